@@ -29,18 +29,13 @@
 #ifndef DAP_OBJMEMCACHE_H_
 #define DAP_OBJMEMCACHE_H_
 
-#include <cassert>
-
+#include <memory>
+#include <ostream>
 #include <string>
-#include <map>
-
-#include "BESIndent.h"
 
-namespace libdap {
-    class DapObj;
-}
+#include <libdap/DapObj.h>
 
-//namespace bes {
+#include "LRUCache.h"
 
 /**
  * @brief An in-memory cache for DapObj (DAS, DDS, ...) objects
@@ -60,56 +55,24 @@ namespace libdap {
  * a DAS to the BES for serialization requires that a copy be made
  * since the BES will delete the returned object.
  *
- * The cache implements a LRU purge policy, where when the purge()
- * method is called, the oldest 20% of times are removed. When an
- * item is accessed (add() or get()), it's access time is updated,
- * so the LRU policy is also a low-budget frequency of use policy
- * without actually keeping count of the total number of accesses.
- * The size (number of items, not bytes) of the cache is examined
- * for every add() call and purge() is called if a preset threshold
- * is exceeded. The purge level (20% by default) can be configured.
+ * The cache is an LRUCache: add() and get() make an item the most recently
+ * used and, when the cache is over its item or byte threshold, add() removes
+ * the least recently used items until it is not. Both operations are O(1).
+ * The purge() method can still be used to remove a fraction of the least
+ * recently used items, e.g., when the cache has no threshold.
  *
- * When an object is removed from the cache using remove() or purge(),
- * it is deleted.
+ * The size of an object in bytes is given by the caller of add(), since only
+ * the caller knows it. Objects added without a size count only against the
+ * item threshold.
  *
- * @note The cache uses an unsigned long long to track the age of
- * items in the cache. It's possible that numbers could wrap around
- * (although that would be a very long-running process) in which case
- * the code will think that the newest objects in the cache are the
- * oldest and remove them. After d_entries_threshold, this will
- * even itself out and the cache will correctly purge the oldest
- * entries.
+ * When an object is removed from the cache using remove() or purge(),
+ * or is evicted, it is deleted.
  */
 class ObjMemCache {
-    // TODO Make this a template or make a new version of this that is a
-    //  template so it's typesafe. jhrg 9/6/23
 private:
-    struct Entry {
-        libdap::DapObj *d_obj;
-        const std::string d_name;
-
-        // We need the string so that we can erase the index entry easily
-        Entry(libdap::DapObj *o, const std::string &n): d_obj(o), d_name(n) { }
-        // deleting an Entry deletes the thing it references
-        ~Entry() { delete d_obj; d_obj = 0;}
-    };
-
-    // TODO Since d_age is used for both the cache and the index, as the 'int'
-    //  it should be an unsigned int or those should be u long longs. It's
-    //  unlikely we will ever run a process long enough to need 64-bits. jhrg 9/6/23
+    float d_purge_threshold;            // free up this fraction of the cache in purge()
 
-    unsigned long long d_age;           // When obj was added or last accessed
-    unsigned int d_entries_threshold;   // no more than this num of entries
-    float d_purge_threshold;            // free up this fraction of the cache
-
-    typedef std::pair<unsigned int, Entry*> cache_pair_t;  // used by map::insert()
-    typedef std::map<unsigned int, Entry*> cache_t;
-    cache_t cache;
-
-    typedef std::pair<const std::string, unsigned int> index_pair_t;
-    // efficiency improvement - use an unordered_map when C++-11 is adopted
-    typedef std::map<const std::string, unsigned int> index_t;
-    index_t index;
+    LRUCache<std::unique_ptr<libdap::DapObj>> d_cache;
 
     friend class DDSMemCacheTest;
 
@@ -117,31 +80,28 @@ public:
     /**
      * @brief Initialize the DapObj cache
      * This constructor builds a cache that will require the
-     * caller manage the purge() operations. Setting the
-     * entries_threshold property to zero disables checking the
-     * cache size in add().
+     * caller manage the purge() operations.
      * @see purge().
      */
-    ObjMemCache(): d_age(0), d_entries_threshold(0), d_purge_threshold(0.2) { }
+    ObjMemCache(): d_purge_threshold(0.2) { }
 
     /**
      * @brief Initialize the DapObj cache to use an item count threshold
      *
-     * The purge() method will be automatically run whenever the threshold
-     * value is exceeded and add() is called.
-     * @param entries_threshold Purge the cache when this number of
-     * items are exceeded.
-     * @param purge_threshold When purging items, remove this fraction of
-     * the LRU items (e.g., 0.2 --> the oldest 20% items are removed)
+     * The least recently used items are removed whenever add() puts the cache
+     * over a threshold.
+     * @param entries_threshold The most items the cache holds; zero means no limit
+     * @param purge_threshold The fraction of the LRU items removed by purge()
+     * when it is called without an argument.
+     * @param bytes_threshold The largest total size, in bytes, of the items
+     * in the cache; zero (the default) means no limit.
      */
-    ObjMemCache(unsigned int entries_threshold, float purge_threshold): d_age(0),
-        d_entries_threshold(entries_threshold), d_purge_threshold(purge_threshold) {
-        // d_entries_threshold = entries_threshold >> 1; // * 2
-    }
+    ObjMemCache(unsigned int entries_threshold, float purge_threshold, unsigned long long bytes_threshold = 0):
+        d_purge_threshold(purge_threshold), d_cache(entries_threshold, bytes_threshold) { }
 
-    virtual ~ObjMemCache();
+    virtual ~ObjMemCache() = default;
 
-    virtual void add(libdap::DapObj *obj, const std::string &key);
+    virtual void add(libdap::DapObj *obj, const std::string &key, unsigned long long size = 0);
 
     virtual void remove(const std::string &key);
 
@@ -151,31 +111,25 @@ public:
      * @brief How many items are in the cache
      * @return The number of items in the cache
      */
-    virtual unsigned int size() const {
-        assert(cache.size() == index.size());
-        return cache.size();
-    }
+    virtual unsigned int size() const { return d_cache.size(); }
+
+    /// @brief The total size, in bytes, of the items added with a size
+    virtual unsigned long long bytes() const { return d_cache.bytes(); }
 
     virtual void purge(float fraction);
 
+    /// @brief Remove the LRU fraction of the items given to the constructor
+    virtual void purge() { purge(d_purge_threshold); }
+
     /**
      * @brief What is in the cache
      * @param os Dump info to this stream
      */
-    virtual void dump(ostream &os) {
+    virtual void dump(std::ostream &os) {
         os << "ObjMemCache" << std::endl;
-        os << "Length of index: " << index.size() << std::endl;
-        for(index_t::const_iterator it = index.begin(); it != index.end(); ++it)  {
-            os << it->first << " --> " << it->second << std::endl;
-        }
-
-        os << "Length of cache: " << cache.size() << std::endl;
-        for(cache_t::const_iterator it = cache.begin(); it != cache.end(); ++it)  {
-            os << it->first << " --> " << it->second->d_name << std::endl;
-        }
+        d_cache.dump(os);
     }
 };
 
-// } namespace bes
 
 #endif /* DAP_OBJMEMCACHE_H_ */
@@ -91,14 +91,12 @@ public:
         ObjMemCache empty_cache;
         DBG2(empty_cache.dump(cerr));
 
-        CPPUNIT_ASSERT(empty_cache.cache.size() == 0);
-        CPPUNIT_ASSERT(empty_cache.index.size() == 0);
+        CPPUNIT_ASSERT(empty_cache.size() == 0);
 
         ObjMemCache *empty_cache_ptr = new ObjMemCache;
         DBG2(empty_cache_ptr->dump(cerr));
 
-        CPPUNIT_ASSERT(empty_cache_ptr->cache.size() == 0);
-        CPPUNIT_ASSERT(empty_cache_ptr->index.size() == 0);
+        CPPUNIT_ASSERT(empty_cache_ptr->size() == 0);
 
         delete empty_cache_ptr;
     }
@@ -115,8 +113,7 @@ public:
 
         DBG2(cache->dump(cerr));
 
-        CPPUNIT_ASSERT(cache->cache.size() == 1);
-        CPPUNIT_ASSERT(cache->index.size() == 1);
+        CPPUNIT_ASSERT(cache->size() == 1);
 
         delete cache;
     }
@@ -134,8 +131,7 @@ public:
 
         DBG2(cache->dump(cerr));
 
-        CPPUNIT_ASSERT(cache->cache.size() == 2);
-        CPPUNIT_ASSERT(cache->index.size() == 2);
+        CPPUNIT_ASSERT(cache->size() == 2);
 
         //delete dds;   the Cache will delete them, so we don't have to
         //delete dds2;
@@ -144,35 +140,64 @@ public:
 
     void purge_test()
     {
-        CPPUNIT_ASSERT(dds_cache->cache.size() == 10);
-        CPPUNIT_ASSERT(dds_cache->index.size() == 10);
+        CPPUNIT_ASSERT(dds_cache->size() == 10);
 
         dds_cache->purge(0.2);
 
         DBG2(dds_cache->dump(cerr));
 
-        CPPUNIT_ASSERT(dds_cache->cache.size() == 8);
-        CPPUNIT_ASSERT(dds_cache->index.size() == 8);
+        CPPUNIT_ASSERT(dds_cache->size() == 8);
     }
 
     void test_get_obj()
     {
         string name = "0_DDS";
-        CPPUNIT_ASSERT(dds_cache->index.find(name)->second == 1);
 
         // dds here is a weak pointer. jhrg 3/30/22
         DDS *dds = static_cast<DDS*>(dds_cache->get(name));
 
         CPPUNIT_ASSERT(dds != 0);
-        // check that the count is updated
+        // check that the entry is now the most recently used; purge() removes '1_DDS' instead
 
-        CPPUNIT_ASSERT(dds_cache->index.find(name)->second == 11);
+        dds_cache->purge(0.1);
+        CPPUNIT_ASSERT(dds_cache->get(name) == dds);
+        CPPUNIT_ASSERT(dds_cache->get("1_DDS") == 0);
+    }
+
+    void threshold_test()
+    {
+        ObjMemCache cache(3, 0.2);
+
+        BaseTypeFactory factory;
+        cache.add(new DDS(&factory, "one"), "one");
+        cache.add(new DDS(&factory, "two"), "two");
+        cache.add(new DDS(&factory, "three"), "three");
+
+        // 'one' is used, so 'two' is the least recently used and is removed
+        CPPUNIT_ASSERT(cache.get("one") != 0);
+        cache.add(new DDS(&factory, "four"), "four");
+
+        CPPUNIT_ASSERT(cache.size() == 3);
+        CPPUNIT_ASSERT(cache.get("one") != 0);
+        CPPUNIT_ASSERT(cache.get("two") == 0);
+    }
+
+    void bytes_threshold_test()
+    {
+        ObjMemCache cache(0, 0.2, 100);
+
+        BaseTypeFactory factory;
+        cache.add(new DDS(&factory, "one"), "one", 60);
+        cache.add(new DDS(&factory, "two"), "two", 60);
+
+        CPPUNIT_ASSERT(cache.size() == 1);
+        CPPUNIT_ASSERT(cache.bytes() == 60);
+        CPPUNIT_ASSERT(cache.get("two") != 0);
     }
 
     void remove_test()
     {
-        CPPUNIT_ASSERT(dds_cache->cache.size() == 10);
-        CPPUNIT_ASSERT(dds_cache->index.size() == 10);
+        CPPUNIT_ASSERT(dds_cache->size() == 10);
 
         //CPPUNIT_ASSERT(dds_cache->index.count("0_DDS") == 1);
 
@@ -182,8 +207,7 @@ public:
 
         DBG2(dds_cache->dump(cerr));
 
-        CPPUNIT_ASSERT(dds_cache->cache.size() == 7);
-        CPPUNIT_ASSERT(dds_cache->index.size() == 7);
+        CPPUNIT_ASSERT(dds_cache->size() == 7);
     }
 
     CPPUNIT_TEST_SUITE( DDSMemCacheTest );
@@ -194,6 +218,8 @@ public:
     CPPUNIT_TEST(purge_test);
     CPPUNIT_TEST(test_get_obj);
     CPPUNIT_TEST(remove_test);
+    CPPUNIT_TEST(threshold_test);
+    CPPUNIT_TEST(bytes_threshold_test);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -34,6 +34,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include <functional>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -55,6 +56,12 @@
 #define LOCK_STATUS "cache-lock-status"
 
 #define CACHE_CONTROL "cache_control"
+#define CACHE_INDEX "cache_index"
+#define CACHE_SHARDS "cache_shards"
+
+// The number of size counters in the cache_shards file. Writers that add files
+// with different names usually update different counters.
+static const unsigned int NUM_CACHE_SHARDS = 16;
 
 #define prolog std::string("BESFileLockingCache::").append(__func__).append("() - ")
 
@@ -113,6 +120,37 @@ public:
     }
 };
 
+/// Like AdvisoryLockGuard, but locks only one counter in the cache_shards file.
+class ShardLockGuard {
+    int d_fd; /// the descriptor to lock
+    off_t d_start;
+
+    void set_lock(int type) {
+        struct flock l{};
+        l.l_type = type;
+        l.l_whence = SEEK_SET;
+        l.l_start = d_start;
+        l.l_len = sizeof(unsigned long long);
+        if (fcntl(d_fd, F_SETLKW, &l) == -1) {
+            ERROR_LOG("Could not " + string(type == F_UNLCK ? "unlock" : "lock") + " a cache size shard (fcntl: "
+                      + get_errno() + ").");
+        }
+    }
+
+public:
+    ShardLockGuard() = delete;
+    ShardLockGuard(const ShardLockGuard &) = delete;
+    ShardLockGuard &operator=(const ShardLockGuard &) = delete;
+
+    ShardLockGuard(int fd, unsigned int shard) : d_fd(fd), d_start(shard * sizeof(unsigned long long)) {
+        set_lock(F_WRLCK);
+    }
+
+    ~ShardLockGuard() {
+        set_lock(F_UNLCK);
+    }
+};
+
 /** @brief Make an instance of FileLockingCache
  *
  * Instantiate the FileLockingClass, using the given values for the cache
@@ -140,6 +178,16 @@ BESFileLockingCache::BESFileLockingCache(string cache_dir, string prefix, unsign
     m_initialize_cache_info();
 }
 
+/// Write the size of the cache to the cache info file. The cache must be locked.
+static void write_cache_info_size(int fd, unsigned long long size)
+{
+    if (lseek(fd, 0, SEEK_SET) == -1)
+        throw BESInternalError(prolog + "Could not rewind to front of cache info file.", __FILE__, __LINE__);
+
+    if (write(fd, &size, sizeof(unsigned long long)) != sizeof(unsigned long long))
+        throw BESInternalError(prolog + "Could not write size info to the cache info file!", __FILE__, __LINE__);
+}
+
 /**
  * A blocking call to create a file locked for write.
  *
@@ -210,7 +258,8 @@ bool BESFileLockingCache::m_initialize_cache_info()
 
         // See if we can create it. If so, that means it doesn't exist. So make it and
         // set the cache initial size to zero.
-        if (createLockedFile(d_cache_info, d_cache_info_fd)) {
+        const bool new_cache_info = createLockedFile(d_cache_info, d_cache_info_fd);
+        if (new_cache_info) {
             // initialize the cache size to zero
             unsigned long long size = 0;
             if (write(d_cache_info_fd, &size, sizeof(unsigned long long)) != sizeof(unsigned long long))
@@ -234,6 +283,30 @@ bool BESFileLockingCache::m_initialize_cache_info()
         }
 
         BESDEBUG(CACHE, prolog << "d_cache_info_fd: " << d_cache_info_fd << endl);
+
+        // The sizes of files added to the cache accumulate in the shards until the
+        // cache is locked for writing; then they are added to the cache info file.
+        d_cache_shards = BESUtil::assemblePath(d_cache_dir, d_prefix + CACHE_SHARDS, true);
+        if ((d_cache_shards_fd = open(d_cache_shards.c_str(), O_RDWR | O_CREAT, 0666)) == -1) {
+            throw BESInternalError(prolog + "Failed to open cache shards file: " + d_cache_shards + " errno: " + get_errno(), __FILE__, __LINE__);
+        }
+        struct stat sb{};
+        if (new_cache_info || (fstat(d_cache_shards_fd, &sb) == 0 && sb.st_size < (off_t)(NUM_CACHE_SHARDS * sizeof(unsigned long long)))) {
+            AdvisoryLockGuard write_alg(d_cache_info_fd, F_WRLCK);
+            if (new_cache_info)
+                m_set_cache_size(0);
+            else if (ftruncate(d_cache_shards_fd, NUM_CACHE_SHARDS * sizeof(unsigned long long)) == -1)
+                throw BESInternalError(prolog + "Could not size the cache shards file: " + d_cache_shards, __FILE__, __LINE__);
+        }
+
+        // A new (or damaged) index is built from the files already in the cache. The cache
+        // works without the index, but update_and_purge() then has to list the directory.
+        // The cache is locked first, since opening a new index writes its header.
+        AdvisoryLockGuard write_alg(d_cache_info_fd, F_WRLCK);
+        if (d_index.open(BESUtil::assemblePath(d_cache_dir, d_prefix + CACHE_INDEX, true)) && d_index.needs_rebuild()) {
+            CacheFiles contents;
+            m_set_cache_size(m_rebuild_index(contents));
+        }
     }
 
     BESDEBUG(CACHE, prolog << "END [" << "CACHE IS " << (cache_enabled()?"ENABLED]":"DISABLED]") << endl);
@@ -574,7 +647,10 @@ bool BESFileLockingCache::get_read_lock(const string &target, int &fd)
 #if USE_GET_SHARED_LOCK
     status = getSharedLock(target, fd);
 
-    if (status) m_record_descriptor(target, fd);
+    if (status) {
+        m_record_descriptor(target, fd);
+        d_index.access(m_index_name(target));
+    }
 #else
     fd = m_find_descriptor(target);
     // fd == -1 --> The file is not currently open
@@ -624,7 +700,9 @@ bool BESFileLockingCache::get_read_lock(const string &target, int &fd)
  * if fcntl(2) returns an error. */
 bool BESFileLockingCache::create_and_lock(const string &target, int &fd)
 {
-    AdvisoryLockGuard write_alg(d_cache_info_fd, F_WRLCK);
+    // A shared lock is enough; open(2) with O_EXCL ensures only one process makes the file.
+    // The lock keeps update_and_purge() from running at the same time.
+    AdvisoryLockGuard read_alg(d_cache_info_fd, F_RDLCK);
 #if 0
     lock_cache_write();
 #endif
@@ -756,56 +834,100 @@ void BESFileLockingCache::unlock_and_close(const string &file_name)
     BESDEBUG(LOCK,  prolog << "END file: "<< file_name<< endl);
 }
 
+/**
+ * @brief Read the size of the cache.
+ *
+ * The size is the value in the cache info file plus the counters in the
+ * cache shards file. The counters are read without their locks, so a size
+ * being added by another process may be missed; the next call will see it.
+ *
+ * @note The cache must be locked (shared or exclusive).
+ * @return The size of the cache
+ */
+unsigned long long BESFileLockingCache::m_read_cache_size()
+{
+    unsigned long long current_size;
+    if (pread(d_cache_info_fd, &current_size, sizeof(unsigned long long), 0) != sizeof(unsigned long long))
+        throw BESInternalError(prolog + "Could not get read size info from the cache info file!", __FILE__, __LINE__);
+
+    unsigned long long shards[NUM_CACHE_SHARDS];
+    if (pread(d_cache_shards_fd, shards, sizeof(shards), 0) != sizeof(shards))
+        throw BESInternalError(prolog + "Could not read the cache shards file!", __FILE__, __LINE__);
+
+    for (auto shard: shards)
+        current_size += shard;
+
+    return current_size;
+}
+
+/**
+ * @brief Add the cache shard counters to the size in the cache info file.
+ *
+ * @note The cache must be locked exclusively.
+ * @return The size of the cache
+ */
+unsigned long long BESFileLockingCache::m_fold_cache_shards()
+{
+    unsigned long long current_size = m_read_cache_size();
+    m_set_cache_size(current_size);
+    return current_size;
+}
+
+/**
+ * @brief Write the size of the cache to the cache info file and zero the shard counters.
+ *
+ * @note The cache must be locked exclusively.
+ * @param size The size of the cache
+ */
+void BESFileLockingCache::m_set_cache_size(unsigned long long size)
+{
+    write_cache_info_size(d_cache_info_fd, size);
+
+    const unsigned long long shards[NUM_CACHE_SHARDS] = {};
+    if (pwrite(d_cache_shards_fd, shards, sizeof(shards), 0) != sizeof(shards))
+        throw BESInternalError(prolog + "Could not write the cache shards file!", __FILE__, __LINE__);
+}
+
 /** @brief Update the cache info file to include 'target'
  *
- * Add the size of the named file to the total cache size recorded in the
- * cache info file. The cache info file is exclusively locked by this
- * method for its duration. This updates the cache info file and returns
- * the new size.
+ * Add the size of the named file to the total cache size. The cache is
+ * locked (shared) for the duration of this method, so update_and_purge()
+ * cannot run at the same time, but other processes can add files. The size
+ * is added to one of the counters in the cache shards file, chosen by the
+ * file's name, and only that counter is locked exclusively.
  *
  * @param target The name of the file
  * @return The new size of the cache
  */
 unsigned long long BESFileLockingCache::update_cache_info(const string &target)
 {
-    AdvisoryLockGuard write_alg(d_cache_info_fd, F_WRLCK);
-    unsigned long long current_size;
-#if 0
-    try {
-        lock_cache_write();
-#endif
+    AdvisoryLockGuard read_alg(d_cache_info_fd, F_RDLCK);
 
-        if (lseek(d_cache_info_fd, 0, SEEK_SET) == -1)
-            throw BESInternalError(prolog + "Could not rewind to front of cache info file.", __FILE__, __LINE__);
+    struct stat buf;
+    if (stat(target.c_str(), &buf) != 0)
+        throw BESInternalError(prolog + "Could not read the size of the new file: " + target + " : " + get_errno(), __FILE__,
+            __LINE__);
 
-        // read the size from the cache info file
-        if (read(d_cache_info_fd, &current_size, sizeof(unsigned long long)) != sizeof(unsigned long long))
-            throw BESInternalError(prolog + "Could not get read size info from the cache info file!", __FILE__, __LINE__);
+    const string name = m_index_name(target);
+    const unsigned int shard = std::hash<string>()(name) % NUM_CACHE_SHARDS;
+    const off_t offset = shard * sizeof(unsigned long long);
+    {
+        ShardLockGuard shard_lg(d_cache_shards_fd, shard);
 
-        struct stat buf;
-        int statret = stat(target.c_str(), &buf);
-        if (statret == 0)
-            current_size += buf.st_size;
-        else
-            throw BESInternalError(prolog + "Could not read the size of the new file: " + target + " : " + get_errno(), __FILE__,
-                __LINE__);
+        unsigned long long shard_size;
+        if (pread(d_cache_shards_fd, &shard_size, sizeof(unsigned long long), offset) != sizeof(unsigned long long))
+            throw BESInternalError(prolog + "Could not read the cache shards file!", __FILE__, __LINE__);
 
-        BESDEBUG(CACHE,  prolog << "cache size updated to: " << current_size << endl);
+        shard_size += buf.st_size;
 
-        if (lseek(d_cache_info_fd, 0, SEEK_SET) == -1)
-            throw BESInternalError(prolog + "Could not rewind to front of cache info file.", __FILE__, __LINE__);
+        if (pwrite(d_cache_shards_fd, &shard_size, sizeof(unsigned long long), offset) != sizeof(unsigned long long))
+            throw BESInternalError(prolog + "Could not write the cache shards file!", __FILE__, __LINE__);
+    }
 
-        if (write(d_cache_info_fd, &current_size, sizeof(unsigned long long)) != sizeof(unsigned long long))
-            throw BESInternalError(prolog + "Could not write size info from the cache info file!", __FILE__, __LINE__);
+    d_index.add(name, buf.st_size);
 
-#if 0
-    unlock_cache();
-    }
-    catch (...) {
-        unlock_cache();
-        throw;
-    }
-#endif
+    unsigned long long current_size = m_read_cache_size();
+    BESDEBUG(CACHE,  prolog << "cache size updated to: " << current_size << " (shard " << shard << ")" << endl);
 
     return current_size;
 }
@@ -821,36 +943,15 @@ bool BESFileLockingCache::cache_too_big(unsigned long long current_size) const
 
 /** @brief Get the cache size.
  *
- * Read the size information from the cache info file and return it.
- * This methods locks the cache.
+ * Read the size information from the cache info and cache shards files and
+ * return it. This methods locks the cache.
  *
  * @return The size of the cache.
  */
 unsigned long long BESFileLockingCache::get_cache_size()
 {
     AdvisoryLockGuard read_alg(d_cache_info_fd, F_RDLCK);
-    unsigned long long current_size;
-#if 0
-    try {
-        lock_cache_read();
-#endif
-
-        if (lseek(d_cache_info_fd, 0, SEEK_SET) == -1)
-            throw BESInternalError(prolog + "Could not rewind to front of cache info file.", __FILE__, __LINE__);
-        // read the size from the cache info file
-        if (read(d_cache_info_fd, &current_size, sizeof(unsigned long long)) != sizeof(unsigned long long))
-            throw BESInternalError(prolog + "Could not get read size info from the cache info file!", __FILE__, __LINE__);
-
-#if 0
-    unlock_cache();
-    }
-    catch (...) {
-        unlock_cache();
-        throw;
-    }
-#endif
-
-    return current_size;
+    return m_read_cache_size();
 }
 
 static bool entry_op(cache_entry &e1, cache_entry &e2)
@@ -867,10 +968,14 @@ unsigned long long BESFileLockingCache::m_collect_cache_dir_info(CacheFiles &con
     struct dirent *dit = nullptr;
     vector<string> files;
     // go through the cache directory and collect all the files that
-    // start with the matching prefix
+    // start with the matching prefix, except the cache info, shards and index files
+    const string cache_control = d_prefix + CACHE_CONTROL;
+    const string cache_shards = d_prefix + CACHE_SHARDS;
+    const string cache_index = d_prefix + CACHE_INDEX;
     while ((dit = readdir(dip)) != NULL) {
         string dirEntry = dit->d_name;
-        if (dirEntry.compare(0, d_prefix.size(), d_prefix) == 0 && dirEntry != d_cache_info) {
+        if (dirEntry.compare(0, d_prefix.size(), d_prefix) == 0 && dirEntry != cache_control && dirEntry != cache_shards
+            && dirEntry.compare(0, cache_index.size(), cache_index) != 0) {
             files.push_back(d_cache_dir + "/" + dirEntry);
         }
     }
@@ -901,6 +1006,33 @@ unsigned long long BESFileLockingCache::m_collect_cache_dir_info(CacheFiles &con
     return current_size;
 }
 
+/** Private. The name of a cache file in the index; the name of the file without the directory. */
+string BESFileLockingCache::m_index_name(const string &file) const
+{
+    return file.substr(file.find_last_of('/') + 1);
+}
+
+/**
+ * Private. Rebuild the index by listing the cache directory. The cache must
+ * be locked for writing.
+ *
+ * @param contents Value-result parameter; the files in the cache, oldest first
+ * @return The size of the files in the cache
+ */
+unsigned long long BESFileLockingCache::m_rebuild_index(CacheFiles &contents)
+{
+    unsigned long long computed_size = m_collect_cache_dir_info(contents);
+
+    vector<CacheIndex::entry> entries;
+    for (const auto &file: contents)
+        entries.emplace_back(m_index_name(file.name), file.size, file.time);
+
+    if (d_index.is_open() && !d_index.rebuild(entries))
+        ERROR_LOG(prolog + "Could not rebuild the cache index for " + d_cache_dir);
+
+    return computed_size;
+}
+
 /**
  * A non-blocking call to get an exclusive (write) lock on a file in the cache.
  * Because this cache uses per-process advisory locking, it's possible to
@@ -962,8 +1094,10 @@ bool BESFileLockingCache::get_exclusive_lock_nb(const string &file_name, int &re
 /** @brief Purge files from the cache
  *
  * Purge files, oldest to newest, if the current size of the cache exceeds the
- * size of the cache specified in the constructor. This method uses an exclusive
- * lock on the cache for the duration of the purge process.
+ * size of the cache specified in the constructor. The files are chosen, using
+ * the cache index, and locked while the cache is locked; they are removed
+ * after the cache is unlocked. If the index does not match the size recorded
+ * in the cache info file, the cache directory is listed to rebuild it.
  *
  * @note If the cache size in bytes is zero, calling this method has no affect
  * (the cache is unlimited in size). Other public methods like update_cache_info()
@@ -983,81 +1117,89 @@ void BESFileLockingCache::update_and_purge(const string &new_file)
         return;
     }
 
-    AdvisoryLockGuard write_alg(d_cache_info_fd, F_WRLCK);
-#if 0
-    try {
-        lock_cache_write();
-#endif
+    // Another process may have purged the cache since the caller looked at its size;
+    // checking with a shared lock lets the others keep adding files.
+    if (!cache_too_big(get_cache_size())) {
+        BESDEBUG(CACHE, prolog << "The cache is no longer too big, so no need to purge." << endl);
+        return;
+    }
+
+    // The files to remove and their locked descriptors
+    vector<pair<string, int>> victims;
+
+    {
+        AdvisoryLockGuard write_alg(d_cache_info_fd, F_WRLCK);
 
+        unsigned long long computed_size = m_fold_cache_shards();
+
+        // Only list the directory if the index is missing or out of step with the cache info file.
         CacheFiles contents;
-        unsigned long long computed_size = m_collect_cache_dir_info(contents);
-#if 0
-        if (BESISDEBUG( "cache_contents" )) {
-            BESDEBUG(CACHE, "BEFORE Purge " << computed_size/BYTES_PER_MEG << endl );
-            CacheFiles::iterator ti = contents.begin();
-            CacheFiles::iterator te = contents.end();
-            for (; ti != te; ti++) {
-                BESDEBUG(CACHE, (*ti).time << ": " << (*ti).name << ": size " << (*ti).size/BYTES_PER_MEG << endl );
-            }
+        if (!d_index.sync() || d_index.bytes() != computed_size) {
+            BESDEBUG(CACHE, prolog << "The cache index (" << d_index.bytes() << " bytes) does not match the cache info ("
+                << computed_size << " bytes); listing the cache directory." << endl);
+            computed_size = m_rebuild_index(contents);
         }
-#endif
+        const bool use_index = d_index.is_open() && !d_index.needs_rebuild();
+
         BESDEBUG(CACHE, prolog << "Current and target size (in MB) "
             << computed_size/BYTES_PER_MEG << ", " << d_target_size/BYTES_PER_MEG << endl);
 
-        // This deletes files and updates computed_size
+        // This chooses files and updates computed_size
         if (cache_too_big(computed_size)) {
+            const string new_name = m_index_name(new_file);
+            vector<string> removed;
+
+            // d_target_size is 80% of the maximum cache size. Files are visited oldest first.
+            auto purge_one = [&](const string &name, unsigned long long size) -> bool {
+                if (computed_size <= d_target_size)
+                    return false;
 
-            // d_target_size is 80% of the maximum cache size.
-            // Grab the first which is the oldest in terms of access time.
-            CacheFiles::iterator i = contents.begin();
-            while (i != contents.end() && computed_size > d_target_size) {
                 // Grab an exclusive lock but do not block - if another process has the file locked
                 // just move on to the next file. Also test to see if the current file is the file
                 // this process just added to the cache - don't purge that!
+                string file = d_cache_dir + "/" + name;
                 int cfile_fd;
-                if (i->name != new_file && get_exclusive_lock_nb(i->name, cfile_fd)) {
-                    BESDEBUG(CACHE, prolog << "purge: " << i->name << " removed." << endl);
+                if (name != new_name && get_exclusive_lock_nb(file, cfile_fd)) {
+                    BESDEBUG(CACHE, prolog << "purge: " << file << " chosen." << endl);
+                    victims.emplace_back(file, cfile_fd);
+                    removed.push_back(name);
+                    computed_size -= size;
+                }
+                else if (name != new_name && access(file.c_str(), F_OK) != 0 && errno == ENOENT) {
+                    // Removed by something other than this cache; drop it from the index.
+                    removed.push_back(name);
+                    computed_size -= size;
+                }
+                return true;
+            };
 
-                    if (unlink(i->name.c_str()) != 0)
-                        throw BESInternalError(
-                            prolog + "Unable to purge the file " + i->name + " from the cache: " + get_errno(), __FILE__,
-                            __LINE__);
+            if (use_index)
+                d_index.visit_lru([&purge_one](const CacheIndex::entry &e) { return purge_one(e.name, e.size); });
+            else
+                for (const auto &file: contents)
+                    if (!purge_one(m_index_name(file.name), file.size))
+                        break;
 
-                    unlock(cfile_fd);
-                    computed_size -= i->size;
-                }
-                ++i;
+            for (const auto &name: removed)
+                d_index.remove(name);
 
-                BESDEBUG(CACHE,prolog << "Current and target size (in MB) "
-                    << computed_size/BYTES_PER_MEG << ", " << d_target_size/BYTES_PER_MEG << endl);
-            }
+            BESDEBUG(CACHE,prolog << "Current and target size (in MB) "
+                << computed_size/BYTES_PER_MEG << ", " << d_target_size/BYTES_PER_MEG << endl);
         }
 
-        if (lseek(d_cache_info_fd, 0, SEEK_SET) == -1)
-            throw BESInternalError(prolog + "Could not rewind to front of cache info file.", __FILE__, __LINE__);
+        m_set_cache_size(computed_size);
 
-        if (write(d_cache_info_fd, &computed_size, sizeof(unsigned long long)) != sizeof(unsigned long long))
-            throw BESInternalError(prolog + "Could not write size info to the cache info file!", __FILE__, __LINE__);
-#if 0
-        if (BESISDEBUG( "cache_contents" )) {
-            contents.clear();
-            computed_size = m_collect_cache_dir_info(contents);
-            BESDEBUG(CACHE, "AFTER Purge " << computed_size/BYTES_PER_MEG << endl );
-            CacheFiles::iterator ti = contents.begin();
-            CacheFiles::iterator te = contents.end();
-            for (; ti != te; ti++) {
-                BESDEBUG(CACHE, (*ti).time << ": " << (*ti).name << ": size " << (*ti).size/BYTES_PER_MEG << endl );
-            }
-        }
-#endif
-#if 0
-    unlock_cache();
+        if (use_index)
+            d_index.compact();
     }
-    catch (...) {
-        unlock_cache();
-        throw;
+
+    // The cache is unlocked; the chosen files are still locked, so no other process can use them.
+    for (const auto &victim: victims) {
+        if (unlink(victim.first.c_str()) != 0)
+            ERROR_LOG(prolog + "Unable to purge the file " + victim.first + " from the cache: " + get_errno());
+        unlock(victim.second);
+        BESDEBUG(CACHE, prolog << "purge: " << victim.first << " removed." << endl);
     }
-#endif
 }
 
 /**
@@ -1150,18 +1292,13 @@ void BESFileLockingCache::purge_file(const string &file)
                             prolog + "Unable to purge the file " + file + " from the cache: " + get_errno(), __FILE__,
                             __LINE__);
 
+                d_index.remove(m_index_name(file));
+
                 // FIXME The exception above could result in a leak. jhrg 11/16/22
                 unlock(cfile_fd);
                 cfile_fd = -1;
-                unsigned long long cache_size = get_cache_size() - size;
-
-                if (lseek(d_cache_info_fd, 0, SEEK_SET) == -1)
-                    throw BESInternalError(prolog + "Could not rewind to front of cache info file.", __FILE__,
-                                           __LINE__);
-
-                if (write(d_cache_info_fd, &cache_size, sizeof(unsigned long long)) != sizeof(unsigned long long))
-                    throw BESInternalError(prolog + "Could not write size info to the cache info file!", __FILE__,
-                                           __LINE__);
+                // Not get_cache_size(); its lock guard would release this method's lock.
+                m_set_cache_size(m_read_cache_size() - size);
             }
         }
         catch (...) {
@@ -1209,5 +1346,7 @@ void BESFileLockingCache::dump(ostream &strm) const
     strm << BESIndent::LMarg << "cache dir: " << d_cache_dir << endl;
     strm << BESIndent::LMarg << "prefix: " << d_prefix << endl;
     strm << BESIndent::LMarg << "size (bytes): " << d_max_cache_size_in_bytes << endl;
+    strm << BESIndent::LMarg << "index entries: " << d_index.size() << endl;
+    strm << BESIndent::LMarg << "size shards: " << NUM_CACHE_SHARDS << endl;
     BESIndent::UnIndent();
 }
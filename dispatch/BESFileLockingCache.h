@@ -36,6 +36,7 @@
 #include <list>
 
 #include "BESObj.h"
+#include "CacheIndex.h"
 
 #define USE_GET_SHARED_LOCK 1
 
@@ -68,6 +69,22 @@ typedef std::list<cache_entry> CacheFiles;
  * looks to see if a file is already in the cache, the entire cache is locked.
  * If the file is present, a shared read lock is obtained and the cache is unlocked.
  *
+ * The cache keeps an index of its files in least recently used order (see
+ * CacheIndex) in the file '<prefix>cache_index.' update_cache_info(),
+ * get_read_lock() and purge_file() update it, so update_and_purge() can choose
+ * the files to remove without listing the cache directory. The directory is
+ * listed only when the index is missing or does not agree with the cache info
+ * file. The files chosen are locked while the cache is locked and removed
+ * after it is unlocked.
+ *
+ * Adding files does not need the cache locked exclusively. create_and_lock()
+ * and update_cache_info() take a shared lock on the cache, and the size of a
+ * new file is added to one of several counters in '<prefix>cache_shards,'
+ * chosen by the file's name and locked by itself. Processes adding different
+ * files seldom wait for each other. The counters are added to the size in the
+ * cache info file (and zeroed) when the cache is locked exclusively, that is,
+ * when update_and_purge() finds the cache too big, or by purge_file().
+ *
  * Methods: create_and_lock() and get_read_lock() open and lock files; the former
  * creates the file and locks it exclusively iff it does not exist, while the
  * latter obtains a shared lock iff the file already exists. The unlock()
@@ -108,6 +125,14 @@ class BESFileLockingCache: public BESObj {
     std::string d_cache_info;
     int d_cache_info_fd = -1;
 
+    // Name of the file that holds the sizes added since the cache was last
+    // locked for writing, one counter per shard of the file names
+    std::string d_cache_shards;
+    int d_cache_shards_fd = -1;
+
+    // The files in the cache, least recently used first. Used only with the cache locked.
+    CacheIndex d_index;
+
     // map that relates files to the descriptor used to obtain a lock
     typedef std::multimap<std::string, int> FilesAndLockDescriptors;
     FilesAndLockDescriptors d_locks;
@@ -116,6 +141,12 @@ class BESFileLockingCache: public BESObj {
     bool m_initialize_cache_info();
 
     unsigned long long m_collect_cache_dir_info(CacheFiles &contents);
+    unsigned long long m_rebuild_index(CacheFiles &contents);
+    std::string m_index_name(const std::string &file) const;
+
+    unsigned long long m_read_cache_size();
+    unsigned long long m_fold_cache_shards();
+    void m_set_cache_size(unsigned long long size);
 
     void m_record_descriptor(const std::string &file, int fd);
     int m_remove_descriptor(const std::string &file);
@@ -144,6 +175,9 @@ public:
         if (d_cache_info_fd != -1) {
             close(d_cache_info_fd);
         }
+        if (d_cache_shards_fd != -1) {
+            close(d_cache_shards_fd);
+        }
     }
 
     void initialize(const std::string &cache_dir, const std::string &prefix, unsigned long long size);
@@ -90,6 +90,8 @@ volatile int bes_timeout = 0;
 
 #define BES_TIMEOUT_KEY "BES.TimeOutInSeconds"
 
+vector<p_bes_end_request> BESInterface::d_end_request_callbacks;
+
 static inline void downcase(string &s)
 {
     transform(s.begin(), s.end(), s.begin(), [](int c) { return std::toupper(c); });
@@ -514,6 +516,8 @@ int BESInterface::finish(int status)
  *
  *  This method allows developers to add callbacks at the end of a request,
  *  to do any cleanup or do any extra work at the end of a request
+ *
+ *  @see add_end_request_callback()
  */
 void BESInterface::end_request()
 {
@@ -524,6 +528,35 @@ void BESInterface::end_request()
         d_dhi_ptr->container->release();
         d_dhi_ptr->next_container();
     }
+
+    // A callback that fails does not keep the others from running.
+    for (auto callback: d_end_request_callbacks) {
+        try {
+            callback();
+        }
+        catch (const BESError &e) {
+            ERROR_LOG(prolog + "End of request callback failed: " + e.get_message());
+        }
+        catch (const std::exception &e) {
+            ERROR_LOG(prolog + "End of request callback failed: " + e.what());
+        }
+    }
+}
+
+/** @brief Run a function at the end of every request
+ *
+ * Modules use this to release per-request resources (open file handles,
+ * cached buffers) once the response has been sent. Register callbacks when
+ * the module is loaded, before the server starts handling requests; the
+ * list is not locked.
+ *
+ * @param callback The function to run. It is run once per request, after the
+ * containers have been released. Adding the same function twice has no effect.
+ */
+void BESInterface::add_end_request_callback(p_bes_end_request callback)
+{
+    if (find(d_end_request_callbacks.begin(), d_end_request_callbacks.end(), callback) == d_end_request_callbacks.end())
+        d_end_request_callbacks.push_back(callback);
 }
 
 /** @brief dumps information about this object
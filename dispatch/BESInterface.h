@@ -35,6 +35,7 @@
 
 #include <string>
 #include <ostream>
+#include <vector>
 
 #include "BESObj.h"
 
@@ -42,6 +43,9 @@ class BESError;
 class BESTransmitter;
 class BESDataHandlerInterface;
 
+/// A function run by BESInterface::end_request() after every request.
+typedef void (*p_bes_end_request)();
+
 /** @brief Entry point into BES, building responses to given requests.
 
  BESInterface is an abstract class providing the entry point into the
@@ -120,6 +124,8 @@ private:
     std::ostream *d_strm {nullptr};
     int d_bes_timeout {0}; ///< Command timeout; can be overridden using setContext
 
+    static std::vector<p_bes_end_request> d_end_request_callbacks;
+
 protected:
     BESDataHandlerInterface *d_dhi_ptr {nullptr}; ///< Allocated by the child class
     BESTransmitter *d_transmitter {nullptr};  ///< The Transmitter to use for the result
@@ -152,6 +158,8 @@ public:
 
     virtual int finish(int status);
 
+    static void add_end_request_callback(p_bes_end_request callback);
+
     void dump(std::ostream &strm) const override;
 };
 
@@ -0,0 +1,432 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "BESLog.h"
+#include "BESDebug.h"
+
+#include "CacheIndex.h"
+
+#define ERROR(msg) ERROR_LOG("CacheIndex: " + std::string(msg))
+
+#define MODULE "cache"
+#define prolog std::string("CacheIndex::").append(__func__).append("() - ")
+
+using namespace std;
+
+constexpr uint64_t CacheIndex::MAGIC;
+constexpr uint64_t CacheIndex::VERSION;
+constexpr uint32_t CacheIndex::RECORD_MAGIC;
+constexpr uint32_t CacheIndex::MAX_NAME_SIZE;
+constexpr int64_t CacheIndex::ACCESS_RESOLUTION;
+constexpr uint64_t CacheIndex::COMPACT_FACTOR;
+constexpr uint64_t CacheIndex::COMPACT_MIN;
+
+namespace {
+
+// Read the journal this much at a time.
+const size_t READ_SIZE = 1024 * 1024;
+
+string errno_string() {
+    const char *s_err = strerror(errno);
+    return s_err ? s_err : "unknown error";
+}
+
+bool write_all(int fd, const char *buf, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, buf, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        buf += n;
+        size -= n;
+    }
+    return true;
+}
+
+} // namespace
+
+CacheIndex::~CacheIndex()
+{
+    close();
+}
+
+/**
+ * @brief Open the index file, making it if needed.
+ *
+ * If the file is new or is not an index, needs_rebuild() is true after
+ * this returns.
+ *
+ * @param path The index file; it should be in the cache directory.
+ * @return True if the file was opened, false otherwise.
+ */
+bool CacheIndex::open(const string &path)
+{
+    close();
+    d_path = path;
+    if (!open_file())
+        return false;
+    sync();
+    return true;
+}
+
+void CacheIndex::close()
+{
+    if (d_fd >= 0)
+        ::close(d_fd);
+    d_fd = -1;
+    reset();
+}
+
+/// Forget everything read from the journal.
+void CacheIndex::reset()
+{
+    d_items.clear();
+    d_lru.clear();
+    d_bytes = 0;
+    d_records = 0;
+    d_offset = 0;
+    d_needs_rebuild = false;
+}
+
+bool CacheIndex::open_file()
+{
+    if (d_fd >= 0)
+        ::close(d_fd);
+    reset();
+
+    d_fd = ::open(d_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0666);
+    if (d_fd < 0) {
+        ERROR("Could not open the cache index " + d_path + ": " + errno_string());
+        return false;
+    }
+
+    struct stat sb{};
+    if (fstat(d_fd, &sb) == 0 && sb.st_size == 0) {
+        file_header header{MAGIC, VERSION};
+        if (!write_all(d_fd, reinterpret_cast<const char *>(&header), sizeof(header))) {
+            ERROR("Could not write the cache index " + d_path + ": " + errno_string());
+            return false;
+        }
+        // A new index has no entries, but the cache directory may have files.
+        d_needs_rebuild = true;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read the records added to the index since the last call.
+ *
+ * If the index file was replaced (by compact() or rebuild() in another
+ * process) or removed, it is opened and read again from the start.
+ *
+ * @return True if the index is up to date, false if it cannot be read or
+ * is damaged. In the latter case needs_rebuild() is also true.
+ */
+bool CacheIndex::sync()
+{
+    if (d_fd < 0)
+        return false;
+
+    struct stat path_sb{};
+    struct stat fd_sb{};
+    if (stat(d_path.c_str(), &path_sb) != 0 || fstat(d_fd, &fd_sb) != 0
+        || path_sb.st_ino != fd_sb.st_ino || path_sb.st_dev != fd_sb.st_dev) {
+        BESDEBUG(MODULE, prolog << "The cache index " << d_path << " was replaced; reading it again." << endl);
+        if (!open_file())
+            return false;
+        if (fstat(d_fd, &fd_sb) != 0)
+            return false;
+    }
+
+    if (d_offset == 0) {
+        file_header header{};
+        if (pread(d_fd, &header, sizeof(header), 0) != sizeof(header) || header.magic != MAGIC
+            || header.version != VERSION) {
+            ERROR("The cache index " + d_path + " is not a version " + to_string(VERSION) + " index.");
+            d_needs_rebuild = true;
+            return false;
+        }
+        d_offset = sizeof(header);
+    }
+
+    const auto file_size = static_cast<uint64_t>(fd_sb.st_size);
+    if (file_size <= d_offset)
+        return !d_needs_rebuild;
+
+    // Parse whole records; a record that is only partly written (a writer
+    // died, or is still writing) ends the read and is tried again next time.
+    vector<char> buf;
+    size_t used = 0;    // Bytes of buf that have been parsed
+    uint64_t read_to = d_offset;
+    while (read_to < file_size) {
+        const size_t want = static_cast<size_t>(min<uint64_t>(READ_SIZE, file_size - read_to));
+        buf.erase(buf.begin(), buf.begin() + used);
+        used = 0;
+        const size_t have = buf.size();
+        buf.resize(have + want);
+        const ssize_t n = pread(d_fd, buf.data() + have, want, static_cast<off_t>(read_to));
+        if (n <= 0) {
+            buf.resize(have);
+            break;
+        }
+        buf.resize(have + n);
+        read_to += n;
+
+        while (buf.size() - used >= sizeof(record_header)) {
+            record_header rh{};
+            memcpy(&rh, buf.data() + used, sizeof(rh));
+            if (rh.magic != RECORD_MAGIC || rh.op < ADD || rh.op > REMOVE || rh.name_size == 0
+                || rh.name_size > MAX_NAME_SIZE) {
+                ERROR("The cache index " + d_path + " is damaged at byte " + to_string(d_offset) + ".");
+                d_needs_rebuild = true;
+                return false;
+            }
+            if (buf.size() - used < sizeof(rh) + rh.name_size)
+                break;
+
+            const string name(buf.data() + used + sizeof(rh), rh.name_size);
+            apply(static_cast<op_type>(rh.op), name, rh.size, rh.time, d_offset);
+
+            used += sizeof(rh) + rh.name_size;
+            d_offset += sizeof(rh) + rh.name_size;
+            ++d_records;
+        }
+    }
+
+    return !d_needs_rebuild;
+}
+
+/// Update the entries for a record read from the journal.
+void CacheIndex::apply(op_type op, const string &name, uint64_t size, int64_t time, uint64_t position)
+{
+    auto pos = d_items.find(name);
+
+    switch (op) {
+        case ADD:
+            if (pos != d_items.end()) {
+                d_bytes -= pos->second.size;
+                d_lru.erase(pos->second.position);
+                pos->second = item{size, time, position};
+            }
+            else {
+                d_items.emplace(name, item{size, time, position});
+            }
+            d_bytes += size;
+            d_lru.emplace(position, name);
+            break;
+
+        case ACCESS:
+            // An access can be recorded after a remove by another process.
+            if (pos != d_items.end()) {
+                d_lru.erase(pos->second.position);
+                pos->second.time = time;
+                pos->second.position = position;
+                d_lru.emplace(position, name);
+            }
+            break;
+
+        case REMOVE:
+            if (pos != d_items.end()) {
+                d_bytes -= pos->second.size;
+                d_lru.erase(pos->second.position);
+                d_items.erase(pos);
+            }
+            break;
+    }
+}
+
+/// Append a record to the journal and read it back, along with any records other processes wrote first.
+bool CacheIndex::append(op_type op, const string &name, uint64_t size, int64_t time)
+{
+    if (d_fd < 0)
+        return false;
+
+    if (name.empty() || name.size() > MAX_NAME_SIZE) {
+        ERROR("Cannot index the name '" + name + "'.");
+        return false;
+    }
+
+    // One write() per record, so records from different processes do not mix.
+    record_header rh{RECORD_MAGIC, op, size, time, static_cast<uint32_t>(name.size()), 0};
+    vector<char> record(sizeof(rh) + name.size());
+    memcpy(record.data(), &rh, sizeof(rh));
+    memcpy(record.data() + sizeof(rh), name.data(), name.size());
+
+    if (!write_all(d_fd, record.data(), record.size())) {
+        ERROR("Could not write to the cache index " + d_path + ": " + errno_string());
+        return false;
+    }
+
+    return sync();
+}
+
+/**
+ * @brief Record a file added to the cache (or replaced).
+ * @param name The file's name in the cache
+ * @param size The file's size in bytes
+ * @param time When the file was added
+ * @return True if recorded, false otherwise.
+ */
+bool CacheIndex::add(const string &name, uint64_t size, int64_t time)
+{
+    return append(ADD, name, size, time);
+}
+
+/**
+ * @brief Record that a file in the cache was used.
+ *
+ * The entry becomes the most recently used. Nothing is written if the entry
+ * was recorded less than ACCESS_RESOLUTION seconds ago or is not in the index.
+ *
+ * @param name The file's name in the cache
+ * @param time When the file was used
+ * @return True unless there was an error.
+ */
+bool CacheIndex::access(const string &name, int64_t time)
+{
+    if (!sync())
+        return false;
+
+    auto pos = d_items.find(name);
+    if (pos == d_items.end() || time - pos->second.time < ACCESS_RESOLUTION)
+        return true;
+
+    return append(ACCESS, name, 0, time);
+}
+
+/**
+ * @brief Record a file removed from the cache.
+ * @param name The file's name in the cache
+ * @return True unless there was an error.
+ */
+bool CacheIndex::remove(const string &name)
+{
+    if (!sync())
+        return false;
+
+    if (d_items.find(name) == d_items.end())
+        return true;
+
+    return append(REMOVE, name, 0, ::time(nullptr));
+}
+
+/**
+ * @brief Replace the index with the given entries.
+ *
+ * The new index is written to a temporary file that is then renamed, so other
+ * processes see either the old index or the new one.
+ *
+ * @param entries The entries, least recently used first. A cache can get
+ * these by scanning its directory and sorting the files by access time.
+ * @return True if the index was replaced, false otherwise.
+ */
+bool CacheIndex::rebuild(const vector<entry> &entries)
+{
+    if (d_path.empty())
+        return false;
+
+    const string tmp_path = d_path + ".tmp." + to_string(getpid());
+    const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        ERROR("Could not make the cache index " + tmp_path + ": " + errno_string());
+        return false;
+    }
+
+    // Build the new file in memory; it is small (tens of bytes per entry).
+    vector<char> buf;
+    file_header header{MAGIC, VERSION};
+    buf.insert(buf.end(), reinterpret_cast<const char *>(&header), reinterpret_cast<const char *>(&header) + sizeof(header));
+    for (const auto &e: entries) {
+        if (e.name.empty() || e.name.size() > MAX_NAME_SIZE)
+            continue;
+        record_header rh{RECORD_MAGIC, ADD, e.size, e.time, static_cast<uint32_t>(e.name.size()), 0};
+        buf.insert(buf.end(), reinterpret_cast<const char *>(&rh), reinterpret_cast<const char *>(&rh) + sizeof(rh));
+        buf.insert(buf.end(), e.name.begin(), e.name.end());
+    }
+
+    const bool written = write_all(fd, buf.data(), buf.size());
+    ::close(fd);
+    if (!written || rename(tmp_path.c_str(), d_path.c_str()) != 0) {
+        ERROR("Could not write the cache index " + d_path + ": " + errno_string());
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    BESDEBUG(MODULE, prolog << "Rebuilt " << d_path << " with " << entries.size() << " entries." << endl);
+
+    if (!open_file())
+        return false;
+    return sync();
+}
+
+/**
+ * @brief Rewrite the journal if it holds many more records than entries.
+ * @return True unless there was an error.
+ */
+bool CacheIndex::compact()
+{
+    if (d_records <= max(COMPACT_MIN, COMPACT_FACTOR * d_items.size()))
+        return true;
+
+    vector<entry> entries;
+    entries.reserve(d_items.size());
+    visit_lru([&entries](const entry &e) {
+        entries.push_back(e);
+        return true;
+    });
+
+    BESDEBUG(MODULE, prolog << "Compacting " << d_records << " records to " << entries.size() << endl);
+    return rebuild(entries);
+}
+
+/**
+ * @brief Call a function for each entry, least recently used first.
+ * @param visitor Called with each entry; return false to stop.
+ */
+void CacheIndex::visit_lru(const function<bool(const entry &)> &visitor) const
+{
+    for (const auto &lru: d_lru) {
+        const item &i = d_items.at(lru.second);
+        if (!visitor(entry(lru.second, i.size, i.time)))
+            break;
+    }
+}
+
+void CacheIndex::dump(ostream &strm) const
+{
+    strm << "CacheIndex [" << d_path << "] entries: " << d_items.size() << " bytes: " << d_bytes << " records: "
+         << d_records << (d_needs_rebuild ? " (needs rebuild)" : "") << endl;
+}
@@ -0,0 +1,171 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef CacheIndex_h_
+#define CacheIndex_h_ 1
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief An on-disk index of the files in a cache, in least recently used order.
+ *
+ * The file caches (FileCache and BESFileLockingCache) used to list the cache
+ * directory and stat() every file each time they purged, which takes a long
+ * time, with the cache locked, when there are millions of files. This index
+ * lets them choose what to purge without looking at the directory.
+ *
+ * The index is a file in the cache directory that is a journal: each put,
+ * get and delete appends a small record to it. Each process reads the
+ * records other processes have appended since it last looked (sync()), so
+ * keeping up costs time in proportion to the number of new records. In
+ * memory, the index is a hash map of the entries and a map that orders them
+ * by their most recent record; visit_lru() walks the entries from the least
+ * recently used, so a purge costs time in proportion to the number of files
+ * it removes.
+ *
+ * Access records are written at most once every ACCESS_RESOLUTION seconds
+ * per entry, since file access times have about that resolution. When the
+ * journal holds many more records than entries, compact() rewrites it. A
+ * rewrite makes a new file and renames it over the old one, so a crash
+ * cannot leave a half-written index; the other processes see the new file
+ * the next time they sync().
+ *
+ * If the index is missing or damaged, needs_rebuild() is true; the cache
+ * then scans its directory (once) and calls rebuild().
+ *
+ * This class does no locking. The cache that uses it must hold its cache
+ * lock for every call; remove(), rebuild() and compact() need the exclusive
+ * lock. Because the records are appended with O_APPEND, add() and access()
+ * can be called with a shared lock.
+ *
+ * Like FileCache, the methods report errors in the log and return false
+ * rather than throw.
+ */
+class CacheIndex {
+public:
+    /// An entry in the index
+    struct entry {
+        std::string name;
+        uint64_t size = 0;
+        int64_t time = 0;       // Time of the most recent record, seconds since the epoch
+
+        entry() = default;
+        entry(std::string n, uint64_t s, int64_t t) : name(std::move(n)), size(s), time(t) {}
+    };
+
+private:
+    enum op_type : uint32_t { ADD = 1, ACCESS = 2, REMOVE = 3 };
+
+    struct file_header {
+        uint64_t magic;
+        uint64_t version;
+    };
+
+    struct record_header {
+        uint32_t magic;
+        uint32_t op;
+        uint64_t size;
+        int64_t time;
+        uint32_t name_size;
+        uint32_t reserved;
+    };
+
+    struct item {
+        uint64_t size;
+        int64_t time;
+        uint64_t position;      // Where the item's most recent record is in the journal
+    };
+
+    std::string d_path;
+    int d_fd = -1;
+    uint64_t d_offset = 0;      // How much of the journal has been read
+    bool d_needs_rebuild = false;
+
+    std::unordered_map<std::string, item> d_items;
+    std::map<uint64_t, std::string> d_lru;      // Journal position to name, least recently used first
+    uint64_t d_bytes = 0;
+    uint64_t d_records = 0;                     // Records in the journal
+
+    bool open_file();
+    void reset();
+    void apply(op_type op, const std::string &name, uint64_t size, int64_t time, uint64_t position);
+    bool append(op_type op, const std::string &name, uint64_t size, int64_t time);
+
+    friend class CacheIndexTest;
+
+public:
+    static constexpr uint64_t MAGIC = 0x4245534349445831ULL;   // "BESCIDX1"
+    static constexpr uint64_t VERSION = 1;
+    static constexpr uint32_t RECORD_MAGIC = 0x43495852;       // "CIXR"
+    static constexpr uint32_t MAX_NAME_SIZE = 4096;
+    static constexpr int64_t ACCESS_RESOLUTION = 1;            // seconds
+
+    // Compact when the journal has more than COMPACT_FACTOR records per entry (and at least COMPACT_MIN)
+    static constexpr uint64_t COMPACT_FACTOR = 4;
+    static constexpr uint64_t COMPACT_MIN = 4096;
+
+    CacheIndex() = default;
+    virtual ~CacheIndex();
+
+    CacheIndex(const CacheIndex &) = delete;
+    CacheIndex &operator=(const CacheIndex &) = delete;
+
+    virtual bool open(const std::string &path);
+    virtual void close();
+
+    /// @return True if open() worked
+    virtual bool is_open() const { return d_fd >= 0; }
+
+    /// @return True if the index is new or damaged and must be rebuilt from the cache directory.
+    virtual bool needs_rebuild() const { return d_needs_rebuild; }
+
+    virtual bool sync();
+    virtual bool rebuild(const std::vector<entry> &entries);
+    virtual bool compact();
+
+    virtual bool add(const std::string &name, uint64_t size, int64_t time = ::time(nullptr));
+    virtual bool access(const std::string &name, int64_t time = ::time(nullptr));
+    virtual bool remove(const std::string &name);
+
+    /// @return True if the name is in the index
+    virtual bool contains(const std::string &name) const { return d_items.find(name) != d_items.end(); }
+
+    /// @return The number of entries
+    virtual uint64_t size() const { return d_items.size(); }
+
+    /// @return The total size of the entries in bytes
+    virtual uint64_t bytes() const { return d_bytes; }
+
+    virtual void visit_lru(const std::function<bool(const entry &)> &visitor) const;
+
+    virtual void dump(std::ostream &strm) const;
+};
+
+#endif // CacheIndex_h_
@@ -30,7 +30,10 @@
 
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <future>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <iomanip>
@@ -47,6 +50,7 @@
 
 #include "BESUtil.h"
 #include "BESLog.h"
+#include "CacheIndex.h"
 
 // Make all the error log messages uniform in one small way. This is a macro
 // so that we can switch to exceptions if that seems necessary. jhrg 11/06/23
@@ -109,6 +113,25 @@ const unsigned long long MEGABYTE = 1048576;
  * cache_info file. This method exists to allow the caller to write directly
  * to the file and then close the file descriptor to release the lock.
  *
+ * When many processes miss on the same key at once, get_or_reserve() lets
+ * only one of them make the item. It returns the item if it is cached, else
+ * it makes a 'reservation,' a file locked exclusively for the caller to fill.
+ * The reservation is renamed to the key when the caller commits it, so an
+ * item that was not finished (e.g., besd was killed) is never found. Other
+ * processes that call get_or_reserve() for that key wait until the item is
+ * committed and then get it. If the caller cannot make the item, the waiting
+ * processes are told to make it themselves, at the same time.
+ *
+ * The cache keeps an index of its items in least recently used order (see
+ * CacheIndex) in the file 'cache_index.' put(), get() and del() update the
+ * index, so purge() can choose the items to remove without listing the cache
+ * directory. If the index does not agree with the cache_info file (e.g.,
+ * files were removed by hand or the index is new), purge() rebuilds it by
+ * listing the directory, as it did every time before there was an index.
+ * The cache is locked only while purge() chooses the items; they are removed
+ * afterward, so get() calls wait for a short time only. Use purge_in_background()
+ * to purge in another thread.
+ *
  * @note The locking mechanism uses Unix flock(2) and so is _per file_.
  * Using flock(2) instead of fcntl(2) means that the locking is thread-safe. On
  * older linux kernels (< 2.6.12) flock(2) does not work with NFSv4. Based on
@@ -132,24 +155,38 @@ class FileCache {
     int d_cache_info_fd = -1;
 
     const std::string CACHE_INFO_FILE_NAME = "cache_info";
+    const std::string CACHE_INDEX_FILE_NAME = "cache_index";
+    const std::string RESERVATION_SUFFIX = ".reservation";
+
+    // The items in LRU order. Used only with the cache locked; mutable since clear() is const.
+    mutable CacheIndex d_index;
+
+    // flock(2) locks belong to the open file, so threads that share d_cache_info_fd
+    // are not kept apart by them. This mutex does that.
+    mutable std::mutex d_cache_mtx;
+
+    // The purge started by purge_in_background(), if any
+    std::future<bool> d_purge_future;
+    std::mutex d_purge_mtx;
 
     static std::string get_lock_type_string(int lock_type) {
         return (lock_type == LOCK_EX) ? "Exclusive": "Shared";
     }
 
-    /// Manage the Cache-level locking. Each instance has to be initialized with d_cache_info_fd.
+    /// Manage the Cache-level locking. Each instance has to be initialized with d_cache_info_fd
+    /// and the cache's mutex.
     class CacheLock {
     private:
         int d_fd = -1;
-        std::mutex cache_lock_mtx;
+        std::unique_lock<std::mutex> d_thread_lock;
 
     public:
-        CacheLock() = default;
+        CacheLock() = delete;
         CacheLock(const CacheLock &) = delete;
-        explicit CacheLock(int fd) : d_fd(fd) {}
+        CacheLock(int fd, std::mutex &mtx) : d_fd(fd), d_thread_lock(mtx, std::defer_lock) {}
         CacheLock &operator=(const CacheLock &) = delete;
         ~CacheLock() {
-            if (flock(d_fd, LOCK_UN) < 0)
+            if (d_thread_lock.owns_lock() && flock(d_fd, LOCK_UN) < 0)
                 ERROR("Could not unlock the FileCache.");
         }
 
@@ -158,12 +195,13 @@ class FileCache {
                 ERROR("Call to CacheLock::lock_the_cache with uninitialized lock object.");
                 return false;
             }
-            const std::lock_guard<std::mutex> lock(cache_lock_mtx);
+            d_thread_lock.lock();
             if (flock(d_fd, lock_type) < 0) {
                 if (msg.empty())
                     ERROR(msg + get_lock_type_string(lock_type) + get_errno());
                 else
                     ERROR(msg + get_errno() );
+                d_thread_lock.unlock();
                 return false;
             }
             return true;
@@ -172,8 +210,28 @@ class FileCache {
 
     // These private methods assume they are called on a locked instance of the cache.
 
+    /// @return True if the file is a reservation made by get_or_reserve()
+    bool is_reservation(const std::string &name) const {
+        return name.size() > RESERVATION_SUFFIX.size()
+               && name.compare(name.size() - RESERVATION_SUFFIX.size(), std::string::npos, RESERVATION_SUFFIX) == 0;
+    }
+
+    /// Remove a reservation if the process that made it is gone (it is not locked).
+    void remove_stale_reservation(const std::string &file) const {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            INFO("Removing the abandoned reservation " + file);
+            if (unlink(file.c_str()) != 0)
+                ERROR("Could not remove the abandoned reservation " + file + " " + get_errno());
+        }
+        close(fd);
+    }
+
     /// Scan the cache and return a value-result vector of all the files it
-    /// holds except the cache_info file.
+    /// holds except the cache_info and cache_index files and reservations.
+    /// Reservations whose process is gone are removed.
     /// Return true if successful, false otherwise.
     bool files_in_cache(std::vector<std::string> &files) const {
         // When we move the C++-17, we can use std::filesystem to do this. jhrg 10/24/23
@@ -184,8 +242,13 @@ class FileCache {
             while ((ent = readdir (dir)) != nullptr) {
                 // Skip the '.' and '..' files and the cache info file
                 if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0
-                    || strcmp(ent->d_name, CACHE_INFO_FILE_NAME.c_str()) == 0)
+                    || strcmp(ent->d_name, CACHE_INFO_FILE_NAME.c_str()) == 0
+                    || strncmp(ent->d_name, CACHE_INDEX_FILE_NAME.c_str(), CACHE_INDEX_FILE_NAME.size()) == 0)
                     continue;
+                if (is_reservation(ent->d_name)) {
+                    remove_stale_reservation(BESUtil::pathConcat(d_cache_dir, ent->d_name));
+                    continue;
+                }
                 files.emplace_back(BESUtil::pathConcat(d_cache_dir, ent->d_name));
             }
             closedir (dir);
@@ -234,13 +297,12 @@ class FileCache {
 
     /// Return the size of the cache as recorded in the cache info file.
     /// Return zero on error or if there's nothing in the cache.
+    /// @note Uses pread(2) so that purge_in_background() can peek at the size without the lock.
     unsigned long long get_cache_info_size() const {
         if (d_cache_info_fd == -1)
             return 0;
-        if (lseek(d_cache_info_fd, 0, SEEK_SET) == -1)
-            return 0;
         unsigned long long size = 0;
-        if (read(d_cache_info_fd, &size, sizeof(size)) != sizeof(size))
+        if (pread(d_cache_info_fd, &size, sizeof(size), 0) != sizeof(size))
             return 0;
         return size;
     }
@@ -250,13 +312,49 @@ class FileCache {
     bool update_cache_info_size(unsigned long long size) const {
         if (d_cache_info_fd == -1)
             return false;
-        if (lseek(d_cache_info_fd, 0, SEEK_SET) == -1)
-            return false;
-        if (write(d_cache_info_fd, &size, sizeof(size)) != sizeof(size))
+        if (pwrite(d_cache_info_fd, &size, sizeof(size), 0) != sizeof(size))
             return false;
         return true;
     }
 
+    /// Rebuild the index (and the cache_info size) by listing the cache directory.
+    /// The items are ordered by their access times.
+    bool rebuild_index() const {
+        std::vector<std::string> files;
+        if (!files_in_cache(files))
+            return false;
+
+        std::multimap<time_t, CacheIndex::entry> items;
+        for (const auto &file: files) {
+            struct stat sb{0};
+            if (stat(file.c_str(), &sb) < 0)
+                continue;   // removed since it was listed
+            items.emplace(sb.st_atime, CacheIndex::entry(file.substr(file.find_last_of('/') + 1), sb.st_size,
+                                                         sb.st_atime));
+        }
+
+        std::vector<CacheIndex::entry> entries;
+        entries.reserve(items.size());
+        for (const auto &item: items)
+            entries.push_back(item.second);
+
+        INFO("Rebuilding the cache index for " + d_cache_dir + " (" + std::to_string(entries.size()) + " items).");
+        if (!d_index.rebuild(entries))
+            return false;
+
+        return update_cache_info_size(d_index.bytes());
+    }
+
+    /// Record a new item made using put(key, PutItem&); called by the PutItem dtor.
+    bool put_done(const std::string &key, unsigned long long size) {
+        CacheLock lock(d_cache_info_fd, d_cache_mtx);
+        if (!lock.lock_the_cache(LOCK_EX, "locking the cache in put_done() for: " + key))
+            return false;
+
+        d_index.add(key, size);
+        return update_cache_info_size(get_cache_info_size() + size);
+    }
+
     friend class FileCacheTest;
 
 public:
@@ -312,6 +410,9 @@ public:
             }
             const std::lock_guard<std::mutex> lock(item_mtx);
             if (flock(d_fd, lock_type) < 0) {
+                // For a non-blocking lock, a locked item is not an error.
+                if ((lock_type & LOCK_NB) && errno == EWOULDBLOCK)
+                    return false;
                 if (msg.empty())
                     ERROR("Could not get " + get_lock_type_string(lock_type) + " lock: " + get_errno() );
                 else
@@ -335,16 +436,83 @@ public:
      */
     class PutItem : public Item {
         FileCache &d_fc;
+        std::string d_key;
+        // Set for an item made by get_or_reserve(); it is kept only if commit() is called.
+        bool d_reserved = false;
+        bool d_committed = false;
+
+        std::string reservation_name() const {
+            return BESUtil::pathConcat(d_fc.d_cache_dir, d_key + d_fc.RESERVATION_SUFFIX);
+        }
     public:
         PutItem() = delete;
         explicit PutItem(FileCache &fc) : d_fc(fc) {}
         PutItem(const PutItem &) = delete;
         const PutItem &operator=(const PutItem &) = delete;
         ~PutItem() override {
-            if (!d_fc.update_cache_info_size(d_fc.get_cache_info_size() + get_file_size(get_fd()))) {
+            if (get_fd() == -1)
+                return;
+            if (d_reserved && !d_committed) {
+                // Remove the reservation before unlocking it; the processes waiting for it
+                // see that it was given up.
+                if (unlink(reservation_name().c_str()) != 0)
+                    ERROR("Could not remove the unused reservation: " + d_key + " " + get_errno());
+                close(get_fd());
+                set_fd(-1);
+                return;
+            }
+            // Close (and unlock) the item before locking the cache; a del() with a blocking
+            // lock could be holding the cache lock while it waits for this item.
+            auto size = get_file_size(get_fd());
+            close(get_fd());
+            set_fd(-1);
+            if (!d_fc.put_done(d_key, size)) {
                 ERROR("Could not update the cache info file while unlocking a put item: " + get_errno() );
             }
         }
+
+        void set_key(const std::string &key) {
+            d_key = key;
+        }
+
+        void set_reserved() {
+            d_reserved = true;
+        }
+
+        /**
+         * @brief Keep an item made by get_or_reserve(); without this the item is removed.
+         *
+         * The reservation is given the item's key. The item stays locked until
+         * the PutItem goes out of scope.
+         *
+         * @return False if the item could not be added, e.g., because another
+         * process put an item with the same key; the reservation is removed.
+         */
+        bool commit() {
+            if (!d_reserved || d_committed) {
+                d_committed = true;
+                return true;
+            }
+
+            CacheLock lock(d_fc.d_cache_info_fd, d_fc.d_cache_mtx);
+            if (!lock.lock_the_cache(LOCK_EX, "locking the cache in commit() for: " + d_key))
+                return false;
+
+            // link(2) does not replace an item that is already cached, as rename(2) would.
+            const std::string reservation = reservation_name();
+            if (link(reservation.c_str(), BESUtil::pathConcat(d_fc.d_cache_dir, d_key).c_str()) != 0) {
+                if (errno == EEXIST)
+                    INFO("Could not commit the reserved key/file; it already exists: " + d_key);
+                else
+                    ERROR("Could not commit the reserved key/file: " + d_key + " " + get_errno());
+                return false;
+            }
+            if (unlink(reservation.c_str()) != 0)
+                ERROR("Could not remove the committed reservation: " + d_key + " " + get_errno());
+
+            d_committed = true;
+            return true;
+        }
     };
 
     FileCache() = default;
@@ -352,6 +520,8 @@ public:
     FileCache &operator=(const FileCache &rhs) = delete;
 
     virtual ~FileCache() {
+        if (d_purge_future.valid())
+            d_purge_future.wait();
         if (d_cache_info_fd != -1) {
             close(d_cache_info_fd);
         }
@@ -389,6 +559,15 @@ public:
 
         d_max_cache_size_in_bytes = (unsigned long long)size;
         d_purge_size = (unsigned long long)purge_size;
+
+        // The cache can work without the index; purge() lists the directory if it must.
+        // Lock the cache before opening the index, since opening a new index writes its
+        // header; only one of several processes starting at once may make (and fill) it.
+        CacheLock lock(d_cache_info_fd, d_cache_mtx);
+        if (lock.lock_the_cache(LOCK_EX, "locking the cache in initialize().")
+            && d_index.open(BESUtil::pathConcat(d_cache_dir, CACHE_INDEX_FILE_NAME)) && d_index.needs_rebuild())
+            rebuild_index();
+
         return true;
     }
 
@@ -404,7 +583,7 @@ public:
      */
     bool put(const std::string &key, const std::string &file_name) {
         // Lock the cache. Ensure the cache is unlocked no matter how we exit
-        CacheLock lock(d_cache_info_fd);
+        CacheLock lock(d_cache_info_fd, d_cache_mtx);
         if (!lock.lock_the_cache(LOCK_EX, "locking the cache in put() for: " + key))
             return false;
 
@@ -450,9 +629,12 @@ public:
         }
 
         // NB: The cache_info file ws locked on entry to this method.
-        if (!update_cache_info_size(get_cache_info_size() + get_file_size(fd)))
+        auto file_size = get_file_size(fd);
+        if (!update_cache_info_size(get_cache_info_size() + file_size))
             return false;
 
+        d_index.add(key, file_size);
+
         // The fd_wrapper instances will take care of closing (and thus unlocking) the files.
         return true;
     }
@@ -471,7 +653,7 @@ public:
      */
     bool put(const std::string &key, PutItem &item) {
         // Lock the cache. Ensure the cache is unlocked no matter how we exit
-        CacheLock lock(d_cache_info_fd);
+        CacheLock lock(d_cache_info_fd, d_cache_mtx);
         if (!lock.lock_the_cache(LOCK_EX, "locking the cache in put() for: " + key))
             return false;
 
@@ -492,6 +674,7 @@ public:
         // The Item instance will take care of closing the file.
         item.
                 set_fd(fd);
+        item.set_key(key);
 
         // Lock the file for writing; released when the file descriptor is closed.
         if (!item.
@@ -513,7 +696,7 @@ public:
      */
     bool get(const std::string &key, Item &item, int lock_type = LOCK_SH | LOCK_NB) {
         // Lock the cache. Ensure the cache is unlocked no matter how we exit
-        CacheLock lock(d_cache_info_fd);
+        CacheLock lock(d_cache_info_fd, d_cache_mtx);
         if (!lock.lock_the_cache(LOCK_EX, "Error locking the cache in get() for: " + key))
             return false;
 
@@ -533,11 +716,118 @@ public:
         if (!item.lock_the_item(lock_type, "Error locking the item in get() for: " + key))
             return false;
 
-        // Here's where we should update the info about the item in the cache_info file
+        // The item is now the most recently used.
+        d_index.access(key);
 
         return true;
     }
 
+    /**
+     * @brief Get an item or, if it is not cached, reserve it for the caller to make
+     *
+     * If the item is cached, lock it (shared) using 'item.' If not, make a
+     * reservation for it, locked exclusively using 'put_item,' and set 'reserved'
+     * to true. The caller must write the item and call put_item.commit(), which
+     * gives it the key; if put_item goes out of scope without commit(), the
+     * reservation is removed. While the item is reserved, other calls to
+     * get_or_reserve() for the key wait for it without locking the cache.
+     *
+     * If the process that reserved the item gives up, the waiting calls return
+     * true with neither 'item' nor 'put_item' set (item.get_fd() is -1); the
+     * callers should make the value themselves and not cache it. If that process
+     * dies, its reservation is found by one of the waiting processes, which then
+     * makes the item.
+     *
+     * @param key The key to the cached item
+     * @param item Value-result parameter; holds the item if it was cached
+     * @param put_item Value-result parameter; holds the item if it was reserved
+     * @param reserved Value-result parameter; true if the caller must make the item
+     * @return False if there was an error, true otherwise
+     */
+    bool get_or_reserve(const std::string &key, Item &item, PutItem &put_item, bool &reserved) {
+        reserved = false;
+        const std::string key_file_name = BESUtil::pathConcat(d_cache_dir, key);
+        const std::string reservation_name = key_file_name + RESERVATION_SUFFIX;
+        while (true) {
+            int fd;
+            bool is_reservation;
+            {
+                // Lock the cache. Ensure the cache is unlocked no matter how we exit
+                CacheLock lock(d_cache_info_fd, d_cache_mtx);
+                if (!lock.lock_the_cache(LOCK_EX, "Error locking the cache in get_or_reserve() for: " + key))
+                    return false;
+
+                fd = open(key_file_name.c_str(), O_RDONLY, 0666);
+                if (fd < 0 && errno != ENOENT) {
+                    ERROR("Error opening the cache item in get_or_reserve() for: " + key + " " + get_errno());
+                    return false;
+                }
+
+                is_reservation = fd < 0;
+                if (is_reservation) {
+                    // Not cached. Reserve it, unless another process has.
+                    if ((fd = open(reservation_name.c_str(), O_CREAT | O_RDWR, 0666)) < 0) {
+                        ERROR("Error creating the reservation in get_or_reserve(): " + key + " " + get_errno());
+                        return false;
+                    }
+                    if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+                        // This caller makes the item. Drop anything left by a process that died.
+                        put_item.set_fd(fd);
+                        put_item.set_key(key);
+                        put_item.set_reserved();
+                        if (ftruncate(fd, 0) != 0) {
+                            ERROR("Error emptying the reservation in get_or_reserve(): " + key + " " + get_errno());
+                            return false;
+                        }
+                        reserved = true;
+                        return true;
+                    }
+                }
+                else if (flock(fd, LOCK_SH | LOCK_NB) == 0) {
+                    item.set_fd(fd);
+                    d_index.access(key);
+                    return true;
+                }
+
+                if (errno != EWOULDBLOCK) {
+                    ERROR("Error locking the item in get_or_reserve() for: " + key + " " + get_errno());
+                    close(fd);
+                    return false;
+                }
+            }
+
+            // Another process is making the item. Wait for it without the cache locked.
+            if (flock(fd, LOCK_SH) < 0) {
+                ERROR("Error waiting for the item in get_or_reserve() for: " + key + " " + get_errno());
+                close(fd);
+                return false;
+            }
+
+            struct stat sb{};
+            struct stat key_sb{};
+            if (fstat(fd, &sb) != 0) {
+                ERROR("Error checking the item in get_or_reserve() for: " + key + " " + get_errno());
+                close(fd);
+                return false;
+            }
+
+            // A committed reservation is the item.
+            if (sb.st_nlink > 0 && (!is_reservation
+                                    || (stat(key_file_name.c_str(), &key_sb) == 0 && key_sb.st_ino == sb.st_ino
+                                        && key_sb.st_dev == sb.st_dev))) {
+                item.set_fd(fd);
+                return true;
+            }
+            close(fd);
+
+            // The process making the item gave up; unless another process added the item
+            // since, the caller makes it. If the item was removed or the process died with
+            // the reservation, try again.
+            if (is_reservation && sb.st_nlink == 0 && access(key_file_name.c_str(), F_OK) != 0)
+                return true;
+        }
+    }
+
     /**
      * @brief Remove the item at the given key
      * Remove the key/item. Updates the size recorded in cache_info. Returns false
@@ -550,7 +840,7 @@ public:
      */
     bool del(const std::string &key, int lock_type = LOCK_EX | LOCK_NB) {
         // Lock the cache. Ensure the cache is unlocked no matter how we exit
-        CacheLock lock(d_cache_info_fd);
+        CacheLock lock(d_cache_info_fd, d_cache_mtx);
         if (!lock.lock_the_cache(LOCK_EX, "Error locking the cache in del()."))
             return false;
 
@@ -572,6 +862,8 @@ public:
             return false;
         }
 
+        d_index.remove(key);
+
         if (!update_cache_info_size(get_cache_info_size() - file_size))
             return false;
 
@@ -585,7 +877,7 @@ public:
      */
     bool clear() const {
         // Lock the cache. Ensure the cache is unlocked no matter how we exit
-        CacheLock lock(d_cache_info_fd);
+        CacheLock lock(d_cache_info_fd, d_cache_mtx);
         if (!lock.lock_the_cache(LOCK_EX, "Error locking the cache in clear()."))
             return false;
 
@@ -601,7 +893,10 @@ public:
             }
         }
 
-        return true;
+        if (d_index.is_open())
+            d_index.rebuild({});
+
+        return update_cache_info_size(0);
     }
 
     /**
@@ -611,84 +906,114 @@ public:
      * on every put, every Nth put or not at all. Note that purge() (often) does nothing more
      * than compare the size recorded in the cache_info file (updated on every put())
      * with the configured max cache size.
+     *
+     * The items to remove are taken from the index, least recently used first, and
+     * locked with the cache locked. The files are removed after the cache is unlocked.
      * @return True if the purge operation encountered no errors, false if failures
      * were found. Note that if an entry cannot be removed, that is not an error because
      * the item might be locked since it's in use.
      */
     bool purge() {
-        // Lock the cache. Ensure the cache is unlocked no matter how we exit
-        CacheLock lock(d_cache_info_fd);
-        if (!lock.lock_the_cache(LOCK_EX, "Error locking the cache in purge()."))
-            return false;
-
-        uint64_t ci_size = get_cache_info_size();
-        if (ci_size < d_max_cache_size_in_bytes)
-            return true;
+        // Each victim stays locked (exclusive) until its file is removed.
+        std::vector<std::pair<std::string, std::unique_ptr<Item>>> victims;
 
-        struct item_info {
-            std::string d_name;
-            off_t d_size;
-            item_info(const std::string &name, off_t size) :d_name(name), d_size(size) {}
-        };
+        {
+            // Lock the cache. Ensure the cache is unlocked no matter how we exit
+            CacheLock lock(d_cache_info_fd, d_cache_mtx);
+            if (!lock.lock_the_cache(LOCK_EX, "Error locking the cache in purge()."))
+                return false;
 
-        // sorted by access time, with the oldest time first
-        std::multimap<unsigned long, struct item_info, std::less<>> items;
-        uint64_t total_size = 0;    // for a sanity check. jhrg 11/03/23
+            uint64_t ci_size = get_cache_info_size();
+            if (ci_size < d_max_cache_size_in_bytes)
+                return true;
 
-        std::vector<std::string> files;
-        if (!files_in_cache(files))
-            return false;
-
-        for (const auto &file: files) {
-            struct stat sb{0};
-
-            if (stat(file.c_str(), &sb) < 0) {
-                ERROR("Error getting info on " + file + " in purge() - " + get_errno());
+            if (!d_index.is_open()) {
+                ERROR("The cache index is not open; cannot purge " + d_cache_dir + ".");
                 return false;
             }
 
-            items.insert(std::pair<unsigned long, item_info>(sb.st_atime, item_info(file, sb.st_size)));
-            total_size += sb.st_size;   // sanity check; remove some day? jhrg 11/03/23
-        }
-
-        if (ci_size != total_size) {
-            ERROR("Error cache_info and the measured size of items differ by " + std::to_string(total_size) + " bytes.");
-        }
-
-        // choose which files to remove - since the 'items' map orders the things by time, use that ordering
-        uint64_t removed_bytes = 0;
-        for (const auto &item: items) {
-            if (removed_bytes > d_purge_size)
-                break;
+            // If the index has fallen out of step with cache_info, list the directory once to fix it.
+            if (!d_index.sync() || d_index.bytes() != ci_size) {
+                if (!d_index.needs_rebuild())
+                    ERROR("Error cache_info and the cache index differ by "
+                          + std::to_string((long long)(ci_size - d_index.bytes())) + " bytes.");
+                if (!rebuild_index())
+                    return false;
+                ci_size = d_index.bytes();
+            }
 
-            // Get a non-blocking but exclusive lock on the item before deleting. If the code
-            // cannot get that lock, move on to the next item. jhrg 11/06/23
-            int fd = open(item.second.d_name.c_str(), O_WRONLY, 0666);
-            if (fd < 0) {
-                ERROR("Error opening the cache item in purge() for: " + item.second.d_name + " " + get_errno());
+            // choose which files to remove - the index orders the items by time of last use
+            uint64_t removed_bytes = 0;
+            std::vector<std::string> missing;
+            d_index.visit_lru([&](const CacheIndex::entry &entry) {
+                if (removed_bytes > d_purge_size)
+                    return false;
+
+                // Get a non-blocking but exclusive lock on the item before deleting. If the code
+                // cannot get that lock, move on to the next item. jhrg 11/06/23
+                std::string item_name = BESUtil::pathConcat(d_cache_dir, entry.name);
+                int fd = open(item_name.c_str(), O_WRONLY, 0666);
+                if (fd < 0) {
+                    if (errno == ENOENT)
+                        missing.push_back(entry.name);
+                    else
+                        ERROR("Error opening the cache item in purge() for: " + item_name + " " + get_errno());
+                    return true;
+                }
+                std::unique_ptr<Item> item_lock(new Item(fd));
+                if (!item_lock->lock_the_item(LOCK_EX | LOCK_NB, "locking the cache item in purge() for: " + item_name))
+                    return true;
+
+                removed_bytes += entry.size;
+                victims.emplace_back(entry.name, std::move(item_lock));
+                return true;
+            });
+
+            for (const auto &name: missing)
+                d_index.remove(name);
+            for (const auto &victim: victims)
+                d_index.remove(victim.first);
+
+            // update the cache info file
+            if (!update_cache_info_size(d_index.bytes())) {
+                ERROR("Error updating the cache_info size in purge() - " + get_errno());
                 return false;
             }
-            Item item_lock(fd);  // The Item dtor is called on every loop iteration according to Google. jhrg 11/03/23
-            if (!item_lock.lock_the_item(LOCK_EX | LOCK_NB, "locking the cache item in purge() for: " + item.second.d_name))
-                continue;
 
-            if (remove(item.second.d_name.c_str()) != 0) {
-                ERROR("Error removing " + item.second.d_name + " from cache directory in purge() - " + get_errno());
+            d_index.compact();
+        }
+
+        for (const auto &victim: victims) {
+            std::string item_name = BESUtil::pathConcat(d_cache_dir, victim.first);
+            if (remove(item_name.c_str()) != 0) {
+                ERROR("Error removing " + item_name + " from cache directory in purge() - " + get_errno());
                 // but keep going; this is a soft error
             }
-            else {
-                // but only count the bytes if they are actually removed
-                removed_bytes += item.second.d_size;
-            }
         }
 
-        // update the cache info file
-        if (!update_cache_info_size(ci_size - removed_bytes)) {
-            ERROR("Error updating the cache_info size in purge() - " + get_errno());
-            return false;
+        return true;
+    }
+
+    /**
+     * @brief Purge the cache in another thread.
+     * This returns without waiting. If a purge started by an earlier call is
+     * still running, or the cache is not full, this does nothing.
+     * @return False if the last purge started by this method failed, true otherwise.
+     */
+    bool purge_in_background() {
+        const std::lock_guard<std::mutex> lock(d_purge_mtx);
+        bool status = true;
+        if (d_purge_future.valid()) {
+            if (d_purge_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return true;
+            status = d_purge_future.get();
         }
 
-        return true;
+        // Only a hint; purge() checks again with the cache locked.
+        if (get_cache_info_size() >= d_max_cache_size_in_bytes)
+            d_purge_future = std::async(std::launch::async, &FileCache::purge, this);
+
+        return status;
     }
 };
 
@@ -0,0 +1,255 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef LRUCache_h_
+#define LRUCache_h_ 1
+
+#include <list>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief A least-recently-used memory cache with item and byte limits.
+ *
+ * This is a header-only class. The entries are kept in a list, most recently
+ * used first, and a hash map from each key to its place in the list. So get(),
+ * put() and remove() are O(1): a hit moves the entry to the front of the list
+ * and eviction takes entries from the back.
+ *
+ * The cache can be limited by the number of entries, by the total size of
+ * the entries in bytes, or both; a limit of zero means no limit. The size of
+ * each entry is given by the caller of put(), since only the caller knows how
+ * big a value really is. An entry that is larger than the byte limit on its
+ * own is not cached.
+ *
+ * The cache counts hits, misses and evictions; dump() prints them.
+ *
+ * Like the caches it replaces (ObjMemCache and the NGAP MemoryCache), this
+ * cache is not thread-safe.
+ *
+ * @tparam VALUE The cached type. It must be movable; get(key, value) also
+ * needs it to be copyable. Use std::unique_ptr for objects the cache owns.
+ * @tparam KEY The key type; it must work with std::hash.
+ */
+template <typename VALUE, typename KEY = std::string>
+class LRUCache {
+    struct entry {
+        KEY key;
+        VALUE value;
+        unsigned long long size;
+
+        entry(const KEY &k, VALUE v, unsigned long long s) : key(k), value(std::move(v)), size(s) {}
+    };
+
+    using entry_list = std::list<entry>;
+
+    unsigned long long d_max_items = 0;     //< Max number of entries; zero means no limit
+    unsigned long long d_max_bytes = 0;     //< Max total size of the entries; zero means no limit
+
+    entry_list d_entries;                   //< Most recently used first
+    std::unordered_map<KEY, typename entry_list::iterator> d_index;
+    unsigned long long d_bytes = 0;         //< Total size of the entries
+
+    unsigned long long d_hits = 0;
+    unsigned long long d_misses = 0;
+    unsigned long long d_evictions = 0;
+
+    bool over_limit() const {
+        return (d_max_items && d_entries.size() > d_max_items) || (d_max_bytes && d_bytes > d_max_bytes);
+    }
+
+    /// Remove the least recently used entry.
+    void evict() {
+        const entry &lru = d_entries.back();
+        d_bytes -= lru.size;
+        d_index.erase(lru.key);
+        d_entries.pop_back();
+        ++d_evictions;
+    }
+
+    /// Check the cache for consistency.
+    bool invariant() const {
+        if (d_entries.size() != d_index.size())
+            return false;
+        if (over_limit())
+            return false;
+
+        unsigned long long bytes = 0;
+        for (auto i = d_entries.begin(); i != d_entries.end(); ++i) {
+            auto pos = d_index.find(i->key);
+            if (pos == d_index.end() || pos->second != i)
+                return false;
+            bytes += i->size;
+        }
+        return bytes == d_bytes;
+    }
+
+    friend class LRUCacheTest;
+
+public:
+    LRUCache() = default;
+
+    /**
+     * @param max_items The most entries the cache can hold; zero means no limit
+     * @param max_bytes The largest total size of the entries; zero means no limit
+     */
+    LRUCache(unsigned long long max_items, unsigned long long max_bytes) :
+            d_max_items(max_items), d_max_bytes(max_bytes) {}
+
+    ~LRUCache() = default;
+
+    LRUCache(const LRUCache &) = delete;
+    LRUCache &operator=(const LRUCache &) = delete;
+
+    /**
+     * @brief Set the limits, evicting entries if the cache is now too large.
+     * @param max_items The most entries the cache can hold; zero means no limit
+     * @param max_bytes The largest total size of the entries; zero means no limit
+     */
+    void set_limits(unsigned long long max_items, unsigned long long max_bytes) {
+        d_max_items = max_items;
+        d_max_bytes = max_bytes;
+        while (over_limit())
+            evict();
+    }
+
+    /**
+     * @brief Find an entry, making it the most recently used.
+     * @param key
+     * @return A pointer to the cached value, or null if the key is not in the
+     * cache. The pointer is valid until the entry is removed or evicted.
+     */
+    VALUE *find(const KEY &key) {
+        auto pos = d_index.find(key);
+        if (pos == d_index.end()) {
+            ++d_misses;
+            return nullptr;
+        }
+
+        d_entries.splice(d_entries.begin(), d_entries, pos->second);
+        ++d_hits;
+        return &pos->second->value;
+    }
+
+    /**
+     * @brief Get a copy of the item from the cache.
+     * If the item is not in the cache, the value-result parameter is not modified.
+     * @param key
+     * @param value Value-result parameter; operator=() is used to copy the value of the cached item.
+     * @return Return True if the item is in the cache, false otherwise.
+     */
+    bool get(const KEY &key, VALUE &value) {
+        const VALUE *cached = find(key);
+        if (!cached)
+            return false;
+        value = *cached;
+        return true;
+    }
+
+    /**
+     * @brief Put the item in the cache, making it the most recently used.
+     *
+     * If the key is already in the cache, the value is replaced. Least recently
+     * used entries are evicted until the cache is within its limits.
+     *
+     * @param key
+     * @param value
+     * @param size The size of the value in bytes
+     * @return True if the value was cached, false if it is larger than the cache.
+     */
+    bool put(const KEY &key, VALUE value, unsigned long long size = 0) {
+        remove(key);
+
+        if (d_max_bytes && size > d_max_bytes)
+            return false;
+
+        d_entries.emplace_front(key, std::move(value), size);
+        d_index[key] = d_entries.begin();
+        d_bytes += size;
+
+        while (over_limit())
+            evict();
+
+        return true;
+    }
+
+    /**
+     * @brief Remove an entry.
+     * @param key
+     * @return True if the key was in the cache.
+     */
+    bool remove(const KEY &key) {
+        auto pos = d_index.find(key);
+        if (pos == d_index.end())
+            return false;
+
+        d_bytes -= pos->second->size;
+        d_entries.erase(pos->second);
+        d_index.erase(pos);
+        return true;
+    }
+
+    /**
+     * @brief Evict the least recently used fraction of the entries.
+     * @param fraction Between 0 and 1
+     */
+    void purge(float fraction) {
+        auto num_remove = static_cast<unsigned long long>(d_entries.size() * fraction);
+        while (num_remove-- > 0 && !d_entries.empty())
+            evict();
+    }
+
+    /// @brief Remove all the entries.
+    void clear() {
+        d_entries.clear();
+        d_index.clear();
+        d_bytes = 0;
+    }
+
+    /// @brief How many items are in the cache
+    unsigned long size() const { return d_entries.size(); }
+
+    /// @brief The total size, in bytes, of the items in the cache
+    unsigned long long bytes() const { return d_bytes; }
+
+    unsigned long long max_items() const { return d_max_items; }
+    unsigned long long max_bytes() const { return d_max_bytes; }
+
+    unsigned long long hits() const { return d_hits; }
+    unsigned long long misses() const { return d_misses; }
+    unsigned long long evictions() const { return d_evictions; }
+
+    /**
+     * @brief Print the limits and statistics of the cache.
+     * @param strm Write to this stream
+     */
+    void dump(std::ostream &strm) const {
+        strm << "LRUCache - entries: " << d_entries.size() << " (max: " << d_max_items << "), bytes: " << d_bytes
+             << " (max: " << d_max_bytes << "), hits: " << d_hits << ", misses: " << d_misses << ", evictions: "
+             << d_evictions << std::endl;
+    }
+};
+
+#endif // LRUCache_h_
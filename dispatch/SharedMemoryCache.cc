@@ -0,0 +1,334 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "BESLog.h"
+#include "BESDebug.h"
+
+#include "SharedMemoryCache.h"
+
+#define ERROR(msg) ERROR_LOG("SharedMemoryCache: " + std::string(msg))
+
+#define MODULE "shared-cache"
+#define prolog std::string("SharedMemoryCache::").append(__func__).append("() - ")
+
+using namespace std;
+
+constexpr uint64_t SharedMemoryCache::MAGIC;
+constexpr uint64_t SharedMemoryCache::VERSION;
+constexpr uint64_t SharedMemoryCache::STALE_LOCK_SECONDS;
+
+namespace {
+
+// Keep the slot table and the arena on cache-line boundaries.
+const uint64_t ALIGNMENT = 64;
+
+uint64_t aligned(uint64_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+const uint64_t SEQ_COUNTER_MASK = 0xffffffffULL;
+
+/// @return The sequence number of a slot locked at lock_time whose counter was counter.
+uint64_t locked_seq(uint64_t counter, uint64_t lock_time)
+{
+    return (lock_time << 32) | ((counter + 1) & SEQ_COUNTER_MASK);
+}
+
+/// @return The sequence number of a slot unlocked after being locked with seq. Never zero.
+uint64_t unlocked_seq(uint64_t seq)
+{
+    const uint64_t counter = (seq + 1) & SEQ_COUNTER_MASK;
+    return counter ? counter : 2;
+}
+
+string errno_string() {
+    const char *s_err = strerror(errno);
+    return s_err ? s_err : "unknown error";
+}
+
+} // namespace
+
+SharedMemoryCache::~SharedMemoryCache()
+{
+    unmap();
+}
+
+void SharedMemoryCache::unmap()
+{
+    if (d_map)
+        munmap(d_map, d_map_size);
+    d_map = nullptr;
+    d_map_size = 0;
+    d_header = nullptr;
+    d_slots = nullptr;
+    d_arena = nullptr;
+}
+
+/// FNV-1a. The hash is stored in the file, so it must not change from build to build.
+uint64_t SharedMemoryCache::hash(const string &key)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char c: key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Map the cache file, making or resetting it if needed.
+ *
+ * Processes that use the same file must use the same size and number of
+ * slots. If the file was made with different values (or is not a cache
+ * file), it is reset, which is only safe when no other process is using it.
+ *
+ * @param path The cache file. Use a file in /dev/shm to keep the cache in memory only.
+ * @param size The size of the file in bytes.
+ * @param num_slots The number of entries the cache can hold.
+ * @return True if the cache can be used, false otherwise.
+ */
+bool SharedMemoryCache::initialize(const string &path, uint64_t size, uint64_t num_slots)
+{
+    unmap();
+
+    const uint64_t slots_offset = aligned(sizeof(cache_header));
+    const uint64_t arena_offset = aligned(slots_offset + num_slots * sizeof(cache_slot));
+    if (num_slots == 0 || size < arena_offset + ALIGNMENT) {
+        ERROR("The cache size (" + to_string(size) + " bytes) is too small for " + to_string(num_slots) + " slots.");
+        return false;
+    }
+
+    // Only the user that runs the server may read (or poison) the cached documents.
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        ERROR("Could not open the cache file " + path + ": " + errno_string());
+        return false;
+    }
+
+    // Only one process at a time sets up the file.
+    if (flock(fd, LOCK_EX) < 0) {
+        ERROR("Could not lock the cache file " + path + ": " + errno_string());
+        close(fd);
+        return false;
+    }
+
+    struct stat sb{};
+    bool ok = fstat(fd, &sb) == 0;
+
+    // A file left by an older server may be readable by everyone; the caches hold
+    // things like signed URLs, so close it to other users.
+    if (ok && (sb.st_mode & (S_IRWXG | S_IRWXO)) && sb.st_uid == geteuid()) {
+        if (fchmod(fd, S_IRUSR | S_IWUSR) < 0)
+            ERROR("Could not change the mode of the cache file " + path + ": " + errno_string());
+    }
+
+    if (ok && static_cast<uint64_t>(sb.st_size) != size) {
+        // Truncating first zeros the whole file.
+        ok = ftruncate(fd, 0) == 0 && ftruncate(fd, static_cast<off_t>(size)) == 0;
+    }
+
+    void *map = ok ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (map == MAP_FAILED) {
+        ERROR("Could not map the cache file " + path + ": " + errno_string());
+        flock(fd, LOCK_UN);
+        close(fd);
+        return false;
+    }
+
+    d_path = path;
+    d_map = map;
+    d_map_size = size;
+    d_header = static_cast<cache_header *>(map);
+    d_slots = reinterpret_cast<cache_slot *>(static_cast<char *>(map) + slots_offset);
+    d_arena = static_cast<char *>(map) + arena_offset;
+
+    const uint64_t arena_size = size - arena_offset;
+    if (d_header->magic != MAGIC || d_header->version != VERSION || d_header->num_slots != num_slots
+        || d_header->arena_size != arena_size) {
+        INFO_LOG(prolog + "Resetting the cache file " + path);
+        memset(map, 0, arena_offset);
+        d_header->version = VERSION;
+        d_header->num_slots = num_slots;
+        d_header->arena_size = arena_size;
+        d_header->arena_head = 0;
+        d_header->magic = MAGIC;
+        msync(map, arena_offset, MS_SYNC);
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);  // The mapping stays valid
+
+    BESDEBUG(MODULE, prolog << "Mapped " << path << ", slots: " << num_slots << ", arena: " << arena_size << endl);
+    return true;
+}
+
+/// @return True if the entry that starts at position has been (even partly) overwritten.
+bool SharedMemoryCache::overwritten(uint64_t position) const
+{
+    return d_header->arena_head.load(memory_order_acquire) > position + d_header->arena_size;
+}
+
+/// Reserve size bytes of the arena. An entry never wraps around the end of the arena.
+uint64_t SharedMemoryCache::allocate(uint64_t size)
+{
+    const uint64_t arena_size = d_header->arena_size;
+    uint64_t head = d_header->arena_head.load();
+    while (true) {
+        const uint64_t offset = head % arena_size;
+        const uint64_t start = (offset + size > arena_size) ? head + (arena_size - offset) : head;
+        if (d_header->arena_head.compare_exchange_weak(head, start + size))
+            return start;
+    }
+}
+
+/**
+ * @brief Get a copy of a cached value.
+ * @param key
+ * @param value Value-result parameter; set only if the key is in the cache.
+ * @return True if the key was found, false otherwise.
+ */
+bool SharedMemoryCache::get(const string &key, string &value)
+{
+    if (!d_header)
+        return false;
+
+    const uint64_t key_hash = hash(key);
+    const cache_slot &slot = slot_for(key_hash);
+
+    const uint64_t seq = slot.seq.load(memory_order_acquire);
+    const uint64_t position = slot.position.load(memory_order_relaxed);
+    const uint64_t key_size = slot.key_size.load(memory_order_relaxed);
+    const uint64_t value_size = slot.value_size.load(memory_order_relaxed);
+    const uint64_t offset = position % d_header->arena_size;
+
+    // The sizes are checked before they are used; a writer may be changing them.
+    if (seq == 0 || (seq & 1) || slot.key_hash.load(memory_order_relaxed) != key_hash || key_size != key.size()
+        || key_size + value_size > max_entry_size() || offset + key_size + value_size > d_header->arena_size
+        || overwritten(position)) {
+        d_misses++;
+        return false;
+    }
+
+    const char *entry = d_arena + offset;
+    const bool same_key = memcmp(entry, key.data(), key_size) == 0;
+    string copy(entry + key_size, value_size);
+
+    // If the slot or the bytes changed while they were being copied, the copy is no good.
+    atomic_thread_fence(memory_order_acquire);
+    if (!same_key || slot.seq.load(memory_order_relaxed) != seq || overwritten(position)) {
+        d_misses++;
+        return false;
+    }
+
+    value.swap(copy);
+    d_hits++;
+    return true;
+}
+
+/**
+ * @brief Add a value to the cache, replacing the value for the key if there is one.
+ *
+ * This does not wait; if another process is writing to the key's slot, the
+ * value is not cached.
+ *
+ * @param key
+ * @param value
+ * @return True if the value was cached, false otherwise.
+ */
+bool SharedMemoryCache::put(const string &key, const string &value)
+{
+    if (!d_header)
+        return false;
+
+    const uint64_t size = key.size() + value.size();
+    if (size == 0 || size > max_entry_size()) {
+        BESDEBUG(MODULE, prolog << "Not caching " << key << ", size: " << size << endl);
+        return false;
+    }
+
+    const uint64_t key_hash = hash(key);
+    cache_slot &slot = slot_for(key_hash);
+
+    const auto now = static_cast<uint64_t>(time(nullptr)) & SEQ_COUNTER_MASK;
+    uint64_t seq = slot.seq.load(memory_order_acquire);
+    if (seq & 1) {
+        // Break the lock of a writer that died; the slot stays locked, now by this process.
+        // The lock's time is part of seq, so the swap fails if the slot was locked again.
+        if (now < (seq >> 32) + STALE_LOCK_SECONDS) {
+            d_put_collisions++;
+            return false;
+        }
+        const uint64_t stale = seq;
+        seq = locked_seq(seq + 1, now);
+        uint64_t expected = stale;
+        if (!slot.seq.compare_exchange_strong(expected, seq)) {
+            d_put_collisions++;
+            return false;
+        }
+        ERROR("Broke a stale lock on a slot for " + key);
+    }
+    else {
+        uint64_t expected = seq;
+        seq = locked_seq(seq, now);
+        if (!slot.seq.compare_exchange_strong(expected, seq)) {
+            d_put_collisions++;
+            return false;
+        }
+    }
+    atomic_thread_fence(memory_order_release);
+
+    const uint64_t position = allocate(size);
+    char *entry = d_arena + position % d_header->arena_size;
+    memcpy(entry, key.data(), key.size());
+    memcpy(entry + key.size(), value.data(), value.size());
+
+    slot.key_hash.store(key_hash, memory_order_relaxed);
+    slot.position.store(position, memory_order_relaxed);
+    slot.key_size.store(key.size(), memory_order_relaxed);
+    slot.value_size.store(value.size(), memory_order_relaxed);
+    slot.seq.store(unlocked_seq(seq), memory_order_release);
+
+    d_puts++;
+    return true;
+}
+
+void SharedMemoryCache::dump(ostream &strm) const
+{
+    strm << "SharedMemoryCache [" << d_path << "]";
+    if (d_header) {
+        strm << " slots: " << d_header->num_slots << " arena: " << d_header->arena_size
+             << " bytes written: " << d_header->arena_head.load();
+    }
+    strm << " hits: " << d_hits << " misses: " << d_misses << " puts: " << d_puts << " put collisions: "
+         << d_put_collisions << endl;
+}
@@ -0,0 +1,134 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef SharedMemoryCache_h_
+#define SharedMemoryCache_h_ 1
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief A memory-mapped cache of strings that is shared by processes.
+ *
+ * The besd children each have their own memory caches (e.g., the NGAP DMR++
+ * cache), so every new child reads and parses the same popular documents
+ * again. This cache lives in a file that every process maps, so a document
+ * read by one child is there for all the others.
+ *
+ * The file holds a header, a table of slots and an 'arena' for the keys and
+ * values. Each key hashes to one slot. Values are written into the arena as
+ * a ring, the newest entries overwriting the oldest; a slot whose entry has
+ * been overwritten is a miss. So the cache never needs purging and its size
+ * is fixed by initialize().
+ *
+ * Readers take no locks. Each slot has a sequence number that is odd while
+ * the slot is being written; a reader copies the value and then checks that
+ * neither the sequence number nor the part of the arena it read has changed
+ * (a 'seqlock'). A writer owns a slot, and so its key, while the sequence
+ * number is odd; another writer for that slot gives up instead of waiting.
+ * If a writer dies with the slot locked, the lock is broken after
+ * STALE_LOCK_SECONDS. The time a slot was locked is kept in the high half of
+ * its sequence number, so taking or breaking a lock and recording its time
+ * is one compare-and-swap; a writer never sees a lock with another lock's
+ * time.
+ *
+ * Like FileCache, the methods report errors in the log and return false
+ * rather than throw.
+ *
+ * @note If the file is on a disk (and not, e.g., /dev/shm) the kernel will
+ * write dirty pages to it from time to time. That is harmless but not free.
+ * @note initialize() can be called before the besd children are forked; the
+ * mapping is inherited.
+ */
+class SharedMemoryCache {
+    struct cache_header {
+        uint64_t magic;
+        uint64_t version;
+        uint64_t num_slots;
+        uint64_t arena_size;
+        std::atomic<uint64_t> arena_head;   // Bytes ever allocated; the next entry starts here
+    };
+
+    struct cache_slot {
+        // Low 32 bits: a counter that is odd while the slot is being written. High 32 bits:
+        // when the slot was locked (seconds since the epoch) while it is odd, zero otherwise.
+        std::atomic<uint64_t> seq;
+        std::atomic<uint64_t> key_hash;
+        std::atomic<uint64_t> position;     // Where the entry starts, counted like arena_head
+        std::atomic<uint64_t> key_size;
+        std::atomic<uint64_t> value_size;
+    };
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "SharedMemoryCache needs lock-free 64-bit atomics");
+
+    std::string d_path;
+    void *d_map = nullptr;
+    uint64_t d_map_size = 0;
+
+    cache_header *d_header = nullptr;
+    cache_slot *d_slots = nullptr;
+    char *d_arena = nullptr;
+
+    // Statistics for this process
+    std::atomic<uint64_t> d_hits{0};
+    std::atomic<uint64_t> d_misses{0};
+    std::atomic<uint64_t> d_puts{0};
+    std::atomic<uint64_t> d_put_collisions{0};
+
+    static uint64_t hash(const std::string &key);
+
+    cache_slot &slot_for(uint64_t key_hash) const { return d_slots[key_hash % d_header->num_slots]; }
+    bool overwritten(uint64_t position) const;
+    uint64_t allocate(uint64_t size);
+    void unmap();
+
+    friend class SharedMemoryCacheTest;
+
+public:
+    static constexpr uint64_t MAGIC = 0x4245534d43414348ULL;   // "BESMCACH"
+    static constexpr uint64_t VERSION = 2;
+    static constexpr uint64_t STALE_LOCK_SECONDS = 10;
+
+    SharedMemoryCache() = default;
+    virtual ~SharedMemoryCache();
+
+    SharedMemoryCache(const SharedMemoryCache &) = delete;
+    SharedMemoryCache &operator=(const SharedMemoryCache &) = delete;
+
+    virtual bool initialize(const std::string &path, uint64_t size, uint64_t num_slots);
+
+    /// @return True if initialize() worked.
+    virtual bool is_initialized() const { return d_header != nullptr; }
+
+    virtual bool get(const std::string &key, std::string &value);
+    virtual bool put(const std::string &key, const std::string &value);
+
+    /// @return The largest value (plus its key) that can be cached.
+    virtual uint64_t max_entry_size() const { return d_header ? d_header->arena_size / 4 : 0; }
+
+    virtual void dump(std::ostream &strm) const;
+};
+
+#endif // SharedMemoryCache_h_
@@ -30,6 +30,7 @@
 #include <algorithm>
 
 #include <dirent.h>
+#include <unistd.h>
 
 #include "BESFileLockingCache.h"
 #include "BESDebug.h"
@@ -309,6 +310,46 @@ public:
         DBG(cerr << __func__ << "() - END " << endl);
     }
 
+    // Sizes added by update_cache_info() go to the shard counters until update_and_purge() folds them.
+    void test_cache_size_shards()
+    {
+        DBG(cerr << endl << __func__ << "() - BEGIN " << endl);
+
+        BESFileLockingCache cache(TEST_CACHE_DIR, CACHE_PREFIX, 1);
+        const unsigned long long initial_size = cache.get_cache_size();
+        CPPUNIT_ASSERT_MESSAGE("The cache should hold the eight template files", initial_size > 0);
+
+        unsigned long long expected_size = initial_size;
+        string cache_file_name;
+        for (int i = 0; i < 8; ++i) {
+            cache_file_name = cache.get_cache_file_name("/shard/test0" + to_string(i) + ".txt");
+            int fd;
+            CPPUNIT_ASSERT_MESSAGE("Could not create a cache file", cache.create_and_lock(cache_file_name, fd));
+            const string data(100 * (i + 1), 'x');
+            CPPUNIT_ASSERT(write(fd, data.data(), data.size()) == (ssize_t)data.size());
+            expected_size += data.size();
+            CPPUNIT_ASSERT_MESSAGE("update_cache_info() should return the new size",
+                                   cache.update_cache_info(cache_file_name) == expected_size);
+            cache.unlock_and_close(cache_file_name);
+        }
+
+        CPPUNIT_ASSERT_MESSAGE("get_cache_size() should include the shards", cache.get_cache_size() == expected_size);
+
+        unsigned long long cache_info_size = 0;
+        CPPUNIT_ASSERT(pread(cache.d_cache_info_fd, &cache_info_size, sizeof(cache_info_size), 0) == sizeof(cache_info_size));
+        CPPUNIT_ASSERT_MESSAGE("The cache info file should not change", cache_info_size == initial_size);
+
+        cache.update_and_purge(cache_file_name);
+
+        CPPUNIT_ASSERT(pread(cache.d_cache_info_fd, &cache_info_size, sizeof(cache_info_size), 0) == sizeof(cache_info_size));
+        CPPUNIT_ASSERT_MESSAGE("The shards should be folded into the cache info file",
+                               cache_info_size == cache.get_cache_size());
+        CPPUNIT_ASSERT_MESSAGE("The purge should shrink the cache", cache_info_size < expected_size);
+        CPPUNIT_ASSERT_MESSAGE("The cache size should match the index", cache_info_size == cache.d_index.bytes());
+
+        DBG(cerr << __func__ << "() - END " << endl);
+    }
+
     // Multi-threaded tests.
 #if 0
     void test_lock_cache_write_mt() {
@@ -467,6 +508,7 @@ public:
         CPPUNIT_TEST(test_check_cache_for_non_existent_compressed_file);
         CPPUNIT_TEST(test_find_existing_cached_file);
         CPPUNIT_TEST(test_cache_purge);
+        CPPUNIT_TEST(test_cache_size_shards);
 
 #if 0
         CPPUNIT_TEST(test_find_existing_cached_file_mt);
@@ -0,0 +1,262 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CacheIndex.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+
+#include "test_config.h"
+
+#include "modules/common/run_tests_cppunit.h"
+
+using namespace std;
+
+#define prolog string("CacheIndexTest::").append(__func__).append("() - ")
+
+class CacheIndexTest : public CppUnit::TestFixture {
+    string d_index_file = string(TEST_BUILD_DIR) + "/cache_index_test";
+
+    /// The names in the index, least recently used first.
+    static vector<string> lru_names(const CacheIndex &index) {
+        vector<string> names;
+        index.visit_lru([&names](const CacheIndex::entry &e) {
+            names.push_back(e.name);
+            return true;
+        });
+        return names;
+    }
+
+    static off_t file_size(const string &file) {
+        struct stat sb{};
+        if (stat(file.c_str(), &sb) != 0)
+            return -1;
+        return sb.st_size;
+    }
+
+public:
+    // Called once before everything gets tested
+    CacheIndexTest() = default;
+    ~CacheIndexTest() override = default;
+    CacheIndexTest(const CacheIndexTest &src) = delete;
+    const CacheIndexTest &operator=(const CacheIndexTest &rhs) = delete;
+
+    // setUp; Called before each test
+    void setUp() override {
+        TheBESKeys::TheKeys()->set_key("BES.LogName", "./bes.log");
+        unlink(d_index_file.c_str());
+    }
+
+    // tearDown; Called after each test
+    void tearDown() override {
+        unlink(d_index_file.c_str());
+    }
+
+    void test_new_index_needs_rebuild() {
+        CacheIndex index;
+        CPPUNIT_ASSERT_MESSAGE("open() should work", index.open(d_index_file));
+        CPPUNIT_ASSERT_MESSAGE("A new index should need to be rebuilt", index.needs_rebuild());
+
+        CPPUNIT_ASSERT_MESSAGE("rebuild() should work", index.rebuild({}));
+        CPPUNIT_ASSERT_MESSAGE("A rebuilt index should not need to be rebuilt", !index.needs_rebuild());
+        CPPUNIT_ASSERT_MESSAGE("The index should be empty", index.size() == 0 && index.bytes() == 0);
+
+        CacheIndex index2;
+        CPPUNIT_ASSERT_MESSAGE("open() should work", index2.open(d_index_file));
+        CPPUNIT_ASSERT_MESSAGE("An existing index should not need to be rebuilt", !index2.needs_rebuild());
+    }
+
+    void test_add_access_remove() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+
+        CPPUNIT_ASSERT(index.add("a", 10, 100));
+        CPPUNIT_ASSERT(index.add("b", 20, 101));
+        CPPUNIT_ASSERT(index.add("c", 30, 102));
+        CPPUNIT_ASSERT_MESSAGE("The index should have three entries", index.size() == 3);
+        CPPUNIT_ASSERT_MESSAGE("The index should have 60 bytes", index.bytes() == 60);
+        CPPUNIT_ASSERT_MESSAGE("The LRU order should be a, b, c", lru_names(index) == vector<string>({"a", "b", "c"}));
+
+        CPPUNIT_ASSERT(index.access("a", 200));
+        CPPUNIT_ASSERT_MESSAGE("The LRU order should be b, c, a", lru_names(index) == vector<string>({"b", "c", "a"}));
+
+        CPPUNIT_ASSERT(index.remove("c"));
+        CPPUNIT_ASSERT_MESSAGE("The index should have 30 bytes", index.bytes() == 30);
+        CPPUNIT_ASSERT_MESSAGE("The index should not have c", !index.contains("c"));
+
+        // Adding a name again replaces it
+        CPPUNIT_ASSERT(index.add("b", 5, 300));
+        CPPUNIT_ASSERT_MESSAGE("The index should have 15 bytes", index.bytes() == 15);
+        CPPUNIT_ASSERT_MESSAGE("The LRU order should be a, b", lru_names(index) == vector<string>({"a", "b"}));
+    }
+
+    void test_access_resolution() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+
+        index.add("a", 10, 100);
+        index.add("b", 10, 100);
+        const off_t size = file_size(d_index_file);
+
+        // 'a' was recorded less than ACCESS_RESOLUTION seconds ago, so nothing is written.
+        CPPUNIT_ASSERT(index.access("a", 100));
+        CPPUNIT_ASSERT_MESSAGE("The index file should not grow", file_size(d_index_file) == size);
+        CPPUNIT_ASSERT_MESSAGE("The LRU order should be a, b", lru_names(index) == vector<string>({"a", "b"}));
+
+        // Nor is an access to a name that is not in the index.
+        CPPUNIT_ASSERT(index.access("z", 500));
+        CPPUNIT_ASSERT_MESSAGE("The index file should not grow", file_size(d_index_file) == size);
+    }
+
+    void test_second_instance_sync() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+        index.add("a", 10, 100);
+
+        CacheIndex index2;
+        CPPUNIT_ASSERT(index2.open(d_index_file));
+        CPPUNIT_ASSERT_MESSAGE("The second index should have a", index2.contains("a"));
+
+        index2.add("b", 20, 101);
+        index2.access("a", 200);
+
+        CPPUNIT_ASSERT(index.sync());
+        CPPUNIT_ASSERT_MESSAGE("The first index should have 30 bytes", index.bytes() == 30);
+        CPPUNIT_ASSERT_MESSAGE("The LRU order should be b, a", lru_names(index) == vector<string>({"b", "a"}));
+    }
+
+    void test_rebuild_seen_by_other_instance() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+        index.add("a", 10, 100);
+
+        CacheIndex index2;
+        index2.open(d_index_file);
+
+        index.rebuild({CacheIndex::entry("x", 1, 1), CacheIndex::entry("y", 2, 2)});
+
+        CPPUNIT_ASSERT(index2.sync());
+        CPPUNIT_ASSERT_MESSAGE("The second index should see the rebuilt index",
+                               lru_names(index2) == vector<string>({"x", "y"}));
+        CPPUNIT_ASSERT_MESSAGE("The second index should have 3 bytes", index2.bytes() == 3);
+    }
+
+    void test_compact() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+
+        index.add("a", 10, 0);
+        index.add("b", 10, 0);
+        for (int64_t t = 1; t <= (int64_t)CacheIndex::COMPACT_MIN; ++t)
+            index.access(t % 2 ? "a" : "b", t * CacheIndex::ACCESS_RESOLUTION);
+
+        CPPUNIT_ASSERT_MESSAGE("The journal should hold many records", index.d_records > CacheIndex::COMPACT_MIN);
+        const vector<string> before = lru_names(index);
+
+        CPPUNIT_ASSERT(index.compact());
+        CPPUNIT_ASSERT_MESSAGE("The journal should hold two records", index.d_records == 2);
+        CPPUNIT_ASSERT_MESSAGE("The LRU order should not change", lru_names(index) == before);
+        CPPUNIT_ASSERT_MESSAGE("The index should have 20 bytes", index.bytes() == 20);
+    }
+
+    void test_partial_record() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+        index.add("a", 10, 100);
+
+        // Write half a record, as a writer that died might.
+        const off_t size = file_size(d_index_file);
+        index.add("bbbbbbbb", 20, 101);
+        CPPUNIT_ASSERT(truncate(d_index_file.c_str(), size + 20) == 0);
+
+        CacheIndex index2;
+        CPPUNIT_ASSERT_MESSAGE("A partial record should be ignored", index2.open(d_index_file) && index2.sync());
+        CPPUNIT_ASSERT_MESSAGE("The second index should have only a", lru_names(index2) == vector<string>({"a"}));
+    }
+
+    void test_damaged_index() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+        index.add("a", 10, 100);
+
+        const int fd = open(d_index_file.c_str(), O_WRONLY | O_APPEND);
+        const string junk(64, 'x');
+        CPPUNIT_ASSERT(write(fd, junk.data(), junk.size()) == (ssize_t)junk.size());
+        close(fd);
+
+        CPPUNIT_ASSERT_MESSAGE("sync() should fail", !index.sync());
+        CPPUNIT_ASSERT_MESSAGE("The index should need to be rebuilt", index.needs_rebuild());
+
+        CPPUNIT_ASSERT(index.rebuild({CacheIndex::entry("a", 10, 100)}));
+        CPPUNIT_ASSERT_MESSAGE("The index should be usable again", index.sync() && index.contains("a"));
+    }
+
+    void test_dump() {
+        CacheIndex index;
+        index.open(d_index_file);
+        index.rebuild({});
+        index.add("a", 10, 100);
+
+        ostringstream oss;
+        index.dump(oss);
+        DBG(cerr << prolog << oss.str());
+        CPPUNIT_ASSERT_MESSAGE("dump() should list the entries", oss.str().find("entries: 1") != string::npos);
+    }
+
+    CPPUNIT_TEST_SUITE( CacheIndexTest );
+
+    CPPUNIT_TEST(test_new_index_needs_rebuild);
+    CPPUNIT_TEST(test_add_access_remove);
+    CPPUNIT_TEST(test_access_resolution);
+    CPPUNIT_TEST(test_second_instance_sync);
+    CPPUNIT_TEST(test_rebuild_seen_by_other_instance);
+    CPPUNIT_TEST(test_compact);
+    CPPUNIT_TEST(test_partial_record);
+    CPPUNIT_TEST(test_damaged_index);
+    CPPUNIT_TEST(test_dump);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CacheIndexTest);
+
+int main(int argc, char *argv[])
+{
+    return bes_run_tests<CacheIndexTest>(argc, argv, "cerr,cache") ? 0 : 1;
+}
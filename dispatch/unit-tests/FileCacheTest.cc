@@ -34,6 +34,7 @@
 #include <algorithm>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/wait.h>
 
 #include <openssl/sha.h>
@@ -1058,6 +1059,276 @@ public:
                                fc.get_cache_info_size() == 1'889'730);
     }
 
+    // This tests if purge() rebuilds a lost index by listing the cache directory.
+    void test_purge_without_index() {
+        FileCache fc;
+        // Each copy of source_file is 188,973 bytes; 10 --> 1,889,730
+        CPPUNIT_ASSERT_MESSAGE("Cache should initialize", fc.initialize(cache_dir, 1'800'000, 370'000));
+        string source_file = string(TEST_SRC_DIR) + "/cache/template.txt";
+
+        for (int i = 0; i < 10; ++i) {
+            ostringstream oss;
+            oss << "key" << i;
+            CPPUNIT_ASSERT_MESSAGE("Cache put(keyn) should work", fc.put(oss.str(), source_file));
+            // this delay spreads the 10 files out over 5 seconds
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+
+        string index_file = BESUtil::pathConcat(cache_dir, fc.CACHE_INDEX_FILE_NAME);
+        CPPUNIT_ASSERT_MESSAGE("The index file should be removed", remove(index_file.c_str()) == 0);
+
+        CPPUNIT_ASSERT_MESSAGE("Cache purge should work", fc.purge());
+
+        CPPUNIT_ASSERT_MESSAGE("Cache info size should be 1,511,784 after purge (two files removed)",
+                               fc.get_cache_info_size() == 1'511'784);
+        CPPUNIT_ASSERT_MESSAGE("The index should match the cache info size", fc.d_index.bytes() == 1'511'784);
+
+        vector<string> files;
+        fc.files_in_cache(files);
+        CPPUNIT_ASSERT_MESSAGE("Cache should have 8 files after purge", files.size() == 8);
+
+        string key0 = BESUtil::pathConcat(cache_dir, "key0");
+        CPPUNIT_ASSERT_MESSAGE("Cache should not have key0 after purge",
+                               std::find(files.begin(), files.end(), key0) == files.end());
+    }
+
+    void test_purge_in_background() {
+        FileCache fc;
+        // Each copy of source_file is 188,973 bytes; 10 --> 1,889,730
+        CPPUNIT_ASSERT_MESSAGE("Cache should initialize", fc.initialize(cache_dir, 1'800'000, 370'000));
+        string source_file = string(TEST_SRC_DIR) + "/cache/template.txt";
+
+        for (int i = 0; i < 10; ++i) {
+            ostringstream oss;
+            oss << "key" << i;
+            CPPUNIT_ASSERT_MESSAGE("Cache put(keyn) should work", fc.put(oss.str(), source_file));
+        }
+
+        CPPUNIT_ASSERT_MESSAGE("Background purge should start", fc.purge_in_background());
+        CPPUNIT_ASSERT_MESSAGE("A purge should be running", fc.d_purge_future.valid());
+        CPPUNIT_ASSERT_MESSAGE("The purge should work", fc.d_purge_future.get());
+
+        CPPUNIT_ASSERT_MESSAGE("Cache info size should be 1,511,784 after purge (two files removed)",
+                               fc.get_cache_info_size() == 1'511'784);
+
+        // The cache is now small enough, so no purge is started.
+        CPPUNIT_ASSERT_MESSAGE("Background purge should return true", fc.purge_in_background());
+        CPPUNIT_ASSERT_MESSAGE("No purge should be running", !fc.d_purge_future.valid());
+    }
+
+    void test_get_or_reserve() {
+        FileCache fc;
+        CPPUNIT_ASSERT_MESSAGE("Cache should initialize", fc.initialize(cache_dir, 100, 20));
+        const string content = "single flight";
+
+        {
+            FileCache::Item item;
+            FileCache::PutItem put_item(fc);
+            bool reserved = false;
+            CPPUNIT_ASSERT_MESSAGE("get_or_reserve() should work", fc.get_or_reserve("key1", item, put_item, reserved));
+            CPPUNIT_ASSERT_MESSAGE("An item not in the cache should be reserved", reserved);
+            CPPUNIT_ASSERT(write(put_item.get_fd(), content.data(), content.size()) == (ssize_t)content.size());
+            CPPUNIT_ASSERT_MESSAGE("The item should not be cached until it is committed",
+                                   access(BESUtil::pathConcat(cache_dir, "key1").c_str(), F_OK) != 0);
+            CPPUNIT_ASSERT_MESSAGE("commit() should work", put_item.commit());
+        }
+
+        CPPUNIT_ASSERT_MESSAGE("The reservation should be gone",
+                               access(BESUtil::pathConcat(cache_dir, "key1.reservation").c_str(), F_OK) != 0);
+        CPPUNIT_ASSERT_MESSAGE("Cache info size should be the size of the item",
+                               fc.get_cache_info_size() == content.size());
+
+        FileCache::Item item;
+        FileCache::PutItem put_item(fc);
+        bool reserved = true;
+        CPPUNIT_ASSERT_MESSAGE("get_or_reserve() should work", fc.get_or_reserve("key1", item, put_item, reserved));
+        CPPUNIT_ASSERT_MESSAGE("A cached item should not be reserved", !reserved);
+        CPPUNIT_ASSERT_MESSAGE("The cached item should be returned",
+                               FileCache::get_file_size(item.get_fd()) == content.size());
+    }
+
+    void test_get_or_reserve_not_committed() {
+        FileCache fc;
+        CPPUNIT_ASSERT_MESSAGE("Cache should initialize", fc.initialize(cache_dir, 100, 20));
+
+        {
+            FileCache::Item item;
+            FileCache::PutItem put_item(fc);
+            bool reserved = false;
+            CPPUNIT_ASSERT_MESSAGE("get_or_reserve() should work", fc.get_or_reserve("key1", item, put_item, reserved));
+            CPPUNIT_ASSERT_MESSAGE("An item not in the cache should be reserved", reserved);
+        }
+
+        CPPUNIT_ASSERT_MESSAGE("An item that was not committed should not be cached",
+                               access(BESUtil::pathConcat(cache_dir, "key1").c_str(), F_OK) != 0);
+        CPPUNIT_ASSERT_MESSAGE("The reservation should be removed",
+                               access(BESUtil::pathConcat(cache_dir, "key1.reservation").c_str(), F_OK) != 0);
+        CPPUNIT_ASSERT_MESSAGE("Cache info size should be zero", fc.get_cache_info_size() == 0);
+
+        FileCache::Item item;
+        FileCache::PutItem put_item(fc);
+        bool reserved = false;
+        CPPUNIT_ASSERT_MESSAGE("get_or_reserve() should work", fc.get_or_reserve("key1", item, put_item, reserved));
+        CPPUNIT_ASSERT_MESSAGE("The item should be reserved again", reserved);
+    }
+
+    // Several processes miss on the same key at the same time; one makes the item and
+    // the others wait for it.
+    void test_get_or_reserve_four_processes() {
+        const string content = "made by one process";
+        const int made_it = 10;
+        vector<pid_t> children;
+        for (int i = 0; i < 4; ++i) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                // _exit() skips the destructors, so close the items before it is called.
+                int status = 0;
+                {
+                    FileCache fc;
+                    FileCache::Item item;
+                    FileCache::PutItem put_item(fc);
+                    bool reserved = false;
+                    if (!fc.initialize(cache_dir, 100, 20))
+                        status = 1;
+                    else if (!fc.get_or_reserve("key1", item, put_item, reserved))
+                        status = 2;
+                    else if (reserved) {
+                        // Take long enough that the other processes wait.
+                        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                        if (write(put_item.get_fd(), content.data(), content.size()) != (ssize_t)content.size())
+                            status = 3;
+                        else
+                            status = put_item.commit() ? made_it : 6;
+                    }
+                    else {
+                        vector<char> buf(content.size());
+                        if (item.get_fd() < 0 || pread(item.get_fd(), buf.data(), buf.size(), 0) != (ssize_t)content.size())
+                            status = 4;
+                        else
+                            status = string(buf.data(), buf.size()) == content ? 0 : 5;
+                    }
+                }
+                _exit(status);
+            }
+            children.push_back(pid);
+        }
+
+        int made = 0;
+        int got = 0;
+        for (auto pid: children) {
+            int status;
+            waitpid(pid, &status, 0);
+            DBG(cerr << prolog << "child exit status: " << WEXITSTATUS(status) << '\n');
+            if (WEXITSTATUS(status) == made_it)
+                ++made;
+            else if (WEXITSTATUS(status) == 0)
+                ++got;
+        }
+
+        CPPUNIT_ASSERT_MESSAGE("Exactly one process should make the item", made == 1);
+        CPPUNIT_ASSERT_MESSAGE("The other processes should get the item", got == 3);
+    }
+
+    // A process that is killed while it holds a reservation leaves a partial item that
+    // must not be found. The next process to ask for the item makes it.
+    void test_get_or_reserve_abandoned() {
+        FileCache fc;
+        CPPUNIT_ASSERT_MESSAGE("Cache should initialize", fc.initialize(cache_dir, 100, 20));
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            FileCache child_fc;
+            FileCache::Item item;
+            FileCache::PutItem put_item(child_fc);
+            bool reserved = false;
+            if (!child_fc.initialize(cache_dir, 100, 20) || !child_fc.get_or_reserve("key1", item, put_item, reserved)
+                || !reserved || write(put_item.get_fd(), "part", 4) != 4)
+                _exit(1);
+            _exit(0);   // Like being killed: put_item is not destroyed
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        CPPUNIT_ASSERT_MESSAGE("The child should reserve the item", WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        FileCache::Item item;
+        CPPUNIT_ASSERT_MESSAGE("The partial item should not be found", !fc.get("key1", item));
+
+        {
+            FileCache::Item item;
+            FileCache::PutItem put_item(fc);
+            bool reserved = false;
+            CPPUNIT_ASSERT_MESSAGE("get_or_reserve() should work", fc.get_or_reserve("key1", item, put_item, reserved));
+            CPPUNIT_ASSERT_MESSAGE("The abandoned reservation should be taken over", reserved);
+            CPPUNIT_ASSERT_MESSAGE("The partial content should be dropped",
+                                   FileCache::get_file_size(put_item.get_fd()) == 0);
+            CPPUNIT_ASSERT(write(put_item.get_fd(), "whole", 5) == 5);
+            CPPUNIT_ASSERT(put_item.commit());
+        }
+
+        CPPUNIT_ASSERT_MESSAGE("The reservation should be gone",
+                               access(BESUtil::pathConcat(cache_dir, "key1.reservation").c_str(), F_OK) != 0);
+        CPPUNIT_ASSERT_MESSAGE("Cache info size should be the size of the item", fc.get_cache_info_size() == 5);
+    }
+
+    // A reservation left by a process that died is removed when the cache is listed.
+    void test_abandoned_reservation_removed() {
+        FileCache fc;
+        CPPUNIT_ASSERT_MESSAGE("Cache should initialize", fc.initialize(cache_dir, 100, 20));
+
+        const string reservation = BESUtil::pathConcat(cache_dir, "key1.reservation");
+        int fd = open(reservation.c_str(), O_CREAT | O_RDWR, 0666);
+        CPPUNIT_ASSERT(fd >= 0);
+        close(fd);
+
+        vector<string> files;
+        CPPUNIT_ASSERT(fc.files_in_cache(files));
+        CPPUNIT_ASSERT_MESSAGE("A reservation is not a cached item", files.empty());
+        CPPUNIT_ASSERT_MESSAGE("The abandoned reservation should be removed", access(reservation.c_str(), F_OK) != 0);
+    }
+
+    // When the process that reserved an item gives up, the processes waiting for it
+    // are told to make it themselves.
+    void test_get_or_reserve_given_up() {
+        FileCache fc;
+        CPPUNIT_ASSERT_MESSAGE("Cache should initialize", fc.initialize(cache_dir, 100, 20));
+
+        pid_t pid;
+        {
+            FileCache::Item item;
+            FileCache::PutItem put_item(fc);
+            bool reserved = false;
+            CPPUNIT_ASSERT(fc.get_or_reserve("key1", item, put_item, reserved));
+            CPPUNIT_ASSERT(reserved);
+
+            pid = fork();
+            if (pid == 0) {
+                // The reservation's lock is shared with the parent's open file; drop it.
+                close(put_item.get_fd());
+                int status = 0;
+                {
+                    FileCache child_fc;
+                    FileCache::Item child_item;
+                    FileCache::PutItem child_put_item(child_fc);
+                    bool child_reserved = true;
+                    if (!child_fc.initialize(cache_dir, 100, 20)
+                        || !child_fc.get_or_reserve("key1", child_item, child_put_item, child_reserved))
+                        status = 1;
+                    else if (child_reserved || child_item.get_fd() != -1)
+                        status = 2;
+                }
+                _exit(status);
+            }
+
+            // Let the child wait, then give up without commit().
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+
+        int status;
+        waitpid(pid, &status, 0);
+        CPPUNIT_ASSERT_MESSAGE("The waiting process should get neither the item nor a reservation",
+                               WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
     CPPUNIT_TEST_SUITE(FileCacheTest);
 
     CPPUNIT_TEST(test_hash_key);
@@ -1088,6 +1359,13 @@ public:
     CPPUNIT_TEST(test_get_duplicate_key_three_threads);
     CPPUNIT_TEST(test_get_and_put_duplicate_key_two_processes);
 
+    CPPUNIT_TEST(test_get_or_reserve);
+    CPPUNIT_TEST(test_get_or_reserve_not_committed);
+    CPPUNIT_TEST(test_get_or_reserve_four_processes);
+    CPPUNIT_TEST(test_get_or_reserve_abandoned);
+    CPPUNIT_TEST(test_abandoned_reservation_removed);
+    CPPUNIT_TEST(test_get_or_reserve_given_up);
+
     CPPUNIT_TEST(test_put_get_del);
     CPPUNIT_TEST(test_put_get_del_in_two_processes);
     CPPUNIT_TEST(test_put_get_del_in_two_processes_two_cache_instances);
@@ -1096,6 +1374,8 @@ public:
     CPPUNIT_TEST(test_purge_key0_used_most_recently);
     CPPUNIT_TEST(test_purge_key0_in_use);
     CPPUNIT_TEST(test_purge_efficiency);
+    CPPUNIT_TEST(test_purge_without_index);
+    CPPUNIT_TEST(test_purge_in_background);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -0,0 +1,237 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "LRUCache.h"
+#include "BESDebug.h"
+
+#include "test_config.h"
+
+#include "modules/common/run_tests_cppunit.h"
+
+using namespace std;
+
+#define prolog string("LRUCacheTest::").append(__func__).append("() - ")
+
+class LRUCacheTest : public CppUnit::TestFixture {
+    LRUCache<string> string_cache;
+
+public:
+    // Called once before everything gets tested
+    LRUCacheTest() = default;
+    ~LRUCacheTest() override = default;
+    LRUCacheTest(const LRUCacheTest &src) = delete;
+    const LRUCacheTest &operator=(const LRUCacheTest &rhs) = delete;
+
+    // setUp; Called before each test
+    void setUp() override {
+        string_cache.set_limits(5, 0);    // holds five things
+        string_cache.put("one", "one_1");
+        string_cache.put("two", "two_2");
+        string_cache.put("three", "three_3");
+        string_cache.put("four", "four_4");
+        string_cache.put("five", "five_5");
+    }
+
+    // tearDown; Called after each test
+    void tearDown() override {
+        string_cache.clear();
+    }
+
+    void test_put_one_item() {
+        LRUCache<string> local_cache;
+        local_cache.put("one", "one");
+        CPPUNIT_ASSERT_MESSAGE("The cache should have one item", local_cache.size() == 1);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", local_cache.invariant());
+    }
+
+    void test_put_five_items() {
+        CPPUNIT_ASSERT_MESSAGE("The cache should have five items", string_cache.size() == 5);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", string_cache.invariant());
+    }
+
+    void test_put_same_key() {
+        string_cache.put("three", "three_33");
+
+        CPPUNIT_ASSERT_MESSAGE("The cache should have five items", string_cache.size() == 5);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", string_cache.invariant());
+        string value;
+        CPPUNIT_ASSERT_MESSAGE("The cache should have the new value",
+                               string_cache.get("three", value) && value == "three_33");
+    }
+
+    void test_put_six_items_evicts_one() {
+        string_cache.put("six", "six_6");
+
+        CPPUNIT_ASSERT_MESSAGE("The cache should have five items", string_cache.size() == 5);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", string_cache.invariant());
+        CPPUNIT_ASSERT_MESSAGE("The cache should have evicted one item", string_cache.evictions() == 1);
+        CPPUNIT_ASSERT_MESSAGE("The LRU entry should be 'two'", string_cache.d_entries.back().key == "two");
+        CPPUNIT_ASSERT_MESSAGE("The MRU entry should be 'six'", string_cache.d_entries.front().key == "six");
+    }
+
+    void test_get_keeps_item() {
+        string value;
+        CPPUNIT_ASSERT_MESSAGE("The cache should have 'one'", string_cache.get("one", value));
+
+        // 'one' was used more recently than 'two', so 'two' is evicted.
+        string_cache.put("six", "six_6");
+
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", string_cache.invariant());
+        CPPUNIT_ASSERT_MESSAGE("The cache should still have 'one'", string_cache.get("one", value));
+        CPPUNIT_ASSERT_MESSAGE("The cache should have returned 'one_1'", value == "one_1");
+        CPPUNIT_ASSERT_MESSAGE("The cache should not have 'two'", !string_cache.get("two", value));
+    }
+
+    void test_get_one_item() {
+        string value;
+        bool status = string_cache.get("three", value);
+        CPPUNIT_ASSERT_MESSAGE("The cache should have returned true", status == true);
+        CPPUNIT_ASSERT_MESSAGE("The cache should have returned 'three_3'", value == "three_3");
+        CPPUNIT_ASSERT_MESSAGE("The cache should count one hit", string_cache.hits() == 1);
+    }
+
+    void test_get_one_item_not_in_cache() {
+        string value;
+        bool status = string_cache.get("17", value);
+        CPPUNIT_ASSERT_MESSAGE("The cache should have returned false - the item is not in the cache", status == false);
+        CPPUNIT_ASSERT_MESSAGE("The cache should have returned the empty string", value == "");
+        CPPUNIT_ASSERT_MESSAGE("The cache should count one miss", string_cache.misses() == 1);
+    }
+
+    void test_find() {
+        string *value = string_cache.find("four");
+        CPPUNIT_ASSERT_MESSAGE("find() should return the cached value", value && *value == "four_4");
+        CPPUNIT_ASSERT_MESSAGE("The MRU entry should be 'four'", string_cache.d_entries.front().key == "four");
+        CPPUNIT_ASSERT_MESSAGE("find() should return null for a missing key", string_cache.find("17") == nullptr);
+    }
+
+    void test_remove() {
+        CPPUNIT_ASSERT_MESSAGE("remove() should find 'three'", string_cache.remove("three"));
+        CPPUNIT_ASSERT_MESSAGE("remove() should not find 'three' twice", !string_cache.remove("three"));
+        CPPUNIT_ASSERT_MESSAGE("The cache should have four items", string_cache.size() == 4);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", string_cache.invariant());
+    }
+
+    void test_purge() {
+        string_cache.purge(0.4);
+
+        CPPUNIT_ASSERT_MESSAGE("The cache should have three items", string_cache.size() == 3);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", string_cache.invariant());
+        string value;
+        CPPUNIT_ASSERT_MESSAGE("The cache should not have 'one'", !string_cache.get("one", value));
+        CPPUNIT_ASSERT_MESSAGE("The cache should not have 'two'", !string_cache.get("two", value));
+        CPPUNIT_ASSERT_MESSAGE("The cache should have 'three'", string_cache.get("three", value));
+    }
+
+    void test_byte_limit() {
+        LRUCache<string> local_cache(0, 100);
+        local_cache.put("a", string(40, 'a'), 40);
+        local_cache.put("b", string(40, 'b'), 40);
+        CPPUNIT_ASSERT_MESSAGE("The cache should hold 80 bytes", local_cache.bytes() == 80);
+
+        // Adding 'c' puts the cache over 100 bytes, so 'a' is evicted.
+        local_cache.put("c", string(40, 'c'), 40);
+        CPPUNIT_ASSERT_MESSAGE("The cache should have two items", local_cache.size() == 2);
+        CPPUNIT_ASSERT_MESSAGE("The cache should hold 80 bytes", local_cache.bytes() == 80);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", local_cache.invariant());
+        CPPUNIT_ASSERT_MESSAGE("The cache should not have 'a'", local_cache.find("a") == nullptr);
+
+        // One big item evicts everything else.
+        local_cache.put("d", string(90, 'd'), 90);
+        CPPUNIT_ASSERT_MESSAGE("The cache should have one item", local_cache.size() == 1);
+        CPPUNIT_ASSERT_MESSAGE("The cache should hold 90 bytes", local_cache.bytes() == 90);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", local_cache.invariant());
+    }
+
+    void test_too_big() {
+        LRUCache<string> local_cache(0, 100);
+        local_cache.put("a", string(40, 'a'), 40);
+
+        CPPUNIT_ASSERT_MESSAGE("An item bigger than the cache should not be cached",
+                               !local_cache.put("b", string(200, 'b'), 200));
+        CPPUNIT_ASSERT_MESSAGE("The cache should still have 'a'", local_cache.find("a") != nullptr);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", local_cache.invariant());
+    }
+
+    void test_set_limits_evicts() {
+        string_cache.set_limits(2, 0);
+
+        CPPUNIT_ASSERT_MESSAGE("The cache should have two items", string_cache.size() == 2);
+        CPPUNIT_ASSERT_MESSAGE("The cache invariant should be true", string_cache.invariant());
+        string value;
+        CPPUNIT_ASSERT_MESSAGE("The cache should have 'five'", string_cache.get("five", value));
+    }
+
+    void test_unique_ptr_values() {
+        LRUCache<unique_ptr<string>> ptr_cache(2, 0);
+        ptr_cache.put("one", unique_ptr<string>(new string("one_1")));
+        ptr_cache.put("two", unique_ptr<string>(new string("two_2")));
+        ptr_cache.put("three", unique_ptr<string>(new string("three_3")));
+
+        CPPUNIT_ASSERT_MESSAGE("The cache should have two items", ptr_cache.size() == 2);
+        unique_ptr<string> *value = ptr_cache.find("three");
+        CPPUNIT_ASSERT_MESSAGE("The cache should have 'three'", value && **value == "three_3");
+    }
+
+    void test_dump() {
+        ostringstream oss;
+        string_cache.dump(oss);
+        DBG(cerr << prolog << oss.str());
+        CPPUNIT_ASSERT_MESSAGE("dump() should list the entries", oss.str().find("entries: 5") != string::npos);
+    }
+
+    CPPUNIT_TEST_SUITE( LRUCacheTest );
+
+    CPPUNIT_TEST(test_put_one_item);
+    CPPUNIT_TEST(test_put_five_items);
+    CPPUNIT_TEST(test_put_same_key);
+    CPPUNIT_TEST(test_put_six_items_evicts_one);
+    CPPUNIT_TEST(test_get_keeps_item);
+
+    CPPUNIT_TEST(test_get_one_item);
+    CPPUNIT_TEST(test_get_one_item_not_in_cache);
+    CPPUNIT_TEST(test_find);
+    CPPUNIT_TEST(test_remove);
+    CPPUNIT_TEST(test_purge);
+
+    CPPUNIT_TEST(test_byte_limit);
+    CPPUNIT_TEST(test_too_big);
+    CPPUNIT_TEST(test_set_limits_evicts);
+    CPPUNIT_TEST(test_unique_ptr_values);
+    CPPUNIT_TEST(test_dump);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(LRUCacheTest);
+
+int main(int argc, char *argv[])
+{
+    return bes_run_tests<LRUCacheTest>(argc, argv, "cerr,cache") ? 0 : 1;
+}
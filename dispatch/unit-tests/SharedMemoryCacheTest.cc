@@ -0,0 +1,280 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <atomic>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "SharedMemoryCache.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+
+#include "test_config.h"
+
+#include "modules/common/run_tests_cppunit.h"
+
+using namespace std;
+
+#define prolog string("SharedMemoryCacheTest::").append(__func__).append("() - ")
+
+class SharedMemoryCacheTest : public CppUnit::TestFixture {
+    std::string cache_file = string(TEST_BUILD_DIR) + "/shared_memory_cache_test";
+
+    const uint64_t cache_size = 1024 * 1024;
+    const uint64_t num_slots = 1024;
+
+    static string value_for(unsigned int i) {
+        return string(100 + i % 300, static_cast<char>('A' + i % 26));
+    }
+
+public:
+    // Called once before everything gets tested
+    SharedMemoryCacheTest() = default;
+
+    // Called at the end of the test
+    ~SharedMemoryCacheTest() override = default;
+
+    // Called before each test
+    void setUp() override
+    {
+        TheBESKeys::TheKeys()->set_key("BES.LogName", "./bes.log");
+        unlink(cache_file.c_str());
+    }
+
+    void tearDown() override
+    {
+        unlink(cache_file.c_str());
+    }
+
+    void test_uninitialized_cache() {
+        SharedMemoryCache cache;
+        string value;
+        CPPUNIT_ASSERT(!cache.is_initialized());
+        CPPUNIT_ASSERT(!cache.put("key", "value"));
+        CPPUNIT_ASSERT(!cache.get("key", value));
+    }
+
+    void test_initialize_too_small() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(!cache.initialize(cache_file, 1024, num_slots));
+        CPPUNIT_ASSERT(!cache.is_initialized());
+    }
+
+    void test_put_get() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+
+        string value;
+        CPPUNIT_ASSERT(!cache.get("key", value));
+        CPPUNIT_ASSERT(cache.put("key", "first"));
+        CPPUNIT_ASSERT(cache.get("key", value));
+        CPPUNIT_ASSERT_EQUAL(string("first"), value);
+
+        CPPUNIT_ASSERT(cache.put("key", "second"));
+        CPPUNIT_ASSERT(cache.get("key", value));
+        CPPUNIT_ASSERT_EQUAL(string("second"), value);
+
+        CPPUNIT_ASSERT(!cache.get("other key", value));
+        CPPUNIT_ASSERT_EQUAL(string("second"), value);
+    }
+
+    void test_entry_too_large() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+        CPPUNIT_ASSERT(!cache.put("big", string(cache.max_entry_size(), 'x')));
+        CPPUNIT_ASSERT(cache.put("big", string(cache.max_entry_size() - 3, 'x')));
+    }
+
+    // The cache holds documents, so only the server's user may read it.
+    void test_file_mode() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+        struct stat sb{};
+        CPPUNIT_ASSERT(stat(cache_file.c_str(), &sb) == 0);
+        CPPUNIT_ASSERT_EQUAL(0600, static_cast<int>(sb.st_mode & 0777));
+    }
+
+    // A world-readable file made by an older server is made private.
+    void test_existing_file_mode() {
+        int fd = open(cache_file.c_str(), O_RDWR | O_CREAT, 0666);
+        CPPUNIT_ASSERT(fd >= 0);
+        CPPUNIT_ASSERT(fchmod(fd, 0666) == 0);
+        close(fd);
+
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+        struct stat sb{};
+        CPPUNIT_ASSERT(stat(cache_file.c_str(), &sb) == 0);
+        CPPUNIT_ASSERT_EQUAL(0600, static_cast<int>(sb.st_mode & 0777));
+    }
+
+    // A lock is broken only when the time stored with it is old.
+    void test_stale_lock() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+        CPPUNIT_ASSERT(cache.put("key", "first"));
+
+        auto &slot = cache.slot_for(SharedMemoryCache::hash("key"));
+        const uint64_t unlocked = slot.seq.load();
+        const auto now = static_cast<uint64_t>(time(nullptr));
+
+        // A writer that locked the slot just now
+        slot.seq.store((now << 32) | (unlocked + 1));
+        CPPUNIT_ASSERT(!cache.put("key", "second"));
+        string value;
+        CPPUNIT_ASSERT(!cache.get("key", value));
+
+        // A writer that died holding the lock
+        slot.seq.store(((now - SharedMemoryCache::STALE_LOCK_SECONDS - 1) << 32) | (unlocked + 1));
+        CPPUNIT_ASSERT(cache.put("key", "third"));
+        CPPUNIT_ASSERT(cache.get("key", value));
+        CPPUNIT_ASSERT_EQUAL(string("third"), value);
+        CPPUNIT_ASSERT_EQUAL(0ULL, static_cast<unsigned long long>(slot.seq.load() >> 32));
+    }
+
+    // The cache file keeps its contents for the next process (or instance).
+    void test_two_instances() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+        CPPUNIT_ASSERT(cache.put("key", "value"));
+
+        SharedMemoryCache cache2;
+        CPPUNIT_ASSERT(cache2.initialize(cache_file, cache_size, num_slots));
+        string value;
+        CPPUNIT_ASSERT(cache2.get("key", value));
+        CPPUNIT_ASSERT_EQUAL(string("value"), value);
+
+        // A different layout resets the file.
+        SharedMemoryCache cache3;
+        CPPUNIT_ASSERT(cache3.initialize(cache_file, cache_size, num_slots * 2));
+        CPPUNIT_ASSERT(!cache3.get("key", value));
+    }
+
+    void test_shared_with_child_process() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+        CPPUNIT_ASSERT(cache.put("parent", "from the parent"));
+
+        pid_t pid = fork();
+        CPPUNIT_ASSERT(pid >= 0);
+        if (pid == 0) {
+            // Use the inherited mapping for one and a new one for the other.
+            string value;
+            bool ok = cache.get("parent", value) && value == "from the parent";
+            SharedMemoryCache child_cache;
+            ok = ok && child_cache.initialize(cache_file, cache_size, num_slots)
+                 && child_cache.put("child", "from the child");
+            _exit(ok ? 0 : 1);
+        }
+
+        int status = 0;
+        CPPUNIT_ASSERT(waitpid(pid, &status, 0) == pid);
+        CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        string value;
+        CPPUNIT_ASSERT(cache.get("child", value));
+        CPPUNIT_ASSERT_EQUAL(string("from the child"), value);
+    }
+
+    // Write more than the arena holds; the oldest entries are gone and the rest are intact.
+    void test_arena_wraps() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+
+        const unsigned int n = 10000;
+        for (unsigned int i = 0; i < n; ++i)
+            CPPUNIT_ASSERT(cache.put("key" + to_string(i), value_for(i)));
+
+        string value;
+        CPPUNIT_ASSERT(!cache.get("key0", value));
+
+        unsigned int hits = 0;
+        for (unsigned int i = 0; i < n; ++i) {
+            if (cache.get("key" + to_string(i), value)) {
+                CPPUNIT_ASSERT_EQUAL(value_for(i), value);
+                ++hits;
+            }
+        }
+        DBG(cerr << prolog << "hits: " << hits << endl);
+        CPPUNIT_ASSERT(hits > 0);
+        CPPUNIT_ASSERT(cache.get("key" + to_string(n - 1), value));
+    }
+
+    // Readers never see a torn value while writers replace the same keys.
+    void test_concurrent_readers_and_writers() {
+        SharedMemoryCache cache;
+        CPPUNIT_ASSERT(cache.initialize(cache_file, cache_size, num_slots));
+
+        atomic<bool> torn{false};
+        vector<thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&cache, &torn, t]() {
+                string value;
+                for (unsigned int i = 0; i < 20000; ++i) {
+                    const unsigned int k = i % 300;
+                    if (t % 2)
+                        cache.put("key" + to_string(k), value_for(k));
+                    else if (cache.get("key" + to_string(k), value) && value != value_for(k))
+                        torn = true;
+                }
+            });
+        }
+        for (auto &t: threads)
+            t.join();
+
+        DBG(cache.dump(cerr));
+        CPPUNIT_ASSERT(!torn);
+    }
+
+    CPPUNIT_TEST_SUITE(SharedMemoryCacheTest);
+
+    CPPUNIT_TEST(test_uninitialized_cache);
+    CPPUNIT_TEST(test_initialize_too_small);
+    CPPUNIT_TEST(test_put_get);
+    CPPUNIT_TEST(test_entry_too_large);
+    CPPUNIT_TEST(test_file_mode);
+    CPPUNIT_TEST(test_existing_file_mode);
+    CPPUNIT_TEST(test_stale_lock);
+    CPPUNIT_TEST(test_two_instances);
+    CPPUNIT_TEST(test_shared_with_child_process);
+    CPPUNIT_TEST(test_arena_wraps);
+    CPPUNIT_TEST(test_concurrent_readers_and_writers);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SharedMemoryCacheTest);
+
+int main(int argc, char *argv[])
+{
+    return bes_run_tests<SharedMemoryCacheTest>(argc, argv, "cerr,shared-cache") ? 0 : 1;
+}
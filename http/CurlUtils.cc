@@ -69,9 +69,6 @@ using namespace std;
 
 namespace curl {
 
-const unsigned int retry_limit = 3; // 10; // Amazon's suggestion
-const useconds_t url_retry_time = 250'000; // 1/4 second in micro seconds
-
 // Set this to 1 to turn on libcurl's verbose mode (for debugging).
 const int curl_trace = 0;
 
@@ -1033,23 +1030,15 @@ static void super_easy_perform(CURL *c_handle, int fd) {
 }
 
 /**
- *
- * Use libcurl to dereference a URL. Read the information referenced by
- * url into the file pointed to by the open file descriptor fd.
+ * @brief Dereference a URL and write the response body to an open file.
  *
  * @param target_url The URL to dereference.
- * @param fd  An open file descriptor (as in 'open' as opposed to 'fopen') which
- * will be the destination for the data; the caller can assume that when this
- * method returns that the body of the response can be retrieved by reading
- * from this file descriptor.
+ * @param range If not empty, the byte range to get (e.g., '0-1023').
+ * @param fd An open file descriptor; rewound when this returns.
  * @param http_response_headers Value/result parameter for the HTTP Response Headers.
- * @param http_request_headers A pointer to a vector of HTTP request headers. Default is
- * null. These headers will be appended to the list of default headers.
- * @exception Error Thrown if libcurl encounters a problem; the libcurl
- * error message is stuffed into the Error object.
  */
-void http_get_and_write_resource(const std::shared_ptr<http::url> &target_url, int fd,
-                                 vector <string> *http_response_headers) {
+static void http_get_and_write(const std::shared_ptr<http::url> &target_url, const string &range, int fd,
+                               vector <string> *http_response_headers) {
 
     vector<char> error_buffer(CURL_ERROR_SIZE, (char) 0);
     CURLcode res;
@@ -1079,6 +1068,11 @@ void http_get_and_write_resource(const std::shared_ptr<http::url> &target_url, i
 
         set_error_buffer(ceh, error_buffer.data());
 
+        if (!range.empty()) {
+            res = curl_easy_setopt(ceh, CURLOPT_RANGE, range.c_str());
+            eval_curl_easy_setopt_result(res, prolog, "CURLOPT_RANGE", error_buffer.data(), __FILE__, __LINE__);
+        }
+
         res = curl_easy_setopt(ceh, CURLOPT_WRITEFUNCTION, writeToOpenFileDescriptor);
         eval_curl_easy_setopt_result(res, prolog, "CURLOPT_WRITEFUNCTION", error_buffer.data(), __FILE__, __LINE__);
 
@@ -1112,6 +1106,44 @@ void http_get_and_write_resource(const std::shared_ptr<http::url> &target_url, i
     BESDEBUG(MODULE, prolog << "END" << endl);
 }
 
+/**
+ *
+ * Use libcurl to dereference a URL. Read the information referenced by
+ * url into the file pointed to by the open file descriptor fd.
+ *
+ * @param target_url The URL to dereference.
+ * @param fd  An open file descriptor (as in 'open' as opposed to 'fopen') which
+ * will be the destination for the data; the caller can assume that when this
+ * method returns that the body of the response can be retrieved by reading
+ * from this file descriptor.
+ * @param http_response_headers Value/result parameter for the HTTP Response Headers.
+ * @param http_request_headers A pointer to a vector of HTTP request headers. Default is
+ * null. These headers will be appended to the list of default headers.
+ * @exception Error Thrown if libcurl encounters a problem; the libcurl
+ * error message is stuffed into the Error object.
+ */
+void http_get_and_write_resource(const std::shared_ptr<http::url> &target_url, int fd,
+                                 vector <string> *http_response_headers) {
+    http_get_and_write(target_url, "", fd, http_response_headers);
+}
+
+/**
+ * @brief Get part of a URL's content and write it to an open file.
+ *
+ * The server may ignore the range and return the whole resource; look for the
+ * Content-Range response header to tell.
+ *
+ * @param target_url The URL to dereference.
+ * @param offset The first byte to get
+ * @param size The number of bytes to get
+ * @param fd An open file descriptor; rewound when this returns.
+ * @param http_response_headers Value/result parameter for the HTTP Response Headers.
+ */
+void http_get_range_and_write_resource(const std::shared_ptr<http::url> &target_url, unsigned long long offset,
+                                       unsigned long long size, int fd, vector <string> *http_response_headers) {
+    http_get_and_write(target_url, get_range_arg_string(offset, size), fd, http_response_headers);
+}
+
 /**
  * Returns a cURL error message string based on the contents of the error_buf or, if the error_buf is empty, the
  * CURLcode code.
@@ -1247,6 +1279,32 @@ void super_easy_perform(CURL *c_handle) {
     super_easy_perform(c_handle, fd);
 }
 
+/**
+ * @brief Evaluate a transfer that was not made by super_easy_perform().
+ *
+ * This is the test super_easy_perform() applies after each attempt. It is for
+ * code that runs its own transfers (e.g., using the libcurl multi interface)
+ * and so must handle the retries itself; use retry_limit and url_retry_time
+ * to match super_easy_perform().
+ *
+ * @param c_handle The easy handle, after the transfer finished
+ * @param curl_code The result of the transfer
+ * @param error_buffer The handle's CURLOPT_ERRORBUFFER, or null
+ * @param target_url The URL that was requested
+ * @param attempt Which attempt this was, starting with 1
+ * @param http_code Value-result parameter, the HTTP response code
+ * @return True if the transfer worked, false if it failed and may be retried.
+ * @throws BESError if the transfer failed and should not be retried.
+ */
+bool eval_transfer_result(CURL *c_handle, CURLcode curl_code, const char *error_buffer, const string &target_url,
+                          unsigned int attempt, long &http_code) {
+    http_code = 0;
+    if (!eval_curl_easy_perform_code(target_url, curl_code, error_buffer ? error_buffer : "", attempt))
+        return false;
+
+    return eval_http_get_response(c_handle, target_url, http_code);
+}
+
 // used only in one place here. jhrg 3/8/23
 static string get_cookie_file_base() {
     return TheBESKeys::read_string_key(HTTP_COOKIES_FILE_KEY, HTTP_DEFAULT_COOKIES_FILE);
@@ -27,6 +27,8 @@
 #ifndef  _bes_http_CURL_UTILS_H_
 #define  _bes_http_CURL_UTILS_H_ 1
 
+#include <unistd.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -47,17 +49,27 @@ class url;
 
 namespace curl {
 
+const unsigned int retry_limit = 3; // 10; // Amazon's suggestion
+const useconds_t url_retry_time = 250'000; // 1/4 second in micro seconds
+
 ///@name Get data from a URL
 ///@{
 void http_get_and_write_resource(const std::shared_ptr<http::url> &target_url, int fd,
                                  std::vector<std::string> *http_response_headers);
 
+void http_get_range_and_write_resource(const std::shared_ptr<http::url> &target_url, unsigned long long offset,
+                                       unsigned long long size, int fd,
+                                       std::vector<std::string> *http_response_headers);
+
 void http_get(const std::string &target_url, std::vector<char> &buf);
 
 bool http_head(const std::string &target_url, int tries = 3, unsigned long wait_time_us = 1'000'000);
 void http_get(const std::string &target_url, std::string &buf);
 
 void super_easy_perform(CURL *ceh);
+
+bool eval_transfer_result(CURL *c_handle, CURLcode curl_code, const char *error_buffer, const std::string &target_url,
+                          unsigned int attempt, long &http_code);
 ///@}
 
 std::shared_ptr<http::EffectiveUrl> get_redirect_url(const std::shared_ptr<http::url> &url);
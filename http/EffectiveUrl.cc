@@ -50,6 +50,7 @@ using std::endl;
 using std::stringstream;
 
 #define CACHE_CONTROL_HEADER_KEY "cache-control"
+#define SERIAL_VERSION "EURL1"
 
 #define MODULE HTTP_MODULE
 #define prolog std::string("EffectiveUrl::").append(__func__).append("() - ")
@@ -57,21 +58,14 @@ using std::stringstream;
 namespace http {
 
 /**
- * @brief Returns true if URL is reusable, false otherwise.
- *
- * @return Returns true if the query string parameters or response headers received with the EffectiveUrl indicate
- *  that the URL may be reused. False otherwise
+ * @brief Find the expiration time given by the Cache-Control max-age response header.
+ * @param expires Value-result parameter; the ingest time plus max-age.
+ * @return True if the response headers include a max-age, false otherwise.
  */
-bool EffectiveUrl::is_expired() {
-    BESDEBUG(MODULE, prolog << "BEGIN" << endl);
-    bool expired = false;
+bool EffectiveUrl::max_age_expires_time(std::time_t &expires) {
     bool found = false;
     string cc_hdr_val;
 
-    auto now =  std::chrono::system_clock::now();
-    auto now_secs = std::chrono::time_point_cast<std::chrono::seconds>(now);
-    BESDEBUG(MODULE, prolog << "now_secs: " << now_secs.time_since_epoch().count() << endl);
-
     get_header(CACHE_CONTROL_HEADER_KEY, cc_hdr_val, found);
     if (found) {
         BESDEBUG(MODULE, prolog << CACHE_CONTROL_HEADER_KEY << " '" << cc_hdr_val << "'" << endl);
@@ -83,16 +77,36 @@ bool EffectiveUrl::is_expired() {
             string max_age_str = cc_hdr_val.substr(max_age_index + max_age_key.size());
             long long msi;
             std::istringstream(max_age_str) >> msi;
-            std::chrono::seconds max_age(msi);
-            auto itime = std::chrono::system_clock::from_time_t(ingest_time());
-            auto expires_time = std::chrono::time_point_cast<std::chrono::seconds>(itime + max_age);
-            expired = now_secs > expires_time;
+            expires = ingest_time() + msi;
+            return true;
+        }
+    }
 
-            BESDEBUG(MODULE, prolog << "expires_time: " << expires_time.time_since_epoch().count() <<
-                                    " threshold: " << HTTP_URL_REFRESH_THRESHOLD << endl);
+    return false;
+}
 
-            BESDEBUG(MODULE, prolog << "expired: " << (expired ? "true" : "false") << endl);
-        }
+/**
+ * @brief Returns true if URL is reusable, false otherwise.
+ *
+ * @return Returns true if the query string parameters or response headers received with the EffectiveUrl indicate
+ *  that the URL may be reused. False otherwise
+ */
+bool EffectiveUrl::is_expired() {
+    BESDEBUG(MODULE, prolog << "BEGIN" << endl);
+    bool expired = false;
+
+    auto now =  std::chrono::system_clock::now();
+    auto now_secs = std::chrono::time_point_cast<std::chrono::seconds>(now);
+    BESDEBUG(MODULE, prolog << "now_secs: " << now_secs.time_since_epoch().count() << endl);
+
+    std::time_t expires;
+    if (max_age_expires_time(expires)) {
+        expired = std::chrono::system_clock::to_time_t(now) > expires;
+
+        BESDEBUG(MODULE, prolog << "expires_time: " << expires <<
+                                " threshold: " << HTTP_URL_REFRESH_THRESHOLD << endl);
+
+        BESDEBUG(MODULE, prolog << "expired: " << (expired ? "true" : "false") << endl);
     }
     if (!expired) {
         expired = url::is_expired();
@@ -101,6 +115,20 @@ bool EffectiveUrl::is_expired() {
     return expired;
 }
 
+/**
+ * @brief When does the URL expire?
+ * @return The earlier of the time given by the Cache-Control max-age response header
+ * and the time given by the URL's query string.
+ * @see url::expires_time()
+ */
+std::time_t EffectiveUrl::expires_time() {
+    std::time_t expires = url::expires_time();
+    std::time_t max_age_expires;
+    if (max_age_expires_time(max_age_expires) && max_age_expires < expires)
+        expires = max_age_expires;
+    return expires;
+}
+
 /**
  * @brief get the value of the named header
  * @param name Name of header value to retrieve
@@ -149,6 +177,81 @@ void EffectiveUrl::ingest_response_headers(const vector <string> &resp_hdrs) {
     }
 }
 
+// Fields are written as '<size>:<bytes>' so they can hold any characters.
+static void write_field(stringstream &ss, const string &field) {
+    ss << field.size() << ':' << field;
+}
+
+static bool read_field(const string &s, size_t &pos, string &field) {
+    size_t colon = s.find(':', pos);
+    if (colon == string::npos || colon == pos)
+        return false;
+    size_t size;
+    try {
+        size = std::stoul(s.substr(pos, colon - pos));
+    }
+    catch (const std::exception &) {
+        return false;
+    }
+    if (size > s.size() - colon - 1)
+        return false;
+    field = s.substr(colon + 1, size);
+    pos = colon + 1 + size;
+    return true;
+}
+
+/**
+ * @brief Write the URL, its ingest time and its response headers to a string.
+ *
+ * The trusted state is not written; an EffectiveUrl read from the string inherits
+ * it from the URL that was used to look it up.
+ *
+ * @return The serialized EffectiveUrl
+ * @see deserialize()
+ */
+string EffectiveUrl::serialize() const {
+    stringstream ss;
+    write_field(ss, SERIAL_VERSION);
+    write_field(ss, std::to_string(ingest_time()));
+    write_field(ss, str());
+    write_field(ss, std::to_string(d_response_header_names.size()));
+    for (size_t i = 0; i < d_response_header_names.size(); ++i) {
+        write_field(ss, d_response_header_names[i]);
+        write_field(ss, d_response_header_values[i]);
+    }
+    return ss.str();
+}
+
+/**
+ * @brief Make an EffectiveUrl from a string written by serialize().
+ * @param s The serialized EffectiveUrl
+ * @return The EffectiveUrl, or null if the string is not a serialized EffectiveUrl.
+ */
+std::shared_ptr<EffectiveUrl> EffectiveUrl::deserialize(const string &s) {
+    size_t pos = 0;
+    string version, itime, url_str, num_headers;
+    if (!read_field(s, pos, version) || version != SERIAL_VERSION
+        || !read_field(s, pos, itime) || !read_field(s, pos, url_str) || !read_field(s, pos, num_headers))
+        return nullptr;
+
+    auto eurl = std::make_shared<EffectiveUrl>(url_str);
+    try {
+        eurl->set_ingest_time(std::stoll(itime));
+        for (unsigned long n = std::stoul(num_headers); n > 0; --n) {
+            string name, value;
+            if (!read_field(s, pos, name) || !read_field(s, pos, value))
+                return nullptr;
+            eurl->d_response_header_names.push_back(name);
+            eurl->d_response_header_values.push_back(value);
+        }
+    }
+    catch (const std::exception &) {
+        return nullptr;
+    }
+
+    return pos == s.size() ? eurl : nullptr;
+}
+
 /**
  * @brief A string dump of the instance
  * @return A string containing readable instance state.
@@ -53,6 +53,8 @@ class EffectiveUrl : public url {
     std::vector<std::string> d_response_header_names;
     std::vector<std::string> d_response_header_values;
 
+    bool max_age_expires_time(std::time_t &expires);
+
 public:
     EffectiveUrl() = default;
     EffectiveUrl(const EffectiveUrl &src_url) = default;
@@ -77,11 +79,15 @@ public:
     ~EffectiveUrl() override = default;
 
     bool is_expired() override;
+    std::time_t expires_time() override;
 
     void get_header(const std::string &name, std::string &value, bool &found );
 
     void ingest_response_headers(const std::vector<std::string> &resp_hdrs);
 
+    std::string serialize() const;
+    static std::shared_ptr<EffectiveUrl> deserialize(const std::string &s);
+
     std::string dump() override;
 };
 
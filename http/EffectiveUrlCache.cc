@@ -26,6 +26,9 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <mutex>
 
 #include <sstream>
@@ -33,6 +36,7 @@
 
 #include "TheBESKeys.h"
 #include "BESDebug.h"
+#include "BESLog.h"
 #include "BESStopWatch.h"
 #include "BESUtil.h"
 #include "CurlUtils.h"
@@ -46,11 +50,22 @@ using namespace std;
 constexpr auto MODULE = "euc";
 constexpr auto MODULE_TIMER = "euc:timer";
 constexpr auto MODULE_DUMPER = "euc:dump";
+constexpr unsigned long long BYTES_PER_MB = 1048576ULL;
 
 #define prolog std::string("EffectiveUrlCache::").append(__func__).append("() - ")
 
 namespace http {
 
+/**
+ * @brief Wait for the background refreshes to finish.
+ */
+EffectiveUrlCache::~EffectiveUrlCache() {
+    for (auto &refresh: d_refreshes) {
+        if (refresh.valid())
+            refresh.wait();
+    }
+}
+
 /**
  * @brief Get the cached effective URL.
  * @param url_key Key to a cached effective URL.
@@ -65,6 +80,131 @@ shared_ptr <EffectiveUrl> EffectiveUrlCache::get_cached_eurl(string const &url_k
     return effective_url;
 }
 
+/**
+ * @brief Get the effective URL from the cache shared by the besd processes.
+ * @param url_key Key to a cached effective URL.
+ * @return The effective URL or null if it is not in the shared cache.
+ * @note This method is not, itself, thread safe.
+ */
+shared_ptr <EffectiveUrl> EffectiveUrlCache::get_shared_eurl(string const &url_key) {
+    string value;
+    if (!d_shared_urls.is_initialized() || !d_shared_urls.get(url_key, value))
+        return nullptr;
+
+    auto effective_url = EffectiveUrl::deserialize(value);
+    BESDEBUG(MODULE, prolog << (effective_url ? "Found " : "Could not read ") << url_key << " in the shared cache." << endl);
+    return effective_url;
+}
+
+/**
+ * @brief Add the effective URL to the cache shared by the besd processes.
+ * @param url_key Key to a cached effective URL.
+ * @param effective_url The effective URL.
+ * @note This method is not, itself, thread safe.
+ */
+void EffectiveUrlCache::put_shared_eurl(string const &url_key, const shared_ptr<EffectiveUrl> &effective_url) {
+    if (d_shared_urls.is_initialized())
+        d_shared_urls.put(url_key, effective_url->serialize());
+}
+
+/**
+ * @brief Read the shared cache and refresh configuration and map the shared cache.
+ *
+ * The shared cache is used only if Http.cache.effective.urls.shared.file is set. If
+ * the file cannot be mapped, the error is logged and the cache works without it.
+ */
+void EffectiveUrlCache::initialize_shared_cache() {
+    if (d_shared_initialized)
+        return;
+    d_shared_initialized = true;
+
+    d_refresh_ahead = TheBESKeys::read_int_key(HTTP_CACHE_EFFECTIVE_URLS_REFRESH_AHEAD_KEY, HTTP_EFFECTIVE_URL_REFRESH_AHEAD);
+
+    string shared_file = TheBESKeys::read_string_key(HTTP_CACHE_EFFECTIVE_URLS_SHARED_FILE_KEY, "");
+    if (!shared_file.empty()) {
+        unsigned long long size_mb = TheBESKeys::read_ulong_key(HTTP_CACHE_EFFECTIVE_URLS_SHARED_SIZE_KEY,
+                                                                HTTP_EFFECTIVE_URL_SHARED_CACHE_SIZE_MB);
+        unsigned long items = TheBESKeys::read_ulong_key(HTTP_CACHE_EFFECTIVE_URLS_SHARED_ITEMS_KEY,
+                                                         HTTP_EFFECTIVE_URL_SHARED_CACHE_ITEMS);
+        if (!d_shared_urls.initialize(shared_file, size_mb * BYTES_PER_MB, items))
+            ERROR_LOG(prolog + "Could not use the shared effective URL cache " + shared_file + "; continuing without it.");
+    }
+
+    BESDEBUG(MODULE, prolog << "shared cache: " << (d_shared_urls.is_initialized() ? shared_file : "not used")
+                            << ", refresh ahead: " << d_refresh_ahead << endl);
+}
+
+/**
+ * @brief Should the effective URL be refreshed before it expires?
+ * @return True if the URL expires in less than d_refresh_ahead seconds.
+ */
+bool EffectiveUrlCache::needs_refresh(const shared_ptr<EffectiveUrl> &effective_url) const {
+    if (d_refresh_ahead <= 0)
+        return false;
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    return effective_url->expires_time() - now < d_refresh_ahead;
+}
+
+/**
+ * @brief Find a new effective URL for source_url in a separate thread.
+ *
+ * If a refresh for the URL is already running, or another besd process has put a newer
+ * effective URL in the shared cache, no refresh is started.
+ *
+ * @param source_url The URL to refresh
+ * @note This method is not, itself, thread safe.
+ */
+void EffectiveUrlCache::refresh_in_background(const shared_ptr<url> &source_url) {
+    const string url_key = source_url->str();
+    if (d_refreshing.find(url_key) != d_refreshing.end())
+        return;
+
+    auto shared_url = get_shared_eurl(url_key);
+    if (shared_url && !needs_refresh(shared_url)) {
+        BESDEBUG(MODULE, prolog << "Using the effective URL another process refreshed for " << url_key << endl);
+        d_effective_urls[url_key] = shared_url;
+        return;
+    }
+
+    // Forget the refreshes that are done.
+    d_refreshes.erase(std::remove_if(d_refreshes.begin(), d_refreshes.end(), [](const std::future<void> &f) {
+        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), d_refreshes.end());
+
+    BESDEBUG(MODULE, prolog << "Refreshing the effective URL for " << url_key << " in the background." << endl);
+    d_refreshing.insert(url_key);
+    d_refreshes.emplace_back(std::async(std::launch::async, &EffectiveUrlCache::refresh, this, make_shared<url>(source_url)));
+}
+
+/**
+ * @brief Find a new effective URL for source_url and cache it.
+ *
+ * This runs in its own thread; errors are logged and the current effective URL is kept.
+ *
+ * @param source_url The URL to refresh
+ */
+void EffectiveUrlCache::refresh(const shared_ptr<url> &source_url) {
+    const string url_key = source_url->str();
+    shared_ptr<EffectiveUrl> effective_url;
+    try {
+        effective_url = curl::get_redirect_url(source_url);
+    }
+    catch (const BESError &e) {
+        ERROR_LOG(prolog + "Could not refresh the effective URL for " + url_key + ": " + e.get_message());
+    }
+    catch (const std::exception &e) {
+        ERROR_LOG(prolog + "Could not refresh the effective URL for " + url_key + ": " + e.what());
+    }
+
+    std::lock_guard<std::mutex> lock_me(d_cache_lock_mutex);
+    if (effective_url) {
+        d_effective_urls[url_key] = effective_url;
+        put_shared_eurl(url_key, effective_url);
+        BESDEBUG(MODULE, prolog << "Refreshed the effective URL for " << url_key << endl);
+    }
+    d_refreshing.erase(url_key);
+}
+
 /**
  * Find the terminal (effective) url for the source_url. If the source_url matches the
  * skip_regex then it will not be cached.
@@ -110,7 +250,20 @@ shared_ptr <EffectiveUrl> EffectiveUrlCache::get_effective_url(shared_ptr <url>
         BESDEBUG(MODULE, prolog << "The cache_effective_urls_skip_regex() was NOT SET " << endl);
     }
 
+    if (!d_shared_initialized)
+        initialize_shared_cache();
+
     shared_ptr<EffectiveUrl> effective_url = get_cached_eurl(source_url->str());
+
+    // Another besd process may have found it.
+    if (!effective_url || effective_url->is_expired()) {
+        auto shared_url = get_shared_eurl(source_url->str());
+        if (shared_url && !shared_url->is_expired()) {
+            d_effective_urls[source_url->str()] = shared_url;
+            effective_url = shared_url;
+        }
+    }
+
     bool retrieve_and_cache = !effective_url || effective_url->is_expired();
 
     // It not found or expired, (re)load.
@@ -141,6 +294,7 @@ shared_ptr <EffectiveUrl> EffectiveUrlCache::get_effective_url(shared_ptr <url>
                                 << (source_url->is_trusted() ? "" : "NOT ") << "trusted)" << endl);
 
         d_effective_urls[source_url->str()] = effective_url;
+        put_shared_eurl(source_url->str(), effective_url);
 
         BESDEBUG(MODULE, prolog << "Updated record for " << source_url->str() << " cache size: "
                                 << d_effective_urls.size() << endl);
@@ -153,12 +307,16 @@ shared_ptr <EffectiveUrl> EffectiveUrlCache::get_effective_url(shared_ptr <url>
         // created in curl::retrieve_effective_url()
         effective_url = make_shared<EffectiveUrl>(effective_url);
     } else {
+        // Expires soon? Get a new one without making this request wait.
+        if (needs_refresh(effective_url))
+            refresh_in_background(source_url);
+
         // Here we have a !expired instance of a shared_ptr<EffectiveUrl> retrieved from the cache.
         // Now we need to make a copy to return, inheriting trust from the requesting URL.
         effective_url = make_shared<EffectiveUrl>(effective_url, source_url->is_trusted());
     }
 
-    BESDEBUG(MODULE_DUMPER, prolog << "dump: " << endl << dump() << endl);
+    BESDEBUG(MODULE_DUMPER, prolog << "dump: " << endl << m_dump() << endl);
     BESDEBUG(MODULE, prolog << "END" << endl);
 
     return effective_url;
@@ -191,12 +349,24 @@ void EffectiveUrlCache::set_skip_regex() {
 
 /**
  * @brief dumps information about this object
+ *
+ * The background refreshes change the cache, so it is locked while it is written.
+ *
  * @param strm C++ i/o stream to dump the information to
  */
 void EffectiveUrlCache::dump(ostream &strm) const {
+    std::lock_guard<std::mutex> lock_me(d_cache_lock_mutex);
+    m_dump(strm);
+}
+
+void EffectiveUrlCache::m_dump(ostream &strm) const {
     strm << BESIndent::LMarg << prolog << "(this: " << (void *) this << ")" << endl;
     BESIndent::Indent();
     strm << BESIndent::LMarg << "d_skip_regex: " << (d_skip_regex ? d_skip_regex->pattern() : "WAS NOT SET") << endl;
+    strm << BESIndent::LMarg << "d_refresh_ahead: " << d_refresh_ahead << endl;
+    strm << BESIndent::LMarg << "refreshing: " << d_refreshing.size() << endl;
+    if (d_shared_urls.is_initialized())
+        d_shared_urls.dump(strm);
     if (!d_effective_urls.empty()) {
         strm << BESIndent::LMarg << "effective url list:" << endl;
         BESIndent::Indent();
@@ -29,12 +29,18 @@
 
 #include <memory>
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <string>
+#include <vector>
+#include <future>
 #include <mutex>
+#include <ctime>
 
 #include "BESObj.h"
 #include "BESRegex.h"   // for std::unique_ptr<BESRegex>
+#include "SharedMemoryCache.h"
+#include "HttpNames.h"
 
 namespace http {
 
@@ -48,13 +54,19 @@ class url;
  * is termed the "effective url" and that is stored in an in memory cache (std::map) so that later requests may
  * skip the redirects and just get required bytes from the actual source.
  *
+ * If Http.cache.effective.urls.shared.file is set, the effective URLs are also kept in a
+ * SharedMemoryCache, so a URL found by one besd process is used by all the others. When a
+ * cached URL is within Http.cache.effective.urls.refresh.ahead seconds of its expiration time,
+ * it is still returned, but a new one is found in the background; requests do not wait for
+ * the redirects unless a URL is missing or has expired.
+ *
  * @note This is the same as following a chain HTTP redirects to get the URL to the origin of the data.
  */
 class EffectiveUrlCache : public BESObj {
 private:
     EffectiveUrlCache() = default;
 
-    std::mutex d_cache_lock_mutex;
+    mutable std::mutex d_cache_lock_mutex;
 
     std::map<std::string, std::shared_ptr<http::EffectiveUrl>> d_effective_urls;
 
@@ -63,8 +75,27 @@ private:
 
     int d_enabled = -1;
 
+    // Effective URLs shared by the besd processes
+    SharedMemoryCache d_shared_urls;
+    bool d_shared_initialized = false;
+
+    // Refresh a URL in the background when it expires in less than this many seconds; 0 disables this.
+    std::time_t d_refresh_ahead = HTTP_EFFECTIVE_URL_REFRESH_AHEAD;
+
+    // URLs being refreshed and the tasks that refresh them
+    std::set<std::string> d_refreshing;
+    std::vector<std::future<void>> d_refreshes;
+
     std::shared_ptr<EffectiveUrl> get_cached_eurl(std::string const &url_key);
 
+    std::shared_ptr<EffectiveUrl> get_shared_eurl(std::string const &url_key);
+    void put_shared_eurl(std::string const &url_key, const std::shared_ptr<EffectiveUrl> &effective_url);
+    void initialize_shared_cache();
+
+    bool needs_refresh(const std::shared_ptr<EffectiveUrl> &effective_url) const;
+    void refresh_in_background(const std::shared_ptr<url> &source_url);
+    void refresh(const std::shared_ptr<url> &source_url);
+
     void set_skip_regex();
 
     bool is_enabled();
@@ -91,13 +122,22 @@ public:
     EffectiveUrlCache(const EffectiveUrlCache &src) = delete;
     EffectiveUrlCache &operator=(const EffectiveUrlCache &rhs) = delete;
 
-    ~EffectiveUrlCache() override = default;
+    ~EffectiveUrlCache() override;
 
     std::shared_ptr<EffectiveUrl> get_effective_url(std::shared_ptr<url> source_url);
 
     void dump(std::ostream &strm) const override;
 
 private:
+    // Write the dump; the caller must hold d_cache_lock_mutex.
+    void m_dump(std::ostream &strm) const;
+
+    std::string m_dump() const {
+        std::stringstream sstrm;
+        m_dump(sstrm);
+        return sstrm.str();
+    }
+
     std::string dump() const {
         std::stringstream sstrm;
         dump(sstrm);
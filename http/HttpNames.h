@@ -67,6 +67,10 @@
 #define HTTP_NO_RETRY_URL_REGEX_KEY "Http.No.Retry.Regex"
 #define HTTP_CACHE_EFFECTIVE_URLS_KEY "Http.cache.effective.urls"
 #define HTTP_CACHE_EFFECTIVE_URLS_SKIP_REGEX_KEY "Http.cache.effective.urls.skip.regex.pattern"
+#define HTTP_CACHE_EFFECTIVE_URLS_SHARED_FILE_KEY "Http.cache.effective.urls.shared.file"
+#define HTTP_CACHE_EFFECTIVE_URLS_SHARED_SIZE_KEY "Http.cache.effective.urls.shared.size.MB"
+#define HTTP_CACHE_EFFECTIVE_URLS_SHARED_ITEMS_KEY "Http.cache.effective.urls.shared.items"
+#define HTTP_CACHE_EFFECTIVE_URLS_REFRESH_AHEAD_KEY "Http.cache.effective.urls.refresh.ahead"
 
 #define AMS_EXPIRES_HEADER_KEY "X-Amz-Expires"
 #define AWS_DATE_HEADER_KEY "X-Amz-Date"
@@ -75,6 +79,11 @@
 #define HTTP_EFFECTIVE_URL_DEFAULT_EXPIRES_INTERVAL 300
 #define HTTP_URL_REFRESH_THRESHOLD 60
 
+// Defaults for the effective URL cache that is shared by the besd processes
+#define HTTP_EFFECTIVE_URL_SHARED_CACHE_SIZE_MB 16
+#define HTTP_EFFECTIVE_URL_SHARED_CACHE_ITEMS 16384
+#define HTTP_EFFECTIVE_URL_REFRESH_AHEAD 120
+
 #define EDL_AUTH_TOKEN_KEY "edl_auth_token"
 #define EDL_ECHO_TOKEN_KEY "edl_echo_token"
 #define EDL_UID_KEY "uid"
@@ -82,6 +91,16 @@
 #define REMOTE_RESOURCE_TMP_DIR_KEY "Http.RemoteResource.TmpDir"    // default is /tmp/bes_rr_tmp
 #define REMOTE_RESOURCE_DELETE_TMP_FILE "Http.RemoteResource.TmpFile.Delete"    // default is true
 
+// Keys for the block cache used by RemoteFile
+#define REMOTE_RESOURCE_BLOCK_CACHE_DIR_KEY "Http.RemoteResource.BlockCache.dir"    // default is <TmpDir>/block_cache
+#define REMOTE_RESOURCE_BLOCK_CACHE_SIZE_KEY "Http.RemoteResource.BlockCache.size.MB"    // default is 0, not used
+#define REMOTE_RESOURCE_BLOCK_SIZE_KEY "Http.RemoteResource.BlockCache.BlockSize.KB"
+#define REMOTE_RESOURCE_READ_AHEAD_KEY "Http.RemoteResource.BlockCache.ReadAhead"
+
+#define REMOTE_RESOURCE_BLOCK_CACHE_SIZE_MB 0
+#define REMOTE_RESOURCE_BLOCK_SIZE_KB 4096
+#define REMOTE_RESOURCE_READ_AHEAD 2
+
 #define HTTP_MODULE "http"
 
 #endif //  _bes_http_HTTP_NAMES_H
@@ -0,0 +1,520 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES http package, part of the Hyrax data server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "BESInternalError.h"
+#include "BESDebug.h"
+#include "BESLog.h"
+#include "BESUtil.h"
+#include "TheBESKeys.h"
+
+#include "CurlUtils.h"
+#include "HttpNames.h"
+#include "url_impl.h"
+#include "RemoteFile.h"
+
+#define prolog string("RemoteFile::").append(__func__).append("() - ")
+#define MODULE HTTP_MODULE
+
+using namespace std;
+
+namespace http {
+
+constexpr uint64_t BYTES_PER_KB = 1024ULL;
+constexpr uint64_t BYTES_PER_MB = 1048576ULL;
+
+FileCache RemoteFile::d_block_cache;
+bool RemoteFile::d_block_cache_enabled = false;
+uint64_t RemoteFile::d_block_size = REMOTE_RESOURCE_BLOCK_SIZE_KB * BYTES_PER_KB;
+unsigned int RemoteFile::d_read_ahead = REMOTE_RESOURCE_READ_AHEAD;
+string RemoteFile::d_temp_file_dir;
+string RemoteFile::d_block_cache_dir;
+std::once_flag RemoteFile::d_init_flag;
+
+/**
+ * @brief Read the block cache keys and initialize the cache
+ *
+ * If the cache cannot be used, the blocks are read from the remote resource
+ * each time they are needed.
+ */
+void RemoteFile::initialize_block_cache() {
+    d_temp_file_dir = TheBESKeys::TheKeys()->read_string_key(REMOTE_RESOURCE_TMP_DIR_KEY, "/tmp/bes_rr_tmp");
+    if (BESUtil::mkdir_p(d_temp_file_dir, 0775) != 0) {
+        throw BESInternalError("Temporary file directory '" + d_temp_file_dir + "' error: " + strerror(errno),
+                               __FILE__, __LINE__);
+    }
+
+    auto block_size_kb = TheBESKeys::read_uint64_key(REMOTE_RESOURCE_BLOCK_SIZE_KEY, REMOTE_RESOURCE_BLOCK_SIZE_KB);
+    if (block_size_kb > 0)
+        d_block_size = block_size_kb * BYTES_PER_KB;
+    d_read_ahead = TheBESKeys::read_ulong_key(REMOTE_RESOURCE_READ_AHEAD_KEY, REMOTE_RESOURCE_READ_AHEAD);
+
+    d_block_cache_dir = TheBESKeys::TheKeys()->read_string_key(REMOTE_RESOURCE_BLOCK_CACHE_DIR_KEY,
+                                                               BESUtil::pathConcat(d_temp_file_dir, "block_cache"));
+    auto size_mb = TheBESKeys::read_uint64_key(REMOTE_RESOURCE_BLOCK_CACHE_SIZE_KEY,
+                                               REMOTE_RESOURCE_BLOCK_CACHE_SIZE_MB);
+
+    // When the cache is full, remove a fifth of it.
+    if (size_mb > 0) {
+        d_block_cache_enabled = d_block_cache.initialize(d_block_cache_dir, (long long)(size_mb * BYTES_PER_MB),
+                                                         (long long)(size_mb * BYTES_PER_MB / 5));
+        if (!d_block_cache_enabled)
+            ERROR_LOG(prolog + "Could not use the block cache " + d_block_cache_dir + "; remote data will not be cached.");
+    }
+
+    BESDEBUG(MODULE, prolog << "block cache: " << (d_block_cache_enabled ? d_block_cache_dir : "not used")
+                            << ", block size: " << d_block_size << ", read ahead: " << d_read_ahead << endl);
+}
+
+/**
+ * @brief Make a RemoteFile for a http:// or https:// URL
+ *
+ * This does not access the remote resource.
+ *
+ * @param target_url The resource to read.
+ */
+RemoteFile::RemoteFile(shared_ptr<http::url> target_url) : d_url(std::move(target_url)) {
+    if (d_url->protocol() != HTTPS_PROTOCOL && d_url->protocol() != HTTP_PROTOCOL) {
+        string err = prolog + "Unsupported protocol: " + d_url->protocol();
+        throw BESInternalError(err, __FILE__, __LINE__);
+    }
+
+    std::call_once(d_init_flag, &RemoteFile::initialize_block_cache);
+}
+
+/// @name Cache keys
+/// @{
+
+/// The key for the size and ETag of this resource.
+string RemoteFile::meta_key() const {
+    return FileCache::hash_key(d_url->str()) + "_meta";
+}
+
+/// The key for a block of this resource. Only valid once the size is known.
+string RemoteFile::block_key(uint64_t block) const {
+    return d_block_prefix + "_" + to_string(block);
+}
+
+/// @}
+
+/**
+ * @brief Record the size and ETag of the resource
+ *
+ * The keys for the blocks are made using the size and ETag, so a resource
+ * that changes will not be read using blocks of its old version.
+ */
+void RemoteFile::set_size_and_etag(uint64_t size, const string &etag) {
+    d_size = size;
+    d_etag = etag;
+    d_size_known = true;
+    d_block_prefix = FileCache::hash_key(d_url->str() + "#" + to_string(d_size) + "#" + d_etag);
+}
+
+/**
+ * @brief Get the size and ETag of the resource from the cache
+ *
+ * The values are trusted for REMOTE_RESOURCE_DEFAULT_EXPIRED_INTERVAL seconds,
+ * after which they are found again by reading the resource.
+ *
+ * @return True if the cache held current values for the resource.
+ */
+bool RemoteFile::get_cached_meta() {
+    if (!d_block_cache_enabled)
+        return false;
+
+    FileCache::Item item;
+    if (!d_block_cache.get(meta_key(), item, LOCK_SH))
+        return false;
+
+    struct stat sb{};
+    if (fstat(item.get_fd(), &sb) != 0 || time(nullptr) - sb.st_mtime > REMOTE_RESOURCE_DEFAULT_EXPIRED_INTERVAL)
+        return false;
+
+    char buf[1024];
+    auto n = ::pread(item.get_fd(), buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        return false;
+    buf[n] = '\0';
+
+    istringstream iss(buf);
+    uint64_t size;
+    if (!(iss >> size))
+        return false;
+    string etag;
+    iss >> etag;    // The ETag may be empty
+
+    set_size_and_etag(size, etag);
+    d_meta_cached = true;
+    BESDEBUG(MODULE, prolog << d_url->str() << " size: " << d_size << ", etag: " << d_etag << endl);
+    return true;
+}
+
+/// Replace the cached size and ETag with the values held by this object.
+void RemoteFile::put_cached_meta() {
+    if (!d_block_cache_enabled)
+        return;
+
+    const string key = meta_key();
+    if (access(BESUtil::pathConcat(d_block_cache_dir, key).c_str(), F_OK) == 0 && !d_block_cache.del(key))
+        return;     // Another process is reading or replacing it
+
+    FileCache::PutItem item(d_block_cache);
+    if (!d_block_cache.put(key, item))
+        return;
+
+    const string meta = to_string(d_size) + " " + d_etag + "\n";
+    if (write(item.get_fd(), meta.data(), meta.size()) != (ssize_t)meta.size())
+        ERROR_LOG(prolog + "Could not write the cached size of " + d_url->str() + ": " + strerror(errno));
+    else
+        d_meta_cached = true;
+}
+
+/// @return True if the block is in the cache. It may be removed before it is read.
+bool RemoteFile::is_cached_block(uint64_t block) const {
+    return d_block_cache_enabled
+           && access(BESUtil::pathConcat(d_block_cache_dir, block_key(block)).c_str(), F_OK) == 0;
+}
+
+/**
+ * @brief Read a block from the cache
+ * @param block The block number
+ * @param data Value-result parameter; holds the block
+ * @return True if the block was found; a block of the wrong size is not used.
+ */
+bool RemoteFile::get_cached_block(uint64_t block, vector<char> &data) const {
+    if (!d_block_cache_enabled)
+        return false;
+
+    FileCache::Item item;
+    if (!d_block_cache.get(block_key(block), item, LOCK_SH))
+        return false;
+
+    auto length = min(d_block_size, d_size - block * d_block_size);
+    data.resize(length);
+    return ::pread(item.get_fd(), data.data(), length, 0) == (ssize_t)length;
+}
+
+/// Add a block to the cache, unless another process has already added it.
+void RemoteFile::put_cached_block(uint64_t block, const char *data, size_t count) const {
+    if (!d_block_cache_enabled)
+        return;
+
+    if (is_cached_block(block))
+        return;
+
+    const string key = block_key(block);
+    FileCache::PutItem item(d_block_cache);
+    if (!d_block_cache.put(key, item))
+        return;
+
+    size_t written = 0;
+    while (written < count) {
+        auto n = write(item.get_fd(), data + written, count - written);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ERROR_LOG(prolog + "Could not write block " + key + " to the block cache: " + strerror(errno));
+            return;
+        }
+        written += n;
+    }
+}
+
+/**
+ * @brief Find the start and total size in a Content-Range response header
+ *
+ * If the request was redirected, the headers of each response are present;
+ * the last Content-Range header is used.
+ *
+ * @return True if a Content-Range header with a known total size was found.
+ */
+bool RemoteFile::parse_content_range(const vector<string> &headers, uint64_t &start, uint64_t &total) {
+    const string name = "content-range:";
+    bool found = false;
+    for (const auto &header: headers) {
+        if (BESUtil::lowercase(header.substr(0, name.size())) != name)
+            continue;
+
+        // e.g., Content-Range: bytes 0-4194303/12345678
+        string value = header.substr(name.size());
+        auto dash = value.find('-');
+        auto slash = value.find('/');
+        auto digit = value.find_first_of("0123456789");
+        if (dash == string::npos || slash == string::npos || digit == string::npos || digit > dash)
+            continue;
+        try {
+            start = stoull(value.substr(digit, dash - digit));
+            total = stoull(value.substr(slash + 1));
+            found = true;
+        }
+        catch (const std::exception &) {
+            // An unknown total size ('*') or a bad value; look for another header.
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Find the size in the Content-Range header of a 416 response
+ *
+ * A server that cannot satisfy a range request should send the size of the
+ * resource, e.g., 'Content-Range: bytes * /0' (without the space).
+ *
+ * @return True if a Content-Range header with an unsatisfied range was found.
+ */
+bool RemoteFile::parse_unsatisfied_range(const vector<string> &headers, uint64_t &total) {
+    const string name = "content-range:";
+    bool found = false;
+    for (const auto &header: headers) {
+        if (BESUtil::lowercase(header.substr(0, name.size())) != name)
+            continue;
+
+        string value = header.substr(name.size());
+        auto star = value.find('*');
+        auto slash = value.find('/');
+        if (star == string::npos || slash != star + 1)
+            continue;
+        try {
+            total = stoull(value.substr(slash + 1));
+            found = true;
+        }
+        catch (const std::exception &) {
+            // A bad value; look for another header.
+        }
+    }
+    return found;
+}
+
+/// @return The value of the last ETag response header, or the empty string.
+string RemoteFile::get_etag(const vector<string> &headers) {
+    const string name = "etag:";
+    string etag;
+    for (const auto &header: headers) {
+        if (BESUtil::lowercase(header.substr(0, name.size())) != name)
+            continue;
+        etag = header.substr(name.size());
+        etag.erase(0, etag.find_first_not_of(" \t"));
+        etag.erase(etag.find_last_not_of(" \t\r\n") + 1);
+    }
+    // ETags are quoted and may not contain spaces, but be safe; the meta item is space separated.
+    replace(etag.begin(), etag.end(), ' ', '_');
+    return etag;
+}
+
+/**
+ * @brief Read blocks from the remote resource
+ *
+ * Get blocks 'first' to 'last' using a range GET, cache them and keep them
+ * in d_fetched. The response also sets the size and ETag of the resource. If
+ * the server ignores the range and returns the whole resource, all the blocks
+ * are cached.
+ *
+ * @param first The first block to read
+ * @param last The last block to read; may be past the end of the resource.
+ */
+void RemoteFile::fetch_blocks(uint64_t first, uint64_t last) {
+    uint64_t offset = first * d_block_size;
+    uint64_t count = (last - first + 1) * d_block_size;
+    if (d_size_known)
+        count = min(count, d_size - offset);
+
+    string temp_file_name;
+    int fd = BESUtil::make_temp_file(d_temp_file_dir, temp_file_name);
+    unlink(temp_file_name.c_str());     // The file is removed when fd is closed
+
+    try {
+        vector<string> headers;
+        try {
+            curl::http_get_range_and_write_resource(d_url, offset, count, fd, &headers);
+        }
+        catch (const BESInternalError &) {
+            // A range that starts at byte 0 can only be unsatisfiable (416) if the resource is empty.
+            uint64_t total;
+            if (offset != 0 || !parse_unsatisfied_range(headers, total) || total != 0)
+                throw;
+
+            set_size_and_etag(0, get_etag(headers));
+            put_cached_meta();
+            d_fetched.clear();
+            close(fd);
+            return;
+        }
+
+        struct stat sb{};
+        if (fstat(fd, &sb) != 0)
+            throw BESInternalError(prolog + "Could not get the size of the response for " + d_url->str() + ": "
+                                   + strerror(errno), __FILE__, __LINE__);
+        auto body_size = (uint64_t)sb.st_size;
+        uint64_t start;
+        uint64_t total;
+        if (!parse_content_range(headers, start, total)) {
+            // The server sent the whole resource
+            start = 0;
+            total = body_size;
+        }
+        if (start % d_block_size != 0)
+            throw BESInternalError(prolog + "The response for " + d_url->str() + " starts at byte " + to_string(start)
+                                   + ", which is not at the start of a block.", __FILE__, __LINE__);
+
+        string etag = get_etag(headers);
+        if (!d_size_known || d_size != total || d_etag != etag) {
+            set_size_and_etag(total, etag);
+            d_meta_cached = false;
+        }
+        if (!d_meta_cached)
+            put_cached_meta();
+
+        d_fetched.clear();
+        vector<char> data;
+        for (uint64_t block = start / d_block_size; block * d_block_size < start + body_size; ++block) {
+            auto length = min(d_block_size, d_size - block * d_block_size);
+            if (block * d_block_size + length > start + body_size)
+                break;      // Only part of this block was sent
+
+            data.resize(length);
+            if (::pread(fd, data.data(), length, block * d_block_size - start) != (ssize_t)length)
+                throw BESInternalError(prolog + "Could not read the response for " + d_url->str() + ": "
+                                       + strerror(errno), __FILE__, __LINE__);
+
+            put_cached_block(block, data.data(), length);
+            if (block >= first && block <= last)
+                d_fetched[block] = data;
+        }
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    if (d_block_cache_enabled)
+        d_block_cache.purge_in_background();
+}
+
+/**
+ * @brief The size of the resource
+ * The first call reads the size from the cache or, if the cache does not hold
+ * it, reads the first blocks of the resource.
+ * @return The size in bytes
+ */
+uint64_t RemoteFile::size() {
+    if (!d_size_known && !get_cached_meta())
+        fetch_blocks(0, d_read_ahead);
+    return d_size;
+}
+
+/**
+ * @brief Copy bytes from the blocks of the resource
+ *
+ * Blocks are read from the blocks held by this object, then the block cache
+ * and last from the remote resource. When blocks must be read remotely, all
+ * the missing blocks up to the next cached block are read using one request.
+ * If this read starts where the last one ended, the next few blocks are read
+ * too.
+ *
+ * @return False if the size or ETag of the resource changed while it was read,
+ * in which case buf may hold bytes from both versions.
+ */
+bool RemoteFile::read_blocks(char *buf, uint64_t count, uint64_t offset) {
+    const uint64_t first = offset / d_block_size;
+    const uint64_t last = (offset + count - 1) / d_block_size;
+    const uint64_t last_in_resource = (d_size - 1) / d_block_size;
+
+    vector<char> cached;
+    for (uint64_t block = first; block <= last; ++block) {
+        const vector<char> *data = nullptr;
+        auto fetched = d_fetched.find(block);
+        if (fetched != d_fetched.end()) {
+            data = &fetched->second;
+        }
+        else if (get_cached_block(block, cached)) {
+            data = &cached;
+        }
+        else {
+            uint64_t end = block;
+            while (end < last && !is_cached_block(end + 1))
+                ++end;
+            if (end == last && block == d_next_block)
+                end = min(end + d_read_ahead, last_in_resource);
+
+            const uint64_t size_before = d_size;
+            const string etag_before = d_etag;
+            fetch_blocks(block, end);
+            if (d_size != size_before || d_etag != etag_before)
+                return false;
+
+            fetched = d_fetched.find(block);
+            if (fetched == d_fetched.end())
+                throw BESInternalError(prolog + "Could not read block " + to_string(block) + " of " + d_url->str(),
+                                       __FILE__, __LINE__);
+            data = &fetched->second;
+        }
+
+        // Copy the part of this block that was asked for
+        uint64_t block_start = block * d_block_size;
+        uint64_t from = max(offset, block_start);
+        uint64_t to = min(offset + count, block_start + data->size());
+        memcpy(buf + (from - offset), data->data() + (from - block_start), to - from);
+    }
+
+    d_next_block = last + 1;
+    return true;
+}
+
+/**
+ * @brief Read bytes from the remote resource
+ *
+ * @param buf Put the bytes here
+ * @param count Read this many bytes
+ * @param offset Starting at this offset in the resource
+ * @return The number of bytes read, which is less than count only at the
+ * end of the resource.
+ * @exception BESInternalError, HttpError if the resource cannot be read
+ */
+ssize_t RemoteFile::pread(void *buf, size_t count, uint64_t offset) {
+    // If the resource changes while it is read, start over once using the new version.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (count == 0 || offset >= size())
+            return 0;
+
+        uint64_t length = min((uint64_t)count, d_size - offset);
+        if (read_blocks(static_cast<char *>(buf), length, offset))
+            return (ssize_t)length;
+    }
+
+    throw BESInternalError(prolog + d_url->str() + " changed while it was being read.", __FILE__, __LINE__);
+}
+
+} //  namespace http
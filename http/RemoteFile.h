@@ -0,0 +1,129 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES http package, part of the Hyrax data server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef  _bes_http_REMOTE_FILE_H_
+#define  _bes_http_REMOTE_FILE_H_ 1
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FileCache.h"
+
+namespace http {
+
+class url;
+
+/**
+ * @brief Read a remote resource without retrieving all of it.
+ *
+ * RemoteResource copies the whole resource to a local file before it can be
+ * read. This class reads it a block at a time using HTTP range GETs, and keeps
+ * the blocks in a FileCache that all the besd processes share. Reads that
+ * follow one another also get the next few blocks (readahead), so a handler
+ * reading a file from start to end makes a few large requests, not many small
+ * ones. Blocks are found in the cache using the URL, the size of the resource
+ * and its ETag, so a changed resource is not read from stale blocks.
+ *
+ * Use pread() as you would pread(2). The data handlers read files by name, so
+ * they still use RemoteResource; this class is for code that can read a
+ * resource using pread-style calls.
+ *
+ * @note An instance is not thread safe; use one instance per thread.
+ */
+class RemoteFile {
+private:
+    friend class RemoteFileTest;
+
+    /// Blocks of all the remote files, shared by all instances (and processes).
+    static FileCache d_block_cache;
+    static bool d_block_cache_enabled;
+    static uint64_t d_block_size;
+    static unsigned int d_read_ahead;
+    static std::string d_temp_file_dir;
+    static std::string d_block_cache_dir;
+
+    static std::once_flag d_init_flag;
+    static void initialize_block_cache();
+
+    std::shared_ptr<http::url> d_url;
+
+    /// Size and ETag of the resource; d_size is valid only if d_size_known is true.
+    uint64_t d_size = 0;
+    bool d_size_known = false;
+    std::string d_etag;
+
+    /// True once the size and ETag in the cache are known to be current.
+    bool d_meta_cached = false;
+
+    /// Prefix of the cache keys of this resource's blocks
+    std::string d_block_prefix;
+
+    /// Blocks read by the last fetch, in case they could not be cached.
+    std::map<uint64_t, std::vector<char>> d_fetched;
+
+    /// The block after the last one read; reading it means the reads are sequential.
+    uint64_t d_next_block = 0;
+
+    std::string meta_key() const;
+    std::string block_key(uint64_t block) const;
+    void set_size_and_etag(uint64_t size, const std::string &etag);
+
+    bool get_cached_meta();
+    void put_cached_meta();
+
+    bool is_cached_block(uint64_t block) const;
+    bool get_cached_block(uint64_t block, std::vector<char> &data) const;
+    void put_cached_block(uint64_t block, const char *data, size_t count) const;
+
+    void fetch_blocks(uint64_t first, uint64_t last);
+    bool read_blocks(char *buf, uint64_t count, uint64_t offset);
+
+    static bool parse_content_range(const std::vector<std::string> &headers, uint64_t &start, uint64_t &total);
+    static bool parse_unsatisfied_range(const std::vector<std::string> &headers, uint64_t &total);
+    static std::string get_etag(const std::vector<std::string> &headers);
+
+public:
+    RemoteFile() = delete;
+    RemoteFile(const RemoteFile &rhs) = delete;
+    RemoteFile &operator=(const RemoteFile &rhs) = delete;
+    explicit RemoteFile(std::shared_ptr<http::url> target_url);
+
+    virtual ~RemoteFile() = default;
+
+    uint64_t size();
+
+    ssize_t pread(void *buf, size_t count, uint64_t offset);
+
+    /// @return The number of bytes in a cached block
+    static uint64_t block_size() { return d_block_size; }
+};
+
+} /* namespace http */
+
+#endif /*  _bes_http_REMOTE_FILE_H_ */
@@ -43,6 +43,10 @@ class url;
  * retrieve the content of the resource and place it in a local temporary file.
  * It can be configured to use a proxy server for the outgoing requests using
  * features of the CurlUtils functions.
+ *
+ * The whole resource is retrieved before any of it can be read, because the
+ * data handlers read files by name. See RemoteFile for reading parts of a
+ * resource with range GETs.
  */
 class RemoteResource {
 private:
@@ -25,6 +25,9 @@
 
 #include <memory>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <ctime>
 
 #include <cppunit/TextTestRunner.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -369,6 +372,72 @@ public:
         DBG(cerr << prolog << "END" << endl);
     }
 
+    void serialize_test() {
+        vector<string> headers = {"Cache-Control: private, max-age=600", "Content-Type: text/plain"};
+        EffectiveUrl eurl("https://ended_here.com/data.nc?Expires=1700000000", headers);
+        eurl.set_ingest_time(1600000000);
+
+        auto copy = EffectiveUrl::deserialize(eurl.serialize());
+        CPPUNIT_ASSERT_MESSAGE("deserialize() should work", copy);
+        CPPUNIT_ASSERT(copy->str() == eurl.str());
+        CPPUNIT_ASSERT(copy->ingest_time() == 1600000000);
+        CPPUNIT_ASSERT_MESSAGE("The max-age header should be kept", copy->expires_time() == 1600000600);
+
+        CPPUNIT_ASSERT_MESSAGE("A damaged value should not be read", !EffectiveUrl::deserialize("EURL1:junk"));
+        CPPUNIT_ASSERT_MESSAGE("A truncated value should not be read",
+                               !EffectiveUrl::deserialize(eurl.serialize().substr(0, 30)));
+    }
+
+    void shared_cache_test() {
+        const string shared_file = string(TEST_BUILD_DIR) + "/effective_url_shared_cache";
+        unlink(shared_file.c_str());
+        TheBESKeys::TheKeys()->set_key(HTTP_CACHE_EFFECTIVE_URLS_SHARED_FILE_KEY, shared_file);
+        TheBESKeys::TheKeys()->set_key(HTTP_CACHE_EFFECTIVE_URLS_SHARED_SIZE_KEY, "1");
+        TheBESKeys::TheKeys()->set_key(HTTP_CACHE_EFFECTIVE_URLS_SHARED_ITEMS_KEY, "64");
+
+        try {
+            // Two caches stand in for two besd processes.
+            EffectiveUrlCache writer;
+            writer.initialize_shared_cache();
+            CPPUNIT_ASSERT_MESSAGE("The shared cache should be mapped", writer.d_shared_urls.is_initialized());
+
+            shared_ptr<http::url> src_url(new http::url("http://started_here.com/data.nc"));
+            const time_t expires = time(nullptr) + 3600;
+            auto eurl = make_shared<EffectiveUrl>("https://ended_here.com/data.nc?Expires=" + to_string(expires));
+            writer.put_shared_eurl(src_url->str(), eurl);
+
+            // The reader finds the URL in the shared cache without following the redirects.
+            EffectiveUrlCache reader;
+            reader.d_enabled = true;
+            auto result_url = reader.get_effective_url(src_url);
+            CPPUNIT_ASSERT(result_url->str() == eurl->str());
+            CPPUNIT_ASSERT_MESSAGE("The reader should cache the shared URL", reader.d_effective_urls.size() == 1);
+            CPPUNIT_ASSERT_MESSAGE("The URL should not be refreshed", reader.d_refreshing.empty());
+        }
+        catch (const BESError &be) {
+            CPPUNIT_FAIL(prolog + "ERROR! Caught BESError. Message: " + be.get_message());
+        }
+
+        TheBESKeys::TheKeys()->set_key(HTTP_CACHE_EFFECTIVE_URLS_SHARED_FILE_KEY, "");
+        unlink(shared_file.c_str());
+    }
+
+    void needs_refresh_test() {
+        EffectiveUrlCache cache;
+        cache.d_refresh_ahead = 120;
+
+        const time_t now = time(nullptr);
+        auto soon = make_shared<EffectiveUrl>("https://ended_here.com/data.nc?Expires=" + to_string(now + 90));
+        CPPUNIT_ASSERT_MESSAGE("The URL should not be expired", !soon->is_expired());
+        CPPUNIT_ASSERT_MESSAGE("The URL should be refreshed", cache.needs_refresh(soon));
+
+        auto later = make_shared<EffectiveUrl>("https://ended_here.com/data.nc?Expires=" + to_string(now + 3600));
+        CPPUNIT_ASSERT_MESSAGE("The URL should not be refreshed", !cache.needs_refresh(later));
+
+        cache.d_refresh_ahead = 0;
+        CPPUNIT_ASSERT_MESSAGE("Refresh ahead should be off", !cache.needs_refresh(soon));
+    }
+
 /* TESTS END */
 /*##################################################################################################*/
 
@@ -381,6 +450,9 @@ CPPUNIT_TEST_SUITE(EffectiveUrlCacheTest);
         CPPUNIT_TEST(euc_ghrc_tea_url_test);
         CPPUNIT_TEST(euc_harmony_url_test);
         CPPUNIT_TEST(trusted_url_test_01);
+        CPPUNIT_TEST(serialize_test);
+        CPPUNIT_TEST(shared_cache_test);
+        CPPUNIT_TEST(needs_refresh_test);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -0,0 +1,250 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES component of the Hyrax Data Server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <memory>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "BESError.h"
+#include "BESInternalError.h"
+#include "BESDebug.h"
+#include "BESUtil.h"
+#include "TheBESKeys.h"
+
+#include "CurlUtils.h"
+#include "HttpNames.h"
+#include "RemoteFile.h"
+#include "url_impl.h"
+#include "test_config.h"
+
+using namespace std;
+
+static bool debug = false;
+static bool bes_debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false)
+
+#define prolog std::string("RemoteFileTest::").append(__func__).append("() - ")
+
+namespace http {
+
+class RemoteFileTest : public CppUnit::TestFixture {
+private:
+    const string d_url_str = "http://test.opendap.org/data/httpd_catalog/READTHIS";
+
+    // Get the whole resource, the way RemoteResource does.
+    string get_whole_resource() const {
+        string temp_file_name;
+        int fd = BESUtil::make_temp_file(TEST_BUILD_DIR, temp_file_name);
+        unlink(temp_file_name.c_str());
+        vector<string> headers;
+        curl::http_get_and_write_resource(make_shared<http::url>(d_url_str), fd, &headers);
+        string content;
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+            content.append(buf, n);
+        close(fd);
+        return content;
+    }
+
+public:
+    RemoteFileTest() = default;
+    ~RemoteFileTest() override = default;
+
+    void setUp() override {
+        TheBESKeys::ConfigFile = string(TEST_BUILD_DIR) + "/bes.conf";
+        if (bes_debug) BESDebug::SetUp("cerr,http,curl");
+
+        // Use small blocks so the test resource spans several of them. These are
+        // read once, by the first RemoteFile made.
+        TheBESKeys::TheKeys()->set_key(REMOTE_RESOURCE_BLOCK_CACHE_DIR_KEY, string(TEST_BUILD_DIR) + "/block_cache");
+        TheBESKeys::TheKeys()->set_key(REMOTE_RESOURCE_BLOCK_CACHE_SIZE_KEY, "10");
+        TheBESKeys::TheKeys()->set_key(REMOTE_RESOURCE_BLOCK_SIZE_KEY, "1");
+        TheBESKeys::TheKeys()->set_key(REMOTE_RESOURCE_READ_AHEAD_KEY, "1");
+    }
+
+    void tearDown() override { }
+
+/*##################################################################################################*/
+/* TESTS BEGIN */
+
+    void unsupported_protocol_test() {
+        auto file_url = make_shared<http::url>(string("file://") + TEST_DATA_DIR + "/test_file");
+        CPPUNIT_ASSERT_THROW_MESSAGE("A file:// URL should not be used with RemoteFile", RemoteFile rf(file_url),
+                                     BESInternalError);
+    }
+
+    void parse_content_range_test() {
+        uint64_t start = 0;
+        uint64_t total = 0;
+        vector<string> headers = {"HTTP/1.1 206 Partial Content", "Content-Type: text/plain",
+                                  "Content-Range: bytes 2048-3071/12345"};
+        CPPUNIT_ASSERT(RemoteFile::parse_content_range(headers, start, total));
+        CPPUNIT_ASSERT_EQUAL((uint64_t)2048, start);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)12345, total);
+
+        // HTTP/2 headers are lower case; after a redirect, the last response is used
+        headers = {"HTTP/1.1 302 Found", "content-range: bytes 0-1/2", "HTTP/2 206", "content-range: bytes 0-1023/4096"};
+        CPPUNIT_ASSERT(RemoteFile::parse_content_range(headers, start, total));
+        CPPUNIT_ASSERT_EQUAL((uint64_t)0, start);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)4096, total);
+
+        headers = {"HTTP/1.1 200 OK", "Content-Length: 4096"};
+        CPPUNIT_ASSERT(!RemoteFile::parse_content_range(headers, start, total));
+
+        headers = {"Content-Range: bytes 0-1023/*"};
+        CPPUNIT_ASSERT(!RemoteFile::parse_content_range(headers, start, total));
+    }
+
+    void parse_unsatisfied_range_test() {
+        uint64_t total = 1;
+        vector<string> headers = {"Content-Type: application/xml", "Content-Range: bytes */0"};
+        CPPUNIT_ASSERT(RemoteFile::parse_unsatisfied_range(headers, total));
+        CPPUNIT_ASSERT_EQUAL((uint64_t)0, total);
+
+        headers = {"content-range: bytes */4096"};
+        CPPUNIT_ASSERT(RemoteFile::parse_unsatisfied_range(headers, total));
+        CPPUNIT_ASSERT_EQUAL((uint64_t)4096, total);
+
+        headers = {"Content-Range: bytes 0-1023/4096"};
+        CPPUNIT_ASSERT(!RemoteFile::parse_unsatisfied_range(headers, total));
+
+        headers = {"Content-Length: 0"};
+        CPPUNIT_ASSERT(!RemoteFile::parse_unsatisfied_range(headers, total));
+    }
+
+    void get_etag_test() {
+        vector<string> headers = {"HTTP/1.1 206 Partial Content", "ETag: \"5d-1a2b3c\""};
+        CPPUNIT_ASSERT_EQUAL(string("\"5d-1a2b3c\""), RemoteFile::get_etag(headers));
+
+        headers = {"HTTP/1.1 200 OK"};
+        CPPUNIT_ASSERT_EQUAL(string(""), RemoteFile::get_etag(headers));
+    }
+
+    void pread_test() {
+        RemoteFile rf(make_shared<http::url>(d_url_str));
+        CPPUNIT_ASSERT_EQUAL_MESSAGE("The block size should be set by the bes.conf key",
+                                     (uint64_t)1024, RemoteFile::block_size());
+
+        string expected = get_whole_resource();
+        DBG(cerr << prolog << "Resource size: " << expected.size() << "\n");
+        CPPUNIT_ASSERT_EQUAL((uint64_t)expected.size(), rf.size());
+
+        // Read sequentially, in pieces that do not line up with the blocks
+        string content;
+        vector<char> buf(300);
+        ssize_t n;
+        while ((n = rf.pread(buf.data(), buf.size(), content.size())) > 0)
+            content.append(buf.data(), n);
+        CPPUNIT_ASSERT_MESSAGE("The content read a piece at a time should match the resource", content == expected);
+
+        // Read past the end
+        CPPUNIT_ASSERT_EQUAL((ssize_t)0, rf.pread(buf.data(), buf.size(), expected.size()));
+    }
+
+    void pread_from_cache_test() {
+        string expected = get_whole_resource();
+
+        // Read the resource once to fill the cache
+        {
+            RemoteFile rf(make_shared<http::url>(d_url_str));
+            vector<char> buf(expected.size());
+            CPPUNIT_ASSERT_EQUAL((ssize_t)expected.size(), rf.pread(buf.data(), buf.size(), 0));
+        }
+
+        // Another instance should find the size and blocks in the cache
+        RemoteFile rf(make_shared<http::url>(d_url_str));
+        CPPUNIT_ASSERT_MESSAGE("The size should be cached", rf.get_cached_meta());
+        CPPUNIT_ASSERT_EQUAL((uint64_t)expected.size(), rf.size());
+        for (uint64_t block = 0; block * RemoteFile::block_size() < expected.size(); ++block)
+            CPPUNIT_ASSERT_MESSAGE("Block " + to_string(block) + " should be cached", rf.is_cached_block(block));
+
+        // Read from the middle, across a block boundary
+        uint64_t offset = expected.size() / 2;
+        vector<char> buf(expected.size() - offset);
+        CPPUNIT_ASSERT_EQUAL((ssize_t)buf.size(), rf.pread(buf.data(), buf.size(), offset));
+        CPPUNIT_ASSERT(string(buf.data(), buf.size()) == expected.substr(offset));
+    }
+
+CPPUNIT_TEST_SUITE(RemoteFileTest);
+
+        CPPUNIT_TEST(unsupported_protocol_test);
+        CPPUNIT_TEST(parse_content_range_test);
+        CPPUNIT_TEST(parse_unsatisfied_range_test);
+        CPPUNIT_TEST(get_etag_test);
+        CPPUNIT_TEST(pread_test);
+        CPPUNIT_TEST(pread_from_cache_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RemoteFileTest);
+
+} // namespace http
+
+int main(int argc, char *argv[]) {
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    int option_char;
+    while ((option_char = getopt(argc, argv, "db")) != -1)
+        switch (option_char) {
+            case 'd':
+                debug = true;  // debug is a static global
+                cerr << "debug enabled\n";
+                break;
+            case 'b':
+                bes_debug = true;  // debug is a static global
+                cerr << "bes_debug enabled\n";
+                break;
+            default:
+                break;
+        }
+
+    argc -= optind;
+    argv += optind;
+
+    bool wasSuccessful = true;
+    if (0 == argc) {
+        wasSuccessful = runner.run("");         // run them all
+    } else {
+        for (int i = 0; i < argc; ++i) {
+            DBG(cerr << "Running " << argv[i] << "\n");
+            string test = http::RemoteFileTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -206,24 +206,25 @@ const vector<string> &url::query_parameter_values(const std::string &key) const
 }
 
 /**
- * @return True if the URL appears within the REFRESH_THRESHOLD of the expires time
- * read from one of CLOUDFRONT_EXPIRES_HEADER_KEY or AMS_EXPIRES_HEADER_KEY.
+ * @brief When does the URL expire?
+ *
+ * The time is read from one of CLOUDFRONT_EXPIRES_HEADER_KEY or AMS_EXPIRES_HEADER_KEY
+ * (plus AWS_DATE_HEADER_KEY). If neither is present, the URL expires
+ * HTTP_EFFECTIVE_URL_DEFAULT_EXPIRES_INTERVAL seconds after its ingest time.
+ *
+ * @return The expiration time, in seconds since the epoch.
  */
-bool url::is_expired()
+std::time_t url::expires_time()
 {
-    bool stale;
-    std::time_t now = system_clock::to_time_t(system_clock::now());
-
-    BESDEBUG(MODULE, prolog << "now: " << now << endl);
     // We set the expiration time to the default, in case other avenues don't work out so well.
-    std::time_t expires_time = ingest_time() + HTTP_EFFECTIVE_URL_DEFAULT_EXPIRES_INTERVAL;
+    std::time_t expires = ingest_time() + HTTP_EFFECTIVE_URL_DEFAULT_EXPIRES_INTERVAL;
 
     string cf_expires = query_parameter_value(CLOUDFRONT_EXPIRES_HEADER_KEY);
     string aws_expires_str = query_parameter_value(AMS_EXPIRES_HEADER_KEY);
 
     if (!cf_expires.empty()) { // CloudFront expires header?
-        std::istringstream(cf_expires) >> expires_time;
-        BESDEBUG(MODULE, prolog << "Using " << CLOUDFRONT_EXPIRES_HEADER_KEY << ": " << expires_time << endl);
+        std::istringstream(cf_expires) >> expires;
+        BESDEBUG(MODULE, prolog << "Using " << CLOUDFRONT_EXPIRES_HEADER_KEY << ": " << expires << endl);
     }
     else if (!aws_expires_str.empty()) {
         long long aws_expires;
@@ -272,13 +273,29 @@ bool url::is_expired()
             BESDEBUG(MODULE, prolog << "AWS start_time (computed): " << aws_start_time << endl);
         }
 
-        expires_time = aws_start_time + aws_expires;
+        expires = aws_start_time + aws_expires;
         BESDEBUG(MODULE, prolog << "Using " << AMS_EXPIRES_HEADER_KEY << ": " << aws_expires <<
-                                " (expires_time: " << expires_time << ")" << endl);
+                                " (expires_time: " << expires << ")" << endl);
     }
 
-    std::time_t remaining = expires_time - now;
-    BESDEBUG(MODULE, prolog << "expires_time: " << expires_time <<
+    return expires;
+}
+
+/**
+ * @return True if the URL appears within the REFRESH_THRESHOLD of the expires time
+ * read from one of CLOUDFRONT_EXPIRES_HEADER_KEY or AMS_EXPIRES_HEADER_KEY.
+ * @see expires_time()
+ */
+bool url::is_expired()
+{
+    bool stale;
+    std::time_t now = system_clock::to_time_t(system_clock::now());
+
+    BESDEBUG(MODULE, prolog << "now: " << now << endl);
+    std::time_t expires = expires_time();
+
+    std::time_t remaining = expires - now;
+    BESDEBUG(MODULE, prolog << "expires_time: " << expires <<
                             "  remaining: " << remaining <<
                             " threshold: " << HTTP_URL_REFRESH_THRESHOLD << endl);
 
@@ -0,0 +1,395 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _handle_cache_h
+#define _handle_cache_h
+
+#include <sys/stat.h>
+
+#include <ctime>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <string>
+#include <utility>
+
+#include "BESDebug.h"
+
+namespace bes {
+
+/**
+ * @brief An LRU cache of open file handles
+ *
+ * The handlers' read() methods open the dataset's file, read one variable and
+ * close the file again. This cache keeps the handles open so that the
+ * variables of a request, and later requests for the same file, share them.
+ * The handlers wrap it to fit their library: HDF5 file IDs, netCDF ncids and
+ * HDF4/HDF-EOS2 SD, file, grid and swath IDs.
+ *
+ * - Handles are reference counted and a handle in use is never closed.
+ * - At most max_entries handles are kept open. When there are more, the least
+ *   recently used handles that are not in use are closed.
+ * - A handle is reused only if its file's modification time has not changed
+ *   since it was opened. A handle for a file that has changed is closed once
+ *   it is no longer in use.
+ * - A handle may depend on another one, like an HDF-EOS2 grid on the file it
+ *   is attached to. The parent is kept open while the child is and the child
+ *   is always closed first.
+ *
+ * Call end_request() when a request is done. A read() that throws may not
+ * release its handles; end_request() drops those references so the handles
+ * can be closed.
+ *
+ * The BES handles one request at a time in a process, so the cache is not
+ * locked.
+ *
+ * @tparam Handle The handle type; it must be copyable and support ==
+ */
+template<typename Handle>
+class HandleCache {
+public:
+    /// Closes a handle and returns the library's status code
+    using close_function = std::function<int(const Handle &)>;
+
+private:
+    struct Entry {
+        std::string key;
+        Handle handle;
+        time_t mtime = 0;
+        unsigned int readers = 0;   // The read() calls using the handle
+        unsigned int children = 0;  // The handles that depend on this one
+        bool stale = false;         // The file changed; close it when it is no longer in use
+        bool has_parent = false;
+        Handle parent;
+
+        bool in_use() const { return readers > 0 || children > 0; }
+    };
+
+    using iterator = typename std::list<Entry>::iterator;
+
+    close_function d_close;
+    unsigned int d_max_entries;
+    std::string d_debug_context;
+
+    // Most recently used first
+    std::list<Entry> d_entries;
+
+    iterator find_handle(const Handle &handle)
+    {
+        auto it = d_entries.begin();
+        while (it != d_entries.end() && !(it->handle == handle))
+            ++it;
+        return it;
+    }
+
+    // The handle for a key, not counting handles for files that have changed
+    iterator find_key(const std::string &key)
+    {
+        auto it = d_entries.begin();
+        while (it != d_entries.end() && (it->stale || it->key != key))
+            ++it;
+        return it;
+    }
+
+    // Add a reader to a handle and make it the most recently used
+    void use(iterator it, Handle &handle)
+    {
+        BESDEBUG(d_debug_context, "HandleCache: reuse " << it->key << std::endl);
+        it->readers++;
+        d_entries.splice(d_entries.begin(), d_entries, it);
+        handle = it->handle;
+    }
+
+    // Mark an entry and the entries that depend on it as stale.
+    void mark_stale(iterator it)
+    {
+        it->stale = true;
+        for (auto child = d_entries.begin(); child != d_entries.end(); ++child) {
+            if (child->has_parent && child->parent == it->handle && !child->stale)
+                mark_stale(child);
+        }
+    }
+
+    // Close the stale handles that are not in use. Closing a child may close
+    // its parent, so start over after each close.
+    void close_stale()
+    {
+        bool closed = true;
+        while (closed) {
+            closed = false;
+            for (auto it = d_entries.begin(); it != d_entries.end(); ++it) {
+                if (it->stale && !it->in_use()) {
+                    close_entry(it);
+                    closed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Close a handle. If it is the last child of a stale parent that is not
+    // in use, close the parent too.
+    int close_entry(iterator it)
+    {
+        BESDEBUG(d_debug_context, "HandleCache: close " << it->key << std::endl);
+
+        int status = d_close(it->handle);
+        bool has_parent = it->has_parent;
+        Handle parent = it->parent;
+        d_entries.erase(it);
+
+        if (has_parent) {
+            auto p = find_handle(parent);
+            if (p != d_entries.end()) {
+                if (p->children > 0)
+                    p->children--;
+                if (p->stale && !p->in_use())
+                    close_entry(p);
+            }
+        }
+
+        return status;
+    }
+
+    // Close the least recently used handles that are not in use until no more
+    // than d_max_entries are open. Children are closed before their parents
+    // because a parent is in use while it has children.
+    void purge()
+    {
+        bool closed = true;
+        while (d_entries.size() > d_max_entries && closed) {
+            closed = false;
+            auto it = d_entries.end();
+            while (it != d_entries.begin()) {
+                --it;
+                if (!it->in_use()) {
+                    close_entry(it);
+                    closed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+public:
+    /**
+     * @param close Closes a handle
+     * @param max_entries Keep at most this many handles open. Zero turns the
+     * cache off; insert() then closes handles when they are released.
+     * @param debug_context The BESDEBUG context for the cache's messages
+     */
+    HandleCache(close_function close, unsigned int max_entries, const std::string &debug_context = "cache") :
+        d_close(std::move(close)), d_max_entries(max_entries), d_debug_context(debug_context) {}
+
+    HandleCache(const HandleCache &) = delete;
+    HandleCache &operator=(const HandleCache &) = delete;
+
+    virtual ~HandleCache() { clear(); }
+
+    /// @return The most handles kept open
+    unsigned int get_max_entries() const { return d_max_entries; }
+    void set_max_entries(unsigned int max_entries) { d_max_entries = max_entries; purge(); }
+
+    /// @return True if the cache keeps handles open
+    bool enabled() const { return d_max_entries > 0; }
+
+    /// @return The number of open handles held by the cache
+    size_t size() const { return d_entries.size(); }
+
+    /**
+     * @brief Get the modification time of a file
+     * @return False if the file cannot be stat'd. The caller should open
+     * the file without the cache and let the library report the error.
+     */
+    static bool file_mtime(const std::string &path, time_t &mtime)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        mtime = st.st_mtime;
+        return true;
+    }
+
+    /**
+     * @brief Find the handle for a key
+     *
+     * If a handle is found, it is in use until release() is called.
+     *
+     * @param key The key used to insert the handle, usually the file's path
+     * @param mtime The file's modification time now. A handle opened when the
+     * file had a different time is marked stale and is not returned.
+     * @param handle Value-result parameter; the handle
+     * @return True if an open handle was found
+     */
+    bool find(const std::string &key, time_t mtime, Handle &handle)
+    {
+        auto it = find_key(key);
+        if (it == d_entries.end())
+            return false;
+
+        if (it->mtime != mtime) {
+            BESDEBUG(d_debug_context, "HandleCache: " << key << " has changed since it was opened" << std::endl);
+            mark_stale(it);
+            close_stale();
+            return false;
+        }
+
+        use(it, handle);
+        return true;
+    }
+
+    /**
+     * @brief Find a handle that depends on another one
+     *
+     * A child handle is valid as long as its parent is, so its file's time is
+     * not checked.
+     */
+    bool find_child(const std::string &key, Handle &handle)
+    {
+        auto it = find_key(key);
+        if (it == d_entries.end())
+            return false;
+
+        use(it, handle);
+        return true;
+    }
+
+    /// @return True if the handle is held by the cache
+    bool contains(const Handle &handle)
+    {
+        return find_handle(handle) != d_entries.end();
+    }
+
+    /**
+     * @brief Add a handle that was just opened
+     *
+     * The handle is in use until release() is called. If the cache is full,
+     * the least recently used handles that are not in use are closed.
+     */
+    void insert(const std::string &key, time_t mtime, const Handle &handle)
+    {
+        Entry entry;
+        entry.key = key;
+        entry.handle = handle;
+        entry.mtime = mtime;
+        entry.readers = 1;
+        d_entries.push_front(entry);
+
+        purge();
+    }
+
+    /**
+     * @brief Add a handle that depends on another handle in the cache
+     *
+     * The parent stays open until the child is closed.
+     *
+     * @return False if the parent is not in the cache; the child was not added.
+     */
+    bool insert_child(const std::string &key, const Handle &handle, const Handle &parent)
+    {
+        auto p = find_handle(parent);
+        if (p == d_entries.end())
+            return false;
+
+        p->children++;
+
+        Entry entry;
+        entry.key = key;
+        entry.handle = handle;
+        entry.mtime = p->mtime;
+        entry.stale = p->stale;
+        entry.readers = 1;
+        entry.has_parent = true;
+        entry.parent = parent;
+        d_entries.push_front(entry);
+
+        purge();
+
+        return true;
+    }
+
+    /**
+     * @brief Release a handle returned by find() or added by insert()
+     *
+     * The handle stays open unless its file has changed or the cache is full.
+     *
+     * @param handle The handle
+     * @param status Value-result parameter; if the handle was closed, the
+     * status returned by the close function. Otherwise unchanged.
+     * @return False if the handle is not in the cache. The caller must close it.
+     */
+    bool release(const Handle &handle, int *status = nullptr)
+    {
+        auto it = find_handle(handle);
+        if (it == d_entries.end())
+            return false;
+
+        if (it->readers > 0)
+            it->readers--;
+
+        if (it->stale && !it->in_use()) {
+            int s = close_entry(it);
+            if (status)
+                *status = s;
+        }
+
+        purge();
+
+        return true;
+    }
+
+    /**
+     * @brief Drop the references held by the reads of a request
+     *
+     * No read is running between requests, so any handle that is still in
+     * use was not released, e.g. because the read() threw. Close those that
+     * are stale and trim the cache.
+     */
+    void end_request()
+    {
+        for (auto &entry: d_entries) {
+            if (entry.readers > 0) {
+                BESDEBUG(d_debug_context, "HandleCache: " << entry.key << " was not released" << std::endl);
+                entry.readers = 0;
+            }
+        }
+
+        close_stale();
+        purge();
+    }
+
+    /// Close all the handles. Children are closed before their parents.
+    void clear()
+    {
+        while (!d_entries.empty()) {
+            auto it = d_entries.begin();
+            while (it->children > 0)
+                ++it;
+            close_entry(it);
+        }
+    }
+};
+
+} // namespace bes
+
+#endif // _handle_cache_h
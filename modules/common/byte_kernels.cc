@@ -0,0 +1,438 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstring>
+#include <utility>
+
+#include "byte_kernels.h"
+
+// The vector kernels use GCC/clang function attributes so that this file can
+// be compiled without -mavx2 and still have AVX2 code, used only when the CPU
+// supports it.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BYTE_KERNELS_X86 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define BYTE_KERNELS_X86 0
+#endif
+
+namespace bes {
+
+/// @return The most capable instruction set supported by this CPU.
+kernel_isa best_kernel_isa()
+{
+#if BYTE_KERNELS_X86
+    static const kernel_isa best = __builtin_cpu_supports("avx2") ? kernel_avx2 : kernel_sse2;
+    return best;
+#else
+    return kernel_scalar;
+#endif
+}
+
+const char *kernel_isa_name(kernel_isa isa)
+{
+    switch (isa) {
+        case kernel_avx2:
+            return "avx2";
+        case kernel_sse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+#if BYTE_KERNELS_X86
+// Never use an instruction set the CPU lacks, even if asked to.
+static kernel_isa usable_isa(kernel_isa isa)
+{
+    return isa > best_kernel_isa() ? best_kernel_isa() : isa;
+}
+#endif
+
+// -- unshuffle --
+//
+// The shuffled data are 'width' planes of 'elems' bytes each; plane j holds
+// byte j of every element. The kernels write elements [first, last).
+
+template <unsigned int W>
+static void unshuffle_scalar_w(char *dest, const char *src, uint64_t elems, uint64_t first, uint64_t last)
+{
+    for (uint64_t i = first; i < last; ++i) {
+        for (unsigned int j = 0; j < W; ++j)
+            dest[i * W + j] = src[j * elems + i];
+    }
+}
+
+static void unshuffle_scalar(char *dest, const char *src, uint64_t elems, uint64_t width, uint64_t first)
+{
+    switch (width) {
+        case 2:
+            unshuffle_scalar_w<2>(dest, src, elems, first, elems);
+            break;
+        case 4:
+            unshuffle_scalar_w<4>(dest, src, elems, first, elems);
+            break;
+        case 8:
+            unshuffle_scalar_w<8>(dest, src, elems, first, elems);
+            break;
+        default:
+            // Plane by plane, which reads the source sequentially.
+            for (uint64_t j = 0; j < width; ++j) {
+                const char *plane = src + j * elems;
+                char *out = dest + j;
+                for (uint64_t i = first; i < elems; ++i)
+                    out[i * width] = plane[i];
+            }
+            break;
+    }
+}
+
+#if BYTE_KERNELS_X86
+
+// Sixteen elements per iteration. Each step of unpacking doubles the number of
+// adjacent bytes that belong to one element.
+static uint64_t unshuffle_sse2(char *dest, const char *src, uint64_t elems, uint64_t width)
+{
+    const uint64_t n = elems - elems % 16;
+    auto load = [src, elems](unsigned int plane, uint64_t i) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + plane * elems + i));
+    };
+    auto store = [dest, width](uint64_t i, unsigned int k, __m128i v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * width + k * 16), v);
+    };
+
+    switch (width) {
+        case 2:
+            for (uint64_t i = 0; i < n; i += 16) {
+                const __m128i a0 = load(0, i), a1 = load(1, i);
+                store(i, 0, _mm_unpacklo_epi8(a0, a1));
+                store(i, 1, _mm_unpackhi_epi8(a0, a1));
+            }
+            return n;
+
+        case 4:
+            for (uint64_t i = 0; i < n; i += 16) {
+                const __m128i a0 = load(0, i), a1 = load(1, i), a2 = load(2, i), a3 = load(3, i);
+                const __m128i t0 = _mm_unpacklo_epi8(a0, a1), t1 = _mm_unpackhi_epi8(a0, a1);
+                const __m128i t2 = _mm_unpacklo_epi8(a2, a3), t3 = _mm_unpackhi_epi8(a2, a3);
+                store(i, 0, _mm_unpacklo_epi16(t0, t2));
+                store(i, 1, _mm_unpackhi_epi16(t0, t2));
+                store(i, 2, _mm_unpacklo_epi16(t1, t3));
+                store(i, 3, _mm_unpackhi_epi16(t1, t3));
+            }
+            return n;
+
+        case 8:
+            for (uint64_t i = 0; i < n; i += 16) {
+                __m128i a[8];
+                for (unsigned int j = 0; j < 8; ++j)
+                    a[j] = load(j, i);
+                __m128i p[4], q[4];
+                for (unsigned int j = 0; j < 4; ++j) {
+                    p[j] = _mm_unpacklo_epi8(a[2 * j], a[2 * j + 1]);     // elements 0-7
+                    q[j] = _mm_unpackhi_epi8(a[2 * j], a[2 * j + 1]);     // elements 8-15
+                }
+                const __m128i r0 = _mm_unpacklo_epi16(p[0], p[1]), r1 = _mm_unpackhi_epi16(p[0], p[1]);
+                const __m128i r2 = _mm_unpacklo_epi16(p[2], p[3]), r3 = _mm_unpackhi_epi16(p[2], p[3]);
+                const __m128i s0 = _mm_unpacklo_epi16(q[0], q[1]), s1 = _mm_unpackhi_epi16(q[0], q[1]);
+                const __m128i s2 = _mm_unpacklo_epi16(q[2], q[3]), s3 = _mm_unpackhi_epi16(q[2], q[3]);
+                store(i, 0, _mm_unpacklo_epi32(r0, r2));
+                store(i, 1, _mm_unpackhi_epi32(r0, r2));
+                store(i, 2, _mm_unpacklo_epi32(r1, r3));
+                store(i, 3, _mm_unpackhi_epi32(r1, r3));
+                store(i, 4, _mm_unpacklo_epi32(s0, s2));
+                store(i, 5, _mm_unpackhi_epi32(s0, s2));
+                store(i, 6, _mm_unpacklo_epi32(s1, s3));
+                store(i, 7, _mm_unpackhi_epi32(s1, s3));
+            }
+            return n;
+
+        default:
+            return 0;
+    }
+}
+
+// Thirty-two elements per iteration. The AVX2 unpack instructions work within
+// each 128-bit half, so after the same steps as the SSE2 version, the low half
+// of result k holds part k of elements 0-15 and the high half holds part k of
+// elements 16-31. The final permutes put the halves in order.
+AVX2_TARGET
+static uint64_t unshuffle_avx2(char *dest, const char *src, uint64_t elems, uint64_t width)
+{
+    const uint64_t n = elems - elems % 32;
+
+#define LOAD256(plane, i) _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + (plane) * elems + (i)))
+#define STORE256(i, k, v) _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + (i) * width + (k) * 32), (v))
+
+    switch (width) {
+        case 2:
+            for (uint64_t i = 0; i < n; i += 32) {
+                const __m256i a0 = LOAD256(0, i), a1 = LOAD256(1, i);
+                const __m256i v0 = _mm256_unpacklo_epi8(a0, a1), v1 = _mm256_unpackhi_epi8(a0, a1);
+                STORE256(i, 0, _mm256_permute2x128_si256(v0, v1, 0x20));
+                STORE256(i, 1, _mm256_permute2x128_si256(v0, v1, 0x31));
+            }
+            break;
+
+        case 4:
+            for (uint64_t i = 0; i < n; i += 32) {
+                const __m256i a0 = LOAD256(0, i), a1 = LOAD256(1, i), a2 = LOAD256(2, i), a3 = LOAD256(3, i);
+                const __m256i t0 = _mm256_unpacklo_epi8(a0, a1), t1 = _mm256_unpackhi_epi8(a0, a1);
+                const __m256i t2 = _mm256_unpacklo_epi8(a2, a3), t3 = _mm256_unpackhi_epi8(a2, a3);
+                const __m256i v0 = _mm256_unpacklo_epi16(t0, t2), v1 = _mm256_unpackhi_epi16(t0, t2);
+                const __m256i v2 = _mm256_unpacklo_epi16(t1, t3), v3 = _mm256_unpackhi_epi16(t1, t3);
+                STORE256(i, 0, _mm256_permute2x128_si256(v0, v1, 0x20));
+                STORE256(i, 1, _mm256_permute2x128_si256(v2, v3, 0x20));
+                STORE256(i, 2, _mm256_permute2x128_si256(v0, v1, 0x31));
+                STORE256(i, 3, _mm256_permute2x128_si256(v2, v3, 0x31));
+            }
+            break;
+
+        case 8:
+            for (uint64_t i = 0; i < n; i += 32) {
+                __m256i a[8];
+                for (unsigned int j = 0; j < 8; ++j)
+                    a[j] = LOAD256(j, i);
+                __m256i p[4], q[4];
+                for (unsigned int j = 0; j < 4; ++j) {
+                    p[j] = _mm256_unpacklo_epi8(a[2 * j], a[2 * j + 1]);
+                    q[j] = _mm256_unpackhi_epi8(a[2 * j], a[2 * j + 1]);
+                }
+                const __m256i r0 = _mm256_unpacklo_epi16(p[0], p[1]), r1 = _mm256_unpackhi_epi16(p[0], p[1]);
+                const __m256i r2 = _mm256_unpacklo_epi16(p[2], p[3]), r3 = _mm256_unpackhi_epi16(p[2], p[3]);
+                const __m256i s0 = _mm256_unpacklo_epi16(q[0], q[1]), s1 = _mm256_unpackhi_epi16(q[0], q[1]);
+                const __m256i s2 = _mm256_unpacklo_epi16(q[2], q[3]), s3 = _mm256_unpackhi_epi16(q[2], q[3]);
+                const __m256i v[8] = {
+                        _mm256_unpacklo_epi32(r0, r2), _mm256_unpackhi_epi32(r0, r2),
+                        _mm256_unpacklo_epi32(r1, r3), _mm256_unpackhi_epi32(r1, r3),
+                        _mm256_unpacklo_epi32(s0, s2), _mm256_unpackhi_epi32(s0, s2),
+                        _mm256_unpacklo_epi32(s1, s3), _mm256_unpackhi_epi32(s1, s3)};
+                for (unsigned int k = 0; k < 4; ++k) {
+                    STORE256(i, k, _mm256_permute2x128_si256(v[2 * k], v[2 * k + 1], 0x20));
+                    STORE256(i, k + 4, _mm256_permute2x128_si256(v[2 * k], v[2 * k + 1], 0x31));
+                }
+            }
+            break;
+
+        default:
+            return 0;
+    }
+
+#undef LOAD256
+#undef STORE256
+
+    return n;
+}
+
+#endif // BYTE_KERNELS_X86
+
+/**
+ * @brief Reverse the HDF5 shuffle filter.
+ *
+ * @note The source size, not the number of elements, is passed because a
+ * shuffled buffer may hold a few bytes after the last whole element; those are
+ * copied as-is, matching the HDF5 library.
+ *
+ * @param dest Put the result here.
+ * @param src Shuffled data source
+ * @param src_size Number of bytes in both src and dest
+ * @param width Number of bytes in an element
+ * @param isa Use this instruction set, or the best one the CPU supports if it
+ * lacks this one.
+ */
+void unshuffle_bytes(char *dest, const char *src, uint64_t src_size, uint64_t width, kernel_isa isa)
+{
+    const uint64_t elems = width ? src_size / width : 0;
+
+    // Nothing to do for 1-byte elements, or "fractional" elements.
+    if (!(width > 1 && elems > 1)) {
+        memcpy(dest, src, src_size);
+        return;
+    }
+
+    uint64_t done = 0;
+#if BYTE_KERNELS_X86
+    switch (usable_isa(isa)) {
+        case kernel_avx2:
+            done = unshuffle_avx2(dest, src, elems, width);
+            break;
+        case kernel_sse2:
+            done = unshuffle_sse2(dest, src, elems, width);
+            break;
+        default:
+            break;
+    }
+#else
+    (void) isa;
+#endif
+
+    unshuffle_scalar(dest, src, elems, width, done);
+
+    const uint64_t leftover = src_size % width;
+    if (leftover > 0)
+        memcpy(dest + elems * width, src + elems * width, leftover);
+}
+
+void unshuffle_bytes(char *dest, const char *src, uint64_t src_size, uint64_t width)
+{
+    unshuffle_bytes(dest, src, src_size, width, best_kernel_isa());
+}
+
+// -- byte swap --
+
+template <typename T, T (*swap)(T)>
+static void byteswap_scalar_t(char *buf, uint64_t first, uint64_t num)
+{
+    // memcpy since the buffer might not be aligned for T.
+    for (uint64_t i = first; i < num; ++i) {
+        T v;
+        memcpy(&v, buf + i * sizeof(T), sizeof(T));
+        v = swap(v);
+        memcpy(buf + i * sizeof(T), &v, sizeof(T));
+    }
+}
+
+static uint16_t bswap16(uint16_t v) { return static_cast<uint16_t>((v << 8) | (v >> 8)); }
+static uint32_t bswap32(uint32_t v) { return (uint32_t(bswap16(uint16_t(v))) << 16) | bswap16(uint16_t(v >> 16)); }
+static uint64_t bswap64(uint64_t v) { return (uint64_t(bswap32(uint32_t(v))) << 32) | bswap32(uint32_t(v >> 32)); }
+
+static void byteswap_scalar(char *buf, uint64_t first, uint64_t num, unsigned int width)
+{
+    switch (width) {
+        case 2:
+            byteswap_scalar_t<uint16_t, bswap16>(buf, first, num);
+            break;
+        case 4:
+            byteswap_scalar_t<uint32_t, bswap32>(buf, first, num);
+            break;
+        case 8:
+            byteswap_scalar_t<uint64_t, bswap64>(buf, first, num);
+            break;
+        default:
+            for (uint64_t i = first; i < num; ++i) {
+                char *elem = buf + i * width;
+                for (unsigned int j = 0; j < width / 2; ++j)
+                    std::swap(elem[j], elem[width - j - 1]);
+            }
+            break;
+    }
+}
+
+#if BYTE_KERNELS_X86
+
+// SSE2 has no byte shuffle, so swap bytes within 16-bit words, then words
+// within 32-bit values, then those within 64-bit values.
+static uint64_t byteswap_sse2(char *buf, uint64_t num, unsigned int width)
+{
+    if (width != 2 && width != 4 && width != 8)
+        return 0;
+
+    const uint64_t per_vector = 16 / width;
+    const uint64_t n = num - num % per_vector;
+    for (uint64_t i = 0; i < n; i += per_vector) {
+        auto p = reinterpret_cast<__m128i *>(buf + i * width);
+        __m128i v = _mm_loadu_si128(p);
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if (width >= 4)
+            v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+        if (width == 8)
+            v = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(p, v);
+    }
+    return n;
+}
+
+AVX2_TARGET
+static uint64_t byteswap_avx2(char *buf, uint64_t num, unsigned int width)
+{
+    __m256i mask;
+    switch (width) {
+        case 2:
+            mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            break;
+        case 4:
+            mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            break;
+        case 8:
+            mask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+            break;
+        default:
+            return 0;
+    }
+
+    const uint64_t per_vector = 32 / width;
+    const uint64_t n = num - num % per_vector;
+    for (uint64_t i = 0; i < n; i += per_vector) {
+        auto p = reinterpret_cast<__m256i *>(buf + i * width);
+        _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask));
+    }
+    return n;
+}
+
+#endif // BYTE_KERNELS_X86
+
+/**
+ * @brief Reverse the byte order of each element of an array, in place.
+ *
+ * @param buf The array
+ * @param num Number of elements
+ * @param width Number of bytes in an element
+ * @param isa Use this instruction set, or the best one the CPU supports if it
+ * lacks this one.
+ */
+void byteswap_array(char *buf, uint64_t num, unsigned int width, kernel_isa isa)
+{
+    if (width < 2)
+        return;
+
+    uint64_t done = 0;
+#if BYTE_KERNELS_X86
+    switch (usable_isa(isa)) {
+        case kernel_avx2:
+            done = byteswap_avx2(buf, num, width);
+            break;
+        case kernel_sse2:
+            done = byteswap_sse2(buf, num, width);
+            break;
+        default:
+            break;
+    }
+#else
+    (void) isa;
+#endif
+
+    byteswap_scalar(buf, done, num, width);
+}
+
+void byteswap_array(char *buf, uint64_t num, unsigned int width)
+{
+    byteswap_array(buf, num, width, best_kernel_isa());
+}
+
+} // namespace bes
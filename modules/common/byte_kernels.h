@@ -0,0 +1,58 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _byte_kernels_h
+#define _byte_kernels_h
+
+#include <cstdint>
+
+/**
+ * Bulk byte-rearranging operations used when decoding array data: the inverse
+ * of the HDF5 shuffle filter and in-place byte swapping.
+ *
+ * On x86-64 the SSE2 or AVX2 version of each operation is chosen at run time
+ * using the capabilities of the CPU; elsewhere, and for element widths without
+ * a vector version, a scalar version is used. Every version produces the same
+ * bytes.
+ */
+namespace bes {
+
+/// The instruction sets the kernels can use, from least to most capable.
+enum kernel_isa {
+    kernel_scalar = 0,
+    kernel_sse2,
+    kernel_avx2
+};
+
+kernel_isa best_kernel_isa();
+const char *kernel_isa_name(kernel_isa isa);
+
+void unshuffle_bytes(char *dest, const char *src, uint64_t src_size, uint64_t width);
+void unshuffle_bytes(char *dest, const char *src, uint64_t src_size, uint64_t width, kernel_isa isa);
+
+void byteswap_array(char *buf, uint64_t num, unsigned int width);
+void byteswap_array(char *buf, uint64_t num, unsigned int width, kernel_isa isa);
+
+} // namespace bes
+
+#endif // _byte_kernels_h
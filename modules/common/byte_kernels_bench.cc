@@ -0,0 +1,94 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Micro-benchmark for the unshuffle and byte-swap kernels. Build it using
+// 'make byte_kernels_bench' in modules/common.
+//
+// Usage: byte_kernels_bench [MB per buffer (default 256)] [repetitions (default 5)]
+//
+// For each element width and each instruction set the CPU supports, print the
+// best throughput in GB/s (bytes of output per second).
+
+#include "config.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "byte_kernels.h"
+
+using namespace std;
+using namespace bes;
+
+template <typename F>
+static double best_gb_per_sec(uint64_t bytes, int reps, F kernel)
+{
+    double best = 0.0;
+    for (int r = 0; r < reps; ++r) {
+        auto start = chrono::steady_clock::now();
+        kernel();
+        const double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (secs > 0)
+            best = max(best, double(bytes) / secs / 1.0e9);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t mb = argc > 1 ? strtoull(argv[1], nullptr, 10) : 256;
+    const int reps = argc > 2 ? atoi(argv[2]) : 5;
+    const uint64_t size = mb * 1024 * 1024;
+
+    vector<char> src(size);
+    vector<char> dest(size);
+    for (uint64_t i = 0; i < size; ++i)
+        src[i] = static_cast<char>(i * 131 + (i >> 10));
+
+    cout << "Buffer: " << mb << " MB, repetitions: " << reps << ", best ISA: "
+         << kernel_isa_name(best_kernel_isa()) << endl;
+    cout << left << setw(10) << "kernel" << setw(8) << "width" << setw(8) << "isa" << "GB/s" << endl;
+
+    for (unsigned int width: {2, 4, 8}) {
+        for (int i = kernel_scalar; i <= best_kernel_isa(); ++i) {
+            const auto isa = static_cast<kernel_isa>(i);
+            const double unshuffle_rate = best_gb_per_sec(size, reps, [&]() {
+                unshuffle_bytes(dest.data(), src.data(), size, width, isa);
+            });
+            cout << left << setw(10) << "unshuffle" << setw(8) << width << setw(8) << kernel_isa_name(isa)
+                 << fixed << setprecision(2) << unshuffle_rate << endl;
+        }
+        for (int i = kernel_scalar; i <= best_kernel_isa(); ++i) {
+            const auto isa = static_cast<kernel_isa>(i);
+            const double swap_rate = best_gb_per_sec(size, reps, [&]() {
+                byteswap_array(dest.data(), size / width, width, isa);
+            });
+            cout << left << setw(10) << "byteswap" << setw(8) << width << setw(8) << kernel_isa_name(isa)
+                 << fixed << setprecision(2) << swap_rate << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,303 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+
+#include "HandleCache.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+namespace bes {
+
+class HandleCacheTest: public CppUnit::TestFixture {
+    // The handles closed by the cache, in order
+    vector<int> d_closed;
+
+    HandleCache<int>::close_function closer()
+    {
+        return [this](const int &handle) { d_closed.push_back(handle); return handle == 99 ? -1 : 0; };
+    }
+
+    bool was_closed(int handle) const
+    {
+        for (auto h: d_closed)
+            if (h == handle) return true;
+        return false;
+    }
+
+public:
+    HandleCacheTest() = default;
+    ~HandleCacheTest() override = default;
+
+    void setUp() override
+    {
+        d_closed.clear();
+    }
+
+    void reuse_test()
+    {
+        HandleCache<int> cache(closer(), 4);
+        int h = -1;
+        CPPUNIT_ASSERT(!cache.find("a.h5", 100, h));
+
+        cache.insert("a.h5", 100, 1);
+        CPPUNIT_ASSERT(cache.release(1));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+        CPPUNIT_ASSERT(d_closed.empty());
+
+        CPPUNIT_ASSERT(cache.find("a.h5", 100, h));
+        CPPUNIT_ASSERT_EQUAL(1, h);
+        CPPUNIT_ASSERT(cache.release(1));
+        CPPUNIT_ASSERT(d_closed.empty());
+    }
+
+    void release_unknown_test()
+    {
+        HandleCache<int> cache(closer(), 4);
+        int status = 42;
+        CPPUNIT_ASSERT(!cache.release(7, &status));
+        CPPUNIT_ASSERT_EQUAL(42, status);
+        CPPUNIT_ASSERT(d_closed.empty());
+    }
+
+    // The least recently used handles are closed first.
+    void lru_test()
+    {
+        HandleCache<int> cache(closer(), 2);
+        cache.insert("a", 100, 1);
+        cache.release(1);
+        cache.insert("b", 100, 2);
+        cache.release(2);
+
+        int h;
+        CPPUNIT_ASSERT(cache.find("a", 100, h));
+        cache.release(h);
+
+        cache.insert("c", 100, 3);
+        cache.release(3);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), cache.size());
+        CPPUNIT_ASSERT_EQUAL(size_t(1), d_closed.size());
+        CPPUNIT_ASSERT_EQUAL(2, d_closed[0]);
+        CPPUNIT_ASSERT(cache.contains(1));
+        CPPUNIT_ASSERT(cache.contains(3));
+    }
+
+    // A handle in use is not closed, even when the cache is full.
+    void in_use_test()
+    {
+        HandleCache<int> cache(closer(), 1);
+        cache.insert("a", 100, 1);
+        cache.insert("b", 100, 2);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), cache.size());
+        CPPUNIT_ASSERT(d_closed.empty());
+
+        // Two readers use 'b'
+        int h;
+        CPPUNIT_ASSERT(cache.find("b", 100, h));
+        cache.release(2);
+        CPPUNIT_ASSERT(d_closed.empty());
+
+        cache.release(1);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+        CPPUNIT_ASSERT(was_closed(1));
+
+        cache.release(2);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+        CPPUNIT_ASSERT(!was_closed(2));
+    }
+
+    // With no entries, handles are closed when they are released.
+    void disabled_test()
+    {
+        HandleCache<int> cache(closer(), 0);
+        CPPUNIT_ASSERT(!cache.enabled());
+        cache.insert("a", 100, 1);
+        CPPUNIT_ASSERT(d_closed.empty());
+        cache.release(1);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+        CPPUNIT_ASSERT(was_closed(1));
+    }
+
+    void changed_file_test()
+    {
+        HandleCache<int> cache(closer(), 4);
+        cache.insert("a", 100, 1);
+        cache.release(1);
+
+        int h;
+        CPPUNIT_ASSERT(!cache.find("a", 200, h));
+        CPPUNIT_ASSERT(was_closed(1));
+        CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+    }
+
+    // A reader using the handle of a changed file keeps it until it releases it.
+    void changed_file_in_use_test()
+    {
+        HandleCache<int> cache(closer(), 4);
+        cache.insert("a", 100, 99);
+
+        int h;
+        CPPUNIT_ASSERT(!cache.find("a", 200, h));
+        CPPUNIT_ASSERT(d_closed.empty());
+
+        cache.insert("a", 200, 2);
+        cache.release(2);
+        CPPUNIT_ASSERT(cache.find("a", 200, h));
+        CPPUNIT_ASSERT_EQUAL(2, h);
+        cache.release(2);
+
+        // The close function's status is returned.
+        int status = 0;
+        CPPUNIT_ASSERT(cache.release(99, &status));
+        CPPUNIT_ASSERT(was_closed(99));
+        CPPUNIT_ASSERT_EQUAL(-1, status);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+    }
+
+    // A child keeps its parent open and is closed first.
+    void child_test()
+    {
+        HandleCache<int> cache(closer(), 1);
+        cache.insert("file", 100, 1);
+        CPPUNIT_ASSERT(cache.insert_child("file/grid", 10, 1));
+        cache.release(1);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), cache.size());
+
+        int h;
+        CPPUNIT_ASSERT(cache.find_child("file/grid", h));
+        CPPUNIT_ASSERT_EQUAL(10, h);
+        cache.release(10);
+        cache.release(10);
+
+        // 'file' is the least recently used but it has a child.
+        CPPUNIT_ASSERT_EQUAL(size_t(1), d_closed.size());
+        CPPUNIT_ASSERT_EQUAL(10, d_closed[0]);
+        CPPUNIT_ASSERT(cache.contains(1));
+
+        CPPUNIT_ASSERT(!cache.insert_child("other/grid", 11, 5));
+    }
+
+    // When a file changes, its children are not reused either.
+    void changed_parent_test()
+    {
+        HandleCache<int> cache(closer(), 4);
+        cache.insert("file", 100, 1);
+        cache.insert_child("file/grid", 10, 1);
+        cache.release(1);
+
+        int h;
+        CPPUNIT_ASSERT(!cache.find("file", 200, h));
+        CPPUNIT_ASSERT(!cache.find_child("file/grid", h));
+        CPPUNIT_ASSERT(d_closed.empty());
+
+        cache.release(10);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), d_closed.size());
+        CPPUNIT_ASSERT_EQUAL(10, d_closed[0]);
+        CPPUNIT_ASSERT_EQUAL(1, d_closed[1]);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+    }
+
+    // Handles a failed read() did not release are freed at the end of the request.
+    void end_request_test()
+    {
+        HandleCache<int> cache(closer(), 1);
+        cache.insert("a", 100, 1);
+        cache.insert("b", 100, 2);
+        cache.insert("c", 100, 3);
+        int h;
+        CPPUNIT_ASSERT(!cache.find("c", 200, h));
+        CPPUNIT_ASSERT(d_closed.empty());
+
+        cache.end_request();
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+        CPPUNIT_ASSERT(was_closed(3));
+        CPPUNIT_ASSERT(was_closed(1));
+        CPPUNIT_ASSERT(cache.contains(2));
+    }
+
+    void clear_test()
+    {
+        HandleCache<int> cache(closer(), 4);
+        cache.insert("file", 100, 1);
+        cache.insert_child("file/grid", 10, 1);
+        cache.insert("other", 100, 2);
+
+        cache.clear();
+        CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+        CPPUNIT_ASSERT_EQUAL(size_t(3), d_closed.size());
+        CPPUNIT_ASSERT_EQUAL(2, d_closed[0]);
+        CPPUNIT_ASSERT_EQUAL(10, d_closed[1]);
+        CPPUNIT_ASSERT_EQUAL(1, d_closed[2]);
+    }
+
+    void destructor_test()
+    {
+        {
+            HandleCache<int> cache(closer(), 4);
+            cache.insert("a", 100, 1);
+            cache.release(1);
+        }
+        CPPUNIT_ASSERT(was_closed(1));
+    }
+
+    void file_mtime_test()
+    {
+        time_t mtime = 0;
+        CPPUNIT_ASSERT(HandleCache<int>::file_mtime(string(TEST_SRC_DIR) + "/HandleCacheTest.cc", mtime));
+        CPPUNIT_ASSERT(mtime > 0);
+        CPPUNIT_ASSERT(!HandleCache<int>::file_mtime(string(TEST_SRC_DIR) + "/no_such_file", mtime));
+    }
+
+    CPPUNIT_TEST_SUITE( HandleCacheTest );
+
+    CPPUNIT_TEST(reuse_test);
+    CPPUNIT_TEST(release_unknown_test);
+    CPPUNIT_TEST(lru_test);
+    CPPUNIT_TEST(in_use_test);
+    CPPUNIT_TEST(disabled_test);
+    CPPUNIT_TEST(changed_file_test);
+    CPPUNIT_TEST(changed_file_in_use_test);
+    CPPUNIT_TEST(child_test);
+    CPPUNIT_TEST(changed_parent_test);
+    CPPUNIT_TEST(end_request_test);
+    CPPUNIT_TEST(clear_test);
+    CPPUNIT_TEST(destructor_test);
+    CPPUNIT_TEST(file_mtime_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(HandleCacheTest);
+
+} // namespace bes
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<bes::HandleCacheTest>(argc, argv, "cerr,cache") ? 0 : 1;
+}
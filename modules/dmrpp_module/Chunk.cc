@@ -25,8 +25,7 @@
 
 #include <sstream>
 #include <cstring>
-
-#include <zlib.h>
+#include <cstdlib>
 
 #include <BESDebug.h>
 #include <BESLog.h>
@@ -43,11 +42,14 @@
 #include "Chunk.h"
 #include "CurlUtils.h"
 #include "CurlHandlePool.h"
+#include "ChunkFilters.h"
+#include "inflate_util.h"
 #include "EffectiveUrlCache.h"
 #include "DmrppRequestHandler.h"
 #include "DmrppNames.h"
 #include "byteswap_compat.h"
 #include "float_byteswap.h"
+#include "byte_kernels.h"
 
 using namespace std;
 using http::EffectiveUrlCache;
@@ -79,8 +81,16 @@ size_t chunk_header_callback(char *buffer, size_t /*size*/, size_t nitems, void
     // -2 strips of the CRLF at the end of the header
     string header(buffer, buffer + nitems - 2);
 
+    // Record the status of each response; libcurl sends the status line of every
+    // response, including redirects, to this callback.
+    if (header.compare(0, 5, "HTTP/") == 0) {
+        auto c_ptr = reinterpret_cast<Chunk *>(data);
+        auto code_start = header.find(' ');
+        if (code_start != string::npos)
+            c_ptr->set_response_code(strtol(header.c_str() + code_start + 1, nullptr, 10));
+    }
     // Look for the content type header and store its value in the Chunk
-    if (header.find("Content-Type") != string::npos) {
+    else if (header.find("Content-Type") != string::npos) {
         // Header format 'Content-Type: <value>'
         auto c_ptr = reinterpret_cast<Chunk *>(data);
         c_ptr->set_response_content_type(header.substr(header.find_last_of(' ') + 1));
@@ -199,131 +209,20 @@ size_t chunk_write_data(void *buffer, size_t size, size_t nmemb, void *data) {
 
     memcpy(chunk->get_rbuf() + bytes_read, buffer, nbytes);
     chunk->set_bytes_read(bytes_read + nbytes);
+
+    if (chunk->get_write_callback())
+        chunk->get_write_callback()(bytes_read + nbytes);
     
     BESDEBUG(MODULE, prolog << "END" << endl);
 
     return nbytes;
 }
 
-/**
- * @brief Throws an exception if the information sent to the inflate function is invalid.
- *
- * @param destp The destination buffer
- * @param dest_len The number of bytes to inflate into
- * @param src The source buffer
- * @param src_len The number of bytes to inflate
- */
-static void inflate_sanity_check(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len) {
-    if (src_len == 0) {
-        string msg = prolog + "ERROR! The number of bytes to inflate is zero.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-    if (dest_len == 0) {
-        string msg = prolog + "ERROR! The number of bytes to inflate into is zero.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-    if (!destp || !*destp) {
-        string msg = prolog + "ERROR! The destination buffer is NULL.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-    if (!src) {
-        string msg = prolog + "ERROR! The source buffer is NULL.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-}
-
-/**
- * @brief Deflate data. This is the zlib algorithm.
- *
- * @note Stolen from the HDF5 library and hacked to fit.
- *
- * @param destp A value-result parameter (pointer to a pointer) of the 'inflated' data 
- * @param dest_len Size of the destination buffer
- * @param src Compressed data
- * @param src_len Size of the compressed data
- * @return The number of bytes of the inflated data
- */
-unsigned long long inflate(char **destp, unsigned long long dest_len, char *src, unsigned long long src_len) {
-    inflate_sanity_check(destp, dest_len, src, src_len);
-
-    /* Input; uncompress */
-    z_stream z_strm; /* zlib parameters */
-
-    /* Set the decompression parameters */
-    memset(&z_strm, 0, sizeof(z_strm));
-    z_strm.next_in = (Bytef *) src;
-    z_strm.avail_in = src_len;
-    z_strm.next_out = (Bytef *) (*destp);
-    z_strm.avail_out = dest_len;
-
-    size_t nalloc = dest_len;
-
-    char *outbuf = *destp;
-
-    /* Initialize the decompression routines */
-    if (Z_OK != inflateInit(&z_strm))
-        throw BESError("Failed to initialize inflate software.", BES_INTERNAL_ERROR, __FILE__, __LINE__);
-
-    /* Loop to uncompress the buffer */
-    int status = Z_OK;
-    do {
-        /* Uncompress some data */
-        status = inflate(&z_strm, Z_SYNC_FLUSH);
-
-        /* Check if we are done decompressing data */
-        if (Z_STREAM_END == status) break; /*done*/
-
-        /* Check for error */
-        if (Z_OK != status) {
-            stringstream err_msg;
-            err_msg << "Failed to inflate data chunk.";
-            char const *err_msg_cstr = z_strm.msg;
-            if(err_msg_cstr)
-                err_msg << " zlib message: " << err_msg_cstr;
-            (void) inflateEnd(&z_strm);
-            throw BESError(err_msg.str(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
-        }
-        else {
-            // If we're not done and just ran out of buffer space, we need to extend the buffer.
-            // We may encounter this case when the deflate filter is used twice. KY 2022-08-03
-            if (0 == z_strm.avail_out) {
-
-                /* Allocate a buffer twice as big */
-                size_t outbuf_size = nalloc;
-                nalloc *= 2;
-                char *new_outbuf = new char[nalloc];
-                memcpy((void*)new_outbuf,(void*)outbuf,outbuf_size);
-                delete[] outbuf;
-                outbuf = new_outbuf;
-
-                /* Update pointers to buffer for next set of uncompressed data */
-                z_strm.next_out = (unsigned char*) outbuf + z_strm.total_out;
-                z_strm.avail_out = (uInt) (nalloc - z_strm.total_out);
-
-            } /* end if */
-        } /* end else */
-    } while (true /* status == Z_OK */);    // Exit via the break statement after the call to inflate(). jhrg 11/8/21
-
-    *destp = outbuf;
-    outbuf = nullptr;
-    /* Finish decompressing the stream */
-    (void) inflateEnd(&z_strm);
-
-    return z_strm.total_out;
-}
-
-// #define this to enable the duff's device loop unrolling code.
-// jhrg 1/19/17
-#define DUFFS_DEVICE
-
 /**
  * @brief Un-shuffle data.
  *
- * @note Stolen from HDF5 and hacked to fit
+ * @note Stolen from HDF5 and hacked to fit. The work is done by the vectorized
+ * kernel in modules/common, which falls back to scalar code when needed.
  *
  * @note We use src size as a param because the buffer might be larger than
  * elems * width (e.g., 1020 byte buffer will hold 127 doubles with 4 extra).
@@ -342,72 +241,7 @@ unsigned long long inflate(char **destp, unsigned long long dest_len, char *src,
  * @param width Number of bytes in an element
  */
 void unshuffle(char *dest, const char *src, unsigned long long src_size, unsigned long long width) {
-    unsigned long long elems = src_size / width;  // int division rounds down
-
-    /* Don't do anything for 1-byte elements, or "fractional" elements */
-    if (!(width > 1 && elems > 1)) {
-        memcpy(dest, const_cast<char *>(src), src_size);
-    }
-    else {
-        /* Get the pointer to the source buffer (Alias for source buffer) */
-        char *_src = const_cast<char *>(src);
-        char *_dest = 0;   // Alias for destination buffer
-
-        /* Input; unshuffle */
-        for (unsigned int i = 0; i < width; i++) {
-            _dest = dest + i;
-#ifndef DUFFS_DEVICE
-            size_t j = elems;
-            while(j > 0) {
-                *_dest = *_src++;
-                _dest += width;
-
-                j--;
-            }
-#else /* DUFFS_DEVICE */
-            {
-                size_t duffs_index = (elems + 7) / 8;   /* Counting index for Duff's device */
-                switch (elems % 8) {
-                    default:
-                        throw BESError("Internal error in unshuffle().", BES_INTERNAL_ERROR, __FILE__, __LINE__);
-
-                    case 0:
-                        do {
-                            // This macro saves repeating the same line 8 times
-#define DUFF_GUTS       *_dest = *_src++; _dest += width;
-
-                            DUFF_GUTS
-                            case 7:
-                            DUFF_GUTS
-                            case 6:
-                            DUFF_GUTS
-                            case 5:
-                            DUFF_GUTS
-                            case 4:
-                            DUFF_GUTS
-                            case 3:
-                            DUFF_GUTS
-                            case 2:
-                            DUFF_GUTS
-                            case 1:
-                            DUFF_GUTS
-                        } while (--duffs_index > 0);
-                } /* end switch */
-            } /* end block */
-#endif /* DUFFS_DEVICE */
-
-        } /* end for i = 0 to width*/
-
-        /* Compute the leftover bytes if there are any */
-        size_t leftover = src_size % width;
-
-        /* Add leftover to the end of data */
-        if (leftover > 0) {
-            /* Adjust back to end of shuffled bytes */
-            _dest -= (width - 1); /*lint !e794 _dest is initialized */
-            memcpy((void *) _dest, (void *) _src, leftover);
-        }
-    } /* end if width and elems both > 1 */
+    bes::unshuffle_bytes(dest, src, src_size, width);
 }
 
 /// Stolen from our friends at Stack Overflow and modified for our use.
@@ -706,7 +540,7 @@ void Chunk::filter_chunk(const string &filters, unsigned long long chunk_size, u
 
             if (num_deflate > 1 && !ignore_rest_deflate) {
 
-                dest_deflate = new char[chunk_size];
+                dest_deflate = ChunkBufferPool::ThePool()->allocate(chunk_size);
                 try {
                     destp = &dest_deflate;
                     if (deflate_index == 0) {
@@ -725,7 +559,7 @@ void Chunk::filter_chunk(const string &filters, unsigned long long chunk_size, u
                         delete[] tmp_buf;
 #endif
                         out_buf_size = inflate(destp, chunk_size, tmp_dest, in_buf_size);
-                        delete[] tmp_dest;
+                        ChunkBufferPool::ThePool()->release(tmp_dest);
                         tmp_dest = *destp;
 
                     }
@@ -747,8 +581,8 @@ void Chunk::filter_chunk(const string &filters, unsigned long long chunk_size, u
 
                 }
                 catch (...) {
-                    delete[] dest_deflate;
-                    delete[] tmp_dest;
+                    ChunkBufferPool::ThePool()->release(dest_deflate);
+                    ChunkBufferPool::ThePool()->release(tmp_dest);
                     throw;
                 }
  
@@ -757,7 +591,7 @@ void Chunk::filter_chunk(const string &filters, unsigned long long chunk_size, u
             else if(num_deflate == 1) {
                 // The following is the same code as before. We need to use the double pointer
                 // to pass the buffer. KY 2022-08-07
-                dest_deflate = new char[chunk_size];
+                dest_deflate = ChunkBufferPool::ThePool()->allocate(chunk_size);
                 destp = &dest_deflate;
                 try {
                     out_buf_size = inflate(destp, chunk_size, get_rbuf(), get_rbuf_size());
@@ -773,14 +607,14 @@ void Chunk::filter_chunk(const string &filters, unsigned long long chunk_size, u
 #endif
                 }
                 catch (...) {
-                    delete[] dest_deflate;
+                    ChunkBufferPool::ThePool()->release(dest_deflate);
                     throw;
                 }
             }
         }// end filter is deflate
         else if (filter == "shuffle"){
             // The internal buffer is chunk's full size at this point.
-            char *dest = new char[get_rbuf_size()];
+            char *dest = ChunkBufferPool::ThePool()->allocate(get_rbuf_size());
             try {
                 unshuffle(dest, get_rbuf(), get_rbuf_size(), elem_width);
 #if DMRPP_USE_SUPER_CHUNKS
@@ -790,7 +624,7 @@ void Chunk::filter_chunk(const string &filters, unsigned long long chunk_size, u
 #endif
             }
             catch (...) {
-                delete[] dest;
+                ChunkBufferPool::ThePool()->release(dest);
                 throw;
             }
         } //end filter is shuffle
@@ -830,10 +664,82 @@ void Chunk::filter_chunk(const string &filters, unsigned long long chunk_size, u
                                        __FILE__, __LINE__);
             }
         } // end filter is fletcher32
+        else if (!filter.empty()) {
+            // Every other filter is decoded by a function found using its name. The
+            // DMR++ entry may include the filter's parameters, e.g., 'szip(141,32,32,256)'.
+            const filter_spec spec = parse_filter_spec(filter);
+            const filter_decoder *decoder = ChunkFilters::TheFilters()->find_decoder(spec.name);
+            if (!decoder) {
+                throw BESInternalError(string("The DMR++ handler cannot decode data that use the '")
+                                       .append(spec.name).append("' filter."), __FILE__, __LINE__);
+            }
+
+            char *dest = ChunkBufferPool::ThePool()->allocate(chunk_size);
+            try {
+                unsigned long long decoded_size = (*decoder)(&dest, chunk_size, get_rbuf(), get_rbuf_size(),
+                                                             elem_width, spec.params);
+                BESDEBUG(MODULE, prolog << spec.name << " decoded " << get_rbuf_size() << " bytes to "
+                                        << decoded_size << endl);
+                set_read_buffer(dest, decoded_size, decoded_size, true);
+            }
+            catch (...) {
+                ChunkBufferPool::ThePool()->release(dest);
+                throw;
+            }
+        }
     } // end for loop
     d_is_inflated = true;
 }
 
+/**
+ * @brief Decode the chunk straight into its place in the Array's value buffer.
+ *
+ * This is the fast path of filter_chunk() for the common deflate and
+ * shuffle/deflate filter pipelines. The decoded values are written to
+ * \arg dest, which must have room for the whole chunk, and not to a new read
+ * buffer, so the values are not copied again and no decoded copy of the chunk
+ * is kept. The chunk's read buffer is left as it was.
+ *
+ * @param dest Write the decoded chunk here
+ * @param filters The filters, as in filter_chunk()
+ * @param chunk_size The size of the chunk, in elements
+ * @param elem_width The number of bytes per element
+ * @return True if the chunk was decoded into dest. False if these filters are
+ * not handled here or the decoded chunk is not exactly chunk_size elements;
+ * then dest may hold junk and the caller should use filter_chunk().
+ */
+bool Chunk::filter_chunk_into(char *dest, const string &filters, unsigned long long chunk_size,
+                              unsigned long long elem_width) {
+    if (d_is_inflated || !dest)
+        return false;
+
+    const vector<string> filter_array = BESUtil::split(filters, ' ');
+    bool shuffled = false;
+    if (filter_array.size() == 2 && filter_array[0] == "shuffle" && filter_array[1] == "deflate")
+        shuffled = true;
+    else if (!(filter_array.size() == 1 && filter_array[0] == "deflate"))
+        return false;
+
+    chunk_size *= elem_width;
+
+    if (!shuffled)
+        return inflate_into(dest, chunk_size, get_rbuf(), get_rbuf_size()) == chunk_size;
+
+    // The unshuffle cannot be done in place, but its output can go to dest.
+    char *inflated = ChunkBufferPool::ThePool()->allocate(chunk_size);
+    try {
+        const bool ok = inflate(&inflated, chunk_size, get_rbuf(), get_rbuf_size()) == chunk_size;
+        if (ok)
+            unshuffle(dest, inflated, chunk_size, elem_width);
+        ChunkBufferPool::ThePool()->release(inflated);
+        return ok;
+    }
+    catch (...) {
+        ChunkBufferPool::ThePool()->release(inflated);
+        throw;
+    }
+}
+
 unsigned int Chunk::obtain_compound_udf_type_size() const {
 
     unsigned int ret_value = 0;
@@ -28,6 +28,7 @@
 #include <utility>
 #include <vector>
 #include <memory>
+#include <functional>
 
 // BES
 #include "url_impl.h"
@@ -35,6 +36,8 @@
 // libdap4
 #include <libdap/util.h>
 
+#include "ChunkBufferPool.h"
+
 
 // This is used to track access to 'cloudydap' accesses in the S3 logs
 // by adding a query string that will show up in those logs. This is
@@ -99,8 +102,8 @@ private:
      *  d_read_buffer_is_mine
      *
      *  This flag controls if the currently
-     *  held read buffer memory is released (via a call to 'delete[]')
-     *  when an instance is destroyed or when Chunk::set_rbuf_to_size()
+     *  held read buffer memory is released (returned to the
+     *  ChunkBufferPool) when an instance is destroyed or when Chunk::set_rbuf_to_size()
      *  or Chunk::set_read_buffer() are invoked. This way, memory
      *  allocated elsewhere can be assigned to a chunk and the chunk
      *  can be used to process the bytes (inflate etc) and the assigned
@@ -108,7 +111,7 @@ private:
      *  when when the chunk is inflating data - if the result won't fit
      *  in the current buffer and the chunk doesn't own it, then the
      *  chunk just allocates new memory for the result and installs it,
-     *  dropping the old pointer (no delete[]) and taking possession of
+     *  dropping the old pointer (no release) and taking possession of
      *  the new memory so it is correctly released as described here.
      */
     bool d_read_buffer_is_mine {true};
@@ -118,6 +121,11 @@ private:
     bool d_is_read {false};
     bool d_is_inflated {false};
     std::string d_response_content_type;
+    long d_response_code {0};
+
+    // If set, called by chunk_write_data() with the new value of d_bytes_read
+    // each time data are written to the read buffer. Not copied.
+    std::function<void(unsigned long long)> d_write_callback;
 
     friend class ChunkTest;
     friend class DmrppCommonTest;
@@ -308,7 +316,7 @@ public:
     virtual ~Chunk()
     {
         if(d_read_buffer_is_mine)
-            delete[] d_read_buffer;
+            ChunkBufferPool::ThePool()->release(d_read_buffer);
         d_read_buffer = nullptr;
     }
 
@@ -331,6 +339,23 @@ public:
     /// @brief Set the response type of the last response
     void  set_response_content_type(const std::string &ct) { d_response_content_type = ct; }
 
+    /// @brief Get the HTTP status of the last response; zero for protocols without one (e.g., file://)
+    virtual long get_response_code() const { return d_response_code; }
+
+    /// @brief Set the HTTP status of the last response
+    void set_response_code(long code) { d_response_code = code; }
+
+    /**
+     * @brief Register a function to be called as data for this chunk arrive.
+     *
+     * The function is passed the number of bytes in the read buffer and runs
+     * on the thread doing the transfer, from inside the libcurl write callback,
+     * so it should be quick. SuperChunk uses this to hand off its child chunks
+     * as soon as their bytes are in.
+     */
+    void set_write_callback(std::function<void(unsigned long long)> cb) { d_write_callback = std::move(cb); }
+    const std::function<void(unsigned long long)> &get_write_callback() const { return d_write_callback; }
+
     /// @return Get the chunk byte order
     virtual std::string get_byte_order() { return d_byte_order; }
 
@@ -408,7 +433,7 @@ public:
      *
      * The class maintains an internal flag, d_read_buffer_is_mine, which
      * controls if the currently held read buffer memory is released
-     * (via a call to 'delete[]') when an this method is invoked.
+     * (returned to the ChunkBufferPool) when an this method is invoked.
      *
      * If the CHunk owns the read buffer, then calling this method
      * will release any previously allocated read buffer memory and then
@@ -418,8 +443,8 @@ public:
     virtual void set_rbuf_to_size()
     {
         if(d_read_buffer_is_mine)
-            delete[] d_read_buffer;
-        d_read_buffer = new char[d_size];
+            ChunkBufferPool::ThePool()->release(d_read_buffer);
+        d_read_buffer = ChunkBufferPool::ThePool()->allocate(d_size);
         d_read_buffer_size = d_size;
         d_read_buffer_is_mine = true;
         set_bytes_read(0);
@@ -439,14 +464,15 @@ public:
      * @param buf_size The size of the passed buffer.
      * @param bytes_read The number of bytes that have been read into buf. In practice
      * this is the offset in buf at which new bytes should be added, (default: 0)
-     * @param assume_ownership If true, then the memory pointed to by buf will be deleted (using delete[])
-     * when the Chunk object's destructor is called. If false then the Chunk's destructor will not attempt to
+     * @param assume_ownership If true, then the memory pointed to by buf, which must have been
+     * allocated by the ChunkBufferPool, will be released to the pool when the Chunk object's
+     * destructor is called. If false then the Chunk's destructor will not attempt to
      * free/delete the memory pointed to by buf. (default: true)
      */
      void set_read_buffer(char *buf, unsigned long long buf_size, unsigned long long bytes_read = 0,
                           bool assume_ownership = true ) {
         if(d_read_buffer_is_mine)
-            delete[] d_read_buffer;
+            ChunkBufferPool::ThePool()->release(d_read_buffer);
         d_read_buffer_is_mine = assume_ownership;
         d_read_buffer = buf;
         d_read_buffer_size = buf_size;
@@ -488,6 +514,8 @@ public:
     virtual void load_fill_values();
 
     virtual void filter_chunk(const std::string &filters, unsigned long long chunk_size, unsigned long long elem_width);
+    virtual bool filter_chunk_into(char *dest, const std::string &filters, unsigned long long chunk_size,
+                                   unsigned long long elem_width);
 
     virtual bool get_is_read() { return d_is_read; }
     virtual void set_is_read(bool state) { d_is_read = state; }
@@ -0,0 +1,328 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include "BESDebug.h"
+#include "BESLog.h"
+#include "BESInternalError.h"
+
+#include "ChunkBufferPool.h"
+#include "DmrppRequestHandler.h"
+#include "DmrppNames.h"
+
+using namespace std;
+
+#define prolog std::string("ChunkBufferPool::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+namespace {
+
+// Every buffer starts with one of these. Its size keeps the caller's part of
+// the buffer aligned as malloc() would align it.
+struct alignas(16) buffer_header {
+    uint16_t magic;
+    int16_t size_class;             // -1 for buffers too large to pool
+    int32_t owner;                  // pid of the process whose pool made the buffer
+    unsigned long long capacity;    // bytes the caller may use
+};
+
+const uint16_t BUFFER_MAGIC = 0xd3b0;
+const int16_t UNPOOLED = -1;
+
+/// @return The buffer's header, or null if the buffer was not made by a ChunkBufferPool.
+buffer_header *header_of(const char *buf)
+{
+    auto header = reinterpret_cast<buffer_header *>(const_cast<char *>(buf) - sizeof(buffer_header));
+    return header->magic == BUFFER_MAGIC ? header : nullptr;
+}
+
+char *new_buffer(unsigned long long capacity, int16_t size_class)
+{
+    auto header = static_cast<buffer_header *>(malloc(sizeof(buffer_header) + capacity));
+    if (!header)
+        throw std::bad_alloc();
+    header->magic = BUFFER_MAGIC;
+    header->size_class = size_class;
+    header->owner = static_cast<int32_t>(getpid());
+    header->capacity = capacity;
+    return reinterpret_cast<char *>(header + 1);
+}
+
+void free_buffer(char *buf)
+{
+    auto header = reinterpret_cast<buffer_header *>(buf) - 1;
+    header->magic = 0;
+    free(header);
+}
+
+} // namespace
+
+constexpr unsigned long long ChunkBufferPool::MIN_CLASS_SIZE;
+constexpr unsigned long long ChunkBufferPool::MAX_CLASS_SIZE;
+
+/**
+ * @brief Make a pool.
+ * @param max_cached_bytes Keep at most this many bytes of released buffers on
+ * the free lists. Zero means buffers are always freed when released.
+ */
+ChunkBufferPool::ChunkBufferPool(unsigned long long max_cached_bytes) :
+        d_max_cached_bytes(max_cached_bytes), d_pid(getpid())
+{
+    // MIN_CLASS_SIZE, then four classes per power of two up to MAX_CLASS_SIZE.
+    for (unsigned long long base = MIN_CLASS_SIZE; base < MAX_CLASS_SIZE; base *= 2) {
+        for (unsigned long long quarter = 0; quarter < 4; ++quarter)
+            d_class_sizes.push_back(base + quarter * base / 4);
+    }
+    d_class_sizes.push_back(MAX_CLASS_SIZE);
+
+    d_free_lists = vector<free_list>(d_class_sizes.size());
+}
+
+ChunkBufferPool::~ChunkBufferPool()
+{
+    trim();
+}
+
+/**
+ * @brief Get the pool for this process.
+ *
+ * The pool is made the first time this is called, using the DMR++ handler's
+ * configuration for the number of bytes it may cache. As with the thread
+ * pool, a pool made by the parent of this process is abandoned (its locks
+ * may have been held by a thread that does not exist here) and a new one is
+ * made. Buffers allocated by the old pool can still be released to the new
+ * one.
+ *
+ * @return A pointer to the process-wide pool.
+ */
+ChunkBufferPool *ChunkBufferPool::ThePool()
+{
+    static std::mutex instance_mtx;
+    static std::unique_ptr<ChunkBufferPool> instance;
+
+    std::lock_guard<std::mutex> lck(instance_mtx);
+    if (!instance || instance->d_pid != getpid()) {
+        if (instance)
+            (void) instance.release();
+
+        instance.reset(new ChunkBufferPool(DmrppRequestHandler::d_buffer_pool_max_bytes));
+        BESDEBUG(BUFFER_POOL, prolog << "Made a new pool. max cached bytes: " << instance->max_cached_bytes() << endl);
+    }
+
+    return instance.get();
+}
+
+/// @return The index of the smallest class that holds size bytes, or -1.
+int ChunkBufferPool::size_class(unsigned long long size) const
+{
+    auto it = lower_bound(d_class_sizes.begin(), d_class_sizes.end(), size);
+    return it == d_class_sizes.end() ? UNPOOLED : static_cast<int>(it - d_class_sizes.begin());
+}
+
+void ChunkBufferPool::add_in_use(unsigned long long size)
+{
+    const auto in_use = d_bytes_in_use.fetch_add(size) + size;
+    auto peak = d_peak_bytes_in_use.load();
+    while (in_use > peak && !d_peak_bytes_in_use.compare_exchange_weak(peak, in_use)) {
+        // peak is updated by compare_exchange_weak() when it fails
+    }
+}
+
+/**
+ * @brief Get a buffer of at least size bytes.
+ *
+ * The contents of the buffer are not initialized. Return it using release().
+ *
+ * @param size The number of bytes needed. Zero is treated as one.
+ * @return The buffer
+ * @exception std::bad_alloc if memory cannot be allocated.
+ */
+char *ChunkBufferPool::allocate(unsigned long long size)
+{
+    d_allocations++;
+
+    const int sc = size_class(size ? size : 1);
+    if (sc == UNPOOLED) {
+        d_unpooled++;
+        d_misses++;
+        add_in_use(size);
+        return new_buffer(size, UNPOOLED);
+    }
+
+    const auto capacity = d_class_sizes[sc];
+    char *buf = nullptr;
+    {
+        auto &fl = d_free_lists[sc];
+        std::lock_guard<std::mutex> lck(fl.mtx);
+        if (!fl.buffers.empty()) {
+            buf = fl.buffers.back();
+            fl.buffers.pop_back();
+        }
+    }
+
+    if (buf) {
+        d_hits++;
+        d_bytes_cached -= capacity;
+    }
+    else {
+        d_misses++;
+        buf = new_buffer(capacity, static_cast<int16_t>(sc));
+    }
+
+    add_in_use(capacity);
+    return buf;
+}
+
+/**
+ * @brief Return a buffer to the pool.
+ *
+ * This is called from the Chunk and SuperChunk destructors, so it does not
+ * throw. A buffer that was not made by allocate() is logged and leaked; it
+ * cannot be freed safely.
+ *
+ * Buffers made by the pool of another process (the parent of a besd) are
+ * freed without changing this pool's counters, which never counted them.
+ *
+ * @param buf A buffer from allocate(); may be null, in which case this does nothing.
+ */
+void ChunkBufferPool::release(char *buf) noexcept
+{
+    if (!buf)
+        return;
+
+    const auto header = header_of(buf);
+    if (!header) {
+        try {
+            ERROR_LOG(prolog + "The buffer was not allocated by the ChunkBufferPool; it will not be freed.");
+        }
+        catch (...) {
+            // The log is not available; leak the buffer anyway.
+        }
+        return;
+    }
+
+    const auto capacity = header->capacity;
+    const int sc = header->size_class;
+
+    d_releases++;
+    if (header->owner != d_pid) {
+        d_discards++;
+        free_buffer(buf);
+        return;
+    }
+
+    d_bytes_in_use -= capacity;
+
+    // Check the class size too; a buffer from a pool with other classes is not kept.
+    bool keep = sc != UNPOOLED && sc < static_cast<int>(d_class_sizes.size()) && d_class_sizes[sc] == capacity;
+    if (keep && d_bytes_cached.fetch_add(capacity) + capacity > d_max_cached_bytes) {
+        d_bytes_cached -= capacity;
+        keep = false;
+    }
+
+    if (!keep) {
+        d_discards++;
+        free_buffer(buf);
+        return;
+    }
+
+    try {
+        auto &fl = d_free_lists[sc];
+        std::lock_guard<std::mutex> lck(fl.mtx);
+        fl.buffers.push_back(buf);
+    }
+    catch (...) {
+        d_bytes_cached -= capacity;
+        d_discards++;
+        free_buffer(buf);
+    }
+}
+
+/**
+ * @return The number of bytes the caller may use in a buffer made by allocate().
+ * @exception BESInternalError if buf was not made by allocate().
+ */
+unsigned long long ChunkBufferPool::capacity(const char *buf)
+{
+    const auto header = header_of(buf);
+    if (!header)
+        throw BESInternalError(prolog + "The buffer was not allocated by the ChunkBufferPool.", __FILE__, __LINE__);
+    return header->capacity;
+}
+
+/**
+ * @brief Free all the buffers on the free lists.
+ *
+ * The DMR++ handler calls this at the end of each request (see
+ * DmrppRequestHandler), so an idle besd does not hold on to the memory.
+ */
+void ChunkBufferPool::trim()
+{
+    for (size_t sc = 0; sc < d_free_lists.size(); ++sc) {
+        auto &fl = d_free_lists[sc];
+        std::lock_guard<std::mutex> lck(fl.mtx);
+        for (auto buf: fl.buffers) {
+            d_bytes_cached -= d_class_sizes[sc];
+            free_buffer(buf);
+        }
+        fl.buffers.clear();
+    }
+}
+
+ChunkBufferPool::pool_stats ChunkBufferPool::stats() const
+{
+    pool_stats s;
+    s.allocations = d_allocations;
+    s.hits = d_hits;
+    s.misses = d_misses;
+    s.unpooled = d_unpooled;
+    s.releases = d_releases;
+    s.discards = d_discards;
+    s.bytes_in_use = d_bytes_in_use;
+    s.peak_bytes_in_use = d_peak_bytes_in_use;
+    s.bytes_cached = d_bytes_cached;
+    return s;
+}
+
+void ChunkBufferPool::dump(ostream &strm) const
+{
+    const auto s = stats();
+    strm << "ChunkBufferPool [pid: " << d_pid << "]" << endl
+         << "    allocations: " << s.allocations << " hits: " << s.hits << " misses: " << s.misses
+         << " unpooled: " << s.unpooled << " hit rate: " << s.hit_rate() << endl
+         << "    releases: " << s.releases << " discards: " << s.discards << endl
+         << "    bytes in use: " << s.bytes_in_use << " peak bytes in use: " << s.peak_bytes_in_use
+         << " bytes cached: " << s.bytes_cached << " (max: " << d_max_cached_bytes << ")" << endl;
+}
+
+} // namespace dmrpp
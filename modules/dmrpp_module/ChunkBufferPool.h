@@ -0,0 +1,132 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dmrpp_chunk_buffer_pool_h
+#define _dmrpp_chunk_buffer_pool_h 1
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace dmrpp {
+
+/**
+ * @brief A process-wide pool of the buffers used to read and decode chunks.
+ *
+ * Chunk and SuperChunk read buffers and the buffers made by inflate() and
+ * the other filter decoders are drawn from this pool and returned to it
+ * instead of being made with new[] and freed with delete[]. A request that
+ * reads thousands of chunks then reuses a handful of buffers rather than
+ * making (and fragmenting the heap of a long-lived besd with) thousands.
+ *
+ * Sizes are rounded up to a size class. There are four classes per power of
+ * two (e.g., 16k, 20k, 24k and 28k), so at most 25% of a buffer is unused,
+ * from MIN_CLASS_SIZE up to MAX_CLASS_SIZE. Larger buffers are not pooled.
+ * Released buffers are kept on a free list for their class until the pool
+ * holds max_cached_bytes; after that they are freed. A pool with
+ * max_cached_bytes of zero caches nothing.
+ *
+ * Each buffer starts with a small header that records its size class, so
+ * release() needs only the pointer and a buffer may be released to the pool
+ * of a process other than the one that allocated it (see ThePool()). The
+ * header also records the process that made the buffer, so buffers made by
+ * a parent's pool do not change the counters of the child's.
+ *
+ * The counters are there to show how well the pool works: hits vs. misses,
+ * the peak number of bytes in use and the bytes held on the free lists.
+ */
+class ChunkBufferPool {
+public:
+    static constexpr unsigned long long MIN_CLASS_SIZE = 4 * 1024;
+    static constexpr unsigned long long MAX_CLASS_SIZE = 64 * 1024 * 1024;
+
+    /// A snapshot of the pool's counters.
+    struct pool_stats {
+        unsigned long long allocations = 0;     ///< Calls to allocate()
+        unsigned long long hits = 0;            ///< ... satisfied from a free list
+        unsigned long long misses = 0;          ///< ... that had to allocate memory
+        unsigned long long unpooled = 0;        ///< ... too large for a size class
+        unsigned long long releases = 0;        ///< Calls to release()
+        unsigned long long discards = 0;        ///< ... freed because the pool was full
+        unsigned long long bytes_in_use = 0;    ///< Held by callers now
+        unsigned long long peak_bytes_in_use = 0;
+        unsigned long long bytes_cached = 0;    ///< Held on the free lists now
+
+        double hit_rate() const { return allocations ? double(hits) / double(allocations) : 0.0; }
+    };
+
+private:
+    struct free_list {
+        std::mutex mtx;
+        std::vector<char *> buffers;
+    };
+
+    std::vector<unsigned long long> d_class_sizes;
+    std::vector<free_list> d_free_lists;
+    unsigned long long d_max_cached_bytes;
+    pid_t d_pid;
+
+    std::atomic<unsigned long long> d_allocations{0};
+    std::atomic<unsigned long long> d_hits{0};
+    std::atomic<unsigned long long> d_misses{0};
+    std::atomic<unsigned long long> d_unpooled{0};
+    std::atomic<unsigned long long> d_releases{0};
+    std::atomic<unsigned long long> d_discards{0};
+    std::atomic<unsigned long long> d_bytes_in_use{0};
+    std::atomic<unsigned long long> d_peak_bytes_in_use{0};
+    std::atomic<unsigned long long> d_bytes_cached{0};
+
+    int size_class(unsigned long long size) const;
+    void add_in_use(unsigned long long size);
+
+    friend class ChunkBufferPoolTest;
+
+public:
+    explicit ChunkBufferPool(unsigned long long max_cached_bytes);
+    virtual ~ChunkBufferPool();
+
+    ChunkBufferPool(const ChunkBufferPool &) = delete;
+    ChunkBufferPool &operator=(const ChunkBufferPool &) = delete;
+
+    static ChunkBufferPool *ThePool();
+
+    char *allocate(unsigned long long size);
+    void release(char *buf) noexcept;
+
+    static unsigned long long capacity(const char *buf);
+
+    void trim();
+
+    unsigned long long max_cached_bytes() const { return d_max_cached_bytes; }
+
+    pool_stats stats() const;
+
+    void dump(std::ostream &strm) const;
+};
+
+} // namespace dmrpp
+
+#endif // _dmrpp_chunk_buffer_pool_h
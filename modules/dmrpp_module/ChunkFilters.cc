@@ -0,0 +1,527 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+
+#if HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#if HAVE_LIBBLOSC
+#include <blosc.h>
+#endif
+#if HAVE_LIBSZ
+// Some versions of szlib.h lack the extern "C" guard.
+extern "C" {
+#include <szlib.h>
+}
+#endif
+#if HAVE_LIBLZ4
+#include <lz4.h>
+#endif
+
+#include "BESInternalError.h"
+#include "BESDebug.h"
+#include "BESUtil.h"
+
+#include "ChunkBufferPool.h"
+#include "ChunkFilters.h"
+
+using namespace std;
+
+#define prolog std::string("ChunkFilters::").append(__func__).append("() - ")
+
+#define MODULE "dmrpp:filters"
+
+// Values used by the bitshuffle library (bitshuffle_core.h, bshuf_h5filter.h)
+#define BSHUF_BLOCKED_MULT 8
+#define BSHUF_TARGET_BLOCK_SIZE_B 8192
+#define BSHUF_MIN_RECOMMEND_BLOCK 128
+#define BSHUF_H5_COMPRESS_NONE 0
+#define BSHUF_H5_COMPRESS_LZ4 2
+#define BSHUF_H5_COMPRESS_ZSTD 3
+
+namespace dmrpp {
+
+/**
+ * @brief Parse one entry from a DMR++ filter list.
+ * @param entry A filter name, optionally followed by its parameters, e.g., 'szip(141,32,32,256)'
+ * @return The filter's name and parameters
+ */
+filter_spec parse_filter_spec(const string &entry)
+{
+    filter_spec spec;
+    const auto open = entry.find('(');
+    spec.name = entry.substr(0, open);
+    if (open == string::npos)
+        return spec;
+
+    const auto close = entry.find(')', open);
+    if (close == string::npos || close != entry.size() - 1)
+        throw BESInternalError(prolog + "Malformed filter entry: '" + entry + "'", __FILE__, __LINE__);
+
+    const string params = entry.substr(open + 1, close - open - 1);
+    if (params.empty())
+        return spec;
+
+    for (const auto &value: BESUtil::split(params, ',')) {
+        try {
+            spec.params.push_back(stoul(value));
+        }
+        catch (const std::exception &) {
+            throw BESInternalError(prolog + "Malformed filter parameter in: '" + entry + "'", __FILE__, __LINE__);
+        }
+    }
+
+    return spec;
+}
+
+/**
+ * @brief Build a DMR++ filter list entry. The inverse of parse_filter_spec().
+ */
+string make_filter_spec(const string &name, const vector<unsigned int> &params)
+{
+    if (params.empty())
+        return name;
+
+    ostringstream oss;
+    oss << name << '(';
+    for (size_t i = 0; i < params.size(); ++i)
+        oss << (i ? "," : "") << params[i];
+    oss << ')';
+    return oss.str();
+}
+
+/**
+ * @brief Is the named filter in a DMR++ filter list?
+ *
+ * The entries are compared by name, so 'shuffle' does not match 'bitshuffle'
+ * and 'szip' matches 'szip(141,32,32,256)'.
+ *
+ * @param filters The DMR++ filter list
+ * @param name The filter name
+ * @return True if one of the entries is the named filter.
+ */
+bool has_filter(const string &filters, const string &name)
+{
+    for (const auto &entry: BESUtil::split(filters, ' ')) {
+        if (entry.substr(0, entry.find('(')) == name)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Can chunks that use these filters be copied as-is to a netCDF-4 file?
+ *
+ * The fileout_netcdf direct IO code can only define deflate, shuffle and
+ * fletcher32 filters for the variables it writes.
+ *
+ * @param filters The DMR++ filter list
+ * @return True if every filter in the list is one of those three.
+ */
+bool filters_support_direct_io(const string &filters)
+{
+    for (const auto &entry: BESUtil::split(filters, ' ')) {
+        if (entry.empty())
+            continue;
+        if (entry != "deflate" && entry != "shuffle" && entry != "fletcher32")
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Make sure *destp can hold \arg needed bytes.
+ * The buffer is replaced, not grown; its contents are not preserved.
+ */
+static void ensure_dest_size(char **destp, unsigned long long &dest_len, unsigned long long needed)
+{
+    if (needed <= dest_len)
+        return;
+
+    auto new_dest = ChunkBufferPool::ThePool()->allocate(needed);
+    ChunkBufferPool::ThePool()->release(*destp);
+    *destp = new_dest;
+    dest_len = needed;
+}
+
+static uint32_t read_be32(const char *p)
+{
+    const auto *b = reinterpret_cast<const unsigned char *>(p);
+    return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | uint32_t(b[3]);
+}
+
+static uint64_t read_be64(const char *p)
+{
+    return (uint64_t(read_be32(p)) << 32) | read_be32(p + 4);
+}
+
+#if HAVE_LIBZSTD
+/**
+ * @brief Decode data compressed by the HDF5 zstd filter (id 32015).
+ *
+ * The filter writes a plain zstd frame. If the frame does not record the size
+ * of the decompressed data, the destination buffer is grown as needed.
+ */
+unsigned long long zstd_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                               unsigned long long /*elem_width*/, const vector<unsigned int> &/*params*/)
+{
+    const auto content_size = ZSTD_getFrameContentSize(src, src_len);
+    if (content_size == ZSTD_CONTENTSIZE_ERROR)
+        throw BESInternalError(prolog + "The chunk is not zstd compressed data.", __FILE__, __LINE__);
+
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN) {
+        ensure_dest_size(destp, dest_len, content_size);
+        const size_t status = ZSTD_decompress(*destp, dest_len, src, src_len);
+        if (ZSTD_isError(status))
+            throw BESInternalError(prolog + "Failed to decompress zstd data: " + ZSTD_getErrorName(status), __FILE__, __LINE__);
+        return status;
+    }
+
+    unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (!dctx)
+        throw BESInternalError(prolog + "Failed to initialize zstd.", __FILE__, __LINE__);
+
+    ZSTD_inBuffer in{src, src_len, 0};
+    ZSTD_outBuffer out{*destp, dest_len, 0};
+    size_t status = 0;
+    do {
+        status = ZSTD_decompressStream(dctx.get(), &out, &in);
+        if (ZSTD_isError(status))
+            throw BESInternalError(prolog + "Failed to decompress zstd data: " + ZSTD_getErrorName(status), __FILE__, __LINE__);
+
+        if (out.pos == out.size) {
+            // Out of room; double the buffer, keeping what's been decoded.
+            const size_t new_size = out.size ? out.size * 2 : 4096;
+            auto new_dest = ChunkBufferPool::ThePool()->allocate(new_size);
+            memcpy(new_dest, *destp, out.pos);
+            ChunkBufferPool::ThePool()->release(*destp);
+            *destp = new_dest;
+            out.dst = new_dest;
+            out.size = new_size;
+        }
+        else if (status != 0 && in.pos == in.size) {
+            throw BESInternalError(prolog + "The zstd data are truncated.", __FILE__, __LINE__);
+        }
+    } while (status != 0 || in.pos < in.size);
+
+    return out.pos;
+}
+#endif
+
+#if HAVE_LIBBLOSC
+/**
+ * @brief Decode data compressed by the HDF5 blosc filter (id 32001).
+ *
+ * A blosc buffer has a header that records the sizes and the shuffle and
+ * codec used, so no filter parameters are needed.
+ */
+unsigned long long blosc_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                                unsigned long long /*elem_width*/, const vector<unsigned int> &/*params*/)
+{
+    if (src_len < BLOSC_MIN_HEADER_LENGTH)
+        throw BESInternalError(prolog + "The chunk is too small to be blosc compressed data.", __FILE__, __LINE__);
+
+    size_t nbytes = 0;
+    size_t cbytes = 0;
+    size_t blocksize = 0;
+    blosc_cbuffer_sizes(src, &nbytes, &cbytes, &blocksize);
+    if (cbytes > src_len)
+        throw BESInternalError(prolog + "The blosc data are truncated.", __FILE__, __LINE__);
+
+    ensure_dest_size(destp, dest_len, nbytes);
+
+    // The _ctx version does not use blosc's global state, so it's safe to call
+    // from the compute threads.
+    const int status = blosc_decompress_ctx(src, *destp, dest_len, 1);
+    if (status < 0) {
+        ostringstream oss;
+        oss << prolog << "Failed to decompress blosc data (status: " << status << ").";
+        throw BESInternalError(oss.str(), __FILE__, __LINE__);
+    }
+
+    return status;
+}
+#endif
+
+#if HAVE_LIBSZ
+/**
+ * @brief Decode data compressed by the HDF5 szip filter.
+ *
+ * HDF5 writes the size of the decoded data as a four-byte little-endian value
+ * ahead of the szip stream.
+ *
+ * @param params The HDF5 filter's client data: options_mask, pixels_per_block,
+ * bits_per_pixel and pixels_per_scanline.
+ */
+unsigned long long szip_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                               unsigned long long /*elem_width*/, const vector<unsigned int> &params)
+{
+    if (params.size() < 4)
+        throw BESInternalError(prolog + "The szip filter needs four parameters; rebuild the DMR++ with a current build_dmrpp.",
+                               __FILE__, __LINE__);
+    if (src_len < 4)
+        throw BESInternalError(prolog + "The chunk is too small to be szip compressed data.", __FILE__, __LINE__);
+
+    const auto *b = reinterpret_cast<const unsigned char *>(src);
+    size_t out_len = size_t(b[0]) | (size_t(b[1]) << 8) | (size_t(b[2]) << 16) | (size_t(b[3]) << 24);
+    ensure_dest_size(destp, dest_len, out_len);
+
+    SZ_com_t sz_param;
+    sz_param.options_mask = params[0];
+    sz_param.pixels_per_block = params[1];
+    sz_param.bits_per_pixel = params[2];
+    sz_param.pixels_per_scanline = params[3];
+
+    const int status = SZ_BufftoBuffDecompress(*destp, &out_len, src + 4, src_len - 4, &sz_param);
+    if (status != SZ_OK) {
+        ostringstream oss;
+        oss << prolog << "Failed to decompress szip data (status: " << status << ").";
+        throw BESInternalError(oss.str(), __FILE__, __LINE__);
+    }
+
+    return out_len;
+}
+#endif
+
+/**
+ * @brief Reverse the bitshuffle transform for one block.
+ *
+ * Bitshuffle transposes the bit matrix with one row per element. In the
+ * shuffled data there is one row for each bit of each byte of the element
+ * (byte-major, least significant bit first); bit i%8 of byte i/8 of a row
+ * holds that bit for element i.
+ *
+ * @param dest Put the elements here
+ * @param src Shuffled data
+ * @param elems The number of elements in the block; must be a multiple of 8
+ * @param elem_size The number of bytes in an element
+ */
+void bitunshuffle_block(char *dest, const char *src, unsigned long long elems, unsigned long long elem_size)
+{
+    const unsigned long long row_bytes = elems / 8;
+    auto *out = reinterpret_cast<unsigned char *>(dest);
+    const auto *in = reinterpret_cast<const unsigned char *>(src);
+
+    memset(out, 0, elems * elem_size);
+    for (unsigned long long j = 0; j < elem_size; ++j) {
+        for (unsigned int b = 0; b < 8; ++b) {
+            const unsigned char *row = in + (j * 8 + b) * row_bytes;
+            for (unsigned long long k = 0; k < row_bytes; ++k) {
+                const unsigned char bits = row[k];
+                if (!bits)
+                    continue;
+                unsigned char *o = out + k * 8 * elem_size + j;
+                for (unsigned int t = 0; t < 8; ++t)
+                    o[t * elem_size] |= ((bits >> t) & 1u) << b;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Undo the bitshuffle filter's blocking, decompression and bit transpose.
+ *
+ * The elements are processed in blocks of \arg block_size elements; the last
+ * partial block is rounded down to a multiple of eight elements and anything
+ * left over after that is stored as-is. When the data were compressed, each
+ * block is preceded by its compressed size as a big-endian four-byte value.
+ */
+static void bitunshuffle_blocks(char *dest, const char *src, unsigned long long src_len, unsigned long long elems,
+                                unsigned long long elem_size, unsigned long long block_size, unsigned int compression)
+{
+    if (block_size == 0) {
+        block_size = BSHUF_TARGET_BLOCK_SIZE_B / elem_size;
+        block_size = (block_size / BSHUF_BLOCKED_MULT) * BSHUF_BLOCKED_MULT;
+        block_size = std::max<unsigned long long>(block_size, BSHUF_MIN_RECOMMEND_BLOCK);
+    }
+    if (block_size % BSHUF_BLOCKED_MULT)
+        throw BESInternalError(prolog + "The bitshuffle block size must be a multiple of eight.", __FILE__, __LINE__);
+
+    const char *in = src;
+    const char *in_end = src + src_len;
+    char *out = dest;
+    vector<char> tmp(compression == BSHUF_H5_COMPRESS_NONE ? 0 : block_size * elem_size);
+
+    auto one_block = [&](unsigned long long n) {
+        const unsigned long long nbytes = n * elem_size;
+        const char *shuffled = in;
+        if (compression == BSHUF_H5_COMPRESS_NONE) {
+            if ((unsigned long long)(in_end - in) < nbytes)
+                throw BESInternalError(prolog + "The bitshuffle data are truncated.", __FILE__, __LINE__);
+            in += nbytes;
+        }
+        else {
+            if (in_end - in < 4)
+                throw BESInternalError(prolog + "The bitshuffle data are truncated.", __FILE__, __LINE__);
+            const uint32_t csize = read_be32(in);
+            in += 4;
+            if ((unsigned long long)(in_end - in) < csize)
+                throw BESInternalError(prolog + "The bitshuffle data are truncated.", __FILE__, __LINE__);
+
+            long long decoded = -1;
+            if (compression == BSHUF_H5_COMPRESS_LZ4) {
+#if HAVE_LIBLZ4
+                decoded = LZ4_decompress_safe(in, tmp.data(), (int) csize, (int) nbytes);
+#else
+                throw BESInternalError(prolog + "This server was built without LZ4; cannot decode bitshuffle/LZ4 data.",
+                                       __FILE__, __LINE__);
+#endif
+            }
+            else if (compression == BSHUF_H5_COMPRESS_ZSTD) {
+#if HAVE_LIBZSTD
+                const size_t status = ZSTD_decompress(tmp.data(), nbytes, in, csize);
+                decoded = ZSTD_isError(status) ? -1 : (long long) status;
+#else
+                throw BESInternalError(prolog + "This server was built without zstd; cannot decode bitshuffle/zstd data.",
+                                       __FILE__, __LINE__);
+#endif
+            }
+            else {
+                throw BESInternalError(prolog + "Unknown bitshuffle compression: " + to_string(compression),
+                                       __FILE__, __LINE__);
+            }
+
+            if (decoded != (long long) nbytes)
+                throw BESInternalError(prolog + "Failed to decompress a bitshuffle block.", __FILE__, __LINE__);
+
+            shuffled = tmp.data();
+            in += csize;
+        }
+
+        bitunshuffle_block(out, shuffled, n, elem_size);
+        out += nbytes;
+    };
+
+    for (unsigned long long i = 0; i < elems / block_size; ++i)
+        one_block(block_size);
+
+    unsigned long long last_block = elems % block_size;
+    last_block -= last_block % BSHUF_BLOCKED_MULT;
+    if (last_block)
+        one_block(last_block);
+
+    const unsigned long long leftover = (elems % BSHUF_BLOCKED_MULT) * elem_size;
+    if ((unsigned long long)(in_end - in) < leftover)
+        throw BESInternalError(prolog + "The bitshuffle data are truncated.", __FILE__, __LINE__);
+    memcpy(out, in, leftover);
+}
+
+/**
+ * @brief Decode data written by the HDF5 bitshuffle filter (id 32008).
+ *
+ * @param params The HDF5 filter's client data: major and minor version,
+ * element size, block size (zero for the default) and compression (0 for
+ * none, 2 for LZ4, 3 for zstd). If absent, the data are assumed to be
+ * uncompressed with the default block size and the element size is
+ * \arg elem_width.
+ */
+unsigned long long bitshuffle_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                                     unsigned long long elem_width, const vector<unsigned int> &params)
+{
+    const unsigned long long elem_size = params.size() > 2 && params[2] ? params[2] : elem_width;
+    unsigned long long block_size = params.size() > 3 ? params[3] : 0;
+    const unsigned int compression = params.size() > 4 ? params[4] : BSHUF_H5_COMPRESS_NONE;
+
+    if (elem_size == 0)
+        throw BESInternalError(prolog + "The bitshuffle element size is zero.", __FILE__, __LINE__);
+
+    unsigned long long nbytes = src_len;
+    if (compression != BSHUF_H5_COMPRESS_NONE) {
+        // Compressed data start with the decoded size (8 bytes) and the block size in bytes (4 bytes).
+        if (src_len < 12)
+            throw BESInternalError(prolog + "The chunk is too small to be bitshuffle compressed data.", __FILE__, __LINE__);
+        nbytes = read_be64(src);
+        block_size = read_be32(src + 8) / elem_size;
+        src += 12;
+        src_len -= 12;
+    }
+
+    if (nbytes % elem_size)
+        throw BESInternalError(prolog + "The bitshuffle data are not a whole number of elements.", __FILE__, __LINE__);
+
+    ensure_dest_size(destp, dest_len, nbytes);
+    bitunshuffle_blocks(*destp, src, src_len, nbytes / elem_size, elem_size, block_size, compression);
+
+    BESDEBUG(MODULE, prolog << "Decoded " << nbytes << " bytes, elem_size: " << elem_size << endl);
+    return nbytes;
+}
+
+ChunkFilters::ChunkFilters()
+{
+#if HAVE_LIBZSTD
+    d_decoders["zstd"] = zstd_decode;
+#endif
+#if HAVE_LIBBLOSC
+    d_decoders["blosc"] = blosc_decode;
+#endif
+#if HAVE_LIBSZ
+    d_decoders["szip"] = szip_decode;
+#endif
+    d_decoders["bitshuffle"] = bitshuffle_decode;
+}
+
+/**
+ * @brief Get the process-wide set of filter decoders.
+ */
+ChunkFilters *ChunkFilters::TheFilters()
+{
+    static ChunkFilters filters;
+    return &filters;
+}
+
+/**
+ * @brief Add (or replace) the decoder for the filter \arg name.
+ */
+void ChunkFilters::add_decoder(const string &name, filter_decoder decoder)
+{
+    d_decoders[name] = std::move(decoder);
+}
+
+/**
+ * @brief Find the decoder for a filter.
+ * @param name The name of the filter, without parameters.
+ * @return A pointer to the decoder, or nullptr if there is none.
+ */
+const filter_decoder *ChunkFilters::find_decoder(const string &name) const
+{
+    auto it = d_decoders.find(name);
+    return it == d_decoders.end() ? nullptr : &it->second;
+}
+
+/// @return The names of the filters that can be decoded, in addition to deflate, shuffle and fletcher32.
+vector<string> ChunkFilters::decoder_names() const
+{
+    vector<string> names;
+    for (const auto &d: d_decoders)
+        names.push_back(d.first);
+    return names;
+}
+
+} // namespace dmrpp
@@ -0,0 +1,119 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dmrpp_chunk_filters_h
+#define _dmrpp_chunk_filters_h 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+namespace dmrpp {
+
+/**
+ * @brief One entry in a DMR++ filter list (the chunks' 'compressionType' attribute).
+ *
+ * Most filters are just a name: 'deflate', 'shuffle', 'zstd'. Filters that cannot
+ * be decoded without the HDF5 filter's client data values carry those values in
+ * parentheses, e.g., 'szip(141,32,32,256)'. There are no spaces in an entry since
+ * the list is space separated.
+ */
+struct filter_spec {
+    std::string name;
+    std::vector<unsigned int> params;
+};
+
+filter_spec parse_filter_spec(const std::string &entry);
+std::string make_filter_spec(const std::string &name, const std::vector<unsigned int> &params);
+
+bool has_filter(const std::string &filters, const std::string &name);
+bool filters_support_direct_io(const std::string &filters);
+
+/**
+ * @brief A function that reverses one filter.
+ *
+ * The decoder reads \arg src_len bytes from \arg src and writes the result to
+ * *destp, which points to a buffer of \arg dest_len bytes allocated by the
+ * ChunkBufferPool. If that buffer is too small, the decoder replaces it with a
+ * larger one (and releases the original), just as inflate() does.
+ *
+ * @return The number of decoded bytes in *destp.
+ */
+using filter_decoder = std::function<unsigned long long(char **destp, unsigned long long dest_len,
+                                                        const char *src, unsigned long long src_len,
+                                                        unsigned long long elem_width,
+                                                        const std::vector<unsigned int> &params)>;
+
+/**
+ * @brief The decoders for filters other than deflate, shuffle and fletcher32.
+ *
+ * Chunk::filter_chunk() handles those three itself, since they are always
+ * available and deflate needs special treatment. Every other filter is looked
+ * up here by name. The decoders built in are the ones whose libraries were
+ * found by configure (zstd, blosc, szip via libaec) plus bitshuffle, which is
+ * implemented here and uses liblz4 when the data were also LZ4 compressed.
+ *
+ * Other decoders can be added using add_decoder(). This must be done before
+ * the handler starts processing requests (e.g., in a module's initialize()
+ * method) since lookups are not locked.
+ */
+class ChunkFilters {
+    std::map<std::string, filter_decoder> d_decoders;
+
+    ChunkFilters();
+
+public:
+    ChunkFilters(const ChunkFilters &) = delete;
+    ChunkFilters &operator=(const ChunkFilters &) = delete;
+
+    virtual ~ChunkFilters() = default;
+
+    static ChunkFilters *TheFilters();
+
+    void add_decoder(const std::string &name, filter_decoder decoder);
+    const filter_decoder *find_decoder(const std::string &name) const;
+    std::vector<std::string> decoder_names() const;
+};
+
+// The built-in decoders. These are exposed for the unit tests.
+#if HAVE_LIBZSTD
+unsigned long long zstd_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                               unsigned long long elem_width, const std::vector<unsigned int> &params);
+#endif
+#if HAVE_LIBBLOSC
+unsigned long long blosc_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                                unsigned long long elem_width, const std::vector<unsigned int> &params);
+#endif
+#if HAVE_LIBSZ
+unsigned long long szip_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                               unsigned long long elem_width, const std::vector<unsigned int> &params);
+#endif
+unsigned long long bitshuffle_decode(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len,
+                                     unsigned long long elem_width, const std::vector<unsigned int> &params);
+
+void bitunshuffle_block(char *dest, const char *src, unsigned long long elems, unsigned long long elem_size);
+
+} // namespace dmrpp
+
+#endif // _dmrpp_chunk_filters_h
@@ -36,7 +36,9 @@
 
 #include "DmrppCommon.h"
 #include "CurlHandlePool.h"
+#include "CurlMultiEngine.h"
 #include "Chunk.h"
+#include "DmrppRequestHandler.h"
 #include "CredentialsManager.h"
 
 #define CURL_VERBOSE 0  // Logs curl info to the bes.log
@@ -222,6 +224,9 @@ dmrpp_easy_handle::~dmrpp_easy_handle() {
  * and Common::read_atomic()). Whether a request is retired is
  * determined by curl::super_easy_perform().
  *
+ * When DMRPP.UseCurlMulti is true, HTTP/S transfers are run by the
+ * CurlMultiEngine instead; the same retry rules apply.
+ *
  * If either the super_easy_perform() (our concoction) or easy_perform()
  * throws, assume the transfer failed. The caller of this method must handle
  * all cleanup.
@@ -231,7 +236,10 @@ void dmrpp_easy_handle::read_data() {
     if (d_url->protocol() == HTTPS_PROTOCOL || d_url->protocol() == HTTP_PROTOCOL) {
         try {
             // This code throws an exception if there is a problem. jhrg 11/16/23
-            curl::super_easy_perform(d_handle);
+            if (DmrppRequestHandler::d_use_curl_multi)
+                CurlMultiEngine::TheEngine()->perform(this);
+            else
+                curl::super_easy_perform(d_handle);
         }
         catch (http::HttpError &http_error) {
             string err_msg = prolog + "Hyrax encountered a Service Chaining Error while attempting to acquire "
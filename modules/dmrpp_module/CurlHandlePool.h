@@ -57,6 +57,8 @@ class dmrpp_easy_handle {
     curl_slist *d_request_headers = nullptr; ///< Holds the list of authorization headers, if needed.
 
     friend class CurlHandlePool;
+    friend class MultiRangeRequest;
+    friend class CurlMultiEngine;
 
 public:
     dmrpp_easy_handle();
@@ -0,0 +1,484 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <algorithm>
+#include <future>
+#include <sstream>
+
+#include "BESDebug.h"
+#include "BESInternalError.h"
+#include "BESLog.h"
+
+#include "CurlUtils.h"
+#include "HttpError.h"
+#include "url_impl.h"
+
+#include "CurlMultiEngine.h"
+#include "CurlHandlePool.h"
+#include "Chunk.h"
+#include "DmrppRequestHandler.h"
+#include "DmrppNames.h"
+
+// curl_multi_wakeup() lets submit() interrupt curl_multi_poll(). Without it, the
+// event loop polls for new transfers every OLD_CURL_POLL_MS.
+#define CURL_HAS_MULTI_WAKEUP (LIBCURL_VERSION_NUM >= 0x074400)
+
+using namespace std;
+
+#define prolog std::string("CurlMultiEngine::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+namespace {
+
+const int MAX_POLL_MS = 1000;
+const int OLD_CURL_POLL_MS = 10;
+
+} // namespace
+
+/**
+ * @brief Make an engine and start its event-loop thread.
+ * @param max_in_flight The most transfers that run at once
+ * @param max_per_origin The most transfers that run at once for one origin; zero means no limit
+ * @param use_http2 Ask for HTTP/2 (over TLS) and multiplex requests to an origin on one connection
+ */
+CurlMultiEngine::CurlMultiEngine(unsigned int max_in_flight, unsigned int max_per_origin, bool use_http2) :
+        d_max_in_flight(max(max_in_flight, 1U)), d_max_per_origin(max_per_origin), d_use_http2(use_http2),
+        d_pid(getpid())
+{
+    d_multi = curl_multi_init();
+    if (!d_multi)
+        throw BESInternalError(prolog + "Could not allocate a CURL multi handle.", __FILE__, __LINE__);
+
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    if (d_use_http2)
+        curl_multi_setopt(d_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+    d_loop = thread(&CurlMultiEngine::event_loop, this);
+}
+
+CurlMultiEngine::~CurlMultiEngine()
+{
+    {
+        lock_guard<mutex> lck(d_mtx);
+        d_shutdown = true;
+    }
+    d_cv.notify_all();
+    wakeup();
+
+    if (d_loop.joinable())
+        d_loop.join();
+
+    curl_multi_cleanup(d_multi);
+}
+
+/**
+ * @brief Get the engine for this process.
+ *
+ * The engine is made the first time this is called, using the DMR++ handler's
+ * configuration. An engine made by the parent of this process is abandoned
+ * (its event-loop thread does not exist here) and a new one is made.
+ *
+ * @return A pointer to the process-wide engine.
+ */
+CurlMultiEngine *CurlMultiEngine::TheEngine()
+{
+    static std::mutex instance_mtx;
+    static std::unique_ptr<CurlMultiEngine> instance;
+
+    std::lock_guard<std::mutex> lck(instance_mtx);
+    if (!instance || instance->d_pid != getpid()) {
+        if (instance)
+            (void) instance.release();
+
+        instance.reset(new CurlMultiEngine(DmrppRequestHandler::d_max_in_flight_transfers,
+                                           DmrppRequestHandler::d_max_in_flight_per_origin,
+                                           DmrppRequestHandler::d_use_http2));
+        BESDEBUG(CURL_MULTI, prolog << "Made a new engine. max in flight: " << instance->d_max_in_flight
+                                    << " max per origin: " << instance->d_max_per_origin << " HTTP/2: "
+                                    << (instance->d_use_http2 ? "yes" : "no") << endl);
+    }
+
+    return instance.get();
+}
+
+void CurlMultiEngine::wakeup()
+{
+#if CURL_HAS_MULTI_WAKEUP
+    curl_multi_wakeup(d_multi);
+#endif
+}
+
+/**
+ * @brief Start a transfer.
+ *
+ * The handle must have been made by CurlHandlePool::get_easy_handle(). The
+ * caller keeps ownership of it and must not use or release it until \arg done
+ * has been called. The response is written to the handle's Chunk.
+ *
+ * @param handle The transfer to run
+ * @param done Called, on the event-loop thread, once the transfer has worked,
+ * or has failed and will not be retried.
+ * @exception BESInternalError if the engine is shutting down.
+ */
+void CurlMultiEngine::submit(dmrpp_easy_handle *handle, completion done)
+{
+    auto t = make_shared<transfer>();
+    t->handle = handle;
+    t->origin = handle->d_url->protocol() + handle->d_url->host();
+    t->done = std::move(done);
+
+    {
+        lock_guard<mutex> lck(d_mtx);
+        if (d_shutdown)
+            throw BESInternalError(prolog + "The CurlMultiEngine is shutting down.", __FILE__, __LINE__);
+        d_submitted.push_back(t);
+    }
+
+    d_cv.notify_one();
+    wakeup();
+}
+
+/**
+ * @brief Run a transfer and wait for it.
+ *
+ * This is the blocking form of submit(); it is a replacement for
+ * curl::super_easy_perform() that shares the event loop (and its
+ * connections) with every other transfer.
+ *
+ * @param handle The transfer to run
+ * @exception BESError if the transfer failed.
+ */
+void CurlMultiEngine::perform(dmrpp_easy_handle *handle)
+{
+    auto result = make_shared<promise<void>>();
+    auto future = result->get_future();
+    submit(handle, [result](exception_ptr error) {
+        if (error)
+            result->set_exception(error);
+        else
+            result->set_value();
+    });
+
+    future.get();
+}
+
+/// Write the response to the transfer's Chunk; stop the transfer if that throws.
+size_t CurlMultiEngine::write_data(void *buffer, size_t size, size_t nmemb, void *data)
+{
+    auto t = reinterpret_cast<transfer *>(data);
+    try {
+        return chunk_write_data(buffer, size, nmemb, t->handle->d_chunk);
+    }
+    catch (...) {
+        t->write_error = current_exception();
+        return 0;
+    }
+}
+
+/**
+ * @brief Move newly submitted transfers to their origin's queue.
+ * @param wait If true, block until there is something to do.
+ * @return False if the engine is shutting down.
+ */
+bool CurlMultiEngine::take_submitted(bool wait)
+{
+    unique_lock<mutex> lck(d_mtx);
+    if (wait) {
+        auto ready = [this] { return d_shutdown || !d_submitted.empty(); };
+        if (d_retries.empty()) {
+            d_cv.wait(lck, ready);
+        }
+        else {
+            auto next = min_element(d_retries.begin(), d_retries.end(),
+                                    [](const shared_ptr<transfer> &a, const shared_ptr<transfer> &b) {
+                                        return a->retry_at < b->retry_at;
+                                    });
+            d_cv.wait_until(lck, (*next)->retry_at, ready);
+        }
+    }
+
+    if (d_shutdown)
+        return false;
+
+    while (!d_submitted.empty()) {
+        auto t = d_submitted.front();
+        d_submitted.pop_front();
+        d_waiting[t->origin].push_back(t);
+    }
+
+    return true;
+}
+
+/// Queue the retries that are due; they go ahead of the other waiting transfers.
+void CurlMultiEngine::schedule_retries()
+{
+    const auto now = chrono::steady_clock::now();
+    auto due = stable_partition(d_retries.begin(), d_retries.end(),
+                                [now](const shared_ptr<transfer> &t) { return t->retry_at > now; });
+    for (auto it = due; it != d_retries.end(); ++it)
+        d_waiting[(*it)->origin].push_front(*it);
+    d_retries.erase(due, d_retries.end());
+}
+
+/// Start waiting transfers until the limits are reached.
+void CurlMultiEngine::start_transfers()
+{
+    for (auto it = d_waiting.begin(); it != d_waiting.end() && d_active.size() < d_max_in_flight;) {
+        auto &queue = it->second;
+        auto &origin_in_flight = d_origin_in_flight[it->first];
+        while (!queue.empty() && d_active.size() < d_max_in_flight
+               && (d_max_per_origin == 0 || origin_in_flight < d_max_per_origin)) {
+            auto t = queue.front();
+            queue.pop_front();
+            start(t);
+        }
+
+        it = queue.empty() ? d_waiting.erase(it) : next(it);
+    }
+}
+
+void CurlMultiEngine::start(const shared_ptr<transfer> &t)
+{
+    CURL *curl = t->handle->d_handle;
+    const char *errbuf = t->handle->d_errbuf.data();
+    try {
+        CURLcode res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
+        curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_WRITEFUNCTION", errbuf, __FILE__, __LINE__);
+        res = curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void *>(t.get()));
+        curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_WRITEDATA", errbuf, __FILE__, __LINE__);
+
+#if LIBCURL_VERSION_NUM >= 0x072f00
+        // Without UseHTTP2 the handle keeps the HTTP version libcurl (or CurlHandlePool) chose.
+        if (d_use_http2) {
+            res = curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_HTTP_VERSION", errbuf, __FILE__, __LINE__);
+            // Wait for a connection that can be multiplexed instead of opening another one.
+            res = curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+            curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_PIPEWAIT", errbuf, __FILE__, __LINE__);
+        }
+#endif
+
+        CURLMcode mres = curl_multi_add_handle(d_multi, curl);
+        if (mres != CURLM_OK)
+            throw BESInternalError(prolog + "Could not add a transfer: " + curl_multi_strerror(mres), __FILE__, __LINE__);
+    }
+    catch (...) {
+        complete(t, current_exception());
+        return;
+    }
+
+    t->attempts++;
+    t->write_error = nullptr;
+    d_active[curl] = t;
+    d_transfers++;
+
+    const unsigned long long in_flight = d_active.size();
+    if (in_flight > d_peak_in_flight)
+        d_peak_in_flight = in_flight;
+    const unsigned long long origin_in_flight = ++d_origin_in_flight[t->origin];
+    if (origin_in_flight > d_peak_origin_in_flight)
+        d_peak_origin_in_flight = origin_in_flight;
+}
+
+/**
+ * @brief Handle a finished transfer: complete it, or schedule a retry.
+ *
+ * This applies the tests used by curl::super_easy_perform().
+ */
+void CurlMultiEngine::finish(CURL *curl, CURLcode code)
+{
+    auto it = d_active.find(curl);
+    if (it == d_active.end())
+        return;
+    auto t = it->second;
+    d_active.erase(it);
+    curl_multi_remove_handle(d_multi, curl);
+    --d_origin_in_flight[t->origin];
+
+    if (t->write_error) {
+        complete(t, t->write_error);
+        return;
+    }
+
+    const string target_url = t->handle->d_url->str();
+    try {
+        long http_code = 0;
+        if (curl::eval_transfer_result(curl, code, t->handle->d_errbuf.data(), target_url, t->attempts, http_code)) {
+            complete(t, nullptr);
+            return;
+        }
+
+        char *effective_url = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+        const string last_url = curl::filter_aws_url(effective_url ? effective_url : target_url);
+
+        if (t->attempts >= curl::retry_limit) {
+            stringstream msg;
+            msg << prolog << "ERROR - Made " << curl::retry_limit << " failed attempts to retrieve the URL "
+                << curl::filter_aws_url(target_url) << " The retry limit has been exceeded. Giving up! "
+                << "CURLINFO_EFFECTIVE_URL: " << last_url << " Returned HTTP_STATUS: " << http_code;
+            ERROR_LOG(msg.str());
+            throw http::HttpError(msg.str(), code, http_code, target_url, last_url, __FILE__, __LINE__);
+        }
+
+        ERROR_LOG(prolog + "ERROR - Problem with data transfer. Will retry (url: " + curl::filter_aws_url(target_url)
+                  + " attempt: " + std::to_string(t->attempts) + "). CURLINFO_EFFECTIVE_URL: " + last_url
+                  + " Returned HTTP_STATUS: " + std::to_string(http_code));
+
+        // Drop whatever the failed attempt wrote.
+        t->handle->d_chunk->set_bytes_read(0);
+        t->handle->d_chunk->set_response_content_type("");
+
+        t->retry_at = chrono::steady_clock::now() + chrono::microseconds(curl::url_retry_time << (t->attempts - 1));
+        d_retries.push_back(t);
+        d_retry_count++;
+    }
+    catch (...) {
+        complete(t, current_exception());
+    }
+}
+
+void CurlMultiEngine::complete(const shared_ptr<transfer> &t, const exception_ptr &error)
+{
+    if (error)
+        d_failures++;
+
+    auto done = std::move(t->done);
+    t->done = nullptr;
+    if (!done)
+        return;
+
+    try {
+        done(error);
+    }
+    catch (...) {
+        ERROR_LOG(prolog + "ERROR - A transfer's completion function threw an exception.");
+    }
+}
+
+/// Complete all the transfers that have not finished with an error.
+void CurlMultiEngine::fail_all()
+{
+    const auto error = make_exception_ptr(
+            BESInternalError(prolog + "The transfer was cancelled; the CurlMultiEngine is shutting down.", __FILE__,
+                             __LINE__));
+
+    vector<shared_ptr<transfer>> pending;
+    for (const auto &active: d_active) {
+        curl_multi_remove_handle(d_multi, active.first);
+        pending.push_back(active.second);
+    }
+    d_active.clear();
+
+    for (auto &waiting: d_waiting)
+        pending.insert(pending.end(), waiting.second.begin(), waiting.second.end());
+    d_waiting.clear();
+
+    pending.insert(pending.end(), d_retries.begin(), d_retries.end());
+    d_retries.clear();
+
+    {
+        lock_guard<mutex> lck(d_mtx);
+        pending.insert(pending.end(), d_submitted.begin(), d_submitted.end());
+        d_submitted.clear();
+    }
+
+    for (const auto &t: pending)
+        complete(t, error);
+}
+
+void CurlMultiEngine::event_loop()
+{
+    while (true) {
+        // Block only when there is nothing to run.
+        if (!take_submitted(d_active.empty() && d_waiting.empty()))
+            break;
+
+        schedule_retries();
+        start_transfers();
+
+        if (d_active.empty())
+            continue;
+
+        int running = 0;
+        curl_multi_perform(d_multi, &running);
+
+        bool finished = false;
+        int queued = 0;
+        while (CURLMsg *msg = curl_multi_info_read(d_multi, &queued)) {
+            if (msg->msg == CURLMSG_DONE) {
+                finish(msg->easy_handle, msg->data.result);
+                finished = true;
+            }
+        }
+
+        // Start the next transfers before waiting.
+        if (finished)
+            continue;
+
+        int timeout_ms = MAX_POLL_MS;
+        if (!d_retries.empty()) {
+            const auto now = chrono::steady_clock::now();
+            for (const auto &t: d_retries) {
+                const auto ms = chrono::duration_cast<chrono::milliseconds>(t->retry_at - now).count();
+                if (ms < timeout_ms)
+                    timeout_ms = ms < 0 ? 0 : static_cast<int>(ms);
+            }
+        }
+
+#if CURL_HAS_MULTI_WAKEUP
+        curl_multi_poll(d_multi, nullptr, 0, timeout_ms, nullptr);
+#else
+        curl_multi_wait(d_multi, nullptr, 0, min(timeout_ms, OLD_CURL_POLL_MS), nullptr);
+#endif
+    }
+
+    fail_all();
+}
+
+CurlMultiEngine::engine_stats CurlMultiEngine::stats() const
+{
+    engine_stats s;
+    s.transfers = d_transfers;
+    s.retries = d_retry_count;
+    s.failures = d_failures;
+    s.peak_in_flight = d_peak_in_flight;
+    s.peak_origin_in_flight = d_peak_origin_in_flight;
+    return s;
+}
+
+void CurlMultiEngine::dump(ostream &strm) const
+{
+    const auto s = stats();
+    strm << "CurlMultiEngine [pid: " << d_pid << "]" << endl
+         << "    max in flight: " << d_max_in_flight << " max per origin: " << d_max_per_origin
+         << " HTTP/2: " << (d_use_http2 ? "yes" : "no") << endl
+         << "    transfers: " << s.transfers << " retries: " << s.retries << " failures: " << s.failures << endl
+         << "    peak in flight: " << s.peak_in_flight << " peak per origin: " << s.peak_origin_in_flight << endl;
+}
+
+} // namespace dmrpp
@@ -0,0 +1,151 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dmrpp_curl_multi_engine_h
+#define _dmrpp_curl_multi_engine_h 1
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <curl/curl.h>
+
+namespace dmrpp {
+
+class dmrpp_easy_handle;
+
+/**
+ * @brief Run transfers using the libcurl multi interface.
+ *
+ * One event-loop thread owns a CURLM handle and drives every transfer added
+ * to it, so the number of requests in flight is not tied to the number of
+ * threads waiting for them. When HTTP/2 is enabled, requests to the same
+ * origin are multiplexed over one connection.
+ *
+ * At most max_in_flight transfers run at once, and at most max_per_origin of
+ * those go to any one origin (protocol and host). The rest wait, first in,
+ * first out, in a queue for their origin.
+ *
+ * A failed transfer is retried as curl::super_easy_perform() would retry it,
+ * except that the event loop does not sleep; the retry is scheduled instead.
+ *
+ * The completion functions run on the event-loop thread and must be short;
+ * they should hand off any real work (e.g., to the DmrppThreadPool).
+ *
+ * @note As with the DmrppThreadPool, threads do not survive fork(), so
+ * TheEngine() makes a new engine when called in a child process.
+ */
+class CurlMultiEngine {
+public:
+    /// Called when a transfer is done; the argument is null if it worked.
+    using completion = std::function<void(std::exception_ptr)>;
+
+    struct engine_stats {
+        unsigned long long transfers = 0;
+        unsigned long long retries = 0;
+        unsigned long long failures = 0;
+        unsigned long long peak_in_flight = 0;
+        unsigned long long peak_origin_in_flight = 0;
+    };
+
+private:
+    struct transfer {
+        dmrpp_easy_handle *handle = nullptr;
+        std::string origin;
+        completion done;
+        unsigned int attempts = 0;
+        std::chrono::steady_clock::time_point retry_at;
+        std::exception_ptr write_error;     // thrown while writing the response
+    };
+
+    CURLM *d_multi = nullptr;
+    unsigned int d_max_in_flight;
+    unsigned int d_max_per_origin;
+    bool d_use_http2;
+    pid_t d_pid;
+
+    // Transfers submitted but not yet seen by the event loop
+    std::mutex d_mtx;
+    std::condition_variable d_cv;
+    std::deque<std::shared_ptr<transfer>> d_submitted;
+    bool d_shutdown = false;
+
+    // These are only used by the event-loop thread
+    std::map<std::string, std::deque<std::shared_ptr<transfer>>> d_waiting;
+    std::map<std::string, unsigned int> d_origin_in_flight;
+    std::map<CURL *, std::shared_ptr<transfer>> d_active;
+    std::vector<std::shared_ptr<transfer>> d_retries;
+
+    std::atomic<unsigned long long> d_transfers{0};
+    std::atomic<unsigned long long> d_retry_count{0};
+    std::atomic<unsigned long long> d_failures{0};
+    std::atomic<unsigned long long> d_peak_in_flight{0};
+    std::atomic<unsigned long long> d_peak_origin_in_flight{0};
+
+    std::thread d_loop;
+
+    void event_loop();
+    bool take_submitted(bool wait);
+    void schedule_retries();
+    void start_transfers();
+    void start(const std::shared_ptr<transfer> &t);
+    void finish(CURL *curl, CURLcode code);
+    void complete(const std::shared_ptr<transfer> &t, const std::exception_ptr &error);
+    void fail_all();
+    void wakeup();
+
+    static size_t write_data(void *buffer, size_t size, size_t nmemb, void *data);
+
+    friend class CurlMultiEngineTest;
+
+public:
+    CurlMultiEngine(unsigned int max_in_flight, unsigned int max_per_origin, bool use_http2);
+    virtual ~CurlMultiEngine();
+
+    CurlMultiEngine(const CurlMultiEngine &) = delete;
+    CurlMultiEngine &operator=(const CurlMultiEngine &) = delete;
+
+    static CurlMultiEngine *TheEngine();
+
+    void submit(dmrpp_easy_handle *handle, completion done);
+    void perform(dmrpp_easy_handle *handle);
+
+    engine_stats stats() const;
+    void dump(std::ostream &strm) const;
+};
+
+} // namespace dmrpp
+
+#endif // _dmrpp_curl_multi_engine_h
@@ -52,6 +52,7 @@
 #include "DMRpp.h"
 #include "DMZ.h"                // this includes the pugixml header
 #include "Chunk.h"
+#include "ChunkFilters.h"
 #include "DmrppCommon.h"
 #include "DmrppArray.h"
 #include "DmrppStructure.h"
@@ -955,6 +956,10 @@ void DMZ::set_up_direct_io_flag_phase_2(BaseType *btp) {
     if (!has_deflate_filter || (deflate_levels.empty()))
         return;
 
+    // Filters other than deflate, shuffle and fletcher32 cannot be used with direct IO.
+    if (!filters_support_direct_io(filter))
+        return;
+
      // If the datatype is not little-endian, cannot do the direct IO. return.
      // The big-endian IEEE-floating-point data also needs byteswap. So we cannot do direct IO. KY 2024-03-03
     if (!is_le)
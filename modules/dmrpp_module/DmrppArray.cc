@@ -30,8 +30,6 @@
 #include <queue>
 #include <iterator>
 #include <thread>
-#include <future>         // std::async, std::future
-#include <chrono>         // std::chrono::milliseconds
 
 #include <cstring>
 #include <cassert>
@@ -54,12 +52,19 @@
 
 #include "byteswap_compat.h"
 #include "float_byteswap.h"
+#include "byte_kernels.h"
 #include "CurlHandlePool.h"
+#include "CurlMultiEngine.h"
 #include "Chunk.h"
+#include "ChunkBufferPool.h"
+#include "ChunkFilters.h"
+#include "inflate_util.h"
 #include "DmrppArray.h"
 #include "DmrppStructure.h"
 #include "DmrppRequestHandler.h"
+#include "DmrppThreadPool.h"
 #include "DmrppNames.h"
+#include "MultiRangeRequest.h"
 #include "Base64.h"
 #include "vlsa_util.h"
 
@@ -75,95 +80,6 @@ using namespace std;
 namespace dmrpp {
 
 
-// Transfer Thread Pool state variables.
-std::mutex transfer_thread_pool_mtx;     // mutex for critical section
-//atomic_ullong transfer_thread_counter(0);
-atomic_uint transfer_thread_counter(0);
-
-
-
-/**
- * @brief Uses future::wait_for() to scan the futures for a ready future, returning true when once get() has been called.
- *
- * When a valid, ready future is found future::get() is called and the thead_counter is decremented.
- * Returns true when it successfully "get"s a future (joins a thread), or if a future turns up as not valid, then
- * it is discarded and the thread is ":finished" and true is returned.
- *
- * @param futures The list of futures to scan
- * @param thread_counter This counter will be decremented when a future is "finished".
- * @param timeout The number of milliseconds to wait for each future to complete.
- * @param debug_prefix This is a string tag used in debugging to associate the particular debug call with the calling
- * method.
- * @return Returns true if future::get() was called on a ready future, false otherwise.
- */
-bool get_next_future(list<std::future<bool>> &futures, atomic_uint &thread_counter, unsigned long timeout, string debug_prefix) {
-    bool future_finished = false;
-    bool done = false;
-    std::chrono::milliseconds timeout_ms (timeout);
-
-    while(!done){
-        auto futr = futures.begin();
-        auto fend = futures.end();
-        bool future_is_valid = true;
-        while(!future_finished && future_is_valid && futr != fend){
-            future_is_valid = (*futr).valid();
-            if(future_is_valid){
-                // What happens if wait_for() always returns future_status::timeout for a stuck thread?
-                // If that were to happen, the loop would run forever. However, we assume that these
-                // threads are never 'stuck.' We assume that their computations always complete, either
-                // with success or failure. For the transfer threads, timeouts will stop them if nothing
-                // else does and for the decompression threads, the worst case is a segmentation fault.
-                // jhrg 2/5/21
-                if((*futr).wait_for(timeout_ms) != std::future_status::timeout){
-                    try {
-                        bool success = (*futr).get();
-                        future_finished = true;
-                        BESDEBUG(dmrpp_3, debug_prefix << prolog << "Called future::get() on a ready future."
-                            << " success: " << (success?"true":"false") << endl);
-                        if(!success){
-                            stringstream msg;
-                            msg << debug_prefix << prolog << "The std::future has failed!";
-                            msg << " thread_counter: " << thread_counter;
-                            throw BESInternalError(msg.str(), __FILE__, __LINE__);
-                        }
-                    }
-                    catch(...){
-                        // TODO I had to add this to make the thread counting work when there's errors
-                        //  But I think it's primitive because it trashes everything - there's
-                        //  surely a way to handle the situation on a per thread basis and maybe even
-                        //  retry?
-                        futures.clear();
-                        thread_counter=0;
-                        throw;
-                    }
-                }
-                else {
-                    futr++;
-                    BESDEBUG(dmrpp_3, debug_prefix << prolog << "future::wait_for() timed out. (timeout: " <<
-                        timeout << " ms) There are currently " << futures.size() << " futures in process."
-                        << " thread_counter: " << thread_counter << endl);
-                }
-            }
-            else {
-                BESDEBUG(dmrpp_3, debug_prefix << prolog << "The future was not valid. Dumping... " << endl);
-                future_finished = true;
-            }
-        }
-
-        if (futr!=fend && future_finished) {
-            futures.erase(futr);
-            thread_counter--;
-            BESDEBUG(dmrpp_3, debug_prefix << prolog << "Erased future from futures list. (Erased future was "
-                                  << (future_is_valid?"":"not ") << "valid at start.) There are currently " <<
-                                  futures.size() << " futures in process. thread_counter: " << thread_counter << endl);
-        }
-
-        done = future_finished || futures.empty();
-    }
-
-    return future_finished;
-}
-
 static void one_child_chunk_thread_new_sanity_check(const one_child_chunk_args_new *args) {
     if (!args->the_one_chunk->get_rbuf()) {
         throw BESInternalError("one_child_chunk_thread_new_sanity_check() - the_one_chunk->get_rbuf() is NULL!", __FILE__, __LINE__);
@@ -186,7 +102,7 @@ static void one_child_chunk_thread_new_sanity_check(const one_child_chunk_args_n
  *
  * @param arg_list A pointer to a one_child_chunk_args
  */
-bool one_child_chunk_thread_new(const unique_ptr<one_child_chunk_args_new> &args)
+bool one_child_chunk_thread_new(const shared_ptr<one_child_chunk_args_new> &args)
 {
     args->child_chunk->read_chunk();
 
@@ -212,11 +128,11 @@ bool one_child_chunk_thread_new(const unique_ptr<one_child_chunk_args_new> &args
 }
 
 /**
- * @brief A single argument wrapper for process_super_chunk() for use with std::async().
- * @param args A unique_ptr to an instance of one_super_chunk_args.
+ * @brief A single argument wrapper for process_super_chunk() for use with the DmrppThreadPool.
+ * @param args A shared_ptr to an instance of one_super_chunk_args.
  * @return True unless an exception is throw in which case neither true or false apply.
  */
-bool one_super_chunk_transfer_thread(const unique_ptr<one_super_chunk_args> &args)
+bool one_super_chunk_transfer_thread(const shared_ptr<one_super_chunk_args> &args)
 {
 
 #if DMRPP_ENABLE_THREAD_TIMERS
@@ -232,11 +148,11 @@ bool one_super_chunk_transfer_thread(const unique_ptr<one_super_chunk_args> &arg
 }
 
 /**
- * @brief A single argument wrapper for process_super_chunk_unconstrained() for use with std::async().
- * @param args A unique_ptr to an instance of one_super_chunk_args.
+ * @brief A single argument wrapper for process_super_chunk_unconstrained() for use with the DmrppThreadPool.
+ * @param args A shared_ptr to an instance of one_super_chunk_args.
  * @return True unless an exception is throw in which case neither true or false apply.
  */
-bool one_super_chunk_unconstrained_transfer_thread(const unique_ptr<one_super_chunk_args> &args)
+bool one_super_chunk_unconstrained_transfer_thread(const shared_ptr<one_super_chunk_args> &args)
 {
 
 #if DMRPP_ENABLE_THREAD_TIMERS
@@ -251,7 +167,7 @@ bool one_super_chunk_unconstrained_transfer_thread(const unique_ptr<one_super_ch
     return true;
 }
 
-bool one_super_chunk_unconstrained_transfer_thread_dio(const unique_ptr<one_super_chunk_args> &args)
+bool one_super_chunk_unconstrained_transfer_thread_dio(const shared_ptr<one_super_chunk_args> &args)
 {
 
 #if DMRPP_ENABLE_THREAD_TIMERS
@@ -267,98 +183,22 @@ bool one_super_chunk_unconstrained_transfer_thread_dio(const unique_ptr<one_supe
 }
 
 
-bool start_one_child_chunk_thread(list<std::future<bool>> &futures, unique_ptr<one_child_chunk_args_new> args) {
-    bool retval = false;
-    std::unique_lock<std::mutex> lck (transfer_thread_pool_mtx);
-    if (transfer_thread_counter < DmrppRequestHandler::d_max_transfer_threads) {
-        transfer_thread_counter++;
-        futures.push_back(std::async(std::launch::async, one_child_chunk_thread_new, std::move(args)));
-        retval = true;
-
-        // The args may be null after move(args) is called and causes the segmentation fault in the following BESDEBUG.
-        // So remove that part but leave the futures.size() for bookkeeping.
-        BESDEBUG(dmrpp_3, prolog << "Got std::future '" << futures.size() <<endl);
-    }
-    return retval;
-}
-
-
 /**
- * @brief Starts the super_chunk_thread function using std::async() and places the returned future in the queue futures.
- * @param futures The queue into which to place the std::future returned by std::async().
- * @param args The arguments for the super_chunk_thread function
- * @return Returns true if the std::async() call was made and a future was returned, false if the
- * transfer_thread_counter has reached the maximum allowable size.
- */
-bool start_super_chunk_transfer_thread(list<std::future<bool>> &futures, unique_ptr<one_super_chunk_args> args) {
-    bool retval = false;
-    std::unique_lock<std::mutex> lck (transfer_thread_pool_mtx);
-    if (transfer_thread_counter < DmrppRequestHandler::d_max_transfer_threads) {
-        transfer_thread_counter++;
-        futures.push_back(std::async(std::launch::async, one_super_chunk_transfer_thread, std::move(args)));
-        retval = true;
-       
-        // The args may be null after move(args) is called and causes the segmentation fault in the following BESDEBUG.
-        // So remove that part but leave the futures.size() for bookkeeping.
-        BESDEBUG(dmrpp_3, prolog << "Got std::future '" << futures.size() <<endl);
- 
-    }
-    return retval;
-}
-
-/**
- * @brief Starts the one_super_chunk_unconstrained_transfer_thread function using std::async() and places the returned future in the queue futures.
- * @param futures The queue into which to place the future returned by std::async().
- * @param args The arguments for the super_chunk_thread function
- * @return Returns true if the async call was made and a future was returned, false if the transfer_thread_counter has
- * reached the maximum allowable size.
- */
-bool start_super_chunk_unconstrained_transfer_thread(list<std::future<bool>> &futures, unique_ptr<one_super_chunk_args> args) {
-    bool retval = false;
-    std::unique_lock<std::mutex> lck (transfer_thread_pool_mtx);
-    if(transfer_thread_counter < DmrppRequestHandler::d_max_transfer_threads) {
-        transfer_thread_counter++;
-        futures.push_back(std::async(std::launch::async, one_super_chunk_unconstrained_transfer_thread, std::move(args)));
-        retval = true;
-
-        // The args may be null after move(args) is called and causes the segmentation fault in the following BESDEBUG.
-        // So remove that part but leave the futures.size() for bookkeeping.
-        BESDEBUG(dmrpp_3, prolog << "Got std::future '" << futures.size() <<endl);
- 
-    }
-    return retval;
-}
-
-bool start_super_chunk_unconstrained_transfer_thread_dio(list<std::future<bool>> &futures, unique_ptr<one_super_chunk_args> args) {
-    bool retval = false;
-    std::unique_lock<std::mutex> lck (transfer_thread_pool_mtx);
-    if(transfer_thread_counter < DmrppRequestHandler::d_max_transfer_threads) {
-        transfer_thread_counter++;
-        futures.push_back(std::async(std::launch::async, one_super_chunk_unconstrained_transfer_thread_dio, std::move(args)));
-        retval = true;
-        BESDEBUG(dmrpp_3, prolog << "Got std::future '" << futures.size() <<
-                                            "' from std::async, transfer_thread_counter: " << transfer_thread_counter << endl);
-    }
-    return retval;
-}
-
-
-/**
- * @brief Uses std::async() and std::future to process the SuperChunks in super_chunks into the DmrppArray array.
+ * @brief Process the SuperChunks in super_chunks into the DmrppArray array using the transfer lane of the DmrppThreadPool.
  *
- * For each SuperChunk in the queue, retrieve the chunked data by using std::async() to generate a std::future which will
- * perform the data retrieval and subsequent computational steps(inflate/shuffle/etc) and finally insertion into the
- * DmrppArray's internal data buffer.
+ * For each SuperChunk in the queue, make a task which will perform the data retrieval and subsequent
+ * computational steps (inflate/shuffle/etc.) and finally insertion into the DmrppArray's internal data buffer.
+ * The tasks are run by the process-wide pool and this function returns once all of them are done. If any
+ * task fails, the SuperChunks that have not been started are skipped and the first error is rethrown.
  *
- * NOTE: There are 4 variants of this function:
+ * When DMRPP.UseCurlMulti is true, the transfers are run by the CurlMultiEngine instead and
+ * each SuperChunk is processed once its transfer completes. See read_super_chunks_async().
  *
- *  - process_chunks_concurrent()
- *  - process_chunks_unconstrained_concurrent()
- *  - read_super_chunks_concurrent()
- *  - read_super_chunks_unconstrained_concurrent
+ * NOTE: There are 3 variants of this function:
  *
- *  If structural/algorithmic changes need to be made to this function it is almost certain that similar changes will
- *  be required in the other 3 functions.
+ *  - read_super_chunks_concurrent()
+ *  - read_super_chunks_unconstrained_concurrent()
+ *  - read_super_chunks_unconstrained_concurrent_dio()
  *
  * @param super_chunks The queue of SuperChunk objects to process.
  * @param array The DmrppArray into which the chunk data will be placed.
@@ -368,151 +208,49 @@ void read_super_chunks_unconstrained_concurrent(queue<shared_ptr<SuperChunk>> &s
     BESStopWatch sw;
     if (BESDebug::IsSet(TIMING_LOG_KEY)) sw.start(prolog + " name: "+array->name(), "");
 
-    // Parallel version based on read_chunks_unconstrained(). There is
-    // substantial duplication of the code in read_chunks_unconstrained(), but
-    // wait to remove that when we move to C++11 which has threads integrated.
-
-    // We maintain a list  of futures to track our parallel activities.
-    list<future<bool>> futures;
-    try {
-        bool done = false;
-        bool future_finished = true;
-        while (!done) {
-
-            if(!futures.empty())
-                future_finished = get_next_future(futures, transfer_thread_counter, DMRPP_WAIT_FOR_FUTURE_MS, prolog);
-
-            // If future_finished is true this means that the chunk_processing_thread_counter has been decremented,
-            // because future::get() was called or a call to future::valid() returned false.
-            BESDEBUG(dmrpp_3, prolog << "future_finished: " << (future_finished ? "true" : "false") << endl);
-
-            if (!super_chunks.empty()){
-                // Next we try to add a new Chunk compute thread if we can - there might be room.
-                bool thread_started = true;
-                while(thread_started && !super_chunks.empty()) {
-                    auto super_chunk = super_chunks.front();
-                    BESDEBUG(dmrpp_3, prolog << "Starting thread for " << super_chunk->to_string(false) << endl);
-
-                    auto args = unique_ptr<one_super_chunk_args>(new one_super_chunk_args(super_chunk, array));
-                    thread_started = start_super_chunk_unconstrained_transfer_thread(futures, std::move(args));
-
-                    if (thread_started) {
-                        super_chunks.pop();
-                        BESDEBUG(dmrpp_3, prolog << "STARTED thread for " << super_chunk->to_string(false) << endl);
-                    } else {
-                        // Thread did not start, ownership of the arguments was not passed to the thread.
-                        BESDEBUG(dmrpp_3, prolog << "Thread not started. args deleted, Chunk remains in queue.)" <<
-                                                            " transfer_thread_counter: " << transfer_thread_counter <<
-                                                            " futures.size(): " << futures.size() << endl);
-                    }
-                }
-            }
-            else {
-                // No more Chunks and no futures means we're done here.
-                if(futures.empty())
-                    done = true;
-            }
-            future_finished = false;
-        }
+    if (DmrppRequestHandler::d_use_curl_multi) {
+        read_super_chunks_async(super_chunks, [array](const shared_ptr<SuperChunk> &super_chunk) {
+            one_super_chunk_unconstrained_transfer_thread(make_shared<one_super_chunk_args>(super_chunk, array));
+        });
+        return;
     }
-    catch (...) {
-        // Complete all the futures, otherwise we'll have threads out there using up resources
-        while(!futures.empty()){
-            if(futures.back().valid())
-                futures.back().get();
-            futures.pop_back();
-        }
-        // re-throw the exception
-        throw;
+
+    vector<DmrppThreadPool::task> tasks;
+    tasks.reserve(super_chunks.size());
+    while (!super_chunks.empty()) {
+        auto args = make_shared<one_super_chunk_args>(super_chunks.front(), array);
+        super_chunks.pop();
+        BESDEBUG(dmrpp_3, prolog << "Queuing task for " << args->super_chunk->to_string(false) << endl);
+        tasks.emplace_back([args]() { one_super_chunk_unconstrained_transfer_thread(args); });
     }
+
+    DmrppThreadPool::TheThreadPool()->run_tasks(transfer_lane, tasks);
 }
 
-// Clone of read_super_chunks_unconstrained_concurrent for direct IO. 
+// Clone of read_super_chunks_unconstrained_concurrent for direct IO.
 // Doing this to ensure direct IO won't affect the regular operations.
 void read_super_chunks_unconstrained_concurrent_dio(queue<shared_ptr<SuperChunk>> &super_chunks, DmrppArray *array)
 {
     BESStopWatch sw;
     if (BESDebug::IsSet(TIMING_LOG_KEY)) sw.start(prolog + " name: "+array->name(), "");
 
-    // Parallel version based on read_chunks_unconstrained(). There is
-    // substantial duplication of the code in read_chunks_unconstrained(), but
-    // wait to remove that when we move to C++11 which has threads integrated.
-
-    // We maintain a list  of futures to track our parallel activities.
-    list<future<bool>> futures;
-    try {
-        bool done = false;
-        bool future_finished = true;
-        while (!done) {
-
-            if(!futures.empty())
-                future_finished = get_next_future(futures, transfer_thread_counter, DMRPP_WAIT_FOR_FUTURE_MS, prolog);
-
-            // If future_finished is true this means that the chunk_processing_thread_counter has been decremented,
-            // because future::get() was called or a call to future::valid() returned false.
-            BESDEBUG(dmrpp_3, prolog << "future_finished: " << (future_finished ? "true" : "false") << endl);
-
-            if (!super_chunks.empty()){
-                // Next we try to add a new Chunk compute thread if we can - there might be room.
-                bool thread_started = true;
-                while(thread_started && !super_chunks.empty()) {
-                    auto super_chunk = super_chunks.front();
-                    BESDEBUG(dmrpp_3, prolog << "Starting thread for " << super_chunk->to_string(false) << endl);
-
-                    auto args = unique_ptr<one_super_chunk_args>(new one_super_chunk_args(super_chunk, array));
-
-                    // direct IO calling
-                    thread_started = start_super_chunk_unconstrained_transfer_thread_dio(futures, std::move(args));
-
-                    if (thread_started) {
-                        super_chunks.pop();
-                        BESDEBUG(dmrpp_3, prolog << "STARTED thread for " << super_chunk->to_string(false) << endl);
-                    } else {
-                        // Thread did not start, ownership of the arguments was not passed to the thread.
-                        BESDEBUG(dmrpp_3, prolog << "Thread not started. args deleted, Chunk remains in queue.)" <<
-                                                            " transfer_thread_counter: " << transfer_thread_counter <<
-                                                            " futures.size(): " << futures.size() << endl);
-                    }
-                }
-            }
-            else {
-                // No more Chunks and no futures means we're done here.
-                if(futures.empty())
-                    done = true;
-            }
-            future_finished = false;
-        }
+    vector<DmrppThreadPool::task> tasks;
+    tasks.reserve(super_chunks.size());
+    while (!super_chunks.empty()) {
+        auto args = make_shared<one_super_chunk_args>(super_chunks.front(), array);
+        super_chunks.pop();
+        BESDEBUG(dmrpp_3, prolog << "Queuing task for " << args->super_chunk->to_string(false) << endl);
+        // direct IO calling
+        tasks.emplace_back([args]() { one_super_chunk_unconstrained_transfer_thread_dio(args); });
     }
-    catch (...) {
-        // Complete all the futures, otherwise we'll have threads out there using up resources
-        while(!futures.empty()){
-            if(futures.back().valid())
-                futures.back().get();
-            futures.pop_back();
-        }
-        // re-throw the exception
-        throw;
-    }
-}
 
+    DmrppThreadPool::TheThreadPool()->run_tasks(transfer_lane, tasks);
+}
 
 /**
- * @brief Uses std::async and std::future to process the SuperChunks in super_chunks into the DmrppArray array.
- *
- * For each SuperChunk in the queue, retrieve the chunked data by using std::async() to generate a std::future which will
- * perform the data retrieval and subsequent computational steps(inflate/shuffle/etc) and finally insertion into the
- * DmrppArray's internal data buffer.
- *
- * NOTE: There are 4 variants of this function:
- *
- *  - process_chunks_concurrent()
- *  - process_chunks_unconstrained_concurrent()
- *  - read_super_chunks_concurrent()
- *  - read_super_chunks_unconstrained_concurrent
- *
- *  If structural/algorithmic changes need to be made to this function it is almost certain that similar changes will
- *  be required in the other 3 functions.
+ * @brief Process the SuperChunks in super_chunks into the DmrppArray array using the transfer lane of the DmrppThreadPool.
  *
+ * @see read_super_chunks_unconstrained_concurrent()
  * @param super_chunks The queue of SuperChunk objects to process.
  * @param array The DmrppArray into which the chunk data will be placed.
  */
@@ -521,63 +259,23 @@ void read_super_chunks_concurrent(queue< shared_ptr<SuperChunk> > &super_chunks,
     BESStopWatch sw;
     if (BESDebug::IsSet(TIMING_LOG_KEY)) sw.start(prolog + " name: "+array->name(), "");
 
-    // Parallel version based on read_chunks_unconstrained(). There is
-    // substantial duplication of the code in read_chunks_unconstrained(), but
-    // wait to remove that when we move to C++11 which has threads integrated.
-
-    // We maintain a list  of futures to track our parallel activities.
-    list<future<bool>> futures;
-    try {
-        bool done = false;
-        bool future_finished = true;
-        while (!done) {
-
-            if(!futures.empty())
-                future_finished = get_next_future(futures, transfer_thread_counter, DMRPP_WAIT_FOR_FUTURE_MS, prolog);
-
-            // If future_finished is true this means that the chunk_processing_thread_counter has been decremented,
-            // because future::get() was called or a call to future::valid() returned false.
-            BESDEBUG(dmrpp_3, prolog << "future_finished: " << (future_finished ? "true" : "false") << endl);
-
-            if (!super_chunks.empty()){
-                // Next we try to add a new Chunk compute thread if we can - there might be room.
-                bool thread_started = true;
-                while(thread_started && !super_chunks.empty()) {
-                    auto super_chunk = super_chunks.front();
-                    BESDEBUG(dmrpp_3, prolog << "Starting thread for " << super_chunk->to_string(false) << endl);
-
-                    auto args = unique_ptr<one_super_chunk_args>(new one_super_chunk_args(super_chunk, array));
-                    thread_started = start_super_chunk_transfer_thread(futures, std::move(args));
-
-                    if (thread_started) {
-                        super_chunks.pop();
-                        BESDEBUG(dmrpp_3, prolog << "STARTED thread for " << super_chunk->to_string(false) << endl);
-                    } else {
-                        // Thread did not start, ownership of the arguments was not passed to the thread.
-                        BESDEBUG(dmrpp_3, prolog << "Thread not started. args deleted, Chunk remains in queue.)" <<
-                                                            " transfer_thread_counter: " << transfer_thread_counter <<
-                                                            " futures.size(): " << futures.size() << endl);
-                    }
-                }
-            }
-            else {
-                // No more Chunks and no futures means we're done here.
-                if(futures.empty())
-                    done = true;
-            }
-            future_finished = false;
-        }
+    if (DmrppRequestHandler::d_use_curl_multi) {
+        read_super_chunks_async(super_chunks, [array](const shared_ptr<SuperChunk> &super_chunk) {
+            one_super_chunk_transfer_thread(make_shared<one_super_chunk_args>(super_chunk, array));
+        });
+        return;
     }
-    catch (...) {
-        // Complete all the futures, otherwise we'll have threads out there using up resources
-        while(!futures.empty()){
-            if(futures.back().valid())
-                futures.back().get();
-            futures.pop_back();
-        }
-        // re-throw the exception
-        throw;
+
+    vector<DmrppThreadPool::task> tasks;
+    tasks.reserve(super_chunks.size());
+    while (!super_chunks.empty()) {
+        auto args = make_shared<one_super_chunk_args>(super_chunks.front(), array);
+        super_chunks.pop();
+        BESDEBUG(dmrpp_3, prolog << "Queuing task for " << args->super_chunk->to_string(false) << endl);
+        tasks.emplace_back([args]() { one_super_chunk_transfer_thread(args); });
     }
+
+    DmrppThreadPool::TheThreadPool()->run_tasks(transfer_lane, tasks);
 }
 
 /**
@@ -907,58 +605,17 @@ void DmrppArray::read_contiguous()
         else 
             chunks_to_read.push(shared_ptr<Chunk>(new Chunk(chunk_byteorder,the_one_chunk->get_fill_value(),the_one_chunk->get_fill_value_type(), chunk_size, chunk_offset)));
 
-        // We maintain a list  of futures to track our parallel activities.
-        list<future<bool>> futures;
-        try {
-            bool done = false;
-            bool future_finished = true;
-            while (!done) {
-
-                if (!futures.empty())
-                    future_finished = get_next_future(futures, transfer_thread_counter, DMRPP_WAIT_FOR_FUTURE_MS, prolog);
-
-                // If future_finished is true this means that the chunk_processing_thread_counter has been decremented,
-                // because future::get() was called or a call to future::valid() returned false.
-                BESDEBUG(dmrpp_3, prolog << "future_finished: " << (future_finished ? "true" : "false") << endl);
-                if (!chunks_to_read.empty()) {
-                    // Next we try to add a new Chunk compute thread if we can - there might be room.
-                    bool thread_started = true;
-                    while (thread_started && !chunks_to_read.empty()) {
-                        auto current_chunk = chunks_to_read.front();
-                        BESDEBUG(dmrpp_3, prolog << "Starting thread for " << current_chunk->to_string() << endl);
-
-                        auto args = unique_ptr<one_child_chunk_args_new>(new one_child_chunk_args_new(current_chunk, the_one_chunk));
-
-                        thread_started = start_one_child_chunk_thread(futures, std::move(args));
-
-                        if (thread_started) {
-                            chunks_to_read.pop();
-                            BESDEBUG(dmrpp_3, prolog << "STARTED thread for " << current_chunk->to_string() << endl);
-                        } else {
-                            // Thread did not start, ownership of the arguments was not passed to the thread.
-                            BESDEBUG(dmrpp_3, prolog << "Thread not started. args deleted, Chunk remains in queue.)" <<
-                                                     " transfer_thread_counter: " << transfer_thread_counter <<
-                                                     " futures.size(): " << futures.size() << endl);
-                        }
-                    }
-                } else {
-                    // No more Chunks and no futures means we're done here.
-                    if (futures.empty())
-                        done = true;
-                }
-                future_finished = false;
-            }
-        }
-        catch (...) {
-            // Complete all the futures, otherwise we'll have threads out there using up resources
-            while (!futures.empty()) {
-                if (futures.back().valid())
-                    futures.back().get();
-                futures.pop_back();
-            }
-            // re-throw the exception
-            throw;
+        // Each child chunk is read by a task in the transfer lane; the tasks copy
+        // their bytes into the_one_chunk's buffer.
+        vector<DmrppThreadPool::task> tasks;
+        tasks.reserve(chunks_to_read.size());
+        while (!chunks_to_read.empty()) {
+            auto args = make_shared<one_child_chunk_args_new>(chunks_to_read.front(), the_one_chunk);
+            chunks_to_read.pop();
+            tasks.emplace_back([args]() { one_child_chunk_thread_new(args); });
         }
+
+        DmrppThreadPool::TheThreadPool()->run_tasks(transfer_lane, tasks);
     }
     BESDEBUG(dmrpp_3, prolog << "Before is_filter " << endl);
 
@@ -1111,6 +768,51 @@ void DmrppArray::insert_chunk_unconstrained(shared_ptr<Chunk> chunk, unsigned in
     }
 }
 
+/**
+ * @brief Where does an unconstrained chunk go if it fills one contiguous run of the Array?
+ *
+ * A chunk's values land in one contiguous run of the Array's value buffer
+ * when, after any leading dimensions where the chunk has size one, the chunk
+ * spans the whole of every remaining dimension but the first (e.g., chunks of
+ * 1 x 1 x ny x nx or k x ny x nx in an Array of nt x nz x ny x nx). Such a
+ * chunk can be decoded straight into the Array's buffer, skipping both the
+ * decoded copy of the chunk and insert_chunk_unconstrained().
+ *
+ * @param chunk The chunk
+ * @param array_shape The size of the Array's dimensions
+ * @param chunk_shape The size of the chunk's dimensions
+ * @return The address of the chunk's first value in the Array's buffer, or
+ * nullptr if the chunk is not contiguous there or extends beyond the Array.
+ */
+char *DmrppArray::contiguous_chunk_target(const shared_ptr<Chunk> &chunk, const vector<unsigned long long> &array_shape,
+                                          const vector<unsigned long long> &chunk_shape)
+{
+    const vector<unsigned long long> &chunk_origin = chunk->get_position_in_array();
+    if (chunk_shape.empty() || chunk_shape.size() != array_shape.size() || chunk_origin.size() != array_shape.size())
+        return nullptr;
+
+    const unsigned int last_dim = chunk_shape.size() - 1;
+    unsigned int dim = 0;
+    while (dim < last_dim && chunk_shape[dim] == 1)
+        ++dim;
+
+    // Edge chunks that extend beyond the Array are copied the usual way.
+    if (chunk_origin[dim] + chunk_shape[dim] > array_shape[dim])
+        return nullptr;
+
+    for (unsigned int d = dim + 1; d <= last_dim; ++d) {
+        if (chunk_shape[d] != array_shape[d])
+            return nullptr;
+    }
+
+    unsigned long long array_offset = chunk_origin[last_dim];
+    for (unsigned int d = 0; d < last_dim; ++d)
+        array_offset += chunk_origin[d] * multiplier(array_shape, d);
+
+    char *target_buffer = is_readable_struct ? d_structure_array_buf.data() : get_buf();
+    return target_buffer + array_offset * bytes_per_element;
+}
+
 // The direct IO routine to insert the unconstrained chunks.
 void DmrppArray::insert_chunk_unconstrained_dio(shared_ptr<Chunk> chunk) {
 
@@ -1353,7 +1055,7 @@ void DmrppArray::read_linked_blocks(){
             char *dest_deflate = nullptr;
             unsigned long long dest_len = get_var_chunks_storage_size();
             unsigned long long src_len = get_var_chunks_storage_size();
-            dest_deflate = new char[dest_len];
+            dest_deflate = ChunkBufferPool::ThePool()->allocate(dest_len);
             destp = &dest_deflate;
             inflate_simple(destp, dest_len, in_buf, src_len);
             
@@ -1361,7 +1063,7 @@ void DmrppArray::read_linked_blocks(){
             reserve_value_capacity_ll_byte(this->width_ll());
             char *out_buf = get_buf();
             memcpy(out_buf,dest_deflate,this->width_ll());
-            delete []dest_deflate; 
+            ChunkBufferPool::ThePool()->release(dest_deflate);
         }
     }
 
@@ -1465,7 +1167,7 @@ void DmrppArray::read_linked_blocks_constrained(){
         char *dest_deflate = nullptr;
         unsigned long long dest_len = get_var_chunks_storage_size();
         unsigned long long src_len = get_var_chunks_storage_size();
-        dest_deflate = new char[dest_len];
+        dest_deflate = ChunkBufferPool::ThePool()->allocate(dest_len);
         destp = &dest_deflate;
         unsigned long long deflated_length = inflate_simple(destp, dest_len, target_buffer, src_len);
         BESDEBUG(dmrpp_3, prolog << "deflated length: " <<  deflated_length << endl);
@@ -1477,7 +1179,7 @@ void DmrppArray::read_linked_blocks_constrained(){
         uncompressed_values.resize(this->width_ll());
         memcpy(uncompressed_values.data(),dest_deflate,this->width_ll());
 #endif
-        delete []dest_deflate; 
+        ChunkBufferPool::ThePool()->release(dest_deflate);
 
         is_compressed = true;
     }
@@ -1498,97 +1200,11 @@ void DmrppArray::read_linked_blocks_constrained(){
 
 
 
+/**
+ * @brief Inflate a buffer; see dmrpp::inflate().
+ */
 unsigned long long DmrppArray::inflate_simple(char **destp, unsigned long long dest_len, char *src, unsigned long long src_len) {
-
-
-    /* Sanity check */
-
-    if (src_len == 0) {
-        string msg = prolog + "ERROR! The number of bytes to inflate is zero.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-    if (dest_len == 0) {
-        string msg = prolog + "ERROR! The number of bytes to inflate into is zero.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-    if (!destp || !*destp) {
-        string msg = prolog + "ERROR! The destination buffer is NULL.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-    if (!src) {
-        string msg = prolog + "ERROR! The source buffer is NULL.";
-        BESDEBUG(MODULE, msg << endl);
-        throw BESInternalError(msg, __FILE__, __LINE__);
-    }
-
-    /* Input; uncompress */
-    z_stream z_strm; /* zlib parameters */
-
-    /* Set the decompression parameters */
-    memset(&z_strm, 0, sizeof(z_strm));
-    z_strm.next_in = (Bytef *) src;
-    z_strm.avail_in = src_len;
-    z_strm.next_out = (Bytef *) (*destp);
-    z_strm.avail_out = dest_len;
-
-    size_t nalloc = dest_len;
-
-    char *outbuf = *destp;
-
-    /* Initialize the decompression routines */
-    if (Z_OK != inflateInit(&z_strm))
-        throw BESError("Failed to initialize inflate software.", BES_INTERNAL_ERROR, __FILE__, __LINE__);
-
-
-    /* Loop to uncompress the buffer */
-    int status = Z_OK;
-    do {
-        /* Uncompress some data */
-        status = inflate(&z_strm, Z_SYNC_FLUSH);
-
-        /* Check if we are done decompressing data */
-        if (Z_STREAM_END == status) break; /*done*/
-
-        /* Check for error */
-        if (Z_OK != status) {
-            stringstream err_msg;
-            err_msg << "Failed to inflate data chunk.";
-            char const *err_msg_cstr = z_strm.msg;
-            if(err_msg_cstr)
-                err_msg << " zlib message: " << err_msg_cstr;
-            (void) inflateEnd(&z_strm);
-            throw BESError(err_msg.str(), BES_INTERNAL_ERROR, __FILE__, __LINE__);
-        }
-        else {
-            // If we're not done and just ran out of buffer space, we need to extend the buffer.
-            // We may encounter this case when the deflate filter is used twice. KY 2022-08-03
-            if (0 == z_strm.avail_out) {
-
-                /* Allocate a buffer twice as big */
-                size_t outbuf_size = nalloc;
-                nalloc *= 2;
-                char* new_outbuf = new char[nalloc];
-                memcpy((void*)new_outbuf,(void*)outbuf,outbuf_size);
-                delete[] outbuf;
-                outbuf = new_outbuf;
-
-                /* Update pointers to buffer for next set of uncompressed data */
-                z_strm.next_out = (unsigned char*) outbuf + z_strm.total_out;
-                z_strm.avail_out = (uInt) (nalloc - z_strm.total_out);
-
-            } /* end if */
-        } /* end else */
-    } while (true /* status == Z_OK */);    // Exit via the break statement after the call to inflate(). jhrg 11/8/21
-
-    *destp = outbuf;
-    outbuf = nullptr;
-    /* Finish decompressing the stream */
-    (void) inflateEnd(&z_strm);
-
-    return z_strm.total_out;
+    return dmrpp::inflate(destp, dest_len, src, src_len);
 }
 
 
@@ -1870,6 +1486,12 @@ void DmrppArray::read_chunks()
     BESDEBUG(dmrpp_3, prolog << "d_max_compute_threads: " << DmrppRequestHandler::d_max_compute_threads << endl);
     BESDEBUG(dmrpp_3, prolog << "SuperChunks.size(): " << super_chunks.size() << endl);
 
+    // A constraint often selects SuperChunks scattered through the file. Read as
+    // many of them as possible using multi-range requests; those are marked as
+    // read and are only processed below.
+    if (DmrppRequestHandler::d_use_multi_range_requests && super_chunks.size() > 1)
+        read_super_chunks_multi_range(super_chunks);
+
     if (!DmrppRequestHandler::d_use_transfer_threads) {
         // This version is the 'serial' version of the code. It reads a chunk, inserts it,
         // reads the next one, and so on.
@@ -2533,46 +2155,39 @@ bool DmrppArray::read()
         throw;
     }
 
+    if (BESDebug::IsSet(SUPER_CHUNK_STATS)) {
+        ostringstream oss;
+        SuperChunk::dump_transfer_stats(oss);
+        BESDEBUG(SUPER_CHUNK_STATS, prolog << FQN() << " " << oss.str());
+    }
+
+    if (BESDebug::IsSet(BUFFER_POOL)) {
+        ostringstream oss;
+        ChunkBufferPool::ThePool()->dump(oss);
+        BESDEBUG(BUFFER_POOL, prolog << FQN() << " " << oss.str());
+    }
+
+    if (BESDebug::IsSet(CURL_MULTI) && DmrppRequestHandler::d_use_curl_multi) {
+        ostringstream oss;
+        CurlMultiEngine::TheEngine()->dump(oss);
+        BESDEBUG(CURL_MULTI, prolog << FQN() << " " << oss.str());
+    }
+
     if (this->twiddle_bytes()) {
 
         int64_t num = this->length_ll();
 
         switch (var_type) {
             case dods_int16_c:
-            case dods_uint16_c: {
-                auto *local = reinterpret_cast<dods_uint16*>(this->get_buf());
-                while (num--) {
-                    *local = bswap_16(*local);
-                    local++;
-                }
-                break;
-            }
+            case dods_uint16_c:
             case dods_int32_c:
-            case dods_uint32_c: {
-                auto *local = reinterpret_cast<dods_uint32*>(this->get_buf());;
-                while (num--) {
-                    *local = bswap_32(*local);
-                    local++;
-                }
-                break;
-            }
+            case dods_uint32_c:
             case dods_int64_c:
-            case dods_uint64_c: {
-                auto *local = reinterpret_cast<dods_uint64*>(this->get_buf());;
-                while (num--) {
-                    *local = bswap_64(*local);
-                    local++;
-                }
+            case dods_uint64_c:
+            case dods_float32_c:
+            case dods_float64_c:
+                bes::byteswap_array(this->get_buf(), num, this->prototype()->width());
                 break;
-            }
-            case dods_float32_c: {
-                swap_float32(this->get_buf(), num);
-                break;
-            }
-            case dods_float64_c: {
-                swap_float64(this->get_buf(), num);
-                break;
-            }
             default: break; // Do nothing for all other types.
         }
     }
@@ -3075,7 +2690,8 @@ bool DmrppArray::use_direct_io_opt() {
     // Check if having the deflate filters.
     if (no_constraint) {
         string filters_string = this->get_filters();
-        if (filters_string.find("deflate")!=string::npos)
+        // Direct IO is only possible when every filter can be described to the netCDF-4 library.
+        if (filters_string.find("deflate")!=string::npos && filters_support_direct_io(filters_string))
             has_deflate_filter = true;
     }
 
@@ -30,7 +30,6 @@
 #include <thread>
 #include <memory>
 #include <queue>
-#include <future>
 #include <list>
 
 #include <libdap/Array.h>
@@ -140,6 +139,10 @@ private:
                                     unsigned long long chunk_offset, const std::vector<unsigned long long> &chunk_shape,
                                     const std::vector<unsigned long long> &chunk_origin);
 
+    char *contiguous_chunk_target(const std::shared_ptr<Chunk> &chunk,
+                                  const std::vector<unsigned long long> &array_shape,
+                                  const std::vector<unsigned long long> &chunk_shape);
+
     virtual void insert_chunk_unconstrained_dio(std::shared_ptr<Chunk> chunk);
    
     void read_chunks();
@@ -292,8 +295,6 @@ struct one_child_chunk_args_new {
 };
 
 
-bool get_next_future(list< std::future<bool> > &futures, atomic_uint &thread_counter, unsigned long timeout, string debug_prefix);
-
 } // namespace dmrpp
 
 #endif // _dmrpp_array_h
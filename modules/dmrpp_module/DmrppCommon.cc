@@ -53,6 +53,7 @@
 #include "DmrppRequestHandler.h"
 #include "DmrppCommon.h"
 #include "Chunk.h"
+#include "ChunkFilters.h"
 #include "byteswap_compat.h"
 #include "Base64.h"
 
@@ -106,11 +107,11 @@ void join_threads(pthread_t threads[], unsigned int num_threads)
 void DmrppCommon::set_filter(const string &value) {
     if (DmrppRequestHandler::d_emulate_original_filter_order_behavior) {
         d_filters = "";
-        if (value.find("shuffle") != string::npos)
+        if (has_filter(value, "shuffle"))
             d_filters.append(" shuffle");
-        if (value.find("deflate") != string::npos)
+        if (has_filter(value, "deflate"))
             d_filters.append(" deflate");
-        if (value.find("fletcher32") != string::npos)
+        if (has_filter(value, "fletcher32"))
             d_filters.append(" fletcher32");
 
         BESUtil::removeLeadingAndTrailingBlanks(d_filters);
@@ -36,6 +36,7 @@
 #define PARSER "dmrpp:dmz"
 #define CREDS  "dmrpp:creds"
 #define DMRPP_CURL  "dmrpp:curl"
+#define BUFFER_POOL "dmrpp:buffer_pool"
 
 #define DMRPP_USE_OBJECT_CACHE_KEY "DMRPP.UseObjectCache"
 #define DMRPP_OBJECT_CACHE_ENTRIES_KEY "DMRPP.ObjectCacheEntries"
@@ -47,6 +48,30 @@
 #define DMRPP_USE_COMPUTE_THREADS_KEY "DMRPP.UseComputeThreads"
 #define DMRPP_MAX_COMPUTE_THREADS_KEY "DMRPP.MaxComputeThreads"
 
+#define DMRPP_STREAM_CHUNK_PROCESSING_KEY "DMRPP.StreamChunkProcessing"
+
+#define DMRPP_DEFAULT_BUFFER_POOL_MAX_BYTES (256ULL*1024*1024)
+#define DMRPP_BUFFER_POOL_MAX_BYTES_KEY "DMRPP.BufferPoolMaxBytes"
+
+#define SUPER_CHUNK_STATS "dmrpp:super_chunk"
+#define DMRPP_DEFAULT_SUPER_CHUNK_MAX_GAP (1024ULL*1024)
+#define DMRPP_SUPER_CHUNK_MAX_GAP_KEY "DMRPP.SuperChunkMaxGap"
+#define DMRPP_DEFAULT_SUPER_CHUNK_MAX_SIZE (64ULL*1024*1024)
+#define DMRPP_SUPER_CHUNK_MAX_SIZE_KEY "DMRPP.SuperChunkMaxSize"
+
+#define MULTI_RANGE "dmrpp:multi_range"
+#define DMRPP_USE_MULTI_RANGE_REQUESTS_KEY "DMRPP.UseMultiRangeRequests"
+#define DMRPP_DEFAULT_MULTI_RANGE_MAX_RANGES 32
+#define DMRPP_MULTI_RANGE_MAX_RANGES_KEY "DMRPP.MultiRangeMaxRanges"
+
+#define CURL_MULTI "dmrpp:curl_multi"
+#define DMRPP_USE_CURL_MULTI_KEY "DMRPP.UseCurlMulti"
+#define DMRPP_DEFAULT_MAX_IN_FLIGHT_TRANSFERS 256
+#define DMRPP_MAX_IN_FLIGHT_TRANSFERS_KEY "DMRPP.MaxInFlightTransfers"
+#define DMRPP_DEFAULT_MAX_IN_FLIGHT_PER_ORIGIN 64
+#define DMRPP_MAX_IN_FLIGHT_PER_ORIGIN_KEY "DMRPP.MaxInFlightPerOrigin"
+#define DMRPP_USE_HTTP2_KEY "DMRPP.UseHTTP2"
+
 #define DMRPP_USE_CLASSIC_IN_FILEOUT_NETCDF "FONc.ClassicModel"
 #define DMRPP_DISABLE_DIRECT_IO "DMRPP.DisableDirectIO"
 
@@ -60,6 +60,7 @@
 #include "BESSyntaxUserError.h"
 #include "BESDebug.h"
 #include "BESStopWatch.h"
+#include "BESInterface.h"
 
 #include "NgapOwnedContainer.h"
 
@@ -74,6 +75,7 @@
 #include "DmrppTypeFactory.h"
 #include "DmrppRequestHandler.h"
 #include "CurlHandlePool.h"
+#include "ChunkBufferPool.h"
 #include "CredentialsManager.h"
 
 using namespace bes;
@@ -120,6 +122,16 @@ unsigned int DmrppRequestHandler::d_max_transfer_threads = 8;
 
 bool DmrppRequestHandler::d_use_compute_threads = true;
 unsigned int DmrppRequestHandler::d_max_compute_threads = 8;
+bool DmrppRequestHandler::d_stream_chunk_processing = true;
+unsigned long long DmrppRequestHandler::d_buffer_pool_max_bytes = DMRPP_DEFAULT_BUFFER_POOL_MAX_BYTES;
+unsigned long long DmrppRequestHandler::d_super_chunk_max_gap = DMRPP_DEFAULT_SUPER_CHUNK_MAX_GAP;
+unsigned long long DmrppRequestHandler::d_super_chunk_max_size = DMRPP_DEFAULT_SUPER_CHUNK_MAX_SIZE;
+bool DmrppRequestHandler::d_use_multi_range_requests = true;
+unsigned int DmrppRequestHandler::d_multi_range_max_ranges = DMRPP_DEFAULT_MULTI_RANGE_MAX_RANGES;
+bool DmrppRequestHandler::d_use_curl_multi = true;
+unsigned int DmrppRequestHandler::d_max_in_flight_transfers = DMRPP_DEFAULT_MAX_IN_FLIGHT_TRANSFERS;
+unsigned int DmrppRequestHandler::d_max_in_flight_per_origin = DMRPP_DEFAULT_MAX_IN_FLIGHT_PER_ORIGIN;
+bool DmrppRequestHandler::d_use_http2 = true;
 
 // Default minimum value is 2MB: 2 * (1024*1024)
 unsigned long long DmrppRequestHandler::d_contiguous_concurrent_threshold = DMRPP_DEFAULT_CONTIGUOUS_CONCURRENT_THRESHOLD;
@@ -180,6 +192,15 @@ static void read_key_value(const std::string &key_name, double &key_value) {
     }
 }
 
+/**
+ * Run at the end of each request: free the chunk buffers cached during the
+ * request, so an idle besd does not keep up to d_buffer_pool_max_bytes of them.
+ */
+static void trim_buffer_pool()
+{
+    ChunkBufferPool::ThePool()->trim();
+}
+
 /**
  * Here we register all of our handler functions so that the BES Dispatch machinery
  * knows what kinds of things we handle.
@@ -223,6 +244,54 @@ DmrppRequestHandler::DmrppRequestHandler(const string &name) :
     INFO_LOG(msg.str());
     msg.str(std::string());
 
+    read_key_value(DMRPP_STREAM_CHUNK_PROCESSING_KEY, d_stream_chunk_processing);
+    msg << prolog << "Streaming Chunk Processing: " << (d_stream_chunk_processing ? "Enabled." : "Disabled.") << endl;
+    INFO_LOG(msg.str());
+    msg.str(std::string());
+
+    read_key_value(DMRPP_BUFFER_POOL_MAX_BYTES_KEY, d_buffer_pool_max_bytes);
+    msg << prolog << "Chunk Buffer Pool: " << d_buffer_pool_max_bytes << " bytes." << endl;
+    INFO_LOG(msg.str());
+    msg.str(std::string());
+    BESInterface::add_end_request_callback(trim_buffer_pool);
+
+    read_key_value(DMRPP_SUPER_CHUNK_MAX_GAP_KEY, d_super_chunk_max_gap);
+    read_key_value(DMRPP_SUPER_CHUNK_MAX_SIZE_KEY, d_super_chunk_max_size);
+    msg << prolog << "SuperChunk max gap: " << d_super_chunk_max_gap << " bytes, max size: "
+        << d_super_chunk_max_size << " bytes." << endl;
+    INFO_LOG(msg.str());
+    msg.str(std::string());
+
+    read_key_value(DMRPP_USE_MULTI_RANGE_REQUESTS_KEY, d_use_multi_range_requests);
+    read_key_value(DMRPP_MULTI_RANGE_MAX_RANGES_KEY, d_multi_range_max_ranges);
+    msg << prolog << "Multi-range Requests: ";
+    if (d_use_multi_range_requests) {
+        msg << "Enabled. max_ranges: " << d_multi_range_max_ranges << endl;
+    }
+    else {
+        msg << "Disabled." << endl;
+    }
+    INFO_LOG(msg.str());
+    msg.str(std::string());
+
+    read_key_value(DMRPP_USE_CURL_MULTI_KEY, d_use_curl_multi);
+    read_key_value(DMRPP_MAX_IN_FLIGHT_TRANSFERS_KEY, d_max_in_flight_transfers);
+    read_key_value(DMRPP_MAX_IN_FLIGHT_PER_ORIGIN_KEY, d_max_in_flight_per_origin);
+    read_key_value(DMRPP_USE_HTTP2_KEY, d_use_http2);
+#if !HAVE_CURL_MULTI_API
+    d_use_curl_multi = false;
+#endif
+    msg << prolog << "libcurl Multi Transfers: ";
+    if (d_use_curl_multi) {
+        msg << "Enabled. max_in_flight: " << d_max_in_flight_transfers << " max_per_origin: "
+            << d_max_in_flight_per_origin << " HTTP/2: " << (d_use_http2 ? "yes" : "no") << endl;
+    }
+    else {
+        msg << "Disabled." << endl;
+    }
+    INFO_LOG(msg.str());
+    msg.str(std::string());
+
     // DMRPP_CONTIGUOUS_CONCURRENT_THRESHOLD_KEY
     read_key_value(DMRPP_CONTIGUOUS_CONCURRENT_THRESHOLD_KEY, d_contiguous_concurrent_threshold);
     msg << prolog << "Contiguous Concurrency Threshold: " << d_contiguous_concurrent_threshold << " bytes." << endl;
@@ -645,6 +714,8 @@ void DmrppRequestHandler::dump(ostream &strm) const {
     strm << BESIndent::LMarg << "DmrppRequestHandler::dump - (" << (void *) this << ")" << endl;
     BESIndent::Indent();
     BESRequestHandler::dump(strm);
+    strm << BESIndent::LMarg;
+    ChunkBufferPool::ThePool()->dump(strm);
     BESIndent::UnIndent();
 }
 
@@ -83,6 +83,32 @@ public:
     static bool d_use_compute_threads;
     static unsigned int d_max_compute_threads;
 
+    // Start processing a SuperChunk's child chunks while the SuperChunk is
+    // still being transferred. Only used when d_use_compute_threads is true.
+    static bool d_stream_chunk_processing;
+
+    // Bytes of released chunk buffers the ChunkBufferPool may keep for reuse
+    static unsigned long long d_buffer_pool_max_bytes;
+
+    // Chunks separated by at most this many bytes may share a SuperChunk (one
+    // request) when the data are remote. The bytes between them are read and
+    // discarded. SuperChunks are not grown past d_super_chunk_max_size (0: no limit).
+    static unsigned long long d_super_chunk_max_gap;
+    static unsigned long long d_super_chunk_max_size;
+
+    // Read the SuperChunks of a constrained array that use the same URL with
+    // multi-range requests, at most d_multi_range_max_ranges ranges per request.
+    static bool d_use_multi_range_requests;
+    static unsigned int d_multi_range_max_ranges;
+
+    // Run HTTP transfers on the CurlMultiEngine's event loop instead of one
+    // blocking transfer per thread. At most d_max_in_flight_transfers run at
+    // once, and at most d_max_in_flight_per_origin to any one origin.
+    static bool d_use_curl_multi;
+    static unsigned int d_max_in_flight_transfers;
+    static unsigned int d_max_in_flight_per_origin;
+    static bool d_use_http2;
+
     static unsigned long long d_contiguous_concurrent_threshold;
 
     static bool d_require_chunks;
@@ -0,0 +1,357 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <unistd.h>
+
+#include <chrono>
+
+#include "BESDebug.h"
+
+#include "DmrppRequestHandler.h"
+#include "DmrppNames.h"
+#include "DmrppThreadPool.h"
+
+using namespace std;
+
+#define prolog std::string("DmrppThreadPool::").append(__func__).append("() - ")
+
+#define POOL_MODULE "dmrpp:pool"
+
+namespace dmrpp {
+
+// Set for the worker threads only; used so that a worker can put the tasks it
+// submits on its own queue and so that it can help out when it waits.
+thread_local const DmrppThreadPool *tl_pool = nullptr;
+thread_local int tl_lane = -1;
+thread_local unsigned int tl_index = 0;
+
+void TaskGroup::task_added()
+{
+    std::lock_guard<std::mutex> lck(d_mtx);
+    d_pending++;
+}
+
+/**
+ * @brief Record that a task in this group has finished.
+ * @param error If the task threw, the exception; nullptr otherwise. Only the
+ * first exception is kept, and recording it cancels the group.
+ */
+void TaskGroup::task_done(std::exception_ptr error)
+{
+    std::lock_guard<std::mutex> lck(d_mtx);
+    if (error && !d_first_error) {
+        d_first_error = error;
+        d_cancelled = true;
+    }
+    if (--d_pending == 0)
+        d_done_cv.notify_all();
+}
+
+bool TaskGroup::done()
+{
+    std::lock_guard<std::mutex> lck(d_mtx);
+    return d_pending == 0;
+}
+
+/**
+ * @brief Make the pool and start the worker threads for both lanes.
+ * @param transfer_threads The number of workers in the transfer lane (min 1)
+ * @param compute_threads The number of workers in the compute lane (min 1)
+ */
+DmrppThreadPool::DmrppThreadPool(unsigned int transfer_threads, unsigned int compute_threads) : d_pid(getpid())
+{
+    start_lane(transfer_lane, transfer_threads);
+    start_lane(compute_lane, compute_threads);
+}
+
+DmrppThreadPool::~DmrppThreadPool()
+{
+    d_shutdown = true;
+    for (auto &lane: d_lanes) {
+        {
+            std::lock_guard<std::mutex> lck(lane.idle_mtx);
+        }
+        lane.idle_cv.notify_all();
+        for (auto &worker: lane.workers) {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+}
+
+/**
+ * @brief Get the pool for this process.
+ *
+ * The pool is made the first time this is called using the DMR++ handler's
+ * configuration for the number of transfer and compute threads. If the pool
+ * was made by a different process (i.e., this is a child of the process that
+ * made it), the old pool is abandoned (its threads do not exist here) and a
+ * new one is made.
+ *
+ * @return A pointer to the process-wide pool.
+ */
+DmrppThreadPool *DmrppThreadPool::TheThreadPool()
+{
+    static std::mutex instance_mtx;
+    static std::unique_ptr<DmrppThreadPool> instance;
+
+    std::lock_guard<std::mutex> lck(instance_mtx);
+    if (!instance || instance->d_pid != getpid()) {
+        // Do not delete a pool inherited across fork(); joining threads that
+        // are not in this process is undefined behavior.
+        if (instance)
+            (void) instance.release();
+
+        instance.reset(new DmrppThreadPool(DmrppRequestHandler::d_max_transfer_threads,
+                                           DmrppRequestHandler::d_max_compute_threads));
+        BESDEBUG(POOL_MODULE, prolog << "Made a new pool. transfer threads: " << instance->lane_size(transfer_lane)
+                                     << ", compute threads: " << instance->lane_size(compute_lane) << endl);
+    }
+
+    return instance.get();
+}
+
+void DmrppThreadPool::start_lane(pool_lane lane, unsigned int num_workers)
+{
+    if (num_workers == 0)
+        num_workers = 1;
+
+    auto &ls = d_lanes[lane];
+    for (unsigned int i = 0; i < num_workers; ++i)
+        ls.queues.emplace_back(new worker_queue());
+
+    for (unsigned int i = 0; i < num_workers; ++i)
+        ls.workers.emplace_back(&DmrppThreadPool::worker_loop, this, lane, i);
+}
+
+/**
+ * @brief Find a task for worker \arg index in \arg lane.
+ *
+ * Look first at the worker's own queue (newest task first), then steal the
+ * oldest task from the other queues in the lane.
+ *
+ * @return True if a task was found and moved into \arg t.
+ */
+bool DmrppThreadPool::try_pop(pool_lane lane, unsigned int index, queued_task &t)
+{
+    auto &ls = d_lanes[lane];
+    const auto num_queues = ls.queues.size();
+
+    {
+        auto &own = *ls.queues[index];
+        std::lock_guard<std::mutex> lck(own.mtx);
+        if (!own.tasks.empty()) {
+            t = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            ls.queued--;
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < num_queues; ++i) {
+        auto &victim = *ls.queues[(index + i) % num_queues];
+        std::lock_guard<std::mutex> lck(victim.mtx);
+        if (!victim.tasks.empty()) {
+            t = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            ls.queued--;
+            ls.tasks_stolen++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Run one task, recording its outcome in the task's group.
+ * If the group has been cancelled, the task is skipped.
+ */
+void DmrppThreadPool::run_task(pool_lane lane, queued_task &t)
+{
+    if (t.group->cancelled()) {
+        d_lanes[lane].tasks_skipped++;
+        t.group->task_done(nullptr);
+        return;
+    }
+
+    std::exception_ptr error = nullptr;
+    try {
+        t.fn();
+    }
+    catch (...) {
+        // BESError is not a std::exception, so capture everything.
+        error = std::current_exception();
+    }
+
+    d_lanes[lane].tasks_run++;
+    // Release the task's resources before the waiter is told it's done.
+    t.fn = nullptr;
+    t.group->task_done(error);
+}
+
+void DmrppThreadPool::worker_loop(pool_lane lane, unsigned int index)
+{
+    tl_pool = this;
+    tl_lane = lane;
+    tl_index = index;
+
+    auto &ls = d_lanes[lane];
+    while (!d_shutdown) {
+        queued_task t;
+        if (try_pop(lane, index, t)) {
+            run_task(lane, t);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lck(ls.idle_mtx);
+        ls.idle_cv.wait(lck, [this, &ls] { return d_shutdown || ls.queued > 0; });
+    }
+}
+
+/**
+ * @brief Queue a task.
+ *
+ * The task runs in the group's lane. A task submitted from a worker of that
+ * lane goes on the worker's own queue, otherwise the queues are used in turn.
+ *
+ * @param group The group that tracks this task's completion
+ * @param fn The task
+ */
+void DmrppThreadPool::submit(const std::shared_ptr<TaskGroup> &group, task fn)
+{
+    const pool_lane lane = group->lane();
+    auto &ls = d_lanes[lane];
+
+    group->task_added();
+
+    unsigned int index;
+    if (tl_pool == this && tl_lane == lane)
+        index = tl_index;
+    else
+        index = ls.next_queue++ % ls.queues.size();
+
+    {
+        auto &q = *ls.queues[index];
+        std::lock_guard<std::mutex> lck(q.mtx);
+        q.tasks.push_back(queued_task{group, std::move(fn)});
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(ls.idle_mtx);
+        ls.queued++;
+    }
+    ls.idle_cv.notify_one();
+}
+
+/**
+ * @brief Wait for all the tasks in \arg group to finish.
+ *
+ * If the calling thread is a worker in the group's lane, it runs queued tasks
+ * while it waits.
+ *
+ * @exception Rethrows the first exception thrown by a task in the group.
+ */
+void DmrppThreadPool::wait(TaskGroup &group)
+{
+    const pool_lane lane = group.lane();
+
+    if (tl_pool == this && tl_lane == lane) {
+        while (!group.done()) {
+            queued_task t;
+            if (try_pop(lane, tl_index, t)) {
+                run_task(lane, t);
+            }
+            else {
+                std::unique_lock<std::mutex> lck(group.d_mtx);
+                group.d_done_cv.wait_for(lck, std::chrono::milliseconds(DMRPP_WAIT_FOR_FUTURE_MS),
+                                         [&group] { return group.d_pending == 0; });
+            }
+        }
+    }
+    else {
+        std::unique_lock<std::mutex> lck(group.d_mtx);
+        group.d_done_cv.wait(lck, [&group] { return group.d_pending == 0; });
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lck(group.d_mtx);
+        error = group.d_first_error;
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/**
+ * @brief Run a set of tasks in one lane and wait for them to finish.
+ *
+ * This is the common case for the DMR++ code: make a task for each SuperChunk
+ * (or Chunk), run them all, and return once they are done. If submitting the
+ * tasks fails part way through, the tasks already queued are cancelled and
+ * waited on before the exception propagates, so no task outlives the caller's
+ * data.
+ *
+ * @param lane Run the tasks in this lane
+ * @param tasks The tasks. Emptied by this method.
+ * @exception Rethrows the first exception thrown by one of the tasks.
+ */
+void DmrppThreadPool::run_tasks(pool_lane lane, std::vector<task> &tasks)
+{
+    auto group = std::make_shared<TaskGroup>(lane);
+    try {
+        for (auto &t: tasks)
+            submit(group, std::move(t));
+        tasks.clear();
+    }
+    catch (...) {
+        group->cancel();
+        try {
+            wait(*group);
+        }
+        catch (...) {
+            // The submit() failure is the more useful error.
+        }
+        throw;
+    }
+
+    wait(*group);
+}
+
+void DmrppThreadPool::dump(ostream &strm) const
+{
+    const char *names[] = {"transfer", "compute"};
+    strm << "DmrppThreadPool [pid: " << d_pid << "]" << endl;
+    for (int i = 0; i < 2; ++i) {
+        const auto &ls = d_lanes[i];
+        strm << "    " << names[i] << " lane - workers: " << ls.workers.size()
+             << " queued: " << ls.queued
+             << " run: " << ls.tasks_run
+             << " stolen: " << ls.tasks_stolen
+             << " skipped: " << ls.tasks_skipped << endl;
+    }
+}
+
+} // namespace dmrpp
@@ -0,0 +1,183 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dmrpp_thread_pool_h
+#define _dmrpp_thread_pool_h 1
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace dmrpp {
+
+/**
+ * @brief The thread pool 'lanes.'
+ *
+ * Each lane has its own set of worker threads. The transfer lane runs tasks
+ * that spend most of their time waiting on the network (SuperChunk reads,
+ * contiguous child chunk reads); the compute lane runs tasks that are CPU
+ * bound (inflate, unshuffle and insertion into the array).
+ */
+enum pool_lane { transfer_lane = 0, compute_lane = 1 };
+
+/**
+ * @brief A set of related tasks submitted to the DmrppThreadPool.
+ *
+ * A TaskGroup is how a caller waits for the tasks it submitted. All the
+ * tasks in a group run in the same lane. When any task throws, the exception
+ * is recorded, the group is cancelled (tasks that have not yet started are
+ * skipped) and DmrppThreadPool::wait() rethrows that first exception once the
+ * tasks that were already running have finished. Tasks in other groups, i.e.,
+ * for other requests or variables, are not affected.
+ */
+class TaskGroup {
+    pool_lane d_lane;
+
+    std::mutex d_mtx;
+    std::condition_variable d_done_cv;
+    unsigned long d_pending = 0;
+    std::exception_ptr d_first_error = nullptr;
+    std::atomic<bool> d_cancelled{false};
+
+    friend class DmrppThreadPool;
+    friend class DmrppThreadPoolTest;
+
+    void task_added();
+    void task_done(std::exception_ptr error);
+
+public:
+    explicit TaskGroup(pool_lane lane) : d_lane(lane) {}
+    virtual ~TaskGroup() = default;
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    pool_lane lane() const { return d_lane; }
+
+    /// @return True if a task failed (or cancel() was called); queued tasks will not run.
+    bool cancelled() const { return d_cancelled; }
+
+    /// @brief Stop tasks in this group that have not started from running.
+    void cancel() { d_cancelled = true; }
+
+    /// @return True when every task added to this group has finished or been skipped.
+    bool done();
+};
+
+/**
+ * @brief A process-wide, work-stealing thread pool for the DMR++ reader.
+ *
+ * This replaces the older scheme of calling std::async() for each SuperChunk
+ * and each Chunk and then polling a list of futures. The worker threads are
+ * made once (per besd process) and reused for every request. There are two
+ * lanes, one for transfers and one for computation, sized using
+ * DmrppRequestHandler::d_max_transfer_threads and
+ * DmrppRequestHandler::d_max_compute_threads, respectively.
+ *
+ * Each worker has its own task queue. Tasks submitted by a worker go on that
+ * worker's queue; tasks submitted by other threads are dealt out round-robin.
+ * A worker runs its newest task first and, when its queue is empty, steals
+ * the oldest task from another worker in the same lane.
+ *
+ * Tasks are delivered in completion order - the caller does not wait on the
+ * tasks one by one in the order they were started. A worker thread that waits
+ * on a TaskGroup in its own lane runs queued tasks while it waits so nested
+ * submission cannot deadlock the pool.
+ *
+ * @note The besd daemon forks its children after it is started, and threads
+ * do not survive fork(). The pool records the pid of the process that made it
+ * and TheThreadPool() makes a new pool when called in a child process.
+ */
+class DmrppThreadPool {
+public:
+    using task = std::function<void()>;
+
+private:
+    struct queued_task {
+        std::shared_ptr<TaskGroup> group;
+        task fn;
+    };
+
+    // One of these per worker thread; other workers steal from the front.
+    struct worker_queue {
+        std::mutex mtx;
+        std::deque<queued_task> tasks;
+    };
+
+    struct lane_state {
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex idle_mtx;
+        std::condition_variable idle_cv;
+        std::atomic<long> queued{0};
+        std::atomic<unsigned long> next_queue{0};
+
+        // Counters reported by dump(); useful for tuning the lane sizes.
+        std::atomic<unsigned long long> tasks_run{0};
+        std::atomic<unsigned long long> tasks_stolen{0};
+        std::atomic<unsigned long long> tasks_skipped{0};
+    };
+
+    lane_state d_lanes[2];
+    std::atomic<bool> d_shutdown{false};
+    pid_t d_pid;
+
+    void start_lane(pool_lane lane, unsigned int num_workers);
+    void worker_loop(pool_lane lane, unsigned int index);
+    bool try_pop(pool_lane lane, unsigned int index, queued_task &t);
+    void run_task(pool_lane lane, queued_task &t);
+
+    friend class DmrppThreadPoolTest;
+
+public:
+    DmrppThreadPool(unsigned int transfer_threads, unsigned int compute_threads);
+    virtual ~DmrppThreadPool();
+
+    DmrppThreadPool(const DmrppThreadPool &) = delete;
+    DmrppThreadPool &operator=(const DmrppThreadPool &) = delete;
+
+    static DmrppThreadPool *TheThreadPool();
+
+    void submit(const std::shared_ptr<TaskGroup> &group, task fn);
+    void wait(TaskGroup &group);
+
+    void run_tasks(pool_lane lane, std::vector<task> &tasks);
+
+    unsigned int lane_size(pool_lane lane) const { return d_lanes[lane].workers.size(); }
+
+    void dump(std::ostream &strm) const;
+};
+
+} // namespace dmrpp
+
+#endif // _dmrpp_thread_pool_h
@@ -0,0 +1,597 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <strings.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <curl/curl.h>
+
+#include "BESDebug.h"
+#include "BESInternalError.h"
+
+#include "CurlUtils.h"
+#include "HttpNames.h"
+#include "url_impl.h"
+
+#include "MultiRangeRequest.h"
+#include "SuperChunk.h"
+#include "ChunkBufferPool.h"
+#include "CurlHandlePool.h"
+#include "DmrppRequestHandler.h"
+#include "DmrppThreadPool.h"
+#include "DmrppNames.h"
+
+using namespace std;
+
+#define prolog std::string("MultiRangeRequest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+namespace {
+
+// Header lines and multipart boundary/header lines longer than this are not
+// from a well-formed byteranges response.
+const size_t MAX_LINE_LENGTH = 8192;
+
+string trim(const string &s)
+{
+    const auto first = s.find_first_not_of(" \t");
+    if (first == string::npos)
+        return "";
+    const auto last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+/// If \arg line is the header \arg name (case-insensitive), set value and return true.
+bool get_header_value(const string &line, const char *name, string &value)
+{
+    const auto len = strlen(name);
+    if (line.size() <= len || line[len] != ':' || strncasecmp(line.c_str(), name, len) != 0)
+        return false;
+    value = trim(line.substr(len + 1));
+    return true;
+}
+
+} // namespace
+
+ByteRangesParser::ByteRangesParser(vector<byte_range> &ranges) : d_ranges(ranges)
+{
+    sort(d_ranges.begin(), d_ranges.end(),
+         [](const byte_range &a, const byte_range &b) { return a.offset < b.offset; });
+}
+
+/**
+ * @brief Get the boundary parameter of a multipart/byteranges Content-Type.
+ * @param content_type The value of the Content-Type header
+ * @return The boundary, without quotes, or the empty string if the content
+ * type is not multipart/byteranges or has no boundary.
+ */
+string ByteRangesParser::get_boundary(const string &content_type)
+{
+    static const string multipart = "multipart/byteranges";
+    const string ct = trim(content_type);
+    if (ct.size() < multipart.size() || strncasecmp(ct.c_str(), multipart.c_str(), multipart.size()) != 0)
+        return "";
+
+    // Parameter names are case-insensitive.
+    string lower = ct;
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    auto pos = lower.find("boundary=");
+    if (pos == string::npos)
+        return "";
+    pos += strlen("boundary=");
+
+    if (pos < ct.size() && ct[pos] == '"') {
+        const auto end = ct.find('"', pos + 1);
+        return end == string::npos ? "" : ct.substr(pos + 1, end - pos - 1);
+    }
+
+    const auto end = ct.find_first_of("; \t", pos);
+    return ct.substr(pos, end == string::npos ? string::npos : end - pos);
+}
+
+/**
+ * @brief Parse the value of a Content-Range header.
+ * @param value A value like 'bytes 100-199/1000' or 'bytes 100-199/ *'
+ * @param first Value-result parameter, the first byte of the range
+ * @param last Value-result parameter, the last byte of the range
+ * @return True if the value was parsed.
+ */
+bool ByteRangesParser::parse_content_range(const string &value, unsigned long long &first, unsigned long long &last)
+{
+    const string v = trim(value);
+    if (v.size() < 6 || strncasecmp(v.c_str(), "bytes ", 6) != 0)
+        return false;
+
+    const char *start = v.c_str() + 6;
+    while (*start == ' ')
+        ++start;
+    if (!isdigit(static_cast<unsigned char>(*start)))
+        return false;
+
+    char *end = nullptr;
+    first = strtoull(start, &end, 10);
+    if (*end != '-' || !isdigit(static_cast<unsigned char>(*(end + 1))))
+        return false;
+    last = strtoull(end + 1, &end, 10);
+    if (*end != '/')
+        return false;
+
+    return first <= last;
+}
+
+/**
+ * @brief Get ready to parse a response body.
+ * @param content_type The response's Content-Type header value.
+ * @param content_range The response's Content-Range header value, which is
+ * only used when the body is not multipart.
+ * @return False if the response cannot be parsed; the body is not the
+ * response to a range request.
+ */
+bool ByteRangesParser::start(const string &content_type, const string &content_range)
+{
+    d_line.clear();
+    d_part_has_range = false;
+    for (auto &range: d_ranges)
+        range.bytes_written = 0;
+
+    const string boundary = get_boundary(content_type);
+    if (!boundary.empty()) {
+        d_boundary = "--" + boundary;
+        d_state = parsing_boundary;
+        return true;
+    }
+
+    // The server merged all the ranges into one.
+    d_boundary.clear();
+    unsigned long long first;
+    unsigned long long last;
+    if (parse_content_range(content_range, first, last)) {
+        d_part_offset = first;
+        d_part_remaining = last - first + 1;
+        d_state = parsing_body;
+        return true;
+    }
+
+    d_state = parse_error;
+    return false;
+}
+
+/// Copy the bytes of a part into the requested ranges they overlap.
+void ByteRangesParser::write_bytes(unsigned long long offset, const char *data, unsigned long long size)
+{
+    const auto end = offset + size;
+
+    // The first range that ends after offset
+    auto it = upper_bound(d_ranges.begin(), d_ranges.end(), offset,
+                          [](unsigned long long o, const byte_range &r) { return o < r.offset + r.size; });
+
+    for (; it != d_ranges.end() && it->offset < end; ++it) {
+        const auto first = max(offset, it->offset);
+        const auto last = min(end, it->offset + it->size);
+        memcpy(it->buffer + (first - it->offset), data + (first - offset), last - first);
+        it->bytes_written += last - first;
+    }
+}
+
+/// Handle one boundary or header line. Return false if the line is an error.
+bool ByteRangesParser::parse_line(const string &line)
+{
+    switch (d_state) {
+        case parsing_boundary: {
+            // Blank lines end the previous part's body; other lines before the
+            // first boundary are the preamble, which is ignored.
+            const string l = trim(line);
+            if (l == d_boundary + "--") {
+                d_state = parse_done;
+            }
+            else if (l == d_boundary) {
+                d_part_has_range = false;
+                d_state = parsing_headers;
+            }
+            return true;
+        }
+
+        case parsing_headers: {
+            if (line.empty()) {
+                if (!d_part_has_range)
+                    return false;
+                d_state = parsing_body;
+                return true;
+            }
+
+            string value;
+            if (get_header_value(line, "Content-Range", value)) {
+                unsigned long long first;
+                unsigned long long last;
+                if (!parse_content_range(value, first, last))
+                    return false;
+                d_part_offset = first;
+                d_part_remaining = last - first + 1;
+                d_part_has_range = true;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Parse the next piece of the response body.
+ * @param data The bytes
+ * @param size How many
+ * @return False if the body is not a valid byteranges response.
+ */
+bool ByteRangesParser::parse(const char *data, unsigned long long size)
+{
+    while (size > 0) {
+        switch (d_state) {
+            case parsing_body: {
+                const auto n = min(size, d_part_remaining);
+                write_bytes(d_part_offset, data, n);
+                d_part_offset += n;
+                d_part_remaining -= n;
+                data += n;
+                size -= n;
+                if (d_part_remaining == 0)
+                    d_state = d_boundary.empty() ? parse_done : parsing_boundary;
+                break;
+            }
+
+            case parsing_boundary:
+            case parsing_headers: {
+                const auto eol = static_cast<const char *>(memchr(data, '\n', size));
+                const auto n = eol ? eol - data + 1 : size;
+                d_line.append(data, eol ? n - 1 : n);
+                data += n;
+                size -= n;
+
+                if (d_line.size() > MAX_LINE_LENGTH) {
+                    d_state = parse_error;
+                    return false;
+                }
+
+                if (eol) {
+                    if (!d_line.empty() && d_line.back() == '\r')
+                        d_line.pop_back();
+                    const bool ok = parse_line(d_line);
+                    d_line.clear();
+                    if (!ok) {
+                        d_state = parse_error;
+                        return false;
+                    }
+                }
+                break;
+            }
+
+            case parse_done:
+                // The epilogue, if any, is ignored.
+                return true;
+
+            case parse_error:
+            default:
+                return false;
+        }
+    }
+
+    return d_state != parse_error;
+}
+
+/// @return True if the body has been parsed and every range was filled.
+bool ByteRangesParser::complete() const
+{
+    // A multipart body may end without the closing boundary line's CRLF
+    if (d_state != parse_done && !(d_state == parsing_boundary && d_line == d_boundary + "--"))
+        return false;
+
+    return all_of(d_ranges.begin(), d_ranges.end(),
+                  [](const byte_range &r) { return r.bytes_written >= r.size; });
+}
+
+namespace {
+
+/// The state of one multi-range transfer, shared by the libcurl callbacks.
+struct multi_range_response {
+    long code = 0;
+    string content_type;
+    string content_range;
+
+    ByteRangesParser parser;
+    bool started = false;
+    bool rejected = false;  // Not a byteranges response
+
+    explicit multi_range_response(vector<byte_range> &ranges) : parser(ranges) {}
+};
+
+size_t multi_range_header_callback(char *buffer, size_t /*size*/, size_t nitems, void *data)
+{
+    auto response = reinterpret_cast<multi_range_response *>(data);
+    const string header = trim(string(buffer, nitems));
+
+    // Each response (there may be redirects) starts with a status line.
+    if (header.compare(0, 5, "HTTP/") == 0) {
+        response->content_type.clear();
+        response->content_range.clear();
+        const auto code_start = header.find(' ');
+        response->code = code_start == string::npos ? 0 : strtol(header.c_str() + code_start + 1, nullptr, 10);
+    }
+    else {
+        string value;
+        if (get_header_value(header, "Content-Type", value))
+            response->content_type = value;
+        else if (get_header_value(header, "Content-Range", value))
+            response->content_range = value;
+    }
+
+    return nitems;
+}
+
+// Returning fewer than nmemb bytes stops the transfer.
+size_t multi_range_write_data(void *buffer, size_t /*size*/, size_t nmemb, void *data)
+{
+    auto response = reinterpret_cast<multi_range_response *>(data);
+
+    if (!response->started) {
+        response->started = true;
+        // An error response is left for the usual reads to report.
+        if (response->code < 200 || response->code >= 300)
+            return 0;
+        if (response->code != 206 || !response->parser.start(response->content_type, response->content_range)) {
+            response->rejected = true;
+            return 0;
+        }
+    }
+
+    return response->parser.parse(reinterpret_cast<const char *>(buffer), nmemb) ? nmemb : 0;
+}
+
+} // namespace
+
+mutex MultiRangeRequest::d_origins_mtx;
+map<string, MultiRangeRequest::origin_support> MultiRangeRequest::d_origins;
+
+/// @return The protocol and host of \arg data_url.
+string MultiRangeRequest::origin(const shared_ptr<http::url> &data_url)
+{
+    return data_url->protocol() + data_url->host();
+}
+
+MultiRangeRequest::origin_support MultiRangeRequest::get_origin_support(const shared_ptr<http::url> &data_url)
+{
+    lock_guard<mutex> lck(d_origins_mtx);
+    auto it = d_origins.find(origin(data_url));
+    return it == d_origins.end() ? unknown : it->second;
+}
+
+void MultiRangeRequest::set_origin_support(const shared_ptr<http::url> &data_url, origin_support support)
+{
+    lock_guard<mutex> lck(d_origins_mtx);
+    d_origins[origin(data_url)] = support;
+}
+
+/**
+ * @brief Add a SuperChunk to this request.
+ * @return False if the SuperChunk uses a different URL, does not need to be
+ * transferred or the request already has DMRPP.MultiRangeMaxRanges ranges.
+ */
+bool MultiRangeRequest::add(const shared_ptr<SuperChunk> &super_chunk)
+{
+    if (d_super_chunks.size() >= DmrppRequestHandler::d_multi_range_max_ranges)
+        return false;
+
+    if (super_chunk->d_is_read || super_chunk->d_uses_fill_value || super_chunk->empty() || !super_chunk->d_data_url
+        || super_chunk->d_data_url->str() != d_data_url->str())
+        return false;
+
+    d_super_chunks.push_back(super_chunk);
+    return true;
+}
+
+/// @return The value for CURLOPT_RANGE, 'a-b,c-d,...', with the ranges in offset order.
+string MultiRangeRequest::get_range_arg_string() const
+{
+    vector<pair<unsigned long long, unsigned long long>> ranges;
+    for (const auto &sc: d_super_chunks)
+        ranges.emplace_back(sc->d_offset, sc->d_size);
+    sort(ranges.begin(), ranges.end());
+
+    ostringstream range;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (i > 0)
+            range << ",";
+        range << ranges[i].first << "-" << ranges[i].first + ranges[i].second - 1;
+    }
+    return range.str();
+}
+
+/**
+ * @brief Read all the SuperChunks with one request.
+ *
+ * If this returns true, every SuperChunk and all of their child Chunks are
+ * read. If it returns false, none of them are marked as read and they should
+ * be read as usual. Errors that would also stop the usual reads (e.g., a URL
+ * that is not allowed) are thrown.
+ *
+ * @return True if the data were read.
+ */
+bool MultiRangeRequest::read()
+{
+    if (d_super_chunks.size() < 2 || get_origin_support(d_data_url) == unsupported)
+        return false;
+
+    vector<byte_range> ranges;
+    unsigned long long bytes = 0;
+    unsigned long long gap_bytes = 0;
+    for (const auto &sc: d_super_chunks) {
+        if (!sc->d_read_buffer)
+            sc->d_read_buffer = ChunkBufferPool::ThePool()->allocate(sc->d_size);
+        sc->map_chunks_to_buffer();
+        ranges.emplace_back(sc->d_offset, sc->d_size, sc->d_read_buffer);
+        bytes += sc->d_size;
+        gap_bytes += sc->d_gap_bytes;
+    }
+
+    const string range_arg = get_range_arg_string();
+    BESDEBUG(MULTI_RANGE, prolog << "URL: " << d_data_url->str() << " ranges: " << range_arg << endl);
+
+    // The Chunk supplies the (effective) URL and the AllowedHosts check to the handle pool.
+    Chunk chunk(d_data_url, "NOT_USED", bytes, ranges.front().offset);
+    dmrpp_easy_handle *handle = DmrppRequestHandler::curl_handle_pool->get_easy_handle(&chunk);
+    if (!handle)
+        throw BESInternalError(prolog + "No more libcurl handles.", __FILE__, __LINE__);
+
+    multi_range_response response(ranges);
+    CURLcode res = CURLE_OK;
+    try {
+        CURL *curl = handle->d_handle;
+        res = curl_easy_setopt(curl, CURLOPT_RANGE, range_arg.c_str());
+        curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_RANGE", handle->d_errbuf.data(), __FILE__, __LINE__);
+        res = curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, multi_range_header_callback);
+        curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_HEADERFUNCTION", handle->d_errbuf.data(), __FILE__, __LINE__);
+        res = curl_easy_setopt(curl, CURLOPT_HEADERDATA, reinterpret_cast<void *>(&response));
+        curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_HEADERDATA", handle->d_errbuf.data(), __FILE__, __LINE__);
+        res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, multi_range_write_data);
+        curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_WRITEFUNCTION", handle->d_errbuf.data(), __FILE__, __LINE__);
+        res = curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void *>(&response));
+        curl::eval_curl_easy_setopt_result(res, prolog, "CURLOPT_WRITEDATA", handle->d_errbuf.data(), __FILE__, __LINE__);
+
+        // One try only; if this fails the SuperChunks are read the usual way,
+        // with its retries.
+        res = curl_easy_perform(curl);
+        CurlHandlePool::release_handle(handle);
+    }
+    catch (...) {
+        CurlHandlePool::release_handle(handle);
+        throw;
+    }
+
+    const bool success = response.code >= 200 && response.code < 300;
+    if (response.rejected || (res == CURLE_OK && success && !response.parser.complete())) {
+        BESDEBUG(MULTI_RANGE, prolog << "The origin " << origin(d_data_url) << " does not support multi-range requests"
+                                     << " (response code: " << response.code << ", Content-Type: "
+                                     << response.content_type << ")." << endl);
+        set_origin_support(d_data_url, unsupported);
+        return false;
+    }
+
+    if (res != CURLE_OK || !response.parser.complete()) {
+        BESDEBUG(MULTI_RANGE, prolog << "The multi-range request failed: " << curl_easy_strerror(res) << endl);
+        return false;
+    }
+
+    set_origin_support(d_data_url, supported);
+
+    for (const auto &sc: d_super_chunks) {
+        for (const auto &child: sc->d_chunks) {
+            child->set_is_read(true);
+            child->set_bytes_read(child->get_size());
+        }
+        sc->d_is_read = true;
+    }
+
+    SuperChunk::d_requests++;
+    SuperChunk::d_bytes_requested += bytes;
+    SuperChunk::d_gap_bytes_requested += gap_bytes;
+
+    BESDEBUG(MULTI_RANGE, prolog << "Read " << d_super_chunks.size() << " SuperChunks (" << bytes
+                                 << " bytes) with one request." << endl);
+    return true;
+}
+
+/**
+ * @brief Read SuperChunks that use the same HTTP URL with multi-range requests.
+ *
+ * The SuperChunks that are read are marked as read; the others are not
+ * changed and must be read as usual. When the support of an origin is not
+ * known, one request is made to find out before any others are started.
+ * The requests are run on the transfer lane of the DmrppThreadPool.
+ *
+ * @param super_chunks The SuperChunks of a constrained array.
+ */
+void read_super_chunks_multi_range(queue<shared_ptr<SuperChunk>> super_chunks)
+{
+    vector<shared_ptr<MultiRangeRequest>> requests;
+    map<string, shared_ptr<MultiRangeRequest>> open_requests;
+
+    while (!super_chunks.empty()) {
+        auto sc = super_chunks.front();
+        super_chunks.pop();
+
+        const auto data_url = sc->get_data_url();
+        if (!data_url || (data_url->protocol() != HTTP_PROTOCOL && data_url->protocol() != HTTPS_PROTOCOL)
+            || MultiRangeRequest::get_origin_support(data_url) == MultiRangeRequest::unsupported)
+            continue;
+
+        auto &request = open_requests[data_url->str()];
+        if (request && request->add(sc))
+            continue;
+
+        // Either the first SuperChunk for this URL or the current request is full.
+        auto next = make_shared<MultiRangeRequest>(data_url);
+        if (!next->add(sc))
+            continue;
+        request = next;
+        requests.push_back(next);
+    }
+
+    requests.erase(remove_if(requests.begin(), requests.end(),
+                             [](const shared_ptr<MultiRangeRequest> &r) { return r->size() < 2; }),
+                   requests.end());
+
+    BESDEBUG(MULTI_RANGE, prolog << "Multi-range requests: " << requests.size() << endl);
+
+    // Probe origins we know nothing about with their first request.
+    vector<shared_ptr<MultiRangeRequest>> remaining;
+    for (const auto &request: requests) {
+        if (MultiRangeRequest::get_origin_support(request->get_data_url()) == MultiRangeRequest::unknown)
+            request->read();
+        else
+            remaining.push_back(request);
+    }
+
+    if (remaining.empty())
+        return;
+
+    if (!DmrppRequestHandler::d_use_transfer_threads || remaining.size() == 1) {
+        for (const auto &request: remaining)
+            request->read();
+        return;
+    }
+
+    vector<DmrppThreadPool::task> tasks;
+    for (const auto &request: remaining)
+        tasks.emplace_back([request]() { request->read(); });
+
+    DmrppThreadPool::TheThreadPool()->run_tasks(transfer_lane, tasks);
+}
+
+} // namespace dmrpp
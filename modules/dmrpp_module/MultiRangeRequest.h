@@ -0,0 +1,144 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dmrpp_multi_range_request_h
+#define _dmrpp_multi_range_request_h 1
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace http {
+class url;
+}
+
+namespace dmrpp {
+
+class SuperChunk;
+
+/// A range of bytes in a resource and the buffer that holds them.
+struct byte_range {
+    unsigned long long offset = 0;
+    unsigned long long size = 0;
+    char *buffer = nullptr;
+    unsigned long long bytes_written = 0;
+
+    byte_range(unsigned long long o, unsigned long long s, char *b) : offset(o), size(s), buffer(b) {}
+};
+
+/**
+ * @brief Parse the body of a response to a multi-range request.
+ *
+ * The body is either a multipart/byteranges document (RFC 9110, 14.6) or,
+ * when the server merged the ranges, the bytes of one range. The bytes of
+ * each part are copied into the buffers of the requested ranges they overlap
+ * as they arrive, so the body is never stored. Bytes not in any requested
+ * range (servers may merge ranges that are close together) are dropped.
+ *
+ * Data can be passed to parse() in pieces of any size.
+ */
+class ByteRangesParser {
+    enum parser_state { parsing_boundary, parsing_headers, parsing_body, parse_done, parse_error };
+
+    std::vector<byte_range> &d_ranges;  // sorted by offset
+    std::string d_boundary;             // "--" plus the boundary; empty if not multipart
+    parser_state d_state = parse_error;
+
+    std::string d_line;
+    unsigned long long d_part_offset = 0;
+    unsigned long long d_part_remaining = 0;
+    bool d_part_has_range = false;
+
+    void write_bytes(unsigned long long offset, const char *data, unsigned long long size);
+    bool parse_line(const std::string &line);
+
+    friend class MultiRangeRequestTest;
+
+public:
+    explicit ByteRangesParser(std::vector<byte_range> &ranges);
+    virtual ~ByteRangesParser() = default;
+
+    static std::string get_boundary(const std::string &content_type);
+    static bool parse_content_range(const std::string &value, unsigned long long &first, unsigned long long &last);
+
+    bool start(const std::string &content_type, const std::string &content_range);
+    bool parse(const char *data, unsigned long long size);
+
+    bool failed() const { return d_state == parse_error; }
+    bool complete() const;
+};
+
+/**
+ * @brief Read the data for several SuperChunks using one HTTP request.
+ *
+ * All the SuperChunks must use the same URL. The request lists each
+ * SuperChunk's bytes in one Range header ('bytes=a-b,c-d,...') and the
+ * response is parsed directly into the SuperChunks' read buffers.
+ *
+ * There is no header that says a server will answer a multi-range request
+ * with a multipart/byteranges response - S3, for one, sends the whole object
+ * instead. So the first request to an origin is a test. If a successful
+ * response is anything other than a 206 that holds all the ranges, the transfer is
+ * stopped as soon as the headers are seen, the origin is noted as not
+ * supporting these requests (for the life of the process) and read() returns
+ * false. The caller then reads the SuperChunks one at a time, as usual.
+ */
+class MultiRangeRequest {
+public:
+    enum origin_support { unknown, supported, unsupported };
+
+private:
+    std::shared_ptr<http::url> d_data_url;
+    std::vector<std::shared_ptr<SuperChunk>> d_super_chunks;
+
+    // What each origin (protocol and host) did with a multi-range request
+    static std::mutex d_origins_mtx;
+    static std::map<std::string, origin_support> d_origins;
+
+    friend class MultiRangeRequestTest;
+
+public:
+    explicit MultiRangeRequest(std::shared_ptr<http::url> data_url) : d_data_url(std::move(data_url)) {}
+    virtual ~MultiRangeRequest() = default;
+
+    bool add(const std::shared_ptr<SuperChunk> &super_chunk);
+    size_t size() const { return d_super_chunks.size(); }
+    std::shared_ptr<http::url> get_data_url() const { return d_data_url; }
+
+    std::string get_range_arg_string() const;
+
+    bool read();
+
+    static std::string origin(const std::shared_ptr<http::url> &data_url);
+    static origin_support get_origin_support(const std::shared_ptr<http::url> &data_url);
+    static void set_origin_support(const std::shared_ptr<http::url> &data_url, origin_support support);
+};
+
+void read_super_chunks_multi_range(std::queue<std::shared_ptr<SuperChunk>> super_chunks);
+
+} // namespace dmrpp
+
+#endif // _dmrpp_multi_range_request_h
@@ -23,17 +23,23 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <sstream>
 #include <vector>
 #include <string>
+#include <mutex>
+#include <condition_variable>
 
 #include "BESInternalError.h"
 #include "BESDebug.h"
+#include "HttpNames.h"
 
 #include "DmrppRequestHandler.h"
 #include "CurlHandlePool.h"
+#include "CurlMultiEngine.h"
 #include "DmrppArray.h"
 #include "DmrppNames.h"
+#include "DmrppThreadPool.h"
 #include "Chunk.h"
 #include "SuperChunk.h"
 
@@ -47,9 +53,6 @@ using std::vector;
 
 namespace dmrpp {
 
-// ThreadPool state variables.
-std::mutex chunk_processing_thread_pool_mtx;     // mutex for critical section
-atomic_uint chunk_processing_thread_counter(0);
 #define COMPUTE_THREADS "compute_threads"
 
 #define DMRPP_ENABLE_THREAD_TIMERS 0
@@ -128,8 +131,17 @@ void process_one_chunk_unconstrained(shared_ptr<Chunk> chunk, const vector<unsig
     chunk->read_chunk();
 
     if(array){
-        if (!chunk->get_uses_fill_value() && !array->is_filters_empty())
+        if (!chunk->get_uses_fill_value() && !array->is_filters_empty()) {
+            // When the chunk is one contiguous run of the array, decode it in place.
+            char *target = array->contiguous_chunk_target(chunk, array_shape, chunk_shape);
+            if (target && chunk->filter_chunk_into(target, array->get_filters(), array->get_chunk_size_in_elements(),
+                                                   array->get_bytes_per_element())) {
+                BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Decoded in place. END" << endl );
+                return;
+            }
+
             chunk->filter_chunk(array->get_filters(), array->get_chunk_size_in_elements(), array->get_bytes_per_element());
+        }
 
         array->insert_chunk_unconstrained(chunk, 0, 0, array_shape, 0, chunk_shape, chunk->get_position_in_array());
     }
@@ -152,11 +164,11 @@ void process_one_chunk_unconstrained_dio(shared_ptr<Chunk> chunk, const vector<u
 }
 
 /**
- * @brief A single argument wrapper for process_one_chunk() for use with std::async().
- * @param args A unique_ptr to an instance of one_chunk_args.
+ * @brief A single argument wrapper for process_one_chunk() for use with the DmrppThreadPool.
+ * @param args A shared_ptr to an instance of one_chunk_args.
  * @return True unless an exception is throw in which case neither true or false apply.
  */
-bool one_chunk_compute_thread(unique_ptr<one_chunk_args> args)
+bool one_chunk_compute_thread(const shared_ptr<one_chunk_args> &args)
 {
 #if DMRPP_ENABLE_THREAD_TIMERS
     stringstream timer_tag;
@@ -171,11 +183,11 @@ bool one_chunk_compute_thread(unique_ptr<one_chunk_args> args)
 }
 
 /**
- * @brief A single argument wrapper for process_one_chunk_unconstrained() for use with std::async().
- * @param args A unique_ptr to an instance of one_chunk_args.
+ * @brief A single argument wrapper for process_one_chunk_unconstrained() for use with the DmrppThreadPool.
+ * @param args A shared_ptr to an instance of one_chunk_args.
  * @return True unless an exception is throw in which case neither true or false apply.
  */
-bool one_chunk_unconstrained_compute_thread(unique_ptr<one_chunk_unconstrained_args> args)
+bool one_chunk_unconstrained_compute_thread(const shared_ptr<one_chunk_unconstrained_args> &args)
 {
 #if DMRPP_ENABLE_THREAD_TIMERS
     stringstream timer_tag;
@@ -189,7 +201,7 @@ bool one_chunk_unconstrained_compute_thread(unique_ptr<one_chunk_unconstrained_a
     return true;
 }
 
-bool one_chunk_unconstrained_compute_thread_dio(unique_ptr<one_chunk_unconstrained_args> args)
+bool one_chunk_unconstrained_compute_thread_dio(const shared_ptr<one_chunk_unconstrained_args> &args)
 {
 #if DMRPP_ENABLE_THREAD_TIMERS
     stringstream timer_tag;
@@ -203,72 +215,13 @@ bool one_chunk_unconstrained_compute_thread_dio(unique_ptr<one_chunk_unconstrain
     return true;
 }
 /**
- * @brief Asynchronously starts the one_chunk_compute_thread using std::async() and places the returned std::future in the queue futures.
- *
- * NOTE: one_chunk_compute_thread is a wrapper() for process_one_chunk()
- *
- * @param futures The queue into which to place the future returned by async.
- * @param args The arguments for the one_chunk_compute_thread function
- * @return Returns true if the std::async() call was made and a future was returned, false if the
- * chunk_processing_thread_counter has reached the maximum allowable size.
- */
-bool start_one_chunk_compute_thread(list<std::future<bool>> &futures, unique_ptr<one_chunk_args> args) {
-    bool retval = false;
-    std::unique_lock<std::mutex> lck (chunk_processing_thread_pool_mtx);
-    BESDEBUG(SUPER_CHUNK_MODULE, prolog << "d_max_compute_threads: " << DmrppRequestHandler::d_max_compute_threads << " chunk_processing_thread_counter: " << chunk_processing_thread_counter << endl);
-    if (chunk_processing_thread_counter < DmrppRequestHandler::d_max_compute_threads) {
-        chunk_processing_thread_counter++;
-        futures.push_back(std::async(std::launch::async, one_chunk_compute_thread, std::move(args)));
-        retval = true;
-        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Got std::future '" << futures.size() <<
-                                            "' from std::async, chunk_processing_thread_counter: " << chunk_processing_thread_counter << endl);
-    }
-    return retval;
-}
-
-/**
- * @brief Asynchronously starts the one_chunk_unconstrained_compute_thread using std::async() and places the returned std::future in the queue futures.
- *
- * NOTE: one_chunk_unconstrained_compute_thread() is a wrapper for process_one_chunk_unconstrained()
- *
- * @param futures The queue into which to place the future returned by async.
- * @param args The arguments for the one_chunk_compute_thread function
- * @return Returns true if the std::async() call was made and a future was returned, false if the
- * chunk_processing_thread_counter has reached the maximum allowable size.
- */
-bool start_one_chunk_unconstrained_compute_thread(list<std::future<bool>> &futures, unique_ptr<one_chunk_unconstrained_args> args) {
-    bool retval = false;
-    std::unique_lock<std::mutex> lck (chunk_processing_thread_pool_mtx);
-    if (chunk_processing_thread_counter < DmrppRequestHandler::d_max_compute_threads) {
-        futures.push_back(std::async(std::launch::async, one_chunk_unconstrained_compute_thread, std::move(args)));
-        chunk_processing_thread_counter++;
-        retval = true;
-        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Got std::future '" << futures.size() <<
-                                            "' from std::async, chunk_processing_thread_counter: " << chunk_processing_thread_counter << endl);
-    }
-    return retval;
-}
-
-bool start_one_chunk_unconstrained_compute_thread_dio(list<std::future<bool>> &futures, unique_ptr<one_chunk_unconstrained_args> args) {
-    bool retval = false;
-    std::unique_lock<std::mutex> lck (chunk_processing_thread_pool_mtx);
-    if (chunk_processing_thread_counter < DmrppRequestHandler::d_max_compute_threads) {
-        futures.push_back(std::async(std::launch::async, one_chunk_unconstrained_compute_thread_dio, std::move(args)));
-        chunk_processing_thread_counter++;
-        retval = true;
-        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Got std::future '" << futures.size() <<
-                                            "' from std::async, chunk_processing_thread_counter: " << chunk_processing_thread_counter << endl);
-    }
-    return retval;
-}
-
-
-/**
- * @brief Uses std::async and std::future to concurrently retrieve/inflate/shuffle/insert/etc the Chunks in the queue "chunks".
+ * @brief Concurrently retrieve/inflate/shuffle/insert/etc the Chunks in the queue "chunks".
  *
- * For each Chunk in the queue, process the chunked data by using std::async() to generate a std::future which will
+ * For each Chunk in the queue, make a task for the compute lane of the DmrppThreadPool which will
  * perform the data retrieval (if the Chunk has not been read previously) and subsequent computational steps
- * (inflate/shuffle/etc) and finally insertion into the DmrppArray's internal data buffer.
+ * (inflate/shuffle/etc) and finally insertion into the DmrppArray's internal data buffer. This function
+ * returns when all the tasks are done. If one fails, the tasks that have not started are skipped and
+ * the first exception is rethrown.
  *
  * NOTE: There are 4 variants of this function:
  *
@@ -290,77 +243,22 @@ void process_chunks_concurrent(
         DmrppArray *array,
         const vector<unsigned long long> &constrained_array_shape ){
 
-    // We maintain a list  of futures to track our parallel activities.
-    list<future<bool>> futures;
-    try {
-        bool done = false;
-        bool future_finished = true;
-        while (!done) {
-
-            if(!futures.empty())
-                future_finished = get_next_future(futures, chunk_processing_thread_counter, DMRPP_WAIT_FOR_FUTURE_MS, prolog);
-
-            // If future_finished is true this means that the chunk_processing_thread_counter has been decremented,
-            // because future::get() was called or a call to future::valid() returned false.
-            BESDEBUG(SUPER_CHUNK_MODULE, prolog << "future_finished: " << (future_finished ? "true" : "false") << endl);
-
-            if (!chunks.empty()){
-                // Next we try to add a new Chunk compute thread if we can - there might be room.
-                bool thread_started = true;
-                while(thread_started && !chunks.empty()) {
-                    auto chunk = chunks.front();
-                    BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Starting thread for " << chunk->to_string() << endl);
-
-                    auto args = unique_ptr<one_chunk_args>(new one_chunk_args(super_chunk_id, chunk, array, constrained_array_shape));
-                    thread_started = start_one_chunk_compute_thread(futures, std::move(args));
-
-                    if (thread_started) {
-                        chunks.pop();
-                        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "STARTED thread for " << chunk->to_string() << endl);
-                    } else {
-                        // Thread did not start, ownership of the arguments was not passed to the thread.
-                        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Thread not started. args deleted, Chunk remains in queue.) " <<
-                                                            "chunk_processing_thread_counter: " << chunk_processing_thread_counter << " futures.size(): " << futures.size() << endl);
-                    }
-                }
-            }
-            else {
-                // No more Chunks and no futures means we're done here.
-                if(futures.empty())
-                    done = true;
-            }
-            future_finished = false;
-        }
-    }
-    catch (...) {
-        // Complete all of the futures, otherwise we'll have threads out there using up resources
-        while(!futures.empty()){
-            if(futures.back().valid())
-                futures.back().get();
-            futures.pop_back();
-        }
-        // re-throw the exception
-        throw;
+    vector<DmrppThreadPool::task> tasks;
+    tasks.reserve(chunks.size());
+    while (!chunks.empty()) {
+        auto args = make_shared<one_chunk_args>(super_chunk_id, chunks.front(), array, constrained_array_shape);
+        chunks.pop();
+        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Queuing task for " << args->chunk->to_string() << endl);
+        tasks.emplace_back([args]() { one_chunk_compute_thread(args); });
     }
+
+    DmrppThreadPool::TheThreadPool()->run_tasks(compute_lane, tasks);
 }
 
 /**
- * @brief Uses std::async and std::future to concurrently retrieve/inflate/shuffle/insert/etc the Chunks in the queue "chunks".
- *
- * For each Chunk in the queue, process the chunked data by using std::async() to generate a std::future which will
- * perform the data retrieval (if the Chunk has not been read previously) and subsequent computational steps
- * (inflate/shuffle/etc) and finally insertion into the DmrppArray's internal data buffer.
- *
- * NOTE: There are 4 variants of this function:
- *
- *  - process_chunks_concurrent()
- *  - process_chunks_unconstrained_concurrent()
- *  - read_super_chunks_concurrent()
- *  - read_super_chunks_unconstrained_concurrent
- *
- *  If structural/algorithmic changes need to be made to this function it is almost certain that similar changes will
- *  be required in the other 3 functions.
+ * @brief Concurrently retrieve/inflate/shuffle/insert/etc the Chunks in the queue "chunks".
  *
+ * @see process_chunks_concurrent()
  * @param chunks The queue of Chunk objects to process.
  * @param chunk_shape The shape of the chunk (passing is faster than recomputing this value)
  * @param array The DmrppArray into which the chunk data will be placed.
@@ -373,55 +271,15 @@ void process_chunks_unconstrained_concurrent(
         DmrppArray *array,
         const vector<unsigned long long> &array_shape){
 
-    // We maintain a list  of futures to track our parallel activities.
-    list<future<bool>> futures;
-    try {
-        bool done = false;
-        while (!done) {
-
-            if(!futures.empty())
-                get_next_future(futures, chunk_processing_thread_counter, DMRPP_WAIT_FOR_FUTURE_MS, prolog);
-
-            // If future_finished is true this means that the chunk_processing_thread_counter has been decremented,
-            // because future::get() was called or a call to future::valid() returned false.
-
-            if (!chunks.empty()){
-                // Next we try to add a new Chunk compute thread if we can - there might be room.
-                bool thread_started = true;
-                while(thread_started && !chunks.empty()) {
-                    auto chunk = chunks.front();
-
-                    auto args = unique_ptr<one_chunk_unconstrained_args>(
-                            new one_chunk_unconstrained_args(super_chunk_id, chunk, array, array_shape, chunk_shape) );
-                    thread_started = start_one_chunk_unconstrained_compute_thread(futures, std::move(args));
-
-                    if (thread_started) {
-                        chunks.pop();
-                    } else {
-                        // Thread did not start, ownership of the arguments was not passed to the thread.
-                        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Thread not started. args deleted, Chunk remains in queue.)" <<
-                                                            " chunk_processing_thread_counter: " << chunk_processing_thread_counter <<
-                                                            " futures.size(): " << futures.size() << endl);
-                    }
-                }
-            }
-            else {
-                // No more Chunks and no futures means we're done here.
-                if(futures.empty())
-                    done = true;
-            }
-        }
-    }
-    catch (...) {
-        // Complete all the futures, otherwise we'll have threads out there using up resources
-        while(!futures.empty()){
-            if(futures.back().valid())
-                futures.back().get();
-            futures.pop_back();
-        }
-        // re-throw the exception
-        throw;
+    vector<DmrppThreadPool::task> tasks;
+    tasks.reserve(chunks.size());
+    while (!chunks.empty()) {
+        auto args = make_shared<one_chunk_unconstrained_args>(super_chunk_id, chunks.front(), array, array_shape, chunk_shape);
+        chunks.pop();
+        tasks.emplace_back([args]() { one_chunk_unconstrained_compute_thread(args); });
     }
+
+    DmrppThreadPool::TheThreadPool()->run_tasks(compute_lane, tasks);
 }
 
 //Direct IO routine for processing chunks when the variable is not constrained. 
@@ -432,59 +290,121 @@ void process_chunks_unconstrained_concurrent_dio(
         DmrppArray *array,
         const vector<unsigned long long> &array_shape){
 
-    // We maintain a list  of futures to track our parallel activities.
-    list<future<bool>> futures;
-    try {
-        bool done = false;
-        while (!done) {
-
-            if(!futures.empty())
-                get_next_future(futures, chunk_processing_thread_counter, DMRPP_WAIT_FOR_FUTURE_MS, prolog);
-
-            // If future_finished is true this means that the chunk_processing_thread_counter has been decremented,
-            // because future::get() was called or a call to future::valid() returned false.
-
-            if (!chunks.empty()){
-                // Next we try to add a new Chunk compute thread if we can - there might be room.
-                bool thread_started = true;
-                while(thread_started && !chunks.empty()) {
-                    auto chunk = chunks.front();
-
-                    auto args = unique_ptr<one_chunk_unconstrained_args>(
-                            new one_chunk_unconstrained_args(super_chunk_id, chunk, array, array_shape, chunk_shape) );
-
-                    // Call direct IO routine
-                    thread_started = start_one_chunk_unconstrained_compute_thread_dio(futures, std::move(args));
-
-                    if (thread_started) {
-                        chunks.pop();
-                    } else {
-                        // Thread did not start, ownership of the arguments was not passed to the thread.
-                        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Thread not started. args deleted, Chunk remains in queue.)" <<
-                                                            " chunk_processing_thread_counter: " << chunk_processing_thread_counter <<
-                                                            " futures.size(): " << futures.size() << endl);
-                    }
-                }
-            }
-            else {
-                // No more Chunks and no futures means we're done here.
-                if(futures.empty())
-                    done = true;
-            }
+    vector<DmrppThreadPool::task> tasks;
+    tasks.reserve(chunks.size());
+    while (!chunks.empty()) {
+        auto args = make_shared<one_chunk_unconstrained_args>(super_chunk_id, chunks.front(), array, array_shape, chunk_shape);
+        chunks.pop();
+        // Call direct IO routine
+        tasks.emplace_back([args]() { one_chunk_unconstrained_compute_thread_dio(args); });
+    }
+
+    DmrppThreadPool::TheThreadPool()->run_tasks(compute_lane, tasks);
+}
+
+/**
+ * @brief Read SuperChunks using the CurlMultiEngine and process each one as its transfer completes.
+ *
+ * The transfers for all the HTTP/S SuperChunks are submitted to the engine, up to
+ * DmrppRequestHandler::d_max_in_flight_transfers at a time, so one event-loop thread
+ * keeps them in flight instead of one transfer thread per SuperChunk. When a transfer
+ * completes, \arg process is queued for that SuperChunk in the compute lane of the
+ * DmrppThreadPool. Other SuperChunks (fill values, local files, and those whose child
+ * chunks are streamed; see SuperChunk::use_async_transfer()) are read and processed
+ * using the transfer lane, as read_super_chunks_concurrent() does.
+ *
+ * This returns when all the SuperChunks have been processed. If anything fails,
+ * SuperChunks that have not been started are skipped and the first error is rethrown.
+ *
+ * @param super_chunks The SuperChunks to read; emptied by this function.
+ * @param process Reads the child chunks of a SuperChunk into its array, e.g.,
+ * SuperChunk::read(). Called on a DmrppThreadPool thread.
+ */
+void read_super_chunks_async(queue<shared_ptr<SuperChunk>> &super_chunks,
+                             const function<void(const shared_ptr<SuperChunk> &)> &process)
+{
+    struct transfer_window {
+        mutex mtx;
+        condition_variable cv;
+        unsigned int in_flight = 0;
+        exception_ptr error = nullptr;
+    };
+
+    auto pool = DmrppThreadPool::TheThreadPool();
+    auto compute_group = make_shared<TaskGroup>(compute_lane);
+    auto transfer_group = make_shared<TaskGroup>(transfer_lane);
+    auto window = make_shared<transfer_window>();
+    const unsigned int max_in_flight = max(DmrppRequestHandler::d_max_in_flight_transfers, 1U);
+
+    while (!super_chunks.empty()) {
+        auto super_chunk = super_chunks.front();
+        super_chunks.pop();
+
+        if (!super_chunk->use_async_transfer()) {
+            pool->submit(transfer_group, [super_chunk, &process]() { process(super_chunk); });
+            continue;
+        }
+
+        {
+            unique_lock<mutex> lck(window->mtx);
+            window->cv.wait(lck, [&window, max_in_flight] {
+                return window->in_flight < max_in_flight || window->error;
+            });
+            if (window->error || compute_group->cancelled() || transfer_group->cancelled())
+                break;
+            window->in_flight++;
+        }
+
+        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Submitting " << super_chunk->to_string(false) << endl);
+        try {
+            super_chunk->retrieve_data_async([super_chunk, pool, compute_group, window, &process](exception_ptr error) {
+                if (error)
+                    compute_group->cancel();
+                else
+                    pool->submit(compute_group, [super_chunk, &process]() { process(super_chunk); });
+
+                lock_guard<mutex> lck(window->mtx);
+                if (error && !window->error)
+                    window->error = error;
+                window->in_flight--;
+                window->cv.notify_all();
+            });
+        }
+        catch (...) {
+            lock_guard<mutex> lck(window->mtx);
+            if (!window->error)
+                window->error = current_exception();
+            window->in_flight--;
+            break;
         }
     }
-    catch (...) {
-        // Complete all the futures, otherwise we'll have threads out there using up resources
-        while(!futures.empty()){
-            if(futures.back().valid())
-                futures.back().get();
-            futures.pop_back();
+
+    // Wait for the transfers; the completions reference the window and the groups.
+    {
+        unique_lock<mutex> lck(window->mtx);
+        if (window->error) {
+            compute_group->cancel();
+            transfer_group->cancel();
+        }
+        window->cv.wait(lck, [&window] { return window->in_flight == 0; });
+    }
+
+    exception_ptr task_error = nullptr;
+    for (auto group: {compute_group, transfer_group}) {
+        try {
+            pool->wait(*group);
+        }
+        catch (...) {
+            if (!task_error)
+                task_error = current_exception();
         }
-        // re-throw the exception
-        throw;
     }
-}
 
+    if (window->error)
+        rethrow_exception(window->error);
+    if (task_error)
+        rethrow_exception(task_error);
+}
 
 //#####################################################################################################################
 //#####################################################################################################################
@@ -494,6 +414,10 @@ void process_chunks_unconstrained_concurrent_dio(
 //
 // = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = = =
 
+std::atomic<unsigned long long> SuperChunk::d_requests{0};
+std::atomic<unsigned long long> SuperChunk::d_bytes_requested{0};
+std::atomic<unsigned long long> SuperChunk::d_gap_bytes_requested{0};
+
 // TODO There are (at least) two ways to handle 'fill value chunks.' The code can group
 //  them all together as one big SuperChunk or store each FV chunk in its own SuperChunk.
 //  (Of course, there are alternatives...) Using one SuperChunk is probably faster but
@@ -505,8 +429,9 @@ void process_chunks_unconstrained_concurrent_dio(
  * @brief Attempts to add a new Chunk to this SuperChunk.
  *
  * The candidate_chunk is added to this SuperChunk if: it is contiguous with
- * the end of the this SuperChunk and has the same data_url. Note that if the
- * SuperChunk is empty, candidate_chunk meets those criteria by default.
+ * (or close enough to, see is_contiguous()) the end of the this SuperChunk
+ * and has the same data_url. Note that if the SuperChunk is empty,
+ * candidate_chunk meets those criteria by default.
  *
  * @note This method was modified to support fill value chunks as part of the
  * work on HYRAX-635. As a stop-gap implementation, each fill value chunk will
@@ -536,12 +461,21 @@ bool SuperChunk::add_chunk(const std::shared_ptr<Chunk> candidate_chunk) {
             d_data_url = candidate_chunk->get_data_url();
         else
             d_data_url = nullptr;
+
+        // Reading the bytes between chunks only pays when each request has a
+        // round-trip cost, i.e., for data read using HTTP.
+        const bool remote = d_data_url && (d_data_url->protocol() == HTTP_PROTOCOL
+                                           || d_data_url->protocol() == HTTPS_PROTOCOL);
+        d_max_gap = remote ? DmrppRequestHandler::d_super_chunk_max_gap : 0;
+        d_max_size = DmrppRequestHandler::d_super_chunk_max_size;
         chunk_was_added =  true;
     }
     // For now, if a chunk uses fill values, it gets its own SuperChunk. jhrg 5/7/22
     else if(!candidate_chunk->get_uses_fill_value() && is_contiguous(candidate_chunk)){
+        const unsigned long long gap = candidate_chunk->get_offset() - (d_offset + d_size);
         this->d_chunks.push_back(candidate_chunk);
-        d_size += candidate_chunk->get_size();
+        d_gap_bytes += gap;
+        d_size += gap + candidate_chunk->get_size();
         chunk_was_added =  true;
     }
     return chunk_was_added;
@@ -553,8 +487,15 @@ bool SuperChunk::add_chunk(const std::shared_ptr<Chunk> candidate_chunk) {
  * Returns true if the implemented rule for contiguousity determines that the candidate_chunk is
  * contiguous with this SuperChunk and false otherwise.
  *
- * Currently the rule is that the offset of the candidate_chunk must be the same as the current
- * offset + size of the SuperChunk, and the data_url is the same as the one in the SuperChunk.
+ * The data_url must be the same as the one in the SuperChunk and the candidate_chunk must
+ * start at or after the end of the SuperChunk. The SuperChunk, including any gap before
+ * the candidate_chunk, must not become larger than the maximum size.
+ *
+ * A gap is allowed because reading a few unneeded bytes costs less than another request:
+ * with a per-request latency of 30 - 80 ms and a transfer rate of tens of MB/s, reading up
+ * to a MB or so takes about as long as the round trip it saves. So the candidate_chunk may
+ * start up to d_max_gap bytes past the end of the SuperChunk (d_max_gap is zero for local
+ * files), provided that the gaps do not come to more bytes than the chunks themselves.
  *
  * @todo Declare candidate_chunk as a reference to avoid needless copy.
  *
@@ -563,29 +504,39 @@ bool SuperChunk::add_chunk(const std::shared_ptr<Chunk> candidate_chunk) {
  */
 bool SuperChunk::is_contiguous(const std::shared_ptr<Chunk> candidate_chunk) {
     // Are the URLs the same?
-    bool contiguous  = candidate_chunk->get_data_url()->str() == d_data_url->str();
-    if(contiguous){
-        // If the URLs match then see if the locations are matching
-        contiguous = (d_offset + d_size) == candidate_chunk->get_offset();
-    }
-    return contiguous;
+    if (candidate_chunk->get_data_url()->str() != d_data_url->str())
+        return false;
+
+    // Only chunks that follow the SuperChunk can be added.
+    const unsigned long long end = d_offset + d_size;
+    if (candidate_chunk->get_offset() < end)
+        return false;
+
+    const unsigned long long gap = candidate_chunk->get_offset() - end;
+    if (d_max_size > 0 && d_size + gap + candidate_chunk->get_size() > d_max_size)
+        return false;
+
+    if (gap == 0)
+        return true;
+
+    const unsigned long long chunk_bytes = d_size - d_gap_bytes + candidate_chunk->get_size();
+    return gap <= d_max_gap && d_gap_bytes + gap <= chunk_bytes;
 }
 
 /**
  * @brief  Assigns each Chunk held by the SuperChunk a read buffer.
  *
  * Each Chunk's read buffer is mapped to the corresponding section of the SuperChunk's
- * enclosing read buffer.
+ * enclosing read buffer. The bytes between chunks, if any, are not mapped.
  *
  * This is a convenience/helper function for SuperChunk::read()
  */
 void SuperChunk::map_chunks_to_buffer()
 {
-    unsigned long long bindex = 0;
     for(const auto &chunk : d_chunks){
+        const unsigned long long bindex = chunk->get_offset() - d_offset;
         chunk->set_read_buffer(d_read_buffer + bindex, chunk->get_size(),0, false);
-        bindex += chunk->get_size();
-        if (bindex > d_size) {
+        if (bindex + chunk->get_size() > d_size) {
             stringstream msg;
             msg << "ERROR The computed buffer index, " << bindex << " is larger than expected size of the SuperChunk. ";
             msg << "d_size: " << d_size;
@@ -596,9 +547,18 @@ void SuperChunk::map_chunks_to_buffer()
 
 /**
  * @brief Reads the contiguous range of bytes associated with the SuperChunk from the data URL.
+ *
+ * Each child Chunk is marked as read once all of its bytes are in the buffer. If
+ * \arg child_ready is given, it is called for each child as soon as that happens,
+ * while the rest of the SuperChunk is still being transferred. The children are
+ * handed off in order and each one exactly once; a child is never touched again
+ * by this method after it has been passed to \arg child_ready.
+ *
  * This is a convenience/helper function for SuperChunk::retrieve_data()
+ *
+ * @param child_ready If not null, called for each child Chunk once it has been read.
  */
-void SuperChunk::read_aggregate_bytes()
+void SuperChunk::read_aggregate_bytes(const child_chunk_handler &child_ready)
 {
     // Since we already have a good infrastructure for reading Chunks, we just make a big-ol-Chunk to
     // use for grabbing bytes. Then, once read, we'll use the child Chunks to do the dirty work of inflating
@@ -607,10 +567,38 @@ void SuperChunk::read_aggregate_bytes()
 
     chunk.set_read_buffer(d_read_buffer, d_size,0,false);
 
+    // The children are in offset order (see add_chunk()), so the next one to
+    // finish is always d_chunks[next_child].
+    size_t next_child = 0;
+    auto child_end = [this](size_t i) { return d_chunks[i]->get_offset() - d_offset + d_chunks[i]->get_size(); };
+    auto release_read_children = [this, &next_child, &child_end, &child_ready](unsigned long long bytes_read) {
+        while (next_child < d_chunks.size() && child_end(next_child) <= bytes_read) {
+            const auto &child = d_chunks[next_child++];
+            child->set_is_read(true);
+            child->set_bytes_read(child->get_size());
+            if (child_ready)
+                child_ready(child);
+        }
+    };
+
+    if (child_ready) {
+        chunk.set_write_callback([&chunk, &release_read_children](unsigned long long bytes_read) {
+            // Don't pass on bytes from an error response; those are handled (and
+            // the request retried) by the transfer code.
+            const long code = chunk.get_response_code();
+            if (code == 0 || (code >= 200 && code < 300))
+                release_read_children(bytes_read);
+        });
+    }
+
     dmrpp_easy_handle *handle = DmrppRequestHandler::curl_handle_pool->get_easy_handle(&chunk);
     if (!handle)
         throw BESInternalError(prolog + "No more libcurl handles.", __FILE__, __LINE__);
 
+    d_requests++;
+    d_bytes_requested += d_size;
+    d_gap_bytes_requested += d_gap_bytes;
+
     try {
         handle->read_data();  // throws if error
         dmrpp::CurlHandlePool::release_handle(handle);
@@ -627,6 +615,9 @@ void SuperChunk::read_aggregate_bytes()
         throw BESInternalError(oss.str(), __FILE__, __LINE__);
     }
 
+    // Any children not yet released (all of them when not streaming).
+    release_read_children(d_size);
+
     d_is_read = true;
 }
 
@@ -649,8 +640,10 @@ void SuperChunk::read_fill_value_chunk()
 
 /**
  * @brief Cause the SuperChunk and all of it's subordinate Chunks to be read.
+ * @param child_ready If not null, called for each child Chunk as soon as its
+ * data have been read. See read_aggregate_bytes().
  */
-void SuperChunk::retrieve_data() {
+void SuperChunk::retrieve_data(const child_chunk_handler &child_ready) {
     // TODO I think this code should set d_is_read. It sets it for the Chunk, which may be redundant). jhrg 5/9/22
     if (d_is_read) {
         BESDEBUG(SUPER_CHUNK_MODULE, prolog << "SuperChunk (" << (void **) this << ") has already been read! Returning." << endl);
@@ -664,7 +657,7 @@ void SuperChunk::retrieve_data() {
     if (!d_read_buffer) {
         // Allocate memory for SuperChunk receive buffer.
         // release memory in destructor.
-        d_read_buffer = new char[d_size];
+        d_read_buffer = ChunkBufferPool::ThePool()->allocate(d_size);
     }
 
     // Massage the chunks so that their read/receive/intern data buffer
@@ -677,19 +670,20 @@ void SuperChunk::retrieve_data() {
     // and utilize our friend cURL to stuff the bytes into d_read_buffer
     //
     // TODO Replace or improve this way of handling fill value chunks. jhrg 5/7/22
-    if (d_uses_fill_value)
+    if (d_uses_fill_value) {
         read_fill_value_chunk();
-    else
-        read_aggregate_bytes();
-
-    // TODO Check if Chunk::read() sets these. jhrg 5/9/22
-    // Set each Chunk's read state to true.
-    // Set each chunks byte count to the expected
-    // size for the chunk - because upstream events
-    // have assured this to be true.
-    for(const auto& chunk : d_chunks){
-        chunk->set_is_read(true);
-        chunk->set_bytes_read(chunk->get_size());
+        // Set each Chunk's read state to true and its byte count to the expected
+        // size for the chunk - because upstream events have assured this to be true.
+        // read_aggregate_bytes() does this for chunks that are transferred.
+        for (const auto &chunk: d_chunks) {
+            chunk->set_is_read(true);
+            chunk->set_bytes_read(chunk->get_size());
+            if (child_ready)
+                child_ready(chunk);
+        }
+    }
+    else {
+        read_aggregate_bytes(child_ready);
     }
 }
 
@@ -707,7 +701,7 @@ void SuperChunk::retrieve_data_dio() {
     if (!d_read_buffer) {
         // Allocate memory for SuperChunk receive buffer.
         // release memory in destructor.
-        d_read_buffer = new char[d_size];
+        d_read_buffer = ChunkBufferPool::ThePool()->allocate(d_size);
     }
 
     // Massage the chunks so that their read/receive/intern data buffer
@@ -720,19 +714,87 @@ void SuperChunk::retrieve_data_dio() {
     // and utilize our friend cURL to stuff the bytes into d_read_buffer
     //
     // TODO Replace or improve this way of handling fill value chunks. jhrg 5/7/22
+    // This also sets each child Chunk's read state and byte count.
     read_aggregate_bytes();
+}
 
-    // TODO Check if Chunk::read() sets these. jhrg 5/9/22
-    // Set each Chunk's read state to true.
-    // Set each chunks byte count to the expected
-    // size for the chunk - because upstream events
-    // have assured this to be true.
-    for(const auto& chunk : d_chunks){
-        chunk->set_is_read(true);
-        chunk->set_bytes_read(chunk->get_size());
-    }
+
+/**
+ * @brief Can this SuperChunk be read by the CurlMultiEngine?
+ *
+ * Only HTTP/S transfers are run by the engine; fill value chunks and local
+ * files are read as usual. SuperChunks whose child chunks are processed while
+ * the transfer runs (see use_streaming()) are also read as usual, on the
+ * transfer lane. Their bytes are still moved by the engine, since
+ * dmrpp_easy_handle::read_data() uses it, but a transfer thread waits for
+ * them so the children can be queued as they arrive.
+ */
+bool SuperChunk::use_async_transfer() const
+{
+    if (d_is_read || d_uses_fill_value || !d_data_url || use_streaming())
+        return false;
+    const string protocol = d_data_url->protocol();
+    return protocol == HTTPS_PROTOCOL || protocol == HTTP_PROTOCOL;
 }
 
+/**
+ * @brief Start reading the SuperChunk's bytes using the CurlMultiEngine.
+ *
+ * This returns as soon as the transfer has been submitted. Once all the bytes
+ * have been read, the SuperChunk and its children are marked as read and
+ * \arg done is called with a null argument. If the transfer fails, \arg done
+ * is called with the error. Either way, \arg done runs on the engine's
+ * event-loop thread, so it should only hand off the work that follows. The
+ * SuperChunk must not be destroyed before \arg done is called.
+ *
+ * @param done Called once the transfer is complete.
+ */
+void SuperChunk::retrieve_data_async(const std::function<void(std::exception_ptr)> &done)
+{
+    if (!d_read_buffer)
+        d_read_buffer = ChunkBufferPool::ThePool()->allocate(d_size);
+
+    map_chunks_to_buffer();
+
+    // As in read_aggregate_bytes(), one Chunk holds the whole SuperChunk. It must
+    // live until the transfer is done, so it is owned by the completion.
+    auto chunk = make_shared<Chunk>(d_data_url, "NOT_USED", d_size, d_offset);
+    chunk->set_read_buffer(d_read_buffer, d_size, 0, false);
+
+    dmrpp_easy_handle *handle = DmrppRequestHandler::curl_handle_pool->get_easy_handle(chunk.get());
+    if (!handle)
+        throw BESInternalError(prolog + "No more libcurl handles.", __FILE__, __LINE__);
+
+    d_requests++;
+    d_bytes_requested += d_size;
+    d_gap_bytes_requested += d_gap_bytes;
+
+    try {
+        CurlMultiEngine::TheEngine()->submit(handle, [this, chunk, handle, done](exception_ptr error) {
+            dmrpp::CurlHandlePool::release_handle(handle);
+            if (!error && d_size != chunk->get_bytes_read()) {
+                ostringstream oss;
+                oss << "Wrong number of bytes read for chunk; read: " << chunk->get_bytes_read() << ", expected: "
+                    << d_size;
+                error = make_exception_ptr(BESInternalError(oss.str(), __FILE__, __LINE__));
+            }
+
+            if (!error) {
+                for (const auto &child: d_chunks) {
+                    child->set_is_read(true);
+                    child->set_bytes_read(child->get_size());
+                }
+                d_is_read = true;
+            }
+
+            done(error);
+        });
+    }
+    catch (...) {
+        dmrpp::CurlHandlePool::release_handle(handle);
+        throw;
+    }
+}
 
 /**
  * @brief Reads the SuperChunk, inflates/de-shuffles the subordinate chunks as required and copies the values into array
@@ -740,12 +802,21 @@ void SuperChunk::retrieve_data_dio() {
  */
 void SuperChunk::process_child_chunks() {
     BESDEBUG(SUPER_CHUNK_MODULE, prolog << "BEGIN" << endl);
-    retrieve_data();
 
     vector<unsigned long long> constrained_array_shape = d_parent_array->get_shape(true);
     BESDEBUG(SUPER_CHUNK_MODULE, prolog << "d_use_compute_threads: " << (DmrppRequestHandler::d_use_compute_threads ? "true" : "false") << endl);
     BESDEBUG(SUPER_CHUNK_MODULE, prolog << "d_max_compute_threads: " << DmrppRequestHandler::d_max_compute_threads << endl);
 
+    if (use_streaming()) {
+        process_child_chunks_streaming([this, &constrained_array_shape](const shared_ptr<Chunk> &chunk) {
+            process_one_chunk(chunk, d_parent_array, constrained_array_shape);
+        });
+        BESDEBUG(SUPER_CHUNK_MODULE, prolog << "END" << endl );
+        return;
+    }
+
+    retrieve_data();
+
     if (!DmrppRequestHandler::d_use_compute_threads) {
 #if DMRPP_ENABLE_THREAD_TIMERS
         BESStopWatch sw(SUPER_CHUNK_MODULE);
@@ -779,13 +850,21 @@ void SuperChunk::process_child_chunks() {
 void SuperChunk::process_child_chunks_unconstrained() {
 
     BESDEBUG(SUPER_CHUNK_MODULE, prolog << "BEGIN" << endl);
-    retrieve_data();
 
     // The size in element of each of the array's dimensions
     const vector<unsigned long long> array_shape = d_parent_array->get_shape(true);
     // The size, in elements, of each of the chunk's dimensions
     const vector<unsigned long long> chunk_shape = d_parent_array->get_chunk_dimension_sizes();
 
+    if (use_streaming()) {
+        process_child_chunks_streaming([this, &chunk_shape, &array_shape](const shared_ptr<Chunk> &chunk) {
+            process_one_chunk_unconstrained(chunk, chunk_shape, d_parent_array, array_shape);
+        });
+        return;
+    }
+
+    retrieve_data();
+
     if (!DmrppRequestHandler::d_use_compute_threads) {
 #if DMRPP_ENABLE_THREAD_TIMERS
         BESStopWatch sw(SUPER_CHUNK_MODULE);
@@ -811,6 +890,63 @@ void SuperChunk::process_child_chunks_unconstrained() {
 }
 
 
+/**
+ * @brief Should the child chunks be processed while the SuperChunk is transferred?
+ *
+ * Streaming only pays off when there is more than one child chunk. It needs the
+ * compute threads since the chunk processing must not block the transfer.
+ */
+bool SuperChunk::use_streaming() const
+{
+    return DmrppRequestHandler::d_stream_chunk_processing && DmrppRequestHandler::d_use_compute_threads
+           && !d_is_read && !d_uses_fill_value && d_chunks.size() > 1;
+}
+
+/**
+ * @brief Read the SuperChunk, processing each child chunk as soon as its bytes arrive.
+ *
+ * The transfer runs on the calling thread. As each child Chunk's byte range is
+ * completed (in the libcurl write callback) a task that runs \arg process_chunk
+ * for it is queued in the compute lane of the DmrppThreadPool, so inflating,
+ * unshuffling and inserting the values overlap with the transfer of the rest of
+ * the SuperChunk. This returns once the transfer and all the tasks are done.
+ *
+ * If the transfer fails, tasks that have not started are cancelled and the
+ * transfer error is rethrown. If a task fails, the first task error is thrown.
+ *
+ * @param process_chunk Called on a compute thread for each child chunk.
+ */
+void SuperChunk::process_child_chunks_streaming(const child_chunk_handler &process_chunk)
+{
+#if DMRPP_ENABLE_THREAD_TIMERS
+    BESStopWatch sw(SUPER_CHUNK_MODULE);
+    sw.start(prolog + "Streaming Chunk Processing. sc_id: " + d_id);
+#endif
+    auto pool = DmrppThreadPool::TheThreadPool();
+    auto group = make_shared<TaskGroup>(compute_lane);
+
+    try {
+        retrieve_data([pool, &group, &process_chunk](const shared_ptr<Chunk> &chunk) {
+            // Once one chunk has failed, there is no point in queuing more work.
+            if (!group->cancelled())
+                pool->submit(group, [chunk, &process_chunk]() { process_chunk(chunk); });
+        });
+    }
+    catch (...) {
+        group->cancel();
+        try {
+            pool->wait(*group);
+        }
+        catch (...) {
+            // The transfer error is the one to report.
+        }
+        throw;
+    }
+
+    BESDEBUG(SUPER_CHUNK_MODULE, prolog << "Transfer complete, waiting for chunk processing. sc_id: " << d_id << endl);
+    pool->wait(*group);
+}
+
 /**
  * @brief Makes a string representation of the SuperChunk.
  * @param verbose If set true then details of the subordinate Chunks will be included.
@@ -821,6 +957,7 @@ string SuperChunk::to_string(bool verbose=false) const {
     msg << "[SuperChunk: " << (void **)this;
     msg << " offset: " << d_offset;
     msg << " size: " << d_size ;
+    msg << " gap_bytes: " << d_gap_bytes;
     msg << " chunk_count: " << d_chunks.size();
     //msg << " parent: " << d_parent->name();
     msg << "]";
@@ -841,6 +978,19 @@ void SuperChunk::dump(ostream & strm) const {
     strm << to_string(false) ;
 }
 
+/**
+ * @brief Write the number of SuperChunk requests made by this process and the bytes they read.
+ *
+ * The gap bytes are the part of the bytes read that lie between chunks and were discarded.
+ * @param strm
+ */
+void SuperChunk::dump_transfer_stats(ostream &strm) {
+    const unsigned long long bytes = d_bytes_requested;
+    const unsigned long long gap_bytes = d_gap_bytes_requested;
+    strm << "SuperChunk requests: " << d_requests << " bytes read: " << bytes << " gap bytes read: " << gap_bytes
+         << " (" << (bytes ? 100.0 * double(gap_bytes) / double(bytes) : 0.0) << "%)" << endl;
+}
+
 // direct chunk method to read unconstrained variables.
 void SuperChunk::read_unconstrained_dio() {
 
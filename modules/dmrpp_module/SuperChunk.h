@@ -27,10 +27,14 @@
 #include <vector>
 #include <memory>
 #include <thread>
+#include <atomic>
+#include <exception>
 #include <queue>
 #include <sstream>
+#include <functional>
 
 #include "Chunk.h"
+#include "ChunkBufferPool.h"
 
 namespace dmrpp {
 
@@ -42,8 +46,13 @@ class DmrppArray;
  *
  */
 class SuperChunk {
-// private
+public:
+    /// Called for each child Chunk once all of its bytes have been read.
+    using child_chunk_handler = std::function<void(const std::shared_ptr<Chunk> &)>;
+
+private:
     friend class SuperChunkTest;
+    friend class MultiRangeRequest;
 
     std::string d_id;
     DmrppArray *d_parent_array = nullptr;
@@ -51,16 +60,27 @@ class SuperChunk {
     std::vector<std::shared_ptr<Chunk>> d_chunks;
     unsigned long long d_offset = 0;
     unsigned long long d_size = 0;
+    unsigned long long d_gap_bytes = 0;     // Bytes in d_size that are between the child chunks
+    unsigned long long d_max_gap = 0;
+    unsigned long long d_max_size = 0;
     bool d_is_read = false;
     char *d_read_buffer = nullptr;
 
     bool d_uses_fill_value{false};
 
+    // Requests made and bytes read by all the SuperChunks of this process
+    static std::atomic<unsigned long long> d_requests;
+    static std::atomic<unsigned long long> d_bytes_requested;
+    static std::atomic<unsigned long long> d_gap_bytes_requested;
+
     bool is_contiguous(std::shared_ptr<Chunk> candidate_chunk);
     void map_chunks_to_buffer();
-    void read_aggregate_bytes();
+    void read_aggregate_bytes(const child_chunk_handler &child_ready = nullptr);
     void read_fill_value_chunk();
 
+    bool use_streaming() const;
+    void process_child_chunks_streaming(const child_chunk_handler &process_chunk);
+
 public:
     // Make the sc_id an uint64 and not a string - the code uses sstream to make the value. jhrg 5/7/22
     explicit SuperChunk(const std::string &sc_id, DmrppArray *parent = nullptr) :
@@ -68,7 +88,7 @@ public:
     {}
 
     virtual ~SuperChunk(){
-        delete[] d_read_buffer;
+        ChunkBufferPool::ThePool()->release(d_read_buffer);
     }
 
     virtual std::string id() const { return d_id; }
@@ -78,6 +98,7 @@ public:
     std::shared_ptr<http::url> get_data_url() { return d_data_url; }
     virtual unsigned long long get_size() const { return d_size; }
     virtual unsigned long long get_offset() const { return d_offset; }
+    virtual unsigned long long get_gap_bytes() const { return d_gap_bytes; }
 
     virtual void read() {
         process_child_chunks();
@@ -90,8 +111,10 @@ public:
     virtual void read_unconstrained_dio(); 
 
 
-    virtual void retrieve_data();
+    virtual void retrieve_data(const child_chunk_handler &child_ready = nullptr);
     virtual void retrieve_data_dio();
+    virtual void retrieve_data_async(const std::function<void(std::exception_ptr)> &done);
+    virtual bool use_async_transfer() const;
 
     virtual void process_child_chunks();
     virtual void process_child_chunks_unconstrained();
@@ -100,11 +123,13 @@ public:
 
     std::string to_string(bool verbose) const;
     virtual void dump(std::ostream & strm) const;
+
+    static void dump_transfer_stats(std::ostream &strm);
 };
 
 /**
  * @brief Single argument structure for a thread that will process a single Chunk for a constrained array.
- * Utilized as an argument to std::async()
+ * Captured by the tasks run on the DmrppThreadPool.
  */
 struct one_chunk_args {
     std::thread::id parent_thread_id;
@@ -119,7 +144,7 @@ struct one_chunk_args {
 
 /**
  * @brief Single argument structure for a thread that will process a single Chunk for an unconstrained array.
- * Utilized as an argument to std::async()
+ * Captured by the tasks run on the DmrppThreadPool.
  * The \arg chunk_shape is part of an optimization for the unconstrained array case.
  */
 struct one_chunk_unconstrained_args {
@@ -156,6 +181,9 @@ void process_chunks_unconstrained_concurrent_dio(
         DmrppArray *array,
         const std::vector<unsigned long long> &array_shape);
 
+void read_super_chunks_async(std::queue<std::shared_ptr<SuperChunk>> &super_chunks,
+                             const std::function<void(const std::shared_ptr<SuperChunk> &)> &process);
+
 } // namespace dmrpp
 
 #endif // HYRAX_GIT_SUPERCHUNK_H
@@ -59,6 +59,7 @@
 #include "DmrppD4Group.h"
 #include "DmrppArray.h"
 #include "DmrppStructure.h"
+#include "ChunkFilters.h"
 #include "D4ParserSax2.h"
 
 #include "UnsupportedTypeException.h"
@@ -97,6 +98,11 @@ bool verbose = false;   // Optionally set by build_dmrpp's main().
 // H5Z_FILTER_SCALEOFFSET   6   scale+offset compression
 // H5Z_FILTER_RESERVED      256 filter ids below this value are reserved for library use
 
+// Registered third-party filters (https://github.com/HDFGroup/hdf5_plugins/blob/master/docs/RegisteredFilterPlugins.md)
+#define H5Z_FILTER_BLOSC        32001
+#define H5Z_FILTER_BITSHUFFLE   32008
+#define H5Z_FILTER_ZSTD         32015
+
 /**
  * Converts the H5Z_filter_t to a readable string.
  * @param filter_type an H5Z_filter_t representing the filter_type
@@ -126,6 +132,15 @@ string h5_filter_name(H5Z_filter_t filter_type) {
         case H5Z_FILTER_SCALEOFFSET:
             name = "H5Z_FILTER_SCALEOFFSET";
             break;
+        case H5Z_FILTER_BLOSC:
+            name = "H5Z_FILTER_BLOSC";
+            break;
+        case H5Z_FILTER_BITSHUFFLE:
+            name = "H5Z_FILTER_BITSHUFFLE";
+            break;
+        case H5Z_FILTER_ZSTD:
+            name = "H5Z_FILTER_ZSTD";
+            break;
         default:
         {
             ostringstream oss("ERROR! Unknown HDF5 FILTER (H5Z_filter_t) type: ", std::ios::ate);
@@ -197,12 +212,13 @@ static void set_filter_information(hid_t dataset_id, DmrppCommon *dc, bool disab
         int numfilt = H5Pget_nfilters(plist_id);
         VERBOSE(cerr << prolog << "Number of filters associated with dataset: " << numfilt << endl);
         string filters;
-        size_t nelmts = 20;
         unsigned int cd_values[20];
         vector<unsigned int> deflate_levels;
 
         for (int filter = 0; filter < numfilt; filter++) {
             unsigned int flags;
+            // H5Pget_filter2() sets nelmts to the number of values for this filter.
+            size_t nelmts = 20;
             H5Z_filter_t filter_type = H5Pget_filter2(plist_id, filter, &flags, &nelmts,
                                                       cd_values, 0, nullptr, nullptr);
             VERBOSE(cerr << prolog << "Found H5 Filter Type: " << h5_filter_name(filter_type) << " (" << filter_type << ")" << endl);
@@ -218,6 +234,20 @@ static void set_filter_information(hid_t dataset_id, DmrppCommon *dc, bool disab
                 case H5Z_FILTER_FLETCHER32:
                     filters.append("fletcher32 ");
                     break;
+                // These filters need the client data values to decode the data, so they
+                // are recorded along with the name, e.g., 'szip(141,32,32,256)'.
+                case H5Z_FILTER_SZIP:
+                    filters.append(make_filter_spec("szip", vector<unsigned int>(cd_values, cd_values + nelmts)) + " ");
+                    break;
+                case H5Z_FILTER_BITSHUFFLE:
+                    filters.append(make_filter_spec("bitshuffle", vector<unsigned int>(cd_values, cd_values + nelmts)) + " ");
+                    break;
+                case H5Z_FILTER_BLOSC:
+                    filters.append("blosc ");
+                    break;
+                case H5Z_FILTER_ZSTD:
+                    filters.append("zstd ");
+                    break;
                 default:
                     ostringstream oss("Unsupported HDF5 filter: ", std::ios::ate);
                     oss << filter_type;
@@ -231,8 +261,9 @@ static void set_filter_information(hid_t dataset_id, DmrppCommon *dc, bool disab
         filters = filters.substr(0, filters.size() - 1);
         dc->set_filter(filters);
         dc->set_deflate_levels(deflate_levels);
+        // Only deflate, shuffle and fletcher32 can be used with direct IO.
         if (!filters.empty())
-            dc->set_disable_dio(disable_dio);
+            dc->set_disable_dio(disable_dio || !filters_support_direct_io(filters));
     }
     catch (...) {
         H5Pclose(plist_id);
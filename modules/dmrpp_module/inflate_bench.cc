@@ -0,0 +1,206 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Compare the zlib and single-shot (libdeflate) inflate engines using the
+// deflated chunks of DMR++ test data. Build it using 'make inflate_bench'.
+//
+// Usage: inflate_bench [-r repetitions] file.dmrpp ...
+// e.g.:  inflate_bench data/dmrpp/*.dmrpp
+//
+// The chunks are read from the data file named by the DMR++ file without its
+// '.dmrpp' suffix. Only chunks whose first decoding step is deflate, possibly
+// after removing a Fletcher32 checksum, are used.
+
+#include "config.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#define PUGIXML_NO_XPATH
+#define PUGIXML_HEADER_ONLY
+#include <pugixml.hpp>
+
+#include "BESError.h"
+
+#include "ChunkBufferPool.h"
+#include "inflate_util.h"
+
+using namespace std;
+
+struct deflated_chunk {
+    vector<char> bytes;
+    unsigned long long inflated_size = 0;
+};
+
+// Strip a namespace prefix ('dmrpp:chunks' -> 'chunks').
+static string local_name(const char *name)
+{
+    string n(name);
+    auto pos = n.find(':');
+    return pos == string::npos ? n : n.substr(pos + 1);
+}
+
+static void find_chunks(const pugi::xml_node &node, ifstream &data, vector<deflated_chunk> &chunks)
+{
+    for (auto child = node.first_child(); child; child = child.next_sibling()) {
+        if (local_name(child.name()) != "chunks") {
+            find_chunks(child, data, chunks);
+            continue;
+        }
+
+        // The filters are listed in the order they were applied, so decoding starts at the end.
+        istringstream filters(child.attribute("compressionType").value());
+        vector<string> names{istream_iterator<string>(filters), istream_iterator<string>()};
+        unsigned long long checksum_bytes = 0;
+        if (!names.empty() && names.back() == "fletcher32") {
+            names.pop_back();
+            checksum_bytes = 4;
+        }
+        if (names.empty() || names.back() != "deflate")
+            continue;
+
+        for (auto chunk = child.first_child(); chunk; chunk = chunk.next_sibling()) {
+            if (local_name(chunk.name()) != "chunk" || chunk.attribute("href"))
+                continue;
+            const unsigned long long offset = chunk.attribute("offset").as_ullong();
+            const unsigned long long size = chunk.attribute("nBytes").as_ullong();
+            if (size <= checksum_bytes)
+                continue;
+
+            deflated_chunk dc;
+            dc.bytes.resize(size - checksum_bytes);
+            data.clear();
+            data.seekg(offset);
+            if (!data.read(dc.bytes.data(), dc.bytes.size()))
+                continue;
+            chunks.push_back(move(dc));
+        }
+    }
+}
+
+// Time one engine; return the best rate, in MB/s of inflated data.
+template <typename F>
+static double best_mb_per_sec(const vector<deflated_chunk> &chunks, unsigned long long total, int reps, F engine)
+{
+    double best = 0.0;
+    for (int r = 0; r < reps; ++r) {
+        auto start = chrono::steady_clock::now();
+        for (const auto &c: chunks)
+            engine(c);
+        const double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (secs > 0)
+            best = max(best, double(total) / secs / 1.0e6);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    int reps = 20;
+    int option_char;
+    while ((option_char = getopt(argc, argv, "r:")) != -1) {
+        switch (option_char) {
+            case 'r':
+                reps = atoi(optarg);
+                break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-r repetitions] file.dmrpp ..." << endl;
+                return 1;
+        }
+    }
+
+    vector<deflated_chunk> chunks;
+    for (int i = optind; i < argc; ++i) {
+        const string dmrpp = argv[i];
+        const string suffix = ".dmrpp";
+        if (dmrpp.size() <= suffix.size() || dmrpp.compare(dmrpp.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        ifstream data(dmrpp.substr(0, dmrpp.size() - suffix.size()), ios::binary);
+        pugi::xml_document doc;
+        if (!data || !doc.load_file(dmrpp.c_str()))
+            continue;
+        find_chunks(doc, data, chunks);
+    }
+
+    // Learn the inflated sizes with the zlib code, which grows its buffer as needed.
+    vector<deflated_chunk> usable;
+    unsigned long long compressed = 0;
+    unsigned long long total = 0;
+    for (auto &c: chunks) {
+        try {
+            unsigned long long size = 4 * c.bytes.size();
+            char *dest = dmrpp::ChunkBufferPool::ThePool()->allocate(size);
+            c.inflated_size = dmrpp::inflate_zlib(&dest, size, c.bytes.data(), c.bytes.size());
+            dmrpp::ChunkBufferPool::ThePool()->release(dest);
+            compressed += c.bytes.size();
+            total += c.inflated_size;
+            usable.push_back(move(c));
+        }
+        catch (BESError &e) {
+            // Not a zlib stream (e.g., deflate is not the first step); skip it.
+        }
+    }
+
+    if (usable.empty()) {
+        cerr << "No deflated chunks found." << endl;
+        return 1;
+    }
+
+    cout << "Chunks: " << usable.size() << ", compressed: " << compressed << " bytes, inflated: " << total
+         << " bytes, repetitions: " << reps << endl;
+
+    const double zlib_rate = best_mb_per_sec(usable, total, reps, [](const deflated_chunk &c) {
+        char *dest = dmrpp::ChunkBufferPool::ThePool()->allocate(c.inflated_size);
+        dmrpp::inflate_zlib(&dest, c.inflated_size, c.bytes.data(), c.bytes.size());
+        dmrpp::ChunkBufferPool::ThePool()->release(dest);
+    });
+    cout << left << setw(12) << "zlib" << fixed << setprecision(1) << zlib_rate << " MB/s" << endl;
+
+    if (string(dmrpp::inflate_engine_name()) == "zlib") {
+        cout << left << setw(12) << "libdeflate" << "not configured" << endl;
+        return 0;
+    }
+
+    unsigned long long failures = 0;
+    const double single_shot_rate = best_mb_per_sec(usable, total, reps, [&failures](const deflated_chunk &c) {
+        char *dest = dmrpp::ChunkBufferPool::ThePool()->allocate(c.inflated_size);
+        if (dmrpp::inflate_single_shot(dest, c.inflated_size, c.bytes.data(), c.bytes.size()) != c.inflated_size)
+            ++failures;
+        dmrpp::ChunkBufferPool::ThePool()->release(dest);
+    });
+    cout << left << setw(12) << dmrpp::inflate_engine_name() << fixed << setprecision(1) << single_shot_rate
+         << " MB/s (" << setprecision(2) << single_shot_rate / zlib_rate << "x)" << endl;
+    if (failures > 0)
+        cout << "The single-shot engine could not decode " << failures / reps << " chunks." << endl;
+
+    return 0;
+}
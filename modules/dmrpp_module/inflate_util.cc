@@ -0,0 +1,294 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+#include <zlib.h>
+
+#if HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#include "BESDebug.h"
+#include "BESInternalError.h"
+
+#include "ChunkBufferPool.h"
+#include "inflate_util.h"
+
+using namespace std;
+
+#define prolog std::string("inflate_util::").append(__func__).append("() - ")
+
+#define MODULE "dmrpp:inflate"
+
+namespace dmrpp {
+
+/**
+ * @brief Throws an exception if the information sent to the inflate function is invalid.
+ *
+ * @param destp The destination buffer
+ * @param dest_len The number of bytes to inflate into
+ * @param src The source buffer
+ * @param src_len The number of bytes to inflate
+ */
+static void inflate_sanity_check(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len) {
+    if (src_len == 0) {
+        string msg = prolog + "ERROR! The number of bytes to inflate is zero.";
+        BESDEBUG(MODULE, msg << endl);
+        throw BESInternalError(msg, __FILE__, __LINE__);
+    }
+    if (dest_len == 0) {
+        string msg = prolog + "ERROR! The number of bytes to inflate into is zero.";
+        BESDEBUG(MODULE, msg << endl);
+        throw BESInternalError(msg, __FILE__, __LINE__);
+    }
+    if (!destp || !*destp) {
+        string msg = prolog + "ERROR! The destination buffer is NULL.";
+        BESDEBUG(MODULE, msg << endl);
+        throw BESInternalError(msg, __FILE__, __LINE__);
+    }
+    if (!src) {
+        string msg = prolog + "ERROR! The source buffer is NULL.";
+        BESDEBUG(MODULE, msg << endl);
+        throw BESInternalError(msg, __FILE__, __LINE__);
+    }
+}
+
+/// @return The name of the engine inflate() tries first.
+const char *inflate_engine_name()
+{
+#if HAVE_LIBDEFLATE
+    return "libdeflate";
+#else
+    return "zlib";
+#endif
+}
+
+/**
+ * @brief Decode a zlib stream with one call, without growing the output buffer.
+ *
+ * @param dest The destination buffer
+ * @param dest_len Size of the destination buffer
+ * @param src Compressed data
+ * @param src_len Size of the compressed data
+ * @return The number of bytes of inflated data, or zero if the data could not
+ * be decoded this way (no single-shot engine, the data are bad or the buffer
+ * is too small). In that case the caller should use inflate_zlib().
+ */
+unsigned long long inflate_single_shot(char *dest, unsigned long long dest_len, const char *src,
+                                       unsigned long long src_len)
+{
+#if HAVE_LIBDEFLATE
+    // A decompressor holds about 32k of tables; keep one per thread.
+    thread_local unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)>
+            decompressor(libdeflate_alloc_decompressor(), libdeflate_free_decompressor);
+    if (!decompressor)
+        return 0;
+
+    size_t out_bytes = 0;
+    const auto result = libdeflate_zlib_decompress(decompressor.get(), src, src_len, dest, dest_len, &out_bytes);
+    if (result == LIBDEFLATE_SUCCESS)
+        return out_bytes;
+
+    BESDEBUG(MODULE, prolog << "libdeflate could not decode the data (result: " << result
+                            << "), using zlib." << endl);
+    return 0;
+#else
+    (void) dest;
+    (void) dest_len;
+    (void) src;
+    (void) src_len;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Deflate data using the zlib streaming interface.
+ *
+ * @note Stolen from the HDF5 library and hacked to fit.
+ *
+ * The first call to zlib asks for the whole stream (Z_FINISH), which lets zlib
+ * skip maintaining its window when the output fits. If it does not fit, the
+ * buffer is doubled until it does.
+ *
+ * @param destp A value-result parameter (pointer to a pointer) of the 'inflated' data
+ * @param dest_len Size of the destination buffer
+ * @param src Compressed data
+ * @param src_len Size of the compressed data
+ * @return The number of bytes of the inflated data
+ */
+unsigned long long inflate_zlib(char **destp, unsigned long long dest_len, const char *src, unsigned long long src_len)
+{
+    inflate_sanity_check(destp, dest_len, src, src_len);
+
+    /* Input; uncompress */
+    z_stream z_strm; /* zlib parameters */
+
+    /* Set the decompression parameters */
+    memset(&z_strm, 0, sizeof(z_strm));
+    z_strm.next_in = (Bytef *) src;
+    z_strm.avail_in = src_len;
+    z_strm.next_out = (Bytef *) (*destp);
+    z_strm.avail_out = dest_len;
+
+    size_t nalloc = dest_len;
+
+    char *outbuf = *destp;
+
+    /* Initialize the decompression routines */
+    if (Z_OK != inflateInit(&z_strm))
+        throw BESInternalError("Failed to initialize inflate software.", __FILE__, __LINE__);
+
+    /* Loop to uncompress the buffer */
+    int flush = Z_FINISH;
+    int status = Z_OK;
+    do {
+        /* Uncompress some data */
+        status = ::inflate(&z_strm, flush);
+
+        /* Check if we are done decompressing data */
+        if (Z_STREAM_END == status) break; /*done*/
+
+        /* Check for error. With Z_FINISH, Z_BUF_ERROR means the output buffer is full. */
+        if (Z_OK != status && !(Z_BUF_ERROR == status && 0 == z_strm.avail_out)) {
+            stringstream err_msg;
+            err_msg << "Failed to inflate data chunk.";
+            char const *err_msg_cstr = z_strm.msg;
+            if(err_msg_cstr)
+                err_msg << " zlib message: " << err_msg_cstr;
+            (void) inflateEnd(&z_strm);
+            throw BESInternalError(err_msg.str(), __FILE__, __LINE__);
+        }
+        else {
+            // If we're not done and just ran out of buffer space, we need to extend the buffer.
+            // We may encounter this case when the deflate filter is used twice. KY 2022-08-03
+            if (0 == z_strm.avail_out) {
+
+                /* Allocate a buffer twice as big */
+                size_t outbuf_size = nalloc;
+                nalloc *= 2;
+                char *new_outbuf = ChunkBufferPool::ThePool()->allocate(nalloc);
+                memcpy((void*)new_outbuf,(void*)outbuf,outbuf_size);
+                ChunkBufferPool::ThePool()->release(outbuf);
+                outbuf = new_outbuf;
+                *destp = outbuf;
+
+                /* Update pointers to buffer for next set of uncompressed data */
+                z_strm.next_out = (unsigned char*) outbuf + z_strm.total_out;
+                z_strm.avail_out = (uInt) (nalloc - z_strm.total_out);
+
+                // Once the buffer has been outgrown, decode in pieces.
+                flush = Z_SYNC_FLUSH;
+            } /* end if */
+        } /* end else */
+    } while (true /* status == Z_OK */);    // Exit via the break statement after the call to inflate(). jhrg 11/8/21
+
+    *destp = outbuf;
+    outbuf = nullptr;
+    /* Finish decompressing the stream */
+    (void) inflateEnd(&z_strm);
+
+    return z_strm.total_out;
+}
+
+/**
+ * @brief Inflate data into a buffer that belongs to someone else.
+ *
+ * Unlike inflate(), the destination is never replaced or released, so it may
+ * point into memory not made by the ChunkBufferPool (e.g., an Array's value
+ * buffer). If the inflated data do not fit in dest_len bytes, the bytes in
+ * dest are undefined and zero is returned.
+ *
+ * @param dest The destination buffer
+ * @param dest_len Size of the destination buffer
+ * @param src Compressed data
+ * @param src_len Size of the compressed data
+ * @return The number of bytes of the inflated data, or zero if they did not fit
+ * @exception BESInternalError if the data cannot be inflated
+ */
+unsigned long long inflate_into(char *dest, unsigned long long dest_len, const char *src, unsigned long long src_len)
+{
+    inflate_sanity_check(&dest, dest_len, src, src_len);
+
+    const unsigned long long out_bytes = inflate_single_shot(dest, dest_len, src, src_len);
+    if (out_bytes > 0)
+        return out_bytes;
+
+    z_stream z_strm;
+    memset(&z_strm, 0, sizeof(z_strm));
+    z_strm.next_in = (Bytef *) src;
+    z_strm.avail_in = src_len;
+    z_strm.next_out = (Bytef *) dest;
+    z_strm.avail_out = dest_len;
+
+    if (Z_OK != inflateInit(&z_strm))
+        throw BESInternalError("Failed to initialize inflate software.", __FILE__, __LINE__);
+
+    const int status = ::inflate(&z_strm, Z_FINISH);
+    if (Z_STREAM_END == status) {
+        (void) inflateEnd(&z_strm);
+        return z_strm.total_out;
+    }
+
+    // With Z_FINISH, Z_BUF_ERROR means the output buffer is full.
+    if ((Z_OK == status || Z_BUF_ERROR == status) && 0 == z_strm.avail_out) {
+        (void) inflateEnd(&z_strm);
+        BESDEBUG(MODULE, prolog << "The inflated data are larger than " << dest_len << " bytes." << endl);
+        return 0;
+    }
+
+    stringstream err_msg;
+    err_msg << "Failed to inflate data chunk.";
+    if (z_strm.msg)
+        err_msg << " zlib message: " << z_strm.msg;
+    (void) inflateEnd(&z_strm);
+    throw BESInternalError(err_msg.str(), __FILE__, __LINE__);
+}
+
+/**
+ * @brief Deflate data. This is the zlib algorithm.
+ *
+ * Try the single-shot engine first and fall back to the zlib streaming code.
+ *
+ * @param destp A value-result parameter (pointer to a pointer) of the 'inflated' data
+ * @param dest_len Size of the destination buffer
+ * @param src Compressed data
+ * @param src_len Size of the compressed data
+ * @return The number of bytes of the inflated data
+ */
+unsigned long long inflate(char **destp, unsigned long long dest_len, char *src, unsigned long long src_len)
+{
+    inflate_sanity_check(destp, dest_len, src, src_len);
+
+    const unsigned long long out_bytes = inflate_single_shot(*destp, dest_len, src, src_len);
+    if (out_bytes > 0)
+        return out_bytes;
+
+    return inflate_zlib(destp, dest_len, src, src_len);
+}
+
+} // namespace dmrpp
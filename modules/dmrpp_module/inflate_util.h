@@ -0,0 +1,59 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dmrpp_inflate_util_h
+#define _dmrpp_inflate_util_h 1
+
+namespace dmrpp {
+
+/**
+ * The inflate (zlib/deflate filter) code used by the DMR++ handler.
+ *
+ * inflate() first tries to decode the whole chunk with one call to the engine
+ * chosen by configure (libdeflate, when it is found). That needs the output
+ * buffer to be big enough, which is almost always true since the size of a
+ * chunk is known from the DMR++. If the engine is not present or cannot decode
+ * the data in the space given, the zlib streaming code, which grows the
+ * buffer as needed, is used.
+ *
+ * All of these functions use the same buffer convention: *destp points to a
+ * buffer of dest_len bytes allocated by the ChunkBufferPool; if that is too
+ * small it is replaced with a larger buffer and the original is released.
+ * The exceptions are inflate_single_shot() and inflate_into(), which write
+ * into a buffer of fixed size and report failure instead of growing it.
+ */
+
+unsigned long long inflate(char **destp, unsigned long long dest_len, char *src, unsigned long long src_len);
+
+unsigned long long inflate_zlib(char **destp, unsigned long long dest_len, const char *src,
+                                unsigned long long src_len);
+unsigned long long inflate_single_shot(char *dest, unsigned long long dest_len, const char *src,
+                                       unsigned long long src_len);
+unsigned long long inflate_into(char *dest, unsigned long long dest_len, const char *src,
+                                unsigned long long src_len);
+
+const char *inflate_engine_name();
+
+} // namespace dmrpp
+
+#endif // _dmrpp_inflate_util_h
@@ -0,0 +1,170 @@
+// This file is part of bes, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "byte_kernels.h"
+#include "float_byteswap.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+using namespace bes;
+
+#define prolog std::string("ByteKernelsTest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+// Defined in Chunk.cc.
+void unshuffle(char *dest, const char *src, unsigned long long src_size, unsigned long long width);
+
+class ByteKernelsTest: public CppUnit::TestFixture {
+private:
+    // Sizes chosen to exercise the vector loops and every kind of remainder.
+    const vector<uint64_t> d_sizes{0, 1, 7, 16, 31, 64, 100, 257, 1023, 4099, 100003};
+    const vector<uint64_t> d_widths{1, 2, 3, 4, 5, 8, 12};
+
+    static vector<char> random_bytes(uint64_t size) {
+        vector<char> bytes(size);
+        uint32_t x = 2463534242u;
+        for (auto &b: bytes) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            b = static_cast<char>(x);
+        }
+        return bytes;
+    }
+
+    // The HDF5 library's algorithm.
+    static vector<char> reference_unshuffle(const vector<char> &src, uint64_t width) {
+        const uint64_t elems = src.size() / width;
+        vector<char> dest(src);
+        if (width > 1 && elems > 1) {
+            for (uint64_t j = 0; j < width; ++j)
+                for (uint64_t i = 0; i < elems; ++i)
+                    dest[i * width + j] = src[j * elems + i];
+        }
+        return dest;
+    }
+
+    static vector<char> reference_byteswap(const vector<char> &src, uint64_t num, uint64_t width) {
+        vector<char> dest(src);
+        for (uint64_t i = 0; i < num; ++i)
+            for (uint64_t j = 0; j < width / 2; ++j)
+                swap(dest[i * width + j], dest[i * width + width - 1 - j]);
+        return dest;
+    }
+
+public:
+    // Called once before everything gets tested
+    ByteKernelsTest() = default;
+
+    // Called at the end of the test
+    ~ByteKernelsTest() override = default;
+
+    void best_isa_test() {
+        DBG(cerr << prolog << "Best ISA: " << kernel_isa_name(best_kernel_isa()) << endl);
+        CPPUNIT_ASSERT(best_kernel_isa() >= kernel_scalar && best_kernel_isa() <= kernel_avx2);
+    }
+
+    void unshuffle_test() {
+        for (int isa = kernel_scalar; isa <= best_kernel_isa(); ++isa) {
+            for (auto width: d_widths) {
+                for (auto size: d_sizes) {
+                    const auto src = random_bytes(size);
+                    vector<char> dest(size);
+                    unshuffle_bytes(dest.data(), src.data(), size, width, static_cast<kernel_isa>(isa));
+                    CPPUNIT_ASSERT_MESSAGE(string("unshuffle with ") + kernel_isa_name(static_cast<kernel_isa>(isa))
+                                           + ", width " + to_string(width) + ", size " + to_string(size),
+                                           dest == reference_unshuffle(src, width));
+                }
+            }
+        }
+    }
+
+    // Chunk.cc's unshuffle() uses the kernel.
+    void chunk_unshuffle_test() {
+        const auto src = random_bytes(1020);    // 127 doubles with 4 extra bytes
+        vector<char> dest(src.size());
+        unshuffle(dest.data(), src.data(), src.size(), 8);
+        CPPUNIT_ASSERT(dest == reference_unshuffle(src, 8));
+    }
+
+    void byteswap_test() {
+        for (int isa = kernel_scalar; isa <= best_kernel_isa(); ++isa) {
+            for (auto width: d_widths) {
+                for (auto size: d_sizes) {
+                    auto buf = random_bytes(size);
+                    const uint64_t num = size / width;
+                    const auto expected = reference_byteswap(buf, num, width);
+                    byteswap_array(buf.data(), num, width, static_cast<kernel_isa>(isa));
+                    CPPUNIT_ASSERT_MESSAGE(string("byteswap with ") + kernel_isa_name(static_cast<kernel_isa>(isa))
+                                           + ", width " + to_string(width) + ", size " + to_string(size),
+                                           buf == expected);
+                }
+            }
+        }
+    }
+
+    void swap_float_test() {
+        vector<float> f{1.5f, -2.25f, 3.0e10f, 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f};
+        auto swapped = f;
+        swap_float32(reinterpret_cast<char *>(swapped.data()), swapped.size());
+        for (size_t i = 0; i < f.size(); ++i) {
+            unsigned char a[4], b[4];
+            memcpy(a, &f[i], 4);
+            memcpy(b, &swapped[i], 4);
+            CPPUNIT_ASSERT(a[0] == b[3] && a[1] == b[2] && a[2] == b[1] && a[3] == b[0]);
+        }
+        swap_float32(reinterpret_cast<char *>(swapped.data()), swapped.size());
+        CPPUNIT_ASSERT(swapped == f);
+
+        vector<double> d{1.5, -2.25, 3.0e100, 0.0, 7.0};
+        auto swapped_d = d;
+        swap_float64(reinterpret_cast<char *>(swapped_d.data()), swapped_d.size());
+        swap_float64(reinterpret_cast<char *>(swapped_d.data()), swapped_d.size());
+        CPPUNIT_ASSERT(swapped_d == d);
+    }
+
+    CPPUNIT_TEST_SUITE( ByteKernelsTest );
+
+    CPPUNIT_TEST(best_isa_test);
+    CPPUNIT_TEST(unshuffle_test);
+    CPPUNIT_TEST(chunk_unshuffle_test);
+    CPPUNIT_TEST(byteswap_test);
+    CPPUNIT_TEST(swap_float_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ByteKernelsTest);
+
+} // namespace dmrpp
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<dmrpp::ByteKernelsTest>(argc, argv, "cerr") ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+// This file is part of bes, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BESInternalError.h"
+
+#include "ChunkBufferPool.h"
+#include "Chunk.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+#define prolog std::string("ChunkBufferPoolTest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+class ChunkBufferPoolTest: public CppUnit::TestFixture {
+public:
+    // Called once before everything gets tested
+    ChunkBufferPoolTest() = default;
+
+    // Called at the end of the test
+    ~ChunkBufferPoolTest() override = default;
+
+    void size_class_test() {
+        ChunkBufferPool pool(1024 * 1024);
+        CPPUNIT_ASSERT_EQUAL(ChunkBufferPool::MIN_CLASS_SIZE, pool.d_class_sizes[pool.size_class(1)]);
+        CPPUNIT_ASSERT_EQUAL(4096ULL, pool.d_class_sizes[pool.size_class(4096)]);
+        CPPUNIT_ASSERT_EQUAL(5120ULL, pool.d_class_sizes[pool.size_class(4097)]);
+        CPPUNIT_ASSERT_EQUAL(28672ULL, pool.d_class_sizes[pool.size_class(24577)]);
+        CPPUNIT_ASSERT_EQUAL(32768ULL, pool.d_class_sizes[pool.size_class(28673)]);
+        CPPUNIT_ASSERT_EQUAL(ChunkBufferPool::MAX_CLASS_SIZE,
+                             pool.d_class_sizes[pool.size_class(ChunkBufferPool::MAX_CLASS_SIZE)]);
+        CPPUNIT_ASSERT_EQUAL(-1, pool.size_class(ChunkBufferPool::MAX_CLASS_SIZE + 1));
+
+        // No class wastes more than a quarter of the buffer.
+        for (unsigned long long size = 1000; size < ChunkBufferPool::MAX_CLASS_SIZE; size = size * 3 / 2) {
+            const auto capacity = pool.d_class_sizes[pool.size_class(size)];
+            CPPUNIT_ASSERT(capacity >= size);
+            CPPUNIT_ASSERT(size < ChunkBufferPool::MIN_CLASS_SIZE || capacity - size <= capacity / 4);
+        }
+    }
+
+    void reuse_test() {
+        ChunkBufferPool pool(1024 * 1024);
+        char *a = pool.allocate(10000);
+        CPPUNIT_ASSERT(ChunkBufferPool::capacity(a) >= 10000);
+        memset(a, 'a', 10000);
+        pool.release(a);
+
+        // Same class, so the same buffer.
+        char *b = pool.allocate(9000);
+        CPPUNIT_ASSERT(a == b);
+
+        auto s = pool.stats();
+        CPPUNIT_ASSERT_EQUAL(2ULL, s.allocations);
+        CPPUNIT_ASSERT_EQUAL(1ULL, s.hits);
+        CPPUNIT_ASSERT_EQUAL(1ULL, s.misses);
+        CPPUNIT_ASSERT_EQUAL(1ULL, s.releases);
+        CPPUNIT_ASSERT_EQUAL(ChunkBufferPool::capacity(b), s.bytes_in_use);
+        CPPUNIT_ASSERT_EQUAL(0ULL, s.bytes_cached);
+        CPPUNIT_ASSERT(s.hit_rate() == 0.5);
+
+        pool.release(b);
+        CPPUNIT_ASSERT_EQUAL(0ULL, pool.stats().bytes_in_use);
+        CPPUNIT_ASSERT_EQUAL(ChunkBufferPool::capacity(b), pool.stats().bytes_cached);
+    }
+
+    void peak_test() {
+        ChunkBufferPool pool(1024 * 1024);
+        vector<char *> bufs;
+        for (int i = 0; i < 10; ++i)
+            bufs.push_back(pool.allocate(4096));
+        for (auto buf: bufs)
+            pool.release(buf);
+
+        auto s = pool.stats();
+        CPPUNIT_ASSERT_EQUAL(10 * 4096ULL, s.peak_bytes_in_use);
+        CPPUNIT_ASSERT_EQUAL(0ULL, s.bytes_in_use);
+        CPPUNIT_ASSERT_EQUAL(10 * 4096ULL, s.bytes_cached);
+
+        pool.trim();
+        CPPUNIT_ASSERT_EQUAL(0ULL, pool.stats().bytes_cached);
+    }
+
+    // Released buffers beyond max_cached_bytes are freed.
+    void max_cached_bytes_test() {
+        ChunkBufferPool pool(3 * 4096);
+        vector<char *> bufs;
+        for (int i = 0; i < 5; ++i)
+            bufs.push_back(pool.allocate(4096));
+        for (auto buf: bufs)
+            pool.release(buf);
+
+        auto s = pool.stats();
+        CPPUNIT_ASSERT_EQUAL(3 * 4096ULL, s.bytes_cached);
+        CPPUNIT_ASSERT_EQUAL(2ULL, s.discards);
+    }
+
+    void no_caching_test() {
+        ChunkBufferPool pool(0);
+        char *a = pool.allocate(4096);
+        pool.release(a);
+        CPPUNIT_ASSERT_EQUAL(1ULL, pool.stats().discards);
+        CPPUNIT_ASSERT_EQUAL(0ULL, pool.stats().bytes_cached);
+    }
+
+    void unpooled_test() {
+        ChunkBufferPool pool(1024 * 1024 * 1024ULL);
+        const auto size = ChunkBufferPool::MAX_CLASS_SIZE + 10;
+        char *a = pool.allocate(size);
+        CPPUNIT_ASSERT_EQUAL(size, ChunkBufferPool::capacity(a));
+        a[size - 1] = 'x';
+        pool.release(a);
+
+        auto s = pool.stats();
+        CPPUNIT_ASSERT_EQUAL(1ULL, s.unpooled);
+        CPPUNIT_ASSERT_EQUAL(1ULL, s.discards);
+        CPPUNIT_ASSERT_EQUAL(0ULL, s.bytes_cached);
+    }
+
+    void release_null_test() {
+        ChunkBufferPool pool(1024);
+        pool.release(nullptr);
+        CPPUNIT_ASSERT_EQUAL(0ULL, pool.stats().releases);
+    }
+
+    void release_foreign_buffer_test() {
+        ChunkBufferPool pool(1024);
+        vector<char> not_pooled(64, 0);
+        // release() is called from destructors, so it logs and leaks the buffer instead of throwing.
+        CPPUNIT_ASSERT_NO_THROW(pool.release(not_pooled.data() + 32));
+        CPPUNIT_ASSERT_EQUAL(0ULL, pool.stats().releases);
+        CPPUNIT_ASSERT_THROW(ChunkBufferPool::capacity(not_pooled.data() + 32), BESInternalError);
+    }
+
+    // A besd child gets a new pool; freeing the parent's buffers must not change its counters.
+    void fork_test() {
+        char *buf = ChunkBufferPool::ThePool()->allocate(4096);
+
+        pid_t pid = fork();
+        CPPUNIT_ASSERT(pid >= 0);
+        if (pid == 0) {
+            auto child_pool = ChunkBufferPool::ThePool();
+            child_pool->release(buf);
+            const auto s = child_pool->stats();
+            _exit(s.bytes_in_use == 0 && s.bytes_cached == 0 && s.releases == 1 ? 0 : 1);
+        }
+
+        int status = 0;
+        CPPUNIT_ASSERT(waitpid(pid, &status, 0) == pid);
+        CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        ChunkBufferPool::ThePool()->release(buf);
+    }
+
+    void threads_test() {
+        ChunkBufferPool pool(64 * 1024 * 1024);
+        vector<thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&pool, t]() {
+                for (int i = 0; i < 1000; ++i) {
+                    const unsigned long long size = 1000 + (i * 7919 + t * 104729) % 200000;
+                    char *buf = pool.allocate(size);
+                    buf[0] = buf[size - 1] = static_cast<char>(t);
+                    pool.release(buf);
+                }
+            });
+        }
+        for (auto &t: threads)
+            t.join();
+
+        auto s = pool.stats();
+        DBG(pool.dump(cerr));
+        CPPUNIT_ASSERT_EQUAL(8000ULL, s.allocations);
+        CPPUNIT_ASSERT_EQUAL(8000ULL, s.releases);
+        CPPUNIT_ASSERT_EQUAL(s.allocations, s.hits + s.misses);
+        CPPUNIT_ASSERT_EQUAL(0ULL, s.bytes_in_use);
+        CPPUNIT_ASSERT(s.hits > 0);
+    }
+
+    // Chunk read buffers come from the process-wide pool.
+    void chunk_buffer_test() {
+        auto pool = ChunkBufferPool::ThePool();
+        CPPUNIT_ASSERT(pool == ChunkBufferPool::ThePool());
+
+        const auto before = pool->stats();
+        {
+            Chunk chunk("LE", 4096, 0);
+            chunk.set_rbuf_to_size();
+            CPPUNIT_ASSERT(ChunkBufferPool::capacity(chunk.get_rbuf()) >= 4096);
+        }
+        const auto after = pool->stats();
+        CPPUNIT_ASSERT_EQUAL(before.allocations + 1, after.allocations);
+        CPPUNIT_ASSERT_EQUAL(before.releases + 1, after.releases);
+        CPPUNIT_ASSERT_EQUAL(before.bytes_in_use, after.bytes_in_use);
+    }
+
+    CPPUNIT_TEST_SUITE( ChunkBufferPoolTest );
+
+    CPPUNIT_TEST(size_class_test);
+    CPPUNIT_TEST(reuse_test);
+    CPPUNIT_TEST(peak_test);
+    CPPUNIT_TEST(max_cached_bytes_test);
+    CPPUNIT_TEST(no_caching_test);
+    CPPUNIT_TEST(unpooled_test);
+    CPPUNIT_TEST(release_null_test);
+    CPPUNIT_TEST(release_foreign_buffer_test);
+    CPPUNIT_TEST(fork_test);
+    CPPUNIT_TEST(threads_test);
+    CPPUNIT_TEST(chunk_buffer_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ChunkBufferPoolTest);
+
+} // namespace dmrpp
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<dmrpp::ChunkBufferPoolTest>(argc, argv, "cerr,dmrpp:buffer_pool") ? 0 : 1;
+}
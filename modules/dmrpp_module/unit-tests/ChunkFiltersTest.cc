@@ -0,0 +1,458 @@
+// This file is part of bes, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#if HAVE_LIBBLOSC
+#include <blosc.h>
+#endif
+#if HAVE_LIBSZ
+// Some versions of szlib.h lack the extern "C" guard.
+extern "C" {
+#include <szlib.h>
+}
+#endif
+#if HAVE_LIBLZ4
+#include <lz4.h>
+#endif
+
+#include "BESInternalError.h"
+
+#include "Chunk.h"
+#include "ChunkFilters.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+#define prolog std::string("ChunkFiltersTest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+// Number of times each decoder is run when measuring its throughput.
+const int DECODE_REPS = 10;
+
+class ChunkFiltersTest: public CppUnit::TestFixture {
+private:
+    // Smooth values, like most science data, so the compressors have something to work with.
+    vector<float> d_values;
+
+    static vector<char> as_bytes(const vector<float> &values) {
+        vector<char> bytes(values.size() * sizeof(float));
+        memcpy(bytes.data(), values.data(), bytes.size());
+        return bytes;
+    }
+
+    // The bitshuffle transform for one block; the inverse of bitunshuffle_block().
+    static void bitshuffle_block(char *dest, const char *src, size_t elems, size_t elem_size) {
+        const size_t row_bytes = elems / 8;
+        memset(dest, 0, elems * elem_size);
+        for (size_t i = 0; i < elems; ++i) {
+            for (size_t j = 0; j < elem_size; ++j) {
+                const auto byte = static_cast<unsigned char>(src[i * elem_size + j]);
+                for (unsigned int b = 0; b < 8; ++b) {
+                    if (byte & (1u << b))
+                        dest[(j * 8 + b) * row_bytes + i / 8] |= static_cast<char>(1u << (i % 8));
+                }
+            }
+        }
+    }
+
+    // Bitshuffle without compression, as written by the HDF5 filter.
+    static vector<char> bitshuffle(const vector<char> &src, size_t elem_size, size_t block_size) {
+        const size_t elems = src.size() / elem_size;
+        vector<char> dest(src.size());
+        size_t pos = 0;
+        for (; pos + block_size <= elems; pos += block_size)
+            bitshuffle_block(&dest[pos * elem_size], &src[pos * elem_size], block_size, elem_size);
+        size_t last = (elems - pos) - (elems - pos) % 8;
+        if (last) {
+            bitshuffle_block(&dest[pos * elem_size], &src[pos * elem_size], last, elem_size);
+            pos += last;
+        }
+        memcpy(&dest[pos * elem_size], &src[pos * elem_size], (elems - pos) * elem_size);
+        return dest;
+    }
+
+    static double mb_per_sec(unsigned long long bytes, chrono::steady_clock::duration elapsed) {
+        const double secs = chrono::duration<double>(elapsed).count();
+        return secs > 0 ? (double(bytes) * DECODE_REPS / (1024.0 * 1024.0)) / secs : 0.0;
+    }
+
+    /**
+     * Decode \arg encoded DECODE_REPS times, check the result matches \arg expected
+     * and report the throughput (measured against the decoded size).
+     */
+    static void check_decoder(const string &name, const filter_decoder &decode, const vector<char> &encoded,
+                              const vector<char> &expected, unsigned long long elem_width,
+                              const vector<unsigned int> &params) {
+        unsigned long long decoded_size = 0;
+        char *dest = ChunkBufferPool::ThePool()->allocate(expected.size());
+        try {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < DECODE_REPS; ++i)
+                decoded_size = decode(&dest, expected.size(), encoded.data(), encoded.size(), elem_width, params);
+            auto elapsed = chrono::steady_clock::now() - start;
+
+            DBG(cerr << prolog << name << ": " << encoded.size() << " -> " << decoded_size << " bytes, "
+                     << mb_per_sec(decoded_size, elapsed) << " MB/s" << endl);
+
+            CPPUNIT_ASSERT_MESSAGE(name + " decoded size", decoded_size == expected.size());
+            CPPUNIT_ASSERT_MESSAGE(name + " decoded values", memcmp(dest, expected.data(), expected.size()) == 0);
+        }
+        catch (...) {
+            ChunkBufferPool::ThePool()->release(dest);
+            throw;
+        }
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+
+public:
+    // Called once before everything gets tested
+    ChunkFiltersTest() = default;
+
+    // Called at the end of the test
+    ~ChunkFiltersTest() override = default;
+
+    // Called before each test
+    void setUp() override {
+        d_values.resize(1000003);   // Not a multiple of 8, so the bitshuffle leftovers are tested.
+        for (size_t i = 0; i < d_values.size(); ++i)
+            d_values[i] = 273.15f + 20.0f * sinf(float(i) / 1000.0f);
+    }
+
+    void parse_filter_spec_test() {
+        auto spec = parse_filter_spec("deflate");
+        CPPUNIT_ASSERT(spec.name == "deflate");
+        CPPUNIT_ASSERT(spec.params.empty());
+
+        spec = parse_filter_spec("szip(141,32,32,256)");
+        CPPUNIT_ASSERT(spec.name == "szip");
+        CPPUNIT_ASSERT(spec.params == vector<unsigned int>({141, 32, 32, 256}));
+
+        spec = parse_filter_spec("bitshuffle()");
+        CPPUNIT_ASSERT(spec.name == "bitshuffle");
+        CPPUNIT_ASSERT(spec.params.empty());
+
+        CPPUNIT_ASSERT_THROW(parse_filter_spec("szip(141,32"), BESInternalError);
+        CPPUNIT_ASSERT_THROW(parse_filter_spec("szip(141,x)"), BESInternalError);
+        CPPUNIT_ASSERT_THROW(parse_filter_spec("szip(1)2"), BESInternalError);
+    }
+
+    void make_filter_spec_test() {
+        CPPUNIT_ASSERT(make_filter_spec("zstd", {}) == "zstd");
+        CPPUNIT_ASSERT(make_filter_spec("szip", {141, 32, 32, 256}) == "szip(141,32,32,256)");
+
+        auto spec = parse_filter_spec(make_filter_spec("bitshuffle", {0, 3, 4, 0, 2}));
+        CPPUNIT_ASSERT(spec.name == "bitshuffle");
+        CPPUNIT_ASSERT(spec.params == vector<unsigned int>({0, 3, 4, 0, 2}));
+    }
+
+    void filters_support_direct_io_test() {
+        CPPUNIT_ASSERT(filters_support_direct_io(""));
+        CPPUNIT_ASSERT(filters_support_direct_io("deflate"));
+        CPPUNIT_ASSERT(filters_support_direct_io("shuffle deflate fletcher32"));
+        CPPUNIT_ASSERT(!filters_support_direct_io("shuffle zstd"));
+        CPPUNIT_ASSERT(!filters_support_direct_io("szip(141,32,32,256)"));
+        CPPUNIT_ASSERT(!filters_support_direct_io("bitshuffle(0,3,4,0,2) deflate"));
+    }
+
+    void has_filter_test() {
+        CPPUNIT_ASSERT(has_filter("shuffle deflate", "shuffle"));
+        CPPUNIT_ASSERT(has_filter("shuffle deflate", "deflate"));
+        CPPUNIT_ASSERT(!has_filter("bitshuffle(0,3,4,0,2) deflate", "shuffle"));
+        CPPUNIT_ASSERT(has_filter("bitshuffle(0,3,4,0,2) deflate", "bitshuffle"));
+        CPPUNIT_ASSERT(has_filter("szip(141,32,32,256)", "szip"));
+        CPPUNIT_ASSERT(!has_filter("", "deflate"));
+    }
+
+    void registry_test() {
+        auto filters = ChunkFilters::TheFilters();
+        CPPUNIT_ASSERT(filters == ChunkFilters::TheFilters());
+        CPPUNIT_ASSERT(filters->find_decoder("bitshuffle"));
+        CPPUNIT_ASSERT(!filters->find_decoder("no_such_filter"));
+#if HAVE_LIBZSTD
+        CPPUNIT_ASSERT(filters->find_decoder("zstd"));
+#endif
+#if HAVE_LIBBLOSC
+        CPPUNIT_ASSERT(filters->find_decoder("blosc"));
+#endif
+#if HAVE_LIBSZ
+        CPPUNIT_ASSERT(filters->find_decoder("szip"));
+#endif
+        for (const auto &name: filters->decoder_names())
+            DBG(cerr << prolog << "decoder: " << name << endl);
+    }
+
+    void bitunshuffle_block_test() {
+        // Eight two-byte elements; element i has the value i in its first byte.
+        vector<char> src(16);
+        for (size_t i = 0; i < 8; ++i)
+            src[i * 2] = static_cast<char>(i);
+        vector<char> shuffled(16);
+        bitshuffle_block(shuffled.data(), src.data(), 8, 2);
+
+        // Bit zero of elements 1, 3, 5 and 7 is set: 0b10101010.
+        CPPUNIT_ASSERT(static_cast<unsigned char>(shuffled[0]) == 0xaa);
+
+        vector<char> result(16);
+        bitunshuffle_block(result.data(), shuffled.data(), 8, 2);
+        CPPUNIT_ASSERT(result == src);
+    }
+
+    void bitshuffle_test() {
+        const auto bytes = as_bytes(d_values);
+        // Use the element size from the parameters and the default block size (2048 for four-byte values).
+        check_decoder("bitshuffle", bitshuffle_decode, bitshuffle(bytes, sizeof(float), 2048), bytes, 1,
+                      {0, 3, sizeof(float), 0, 0});
+        // No parameters; the element size is the variable's.
+        check_decoder("bitshuffle (no params)", bitshuffle_decode, bitshuffle(bytes, sizeof(float), 2048), bytes,
+                      sizeof(float), {});
+        check_decoder("bitshuffle (block size 64)", bitshuffle_decode, bitshuffle(bytes, sizeof(float), 64), bytes,
+                      sizeof(float), {0, 3, sizeof(float), 64, 0});
+    }
+
+    void bitshuffle_truncated_test() {
+        const auto bytes = as_bytes(d_values);
+        auto shuffled = bitshuffle(bytes, sizeof(float), 2048);
+        shuffled.resize(shuffled.size() - 3);   // No longer a whole number of elements
+        char *dest = ChunkBufferPool::ThePool()->allocate(bytes.size());
+        CPPUNIT_ASSERT_THROW(bitshuffle_decode(&dest, bytes.size(), shuffled.data(), shuffled.size(), sizeof(float), {}),
+                             BESInternalError);
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+
+#if HAVE_LIBLZ4
+    void bitshuffle_lz4_test() {
+        const auto bytes = as_bytes(d_values);
+        const size_t elem_size = sizeof(float);
+        const size_t block_size = 2048;
+        const size_t elems = d_values.size();
+
+        // The header: decoded size (8 bytes, big-endian), then the block size in bytes (4 bytes, big-endian).
+        vector<char> encoded(12);
+        const uint64_t nbytes = bytes.size();
+        const uint32_t block_bytes = block_size * elem_size;
+        for (int i = 0; i < 8; ++i)
+            encoded[i] = static_cast<char>(nbytes >> (56 - 8 * i));
+        for (int i = 0; i < 4; ++i)
+            encoded[8 + i] = static_cast<char>(block_bytes >> (24 - 8 * i));
+
+        auto add_block = [&](size_t pos, size_t n) {
+            vector<char> shuffled(n * elem_size);
+            bitshuffle_block(shuffled.data(), &bytes[pos * elem_size], n, elem_size);
+            vector<char> compressed(LZ4_compressBound(shuffled.size()));
+            const uint32_t csize = LZ4_compress_default(shuffled.data(), compressed.data(), shuffled.size(),
+                                                        compressed.size());
+            for (int i = 0; i < 4; ++i)
+                encoded.push_back(static_cast<char>(csize >> (24 - 8 * i)));
+            encoded.insert(encoded.end(), compressed.begin(), compressed.begin() + csize);
+        };
+
+        size_t pos = 0;
+        for (; pos + block_size <= elems; pos += block_size)
+            add_block(pos, block_size);
+        const size_t last = (elems - pos) - (elems - pos) % 8;
+        if (last) {
+            add_block(pos, last);
+            pos += last;
+        }
+        encoded.insert(encoded.end(), bytes.begin() + pos * elem_size, bytes.end());
+
+        check_decoder("bitshuffle/lz4", bitshuffle_decode, encoded, bytes, elem_size, {0, 3, sizeof(float), 0, 2});
+    }
+#endif
+
+#if HAVE_LIBZSTD
+    void zstd_test() {
+        const auto bytes = as_bytes(d_values);
+        vector<char> encoded(ZSTD_compressBound(bytes.size()));
+        const size_t csize = ZSTD_compress(encoded.data(), encoded.size(), bytes.data(), bytes.size(), 3);
+        CPPUNIT_ASSERT(!ZSTD_isError(csize));
+        encoded.resize(csize);
+
+        check_decoder("zstd", zstd_decode, encoded, bytes, sizeof(float), {});
+    }
+
+    // A frame written by the streaming API does not record its decoded size.
+    void zstd_unknown_size_test() {
+        const auto bytes = as_bytes(d_values);
+        unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+        vector<char> encoded(ZSTD_compressBound(bytes.size()));
+        ZSTD_inBuffer in{bytes.data(), bytes.size(), 0};
+        ZSTD_outBuffer out{encoded.data(), encoded.size(), 0};
+        ZSTD_compressStream(cctx.get(), &out, &in);
+        ZSTD_endStream(cctx.get(), &out);
+        encoded.resize(out.pos);
+        CPPUNIT_ASSERT(ZSTD_getFrameContentSize(encoded.data(), encoded.size()) == ZSTD_CONTENTSIZE_UNKNOWN);
+
+        // Start with a buffer that's too small; the decoder has to grow it.
+        char *dest = ChunkBufferPool::ThePool()->allocate(1024);
+        unsigned long long decoded_size = 0;
+        try {
+            decoded_size = zstd_decode(&dest, 1024, encoded.data(), encoded.size(), sizeof(float), {});
+            CPPUNIT_ASSERT(decoded_size == bytes.size());
+            CPPUNIT_ASSERT(memcmp(dest, bytes.data(), bytes.size()) == 0);
+        }
+        catch (...) {
+            ChunkBufferPool::ThePool()->release(dest);
+            throw;
+        }
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+#endif
+
+#if HAVE_LIBBLOSC
+    void blosc_test() {
+        const auto bytes = as_bytes(d_values);
+        vector<char> encoded(bytes.size() + BLOSC_MAX_OVERHEAD);
+        const int csize = blosc_compress_ctx(5, BLOSC_SHUFFLE, sizeof(float), bytes.size(), bytes.data(),
+                                             encoded.data(), encoded.size(), "blosclz", 0, 1);
+        CPPUNIT_ASSERT(csize > 0);
+        encoded.resize(csize);
+
+        check_decoder("blosc", blosc_decode, encoded, bytes, sizeof(float), {});
+    }
+#endif
+
+#if HAVE_LIBSZ
+    void szip_test() {
+        const auto bytes = as_bytes(d_values);
+        // options_mask, pixels_per_block, bits_per_pixel, pixels_per_scanline
+        const vector<unsigned int> params{SZ_ALLOW_K13_OPTION_MASK | SZ_NN_OPTION_MASK | SZ_RAW_OPTION_MASK
+                                          | SZ_LSB_OPTION_MASK, 32, 32, 256};
+        SZ_com_t sz_param;
+        sz_param.options_mask = params[0];
+        sz_param.pixels_per_block = params[1];
+        sz_param.bits_per_pixel = params[2];
+        sz_param.pixels_per_scanline = params[3];
+
+        // HDF5 puts the decoded size, as a four-byte little-endian value, in front of the szip data.
+        vector<char> encoded(bytes.size() * 2 + 4);
+        size_t csize = encoded.size() - 4;
+        const int status = SZ_BufftoBuffCompress(&encoded[4], &csize, bytes.data(), bytes.size(), &sz_param);
+        CPPUNIT_ASSERT(status == SZ_OK);
+        for (int i = 0; i < 4; ++i)
+            encoded[i] = static_cast<char>(bytes.size() >> (8 * i));
+        encoded.resize(csize + 4);
+
+        check_decoder("szip", szip_decode, encoded, bytes, sizeof(float), params);
+
+        char *dest = ChunkBufferPool::ThePool()->allocate(bytes.size());
+        CPPUNIT_ASSERT_THROW(szip_decode(&dest, bytes.size(), encoded.data(), encoded.size(), sizeof(float), {}),
+                             BESInternalError);
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+#endif
+
+    // The new filters are used by Chunk::filter_chunk(), along with the original ones.
+    void filter_chunk_test() {
+        const auto bytes = as_bytes(d_values);
+        auto shuffled = bitshuffle(bytes, sizeof(float), 2048);
+
+        Chunk chunk("LE", shuffled.size(), 0);
+        auto buf = ChunkBufferPool::ThePool()->allocate(shuffled.size());
+        memcpy(buf, shuffled.data(), shuffled.size());
+        chunk.set_read_buffer(buf, shuffled.size(), shuffled.size(), true);
+
+        chunk.filter_chunk("bitshuffle(0,3,4,0,0)", d_values.size(), sizeof(float));
+        CPPUNIT_ASSERT(chunk.get_rbuf_size() == bytes.size());
+        CPPUNIT_ASSERT(memcmp(chunk.get_rbuf(), bytes.data(), bytes.size()) == 0);
+    }
+
+    // Sixteen int32 values, i * 1000 + 7, shuffled by the HDF5 shuffle filter (byte j of
+    // element i at j * 16 + i) and then compressed by zlib's compress() at level 6, as
+    // the HDF5 deflate filter does. The bytes were made by zlib, not by this code.
+    void shuffle_deflate_reference_test() {
+        const vector<unsigned char> encoded = {
+            0x78, 0x9c, 0x63, 0x7f, 0x7f, 0x7d, 0xff, 0xf2, 0xfe, 0xf2, 0x78, 0x77, 0x7d, 0xf1, 0xff, 0xcf,
+            0xcf, 0x6f, 0x9f, 0xcf, 0xc0, 0xcc, 0xce, 0xcd, 0x2f, 0x2c, 0x2e, 0x2d, 0xaf, 0xac, 0xae, 0xa5,
+            0x67, 0x64, 0x66, 0xc5, 0x40, 0x00, 0x00, 0x00, 0x47, 0xef, 0x0a, 0xfd
+        };
+        vector<int32_t> expected(16);
+        for (size_t i = 0; i < expected.size(); ++i)
+            expected[i] = static_cast<int32_t>(i * 1000 + 7);
+
+        Chunk chunk("LE", encoded.size(), 0);
+        auto buf = ChunkBufferPool::ThePool()->allocate(encoded.size());
+        memcpy(buf, encoded.data(), encoded.size());
+        chunk.set_read_buffer(buf, encoded.size(), encoded.size(), true);
+
+        chunk.filter_chunk("shuffle deflate", expected.size(), sizeof(int32_t));
+        CPPUNIT_ASSERT(chunk.get_rbuf_size() == expected.size() * sizeof(int32_t));
+        CPPUNIT_ASSERT(memcmp(chunk.get_rbuf(), expected.data(), expected.size() * sizeof(int32_t)) == 0);
+    }
+
+    void filter_chunk_unknown_filter_test() {
+        Chunk chunk("LE", 16, 0);
+        chunk.set_read_buffer(ChunkBufferPool::ThePool()->allocate(16), 16, 16, true);
+        CPPUNIT_ASSERT_THROW(chunk.filter_chunk("lzf", 4, 4), BESInternalError);
+    }
+
+    CPPUNIT_TEST_SUITE( ChunkFiltersTest );
+
+    CPPUNIT_TEST(parse_filter_spec_test);
+    CPPUNIT_TEST(make_filter_spec_test);
+    CPPUNIT_TEST(filters_support_direct_io_test);
+    CPPUNIT_TEST(has_filter_test);
+    CPPUNIT_TEST(registry_test);
+    CPPUNIT_TEST(bitunshuffle_block_test);
+    CPPUNIT_TEST(bitshuffle_test);
+    CPPUNIT_TEST(bitshuffle_truncated_test);
+#if HAVE_LIBLZ4
+    CPPUNIT_TEST(bitshuffle_lz4_test);
+#endif
+#if HAVE_LIBZSTD
+    CPPUNIT_TEST(zstd_test);
+    CPPUNIT_TEST(zstd_unknown_size_test);
+#endif
+#if HAVE_LIBBLOSC
+    CPPUNIT_TEST(blosc_test);
+#endif
+#if HAVE_LIBSZ
+    CPPUNIT_TEST(szip_test);
+#endif
+    CPPUNIT_TEST(filter_chunk_test);
+    CPPUNIT_TEST(shuffle_deflate_reference_test);
+    CPPUNIT_TEST(filter_chunk_unknown_filter_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ChunkFiltersTest);
+
+} // namespace dmrpp
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<dmrpp::ChunkFiltersTest>(argc, argv, "cerr,dmrpp:filters") ? 0 : 1;
+}
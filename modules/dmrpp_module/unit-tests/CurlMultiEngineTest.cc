@@ -0,0 +1,218 @@
+// This file is part of bes, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BESError.h"
+#include "TheBESKeys.h"
+#include "CurlUtils.h"
+#include "url_impl.h"
+
+#include "Chunk.h"
+#include "CurlHandlePool.h"
+#include "CurlMultiEngine.h"
+#include "DmrppRequestHandler.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+#define prolog std::string("CurlMultiEngineTest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+class CurlMultiEngineTest: public CppUnit::TestFixture {
+private:
+    DmrppRequestHandler *d_handler = nullptr;
+    shared_ptr<http::url> d_data_url;
+    string d_contents;
+
+    // One range of the test file and the transfer that reads it.
+    struct range_read {
+        vector<char> buffer;
+        unique_ptr<Chunk> chunk;
+        dmrpp_easy_handle *handle = nullptr;
+
+        range_read(const shared_ptr<http::url> &url, unsigned long long offset, unsigned long long size)
+                : buffer(size) {
+            chunk.reset(new Chunk(url, "NOT_USED", size, offset));
+            chunk->set_read_buffer(buffer.data(), size, 0, false);
+            handle = DmrppRequestHandler::curl_handle_pool->get_easy_handle(chunk.get());
+            CPPUNIT_ASSERT(handle);
+        }
+
+        ~range_read() {
+            CurlHandlePool::release_handle(handle);
+        }
+    };
+
+    // Submit all the reads and wait for them; return the number that failed.
+    static unsigned int run(CurlMultiEngine &engine, vector<unique_ptr<range_read>> &reads) {
+        mutex mtx;
+        condition_variable cv;
+        size_t done = 0;
+        unsigned int failed = 0;
+
+        for (auto &r: reads) {
+            engine.submit(r->handle, [&](exception_ptr error) {
+                lock_guard<mutex> lck(mtx);
+                if (error)
+                    failed++;
+                done++;
+                cv.notify_all();
+            });
+        }
+
+        unique_lock<mutex> lck(mtx);
+        cv.wait(lck, [&] { return done == reads.size(); });
+        return failed;
+    }
+
+public:
+    // Called once before everything gets tested
+    CurlMultiEngineTest() = default;
+
+    // Called at the end of the test
+    ~CurlMultiEngineTest() override = default;
+
+    void setUp() override {
+        TheBESKeys::ConfigFile = string(TEST_BUILD_DIR).append("/bes.conf");
+        // This call instantiates the curlHandlePool.
+        d_handler = new DmrppRequestHandler("Chaos");
+
+        const string file_name = string(TEST_DATA_DIR).append("/big_ole_chunky_test.txt");
+        d_data_url = make_shared<http::url>(string("file://").append(file_name));
+
+        ifstream in(file_name, ios::binary);
+        d_contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        CPPUNIT_ASSERT(!d_contents.empty());
+    }
+
+    void tearDown() override {
+        delete d_handler;
+    }
+
+    void many_transfers_test() {
+        CurlMultiEngine engine(16, 0, false);
+
+        vector<unique_ptr<range_read>> reads;
+        for (unsigned long long i = 0; i < 100; ++i)
+            reads.emplace_back(new range_read(d_data_url, i * 1000 + i, 1000 + i));
+
+        CPPUNIT_ASSERT_EQUAL(0U, run(engine, reads));
+
+        for (unsigned long long i = 0; i < reads.size(); ++i) {
+            const auto &r = reads[i];
+            CPPUNIT_ASSERT_EQUAL(r->chunk->get_size(), r->chunk->get_bytes_read());
+            CPPUNIT_ASSERT(d_contents.compare(r->chunk->get_offset(), r->buffer.size(), r->buffer.data(),
+                                              r->buffer.size()) == 0);
+        }
+
+        const auto stats = engine.stats();
+        CPPUNIT_ASSERT_EQUAL(100ULL, stats.transfers);
+        CPPUNIT_ASSERT_EQUAL(0ULL, stats.failures);
+        CPPUNIT_ASSERT(stats.peak_in_flight <= 16);
+    }
+
+    void per_origin_limit_test() {
+        CurlMultiEngine engine(16, 2, false);
+
+        vector<unique_ptr<range_read>> reads;
+        for (unsigned long long i = 0; i < 40; ++i)
+            reads.emplace_back(new range_read(d_data_url, i * 4096, 4096));
+
+        CPPUNIT_ASSERT_EQUAL(0U, run(engine, reads));
+
+        const auto stats = engine.stats();
+        DBG(engine.dump(cerr));
+        CPPUNIT_ASSERT_EQUAL(40ULL, stats.transfers);
+        CPPUNIT_ASSERT(stats.peak_origin_in_flight <= 2);
+        CPPUNIT_ASSERT(stats.peak_in_flight <= 2);
+    }
+
+    void perform_test() {
+        CurlMultiEngine engine(4, 0, false);
+
+        range_read r(d_data_url, 12345, 777);
+        engine.perform(r.handle);
+
+        CPPUNIT_ASSERT_EQUAL(777ULL, r.chunk->get_bytes_read());
+        CPPUNIT_ASSERT(d_contents.compare(12345, 777, r.buffer.data(), 777) == 0);
+    }
+
+    void missing_file_test() {
+        CurlMultiEngine engine(4, 0, false);
+
+        auto missing = make_shared<http::url>(string("file://").append(TEST_DATA_DIR).append("/no_such_file.bin"));
+        range_read r(missing, 0, 100);
+        // Retried like curl::super_easy_perform() does, then reported.
+        CPPUNIT_ASSERT_THROW(engine.perform(r.handle), BESError);
+        const auto stats = engine.stats();
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned long long>(curl::retry_limit), stats.transfers);
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned long long>(curl::retry_limit - 1), stats.retries);
+        CPPUNIT_ASSERT_EQUAL(1ULL, stats.failures);
+    }
+
+    void shutdown_test() {
+        vector<unique_ptr<range_read>> reads;
+        for (unsigned long long i = 0; i < 20; ++i)
+            reads.emplace_back(new range_read(d_data_url, i * 100, 100));
+
+        atomic<unsigned int> completed{0};
+        {
+            CurlMultiEngine engine(1, 0, false);
+            for (auto &r: reads)
+                engine.submit(r->handle, [&completed](exception_ptr) { completed++; });
+        }
+
+        // Every transfer is completed, with or without an error, before the engine is gone.
+        CPPUNIT_ASSERT_EQUAL(20U, completed.load());
+    }
+
+    CPPUNIT_TEST_SUITE( CurlMultiEngineTest );
+
+    CPPUNIT_TEST(many_transfers_test);
+    CPPUNIT_TEST(per_origin_limit_test);
+    CPPUNIT_TEST(perform_test);
+    CPPUNIT_TEST(missing_file_test);
+    CPPUNIT_TEST(shutdown_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CurlMultiEngineTest);
+
+} // namespace dmrpp
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<dmrpp::CurlMultiEngineTest>(argc, argv, "cerr,dmrpp:curl_multi") ? 0 : 1;
+}
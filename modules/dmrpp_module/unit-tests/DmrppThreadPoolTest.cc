@@ -0,0 +1,223 @@
+// This file is part of bes, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "BESInternalError.h"
+
+#include "DmrppThreadPool.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+#define prolog std::string("DmrppThreadPoolTest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+class DmrppThreadPoolTest: public CppUnit::TestFixture {
+private:
+    unique_ptr<DmrppThreadPool> d_pool;
+
+public:
+    // Called once before everything gets tested
+    DmrppThreadPoolTest() = default;
+
+    // Called at the end of the test
+    ~DmrppThreadPoolTest() override = default;
+
+    // Called before each test
+    void setUp() override {
+        d_pool.reset(new DmrppThreadPool(4, 2));
+    }
+
+    void tearDown() override {
+        d_pool.reset();
+    }
+
+    void lane_size_test() {
+        CPPUNIT_ASSERT(d_pool->lane_size(transfer_lane) == 4);
+        CPPUNIT_ASSERT(d_pool->lane_size(compute_lane) == 2);
+
+        DmrppThreadPool pool(0, 0);
+        CPPUNIT_ASSERT_MESSAGE("A lane always has at least one worker", pool.lane_size(transfer_lane) == 1);
+        CPPUNIT_ASSERT(pool.lane_size(compute_lane) == 1);
+    }
+
+    void run_tasks_test() {
+        atomic<unsigned int> count{0};
+        vector<DmrppThreadPool::task> tasks;
+        for (int i = 0; i < 1000; ++i)
+            tasks.emplace_back([&count]() { count++; });
+
+        d_pool->run_tasks(compute_lane, tasks);
+        CPPUNIT_ASSERT(count == 1000);
+        CPPUNIT_ASSERT(tasks.empty());
+        CPPUNIT_ASSERT(d_pool->d_lanes[compute_lane].tasks_run == 1000);
+        CPPUNIT_ASSERT(d_pool->d_lanes[compute_lane].queued == 0);
+    }
+
+    void uses_many_threads_test() {
+        mutex mtx;
+        set<thread::id> ids;
+        vector<DmrppThreadPool::task> tasks;
+        for (int i = 0; i < 16; ++i) {
+            tasks.emplace_back([&mtx, &ids]() {
+                this_thread::sleep_for(chrono::milliseconds(20));
+                lock_guard<mutex> lck(mtx);
+                ids.insert(this_thread::get_id());
+            });
+        }
+
+        d_pool->run_tasks(transfer_lane, tasks);
+        DBG(cerr << prolog << "Distinct threads: " << ids.size() << endl);
+        CPPUNIT_ASSERT(ids.size() > 1);
+        CPPUNIT_ASSERT(ids.size() <= 4);
+        CPPUNIT_ASSERT(ids.find(this_thread::get_id()) == ids.end());
+    }
+
+    void error_cancels_group_test() {
+        // One worker, which runs the newest task on its queue first, so the task
+        // that throws runs before most of the others.
+        DmrppThreadPool pool(1, 1);
+        atomic<unsigned int> count{0};
+        vector<DmrppThreadPool::task> tasks;
+        for (int i = 0; i < 100; ++i)
+            tasks.emplace_back([&count]() { this_thread::sleep_for(chrono::milliseconds(1)); count++; });
+        tasks.emplace_back([]() { throw BESInternalError("Expected", __FILE__, __LINE__); });
+
+        CPPUNIT_ASSERT_THROW(pool.run_tasks(transfer_lane, tasks), BESInternalError);
+        DBG(cerr << prolog << "Tasks run: " << count << endl);
+        CPPUNIT_ASSERT_MESSAGE("Tasks queued after the error should be skipped", count < 100);
+        CPPUNIT_ASSERT(pool.d_lanes[transfer_lane].tasks_skipped > 0);
+
+        // The pool is still usable and another group is not affected.
+        count = 0;
+        for (int i = 0; i < 10; ++i)
+            tasks.emplace_back([&count]() { count++; });
+        pool.run_tasks(transfer_lane, tasks);
+        CPPUNIT_ASSERT(count == 10);
+    }
+
+    void groups_are_independent_test() {
+        auto bad = make_shared<TaskGroup>(transfer_lane);
+        auto good = make_shared<TaskGroup>(transfer_lane);
+        atomic<unsigned int> count{0};
+
+        bad->cancel();
+        for (int i = 0; i < 10; ++i) {
+            d_pool->submit(bad, [&count]() { count += 100; });
+            d_pool->submit(good, [&count]() { count++; });
+        }
+
+        d_pool->wait(*bad);
+        d_pool->wait(*good);
+        CPPUNIT_ASSERT(count == 10);
+        CPPUNIT_ASSERT(bad->done() && good->done());
+    }
+
+    // Transfer tasks that fan out into the compute lane, the pattern used by
+    // SuperChunk::process_child_chunks().
+    void nested_lanes_test() {
+        atomic<unsigned int> count{0};
+        vector<DmrppThreadPool::task> tasks;
+        for (int i = 0; i < 20; ++i) {
+            tasks.emplace_back([this, &count]() {
+                vector<DmrppThreadPool::task> children;
+                for (int j = 0; j < 10; ++j)
+                    children.emplace_back([&count]() { count++; });
+                d_pool->run_tasks(compute_lane, children);
+            });
+        }
+
+        d_pool->run_tasks(transfer_lane, tasks);
+        CPPUNIT_ASSERT(count == 200);
+    }
+
+    // A worker that waits on a group in its own lane runs tasks while it waits;
+    // with one worker per lane this would deadlock otherwise.
+    void nested_same_lane_test() {
+        DmrppThreadPool pool(1, 1);
+        atomic<unsigned int> count{0};
+        vector<DmrppThreadPool::task> tasks;
+        tasks.emplace_back([&pool, &count]() {
+            vector<DmrppThreadPool::task> children;
+            for (int j = 0; j < 10; ++j)
+                children.emplace_back([&count]() { count++; });
+            pool.run_tasks(transfer_lane, children);
+        });
+
+        pool.run_tasks(transfer_lane, tasks);
+        CPPUNIT_ASSERT(count == 10);
+    }
+
+    void stealing_test() {
+        // Load all the work onto one worker's queue; the idle workers have to steal it.
+        auto group = make_shared<TaskGroup>(compute_lane);
+        DmrppThreadPool::task producer = [this, group]() {
+            for (int i = 0; i < 50; ++i)
+                d_pool->submit(group, []() { this_thread::sleep_for(chrono::milliseconds(1)); });
+        };
+        vector<DmrppThreadPool::task> tasks{producer};
+        d_pool->run_tasks(compute_lane, tasks);
+        d_pool->wait(*group);
+
+        DBG(cerr << prolog << "Tasks stolen: " << d_pool->d_lanes[compute_lane].tasks_stolen << endl);
+        CPPUNIT_ASSERT(d_pool->d_lanes[compute_lane].tasks_stolen > 0);
+    }
+
+    void the_thread_pool_test() {
+        DmrppThreadPool *pool = DmrppThreadPool::TheThreadPool();
+        CPPUNIT_ASSERT(pool);
+        CPPUNIT_ASSERT(pool == DmrppThreadPool::TheThreadPool());
+    }
+
+    CPPUNIT_TEST_SUITE( DmrppThreadPoolTest );
+
+    CPPUNIT_TEST(lane_size_test);
+    CPPUNIT_TEST(run_tasks_test);
+    CPPUNIT_TEST(uses_many_threads_test);
+    CPPUNIT_TEST(error_cancels_group_test);
+    CPPUNIT_TEST(groups_are_independent_test);
+    CPPUNIT_TEST(nested_lanes_test);
+    CPPUNIT_TEST(nested_same_lane_test);
+    CPPUNIT_TEST(stealing_test);
+    CPPUNIT_TEST(the_thread_pool_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DmrppThreadPoolTest);
+
+} // namespace dmrpp
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<dmrpp::DmrppThreadPoolTest>(argc, argv, "cerr,dmrpp:pool") ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+// This file is part of bes, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+#include "BESInternalError.h"
+
+#include "Chunk.h"
+#include "ChunkBufferPool.h"
+#include "inflate_util.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+#define prolog std::string("InflateTest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+class InflateTest: public CppUnit::TestFixture {
+private:
+    vector<char> d_raw;
+    vector<char> d_deflated;
+
+public:
+    // Called once before everything gets tested
+    InflateTest() = default;
+
+    // Called at the end of the test
+    ~InflateTest() override = default;
+
+    void setUp() override {
+        d_raw.resize(100000);
+        for (size_t i = 0; i < d_raw.size(); ++i)
+            d_raw[i] = static_cast<char>((i % 251) ^ (i >> 7));
+
+        uLongf size = compressBound(d_raw.size());
+        d_deflated.resize(size);
+        CPPUNIT_ASSERT(compress(reinterpret_cast<Bytef *>(d_deflated.data()), &size,
+                                reinterpret_cast<const Bytef *>(d_raw.data()), d_raw.size()) == Z_OK);
+        d_deflated.resize(size);
+    }
+
+    void engine_name_test() {
+        DBG(cerr << prolog << "Inflate engine: " << inflate_engine_name() << endl);
+        CPPUNIT_ASSERT(strlen(inflate_engine_name()) > 0);
+    }
+
+    void inflate_test() {
+        char *dest = ChunkBufferPool::ThePool()->allocate(d_raw.size());
+        auto size = inflate(&dest, d_raw.size(), d_deflated.data(), d_deflated.size());
+        CPPUNIT_ASSERT_EQUAL((unsigned long long) d_raw.size(), size);
+        CPPUNIT_ASSERT(memcmp(dest, d_raw.data(), size) == 0);
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+
+    // A buffer that is too small is replaced, as when deflate is used twice.
+    void inflate_small_buffer_test() {
+        for (unsigned long long dest_size: {1000ULL, 7ULL, 1ULL}) {
+            char *dest = ChunkBufferPool::ThePool()->allocate(dest_size);
+            auto size = inflate(&dest, dest_size, d_deflated.data(), d_deflated.size());
+            CPPUNIT_ASSERT_EQUAL((unsigned long long) d_raw.size(), size);
+            CPPUNIT_ASSERT(memcmp(dest, d_raw.data(), size) == 0);
+            ChunkBufferPool::ThePool()->release(dest);
+        }
+    }
+
+    void inflate_zlib_test() {
+        char *dest = ChunkBufferPool::ThePool()->allocate(d_raw.size());
+        auto size = inflate_zlib(&dest, d_raw.size(), d_deflated.data(), d_deflated.size());
+        CPPUNIT_ASSERT_EQUAL((unsigned long long) d_raw.size(), size);
+        CPPUNIT_ASSERT(memcmp(dest, d_raw.data(), size) == 0);
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+
+    // The single-shot engine never grows the buffer; it returns zero instead.
+    void inflate_single_shot_test() {
+        vector<char> dest(d_raw.size());
+        auto size = inflate_single_shot(dest.data(), dest.size(), d_deflated.data(), d_deflated.size());
+        if (string(inflate_engine_name()) == "zlib") {
+            CPPUNIT_ASSERT_EQUAL(0ULL, size);
+        }
+        else {
+            CPPUNIT_ASSERT_EQUAL((unsigned long long) d_raw.size(), size);
+            CPPUNIT_ASSERT(memcmp(dest.data(), d_raw.data(), size) == 0);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(0ULL, inflate_single_shot(dest.data(), 100, d_deflated.data(), d_deflated.size()));
+    }
+
+    void inflate_bad_data_test() {
+        auto bad = d_deflated;
+        bad[10] ^= 0x55;
+        bad[20] ^= 0x33;
+        char *dest = ChunkBufferPool::ThePool()->allocate(d_raw.size());
+        CPPUNIT_ASSERT_THROW(inflate(&dest, d_raw.size(), bad.data(), bad.size()), BESInternalError);
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+
+    void inflate_zero_size_test() {
+        char *dest = ChunkBufferPool::ThePool()->allocate(10);
+        CPPUNIT_ASSERT_THROW(inflate(&dest, 10, d_deflated.data(), 0), BESInternalError);
+        CPPUNIT_ASSERT_THROW(inflate(&dest, 0, d_deflated.data(), d_deflated.size()), BESInternalError);
+        ChunkBufferPool::ThePool()->release(dest);
+    }
+
+    void inflate_into_test() {
+        vector<char> dest(d_raw.size());
+        auto size = inflate_into(dest.data(), dest.size(), d_deflated.data(), d_deflated.size());
+        CPPUNIT_ASSERT_EQUAL((unsigned long long) d_raw.size(), size);
+        CPPUNIT_ASSERT(dest == d_raw);
+    }
+
+    // The buffer is not ours to grow, so data that do not fit are not an error.
+    void inflate_into_small_buffer_test() {
+        vector<char> dest(d_raw.size() - 1);
+        CPPUNIT_ASSERT_EQUAL(0ULL, inflate_into(dest.data(), dest.size(), d_deflated.data(), d_deflated.size()));
+    }
+
+    void inflate_into_bad_data_test() {
+        auto bad = d_deflated;
+        bad[0] ^= 0x55;
+        vector<char> dest(d_raw.size());
+        CPPUNIT_ASSERT_THROW(inflate_into(dest.data(), dest.size(), bad.data(), bad.size()), BESInternalError);
+    }
+
+    // Load a chunk as SuperChunk::map_chunks_to_buffer() does - the chunk does not own its buffer.
+    static void set_chunk_bytes(Chunk &chunk, vector<char> &bytes) {
+        chunk.set_read_buffer(bytes.data(), bytes.size(), bytes.size(), false);
+    }
+
+    void filter_chunk_into_test() {
+        Chunk chunk("LE", d_deflated.size(), 0);
+        set_chunk_bytes(chunk, d_deflated);
+
+        vector<char> dest(d_raw.size());
+        CPPUNIT_ASSERT(chunk.filter_chunk_into(dest.data(), "deflate", d_raw.size() / 4, 4));
+        CPPUNIT_ASSERT(dest == d_raw);
+        // The chunk still holds the compressed bytes.
+        CPPUNIT_ASSERT(chunk.get_rbuf() == d_deflated.data());
+    }
+
+    void filter_chunk_into_shuffle_test() {
+        const unsigned long long width = 4;
+        const unsigned long long elements = d_raw.size() / width;
+        vector<char> shuffled(d_raw.size());
+        for (unsigned long long i = 0; i < elements; ++i)
+            for (unsigned long long b = 0; b < width; ++b)
+                shuffled[b * elements + i] = d_raw[i * width + b];
+
+        uLongf size = compressBound(shuffled.size());
+        vector<char> deflated(size);
+        CPPUNIT_ASSERT(compress(reinterpret_cast<Bytef *>(deflated.data()), &size,
+                                reinterpret_cast<const Bytef *>(shuffled.data()), shuffled.size()) == Z_OK);
+        deflated.resize(size);
+
+        Chunk chunk("LE", deflated.size(), 0);
+        set_chunk_bytes(chunk, deflated);
+
+        vector<char> dest(d_raw.size());
+        CPPUNIT_ASSERT(chunk.filter_chunk_into(dest.data(), "shuffle deflate", elements, width));
+        CPPUNIT_ASSERT(dest == d_raw);
+    }
+
+    // Filters other than deflate and shuffle/deflate, or a chunk of the wrong size, use filter_chunk().
+    void filter_chunk_into_fallback_test() {
+        Chunk chunk("LE", d_deflated.size(), 0);
+        set_chunk_bytes(chunk, d_deflated);
+
+        vector<char> dest(d_raw.size() * 2);
+        CPPUNIT_ASSERT(!chunk.filter_chunk_into(dest.data(), "deflate fletcher32", d_raw.size(), 1));
+        CPPUNIT_ASSERT(!chunk.filter_chunk_into(dest.data(), "deflate deflate", d_raw.size(), 1));
+        CPPUNIT_ASSERT(!chunk.filter_chunk_into(dest.data(), "deflate", d_raw.size() * 2, 1));
+        CPPUNIT_ASSERT(!chunk.filter_chunk_into(dest.data(), "deflate", d_raw.size() / 2, 1));
+    }
+
+    CPPUNIT_TEST_SUITE( InflateTest );
+
+    CPPUNIT_TEST(engine_name_test);
+    CPPUNIT_TEST(inflate_test);
+    CPPUNIT_TEST(inflate_small_buffer_test);
+    CPPUNIT_TEST(inflate_zlib_test);
+    CPPUNIT_TEST(inflate_single_shot_test);
+    CPPUNIT_TEST(inflate_bad_data_test);
+    CPPUNIT_TEST(inflate_zero_size_test);
+    CPPUNIT_TEST(inflate_into_test);
+    CPPUNIT_TEST(inflate_into_small_buffer_test);
+    CPPUNIT_TEST(inflate_into_bad_data_test);
+    CPPUNIT_TEST(filter_chunk_into_test);
+    CPPUNIT_TEST(filter_chunk_into_shuffle_test);
+    CPPUNIT_TEST(filter_chunk_into_fallback_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(InflateTest);
+
+} // namespace dmrpp
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<dmrpp::InflateTest>(argc, argv, "cerr,dmrpp:inflate") ? 0 : 1;
+}
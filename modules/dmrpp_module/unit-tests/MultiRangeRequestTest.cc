@@ -0,0 +1,288 @@
+// This file is part of bes, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "url_impl.h"
+
+#include "MultiRangeRequest.h"
+#include "SuperChunk.h"
+#include "DmrppRequestHandler.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+#define prolog std::string("MultiRangeRequestTest::").append(__func__).append("() - ")
+
+namespace dmrpp {
+
+class MultiRangeRequestTest: public CppUnit::TestFixture {
+private:
+    // The 'resource' the ranges are read from
+    string d_resource;
+
+    // Two ranges: 10-19 and 40-49
+    vector<char> d_buf1;
+    vector<char> d_buf2;
+    vector<byte_range> d_ranges;
+
+    static string part(const string &boundary, unsigned long long first, unsigned long long last, const string &body) {
+        return "--" + boundary + "\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes "
+               + to_string(first) + "-" + to_string(last) + "/100\r\n\r\n" + body + "\r\n";
+    }
+
+    string multipart_body(const string &boundary) const {
+        return "\r\n" + part(boundary, 10, 19, d_resource.substr(10, 10))
+               + part(boundary, 40, 49, d_resource.substr(40, 10)) + "--" + boundary + "--\r\n";
+    }
+
+    void check_ranges() const {
+        CPPUNIT_ASSERT_EQUAL(d_resource.substr(10, 10), string(d_buf1.data(), d_buf1.size()));
+        CPPUNIT_ASSERT_EQUAL(d_resource.substr(40, 10), string(d_buf2.data(), d_buf2.size()));
+    }
+
+public:
+    // Called once before everything gets tested
+    MultiRangeRequestTest() = default;
+
+    // Called at the end of the test
+    ~MultiRangeRequestTest() override = default;
+
+    void setUp() override {
+        d_resource.clear();
+        for (int i = 0; i < 100; ++i)
+            d_resource.push_back(static_cast<char>('A' + i % 26));
+
+        d_buf1.assign(10, '\0');
+        d_buf2.assign(10, '\0');
+        d_ranges.clear();
+        // Out of order on purpose; the parser sorts them.
+        d_ranges.emplace_back(40, 10, d_buf2.data());
+        d_ranges.emplace_back(10, 10, d_buf1.data());
+    }
+
+    void get_boundary_test() {
+        CPPUNIT_ASSERT_EQUAL(string("3d6b6a416f9b5"),
+                             ByteRangesParser::get_boundary("multipart/byteranges; boundary=3d6b6a416f9b5"));
+        CPPUNIT_ASSERT_EQUAL(string("a b;c"),
+                             ByteRangesParser::get_boundary("Multipart/ByteRanges; Boundary=\"a b;c\""));
+        CPPUNIT_ASSERT_EQUAL(string("xyz"),
+                             ByteRangesParser::get_boundary("multipart/byteranges; boundary=xyz; charset=x"));
+        CPPUNIT_ASSERT_EQUAL(string(""), ByteRangesParser::get_boundary("multipart/byteranges"));
+        CPPUNIT_ASSERT_EQUAL(string(""), ByteRangesParser::get_boundary("application/octet-stream"));
+        CPPUNIT_ASSERT_EQUAL(string(""), ByteRangesParser::get_boundary(""));
+    }
+
+    void parse_content_range_test() {
+        unsigned long long first = 0;
+        unsigned long long last = 0;
+        CPPUNIT_ASSERT(ByteRangesParser::parse_content_range("bytes 10-19/100", first, last));
+        CPPUNIT_ASSERT_EQUAL(10ULL, first);
+        CPPUNIT_ASSERT_EQUAL(19ULL, last);
+        CPPUNIT_ASSERT(ByteRangesParser::parse_content_range(" bytes 0-0/*", first, last));
+        CPPUNIT_ASSERT_EQUAL(0ULL, first);
+        CPPUNIT_ASSERT_EQUAL(0ULL, last);
+
+        CPPUNIT_ASSERT(!ByteRangesParser::parse_content_range("bytes */100", first, last));
+        CPPUNIT_ASSERT(!ByteRangesParser::parse_content_range("bytes 20-10/100", first, last));
+        CPPUNIT_ASSERT(!ByteRangesParser::parse_content_range("bytes 10-/100", first, last));
+        CPPUNIT_ASSERT(!ByteRangesParser::parse_content_range("items 10-19/100", first, last));
+        CPPUNIT_ASSERT(!ByteRangesParser::parse_content_range("", first, last));
+    }
+
+    void multipart_test() {
+        const string body = multipart_body("3d6b6a416f9b5");
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=3d6b6a416f9b5", ""));
+        CPPUNIT_ASSERT(parser.parse(body.data(), body.size()));
+        CPPUNIT_ASSERT(parser.complete());
+        check_ranges();
+    }
+
+    // libcurl passes the body in pieces of any size.
+    void multipart_pieces_test() {
+        const string body = multipart_body("3d6b6a416f9b5");
+        for (size_t piece = 1; piece <= body.size(); ++piece) {
+            setUp();
+            ByteRangesParser parser(d_ranges);
+            CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=3d6b6a416f9b5", ""));
+            for (size_t i = 0; i < body.size(); i += piece)
+                CPPUNIT_ASSERT(parser.parse(body.data() + i, min(piece, body.size() - i)));
+            CPPUNIT_ASSERT(parser.complete());
+            check_ranges();
+        }
+    }
+
+    // The closing boundary does not have to end with CRLF.
+    void multipart_no_final_crlf_test() {
+        string body = multipart_body("b");
+        body.resize(body.size() - 2);
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=b", ""));
+        CPPUNIT_ASSERT(parser.parse(body.data(), body.size()));
+        CPPUNIT_ASSERT(parser.complete());
+    }
+
+    // Servers may merge ranges that are close together; the bytes between them are dropped.
+    void merged_part_test() {
+        const string body = part("b", 5, 59, d_resource.substr(5, 55)) + "--b--\r\n";
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=b", ""));
+        CPPUNIT_ASSERT(parser.parse(body.data(), body.size()));
+        CPPUNIT_ASSERT(parser.complete());
+        check_ranges();
+    }
+
+    // A 206 response with one range that holds all of the requested ranges.
+    void single_part_test() {
+        const string body = d_resource.substr(10, 40);
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("application/octet-stream", "bytes 10-49/100"));
+        CPPUNIT_ASSERT(parser.parse(body.data(), body.size()));
+        CPPUNIT_ASSERT(parser.complete());
+        check_ranges();
+    }
+
+    void missing_range_test() {
+        const string body = part("b", 10, 19, d_resource.substr(10, 10)) + "--b--\r\n";
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=b", ""));
+        CPPUNIT_ASSERT(parser.parse(body.data(), body.size()));
+        CPPUNIT_ASSERT(!parser.complete());
+    }
+
+    void truncated_body_test() {
+        const string body = multipart_body("b");
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=b", ""));
+        CPPUNIT_ASSERT(parser.parse(body.data(), body.size() / 2));
+        CPPUNIT_ASSERT(!parser.complete());
+    }
+
+    void not_a_range_response_test() {
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(!parser.start("application/octet-stream", ""));
+        CPPUNIT_ASSERT(parser.failed());
+        CPPUNIT_ASSERT(!parser.parse(d_resource.data(), d_resource.size()));
+    }
+
+    void part_without_range_test() {
+        const string body = "--b\r\nContent-Type: text/plain\r\n\r\nhello\r\n--b--\r\n";
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=b", ""));
+        CPPUNIT_ASSERT(!parser.parse(body.data(), body.size()));
+        CPPUNIT_ASSERT(parser.failed());
+    }
+
+    void long_line_test() {
+        const string body = "--b\r\nX-Junk: " + string(10000, 'x') + "\r\n";
+        ByteRangesParser parser(d_ranges);
+        CPPUNIT_ASSERT(parser.start("multipart/byteranges; boundary=b", ""));
+        CPPUNIT_ASSERT(!parser.parse(body.data(), body.size()));
+    }
+
+    static shared_ptr<SuperChunk> make_super_chunk(const shared_ptr<http::url> &url, unsigned long long offset,
+                                                  unsigned long long size) {
+        auto sc = make_shared<SuperChunk>("sc-" + to_string(offset));
+        sc->add_chunk(make_shared<Chunk>(url, "LE", size, offset));
+        return sc;
+    }
+
+    void range_arg_string_test() {
+        auto url = make_shared<http::url>("http://test.opendap.org/data/file.h5");
+        MultiRangeRequest request(url);
+        CPPUNIT_ASSERT(request.add(make_super_chunk(url, 1000, 100)));
+        CPPUNIT_ASSERT(request.add(make_super_chunk(url, 0, 10)));
+        CPPUNIT_ASSERT(request.add(make_super_chunk(url, 5000, 1)));
+        CPPUNIT_ASSERT_EQUAL(string("0-9,1000-1099,5000-5000"), request.get_range_arg_string());
+    }
+
+    void add_test() {
+        auto url = make_shared<http::url>("http://test.opendap.org/data/file.h5");
+        auto other_url = make_shared<http::url>("http://test.opendap.org/data/other.h5");
+        MultiRangeRequest request(url);
+        CPPUNIT_ASSERT(!request.add(make_super_chunk(other_url, 0, 10)));
+
+        const auto max_ranges = DmrppRequestHandler::d_multi_range_max_ranges;
+        DmrppRequestHandler::d_multi_range_max_ranges = 2;
+        CPPUNIT_ASSERT(request.add(make_super_chunk(url, 0, 10)));
+        CPPUNIT_ASSERT(request.add(make_super_chunk(url, 100, 10)));
+        CPPUNIT_ASSERT(!request.add(make_super_chunk(url, 200, 10)));
+        DmrppRequestHandler::d_multi_range_max_ranges = max_ranges;
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, request.size());
+    }
+
+    void origin_support_test() {
+        auto url = make_shared<http::url>("https://data.example.com/a/b.h5");
+        auto same_origin = make_shared<http::url>("https://data.example.com/c/d.h5");
+        auto other_origin = make_shared<http::url>("https://s3.example.com/a/b.h5");
+
+        CPPUNIT_ASSERT_EQUAL(string("https://data.example.com"), MultiRangeRequest::origin(url));
+        CPPUNIT_ASSERT(MultiRangeRequest::get_origin_support(url) == MultiRangeRequest::unknown);
+
+        MultiRangeRequest::set_origin_support(url, MultiRangeRequest::unsupported);
+        CPPUNIT_ASSERT(MultiRangeRequest::get_origin_support(same_origin) == MultiRangeRequest::unsupported);
+        CPPUNIT_ASSERT(MultiRangeRequest::get_origin_support(other_origin) == MultiRangeRequest::unknown);
+
+        // Reading does not try an origin that does not support multi-range requests.
+        MultiRangeRequest request(url);
+        CPPUNIT_ASSERT(request.add(make_super_chunk(url, 0, 10)));
+        CPPUNIT_ASSERT(request.add(make_super_chunk(url, 100, 10)));
+        CPPUNIT_ASSERT(!request.read());
+    }
+
+    CPPUNIT_TEST_SUITE( MultiRangeRequestTest );
+
+    CPPUNIT_TEST(get_boundary_test);
+    CPPUNIT_TEST(parse_content_range_test);
+    CPPUNIT_TEST(multipart_test);
+    CPPUNIT_TEST(multipart_pieces_test);
+    CPPUNIT_TEST(multipart_no_final_crlf_test);
+    CPPUNIT_TEST(merged_part_test);
+    CPPUNIT_TEST(single_part_test);
+    CPPUNIT_TEST(missing_range_test);
+    CPPUNIT_TEST(truncated_body_test);
+    CPPUNIT_TEST(not_a_range_response_test);
+    CPPUNIT_TEST(part_without_range_test);
+    CPPUNIT_TEST(long_line_test);
+    CPPUNIT_TEST(range_arg_string_test);
+    CPPUNIT_TEST(add_test);
+    CPPUNIT_TEST(origin_support_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MultiRangeRequestTest);
+
+} // namespace dmrpp
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<dmrpp::MultiRangeRequestTest>(argc, argv, "cerr,dmrpp:multi_range") ? 0 : 1;
+}
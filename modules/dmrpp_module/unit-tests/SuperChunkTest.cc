@@ -315,12 +315,124 @@ public:
         DBG(cerr << prolog << "END" << endl);
     }
 
+    // The child chunks are handed to the handler in order, once each, and
+    // are fully read when that happens.
+    void sc_streaming_test()
+    {
+        DBG(cerr << prolog << "BEGIN" << endl);
+
+        // this_is_a_test.txt is 1106 bytes and contains human readable text chunk content.
+        string url_s = string("file://").append(TEST_DATA_DIR).append("/").append("this_is_a_test.txt");
+        auto data_url(std::make_shared<http::url>(url_s));
+
+        string chunk_position_in_array = "[0]";
+        try {
+            SuperChunk word_this(prolog + "word_this");
+            for (unsigned long long offset = 0; offset < 400; offset += 100)
+                CPPUNIT_ASSERT(word_this.add_chunk(std::make_shared<Chunk>(data_url, "", 100, offset, chunk_position_in_array)));
+
+            char target_this[] = "This";
+            size_t letter_index = 0;
+            word_this.retrieve_data([&](const shared_ptr<Chunk> &chunk) {
+                DBG(cerr << prolog << "Handed chunk at offset " << chunk->get_offset() << endl);
+                CPPUNIT_ASSERT(chunk == word_this.d_chunks.at(letter_index));
+                CPPUNIT_ASSERT(chunk->get_is_read());
+                CPPUNIT_ASSERT(chunk->get_bytes_read() == 100);
+                for (size_t i = 0; i < 100; i++)
+                    CPPUNIT_ASSERT(chunk->get_rbuf()[i] == target_this[letter_index]);
+                letter_index++;
+            });
+
+            CPPUNIT_ASSERT(letter_index == 4);
+        }
+        catch (const BESError &be) {
+            stringstream msg;
+            msg << prolog << "CAUGHT BESError: " << be.get_verbose_message() << endl;
+            cerr << msg.str();
+            CPPUNIT_FAIL(msg.str());
+        }
+        DBG(cerr << prolog << "END" << endl);
+    }
+
+    // Chunks separated by small gaps share a SuperChunk when a gap is allowed.
+    void sc_gap_test()
+    {
+        DBG(cerr << prolog << "BEGIN" << endl);
+
+        // this_is_a_test.txt is 1106 bytes and contains human readable text chunk content.
+        string url_s = string("file://").append(TEST_DATA_DIR).append("/").append("this_is_a_test.txt");
+        auto data_url(std::make_shared<http::url>(url_s));
+
+        string chunk_position_in_array = "[0]";
+        try {
+            SuperChunk words(prolog + "words");
+            CPPUNIT_ASSERT(words.add_chunk(std::make_shared<Chunk>(data_url, "", 100, 0, chunk_position_in_array)));
+            // There is no gap tolerance for local files; set one as if the data were remote.
+            CPPUNIT_ASSERT_EQUAL(0ULL, words.d_max_gap);
+            words.d_max_gap = 2;
+
+            for (unsigned long long offset: {100, 200, 300, 402, 502, 604})
+                CPPUNIT_ASSERT(words.add_chunk(std::make_shared<Chunk>(data_url, "", 100, offset, chunk_position_in_array)));
+            // The gap is too big.
+            CPPUNIT_ASSERT(!words.add_chunk(std::make_shared<Chunk>(data_url, "", 100, 806, chunk_position_in_array)));
+            // A chunk before the end of the SuperChunk.
+            CPPUNIT_ASSERT(!words.add_chunk(std::make_shared<Chunk>(data_url, "", 100, 0, chunk_position_in_array)));
+
+            CPPUNIT_ASSERT_EQUAL(704ULL, words.get_size());
+            CPPUNIT_ASSERT_EQUAL(4ULL, words.get_gap_bytes());
+
+            words.retrieve_data();
+            char target[] = "Thisisa";
+            size_t letter_index = 0;
+            for (const auto &chunk: words.d_chunks) {
+                CPPUNIT_ASSERT(chunk->get_is_read());
+                CPPUNIT_ASSERT(chunk->get_bytes_read() == 100);
+                for (size_t i = 0; i < 100; i++)
+                    CPPUNIT_ASSERT(chunk->get_rbuf()[i] == target[letter_index]);
+                letter_index++;
+            }
+            CPPUNIT_ASSERT(letter_index == 7);
+        }
+        catch (const BESError &be) {
+            stringstream msg;
+            msg << prolog << "CAUGHT BESError: " << be.get_verbose_message() << endl;
+            cerr << msg.str();
+            CPPUNIT_FAIL(msg.str());
+        }
+        DBG(cerr << prolog << "END" << endl);
+    }
+
+    // The gaps may not add up to more than the chunks and the SuperChunk may not exceed the max size.
+    void sc_gap_limits_test()
+    {
+        string url_s = string("https://test.opendap.org/data/this_is_a_test.txt");
+        auto data_url(std::make_shared<http::url>(url_s));
+        string chunk_position_in_array = "[0]";
+
+        SuperChunk sc(prolog + "sc");
+        CPPUNIT_ASSERT(sc.add_chunk(std::make_shared<Chunk>(data_url, "", 10, 0, chunk_position_in_array)));
+        CPPUNIT_ASSERT_EQUAL(DmrppRequestHandler::d_super_chunk_max_gap, sc.d_max_gap);
+
+        // Twenty bytes of gap for twenty bytes of chunks is OK, but not twenty-one.
+        CPPUNIT_ASSERT(!sc.add_chunk(std::make_shared<Chunk>(data_url, "", 10, 31, chunk_position_in_array)));
+        CPPUNIT_ASSERT(sc.add_chunk(std::make_shared<Chunk>(data_url, "", 10, 30, chunk_position_in_array)));
+        CPPUNIT_ASSERT_EQUAL(20ULL, sc.get_gap_bytes());
+
+        sc.d_max_size = 50;
+        CPPUNIT_ASSERT(!sc.add_chunk(std::make_shared<Chunk>(data_url, "", 11, 40, chunk_position_in_array)));
+        CPPUNIT_ASSERT(sc.add_chunk(std::make_shared<Chunk>(data_url, "", 10, 40, chunk_position_in_array)));
+        CPPUNIT_ASSERT_EQUAL(50ULL, sc.get_size());
+    }
+
     CPPUNIT_TEST_SUITE( SuperChunkTest );
 
         CPPUNIT_TEST(empty_test);
         CPPUNIT_TEST(sc_one_chunk_test);
         CPPUNIT_TEST(sc_chunks_test_01);
         CPPUNIT_TEST(sc_chunks_test_02);
+        CPPUNIT_TEST(sc_streaming_test);
+        CPPUNIT_TEST(sc_gap_test);
+        CPPUNIT_TEST(sc_gap_limits_test);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -35,6 +35,7 @@
 #include <cstring>
 
 #include <netcdf.h>
+#include <zlib.h>
 
 #include <libdap/Array.h>
 #include <libdap/AttrTable.h>
@@ -69,6 +70,9 @@ const int GENERAL_MAX_CHUNK_SIZES = 1048576;
 // set normal 1-D maximum chunk sizes to 64K(64*1024)
 const int NORMAL_1D_MAX_CHUNK_SIZES = 65536;
 
+// The deflate level used when FONc.UseCompression is true
+const int DEFLATE_LEVEL = 4;
+
 /** @brief Constructor for FONcArray that takes a DAP Array
  *
  * This constructor takes a DAP BaseType and makes sure that it is a DAP
@@ -681,9 +685,13 @@ void FONcArray::define(int ncid) {
                 define_dio_filters(ncid, d_varid);     
             }
             else {
+                d_precompress = can_precompress();
                 if (FONcRequestHandler::chunk_size == 0)
                     // I have no idea if chunksizes is needed in this case.
                     stax = nc_def_var_chunking(ncid, d_varid, NC_CONTIGUOUS, d_chunksizes.data());
+                else if (d_precompress)
+                    // read_ahead() compresses the chunks; they are written like the direct IO chunks.
+                    stax = nc_def_var_chunking_direct_write(ncid, d_varid, NC_CHUNKED, d_chunksizes.data());
                 else
                     stax = nc_def_var_chunking(ncid, d_varid, NC_CHUNKED, d_chunksizes.data());
     
@@ -697,17 +705,9 @@ void FONcArray::define(int ncid) {
                 // The following code provides a way how to use shuffle. KY 11/2/23
                 if (FONcRequestHandler::use_compression) {
     
-                    int shuffle = 0;
-                    // For integer, if the type size is >= 2, turn on the shuffle key always.
-                    // For other types, turn off the shuffle key by default.
-                    if (NC_SHORT == d_array_type || NC_USHORT == d_array_type || NC_INT == d_array_type ||
-                        NC_UINT == d_array_type || NC_INT64 == d_array_type || NC_UINT64 == d_array_type ||
-                        FONcRequestHandler::use_shuffle)                
-                        shuffle = 1;
-                    
+                    int shuffle = use_shuffle_filter() ? 1 : 0;
                     int deflate = 1;
-                    int deflate_level = 4;
-                    stax = nc_def_var_deflate(ncid, d_varid, shuffle, deflate, deflate_level);
+                    stax = nc_def_var_deflate(ncid, d_varid, shuffle, deflate, DEFLATE_LEVEL);
     
                     if (stax != NC_NOERR) {
                         string err = (string) "fileout.netcdf - Failed to define compression (deflate) level for variable "
@@ -752,6 +752,13 @@ void FONcArray::define(int ncid) {
  */
 void FONcArray::write_nc_variable(int ncid, nc_type var_type) {
 
+    if (d_precompress) {
+        // Read and compress the data unless a worker thread has already done it.
+        read_ahead();
+        write_compressed_chunks(ncid);
+        return;
+    }
+
     // Note: when fdio_flag is not true, the intern_data needs to be called here.
     // FIXME Patch for HYRAX-1334 jhrg 2/14/24
     if (d_is_dap4 || get_eval() == nullptr || get_dds() == nullptr)
@@ -1339,4 +1346,186 @@ void FONcArray::write_direct_io_data(int ncid, int d_varid) {
  
 }
 
+// For integer, if the type size is >= 2, turn on the shuffle key always.
+// For other types, turn off the shuffle key by default.
+bool FONcArray::use_shuffle_filter() const {
+    return NC_SHORT == d_array_type || NC_USHORT == d_array_type || NC_INT == d_array_type ||
+           NC_UINT == d_array_type || NC_INT64 == d_array_type || NC_UINT64 == d_array_type ||
+           FONcRequestHandler::use_shuffle;
+}
 
+// Can read_ahead() compress the data? Only when it runs on a worker thread
+// and the data are written to the netCDF-4 enhanced model as they are read.
+bool FONcArray::can_precompress() {
+    if (!get_read_on_worker() || !FONcRequestHandler::use_compression
+        || FONcRequestHandler::chunk_size == 0 || !isNetCDF4_ENHANCED())
+        return false;
+
+    if (d_nelements == 0 || d_chunksizes.size() != d_dim_sizes.size())
+        return false;
+
+    switch (d_array_type) {
+        case NC_BYTE:
+        case NC_UBYTE:
+        case NC_SHORT:
+        case NC_USHORT:
+        case NC_INT:
+        case NC_UINT:
+        case NC_INT64:
+        case NC_UINT64:
+        case NC_FLOAT:
+        case NC_DOUBLE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Read the array's data before it is written
+ *
+ * If the array will be compressed, split the data into chunks and shuffle
+ * and deflate them the way the netCDF-4 library would, then free the data.
+ * Nothing here calls the netCDF library. The data handler's read() is
+ * called, so FONcTransform runs this on a worker thread only for DMR++
+ * containers.
+ */
+void FONcArray::read_ahead() {
+    // String data are read in convert().
+    if (d_dont_use_it || d_array_type == NC_CHAR || d_chunks_ready)
+        return;
+
+    if (d_is_dap4 || get_eval() == nullptr || get_dds() == nullptr)
+        d_a->intern_data();
+    else
+        d_a->intern_data(*get_eval(), *get_dds());
+
+    if (d_precompress) {
+        compress_chunks();
+        d_a->clear_local_data();
+        d_chunks_ready = true;
+    }
+}
+
+// Step 'index' through [0, limit) by 'step' in the first n dimensions, the
+// last of them fastest. Returns false after the last index.
+static bool next_index(vector<size_t> &index, const vector<size_t> &limit, const vector<size_t> &step, size_t n) {
+    for (size_t i = n; i > 0; --i) {
+        index[i - 1] += step[i - 1];
+        if (index[i - 1] < limit[i - 1])
+            return true;
+        index[i - 1] = 0;
+    }
+    return false;
+}
+
+// Copy each chunk out of the row-major data. Edge chunks are padded to the
+// full chunk size, as HDF5 stores them.
+void FONcArray::compress_chunks() {
+    size_t width = 0;
+    switch (d_array_type) {
+        case NC_BYTE:
+        case NC_UBYTE:
+            width = 1;
+            break;
+        case NC_SHORT:
+        case NC_USHORT:
+            width = 2;
+            break;
+        case NC_INT:
+        case NC_UINT:
+        case NC_FLOAT:
+            width = 4;
+            break;
+        default:
+            width = 8;
+            break;
+    }
+
+    const size_t rank = d_dim_sizes.size();
+    const char *data = d_a->get_buf();
+
+    size_t chunk_elements = 1;
+    for (auto size: d_chunksizes)
+        chunk_elements *= size;
+
+    // Offset, in elements, of a step in each dimension of the data and of a chunk
+    vector<size_t> data_stride(rank, 1);
+    vector<size_t> chunk_stride(rank, 1);
+    for (size_t i = rank - 1; i > 0; --i) {
+        data_stride[i - 1] = data_stride[i] * d_dim_sizes[i];
+        chunk_stride[i - 1] = chunk_stride[i] * d_chunksizes[i];
+    }
+
+    const vector<size_t> ones(rank, 1);
+    const bool shuffle = use_shuffle_filter() && width > 1;
+    vector<char> chunk(chunk_elements * width);
+    vector<char> shuffled(shuffle ? chunk.size() : 0);
+
+    d_chunks.clear();
+    vector<size_t> coords(rank, 0);
+    do {
+        fill(chunk.begin(), chunk.end(), 0);
+
+        // Copy the chunk one row (a run along the last dimension) at a time.
+        vector<size_t> extent(rank);
+        for (size_t i = 0; i < rank; ++i)
+            extent[i] = min(d_chunksizes[i], d_dim_sizes[i] - coords[i]);
+
+        vector<size_t> pos(rank, 0);
+        do {
+            size_t src = 0;
+            size_t dest = 0;
+            for (size_t i = 0; i < rank; ++i) {
+                src += (coords[i] + pos[i]) * data_stride[i];
+                dest += pos[i] * chunk_stride[i];
+            }
+            memcpy(chunk.data() + dest * width, data + src * width, extent[rank - 1] * width);
+        } while (next_index(pos, extent, ones, rank - 1));
+
+        const char *src = chunk.data();
+        if (shuffle) {
+            for (size_t e = 0; e < chunk_elements; ++e)
+                for (size_t b = 0; b < width; ++b)
+                    shuffled[b * chunk_elements + e] = chunk[e * width + b];
+            src = shuffled.data();
+        }
+
+        uLongf compressed_size = compressBound(chunk.size());
+        Chunk compressed;
+        compressed.coords = coords;
+        compressed.data.resize(compressed_size);
+        int status = compress2(reinterpret_cast<Bytef *>(compressed.data.data()), &compressed_size,
+                               reinterpret_cast<const Bytef *>(src), chunk.size(), DEFLATE_LEVEL);
+        if (status != Z_OK)
+            throw BESInternalError("fileout.netcdf - Failed to compress the data of variable " + d_varname,
+                                   __FILE__, __LINE__);
+        compressed.data.resize(compressed_size);
+        d_chunks.push_back(std::move(compressed));
+    } while (next_index(coords, d_dim_sizes, d_chunksizes, rank));
+}
+
+// Write the chunks made by compress_chunks().
+void FONcArray::write_compressed_chunks(int ncid) {
+
+    BESDEBUG("fonc", "FONcArray::write_compressed_chunks() - " << d_varname << ", " << d_chunks.size() << " chunks" << endl);
+
+    // As for the direct IO data, this sets up the variable to have its chunks written.
+    char dummy_buffer[1];
+    int stax = nc_put_var(ncid, d_varid, dummy_buffer);
+    if (stax != NC_NOERR) {
+        string err = "fileout.netcdf - the direct IO version of nc_put_var error for variable " + d_varname;
+        FONcUtils::handle_error(stax, err, __FILE__, __LINE__);
+    }
+
+    for (auto &chunk: d_chunks) {
+        stax = nc4_write_chunk(ncid, d_varid, 0, chunk.coords.size(), chunk.coords.data(), chunk.data.size(),
+                               chunk.data.data());
+        if (stax != NC_NOERR) {
+            string err = "fileout.netcdf - nc4_write_chunk error for variable " + d_varname;
+            FONcUtils::handle_error(stax, err, __FILE__, __LINE__);
+        }
+    }
+
+    d_chunks.clear();
+}
@@ -100,6 +100,16 @@ private:
     // if DAP4 dim. is defined
     bool d4_def_dim = false;
 
+    // The data are deflated into chunks by read_ahead() and written with
+    // nc4_write_chunk(), so the compression can run on a worker thread.
+    bool d_precompress = false;
+    struct Chunk {
+        std::vector<size_t> coords;
+        std::vector<char> data;
+    };
+    std::vector<Chunk> d_chunks{};
+    bool d_chunks_ready = false;
+
 #if 0
     // direct io flag, used in the define mode,the default is false. It should be set to true when direct io is supported.
     // TODO: This is for the temporary memory usage optimization. Once we can support the define() with or without dio for individual array.
@@ -123,6 +133,11 @@ private:
     void allocate_dio_nc4_def_filters(int, int, bool ,bool , bool , bool , bool, const vector<unsigned int> &) const; 
     void write_direct_io_data(int, int);
 
+    bool use_shuffle_filter() const;
+    bool can_precompress();
+    void compress_chunks();
+    void write_compressed_chunks(int ncid);
+
     FONcArray() = default;      // Used in some unit tests
     friend class FONcArrayTest;
 
@@ -135,6 +150,7 @@ public:
     virtual void convert(std::vector<std::string> embed, bool _dap4=false, bool is_dap4_group=false) override;
     virtual void define(int ncid) override;
     virtual void write(int ncid) override;
+    virtual void read_ahead() override;
 
     std::string name() override;
 
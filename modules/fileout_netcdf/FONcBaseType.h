@@ -81,6 +81,9 @@ protected:
     //       This flag is not necessary and should be removed. KY 11/29/23
     bool fdio_flag = false;
 
+    // FONcTransform will call read_ahead() on a worker thread.
+    bool d_read_on_worker = false;
+
 
 public:
     FONcBaseType() = default;
@@ -106,6 +109,12 @@ public:
 
     virtual void write(int ncid) = 0;
 
+    // Read the data ahead of write(). If get_read_on_worker() is true,
+    // FONcTransform calls this on a worker thread while other variables are
+    // written, so it must not call netCDF. It does call the data handler's
+    // read(); FONcTransform only uses workers for handlers that allow that.
+    virtual void read_ahead() { }
+
     virtual std::string name() = 0;
 
     virtual nc_type type();
@@ -129,6 +138,9 @@ public:
     bool get_fdio_flag() const {return fdio_flag; }
     void set_fdio_flag(bool dio_flag_value = true) { fdio_flag = dio_flag_value; }
 
+    bool get_read_on_worker() const { return d_read_on_worker; }
+    void set_read_on_worker(bool read_on_worker = true) { d_read_on_worker = read_on_worker; }
+
 };
 
 #endif // FONcBaseType_h_
@@ -43,6 +43,12 @@
 #define FONC_NC3_CLASSIC_FORMAT false
 #define FONC_NC3_CLASSIC_FORMAT_KEY "FONc.NC3ClassicFormat"
 
+// With more than one, the DAP4 responses built from DMR++ containers read
+// the following variables on worker threads while a variable is written.
+#define FONC_READ_THREADS 1
+#define FONC_READ_THREADS_KEY "FONc.ReadThreads"
+#define FONC_MAX_READ_THREADS 16
+
 #define FONC_RETURN_AS_NETCDF3 "netcdf"
 #define FONC_RETURN_AS_NETCDF4 "netcdf-4"
 #define FONC_NC4_CLASSIC_MODEL "NC4_CLASSIC_MODEL"
@@ -0,0 +1,86 @@
+// FONcReadAhead.cc
+
+// This file is part of BES Netcdf File Out Module
+
+// Copyright (c) 2004,2005 University Corporation for Atmospheric Research
+// Author: Patrick West <pwest@ucar.edu> and Jose Garcia <jgarcia@ucar.edu>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact University Corporation for Atmospheric Research at
+// 3080 Center Green Drive, Boulder, CO 80301
+
+// (c) COPYRIGHT University Corporation for Atmospheric Research 2004-2005
+// Please read the full copyright statement in the file COPYRIGHT_UCAR.
+
+#include "config.h"
+
+#include <algorithm>
+#include <system_error>
+
+#include <BESDebug.h>
+
+#include "FONcBaseType.h"
+#include "FONcReadAhead.h"
+
+using namespace std;
+
+#define MODULE "fonc"
+#define prolog string("FONcReadAhead::").append(__func__).append("() - ")
+
+/** @brief Build a read-ahead for the variables of a response
+ *
+ * @param vars The variables, in the order they will be written. The vector
+ * must outlive this object.
+ * @param threads Read at most this many variables at once
+ */
+FONcReadAhead::FONcReadAhead(const vector<FONcBaseType *> &vars, size_t threads) : d_vars(vars), d_threads(threads)
+{
+    if (d_threads > 1)
+        d_reads.reserve(d_vars.size());
+}
+
+// The future of each read started with std::async waits for it when the
+// future is destroyed, so no thread is left using a variable after an error.
+FONcReadAhead::~FONcReadAhead() = default;
+
+/** @brief Wait until variable i has been read and start reading the next ones
+ *
+ * @param i Index of the variable about to be written
+ * @exception Rethrows the exception thrown while reading the variable
+ */
+void FONcReadAhead::wait(size_t i)
+{
+    if (d_threads <= 1)
+        return;
+
+    const size_t last = min(d_vars.size(), i + d_threads);
+    while (d_reads.size() < last) {
+        FONcBaseType *fbt = d_vars[d_reads.size()];
+        try {
+            d_reads.emplace_back(async(launch::async, [fbt]() { fbt->read_ahead(); }));
+        }
+        catch (const system_error &e) {
+            // write() reads the variable instead.
+            BESDEBUG(MODULE, prolog << "Could not start reading " << fbt->name() << ": " << e.what() << endl);
+            d_reads.emplace_back();
+        }
+    }
+
+    if (i < d_reads.size() && d_reads[i].valid()) {
+        BESDEBUG(MODULE, prolog << "Waiting for " << d_vars[i]->name() << endl);
+        d_reads[i].get();
+    }
+}
@@ -0,0 +1,66 @@
+// FONcReadAhead.h
+
+// This file is part of BES Netcdf File Out Module
+
+// Copyright (c) 2004,2005 University Corporation for Atmospheric Research
+// Author: Patrick West <pwest@ucar.edu> and Jose Garcia <jgarcia@ucar.edu>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact University Corporation for Atmospheric Research at
+// 3080 Center Green Drive, Boulder, CO 80301
+
+// (c) COPYRIGHT University Corporation for Atmospheric Research 2004-2005
+// Please read the full copyright statement in the file COPYRIGHT_UCAR.
+
+#ifndef FONcReadAhead_h_
+#define FONcReadAhead_h_ 1
+
+#include <future>
+#include <vector>
+
+class FONcBaseType;
+
+/** @brief Read variables on worker threads while earlier ones are written
+ *
+ * The netCDF library is not thread safe, so the variables are still written
+ * one at a time, on the calling thread. Before writing variable i, call
+ * wait(i): it starts FONcBaseType::read_ahead() for the variables after i, up
+ * to the number of threads, and returns once variable i has been read.
+ * Reading, and for compressed netCDF-4 arrays the compression, of the next
+ * variables then overlaps the writing of this one.
+ *
+ * read_ahead() calls the data handler's read() on the worker threads. Only
+ * use more than one thread when the handler's read() is thread safe; see
+ * FONcTransform::read_threads(). With one thread nothing is read ahead and
+ * write() reads each variable.
+ */
+class FONcReadAhead {
+private:
+    const std::vector<FONcBaseType *> &d_vars;
+    size_t d_threads;
+    std::vector<std::future<void>> d_reads;
+
+public:
+    FONcReadAhead(const std::vector<FONcBaseType *> &vars, size_t threads);
+    virtual ~FONcReadAhead();
+
+    FONcReadAhead(const FONcReadAhead &) = delete;
+    FONcReadAhead &operator=(const FONcReadAhead &) = delete;
+
+    void wait(size_t i);
+};
+
+#endif // FONcReadAhead_h_
@@ -42,6 +42,7 @@
 #include <BESDataNames.h>
 #include <TheBESKeys.h>
 #include <BESDebug.h>
+#include <BESLog.h>
 #include <BESUtil.h>
 
 #include "FONcRequestHandler.h"
@@ -57,6 +58,7 @@ bool FONcRequestHandler::reduce_dim;
 bool FONcRequestHandler::no_global_attrs;
 unsigned long long FONcRequestHandler::request_max_size_kb;
 bool FONcRequestHandler::nc3_classic_format;
+size_t FONcRequestHandler::read_threads;
 
 using namespace std;
 
@@ -171,6 +173,15 @@ FONcRequestHandler::FONcRequestHandler( const string &name )
 
     read_key_value(FONC_NC3_CLASSIC_FORMAT_KEY, FONcRequestHandler::nc3_classic_format, FONC_NC3_CLASSIC_FORMAT);
 
+    read_key_value(FONC_READ_THREADS_KEY, FONcRequestHandler::read_threads, FONC_READ_THREADS);
+    if (FONcRequestHandler::read_threads == 0 || FONcRequestHandler::read_threads > FONC_MAX_READ_THREADS) {
+        // A negative value reads as a very large size_t.
+        size_t threads = FONcRequestHandler::read_threads == 0 ? 1 : FONC_MAX_READ_THREADS;
+        INFO_LOG(string(FONC_READ_THREADS_KEY) + " must be between 1 and " + to_string(FONC_MAX_READ_THREADS)
+                 + "; using " + to_string(threads));
+        FONcRequestHandler::read_threads = threads;
+    }
+
     BESDEBUG("fonc", "FONcRequestHandler::temp_dir: " << FONcRequestHandler::temp_dir << endl);
     BESDEBUG("fonc", "FONcRequestHandler::byte_to_short: " << FONcRequestHandler::byte_to_short << endl);
     BESDEBUG("fonc", "FONcRequestHandler::use_compression: " << FONcRequestHandler::use_compression << endl);
@@ -181,6 +192,7 @@ FONcRequestHandler::FONcRequestHandler( const string &name )
     BESDEBUG("fonc", "FONcRequestHandler::turn_off_global_attrs: " << FONcRequestHandler::no_global_attrs << endl);
     BESDEBUG("fonc", "FONcRequestHandler::request_max_size_kb: " << FONcRequestHandler::request_max_size_kb << endl);
     BESDEBUG("fonc", "FONcRequestHandler::nc3_classic_format " << FONcRequestHandler::nc3_classic_format << endl);
+    BESDEBUG("fonc", "FONcRequestHandler::read_threads " << FONcRequestHandler::read_threads << endl);
 }
 
 /** @brief Any cleanup that needs to take place
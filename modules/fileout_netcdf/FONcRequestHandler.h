@@ -59,6 +59,7 @@ public:
     static bool no_global_attrs;
     static unsigned long long request_max_size_kb;
     static bool nc3_classic_format;
+    static size_t read_threads;
 
     static bool build_help(BESDataHandlerInterface &dhi);
     static bool build_version(BESDataHandlerInterface &dhi);
@@ -0,0 +1,318 @@
+// FONcStreamWriter.cc
+
+// This file is part of BES Netcdf File Out Module
+
+// Copyright (c) 2004,2005 University Corporation for Atmospheric Research
+// Author: Patrick West <pwest@ucar.edu> and Jose Garcia <jgarcia@ucar.edu>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact University Corporation for Atmospheric Research at
+// 3080 Center Green Drive, Boulder, CO 80301
+
+// (c) COPYRIGHT University Corporation for Atmospheric Research 2004-2005
+// Please read the full copyright statement in the file COPYRIGHT_UCAR.
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <netcdf.h>
+
+#include <BESDebug.h>
+#include <BESInternalError.h>
+
+#include "FONcStreamWriter.h"
+#include "FONcUtils.h"
+
+using namespace std;
+
+#define MODULE "fonc"
+#define prolog string("FONcStreamWriter::").append(__func__).append("() - ")
+
+namespace {
+
+const size_t block_size = 1024 * 1024;
+
+// Tags and sizes from the netCDF classic format specification.
+const uint32_t NC_DIMENSION_TAG = 0x0A;
+const uint32_t NC_VARIABLE_TAG = 0x0B;
+const uint32_t NC_ATTRIBUTE_TAG = 0x0C;
+
+uint64_t type_size(uint32_t type)
+{
+    switch (type) {
+        case NC_BYTE:
+        case NC_CHAR:
+            return 1;
+        case NC_SHORT:
+            return 2;
+        case NC_INT:
+        case NC_FLOAT:
+            return 4;
+        case NC_DOUBLE:
+            return 8;
+        default:
+            return 0;   // Not a classic type
+    }
+}
+
+uint64_t pad4(uint64_t n)
+{
+    return (n + 3) & ~static_cast<uint64_t>(3);
+}
+
+// Read the big-endian header of a netCDF-3 file.
+class HeaderReader {
+    int d_fd;
+    vector<unsigned char> d_buf;
+    uint64_t d_buf_start = 0;   // File offset of d_buf[0]
+    uint64_t d_pos = 0;         // File offset of the next byte
+
+    const unsigned char *get(uint64_t n) {
+        if (d_pos < d_buf_start || d_pos + n > d_buf_start + d_buf.size()) {
+            d_buf.resize(max<uint64_t>(n, block_size));
+            ssize_t bytes = pread(d_fd, d_buf.data(), d_buf.size(), static_cast<off_t>(d_pos));
+            if (bytes < 0)
+                throw BESInternalError(prolog + "Could not read the netCDF header: " + strerror(errno), __FILE__, __LINE__);
+            d_buf.resize(bytes);
+            d_buf_start = d_pos;
+            if (static_cast<uint64_t>(bytes) < n)
+                throw BESInternalError(prolog + "The netCDF header is truncated.", __FILE__, __LINE__);
+        }
+        const unsigned char *p = d_buf.data() + (d_pos - d_buf_start);
+        d_pos += n;
+        return p;
+    }
+
+public:
+    explicit HeaderReader(int fd) : d_fd(fd) { }
+
+    uint64_t pos() const { return d_pos; }
+
+    uint32_t u32() {
+        const unsigned char *p = get(4);
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+
+    uint64_t u64() {
+        uint64_t hi = u32();
+        return (hi << 32) | u32();
+    }
+
+    void skip(uint64_t n) { d_pos += n; }
+
+    // A name is its length followed by its characters, padded to four bytes.
+    void skip_name() { skip(pad4(u32())); }
+
+    // Returns false if the list holds something that is not a classic type.
+    bool skip_attributes() {
+        uint32_t tag = u32();
+        uint32_t nelems = u32();
+        if (tag != NC_ATTRIBUTE_TAG && !(tag == 0 && nelems == 0))
+            throw BESInternalError(prolog + "Malformed attribute list in the netCDF header.", __FILE__, __LINE__);
+        for (uint32_t i = 0; i < nelems; ++i) {
+            skip_name();
+            uint64_t size = type_size(u32());
+            if (size == 0)
+                return false;
+            skip(pad4(size * u32()));
+        }
+        return true;
+    }
+};
+
+}
+
+/** @brief Build a writer for a NetCDF-3 file
+ *
+ * @param filename The file the netCDF library is writing
+ * @param strm Send the file here
+ */
+FONcStreamWriter::FONcStreamWriter(const string &filename, ostream &strm) : d_filename(filename), d_strm(strm)
+{
+    d_fd = open(d_filename.c_str(), O_RDWR);
+    if (d_fd == -1)
+        throw BESInternalError(prolog + "Could not open " + d_filename + ": " + strerror(errno), __FILE__, __LINE__);
+}
+
+FONcStreamWriter::~FONcStreamWriter()
+{
+    close(d_fd);
+}
+
+/** @brief Send the header
+ *
+ * Call this after nc_enddef() and before any data are written.
+ *
+ * @param ncid The open file
+ * @return False if the file cannot be streamed. Nothing has been sent and
+ * the file should be sent once it is complete.
+ */
+bool FONcStreamWriter::start(int ncid)
+{
+    int stax = nc_sync(ncid);
+    if (stax != NC_NOERR)
+        FONcUtils::handle_error(stax, prolog + "Unable to sync " + d_filename, __FILE__, __LINE__);
+
+    if (!read_layout())
+        return false;
+
+    send_to(d_var_begin.empty() ? d_data_end : d_var_begin.front());
+
+    BESDEBUG(MODULE, prolog << "Sent the header, bytes_sent: " << d_bytes_sent << endl);
+    return true;
+}
+
+/** @brief Send the data of the variables that have been written
+ *
+ * @param ncid The open file
+ * @param nvars The variables with varids less than this have been written
+ */
+void FONcStreamWriter::send_vars(int ncid, int nvars)
+{
+    int stax = nc_sync(ncid);
+    if (stax != NC_NOERR)
+        FONcUtils::handle_error(stax, prolog + "Unable to sync " + d_filename, __FILE__, __LINE__);
+
+    if (nvars < 0 || static_cast<size_t>(nvars) >= d_var_begin.size())
+        send_to(d_data_end);
+    else
+        send_to(d_var_begin[nvars]);
+
+    BESDEBUG(MODULE, prolog << "Sent " << nvars << " variables, bytes_sent: " << d_bytes_sent << endl);
+}
+
+/** @brief Send whatever is left; call this after nc_close() */
+void FONcStreamWriter::finish()
+{
+    send_to(d_data_end);
+}
+
+// Read the variables' offsets from the header. Returns false if the file is
+// not a classic or 64-bit offset file without record variables.
+bool FONcStreamWriter::read_layout()
+{
+    HeaderReader header(d_fd);
+
+    uint32_t magic = header.u32();
+    uint32_t version = magic & 0xFF;
+    if ((magic >> 8) != 0x434446 /* CDF */ || (version != 1 && version != 2)) {
+        BESDEBUG(MODULE, prolog << d_filename << " is not a classic or 64-bit offset file" << endl);
+        return false;
+    }
+
+    (void) header.u32();    // numrecs
+
+    vector<uint64_t> dim_sizes;
+    uint32_t tag = header.u32();
+    uint32_t nelems = header.u32();
+    if (tag != NC_DIMENSION_TAG && !(tag == 0 && nelems == 0))
+        throw BESInternalError(prolog + "Malformed dimension list in the netCDF header.", __FILE__, __LINE__);
+    for (uint32_t i = 0; i < nelems; ++i) {
+        header.skip_name();
+        uint32_t size = header.u32();
+        if (size == 0) {
+            BESDEBUG(MODULE, prolog << d_filename << " has an unlimited dimension" << endl);
+            return false;
+        }
+        dim_sizes.push_back(size);
+    }
+
+    if (!header.skip_attributes())
+        return false;
+
+    tag = header.u32();
+    nelems = header.u32();
+    if (tag != NC_VARIABLE_TAG && !(tag == 0 && nelems == 0))
+        throw BESInternalError(prolog + "Malformed variable list in the netCDF header.", __FILE__, __LINE__);
+
+    uint64_t last_size = 0;
+    for (uint32_t i = 0; i < nelems; ++i) {
+        header.skip_name();
+        uint64_t nvalues = 1;
+        uint32_t ndims = header.u32();
+        for (uint32_t d = 0; d < ndims; ++d) {
+            uint32_t dimid = header.u32();
+            if (dimid >= dim_sizes.size())
+                throw BESInternalError(prolog + "Bad dimension id in the netCDF header.", __FILE__, __LINE__);
+            nvalues *= dim_sizes[dimid];
+        }
+        if (!header.skip_attributes())
+            return false;
+        uint64_t size = type_size(header.u32());
+        if (size == 0)
+            return false;
+        (void) header.u32();    // vsize; it saturates for large variables, so compute it
+        uint64_t begin = (version == 1) ? header.u32() : header.u64();
+
+        if (!d_var_begin.empty() && begin < d_var_begin.back())
+            throw BESInternalError(prolog + "The variables in the netCDF file are not in order.", __FILE__, __LINE__);
+
+        d_var_begin.push_back(begin);
+        last_size = pad4(nvalues * size);
+    }
+
+    d_data_end = d_var_begin.empty() ? header.pos() : d_var_begin.back() + last_size;
+
+    return true;
+}
+
+// Send the file from where the last call stopped up to 'end'. The netCDF
+// library does not write the padding between variables when fill mode is
+// off, so bytes past the end of the file are sent as zeros.
+void FONcStreamWriter::send_to(uint64_t end)
+{
+    const uint64_t begin = d_bytes_sent;
+    vector<char> buf(min<uint64_t>(block_size, end > begin ? end - begin : 0));
+
+    while (d_bytes_sent < end) {
+        size_t n = min<uint64_t>(buf.size(), end - d_bytes_sent);
+        ssize_t bytes = pread(d_fd, buf.data(), n, static_cast<off_t>(d_bytes_sent));
+        if (bytes < 0)
+            throw BESInternalError(prolog + "Could not read " + d_filename + ": " + strerror(errno), __FILE__, __LINE__);
+        if (static_cast<size_t>(bytes) < n)
+            memset(buf.data() + bytes, 0, n - bytes);
+
+        d_strm.write(buf.data(), n);
+        if (!d_strm)
+            throw BESInternalError(prolog + "Could not write the response to the output stream.", __FILE__, __LINE__);
+        d_bytes_sent += n;
+    }
+    d_strm.flush();
+
+    release(begin, d_bytes_sent);
+}
+
+// Give the disk space of a range that has been sent back to the file system.
+// If the netCDF library later rewrites part of the range while writing the
+// next variable, it only changes bytes that will not be sent again.
+void FONcStreamWriter::release(uint64_t begin, uint64_t end) const
+{
+#ifdef FALLOC_FL_PUNCH_HOLE
+    if (end > begin && fallocate(d_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(begin),
+                                 static_cast<off_t>(end - begin)) != 0) {
+        BESDEBUG(MODULE, prolog << "Could not release the space used by " << d_filename << ": " << strerror(errno) << endl);
+    }
+#else
+    (void) begin;
+    (void) end;
+#endif
+}
@@ -0,0 +1,82 @@
+// FONcStreamWriter.h
+
+// This file is part of BES Netcdf File Out Module
+
+// Copyright (c) 2004,2005 University Corporation for Atmospheric Research
+// Author: Patrick West <pwest@ucar.edu> and Jose Garcia <jgarcia@ucar.edu>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact University Corporation for Atmospheric Research at
+// 3080 Center Green Drive, Boulder, CO 80301
+
+// (c) COPYRIGHT University Corporation for Atmospheric Research 2004-2005
+// Please read the full copyright statement in the file COPYRIGHT_UCAR.
+
+#ifndef FONcStreamWriter_h_
+#define FONcStreamWriter_h_ 1
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** @brief Stream a NetCDF-3 response while it is being written
+ *
+ * The classic and 64-bit offset formats put a header, which holds the
+ * offset of every variable, in front of the variables' data. Once
+ * nc_enddef() has been called, the header does not change and each
+ * (non-record) variable's data occupies a fixed range of the file. This
+ * class reads that layout from the file, sends the header to the client
+ * and then sends each variable's data as soon as it has been written.
+ *
+ * The netCDF library still encodes everything, so the temporary file is
+ * used as a window: once a range has been sent its disk space is released
+ * (on file systems that support hole punching), and a response needs only
+ * about as much scratch space as its largest variable.
+ *
+ * Files with record variables cannot be streamed because the number of
+ * records in the header changes as the data are written; start() returns
+ * false for those and nothing is sent.
+ */
+class FONcStreamWriter {
+private:
+    std::string d_filename;
+    std::ostream &d_strm;
+    int d_fd = -1;
+
+    std::vector<uint64_t> d_var_begin;  // Offset of each variable's data, by varid
+    uint64_t d_data_end = 0;            // The end of the last variable's data
+    uint64_t d_bytes_sent = 0;
+
+    bool read_layout();
+    void send_to(uint64_t end);
+    void release(uint64_t begin, uint64_t end) const;
+
+public:
+    FONcStreamWriter(const std::string &filename, std::ostream &strm);
+    virtual ~FONcStreamWriter();
+
+    FONcStreamWriter(const FONcStreamWriter &) = delete;
+    FONcStreamWriter &operator=(const FONcStreamWriter &) = delete;
+
+    bool start(int ncid);
+    void send_vars(int ncid, int nvars);
+    void finish();
+
+    uint64_t bytes_sent() const { return d_bytes_sent; }
+};
+
+#endif // FONcStreamWriter_h_
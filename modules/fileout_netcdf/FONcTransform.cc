@@ -34,6 +34,7 @@
 #include "config.h"
 
 #include <sstream>
+#include <memory>
 
 #include <netcdf.h>
 
@@ -73,6 +74,8 @@
 #include "FONcBaseType.h"
 #include "FONcAttributes.h"
 #include "FONcTransmitter.h"
+#include "FONcStreamWriter.h"
+#include "FONcReadAhead.h"
 #include "history_utils.h"
 #include "FONcNames.h"
 
@@ -120,6 +123,33 @@ FONcTransform::FONcTransform(BESResponseObject *obj, BESDataHandlerInterface *dh
     else {
         FONcUtils::name_prefix = "nc_";
     }
+
+    d_read_threads = read_threads();
+}
+
+/** @brief How many variables of a DAP4 response to read at once
+ *
+ * The read-ahead calls each variable's read() on a worker thread. Most data
+ * handlers read with libraries that are not thread safe (netCDF, HDF4, HDF5
+ * built without thread safety), so FONc.ReadThreads is used only when every
+ * container is a DMR++. Otherwise the variables are read one at a time, when
+ * they are written.
+ *
+ * @return FONc.ReadThreads or 1
+ */
+size_t FONcTransform::read_threads() const {
+    if (FONcRequestHandler::read_threads <= 1)
+        return 1;
+
+    for (auto container: d_dhi->containers) {
+        if (container->get_container_type() != "dmrpp") {
+            BESDEBUG(MODULE, prolog << "Container type " << container->get_container_type()
+                                    << " is not read in parallel; reading serially." << endl);
+            return 1;
+        }
+    }
+
+    return d_dhi->containers.empty() ? 1 : FONcRequestHandler::read_threads;
 }
 
 /** @brief Destructor
@@ -443,9 +473,13 @@ void FONcTransform::transform_dap2(ostream &strm) {
         // For each converted FONc object, call define on it to define
         // that object to the netcdf file. This also adds the attributes
         // for the variables to the netcdf file
+        // Record how many netCDF variables have been defined after each
+        // object so the streaming writer knows which data are complete.
+        vector<int> nc_vars_defined;
         for (FONcBaseType *fbt: _fonc_vars) {
             BESDEBUG(MODULE,  prolog << "Defining variable:  " << fbt->name() << endl);
             fbt->define(_ncid);
+            nc_vars_defined.push_back(defined_nc_vars());
         }
 
         if (FONcRequestHandler::no_global_attrs == false) {
@@ -473,46 +507,29 @@ void FONcTransform::transform_dap2(ostream &strm) {
                                     __LINE__);
         }
         // write file data
-        uint64_t bytes_written = 0;
-
-        if (is_streamable()) {
-            // Verify the request hasn't exceeded bes_timeout.
-            RequestServiceTimer::TheTimer()->throw_if_timeout_expired(prolog +"ERROR: bes-timeout expired before transmitting data.", __FILE__, __LINE__);
-
-            // Now that we are ready to start streaming the response data we
-            // cancel any pending timeout alarm according to the configuration.
-            BESUtil::conditional_timeout_cancel();
-
-            bytes_written += BESUtil::file_to_stream(_localfile, strm, bytes_written);
-            BESDEBUG(MODULE,  prolog << "First write data to stream, bytes_written:  " << bytes_written << endl);
-        }
+        unique_ptr<FONcStreamWriter> writer = start_stream(strm);
 
-        for (FONcBaseType *fbt: _fonc_vars) {
+        for (size_t i = 0; i < _fonc_vars.size(); ++i) {
+            FONcBaseType *fbt = _fonc_vars[i];
             BESDEBUG(MODULE,  prolog << "Writing data for variable:  " << fbt->name() << endl);
 
             fbt->set_dds(_dds);
             fbt->set_eval(&eval);
 
             fbt->write(_ncid);
-            nc_sync(_ncid);
 
             RequestServiceTimer::TheTimer()->throw_if_timeout_expired(prolog + "ERROR: bes-timeout expired before transmitting: " + fbt->name() , __FILE__, __LINE__);
 
-            if (is_streamable()) {
-                // write the what's been written
-                bytes_written += BESUtil::file_to_stream(_localfile, strm, bytes_written);
-                BESDEBUG(MODULE,  prolog << "Writing data to stream, bytes_written:  " << bytes_written << endl);
-            }
+            // send what's been written
+            if (writer)
+                writer->send_vars(_ncid, nc_vars_defined[i]);
         }
 
         stax = nc_close(_ncid);
         if (stax != NC_NOERR)
             FONcUtils::handle_error(stax, "File out netcdf, unable to close: " + _localfile, __FILE__, __LINE__);
 
-        RequestServiceTimer::TheTimer()->throw_if_timeout_expired(prolog + "ERROR: bes-timeout expired before transmitting data." , __FILE__, __LINE__);
-
-        bytes_written += BESUtil::file_to_stream(_localfile, strm, bytes_written);
-        BESDEBUG(MODULE,  prolog << "After nc_close() bytes_written:  " << bytes_written << endl);
+        finish_stream(writer.get(), strm);
     }
     catch (const BESError &e) {
         (void) nc_close(_ncid); // ignore the error at this point
@@ -520,6 +537,64 @@ void FONcTransform::transform_dap2(ostream &strm) {
     }
 }
 
+/** @brief Start sending the response before its data are written
+ *
+ * If the response is streamable, send the netcdf header now and return a
+ * writer that sends each variable once it has been written. Call this after
+ * nc_enddef().
+ *
+ * @param strm The output stream
+ * @return The writer, or null if the file must be sent after it is closed
+ */
+unique_ptr<FONcStreamWriter> FONcTransform::start_stream(ostream &strm) {
+    if (!is_streamable())
+        return nullptr;
+
+    // Verify the request hasn't exceeded bes_timeout.
+    RequestServiceTimer::TheTimer()->throw_if_timeout_expired(prolog +"ERROR: bes-timeout expired before transmitting data.", __FILE__, __LINE__);
+
+    // Now that we are ready to start streaming the response data we
+    // cancel any pending timeout alarm according to the configuration.
+    BESUtil::conditional_timeout_cancel();
+
+    unique_ptr<FONcStreamWriter> writer(new FONcStreamWriter(_localfile, strm));
+    if (!writer->start(_ncid)) {
+        BESDEBUG(MODULE,  prolog << "The response cannot be streamed, it will be sent once it is complete" << endl);
+        return nullptr;
+    }
+
+    return writer;
+}
+
+/** @brief Send the rest of the response; call this after nc_close()
+ *
+ * @param writer The writer returned by start_stream(), or null to send the
+ * whole file
+ * @param strm The output stream
+ */
+void FONcTransform::finish_stream(FONcStreamWriter *writer, ostream &strm) {
+    if (writer) {
+        writer->finish();
+        BESDEBUG(MODULE,  prolog << "Streamed the response, bytes_written:  " << writer->bytes_sent() << endl);
+        return;
+    }
+
+    RequestServiceTimer::TheTimer()->throw_if_timeout_expired(prolog + "ERROR: bes-timeout expired before transmitting data." , __FILE__, __LINE__);
+    BESUtil::conditional_timeout_cancel();
+
+    uint64_t bytes_written = BESUtil::file_to_stream(_localfile, strm);
+    BESDEBUG(MODULE,  prolog << "After nc_close() bytes_written:  " << bytes_written << endl);
+}
+
+/// @return The number of variables defined in the root group of the netcdf file
+int FONcTransform::defined_nc_vars() const {
+    int nvars = 0;
+    int stax = nc_inq_nvars(_ncid, &nvars);
+    if (stax != NC_NOERR)
+        FONcUtils::handle_error(stax, "File out netcdf, unable to get the number of variables: " + _localfile, __FILE__, __LINE__);
+    return nvars;
+}
+
 /** @brief checks if a netcdf file is streamable
  *
  * /!\ WARNING /!\ DDS/DMR object must be correctly constructed for this function to work
@@ -609,8 +684,11 @@ void FONcTransform::throw_if_dap4_response_too_big(DMR *dmr, const string &dap4_
  * attributes to the netcdf file. Each OPeNDAP data type translates into a
  * particular netcdf type. Also write out any global variables stored at the
  * top level of the DMR.
+ *
+ * @param strm The netcdf file is sent to this stream. NetCDF-3 responses
+ * are sent while they are written; others are sent once they are complete.
  */
-void FONcTransform::transform_dap4() {
+void FONcTransform::transform_dap4(ostream &strm) {
     BESDEBUG(MODULE,  prolog << "BEGIN" << endl);
 
     FONcUtils::reset();
@@ -843,9 +921,10 @@ void FONcTransform::transform_dap4() {
         if (stax != NC_NOERR)
             FONcUtils::handle_error(stax, "File out netcdf, unable to close: " + _localfile, __FILE__, __LINE__);
 
+        finish_stream(nullptr, strm);
     }
     else // No group, handle as the classic way
-        transform_dap4_no_group();
+        transform_dap4_no_group(strm);
 
     BESDEBUG(MODULE,  prolog << "END" << endl);
 
@@ -857,7 +936,7 @@ void FONcTransform::transform_dap4() {
  * This routine is similar to transform() that handles DAP2 objects.  However, DAP4 routines are needed.
  * So still keep a separate function. May combine this function with the transform()  in the future.
  */
-void FONcTransform::transform_dap4_no_group() {
+void FONcTransform::transform_dap4_no_group(ostream &strm) {
 
     D4Group *root_grp = _dmr->root();
 #if !NDEBUG
@@ -964,13 +1043,13 @@ void FONcTransform::transform_dap4_no_group() {
         // For each converted FONc object, call define on it to define
         // that object to the netcdf file. This also adds the attributes
         // for the variables to the netcdf file
-        vector<FONcBaseType *>::iterator i = _fonc_vars.begin();
-        vector<FONcBaseType *>::iterator e = _fonc_vars.end();
-        for (; i != e; i++) {
-            FONcBaseType *fbt = *i;
+        vector<int> nc_vars_defined;
+        for (FONcBaseType *fbt: _fonc_vars) {
             BESDEBUG(MODULE, prolog << "Defining variable:  " << fbt->name() << endl);
             //fbt->set_is_dap4(true);
+            fbt->set_read_on_worker(d_read_threads > 1);
             fbt->define(_ncid);
+            nc_vars_defined.push_back(defined_nc_vars());
         }
 
         if (FONcRequestHandler::no_global_attrs == false) {
@@ -1006,18 +1085,27 @@ void FONcTransform::transform_dap4_no_group() {
         }
 
         // Write everything out
-        i = _fonc_vars.begin();
-        e = _fonc_vars.end();
-        for (; i != e; i++) {
-            FONcBaseType *fbt = *i;
+        unique_ptr<FONcStreamWriter> writer = start_stream(strm);
+
+        // The next variables are read on worker threads while each one is written.
+        FONcReadAhead read_ahead(_fonc_vars, d_read_threads);
+
+        for (size_t i = 0; i < _fonc_vars.size(); ++i) {
+            FONcBaseType *fbt = _fonc_vars[i];
             RequestServiceTimer::TheTimer()->throw_if_timeout_expired(prolog + "ERROR: bes-timeout expired before transmitting: " + fbt->name() , __FILE__, __LINE__);
+            read_ahead.wait(i);
             BESDEBUG(MODULE, prolog << "Writing data for variable:  " << fbt->name() << endl);
             fbt->write(_ncid);
+
+            if (writer)
+                writer->send_vars(_ncid, nc_vars_defined[i]);
         }
 
         stax = nc_close(_ncid);
         if (stax != NC_NOERR)
             FONcUtils::handle_error(stax, "File out netcdf, unable to close: " + _localfile, __FILE__, __LINE__);
+
+        finish_stream(writer.get(), strm);
     }
     catch (BESError &e) {
         (void) nc_close(_ncid); // ignore the error at this point
@@ -1191,6 +1279,7 @@ void FONcTransform::transform_dap4_group_internal(D4Group *grp,
             FONcBaseType *fbt = *i;
             BESDEBUG(MODULE,  prolog << "Defining variable:  " << fbt->name() << endl);
             //fbt->set_is_dap4(true);
+            fbt->set_read_on_worker(d_read_threads > 1);
             fbt->define(grp_id);
         }
 
@@ -1213,12 +1302,13 @@ void FONcTransform::transform_dap4_group_internal(D4Group *grp,
             // *** Add the json history here
         }
 
-        // Write every variable in this group. 
-        i = fonc_vars_in_grp.begin();
-        e = fonc_vars_in_grp.end();
-        for (; i != e; i++) {
-            FONcBaseType *fbt = *i;
+        // Write every variable in this group. The next variables are read on
+        // worker threads while each one is written.
+        FONcReadAhead read_ahead(fonc_vars_in_grp, d_read_threads);
+        for (size_t j = 0; j < fonc_vars_in_grp.size(); ++j) {
+            FONcBaseType *fbt = fonc_vars_in_grp[j];
             RequestServiceTimer::TheTimer()->throw_if_timeout_expired(prolog + "ERROR: bes-timeout expired before transmitting: " + fbt->name() , __FILE__, __LINE__);
+            read_ahead.wait(j);
             BESDEBUG(MODULE, prolog << "Writing data for variable:  " << fbt->name() << endl);
             //fbt->write(_ncid);
             fbt->write(grp_id);
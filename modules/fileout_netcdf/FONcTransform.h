@@ -37,6 +37,7 @@
 #include <map>
 #include <unordered_map>
 #include <set>
+#include <memory>
 
 #include <BESObj.h>
 
@@ -47,6 +48,7 @@ class D4Group;
 }
 
 class FONcBaseType;
+class FONcStreamWriter;
 class BESResponseObject;
 class BESDataHandlerInterface;
 
@@ -76,6 +78,10 @@ private:
     //       This flag is not necessary and should be removed. KY 11/29/23
     bool global_dio_flag = false; 
 
+    // The number of variables read at once. More than one only when every
+    // container is a DMR++; see read_threads().
+    size_t d_read_threads = 1;
+
     bool do_reduce_dim = false;
     std::unordered_map<int64_t, std::vector<std::string>> dimsize_to_dup_dimnames;
     int reduced_dim_num = 0;
@@ -84,7 +90,7 @@ public:
     FONcTransform(BESResponseObject *obj, BESDataHandlerInterface *dhi, const std::string &localfile, const std::string &ncVersion = "netcdf");
     virtual ~FONcTransform();
 	virtual void transform_dap2(ostream &strm);
-	virtual void transform_dap4();
+	virtual void transform_dap4(ostream &strm);
 
 	virtual void dump(ostream &strm) const;
 
@@ -95,7 +101,7 @@ public:
 
 
 private:
-    virtual void transform_dap4_no_group();
+    virtual void transform_dap4_no_group(ostream &strm);
     virtual void transform_dap4_group(libdap::D4Group*,bool is_root, int par_grp_id, std::map<std::string, int>&, std::vector<int>&);
     virtual void transform_dap4_group_internal(libdap::D4Group*, bool is_root, int par_grp_id, std::map<std::string, int>&, std::vector<int>&);
     virtual void check_and_obtain_dimensions(libdap::D4Group *grp, bool);
@@ -109,7 +115,12 @@ private:
     virtual void build_reduce_dim();
     virtual void build_reduce_dim_internal(libdap::D4Group *grp, libdap::D4Group *root_grp);
 
+    size_t read_threads() const;
+
     virtual bool is_streamable();
+    std::unique_ptr<FONcStreamWriter> start_stream(ostream &strm);
+    void finish_stream(FONcStreamWriter *writer, ostream &strm);
+    int defined_nc_vars() const;
     virtual bool is_dds_streamable();
     virtual bool is_dmr_streamable(libdap::D4Group *group);
     void throw_if_dap2_response_too_big(DDS *dds, const string &dap2_ce="");
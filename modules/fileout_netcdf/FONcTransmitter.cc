@@ -85,7 +85,9 @@ using namespace rapidjson;
  * The OPeNDAP data object is written to a netcdf file locally in a
  * temporary directory specified by the BES configuration parameter
  * FONc.Tempdir. If this variable is not found or is not set then it
- * defaults to the macro definition FONC_TEMP_DIR.
+ * defaults to the macro definition FONC_TEMP_DIR. NetCDF-3 files are
+ * sent while they are written and the parts already sent are released
+ * from the temporary file; NetCDF-4 files are sent once complete.
  */
 FONcTransmitter::FONcTransmitter() :
         BESTransmitter()
@@ -177,7 +179,6 @@ void FONcTransmitter::send_dap2_data(BESResponseObject *obj, BESDataHandlerInter
 void FONcTransmitter::send_dap4_data(BESResponseObject *obj, BESDataHandlerInterface &dhi)
 {
     BESDEBUG(MODULE,  prolog << "BEGIN" << endl);
-    uint64_t bytes_sent = 0;
     try { // Expanded try block so all DAP errors are caught. ndp 12/23/2015
 
         auto bdmr = dynamic_cast<BESDMRResponse *>(obj);
@@ -191,14 +192,6 @@ void FONcTransmitter::send_dap4_data(BESResponseObject *obj, BESDataHandlerInter
         string temp_file_name = temp_file.create(FONcRequestHandler::temp_dir,  "dap4_nc_"+base_name);
 
         BESDEBUG(MODULE,  prolog << "Building response file " << temp_file_name << endl);
-        // Note that 'RETURN_CMD' is the same as the string that determines the file type:
-        // netcdf 3 or netcdf 4. Hack. jhrg 9/7/16
-        // FONcTransform ft(loaded_dmr, dhi, temp_file.get_name(), dhi.data[RETURN_CMD]);
-        FONcTransform ft(obj, &dhi, temp_file_name, dhi.data[RETURN_CMD]);
-
-        // Call the transform function for DAP4.
-        ft.transform_dap4();
-
         ostream &strm = dhi.get_output_stream();
 
 #if !NDEBUG
@@ -210,14 +203,14 @@ void FONcTransmitter::send_dap4_data(BESResponseObject *obj, BESDataHandlerInter
 
         if (!strm) throw BESInternalError("Output stream is not set, can not return as", __FILE__, __LINE__);
 
-        // Verify the request hasn't exceeded bes_timeout, and disable timeout if allowed.
-        RequestServiceTimer::TheTimer()->throw_if_timeout_expired("ERROR: bes-timeout expired before transmit", __FILE__, __LINE__);
-        BESUtil::conditional_timeout_cancel();
-
-        BESDEBUG(MODULE,  prolog << "Transmitting temp file " << temp_file_name << endl);
+        // Note that 'RETURN_CMD' is the same as the string that determines the file type:
+        // netcdf 3 or netcdf 4. Hack. jhrg 9/7/16
+        // FONcTransform ft(loaded_dmr, dhi, temp_file.get_name(), dhi.data[RETURN_CMD]);
+        FONcTransform ft(obj, &dhi, temp_file_name, dhi.data[RETURN_CMD]);
 
-        // FONcTransmitter::write_temp_file_to_stream(temp_file.get_fd(), strm); //, loaded_dds->filename(), ncVersion);
-        bytes_sent = BESUtil::file_to_stream(temp_file_name,strm);
+        // Call the transform function for DAP4. It sends the response to strm; NetCDF-3
+        // responses are sent as they are written.
+        ft.transform_dap4(strm);
     }
     // This series of catch blocks is used to convert other errors into BESErrors.
     // Thus, we do not need to catch BESError here because it's already what we want.
@@ -235,7 +228,7 @@ void FONcTransmitter::send_dap4_data(BESResponseObject *obj, BESDataHandlerInter
         throw BESInternalError(prolog + "Failed to get read data: Unknown exception caught", __FILE__, __LINE__);
     }
 
-    BESDEBUG(MODULE,  prolog << "END  Transmitted as netcdf. bytes_sent: " << bytes_sent << endl);
+    BESDEBUG(MODULE,  prolog << "END  Transmitted as netcdf" << endl);
 }
 
 
@@ -25,16 +25,86 @@
 #include <vector>
 #include <string>
 
+#include <netcdf.h>
+
+#include <libdap/Array.h>
+#include <libdap/Int32.h>
+#include <libdap/Float64.h>
+
 #include "modules/common/run_tests_cppunit.h"
 #include "test_config.h"
 
 #include "FONcArray.h"
+#include "FONcRequestHandler.h"
 
 using namespace std;
 
 class FONcArrayTest: public CppUnit::TestFixture {
     FONcArray fa;
 
+    string d_tmpDir = string(TEST_BUILD_DIR) + "/tmp";
+
+    static void check(int stax) {
+        CPPUNIT_ASSERT_MESSAGE(nc_strerror(stax), stax == NC_NOERR);
+    }
+
+    // Compress a 5x7x9 array in 2x3x4 chunks, so there are edge chunks in
+    // every dimension, the way read_ahead() does. Write the chunks to a
+    // netCDF-4 file with write_compressed_chunks() and read the array back
+    // with the netCDF library.
+    template<class DAP_TYPE, typename T>
+    void check_compressed_chunks(nc_type type, bool expect_shuffle) {
+        const vector<size_t> shape{5, 7, 9};
+        vector<T> values(5 * 7 * 9);
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = static_cast<T>(i * 1000) - 100;
+
+        DAP_TYPE proto("v");
+        libdap::Array a("v", &proto);
+        a.append_dim(5, "x");
+        a.append_dim(7, "y");
+        a.append_dim(9, "z");
+        a.set_value(values, values.size());
+
+        FONcArray array;
+        array.d_a = &a;
+        array.d_varname = "v";
+        array.d_array_type = type;
+        array.d_dim_sizes = shape;
+        array.d_chunksizes = {2, 3, 4};
+        array.d_nelements = values.size();
+        CPPUNIT_ASSERT_EQUAL(expect_shuffle, array.use_shuffle_filter());
+
+        const string name = d_tmpDir + "/compressed_chunks.nc";
+        int ncid;
+        check(nc_create(name.c_str(), NC_CLOBBER | NC_NETCDF4, &ncid));
+        int dims[3];
+        check(nc_def_dim(ncid, "x", shape[0], &dims[0]));
+        check(nc_def_dim(ncid, "y", shape[1], &dims[1]));
+        check(nc_def_dim(ncid, "z", shape[2], &dims[2]));
+        check(nc_def_var(ncid, "v", type, 3, dims, &array.d_varid));
+        check(nc_def_var_chunking_direct_write(ncid, array.d_varid, NC_CHUNKED, array.d_chunksizes.data()));
+        check(nc_def_var_deflate(ncid, array.d_varid, expect_shuffle ? 1 : 0, 1, 4));
+        check(nc_enddef(ncid));
+
+        array.compress_chunks();
+        CPPUNIT_ASSERT_EQUAL(size_t(3 * 3 * 3), array.d_chunks.size());
+        array.write_compressed_chunks(ncid);
+        check(nc_close(ncid));
+
+        check(nc_open(name.c_str(), NC_NOWRITE, &ncid));
+        int varid;
+        check(nc_inq_varid(ncid, "v", &varid));
+        int shuffle, deflate, level;
+        check(nc_inq_var_deflate(ncid, varid, &shuffle, &deflate, &level));
+        CPPUNIT_ASSERT_EQUAL(expect_shuffle ? 1 : 0, shuffle);
+        vector<T> result(values.size());
+        check(nc_get_var(ncid, varid, result.data()));
+        check(nc_close(ncid));
+
+        CPPUNIT_ASSERT_MESSAGE("The data read back should match the data written", result == values);
+    }
+
 public:
     // Called once before everything gets tested
     FONcArrayTest() = default;
@@ -42,8 +112,9 @@ public:
     // Called at the end of the test
     ~FONcArrayTest() = default;
 
-    // These tests don't define specializations of void setUp() OR void tearDown().
-    // jhrg 2/25/22
+    void tearDown() override {
+        FONcRequestHandler::use_shuffle = false;
+    }
 
     void test_equal_length_1() {
         vector<string> stuff;
@@ -103,6 +174,21 @@ public:
         CPPUNIT_ASSERT_MESSAGE("All the string are the same length", fa.equal_length(stuff));
     }
 
+    // Integers are always shuffled.
+    void test_compressed_chunks_int32() {
+        check_compressed_chunks<libdap::Int32, libdap::dods_int32>(NC_INT, true);
+    }
+
+    void test_compressed_chunks_float64() {
+        FONcRequestHandler::use_shuffle = false;
+        check_compressed_chunks<libdap::Float64, libdap::dods_float64>(NC_DOUBLE, false);
+    }
+
+    void test_compressed_chunks_float64_shuffle() {
+        FONcRequestHandler::use_shuffle = true;
+        check_compressed_chunks<libdap::Float64, libdap::dods_float64>(NC_DOUBLE, true);
+    }
+
     CPPUNIT_TEST_SUITE( FONcArrayTest );
 
     CPPUNIT_TEST(test_equal_length_1);
@@ -110,6 +196,10 @@ public:
     CPPUNIT_TEST(test_equal_length_3);
     CPPUNIT_TEST(test_equal_length_4);
 
+    CPPUNIT_TEST(test_compressed_chunks_int32);
+    CPPUNIT_TEST(test_compressed_chunks_float64);
+    CPPUNIT_TEST(test_compressed_chunks_float64_shuffle);
+
     // equal_length is so fast the profiler does not sample its call. jhrg 10/4/22
     // CPPUNIT_TEST(test_equal_length_for_profiler);
 
@@ -0,0 +1,176 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP
+// Hyrax data server
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <netcdf.h>
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+#include "FONcStreamWriter.h"
+
+using namespace std;
+
+#define prolog std::string("FONcStreamWriterTest::").append(__func__).append("() - ")
+
+class FONcStreamWriterTest: public CppUnit::TestFixture {
+
+private:
+    string d_tmpDir = string(TEST_BUILD_DIR) + "/tmp";
+
+    static void check(int stax) {
+        CPPUNIT_ASSERT_MESSAGE(nc_strerror(stax), stax == NC_NOERR);
+    }
+
+    static string read_file(const string &name) {
+        ifstream in(name, ios::binary);
+        ostringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    }
+
+    // Write a small file the way FONcTransform does (fill off, define, then
+    // write each variable). If strm is not null, stream it while writing.
+    // Returns false if the writer could not stream the file.
+    static bool write_file(const string &name, int cmode, bool unlimited, ostream *strm) {
+        int ncid;
+        check(nc_create(name.c_str(), NC_CLOBBER | cmode, &ncid));
+        int old_fill;
+        check(nc_set_fill(ncid, NC_NOFILL, &old_fill));
+
+        int x, y;
+        check(nc_def_dim(ncid, "x", unlimited ? NC_UNLIMITED : 3, &x));
+        check(nc_def_dim(ncid, "y", 5, &y));
+
+        const string history = "FONcStreamWriterTest";
+        check(nc_put_att_text(ncid, NC_GLOBAL, "history", history.size(), history.c_str()));
+
+        int b, s, d, i;
+        check(nc_def_var(ncid, "b", NC_BYTE, 1, &x, &b));                 // Padded to four bytes
+        check(nc_def_var(ncid, "s", NC_SHORT, 1, &y, &s));
+        const short valid_range[] = {-10, 10};
+        check(nc_put_att_short(ncid, s, "valid_range", NC_SHORT, 2, valid_range));
+        int dims[] = {x, y};
+        check(nc_def_var(ncid, "d", NC_DOUBLE, 2, dims, &d));
+        check(nc_def_var(ncid, "i", NC_INT, 0, nullptr, &i));
+        check(nc_enddef(ncid));
+
+        unique_ptr<FONcStreamWriter> writer;
+        bool streamed = false;
+        if (strm) {
+            writer.reset(new FONcStreamWriter(name, *strm));
+            streamed = writer->start(ncid);
+        }
+
+        const signed char b_data[] = {1, 2, 3};
+        const size_t start[] = {0, 0};
+        const size_t x_count[] = {3};
+        check(nc_put_vara_schar(ncid, b, start, x_count, b_data));
+        if (streamed) writer->send_vars(ncid, 1);
+
+        const short s_data[] = {-2, -1, 0, 1, 2};
+        check(nc_put_var_short(ncid, s, s_data));
+        if (streamed) writer->send_vars(ncid, 2);
+
+        vector<double> d_data(15);
+        for (size_t n = 0; n < d_data.size(); ++n) d_data[n] = n * 0.5;
+        const size_t count[] = {3, 5};
+        check(nc_put_vara_double(ncid, d, start, count, d_data.data()));
+        if (streamed) writer->send_vars(ncid, 3);
+
+        const int i_data = 42;
+        check(nc_put_var_int(ncid, i, &i_data));
+        if (streamed) writer->send_vars(ncid, 4);
+
+        check(nc_close(ncid));
+        if (streamed) writer->finish();
+
+        return streamed;
+    }
+
+    void stream_matches_file(int cmode) {
+        const string reference = d_tmpDir + "/stream_writer_reference.nc";
+        write_file(reference, cmode, false, nullptr);
+
+        ostringstream strm;
+        const string streamed = d_tmpDir + "/stream_writer_streamed.nc";
+        CPPUNIT_ASSERT_MESSAGE("The file should be streamed", write_file(streamed, cmode, false, &strm));
+
+        const string expected = read_file(reference);
+        DBG(cerr << prolog << "expected " << expected.size() << " bytes, streamed " << strm.str().size() << endl);
+        CPPUNIT_ASSERT_EQUAL(expected.size(), strm.str().size());
+        CPPUNIT_ASSERT_MESSAGE("The streamed bytes should match the file", expected == strm.str());
+    }
+
+public:
+    // Called once before everything gets tested
+    FONcStreamWriterTest() = default;
+
+    // Called at the end of the test
+    ~FONcStreamWriterTest() = default;
+
+    void test_classic() {
+        stream_matches_file(0);
+    }
+
+    void test_64bit_offset() {
+        stream_matches_file(NC_64BIT_OFFSET);
+    }
+
+    void test_record_variables_not_streamed() {
+        ostringstream strm;
+        const string name = d_tmpDir + "/stream_writer_unlimited.nc";
+        CPPUNIT_ASSERT_MESSAGE("A file with record variables cannot be streamed",
+                               !write_file(name, 0, true, &strm));
+        CPPUNIT_ASSERT_MESSAGE("Nothing should be sent", strm.str().empty());
+    }
+
+    void test_netcdf4_not_streamed() {
+        ostringstream strm;
+        const string name = d_tmpDir + "/stream_writer_nc4.nc";
+        CPPUNIT_ASSERT_MESSAGE("A netCDF-4 file cannot be streamed", !write_file(name, NC_NETCDF4, false, &strm));
+        CPPUNIT_ASSERT_MESSAGE("Nothing should be sent", strm.str().empty());
+    }
+
+    CPPUNIT_TEST_SUITE( FONcStreamWriterTest );
+
+    CPPUNIT_TEST(test_classic);
+    CPPUNIT_TEST(test_64bit_offset);
+    CPPUNIT_TEST(test_record_variables_not_streamed);
+    CPPUNIT_TEST(test_netcdf4_not_streamed);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FONcStreamWriterTest);
+
+int main(int argc, char *argv[])
+{
+    return bes_run_tests<FONcStreamWriterTest>(argc, argv, "cerr,fonc") ? 0: 1;
+}
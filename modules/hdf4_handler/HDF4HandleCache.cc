@@ -0,0 +1,180 @@
+/////////////////////////////////////////////////////////////////////////////
+// This file is part of the hdf4 data handler for the OPeNDAP data server.
+// It keeps the HDF4 SD and HDF-EOS2 handles used to read data open
+// between variable reads.
+// Copyright (c) The HDF Group
+/////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+
+#ifdef USE_HDFEOS2_LIB
+#include "HdfEosDef.h"
+#endif
+
+#include "HDF4HandleCache.h"
+
+using namespace std;
+
+// The cache is created when it is first used. It is empty by the time it is
+// destroyed because the request handler's destructor calls clear().
+bes::HandleCache<HDF4HandleCache::Handle> &HDF4HandleCache::cache()
+{
+    static bes::HandleCache<Handle> the_cache(close_handle, 0, "h4");
+    return the_cache;
+}
+
+/// Start the SD interface for a file, reusing a cached SD ID if possible.
+/// \return The SD ID or FAIL. Release it with sd_end().
+int32 HDF4HandleCache::sd_start(const string &filename)
+{
+    return open_file(SD_FILE, filename);
+}
+
+/// Release an SD ID returned by sd_start().
+intn HDF4HandleCache::sd_end(int32 sdid)
+{
+    return release(SD_FILE, sdid);
+}
+
+#ifdef USE_HDFEOS2_LIB
+/// Open an HDF-EOS2 file with the grid (GDopen) or swath (SWopen) interface,
+/// reusing a cached file ID if possible.
+/// \return The file ID or FAIL. Release it with eos_close().
+int32 HDF4HandleCache::eos_open(const string &filename, bool is_grid)
+{
+    return open_file(is_grid ? GRID_FILE : SWATH_FILE, filename);
+}
+
+/// Release a file ID returned by eos_open().
+intn HDF4HandleCache::eos_close(int32 eos_fileid, bool is_grid)
+{
+    return release(is_grid ? GRID_FILE : SWATH_FILE, eos_fileid);
+}
+
+/// Attach a grid or swath, reusing a cached grid or swath ID if possible.
+/// Only grids and swaths of files opened with eos_open() are cached.
+/// \return The grid or swath ID or FAIL. Release it with eos_detach().
+int32 HDF4HandleCache::eos_attach(int32 eos_fileid, const string &name, bool is_grid)
+{
+    Handle file;
+    file.kind = is_grid ? GRID_FILE : SWATH_FILE;
+    file.id = eos_fileid;
+
+    Handle handle;
+    handle.kind = is_grid ? GRID : SWATH;
+
+    // A grid or swath ID is only valid with the file ID it was attached to.
+    const string key = (is_grid ? "grid " : "swath ") + to_string(eos_fileid) + " " + name;
+    if (cache().find_child(key, handle))
+        return handle.id;
+
+    handle.id = is_grid ? GDattach(eos_fileid, const_cast<char *>(name.c_str()))
+                        : SWattach(eos_fileid, const_cast<char *>(name.c_str()));
+
+    // If the file is not in the cache, neither is the grid or swath.
+    if (handle.id >= 0 && cache().contains(file))
+        cache().insert_child(key, handle, file);
+
+    return handle.id;
+}
+
+/// Release a grid or swath ID returned by eos_attach().
+intn HDF4HandleCache::eos_detach(int32 eos_id, bool is_grid)
+{
+    return release(is_grid ? GRID : SWATH, eos_id);
+}
+#endif
+
+/// Set the number of handles kept open, H4.FileIdCacheEntries. Zero turns the cache off.
+void HDF4HandleCache::set_max_entries(unsigned int max_entries)
+{
+    cache().set_max_entries(max_entries);
+}
+
+/// Release the handles a failed read did not release. Registered with
+/// BESInterface::add_end_request_callback().
+void HDF4HandleCache::end_request()
+{
+    cache().end_request();
+}
+
+/// Close all the cached handles. Grids and swaths are detached before
+/// their files are closed.
+void HDF4HandleCache::clear()
+{
+    cache().clear();
+}
+
+size_t HDF4HandleCache::size()
+{
+    return cache().size();
+}
+
+int32 HDF4HandleCache::open_file(handle_kind kind, const string &filename)
+{
+    Handle handle;
+    handle.kind = kind;
+
+    static const char *kind_names[] = { "sd ", "gd ", "sw " };
+    const string key = kind_names[kind] + filename;
+    time_t mtime = 0;
+    bool use_cache = cache().enabled() && bes::HandleCache<Handle>::file_mtime(filename, mtime);
+
+    if (use_cache && cache().find(key, mtime, handle))
+        return handle.id;
+
+    switch (kind) {
+        case SD_FILE:
+            handle.id = SDstart(const_cast<char *>(filename.c_str()), DFACC_READ);
+            break;
+#ifdef USE_HDFEOS2_LIB
+        case GRID_FILE:
+            handle.id = GDopen(const_cast<char *>(filename.c_str()), DFACC_READ);
+            break;
+        case SWATH_FILE:
+            handle.id = SWopen(const_cast<char *>(filename.c_str()), DFACC_READ);
+            break;
+#endif
+        default:
+            handle.id = FAIL;
+            break;
+    }
+
+    if (use_cache && handle.id >= 0)
+        cache().insert(key, mtime, handle);
+
+    return handle.id;
+}
+
+intn HDF4HandleCache::release(handle_kind kind, int32 id)
+{
+    Handle handle;
+    handle.kind = kind;
+    handle.id = id;
+
+    int status = SUCCEED;
+    if (!cache().release(handle, &status))
+        return close_handle(handle);
+
+    return status;
+}
+
+int HDF4HandleCache::close_handle(const Handle &handle)
+{
+    switch (handle.kind) {
+        case SD_FILE:
+            return SDend(handle.id);
+#ifdef USE_HDFEOS2_LIB
+        case GRID_FILE:
+            return GDclose(handle.id);
+        case SWATH_FILE:
+            return SWclose(handle.id);
+        case GRID:
+            return GDdetach(handle.id);
+        case SWATH:
+            return SWdetach(handle.id);
+#endif
+        default:
+            return FAIL;
+    }
+}
@@ -0,0 +1,73 @@
+/////////////////////////////////////////////////////////////////////////////
+// This file is part of the hdf4 data handler for the OPeNDAP data server.
+// It keeps the HDF4 SD and HDF-EOS2 handles used to read data open
+// between variable reads.
+// Copyright (c) The HDF Group
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef HDF4HANDLECACHE_H
+#define HDF4HANDLECACHE_H
+
+#include <string>
+
+#include "mfhdf.h"
+#include "hdf.h"
+
+#include "HandleCache.h"
+
+/// A per-process cache of the handles the array classes use to read data.
+///
+/// Without it, each variable read calls SDstart(), GDopen() or SWopen() and
+/// GDattach() or SWattach(), and closes them again. For HDF-EOS2 files with
+/// large StructMetadata the opens and attaches cost much more than the read.
+/// With it, the variables of a request, and later requests for the same
+/// file, share the handles.
+///
+/// The handles are kept in a bes::HandleCache. An attached grid or swath is
+/// a child of its EOS file, so it is always detached before the file is
+/// closed. Handles for a file that has changed since it was opened are not
+/// reused. When more than H4.FileIdCacheEntries handles are open, the least
+/// recently used idle handles are closed. At the end of each request, the
+/// handles that a failed read did not release are released.
+///
+/// Handles that are not in the cache, e.g. the IDs passed from the DDS when
+/// H4.EnablePassFileID is true, are closed by the release functions as
+/// before, so the release functions can replace SDend() etc. everywhere.
+class HDF4HandleCache {
+public:
+    static int32 sd_start(const std::string &filename);
+    static intn sd_end(int32 sdid);
+
+#ifdef USE_HDFEOS2_LIB
+    static int32 eos_open(const std::string &filename, bool is_grid);
+    static intn eos_close(int32 eos_fileid, bool is_grid);
+    static int32 eos_attach(int32 eos_fileid, const std::string &name, bool is_grid);
+    static intn eos_detach(int32 eos_id, bool is_grid);
+#endif
+
+    static void set_max_entries(unsigned int max_entries);
+    static void end_request();
+    static void clear();
+
+    /// @return The number of open handles held by the cache
+    static size_t size();
+
+private:
+    enum handle_kind { SD_FILE, GRID_FILE, SWATH_FILE, GRID, SWATH };
+
+    // The SD, GD and SW interfaces number their IDs independently.
+    struct Handle {
+        handle_kind kind = SD_FILE;
+        int32 id = -1;
+
+        bool operator==(const Handle &rhs) const { return kind == rhs.kind && id == rhs.id; }
+    };
+
+    static bes::HandleCache<Handle> &cache();
+
+    static int32 open_file(handle_kind kind, const std::string &filename);
+    static intn release(handle_kind kind, int32 id);
+    static int close_handle(const Handle &handle);
+};
+
+#endif
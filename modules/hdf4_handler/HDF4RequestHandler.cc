@@ -59,12 +59,14 @@
 #include <BESDapError.h>
 #include <BESStopWatch.h>
 #include <BESDebug.h>
+#include <BESInterface.h>
 #include "BESDataNames.h"
 #include <libdap/Ancillary.h>
 #include "config_hdf.h"
 
 #include "HE2CF.h"
 #include "HDF4_DDS.h"
+#include "HDF4HandleCache.h"
 
 #include "HDF4_DMR.h"
 
@@ -148,6 +150,9 @@ long HDF4RequestHandler::_cache_latlon_size       =0;
 bool HDF4RequestHandler::_cache_metadata_path_exist        =false;
 string HDF4RequestHandler::_cache_metadata_path            ="";
 
+// Number of SD and HDF-EOS2 handles kept open between variable reads
+unsigned int HDF4RequestHandler::_fileid_cache_entries     =0;
+
 HDF4RequestHandler::HDF4RequestHandler(const string & name) :
 	BESRequestHandler(name) {
 
@@ -205,6 +210,20 @@ HDF4RequestHandler::HDF4RequestHandler(const string & name) :
 
         _cache_metadata_path_exist        =get_beskeys("H4.Cache.metadata.path",_cache_metadata_path);
 
+        string temp_fileid_cache_entries;
+        if (true == get_beskeys("H4.FileIdCacheEntries",temp_fileid_cache_entries)) {
+            istringstream iss(temp_fileid_cache_entries);
+            iss >> _fileid_cache_entries;
+        }
+        HDF4HandleCache::set_max_entries(_fileid_cache_entries);
+
+        // Release the handles held by reads that failed
+        BESInterface::add_end_request_callback(HDF4HandleCache::end_request);
+}
+
+HDF4RequestHandler::~HDF4RequestHandler()
+{
+    HDF4HandleCache::clear();
 }
 
 bool HDF4RequestHandler::hdf4_build_das(BESDataHandlerInterface & dhi) {
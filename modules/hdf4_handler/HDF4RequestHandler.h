@@ -85,12 +85,14 @@ class HDF4RequestHandler:public BESRequestHandler {
 
   static bool _cache_metadata_path_exist;
   static std::string _cache_metadata_path;
+
+  static unsigned int _fileid_cache_entries;
    
   static bool _direct_dmr;
 
   public:
     explicit HDF4RequestHandler(const std::string & name);
-    ~HDF4RequestHandler(void) override = default;
+    ~HDF4RequestHandler(void) override;
 
     static bool hdf4_build_das(BESDataHandlerInterface & dhi);
     static bool hdf4_build_dds(BESDataHandlerInterface & dhi);
@@ -144,6 +146,8 @@ class HDF4RequestHandler:public BESRequestHandler {
     static bool get_cache_metadata_path_exist() { return _cache_metadata_path_exist; }
     static std::string get_cache_metadata_path() { return _cache_metadata_path;}
 
+    static unsigned int get_fileid_cache_entries() { return _fileid_cache_entries; }
+
 };
 
 
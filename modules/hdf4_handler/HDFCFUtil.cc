@@ -25,6 +25,7 @@
 #include "HDFFloat64.h"
 #include "HDFStr.h"
 #include "HDF4RequestHandler.h"
+#include "HDF4HandleCache.h"
 
 //
 using namespace std;
@@ -3558,16 +3559,18 @@ ssize_t HDFCFUtil::read_buffer_from_file(int fd,  void*buf, size_t total_read) {
 }
 void HDFCFUtil::close_fileid(int32 sdfd, int32 fileid,int32 gridfd, int32 swathfd,bool pass_fileid) {
 
+    // The SD and HDF-EOS2 IDs may be shared through HDF4HandleCache; release
+    // them there. IDs the cache does not hold are closed.
     if(false == pass_fileid) {
         if(sdfd != -1)
-            SDend(sdfd);
+            HDF4HandleCache::sd_end(sdfd);
         if(fileid != -1)
             Hclose(fileid);
 #ifdef USE_HDFEOS2_LIB
         if(gridfd != -1)
-            GDclose(gridfd);
+            HDF4HandleCache::eos_close(gridfd,true);
         if(swathfd != -1)
-            SWclose(swathfd);
+            HDF4HandleCache::eos_close(swathfd,false);
         
 #endif
     }
@@ -20,6 +20,7 @@
 #include "HDFEOS2Array_RealField.h"
 #include "dodsutil.h"
 #include "HDF4RequestHandler.h"
+#include "HDF4HandleCache.h"
 
 using namespace std;
 using namespace libdap;
@@ -63,27 +64,19 @@ HDFEOS2Array_RealField::read ()
         step32[i] = step[i];
     }
 
-    // Define function pointers to handle both grid and swath
-    int32 (*openfunc) (char *, intn);
-    intn (*closefunc) (int32);
-    int32 (*attachfunc) (int32, char *);
-    intn (*detachfunc) (int32);
+    // Define the function pointer to obtain the field information of both grid and swath.
+    // The grid or swath is opened, attached, detached and closed through
+    // HDF4HandleCache so the handles can be shared by the variable reads.
     intn (*fieldinfofunc) (int32, char *, int32 *, int32 *, int32 *, char *);
 
     string datasetname;
+    bool is_grid = true;
     if (swathname == "") {
-        openfunc = GDopen;
-        closefunc = GDclose;
-        attachfunc = GDattach;
-        detachfunc = GDdetach;
         fieldinfofunc = GDfieldinfo;
         datasetname = gridname;
     }
     else if (gridname == "") {
-        openfunc = SWopen;
-        closefunc = SWclose;
-        attachfunc = SWattach;
-        detachfunc = SWdetach;
+        is_grid = false;
         fieldinfofunc = SWfieldinfo;
         datasetname = swathname;
     }
@@ -97,7 +90,7 @@ HDFEOS2Array_RealField::read ()
     if (true == isgeofile || false == check_pass_fileid_key) {
 
         // Obtain the EOS object ID(either grid or swath)
-        gfid = openfunc (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        gfid = HDF4HandleCache::eos_open(filename, is_grid);
         if (gfid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
@@ -108,7 +101,7 @@ HDFEOS2Array_RealField::read ()
         gfid = gsfd;
 
     // Attach the EOS object ID
-    gridid = attachfunc (gfid, const_cast < char *>(datasetname.c_str ()));
+    gridid = HDF4HandleCache::eos_attach(gfid, datasetname, is_grid);
     if (gridid < 0) {
         close_fileid(gfid,-1);
         ostringstream eherr;
@@ -143,7 +136,7 @@ HDFEOS2Array_RealField::read ()
         r = fieldinfofunc (gridid, const_cast < char *>(fieldname.c_str ()),
                 &tmp_rank, tmp_dims, &field_dtype, tmp_dimlist);
         if (r != 0) {
-            detachfunc(gridid);
+            HDF4HandleCache::eos_detach(gridid, is_grid);
             close_fileid(gfid,-1);
             ostringstream eherr;
 
@@ -165,10 +158,10 @@ HDFEOS2Array_RealField::read ()
 
         if (true == isgeofile || false == check_pass_fileid_key)  {
 
-            sdfileid = SDstart(filename.c_str (), DFACC_READ);
+            sdfileid = HDF4HandleCache::sd_start(filename);
 
             if (FAIL == sdfileid) {
-                detachfunc(gridid);
+                HDF4HandleCache::eos_detach(gridid, is_grid);
                 close_fileid(gfid,-1);
                 ostringstream eherr;
                 eherr << "Cannot Start the SD interface for the file " << filename <<endl;
@@ -181,7 +174,7 @@ HDFEOS2Array_RealField::read ()
         int32 sdsid = -1;
         sdsindex = SDnametoindex(sdfileid, fieldname.c_str());
         if (FAIL == sdsindex) {
-            detachfunc(gridid);
+            HDF4HandleCache::eos_detach(gridid, is_grid);
             close_fileid(gfid,sdfileid);
             ostringstream eherr;
             eherr << "Cannot obtain the index of " << fieldname;
@@ -190,7 +183,7 @@ HDFEOS2Array_RealField::read ()
 
         sdsid = SDselect(sdfileid, sdsindex);
         if (FAIL == sdsid) {
-            detachfunc(gridid);
+            HDF4HandleCache::eos_detach(gridid, is_grid);
             close_fileid(gfid,sdfileid);
             ostringstream eherr;
             eherr << "Cannot obtain the SDS ID  of " << fieldname;
@@ -209,7 +202,7 @@ HDFEOS2Array_RealField::read ()
         // Close the interfaces
         SDendaccess(sdsid);
         if (true == isgeofile || false == check_pass_fileid_key)
-            SDend(sdfileid);
+            HDF4HandleCache::sd_end(sdfileid);
     }
 
     // USE a try-catch block to release the resources.
@@ -221,13 +214,13 @@ HDFEOS2Array_RealField::read ()
             write_dap_data_scale_comp(gridid,nelms,offset32,count32,step32);
     }
     catch(...) {
-        detachfunc(gridid);
+        HDF4HandleCache::eos_detach(gridid, is_grid);
         close_fileid(gfid,-1);
         throw;
     }
 
     int32 r = -1;
-    r = detachfunc (gridid);
+    r = HDF4HandleCache::eos_detach(gridid, is_grid);
     if (r != 0) {
         close_fileid(gfid,-1);
         ostringstream eherr;
@@ -237,7 +230,7 @@ HDFEOS2Array_RealField::read ()
 
 
     if (true == isgeofile || false == check_pass_fileid_key) {
-        r = closefunc (gfid);
+        r = HDF4HandleCache::eos_close(gfid, is_grid);
         if (r != 0) {
             ostringstream eherr;
             eherr << "Grid/Swath " << filename.c_str () << " cannot be closed.";
@@ -408,7 +401,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
             if (false == isgeofile || false == check_pass_fileid_key) 
                 sdfileid = sdfd;
             else {
-                sdfileid = SDstart(filename.c_str (), DFACC_READ);
+                sdfileid = HDF4HandleCache::sd_start(filename);
                 if (FAIL == sdfileid) {
                     ostringstream eherr;
                     eherr << "Cannot Start the SD interface for the file " 
@@ -422,7 +415,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
 	    sdsindex = SDnametoindex(sdfileid, fieldname.c_str());
             if (FAIL == sdsindex) {
                 if (true == isgeofile || false == check_pass_fileid_key) 
-                    SDend(sdfileid);
+                    HDF4HandleCache::sd_end(sdfileid);
                 ostringstream eherr;
                 eherr << "Cannot obtain the index of " << fieldname;
                 throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -431,7 +424,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
             sdsid = SDselect(sdfileid, sdsindex);
             if (FAIL == sdsid) {
                 if (true == isgeofile || false == check_pass_fileid_key)
-                    SDend(sdfileid);
+                    HDF4HandleCache::sd_end(sdfileid);
                 ostringstream eherr;
                 eherr << "Cannot obtain the SDS ID  of " << fieldname;
                 throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -458,7 +451,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_scales' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -471,7 +464,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     release_mod1b_res(reflectance_scales,reflectance_offsets,radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_scales' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -482,7 +475,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     release_mod1b_res(reflectance_scales,reflectance_offsets,radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_offsets' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -495,7 +488,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     release_mod1b_res(reflectance_scales,reflectance_offsets,radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_offsets' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -538,7 +531,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     release_mod1b_res(reflectance_scales,reflectance_offsets,radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                       SDend(sdfileid);
+                       HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_scales' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -551,7 +544,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     release_mod1b_res(reflectance_scales,reflectance_offsets,radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_scales' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -563,7 +556,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     release_mod1b_res(reflectance_scales,reflectance_offsets,radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                       SDend(sdfileid);
+                       HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_offsets' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -576,7 +569,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     release_mod1b_res(reflectance_scales,reflectance_offsets,radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_offsets' in " << fieldname.c_str () << " cannot be obtained.";
                     throw InternalErr (__FILE__, __LINE__, eherr.str ());
@@ -616,7 +609,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'scale_factor' in " 
                           << fieldname.c_str () << " cannot be obtained.";
@@ -629,7 +622,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
 
                     ostringstream eherr;
                     eherr << "Attribute 'scale_factor' in " 
@@ -675,7 +668,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
 
                     ostringstream eherr;
                     eherr << "Attribute 'add_offset' in " << fieldname.c_str () 
@@ -689,7 +682,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
 
                     ostringstream eherr;
                     eherr << "Attribute 'add_offset' in " << fieldname.c_str () 
@@ -733,7 +726,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
 
                     ostringstream eherr;
                     eherr << "Attribute '_FillValue' in " << fieldname.c_str () 
@@ -747,7 +740,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
 
                     ostringstream eherr;
                     eherr << "Attribute '_FillValue' in " << fieldname.c_str () 
@@ -791,7 +784,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
 
                     ostringstream eherr;
                     eherr << "Attribute '_FillValue' in " << fieldname.c_str () 
@@ -805,7 +798,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
 
                     ostringstream eherr;
                     eherr << "Attribute '_FillValue' in " << fieldname.c_str () 
@@ -828,13 +821,13 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (string::npos == found){
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
                             throw InternalErr(__FILE__,__LINE__,"should find the separator ,");
                         }
                         if (found != found_from_end){
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
                             throw InternalErr(__FILE__,__LINE__,
                                               "Only one separator , should be available.");
                         }
@@ -862,13 +855,13 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                             if (string::npos == found){
                                 SDendaccess(sdsid);
                                 if (true == isgeofile || false == check_pass_fileid_key)
-                                    SDend(sdfileid);
+                                    HDF4HandleCache::sd_end(sdfileid);
                                 throw InternalErr(__FILE__,__LINE__,"should find the separator ,");
                             }
                             if (found != found_from_end){
                                 SDendaccess(sdsid);
                                 if (true == isgeofile || false == check_pass_fileid_key)
-                                    SDend(sdfileid);
+                                    HDF4HandleCache::sd_end(sdfileid);
                                 throw InternalErr(__FILE__,__LINE__,
                                                   "Only one separator , should be available.");
                             }
@@ -884,7 +877,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         else {
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
                             throw InternalErr(__FILE__,__LINE__,
                                              "The number of attribute count should be greater than 1.");
                         }
@@ -898,7 +891,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (temp_attrcount != 2) {
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
  
                             throw InternalErr(__FILE__,__LINE__,
                                   "The number of attribute count should be 2 for the DFNT_UINT8 type.");
@@ -915,7 +908,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (temp_attrcount != 2) {
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
  
                             throw InternalErr(__FILE__,__LINE__,
                                   "The number of attribute count should be 2 for the DFNT_INT16 type.");
@@ -932,7 +925,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (temp_attrcount != 2) {
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
  
                             throw InternalErr(__FILE__,__LINE__,
                                 "The number of attribute count should be 2 for the DFNT_UINT16 type.");
@@ -949,7 +942,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (temp_attrcount != 2) {
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
  
                             throw InternalErr(__FILE__,__LINE__,
                                 "The number of attribute count should be 2 for the DFNT_INT32 type.");
@@ -966,7 +959,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (temp_attrcount != 2) {
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
  
                             throw InternalErr(__FILE__,__LINE__,
                                "The number of attribute count should be 2 for the DFNT_UINT32 type.");
@@ -983,7 +976,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (temp_attrcount != 2) {
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
  
                             throw InternalErr(__FILE__,__LINE__,
                               "The number of attribute count should be 2 for the DFNT_FLOAT32 type.");
@@ -1000,7 +993,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                         if (temp_attrcount != 2){
                             SDendaccess(sdsid);
                             if (true == isgeofile || false == check_pass_fileid_key)
-                                SDend(sdfileid);
+                                HDF4HandleCache::sd_end(sdfileid);
  
                             throw InternalErr(__FILE__,__LINE__,
                               "The number of attribute count should be 2 for the DFNT_FLOAT64 type.");
@@ -1019,7 +1012,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                     default: {
                         SDendaccess(sdsid);
                         if (true == isgeofile || false == check_pass_fileid_key)
-                            SDend(sdfileid);
+                            HDF4HandleCache::sd_end(sdfileid);
                         throw InternalErr(__FILE__,__LINE__,"Unsupported data type.");
                     }
                 }
@@ -1058,7 +1051,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_scales' in " << fieldname.c_str () 
                           << " cannot be obtained.";
@@ -1071,7 +1064,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_scales' in " << fieldname.c_str () 
                           << " cannot be obtained.";
@@ -1083,7 +1076,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_offsets' in " 
                           << fieldname.c_str () << " cannot be obtained.";
@@ -1096,7 +1089,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                 {
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'radiance_offsets' in " 
                           << fieldname.c_str () << " cannot be obtained.";
@@ -1148,7 +1141,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                                       radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                       SDend(sdfileid);
+                       HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_scales' in " 
                           << fieldname.c_str () << " cannot be obtained.";
@@ -1163,7 +1156,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                                       radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_scales' in " 
                           << fieldname.c_str () << " cannot be obtained.";
@@ -1178,7 +1171,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                                       radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                       SDend(sdfileid);
+                       HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_offsets' in " 
                           << fieldname.c_str () << " cannot be obtained.";
@@ -1193,7 +1186,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
                                       radiance_scales,radiance_offsets);
                     SDendaccess(sdsid);
                     if (true == isgeofile || false == check_pass_fileid_key)
-                        SDend(sdfileid);
+                        HDF4HandleCache::sd_end(sdfileid);
                     ostringstream eherr;
                     eherr << "Attribute 'reflectance_offsets' in " 
                           << fieldname.c_str () << " cannot be obtained.";
@@ -1601,7 +1594,7 @@ HDFEOS2Array_RealField::write_dap_data_scale_comp(int32 gridid,
     // Somehow the macro RECALCULATE causes the interaction between gridid and sdfileid. SO
     // If I close the sdfileid earlier, gridid becomes invalid. So close the sdfileid now. KY 2014-10-24
     if (true == isgeofile || false == check_pass_fileid_key)
-                SDend(sdfileid);
+                HDF4HandleCache::sd_end(sdfileid);
     //
     return false;
     
@@ -1855,13 +1848,13 @@ void HDFEOS2Array_RealField::close_fileid(const int gsfileid, const int sdfileid
     if (true == isgeofile || false == HDF4RequestHandler::get_pass_fileid()) {
 
         if (sdfileid != -1)
-            SDend(sdfileid);
+            HDF4HandleCache::sd_end(sdfileid);
 
         if (gsfileid != -1){
             if (""==gridname) 
-                SWclose(gsfileid);
+                HDF4HandleCache::eos_close(gsfileid, false);
             if (""==swathname)
-                GDclose(gsfileid);
+                HDF4HandleCache::eos_close(gsfileid, true);
         }
 
     }
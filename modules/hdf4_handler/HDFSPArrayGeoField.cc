@@ -19,6 +19,7 @@
 #include <BESDebug.h>
 #include "HDFCFUtil.h"
 #include "HDF4RequestHandler.h"
+#include "HDF4HandleCache.h"
 
 using namespace std;
 using namespace libdap;
@@ -213,7 +214,7 @@ HDFSPArrayGeoField::readtrmml2_v6 (const int32 * offset32, const int32 * count32
     int32 sdid = -1;
 
     if(false == check_pass_fileid_key) {
-        sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        sdid = HDF4HandleCache::sd_start(filename);
         if (sdid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
@@ -548,7 +549,7 @@ HDFSPArrayGeoField::readtrmml3_v7 (const int32 * offset32,
     int32 sdid = -1;
 
     if(false == check_pass_fileid_key) {
-        sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        sdid = HDF4HandleCache::sd_start(filename);
         if (sdid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
@@ -658,7 +659,7 @@ HDFSPArrayGeoField::readobpgl2 (int32 * offset32, int32 * count32,
     int32 sdid = -1;
 
     if(false == check_pass_fileid_key) {
-        sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        sdid = HDF4HandleCache::sd_start(filename);
         if (sdid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
@@ -972,7 +973,7 @@ HDFSPArrayGeoField::readobpgl3 (const int *offset,  const int *step, const int n
     int32 sdid = -1;
 
     if(false == check_pass_fileid_key) {
-        sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        sdid = HDF4HandleCache::sd_start(filename);
         if (sdid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
@@ -1392,7 +1393,7 @@ HDFSPArrayGeoField::readceravgsyn (int32 * offset32, int32 * count32,
     int32 sdid = -1;
 
     if(false == check_pass_fileid_key) {
-        sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        sdid = HDF4HandleCache::sd_start(filename);
         if (sdid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
@@ -1517,7 +1518,7 @@ HDFSPArrayGeoField::readceres4ig (const int32 * offset32, const int32 * count32,
     int32 sdid = -1;
 
     if(false == check_pass_fileid_key) {
-        sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        sdid = HDF4HandleCache::sd_start(filename);
         if (sdid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
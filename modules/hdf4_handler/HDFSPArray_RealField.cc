@@ -16,6 +16,7 @@
 #include "BESInternalError.h"
 #include "HDFCFUtil.h"
 #include "HDF4RequestHandler.h"
+#include "HDF4HandleCache.h"
 
 //#include "BESH4MCache.h"
 #include "dodsutil.h"
@@ -165,7 +166,7 @@ HDFSPArray_RealField::read ()
 
     // Obtain SD ID.
     if (false == check_pass_fileid_key) {
-        sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+        sdid = HDF4HandleCache::sd_start(filename);
         if (sdid < 0) {
             ostringstream eherr;
             eherr << "File " << filename.c_str () << " cannot be open.";
@@ -178,7 +179,7 @@ HDFSPArray_RealField::read ()
 
         if (true == HDF4RequestHandler::get_enable_metadata_cachefile()) {
 
-            sdid = SDstart (const_cast < char *>(filename.c_str ()), DFACC_READ);
+            sdid = HDF4HandleCache::sd_start(filename);
             if (sdid < 0) {
                 ostringstream eherr;
                 eherr << "File " << filename.c_str () << " cannot be open.";
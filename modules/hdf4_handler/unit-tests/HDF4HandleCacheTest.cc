@@ -0,0 +1,253 @@
+/////////////////////////////////////////////////////////////////////////////
+// This file is part of the hdf4 data handler for the OPeNDAP data server.
+// Tests for the cache of HDF4 SD and HDF-EOS2 handles.
+// Copyright (c) The HDF Group
+/////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include <string>
+
+#ifdef USE_HDFEOS2_LIB
+#include "HdfEosDef.h"
+#endif
+
+#include "HDF4HandleCache.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+class HDF4HandleCacheTest: public CppUnit::TestFixture {
+    static string file(const string &name)
+    {
+        return string(TEST_BUILD_DIR) + "/" + name;
+    }
+
+    static void set_mtime(const string &path, time_t mtime)
+    {
+        struct utimbuf times = { mtime, mtime };
+        CPPUNIT_ASSERT(utime(path.c_str(), &times) == 0);
+    }
+
+    // Make an HDF4 file with one SDS
+    static void make_sd_file(const string &path, const string &sds_name, time_t mtime)
+    {
+        unlink(path.c_str());
+        int32 sdid = SDstart(const_cast<char *>(path.c_str()), DFACC_CREATE);
+        CPPUNIT_ASSERT(sdid != FAIL);
+        int32 dims[1] = { 4 };
+        int32 sdsid = SDcreate(sdid, const_cast<char *>(sds_name.c_str()), DFNT_INT32, 1, dims);
+        CPPUNIT_ASSERT(sdsid != FAIL);
+        SDendaccess(sdsid);
+        SDend(sdid);
+        set_mtime(path, mtime);
+    }
+
+    static bool sd_is_open(int32 sdid)
+    {
+        int32 ndatasets, nattrs;
+        return SDfileinfo(sdid, &ndatasets, &nattrs) != FAIL;
+    }
+
+    static bool has_sds(int32 sdid, const string &sds_name)
+    {
+        return SDnametoindex(sdid, const_cast<char *>(sds_name.c_str())) != FAIL;
+    }
+
+#ifdef USE_HDFEOS2_LIB
+    // Make an HDF-EOS2 file with one grid
+    static void make_grid_file(const string &path, const string &grid_name, time_t mtime)
+    {
+        unlink(path.c_str());
+        int32 gfid = GDopen(const_cast<char *>(path.c_str()), DFACC_CREATE);
+        CPPUNIT_ASSERT(gfid != FAIL);
+        float64 upleft[2] = { -180000000.0, 90000000.0 };
+        float64 lowright[2] = { 180000000.0, -90000000.0 };
+        int32 gridid = GDcreate(gfid, const_cast<char *>(grid_name.c_str()), 4, 2, upleft, lowright);
+        CPPUNIT_ASSERT(gridid != FAIL);
+        GDdetach(gridid);
+        GDclose(gfid);
+        set_mtime(path, mtime);
+    }
+
+    static bool grid_is_attached(int32 gridid)
+    {
+        int32 xdim, ydim;
+        float64 upleft[2], lowright[2];
+        return GDgridinfo(gridid, &xdim, &ydim, upleft, lowright) != FAIL;
+    }
+#endif
+
+public:
+    HDF4HandleCacheTest() = default;
+    ~HDF4HandleCacheTest() override = default;
+
+    void setUp() override
+    {
+        make_sd_file(file("a.hdf"), "a", 1000000);
+        make_sd_file(file("b.hdf"), "b", 1000000);
+        make_sd_file(file("c.hdf"), "c", 1000000);
+        HDF4HandleCache::set_max_entries(4);
+    }
+
+    void tearDown() override
+    {
+        HDF4HandleCache::clear();
+        HDF4HandleCache::set_max_entries(0);
+    }
+
+    void sd_reuse_test()
+    {
+        int32 sdid1 = HDF4HandleCache::sd_start(file("a.hdf"));
+        int32 sdid2 = HDF4HandleCache::sd_start(file("a.hdf"));
+        CPPUNIT_ASSERT(sdid1 != FAIL);
+        CPPUNIT_ASSERT_EQUAL(sdid1, sdid2);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), HDF4HandleCache::size());
+
+        CPPUNIT_ASSERT_EQUAL(SUCCEED, HDF4HandleCache::sd_end(sdid1));
+        CPPUNIT_ASSERT_EQUAL(SUCCEED, HDF4HandleCache::sd_end(sdid2));
+        CPPUNIT_ASSERT(sd_is_open(sdid1));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), HDF4HandleCache::size());
+    }
+
+    // With no entries, every sd_start() opens the file and sd_end() closes it.
+    void disabled_test()
+    {
+        HDF4HandleCache::set_max_entries(0);
+        int32 sdid = HDF4HandleCache::sd_start(file("a.hdf"));
+        CPPUNIT_ASSERT(sdid != FAIL);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), HDF4HandleCache::size());
+        HDF4HandleCache::sd_end(sdid);
+        CPPUNIT_ASSERT(!sd_is_open(sdid));
+    }
+
+    // A file that changed is opened again; the old ID is closed. The HDF4
+    // library finds open files by name, so only the file's time is changed
+    // here. HandleCacheTest covers replaced files that are in use.
+    void mtime_test()
+    {
+        int32 sdid = HDF4HandleCache::sd_start(file("a.hdf"));
+        HDF4HandleCache::sd_end(sdid);
+        CPPUNIT_ASSERT(sd_is_open(sdid));
+
+        set_mtime(file("a.hdf"), 2000000);
+
+        sdid = HDF4HandleCache::sd_start(file("a.hdf"));
+        CPPUNIT_ASSERT(has_sds(sdid, "a"));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), HDF4HandleCache::size());
+        HDF4HandleCache::sd_end(sdid);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), HDF4HandleCache::size());
+    }
+
+    void eviction_test()
+    {
+        HDF4HandleCache::set_max_entries(2);
+        int32 a = HDF4HandleCache::sd_start(file("a.hdf"));
+        HDF4HandleCache::sd_end(a);
+        int32 b = HDF4HandleCache::sd_start(file("b.hdf"));
+        HDF4HandleCache::sd_end(b);
+        int32 c = HDF4HandleCache::sd_start(file("c.hdf"));
+        HDF4HandleCache::sd_end(c);
+
+        CPPUNIT_ASSERT_EQUAL(size_t(2), HDF4HandleCache::size());
+        CPPUNIT_ASSERT(!sd_is_open(a));
+        CPPUNIT_ASSERT(sd_is_open(b));
+        CPPUNIT_ASSERT(sd_is_open(c));
+    }
+
+    // A read that throws may not call sd_end(); the ID is released when the request ends.
+    void end_request_test()
+    {
+        HDF4HandleCache::set_max_entries(1);
+        int32 a = HDF4HandleCache::sd_start(file("a.hdf"));
+        int32 b = HDF4HandleCache::sd_start(file("b.hdf"));
+        HDF4HandleCache::sd_end(b);
+        CPPUNIT_ASSERT(sd_is_open(a));
+
+        HDF4HandleCache::end_request();
+        int32 c = HDF4HandleCache::sd_start(file("c.hdf"));
+        HDF4HandleCache::sd_end(c);
+        CPPUNIT_ASSERT(!sd_is_open(a));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), HDF4HandleCache::size());
+    }
+
+    // IDs the cache did not open, e.g. those passed from the DDS, are closed.
+    void not_cached_test()
+    {
+        int32 sdid = SDstart(const_cast<char *>(file("a.hdf").c_str()), DFACC_READ);
+        CPPUNIT_ASSERT(sdid != FAIL);
+        CPPUNIT_ASSERT_EQUAL(SUCCEED, HDF4HandleCache::sd_end(sdid));
+        CPPUNIT_ASSERT(!sd_is_open(sdid));
+        CPPUNIT_ASSERT_EQUAL(size_t(0), HDF4HandleCache::size());
+    }
+
+#ifdef USE_HDFEOS2_LIB
+    // An attached grid keeps its file open and is detached first.
+    void grid_test()
+    {
+        make_grid_file(file("grid.hdf"), "g", 1000000);
+
+        int32 gfid = HDF4HandleCache::eos_open(file("grid.hdf"), true);
+        CPPUNIT_ASSERT(gfid != FAIL);
+        int32 gridid = HDF4HandleCache::eos_attach(gfid, "g", true);
+        CPPUNIT_ASSERT(gridid != FAIL);
+        HDF4HandleCache::eos_close(gfid, true);
+        CPPUNIT_ASSERT(grid_is_attached(gridid));
+
+        HDF4HandleCache::eos_detach(gridid, true);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), HDF4HandleCache::size());
+
+        int32 gfid2 = HDF4HandleCache::eos_open(file("grid.hdf"), true);
+        CPPUNIT_ASSERT_EQUAL(gfid, gfid2);
+        int32 gridid2 = HDF4HandleCache::eos_attach(gfid2, "g", true);
+        CPPUNIT_ASSERT_EQUAL(gridid, gridid2);
+        HDF4HandleCache::eos_detach(gridid2, true);
+        HDF4HandleCache::eos_close(gfid2, true);
+
+        HDF4HandleCache::set_max_entries(0);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), HDF4HandleCache::size());
+        CPPUNIT_ASSERT(!grid_is_attached(gridid));
+    }
+
+    // Grids of a file opened without the cache are not cached.
+    void grid_not_cached_test()
+    {
+        make_grid_file(file("grid.hdf"), "g", 1000000);
+
+        int32 gfid = GDopen(const_cast<char *>(file("grid.hdf").c_str()), DFACC_READ);
+        int32 gridid = HDF4HandleCache::eos_attach(gfid, "g", true);
+        CPPUNIT_ASSERT(gridid != FAIL);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), HDF4HandleCache::size());
+        HDF4HandleCache::eos_detach(gridid, true);
+        CPPUNIT_ASSERT(!grid_is_attached(gridid));
+        GDclose(gfid);
+    }
+#endif
+
+    CPPUNIT_TEST_SUITE( HDF4HandleCacheTest );
+
+    CPPUNIT_TEST(sd_reuse_test);
+    CPPUNIT_TEST(disabled_test);
+    CPPUNIT_TEST(mtime_test);
+    CPPUNIT_TEST(eviction_test);
+    CPPUNIT_TEST(end_request_test);
+    CPPUNIT_TEST(not_cached_test);
+#ifdef USE_HDFEOS2_LIB
+    CPPUNIT_TEST(grid_test);
+    CPPUNIT_TEST(grid_not_cached_test);
+#endif
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(HDF4HandleCacheTest);
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<HDF4HandleCacheTest>(argc, argv, "cerr,h4") ? 0 : 1;
+}
@@ -39,6 +39,7 @@
 #include <libdap/InternalErr.h>
 
 #include "HDF5Array.h"
+#include "HDF5FileIdCache.h"
 #include "HDF5Structure.h"
 #include "HDF5Str.h"
 
@@ -108,7 +109,7 @@ bool HDF5Array::read()
 	    << " data_size=" << d_memneed << " length=" << length()
 	    << endl);
 
-    hid_t file_id = H5Fopen(dataset().c_str(),H5F_ACC_RDONLY,H5P_DEFAULT);
+    hid_t file_id = HDF5FileIdCache::open_file(dataset());
 
     BESDEBUG("h5","variable name is "<<name() <<endl);
     BESDEBUG("h5","variable path is  "<<var_path <<endl);
@@ -125,7 +126,7 @@ bool HDF5Array::read()
     hid_t dtype_id = H5Dget_type(dset_id);
     if(dtype_id < 0) {
         H5Dclose(dset_id);
-        H5Fclose(file_id);
+        HDF5FileIdCache::close_file(file_id);
         throw InternalErr(__FILE__,__LINE__, "Fail to obtain the datatype .");
     }
 
@@ -143,13 +144,13 @@ bool HDF5Array::read()
 	    ret_ref = m_array_of_reference(dset_id,dtype_id);
             H5Tclose(dtype_id);
             H5Dclose(dset_id);
-            H5Fclose(file_id);
+            HDF5FileIdCache::close_file(file_id);
  
         }
         catch(...) {
             H5Tclose(dtype_id);
             H5Dclose(dset_id);
-            H5Fclose(file_id);
+            HDF5FileIdCache::close_file(file_id);
             throw;
  
         }
@@ -162,13 +163,13 @@ bool HDF5Array::read()
     catch(...) {
         H5Tclose(dtype_id);
         H5Dclose(dset_id);
-        H5Fclose(file_id);
+        HDF5FileIdCache::close_file(file_id);
         throw; 
     }
 
     H5Tclose(dtype_id);
     H5Dclose(dset_id);
-    H5Fclose(file_id);
+    HDF5FileIdCache::close_file(file_id);
     
     return true;
 }
@@ -590,8 +590,8 @@ handle_data_with_mem_cache(H5DataType h5_dtype, size_t total_elems,const short c
         auto new_mem_cache_ele = new_mem_cache_ele_unique.release();
        	new_mem_cache_ele->set_databuf(buf);
 
-        // Add this entry to the cache list
-       	mem_data_cache->add(new_mem_cache_ele, cache_key);
+        // Add this entry to the cache list; its size counts against H5.LargeDataMemCacheSize.MB
+       	mem_data_cache->add(new_mem_cache_ele, cache_key, buf.size());
     }
 
 }
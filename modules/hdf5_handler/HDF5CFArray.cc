@@ -35,6 +35,7 @@
 
 #include <libdap/Str.h>
 #include "HDF5RequestHandler.h"
+#include "HDF5FileIdCache.h"
 #include "HDF5CFArray.h"
 #include "h5cfdaputil.h"
 #include "ObjMemCache.h"
@@ -278,7 +279,7 @@ void HDF5CFArray::read_data_NOT_from_mem_cache(bool add_mem_cache,void*buf) {
    
     bool pass_fileid = HDF5RequestHandler::get_pass_fileid();
     if(false == pass_fileid) {
-        if ((fileid = H5Fopen(filename.c_str(),H5F_ACC_RDONLY,H5P_DEFAULT))<0) {
+        if ((fileid = HDF5FileIdCache::open_file(filename))<0) {
             ostringstream eherr;
             eherr << "HDF5 File " << filename 
                   << " cannot be opened. "<<endl;
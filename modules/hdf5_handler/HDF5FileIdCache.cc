@@ -0,0 +1,97 @@
+// This file is part of the hdf5_handler implementing for the CF-compliant
+// Copyright (c) 2011-2023 The HDF Group, Inc. and OPeNDAP, Inc.
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+// You can contact The HDF Group, Inc. at 410 E University Ave,
+// Suite 200, Champaign, IL 61820
+
+////////////////////////////////////////////////////////////////////////////////
+/// \file HDF5FileIdCache.cc
+/// \brief A cache of open HDF5 file IDs shared by the array read() methods.
+///
+/// The cache keeps at most H5.FileIdCacheEntries files open; a file that a
+/// read() is using is never closed, so it may briefly hold more. An entry is
+/// reused only when the file's modification time has not changed since it was
+/// opened. The bookkeeping is done by bes::HandleCache, which the netCDF and
+/// HDF4 handlers use for their handles too.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include "HDF5FileIdCache.h"
+
+using namespace std;
+
+// The cache is created when it is first used. It is empty by the time it is
+// destroyed because the request handler's destructor calls clear().
+bes::HandleCache<hid_t> &HDF5FileIdCache::cache()
+{
+    static bes::HandleCache<hid_t> the_cache([](const hid_t &fileid) { return static_cast<int>(H5Fclose(fileid)); },
+                                             0, "h5");
+    return the_cache;
+}
+
+/// Open an HDF5 file read-only, using the cached ID if the file is open.
+///
+/// \param filename The HDF5 file
+/// \return The file ID or a negative value if the file cannot be opened.
+/// Release the ID with close_file(), not H5Fclose().
+hid_t HDF5FileIdCache::open_file(const string &filename)
+{
+    time_t mtime;
+    if (!cache().enabled() || !bes::HandleCache<hid_t>::file_mtime(filename, mtime))
+        return H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+
+    hid_t fileid;
+    if (cache().find(filename, mtime, fileid))
+        return fileid;
+
+    fileid = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (fileid >= 0)
+        cache().insert(filename, mtime, fileid);
+
+    return fileid;
+}
+
+/// Release a file ID returned by open_file(). The file stays open if it is
+/// cached. IDs that are not in the cache are closed.
+void HDF5FileIdCache::close_file(hid_t fileid)
+{
+    if (fileid < 0)
+        return;
+
+    if (!cache().release(fileid))
+        H5Fclose(fileid);
+}
+
+/// Set the number of files kept open, H5.FileIdCacheEntries. Zero turns the cache off.
+void HDF5FileIdCache::set_max_entries(unsigned int max_entries)
+{
+    cache().set_max_entries(max_entries);
+}
+
+/// Release the IDs a failed read() did not close. Registered with
+/// BESInterface::add_end_request_callback().
+void HDF5FileIdCache::end_request()
+{
+    cache().end_request();
+}
+
+/// Close all the cached files.
+void HDF5FileIdCache::clear()
+{
+    cache().clear();
+}
@@ -0,0 +1,56 @@
+// This file is part of the hdf5_handler implementing for the CF-compliant
+// Copyright (c) 2011-2023 The HDF Group, Inc. and OPeNDAP, Inc.
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+// You can contact The HDF Group, Inc. at 410 E University Ave,
+// Suite 200, Champaign, IL 61820
+
+////////////////////////////////////////////////////////////////////////////////
+/// \file HDF5FileIdCache.h
+/// \brief A cache of open HDF5 file IDs shared by the array read() methods.
+///
+/// Without this cache, every array read() opens the HDF5 file, reads one
+/// variable and closes the file again, so the HDF5 library reads the
+/// superblock, the root group and the object headers again for every variable.
+/// With it, the file stays open across the variable reads of a request and
+/// across requests handled by the same BES process.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _HDF5FILEIDCACHE_H
+#define _HDF5FILEIDCACHE_H
+
+#include <string>
+
+#include "hdf5.h"
+
+#include "HandleCache.h"
+
+class HDF5FileIdCache {
+public:
+    static hid_t open_file(const std::string &filename);
+    static void close_file(hid_t fileid);
+
+    static void set_max_entries(unsigned int max_entries);
+    static void end_request();
+    static void clear();
+
+private:
+    static bes::HandleCache<hid_t> &cache();
+};
+
+#endif
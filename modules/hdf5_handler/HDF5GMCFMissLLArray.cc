@@ -35,6 +35,7 @@
 #include <BESDebug.h>
 #include <libdap/InternalErr.h>
 #include "HDF5RequestHandler.h"
+#include "HDF5FileIdCache.h"
 #include "HDF5GMCFMissLLArray.h"
 #include "h5apicompatible.h"
 
@@ -115,7 +116,7 @@ void HDF5GMCFMissLLArray::obtain_aqu_obpg_l3_ll(const int64_t* offset, const int
 
     bool check_pass_fileid_key = HDF5RequestHandler::get_pass_fileid();
     if (false == check_pass_fileid_key) {
-        if ((fileid = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)) < 0) {
+        if ((fileid = HDF5FileIdCache::open_file(filename)) < 0) {
             ostringstream eherr;
             eherr << "HDF5 File " << filename << " cannot be opened. " << endl;
             throw InternalErr(__FILE__, __LINE__, eherr.str());
@@ -239,7 +240,7 @@ void HDF5GMCFMissLLArray::obtain_gpm_l3_ll(const int64_t* offset, const int64_t*
     bool check_pass_fileid_key = HDF5RequestHandler::get_pass_fileid();
 
     if (false == check_pass_fileid_key) {
-        if ((fileid = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)) < 0) {
+        if ((fileid = HDF5FileIdCache::open_file(filename)) < 0) {
             ostringstream eherr;
             eherr << "HDF5 File " << filename << " cannot be opened. " << endl;
             throw InternalErr(__FILE__, __LINE__, eherr.str());
@@ -340,7 +341,7 @@ void HDF5GMCFMissLLArray::obtain_gpm_l3_ll(const int64_t* offset, const int64_t*
     }
     catch (...) {
         H5Gclose(grid_grp_id);
-        H5Fclose(fileid);
+        HDF5CFUtil::close_fileid(fileid, check_pass_fileid_key);
         throw;
 
     }
@@ -576,7 +577,7 @@ void HDF5GMCFMissLLArray::obtain_gpm_l3_new_grid_info(hid_t file,
 
    herr_t ret_o= H5OVISIT(file, H5_INDEX_NAME, H5_ITER_INC, visit_obj_cb, (void*)&attr_na);
    if(ret_o < 0){
-        H5Fclose(file);
+        HDF5CFUtil::close_fileid(file, HDF5RequestHandler::get_pass_fileid());
         throw InternalErr(__FILE__, __LINE__, "H5OVISIT failed. ");
    }
    else if(ret_o >0) {
@@ -606,7 +607,7 @@ void HDF5GMCFMissLLArray::obtain_gpm_l3_new_grid_info(hid_t file,
         // In this round, we need to release the memory allocated for the second grid info.
         herr_t ret_o2= H5OVISIT(file, H5_INDEX_NAME, H5_ITER_INC, visit_obj_cb, (void*)&attr_na);
         if(ret_o2 < 0) {
-            H5Fclose(file);
+            HDF5CFUtil::close_fileid(file, HDF5RequestHandler::get_pass_fileid());
             throw InternalErr(__FILE__, __LINE__, "H5OVISIT failed again. ");
         }
         else if(ret_o2>0) {
@@ -38,6 +38,7 @@
 #include <libdap/InternalErr.h>
 
 #include "HDF5RequestHandler.h"
+#include "HDF5FileIdCache.h"
 #include "HDF5GMSPCFArray.h"
 
 using namespace std;
@@ -109,7 +110,7 @@ void HDF5GMSPCFArray::read_data_NOT_from_mem_cache(bool /*add_cache*/,void*/*buf
     hid_t memtype = -1;
 
     if(false == check_pass_fileid_key) {
-        if ((fileid = H5Fopen(filename.c_str(),H5F_ACC_RDONLY,H5P_DEFAULT))<0) {
+        if ((fileid = HDF5FileIdCache::open_file(filename))<0) {
             ostringstream eherr;
             eherr << "HDF5 File " << filename 
                   << " cannot be opened. "<<endl;
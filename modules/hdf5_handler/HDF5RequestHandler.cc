@@ -50,6 +50,7 @@
 #include "HDF5RequestHandler.h"
 #include "HDF5CFModule.h"
 #include "HDF5_DDS.h"
+#include "HDF5FileIdCache.h"
 
 #include <BESDASResponse.h>
 #include <libdap/Ancillary.h>
@@ -65,6 +66,7 @@
 #include <TheBESKeys.h>
 #include <BESDebug.h>
 #include <BESStopWatch.h>
+#include <BESInterface.h>
 #include "h5get.h"
 
 #define HDF5_NAME "h5"
@@ -125,7 +127,9 @@ extern void read_cfdmr(DMR *dmr, const string & filename,hid_t fileid);
 unsigned int HDF5RequestHandler::_mdcache_entries = 500;
 unsigned int HDF5RequestHandler::_lrdcache_entries = 0;
 unsigned int HDF5RequestHandler::_srdcache_entries = 0;
+unsigned int HDF5RequestHandler::_lrdcache_size_mb = 0;
 float HDF5RequestHandler::_cache_purge_level = 0.2F;
+unsigned int HDF5RequestHandler::_fileid_cache_entries = 0;
 
 // Metadata object cache at DAS,DDS and DMR.
 ObjMemCache *HDF5RequestHandler::das_cache = nullptr;
@@ -214,6 +218,9 @@ HDF5RequestHandler::HDF5RequestHandler(const string & name)
     load_config();
 #endif
 
+    // Drop the file IDs held by reads that failed
+    BESInterface::add_end_request_callback(HDF5FileIdCache::end_request);
+
     BESDEBUG(HDF5_NAME, prolog << "END" << endl);
 }
 
@@ -226,7 +233,8 @@ HDF5RequestHandler::~HDF5RequestHandler()
     delete dmr_cache;
     delete lrdata_mem_cache;
     delete srdata_mem_cache;
-     
+
+    HDF5FileIdCache::clear();
 }
 
 /**
@@ -244,6 +252,7 @@ void HDF5RequestHandler::load_config()
     HDF5RequestHandler::_mdcache_entries   = get_uint_key("H5.MetaDataMemCacheEntries", 0);
     HDF5RequestHandler::_lrdcache_entries  = get_uint_key("H5.LargeDataMemCacheEntries", 0);
     HDF5RequestHandler::_srdcache_entries  = get_uint_key("H5.SmallDataMemCacheEntries", 0);
+    HDF5RequestHandler::_lrdcache_size_mb  = get_uint_key("H5.LargeDataMemCacheSize.MB", 0);
     HDF5RequestHandler::_cache_purge_level = get_float_key("H5.CachePurgeLevel", 0.2F);
 
     if (get_mdcache_entries()) {  // else it stays at its default of null
@@ -280,6 +289,10 @@ void HDF5RequestHandler::load_config()
         _pass_fileid  = key_value;
     BESDEBUG(HDF5_NAME, prolog << "H5.EnablePassFileID: " << (_pass_fileid?"true":"false") << endl);
 
+    _fileid_cache_entries = get_uint_key("H5.FileIdCacheEntries", 0);
+    HDF5FileIdCache::set_max_entries(_fileid_cache_entries);
+    BESDEBUG(HDF5_NAME, prolog << "H5.FileIdCacheEntries: " << _fileid_cache_entries << endl);
+
     key_value = obtain_beskeys_info("H5.DisableStructMetaAttr",has_key);
     if (has_key)
         _disable_structmeta  = key_value;
@@ -440,7 +453,9 @@ void HDF5RequestHandler::load_config_cf_cache() {
     bool has_key = false;
     if (get_lrdcache_entries()) {
 
-        lrdata_mem_cache = new ObjMemCache(get_lrdcache_entries(), get_cache_purge_level());
+        // The cached arrays are added with their size, so the cache can also be bounded by bytes.
+        lrdata_mem_cache = new ObjMemCache(get_lrdcache_entries(), get_cache_purge_level(),
+                                           (unsigned long long)get_lrdcache_size_mb() * 1024 * 1024);
         bool has_LFMC_config = false;
         bool key_value = obtain_beskeys_info("H5.LargeDataMemCacheConfig",has_key);
         if (has_key)
@@ -98,7 +98,9 @@ class HDF5RequestHandler:public BESRequestHandler {
     static unsigned int get_mdcache_entries() { return _mdcache_entries;}
     static unsigned int get_lrdcache_entries() { return _lrdcache_entries;}
     static unsigned int get_srdcache_entries() { return _srdcache_entries;}
+    static unsigned int get_lrdcache_size_mb() { return _lrdcache_size_mb;}
     static float get_cache_purge_level() { return _cache_purge_level;}
+    static unsigned int get_fileid_cache_entries() { return _fileid_cache_entries;}
 
     
     static ObjMemCache* get_lrdata_mem_cache() {return lrdata_mem_cache;}
@@ -153,7 +155,9 @@ class HDF5RequestHandler:public BESRequestHandler {
     static unsigned int _mdcache_entries;
     static unsigned int _lrdcache_entries;
     static unsigned int _srdcache_entries;
+    static unsigned int _lrdcache_size_mb;
     static float _cache_purge_level;
+    static unsigned int _fileid_cache_entries;
 
     static ObjMemCache *das_cache;
     static ObjMemCache *dds_cache;
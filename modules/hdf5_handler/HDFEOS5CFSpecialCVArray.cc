@@ -36,6 +36,7 @@
 #include <libdap/InternalErr.h>
 
 #include "HDF5RequestHandler.h"
+#include "HDF5FileIdCache.h"
 #include "HDFEOS5CFSpecialCVArray.h"
 
 using namespace std;
@@ -81,7 +82,7 @@ void HDFEOS5CFSpecialCVArray::read_data_NOT_from_mem_cache(bool /*add_cache*/, v
     }
 
     if(false == check_pass_fileid_key) {
-        if ((fileid = H5Fopen(filename.c_str(),H5F_ACC_RDONLY,H5P_DEFAULT))<0) {
+        if ((fileid = HDF5FileIdCache::open_file(filename))<0) {
 
             ostringstream eherr;
             eherr << "HDF5 File " << filename 
@@ -82,6 +82,17 @@ public:
      */
     virtual const libdap::DDS* getDDS() = 0;
 
+    /**
+     * Whether the variables of the loaded DDS can be read at the same
+     * time as those of other member datasets, from other threads. Only
+     * meaningful after getDDS(). Most handlers' read() methods are not
+     * thread safe, so the default is false.
+     */
+    virtual bool canReadInParallel() const
+    {
+        return false;
+    }
+
     /**
      * Get the size of the given dimension named dimName
      * cached within the dataset.  If not found in cache, throws.
@@ -140,6 +151,9 @@ public:
     /** Load the values in the dimension cache from the input stream */
     virtual void loadDimensionCache(std::istream& istr) = 0;
 
+    /** Copy the dimensions in the dimension cache into dims */
+    virtual void getDimensionCache(std::vector<Dimension>& dims) const = 0;
+
 private:
     // data rep
     std::string _location; // non-empty location from which to load DDS
@@ -10,10 +10,12 @@
 #include "config.h"
 
 #include "AggMemberDatasetDimensionCache.h"
+#include "AggMemberDatasetDimensionIndex.h"
 #include "AggMemberDataset.h"
 #include <string>
 #include <sstream>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <libdap/util.h>
 #include "BESInternalError.h"
@@ -296,6 +298,114 @@ bool AggMemberDatasetDimensionCache::is_valid(const string &cache_file_name, con
 }
 
 
+/**
+ * @return The LMT of the source dataset file, or 0 if it is not a file.
+ */
+int64_t AggMemberDatasetDimensionCache::get_dataset_mtime(const string &local_id) const
+{
+    string datasetFileName = BESUtil::assemblePath(d_dataRootDir, local_id, true);
+    struct stat buf;
+    if (stat(datasetFileName.c_str(), &buf) == 0)
+        return buf.st_mtime;
+
+    return 0;
+}
+
+/**
+ * Write a new dimension index and add it to the cache. The old index, if
+ * any, is purged first; processes that have it mapped keep using it. If
+ * another process makes the new index first, this does nothing.
+ *
+ * @param index_file_name The index's cache file name
+ * @param entries The dimensions of the aggregation's members
+ */
+void AggMemberDatasetDimensionCache::write_dimension_index(const string &index_file_name,
+    const std::vector<AggMemberDatasetDimensionIndex::Entry> &entries)
+{
+    purge_file(index_file_name);
+
+    int fd;
+    if (!create_and_lock(index_file_name, fd)) {
+        BESDEBUG("cache", prolog << "Another process made the dimension index: " << index_file_name << endl);
+        return;
+    }
+
+    try {
+        AggMemberDatasetDimensionIndex::write(fd, entries);
+    }
+    catch (...) {
+        // Not purge_file(); the partial file was never added to the cache size.
+        unlink(index_file_name.c_str());
+        unlock_and_close(index_file_name);
+        throw;
+    }
+
+    exclusive_to_shared_lock(fd);
+
+    unsigned long long size = update_cache_info(index_file_name);
+    if (cache_too_big(size))
+        update_and_purge(index_file_name);
+
+    unlock_and_close(index_file_name);
+}
+
+/**
+ * Loads the dimensions of all the members of an aggregation using one index
+ * file for the aggregation (see AggMemberDatasetDimensionIndex) instead of a
+ * cache file for each member. Members that are in the index, and whose
+ * source dataset file has not changed since they were indexed, are loaded
+ * from it. The others are loaded using their DDS and, if there were any (or
+ * members were removed), a new index is written.
+ *
+ * The index is a cache item like any other: it is counted in the cache's
+ * size and may be purged, in which case it is rebuilt the next time.
+ *
+ * @param aggregation_id Names the aggregation; the same id must be used each
+ * time the aggregation is loaded.
+ * @param granules The members of the aggregation
+ */
+void AggMemberDatasetDimensionCache::loadDimensionCache(const string &aggregation_id, const AMDList &granules)
+{
+    string index_file_name = get_cache_file_name(aggregation_id + "#dimension_index", true);
+    BESDEBUG("cache", prolog << "Dimension index file: " << index_file_name << endl);
+
+    AggMemberDatasetDimensionIndex index(index_file_name);
+    bool index_changed = true;
+    int fd;
+    if (get_read_lock(index_file_name, fd)) {
+        // The mapping stays valid once the lock is released, even if the file is purged.
+        index_changed = !index.open(fd);
+        unlock_and_close(index_file_name);
+    }
+
+    std::vector<AggMemberDatasetDimensionIndex::Entry> entries(granules.size());
+    auto entry = entries.begin();
+    for (const auto &granule: granules) {
+        AggMemberDataset *amd = granule.get();
+        entry->location = amd->getLocation();
+        entry->mtime = get_dataset_mtime(entry->location);
+
+        if (index.find(entry->location, entry->mtime, entry->dimensions)) {
+            for (const auto &dim: entry->dimensions)
+                amd->setDimensionCacheFor(dim, false);
+        }
+        else {
+            BESDEBUG("cache", prolog << "Loading dimensions from the DDS for: " << entry->location << endl);
+            amd->fillDimensionCacheByUsingDDS();
+            amd->getDimensionCache(entry->dimensions);
+            index_changed = true;
+        }
+
+        ++entry;
+    }
+
+    // If members were removed from the aggregation, drop them from the index.
+    if (index_changed || index.size() != entries.size())
+        write_dimension_index(index_file_name, entries);
+
+    BESDEBUG("cache", prolog << "END (aggregation_id=`" << aggregation_id << "')" << endl);
+}
+
 /**
  * Loads the dimensions of the passed  AggMemberDataset. If the dimensions are in the cache, and the cache file
  * is valid (length>0 and LMT < the LMT of the source dataset file) then the dimensions will be read from the
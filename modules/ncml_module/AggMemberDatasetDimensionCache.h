@@ -8,12 +8,15 @@
 #ifndef MODULES_NCML_MODULE_AGGMEMBERDATASETDIMENSIONCACHE_H_
 #define MODULES_NCML_MODULE_AGGMEMBERDATASETDIMENSIONCACHE_H_
 
+#include <cstdint>
+#include <string>
+
 #include "BESFileLockingCache.h"
+#include "AggMemberDataset.h"
+#include "AggMemberDatasetDimensionIndex.h"
 
 namespace agg_util
 {
-// Forward declaration
-class AggMemberDataset;
 
 /**
  * This child of BESFileLockingCache manifests a cache for the ncml_handler in which
@@ -28,6 +31,10 @@ class AggMemberDataset;
  * to locate the source dataset files in order to verify of the cache is up-to-date
  * and updates cache components as needed.
  *
+ * The dimensions of a joinExisting aggregation's members are kept in one binary
+ * index file per aggregation (see AggMemberDatasetDimensionIndex), so loading
+ * them does not open and lock a cache file for each member.
+ *
  */
 class AggMemberDatasetDimensionCache: public BESFileLockingCache
 {
@@ -44,6 +51,9 @@ private:
 	AggMemberDatasetDimensionCache();
 
 	bool is_valid(const std::string &cache_file_name, const std::string &dataset_file_name) const;
+	int64_t get_dataset_mtime(const std::string &local_id) const;
+	void write_dimension_index(const std::string &index_file_name,
+	    const std::vector<AggMemberDatasetDimensionIndex::Entry> &entries);
 
 
     static std::string getBesDataRootDirFromConfig();
@@ -67,6 +77,7 @@ public:
     AggMemberDatasetDimensionCache(const AggMemberDatasetDimensionCache &src) = delete;
 
     void loadDimensionCache(AggMemberDataset *amd);
+    void loadDimensionCache(const std::string &aggregation_id, const AMDList &granules);
 
 	~AggMemberDatasetDimensionCache() override = default;
 };
@@ -0,0 +1,271 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES ncml_module, part of the Hyrax data server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BESInternalError.h"
+#include "BESDebug.h"
+
+#include "AggMemberDatasetDimensionIndex.h"
+
+using namespace std;
+
+#define prolog std::string("AggMemberDatasetDimensionIndex::").append(__func__).append("() - ")
+
+// The file starts with the magic string, the format version and the number of entries.
+// Each entry is:
+//   uint32 location length, location, int64 mtime, uint32 number of dimensions,
+//   then for each dimension: uint32 name length, name, uint32 size.
+#define INDEX_MAGIC "NCMLDIMX"
+#define INDEX_MAGIC_LEN 8
+#define INDEX_VERSION 1
+
+namespace agg_util {
+
+namespace {
+
+/// Read values from the mapped file, checking each read stays inside it.
+class Reader {
+    const char *d_pos;
+    const char *d_end;
+
+public:
+    Reader(const char *pos, const char *end) : d_pos(pos), d_end(end) {}
+
+    const char *pos() const { return d_pos; }
+
+    template<typename T>
+    bool get(T &value) {
+        if (static_cast<size_t>(d_end - d_pos) < sizeof(T)) return false;
+        memcpy(&value, d_pos, sizeof(T));
+        d_pos += sizeof(T);
+        return true;
+    }
+
+    bool get(string &value) {
+        uint32_t len;
+        if (!get(len) || static_cast<size_t>(d_end - d_pos) < len) return false;
+        value.assign(d_pos, len);
+        d_pos += len;
+        return true;
+    }
+
+    bool skip_string() {
+        uint32_t len;
+        if (!get(len) || static_cast<size_t>(d_end - d_pos) < len) return false;
+        d_pos += len;
+        return true;
+    }
+};
+
+template<typename T>
+void put(string &buf, const T &value) {
+    buf.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void put(string &buf, const string &value) {
+    put(buf, static_cast<uint32_t>(value.size()));
+    buf.append(value);
+}
+
+} // namespace
+
+AggMemberDatasetDimensionIndex::~AggMemberDatasetDimensionIndex()
+{
+    if (d_map)
+        munmap(const_cast<char *>(d_map), d_map_size);
+}
+
+/**
+ * @brief Map the index file and find its entries
+ * @return False if the file does not exist or is not a valid index; true otherwise.
+ */
+bool AggMemberDatasetDimensionIndex::open()
+{
+    int fd = ::open(d_file_name.c_str(), O_RDONLY);
+    if (fd == -1) {
+        BESDEBUG("cache", prolog << "No index file: " << d_file_name << endl);
+        return false;
+    }
+
+    bool status = open(fd);
+    close(fd);  // The mapping holds a reference to the file
+    return status;
+}
+
+/**
+ * @brief Map an open index file and find its entries
+ *
+ * The mapping does not depend on the descriptor, which the caller still
+ * owns and may close (or unlock) once this returns.
+ *
+ * @param fd An open descriptor for the index file
+ * @return False if the file is not a valid index; true otherwise.
+ */
+bool AggMemberDatasetDimensionIndex::open(int fd)
+{
+    struct stat buf;
+    if (fstat(fd, &buf) == -1 || buf.st_size < INDEX_MAGIC_LEN)
+        return false;
+
+    void *map = mmap(nullptr, buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        BESDEBUG("cache", prolog << "Could not map " << d_file_name << ": " << strerror(errno) << endl);
+        return false;
+    }
+
+    d_map = static_cast<const char *>(map);
+    d_map_size = buf.st_size;
+
+    if (!read_entries()) {
+        BESDEBUG("cache", prolog << "The index file is not valid, it will be rebuilt: " << d_file_name << endl);
+        d_entries.clear();
+        return false;
+    }
+
+    BESDEBUG("cache", prolog << "Mapped " << d_entries.size() << " entries from " << d_file_name << endl);
+    return true;
+}
+
+/// Walk the entries in the mapped file and record where each one starts.
+bool AggMemberDatasetDimensionIndex::read_entries()
+{
+    if (memcmp(d_map, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0)
+        return false;
+
+    Reader reader(d_map + INDEX_MAGIC_LEN, d_map + d_map_size);
+    uint32_t version;
+    uint32_t count;
+    if (!reader.get(version) || version != INDEX_VERSION || !reader.get(count))
+        return false;
+
+    // Each entry takes at least 16 bytes; don't trust count from a damaged file
+    d_entries.reserve(std::min(static_cast<size_t>(count), d_map_size / 16));
+    for (uint32_t i = 0; i < count; ++i) {
+        string location;
+        if (!reader.get(location))
+            return false;
+        d_entries[location] = reader.pos();
+
+        int64_t mtime;
+        uint32_t num_dims;
+        if (!reader.get(mtime) || !reader.get(num_dims))
+            return false;
+        for (uint32_t d = 0; d < num_dims; ++d) {
+            uint32_t size;
+            if (!reader.skip_string() || !reader.get(size))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get the dimensions of a member dataset
+ * @param location The member's location
+ * @param mtime The member's current modification time. If the entry was made
+ * for a different time, the member has changed and the entry is not used.
+ * @param dimensions Value-result parameter; the member's dimensions
+ * @return True if the index holds current dimensions for the member.
+ */
+bool AggMemberDatasetDimensionIndex::find(const string &location, int64_t mtime, vector<Dimension> &dimensions) const
+{
+    auto it = d_entries.find(location);
+    if (it == d_entries.end())
+        return false;
+
+    // read_entries() checked the entry is well-formed
+    Reader reader(it->second, d_map + d_map_size);
+    int64_t entry_mtime;
+    uint32_t num_dims;
+    reader.get(entry_mtime);
+    if (entry_mtime != mtime) {
+        BESDEBUG("cache", prolog << location << " has changed since it was indexed" << endl);
+        return false;
+    }
+
+    reader.get(num_dims);
+    dimensions.clear();
+    dimensions.reserve(num_dims);
+    for (uint32_t d = 0; d < num_dims; ++d) {
+        string name;
+        uint32_t size;
+        reader.get(name);
+        reader.get(size);
+        dimensions.emplace_back(name, size);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write a new index file
+ *
+ * @param fd An open descriptor for a new, empty, index file
+ * @param entries The dimensions of the aggregation's members
+ */
+void AggMemberDatasetDimensionIndex::write(int fd, const vector<Entry> &entries)
+{
+    string buf(INDEX_MAGIC, INDEX_MAGIC_LEN);
+    put(buf, static_cast<uint32_t>(INDEX_VERSION));
+    put(buf, static_cast<uint32_t>(entries.size()));
+    for (const auto &entry: entries) {
+        put(buf, entry.location);
+        put(buf, entry.mtime);
+        put(buf, static_cast<uint32_t>(entry.dimensions.size()));
+        for (const auto &dim: entry.dimensions) {
+            put(buf, dim.name);
+            put(buf, static_cast<uint32_t>(dim.size));
+        }
+    }
+
+    const char *pos = buf.data();
+    size_t remaining = buf.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(fd, pos, remaining);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            throw BESInternalError(string("Could not write the dimension index: ") + strerror(errno),
+                                   __FILE__, __LINE__);
+        }
+        pos += written;
+        remaining -= written;
+    }
+
+    BESDEBUG("cache", prolog << "Wrote " << entries.size() << " entries" << endl);
+}
+
+} /* namespace agg_util */
@@ -0,0 +1,93 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES ncml_module, part of the Hyrax data server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef MODULES_NCML_MODULE_AGGMEMBERDATASETDIMENSIONINDEX_H_
+#define MODULES_NCML_MODULE_AGGMEMBERDATASETDIMENSIONINDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Dimension.h"
+
+namespace agg_util {
+
+/**
+ * A binary file that holds the dimensions of all the members of one
+ * aggregation. Each entry holds a member's location, the modification
+ * time of the member when its dimensions were read and the dimensions.
+ *
+ * The file is memory mapped and only the entries that are used are decoded,
+ * so loading the dimensions of a large aggregation reads one file, not one
+ * per member. The file is never changed in place. A new index is written to
+ * a new file once the old one has been removed, so processes that have the
+ * old one mapped are not affected. AggMemberDatasetDimensionCache keeps the
+ * files in its cache directory and locks them the way it locks other items.
+ *
+ * The file is in the host's byte order; it is a cache, not an exchange format.
+ */
+class AggMemberDatasetDimensionIndex {
+public:
+    /// The dimensions of one member dataset
+    struct Entry {
+        std::string location;
+        int64_t mtime = 0;
+        std::vector<Dimension> dimensions;
+    };
+
+private:
+    std::string d_file_name;
+
+    const char *d_map = nullptr;
+    size_t d_map_size = 0;
+
+    /// Location --> start of the entry's mtime in the mapped file
+    std::unordered_map<std::string, const char *> d_entries;
+
+    bool read_entries();
+
+public:
+    AggMemberDatasetDimensionIndex() = delete;
+    AggMemberDatasetDimensionIndex(const AggMemberDatasetDimensionIndex &) = delete;
+    AggMemberDatasetDimensionIndex &operator=(const AggMemberDatasetDimensionIndex &) = delete;
+
+    explicit AggMemberDatasetDimensionIndex(std::string file_name) : d_file_name(std::move(file_name)) {}
+
+    virtual ~AggMemberDatasetDimensionIndex();
+
+    bool open();
+    bool open(int fd);
+
+    /// @return The number of entries in the index
+    size_t size() const { return d_entries.size(); }
+
+    bool find(const std::string &location, int64_t mtime, std::vector<Dimension> &dimensions) const;
+
+    static void write(int fd, const std::vector<Entry> &entries);
+};
+
+} /* namespace agg_util */
+
+#endif /* MODULES_NCML_MODULE_AGGMEMBERDATASETDIMENSIONINDEX_H_ */
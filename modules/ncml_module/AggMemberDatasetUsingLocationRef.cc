@@ -86,6 +86,11 @@ AggMemberDatasetUsingLocationRef::getDDS()
     return pDDSRet;
 }
 
+bool AggMemberDatasetUsingLocationRef::canReadInParallel() const
+{
+    return _pDataResponse && _loader.getLoadedContainerType() == "dmrpp";
+}
+
 /////////////////////////////// Private Helpers ////////////////////////////////////
 void AggMemberDatasetUsingLocationRef::loadDDS()
 {
@@ -74,6 +74,10 @@ public:
      */
     const libdap::DDS* getDDS() override;
 
+    /** True if the location was loaded by the DMR++ handler, whose reads
+     * are thread safe. */
+    bool canReadInParallel() const override;
+
 private:
     // helpers
 
@@ -175,6 +175,12 @@ void AggMemberDatasetWithDimensionCacheBase::loadDimensionCache(std::istream& is
     loadDimensionCacheInternal(istr);
 }
 
+/* virtual */
+void AggMemberDatasetWithDimensionCacheBase::getDimensionCache(std::vector<Dimension>& dims) const
+{
+    dims = _dimensionCache;
+}
+
 Dimension*
 AggMemberDatasetWithDimensionCacheBase::findDimension(const std::string& dimName)
 {
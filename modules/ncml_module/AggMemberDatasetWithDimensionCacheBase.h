@@ -60,6 +60,7 @@ public:
     /** Append the values in the dimension cache to the output stream */
     virtual void saveDimensionCache(std::ostream& ostr);
     virtual void loadDimensionCache(std::istream& istr);
+    virtual void getDimensionCache(std::vector<Dimension>& dims) const;
 
 private:
     // Helper Functions
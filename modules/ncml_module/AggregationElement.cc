@@ -631,18 +631,23 @@ void AggregationElement::fillDimensionCacheForJoinExistingDimension(AMDList& gra
 
     	agg_util::AggMemberDatasetDimensionCache *aggDimCache = agg_util::AggMemberDatasetDimensionCache::get_instance();
 
-		AMDList::iterator endIt = granuleList.end();
-		for (AMDList::iterator it = granuleList.begin(); it != endIt; ++it) {
-			AggMemberDataset *amd = (*it).get();
-			if(aggDimCache) {
-				BESDEBUG("ncml", "AggregationElement::fillDimensionCacheForJoinExistingDimension() - Loading dimension cache for: " << (*it)->getLocation() << "..." << endl);
-				aggDimCache->loadDimensionCache(amd);
-			}
-			else {
+		if (aggDimCache) {
+			// One index for all the members of this aggregation, named by the NcML file and
+			// the join dimension. Not by the element's line; editing the file would leave the
+			// old index behind. Aggregations that share a name share an index, which is
+			// rewritten as needed since its entries are found by member location.
+			std::ostringstream aggregation_id;
+			aggregation_id << _parser->getParseFilename() << "#" << _dimName;
+			BESDEBUG("ncml", "AggregationElement::fillDimensionCacheForJoinExistingDimension() - Loading dimension cache for: " << aggregation_id.str() << "..." << endl);
+			aggDimCache->loadDimensionCache(aggregation_id.str(), granuleList);
+		}
+		else {
+			AMDList::iterator endIt = granuleList.end();
+			for (AMDList::iterator it = granuleList.begin(); it != endIt; ++it) {
 				BESDEBUG("ncml", "AggregationElement::fillDimensionCacheForJoinExistingDimension() - " <<
 						"WARNING NcML Dimension Caching is not configured or is not working! Loading dimensions from DDS for dataset: " <<
 						(*it)->getLocation() << "" << endl);
-				amd->fillDimensionCacheByUsingDDS();
+				(*it)->fillDimensionCacheByUsingDDS();
 			}
 		}
     }
@@ -44,6 +44,15 @@
 #include <libdap/Grid.h>
 #include "BESDebug.h"
 #include "BESStopWatch.h"
+#include "TheBESKeys.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
 
 // Outside includes (MINIMIZE THESE!)
 #include "NCMLDebug.h" // This the ONLY dependency on NCML Module I want in this class since the macros there are general it's ok...
@@ -59,6 +68,8 @@ using libdap::Vector;
 using std::string;
 using std::vector;
 
+#define AGGREGATION_READ_THREADS_KEY "NCML.Aggregation.ReadThreads"
+
 namespace agg_util {
 // Static class member used to track the position of the last CVs insertion
 // when building a JoinExisting aggregation.
@@ -936,6 +947,115 @@ void AggregationUtil::addDatasetArrayDataToAggregationOutputArray(libdap::Array&
     pDatasetArray->clear_local_data();
 }
 
+/** The text of the error thrown when reading one member dataset fails. */
+static std::string memberReadErrorMessage(const MemberDatasetRead &read, const AggregationException &ex)
+{
+    std::ostringstream oss;
+    oss << "dataset index=" << read.datasetIndex << " data for location=\"" << read.dataset->getLocation()
+        << "\" The error msg was: " << ex.what();
+    return oss.str();
+}
+
+unsigned int AggregationUtil::getAggregationReadThreads()
+{
+    static const unsigned int read_threads = std::max(1, TheBESKeys::read_int_key(AGGREGATION_READ_THREADS_KEY, 1));
+    return read_threads;
+}
+
+void AggregationUtil::addDatasetArraysDataToAggregationOutputArray(libdap::Array& oOutputArray,
+    const vector<MemberDatasetRead>& reads, const std::string& varName, const ArrayGetterInterface& arrayGetter,
+    const std::string& debugChannel)
+{
+    BESStopWatch sw;
+    if (BESDebug::IsSet(TIMING_LOG_KEY)) sw.start("AggregationUtil::addDatasetArraysDataToAggregationOutputArray", "");
+
+    size_t num_threads = std::min(static_cast<size_t>(getAggregationReadThreads()), reads.size());
+
+    if (num_threads > 1) {
+        // Loading a DDS runs a request using the DataHandlerInterface of the current
+        // request, so only one can be loaded at a time. Once loaded, getDDS() just
+        // returns it, so the threads can use it.
+        for (const auto &read: reads) {
+            read.dataset->getDDS();
+            if (!read.dataset->canReadInParallel()) {
+                BESDEBUG(debugChannel, "Member dataset location=\"" << read.dataset->getLocation()
+                    << "\" cannot be read in parallel; reading the members of " << varName << " serially" << endl);
+                num_threads = 1;
+                break;
+            }
+        }
+    }
+
+    if (num_threads <= 1) {
+        for (const auto &read: reads) {
+            try {
+                addDatasetArrayDataToAggregationOutputArray(oOutputArray, read.atIndex, *read.constrainedTemplateArray,
+                    varName, *read.dataset, arrayGetter, debugChannel);
+            }
+            catch (AggregationException &ex) {
+                throw AggregationException(memberReadErrorMessage(read, ex));
+            }
+        }
+        return;
+    }
+
+    BESDEBUG(debugChannel, "Reading " << reads.size() << " member datasets of " << varName << " using "
+        << num_threads << " threads" << endl);
+
+    std::atomic<size_t> next_read(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr first_error;
+    std::mutex output_mutex; // protects oOutputArray and first_error
+
+    auto read_members = [&]() {
+        size_t i;
+        while (!failed && (i = next_read++) < reads.size()) {
+            const MemberDatasetRead &read = reads[i];
+            try {
+                Array* pDatasetArray = readDatasetArrayDataForAggregation(*read.constrainedTemplateArray, varName,
+                    *read.dataset, arrayGetter, debugChannel);
+                {
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    oOutputArray.set_value_slice_from_row_major_vector(*pDatasetArray, read.atIndex);
+                }
+                pDatasetArray->clear_local_data();
+            }
+            catch (AggregationException &ex) {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                if (!first_error) {
+                    first_error = std::make_exception_ptr(AggregationException(memberReadErrorMessage(read, ex)));
+                }
+                failed = true;
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                if (!first_error) first_error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    // This thread reads too, so start one fewer.
+    vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+        try {
+            threads.emplace_back(read_members);
+        }
+        catch (std::system_error &e) {
+            BESDEBUG(debugChannel, "Could not start an aggregation read thread: " << e.what() << endl);
+            break;
+        }
+    }
+
+    read_members();
+
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    if (first_error) std::rethrow_exception(first_error);
+}
+
 void AggregationUtil::gatherMetadataChangesFrom(BaseType* pIntoVar, const BaseType& fromVarC)
 {
     BaseType& fromVar = const_cast<BaseType&>(fromVarC); //semantic const
@@ -154,6 +154,19 @@ struct TopLevelGridMapArrayGetter: public ArrayGetterInterface {
 };
 // class TopLevelGridMapArrayGetter
 
+/**
+ * One member dataset's part of an aggregated read: the dataset, the template
+ * holding the constraints to use when reading it, where its data go in the
+ * aggregated array (an element index, not a byte offset) and the index of the
+ * dataset in the aggregation (for error messages).
+ */
+struct MemberDatasetRead {
+    AggMemberDataset* dataset;
+    const libdap::Array* constrainedTemplateArray;
+    unsigned int atIndex;
+    unsigned int datasetIndex;
+};
+
 /**
  *   A static class for encapsulating the aggregation functionality on libdap.
  *   This class should have references to libdap and STL, but should NOT
@@ -465,6 +478,35 @@ public:
         const string& debugChannel // if !"", debug output goes to this channel.
         );
 
+    /**
+     * Read the data for several member datasets and copy each into oOutputArray,
+     * as addDatasetArrayDataToAggregationOutputArray() does for one.
+     *
+     * If NCML.Aggregation.ReadThreads is more than one, the members' DDSs are
+     * loaded one after another (loading uses the request's DataHandlerInterface).
+     * If every member then says it can be read in parallel (only the DMR++
+     * handler's reads are thread safe), the reads run on that many threads;
+     * otherwise they run one after another. Each read uses its own constraint
+     * template, so the templates must not be shared with code that changes them
+     * while this runs. The first error stops the remaining reads and is
+     * rethrown once all the threads are done.
+     *
+     * Errors are rethrown as AggregationException naming the index and
+     * location of the member dataset that failed.
+     *
+     * @param oOutputArray  the Array to output the data into
+     * @param reads the member datasets to read and where their data go
+     * @param varName the name of the aggVar to find in each DDS
+     * @param arrayGetter  the class to use to get the member Array by name from DDS
+     * @param debugChannel if not empty(), BESDEBUG channel to use
+     */
+    static void addDatasetArraysDataToAggregationOutputArray(libdap::Array& oOutputArray,
+        const std::vector<MemberDatasetRead>& reads, const std::string& varName,
+        const ArrayGetterInterface& arrayGetter, const std::string& debugChannel);
+
+    /** @return The number of threads to use for aggregation reads, at least one. */
+    static unsigned int getAggregationReadThreads();
+
     /**
      * Union fromVar's AttrTable (initially) with pIntoVar's AttrTable
      * and replace pIntoVar's AttrTable with this union.
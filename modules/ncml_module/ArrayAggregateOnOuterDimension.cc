@@ -246,6 +246,28 @@ void ArrayAggregateOnOuterDimension::readConstrainedGranuleArraysAndAggregateDat
     if (BESDebug::IsSet(TIMING_LOG_KEY))
         sw.start("ArrayAggregateOnOuterDimension::readConstrainedGranuleArraysAndAggregateDataHook", "");
 
+    std::vector<MemberDatasetRead> reads;
+    std::vector<std::unique_ptr<Array>> granuleTemplates;
+    getGranuleReadsHook(reads, granuleTemplates);
+
+    // Prepare our output buffer for our constrained length
+    reserve_value_capacity();
+
+    try {
+        agg_util::AggregationUtil::addDatasetArraysDataToAggregationOutputArray(*this, // into the output buffer of this object
+            reads, // the datasets and where their slices go
+            name(), // aggvar name
+            getArrayGetterInterface(), DEBUG_CHANNEL);
+    }
+    catch (agg_util::AggregationException& ex) {
+        THROW_NCML_PARSE_ERROR(-1, "Got AggregationException while streaming " + std::string(ex.what()));
+    }
+}
+
+/* virtual */
+void ArrayAggregateOnOuterDimension::getGranuleReadsHook(std::vector<MemberDatasetRead>& reads,
+    std::vector<std::unique_ptr<Array>>& /* granuleTemplates */)
+{
     // outer one is the first in iteration
     const Array::dimension& outerDim = *(dim_begin());
     BESDEBUG(DEBUG_CHANNEL,
@@ -258,39 +280,23 @@ void ArrayAggregateOnOuterDimension::readConstrainedGranuleArraysAndAggregateDat
             " have the same size as the number of datasets in the aggregation!");
     }
 
-    // Prepare our output buffer for our constrained length
-    reserve_value_capacity();
-
     // this index pointing into the value buffer for where to write.
     // The buffer has a stride equal to the _pSubArrayProto->size().
     int nextElementIndex = 0;
 
-    // Traverse the dataset array respecting hyperslab
+    // Traverse the dataset array respecting hyperslab, noting where each
+    // dataset's data go. They all use the same constraints template.
     for (int i = outerDim.start; i <= outerDim.stop && i < outerDim.size; i += outerDim.stride) {
-        AggMemberDataset& dataset = *((getDatasetList())[i]);
-
-        try {
-            agg_util::AggregationUtil::addDatasetArrayDataToAggregationOutputArray(*this, // into the output buffer of this object
-                nextElementIndex, // into the next open slice
-                getGranuleTemplateArray(), // constraints template
-                name(), // aggvar name
-                dataset, // Dataset who's DDS should be searched
-                getArrayGetterInterface(), DEBUG_CHANNEL);
-        }
-        catch (agg_util::AggregationException& ex) {
-            std::ostringstream oss;
-            oss << "Got AggregationException while streaming dataset index=" << i << " data for location=\""
-                << dataset.getLocation() << "\" The error msg was: " << std::string(ex.what());
-            THROW_NCML_PARSE_ERROR(-1, oss.str());
-        }
+        reads.push_back({ (getDatasetList())[i].get(), &getGranuleTemplateArray(),
+            static_cast<unsigned int>(nextElementIndex), static_cast<unsigned int>(i) });
 
-        // Jump forward by the amount we added.
+        // Jump forward by the amount we will add.
         nextElementIndex += getGranuleTemplateArray().length();
     }
 
-    // If we succeeded, we are at the end of the array!
+    // The datasets should fill the array exactly
     NCML_ASSERT_MSG(nextElementIndex == length(), "Logic error:\n"
-        "ArrayAggregateOnOuterDimension::read(): "
+        "ArrayAggregateOnOuterDimension::getGranuleReadsHook(): "
         "At end of aggregating, expected the nextElementIndex to be the length of the "
         "aggregated array, but it wasn't!");
 }
@@ -128,6 +128,12 @@ protected:
      */
     void readConstrainedGranuleArraysAndAggregateDataHook() override;
 
+    /* IMPL of virtual hook.
+     * Every member dataset in the outer dimension constraint is read
+     * using the granule template. */
+    void getGranuleReadsHook(std::vector<MemberDatasetRead>& reads,
+        std::vector<std::unique_ptr<libdap::Array>>& granuleTemplates) override;
+
 private:
     // Helper interface
 
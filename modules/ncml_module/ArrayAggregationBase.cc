@@ -31,8 +31,11 @@
 
 #include <libdap/Marshaller.h>
 #include <libdap/ConstraintEvaluator.h>
+#include <libdap/D4StreamMarshaller.h>
+#include <libdap/DMR.h>
 
 #include "ArrayAggregationBase.h"
+#include "AggregationException.h"
 #include "NCMLDebug.h"
 #include "BESDebug.h"
 #include "BESStopWatch.h"
@@ -139,6 +142,106 @@ bool ArrayAggregationBase::read()
     return true;
 }
 
+/**
+ * Write the data in a member dataset's Array as the next part of a DAP4 array.
+ * DAP4 arrays have no length prefix, so the parts simply follow one another.
+ */
+static void put_d4_vector_part(D4StreamMarshaller &m, Array &granuleArray)
+{
+    const int64_t num = granuleArray.length();
+    if (num == 0) return;
+
+    switch (granuleArray.var()->type()) {
+    case dods_byte_c:
+    case dods_char_c:
+    case dods_int8_c:
+    case dods_uint8_c:
+        m.put_vector(granuleArray.get_buf(), num);
+        break;
+
+    case dods_int16_c:
+    case dods_uint16_c:
+    case dods_int32_c:
+    case dods_uint32_c:
+    case dods_int64_c:
+    case dods_uint64_c:
+        m.put_vector(granuleArray.get_buf(), num, granuleArray.var()->width());
+        break;
+
+    case dods_float32_c:
+        m.put_vector_float32(granuleArray.get_buf(), num);
+        break;
+
+    case dods_float64_c:
+        m.put_vector_float64(granuleArray.get_buf(), num);
+        break;
+
+    default:
+        THROW_NCML_INTERNAL_ERROR("Cannot stream an aggregated array of type " + granuleArray.var()->type_name());
+    }
+}
+
+/** @return True if the data of an Array of this type can be sent a part at a time */
+static bool is_d4_streamable_type(Type type)
+{
+    switch (type) {
+    case dods_byte_c:
+    case dods_char_c:
+    case dods_int8_c:
+    case dods_uint8_c:
+    case dods_int16_c:
+    case dods_uint16_c:
+    case dods_int32_c:
+    case dods_uint32_c:
+    case dods_int64_c:
+    case dods_uint64_c:
+    case dods_float32_c:
+    case dods_float64_c:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* virtual */
+void ArrayAggregationBase::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter)
+{
+    BESStopWatch sw;
+    if (BESDebug::IsSet(TIMING_LOG_KEY)) sw.start("ArrayAggregationBase::serialize", "");
+
+    if (read_p() || !is_d4_streamable_type(var()->type())) {
+        Array::serialize(m, dmr, filter);
+        return;
+    }
+
+    // call subclass impl
+    transferOutputConstraintsIntoGranuleTemplateHook();
+
+    vector<MemberDatasetRead> reads;
+    vector<unique_ptr<Array>> granuleTemplates;
+    getGranuleReadsHook(reads, granuleTemplates);
+
+    BESDEBUG_FUNC(DEBUG_CHANNEL, "Streaming " << reads.size() << " granules of " << name() << endl);
+
+    for (const auto &granuleRead: reads) {
+        try {
+            Array* pDatasetArray = AggregationUtil::readDatasetArrayDataForAggregation(*granuleRead.constrainedTemplateArray,
+                name(), *granuleRead.dataset, getArrayGetterInterface(), DEBUG_CHANNEL);
+
+            put_d4_vector_part(m, *pDatasetArray);
+
+            pDatasetArray->clear_local_data();
+        }
+        catch (AggregationException& ex) {
+            ostringstream oss;
+            oss << "Got AggregationException while streaming dataset index=" << granuleRead.datasetIndex
+                << " data for location=\"" << granuleRead.dataset->getLocation() << "\" The error msg was: "
+                << ex.what();
+            THROW_NCML_PARSE_ERROR(-1, oss.str());
+        }
+    }
+}
+
 const AMDList&
 ArrayAggregationBase::getDatasetList() const
 {
@@ -202,4 +305,12 @@ void ArrayAggregationBase::readConstrainedGranuleArraysAndAggregateDataHook()
         "needs to be overridden and implemented in a base class.");
 }
 
+/* virtual */
+void ArrayAggregationBase::getGranuleReadsHook(vector<MemberDatasetRead>&, vector<unique_ptr<Array>>&)
+{
+    NCML_ASSERT_MSG(false, "** Unimplemented function: "
+        "ArrayAggregationBase::getGranuleReadsHook(): "
+        "needs to be overridden and implemented in a base class.");
+}
+
 }
@@ -30,6 +30,7 @@
 #define __AGG_UTIL__ARRAY_AGGREGATION_BASE_H__
 
 #include <memory> // std
+#include <vector> // std
 
 #include <libdap/Array.h> // libdap
 
@@ -38,7 +39,9 @@
 
 namespace libdap {
     class ConstraintEvaluator;
+    class D4StreamMarshaller;
     class DDS;
+    class DMR;
     class Marshaller;
 }
 
@@ -97,6 +100,19 @@ namespace agg_util
      */
     bool read() override;
 
+    /**
+     * DAP4 serialize that reads one member dataset at a time and sends
+     * its data before reading the next, so only one granule's data are
+     * held in memory. Used for the numeric types; for other types, and if
+     * the data were already read, libdap::Array::serialize() is used.
+     *
+     * @param m  the marshaller to write the data to
+     * @param dmr  the DMR this variable is part of
+     * @param filter  passed to libdap::Array::serialize() if that is used
+     */
+    void serialize(libdap::D4StreamMarshaller &m, libdap::DMR &dmr, bool filter = false) override;
+    using libdap::Array::serialize;
+
     /**
     * Get the list of AggMemberDataset's that comprise this aggregation
     */
@@ -132,6 +148,18 @@ namespace agg_util
      */
     virtual void readConstrainedGranuleArraysAndAggregateDataHook();
 
+    /**
+     * Find the member datasets the constrained aggregation needs, the
+     * constraints to read each one with and where each one's data go in
+     * this Array. Called once the constraints are in the granule template.
+     *
+     * @param reads  the member dataset reads, in output order
+     * @param granuleTemplates  holds any constraint templates made for the
+     *                          reads; they must outlive the reads.
+     */
+    virtual void getGranuleReadsHook(std::vector<MemberDatasetRead>& reads,
+        std::vector<std::unique_ptr<libdap::Array>>& granuleTemplates);
+
   private:
 
     /** Assign the state from rhs into this */
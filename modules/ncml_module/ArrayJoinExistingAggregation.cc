@@ -29,7 +29,9 @@
 
 #include "config.h"
 
+#include <memory>
 #include <sstream>
+#include <vector>
 
 #include <libdap/Marshaller.h>
 
@@ -192,7 +194,7 @@ bool ArrayJoinExistingAggregation::serialize(libdap::ConstraintEvaluator &eval,
                 // then do it now.  Map constraints into the local granule space.
                 if (!currDatasetWasRead) {
                     BESDEBUG_FUNC(DEBUG_CHANNEL,
-                        " Current granule dataset was traversed but not yet " "read and copied into output.  Mapping constraints " "and calling read()..." << endl);
+                        " Current granule dataset was traversed but not yet " "read and copied into output.  Mapping constraints " "for read()..." << endl);
 
                     // Set up a constraint object for the actual granule read
                     // so that it only loads the data values in which we are
@@ -314,15 +316,35 @@ void ArrayJoinExistingAggregation::readConstrainedGranuleArraysAndAggregateDataH
     if (BESDebug::IsSet(TIMING_LOG_KEY))
         sw.start("ArrayJoinExistingAggregation::readConstrainedGranuleArraysAndAggregateDataHook", "");
 
+    std::vector<MemberDatasetRead> reads;
+    std::vector<std::unique_ptr<Array>> granuleTemplates;
+    getGranuleReadsHook(reads, granuleTemplates);
+
+    try {
+        // assumes the constraints are already set properly on this
+        reserve_value_capacity();
+
+        // Do the constrained reads and copy them into this output buffer
+        agg_util::AggregationUtil::addDatasetArraysDataToAggregationOutputArray(*this, // into the output buffer of this object
+            reads, // the granules and where their slices go
+            name(), // aggvar name
+            getArrayGetterInterface(), DEBUG_CHANNEL);
+    }
+    catch (AggregationException& ex) {
+        THROW_NCML_PARSE_ERROR(-1, ex.what());
+    }
+}
+
+/* virtual */
+void ArrayJoinExistingAggregation::getGranuleReadsHook(std::vector<MemberDatasetRead>& reads,
+    std::vector<std::unique_ptr<Array>>& granuleTemplates)
+{
     // outer one is the first in iteration
     const Array::dimension& outerDim = *(dim_begin());
     BESDEBUG("ncml",
         "Aggregating datasets array with outer dimension constraints: " << " start=" << outerDim.start << " stride=" << outerDim.stride << " stop=" << outerDim.stop << endl);
 
     try {
-        // assumes the constraints are already set properly on this
-        reserve_value_capacity();
-
         // Start the iteration state for the granule.
         const AMDList& datasets = getDatasetList(); // the list
         NCML_ASSERT(!datasets.empty());
@@ -411,20 +433,18 @@ void ArrayJoinExistingAggregation::readConstrainedGranuleArraysAndAggregateDataH
                 // mapped endpoint clamped within this granule
                 granuleConstraintTemplate.add_constraint(outerDimIt, localGranuleIndex, clampedStride, granuleStopIndex);
 
-                // Do the constrained read and copy it into this output buffer
-                agg_util::AggregationUtil::addDatasetArrayDataToAggregationOutputArray(*this, // into the output buffer of this object
-                    nextOutputBufferElementIndex, // into the next open slice
-                    getGranuleTemplateArray(), // constraints we just setup
-                    name(), // aggvar name
-                    const_cast<AggMemberDataset&>(*pCurrDataset), // Dataset who's DDS should be searched
-                    getArrayGetterInterface(), DEBUG_CHANNEL);
+                // Each granule read gets its own copy of the constraints
+                // since the outer dimension is different for each one.
+                granuleTemplates.emplace_back(static_cast<Array*>(granuleConstraintTemplate.ptr_duplicate()));
+                reads.push_back({ const_cast<AggMemberDataset*>(pCurrDataset), granuleTemplates.back().get(),
+                    nextOutputBufferElementIndex, static_cast<unsigned int>(currDatasetIndex) });
 
-                // Jump output buffer index forward by the amount we added.
-                nextOutputBufferElementIndex += getGranuleTemplateArray().length();
+                // Jump output buffer index forward by the amount we will add.
+                nextOutputBufferElementIndex += granuleConstraintTemplate.length();
                 currDatasetWasRead = true;
 
                 BESDEBUG_FUNC(DEBUG_CHANNEL,
-                    " The granule index " << currDatasetIndex << " was read with constraints and copied into the aggregation output." << endl);
+                    " The granule index " << currDatasetIndex << " constraints were mapped for the aggregation output." << endl);
             } // !currDatasetWasRead
         } // for loop over outerDim
     } // try
@@ -432,7 +452,6 @@ void ArrayJoinExistingAggregation::readConstrainedGranuleArraysAndAggregateDataH
     catch (AggregationException& ex) {
         THROW_NCML_PARSE_ERROR(-1, ex.what());
     }
-
 }
 
 } // namespace agg_util
@@ -90,6 +90,12 @@ protected:
      * and respecting constraints on the outer dimension */
     virtual void readConstrainedGranuleArraysAndAggregateDataHook();
 
+    /* IMPL of virtual hook.
+     * Maps the outer dimension constraints into each member dataset
+     * it spans, making a constraints template for each. */
+    virtual void getGranuleReadsHook(std::vector<MemberDatasetRead>& reads,
+        std::vector<std::unique_ptr<libdap::Array>>& granuleTemplates);
+
 private:
     // helpers
 
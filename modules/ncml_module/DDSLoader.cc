@@ -72,14 +72,14 @@ long DDSLoader::_gensymID = 0L;
 
 DDSLoader::DDSLoader(BESDataHandlerInterface& dhi) :
     _dhi(dhi), /*d_saved_dhi(0),*/_hijacked(false), _filename(""), _store(0), _containerSymbol(""), _origAction(""), _origActionName(
-        ""), _origContainer(0), _origResponse(0)
+        ""), _origContainer(0), _origResponse(0), _containerType("")
 {
 }
 
 // WE ONLY COPY THE DHI!  I got forced to impl this.
 DDSLoader::DDSLoader(const DDSLoader& proto) :
     _dhi(proto._dhi), /*d_saved_dhi(0),*/_hijacked(false), _filename(""), _store(0), _containerSymbol(""), _origAction(
-        ""), _origActionName(""), _origContainer(0), _origResponse(0)
+        ""), _origActionName(""), _origContainer(0), _origResponse(0), _containerType("")
 {
 }
 
@@ -124,6 +124,7 @@ DDSLoader::operator=(const DDSLoader& rhs)
     // test for this case - and new copy ctor and operator=() methods added.
     // jhrg 4/18/14
     if (&_dhi != &rhs._dhi) _dhi.make_copy(rhs._dhi);
+    _containerType = "";
 
     return *this;
 }
@@ -218,6 +219,7 @@ void DDSLoader::loadInto(const std::string& location, ResponseType type, BESDapR
         BESDEBUG("ncml", "Handler name: " << BESRequestHandlerList::TheList()->get_handler_names() << endl);
 
         BESRequestHandlerList::TheList()->execute_current(_dhi);
+        _containerType = _dhi.container->get_container_type();
 
         // Some NcML operations like rename/add attributes need to have attributes in the data access.
         // So we need to check if the attributes are added by the underneath handlers.
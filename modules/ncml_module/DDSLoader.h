@@ -81,6 +81,9 @@ private:
     BESContainer* _origContainer;
     BESResponseObject* _origResponse;
 
+    // The type of the container used by the last successful loadInto(), e.g. "dmrpp".
+    std::string _containerType;
+
     // A counter we use to generate a "class-unique" symbol for containers internally.
     // Incremented by getNextContainerName().
     static long _gensymID;
@@ -161,6 +164,15 @@ public:
      */
     void loadInto(const std::string& location, ResponseType type, BESDapResponse* pResponse);
 
+    /**
+     * The container type (i.e., the name of the handler) that the last
+     * successful loadInto() used, or "" if nothing has been loaded.
+     */
+    const std::string& getLoadedContainerType() const
+    {
+        return _containerType;
+    }
+
     /**
      * @brief restore dhi to clean state
      *
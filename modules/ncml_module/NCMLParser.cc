@@ -197,6 +197,11 @@ bool NCMLParser::parsing() const
     return !_filename.empty();
 }
 
+const std::string& NCMLParser::getParseFilename() const
+{
+    return _filename;
+}
+
 int NCMLParser::getParseLineNumber() const
 {
     return _currentParseLine;
@@ -217,6 +217,9 @@ public:
     /** Are we currently parsing? */
     bool parsing() const;
 
+    /** The NcML file being parsed, or empty if not parsing */
+    const std::string& getParseFilename() const;
+
     /** Get the line of the NCML file the parser is currently parsing */
     int getParseLineNumber() const;
 
@@ -0,0 +1,276 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES ncml_module, part of the Hyrax data server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <utime.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "BESUtil.h"
+
+#include "AggMemberDatasetDimensionCache.h"
+#include "AggMemberDatasetDimensionIndex.h"
+#include "AggMemberDatasetWithDimensionCacheBase.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+namespace agg_util {
+
+/**
+ * A member dataset that makes up its dimensions instead of reading a DDS
+ * and counts how many times it was asked to.
+ */
+class FakeMemberDataset: public AggMemberDatasetWithDimensionCacheBase {
+public:
+    unsigned int d_time_size;
+    int d_fills = 0;
+
+    FakeMemberDataset(const string &location, unsigned int time_size) :
+        AggMemberDatasetWithDimensionCacheBase(location), d_time_size(time_size) {}
+
+    const libdap::DDS *getDDS() override { return nullptr; }
+
+    void fillDimensionCacheByUsingDDS() override
+    {
+        ++d_fills;
+        setDimensionCacheFor(Dimension("time", d_time_size), false);
+    }
+};
+
+class AggMemberDatasetDimensionCacheTest: public CppUnit::TestFixture {
+    const string d_data_root = string(TEST_BUILD_DIR) + "/dim_cache_data";
+    const string d_cache_dir = string(TEST_BUILD_DIR) + "/dim_cache";
+
+    AggMemberDatasetDimensionCache *d_cache = nullptr;
+
+    // The members of the aggregation; d_members[i] is d_amds[i].
+    vector<FakeMemberDataset *> d_members;
+    AMDList d_amds;
+
+    void make_members(unsigned int n)
+    {
+        d_members.clear();
+        d_amds.clear();
+        for (unsigned int i = 0; i < n; ++i) {
+            auto member = new FakeMemberDataset("m" + to_string(i) + ".nc", 10 + i);
+            d_members.push_back(member);
+            d_amds.emplace_back(member);
+        }
+    }
+
+    int total_fills() const
+    {
+        int fills = 0;
+        for (auto member: d_members)
+            fills += member->d_fills;
+        return fills;
+    }
+
+    string index_file(const string &id) const
+    {
+        return d_cache->get_cache_file_name(id + "#dimension_index", true);
+    }
+
+    // Remove the index left by an earlier run of the test
+    void remove_index(const string &id)
+    {
+        d_cache->purge_file(index_file(id));
+    }
+
+    static off_t file_size(const string &name)
+    {
+        struct stat buf;
+        return stat(name.c_str(), &buf) == 0 ? buf.st_size : -1;
+    }
+
+    static ino_t file_inode(const string &name)
+    {
+        struct stat buf;
+        return stat(name.c_str(), &buf) == 0 ? buf.st_ino : 0;
+    }
+
+    void touch_member(unsigned int i, time_t mtime)
+    {
+        string name = d_data_root + "/m" + to_string(i) + ".nc";
+        struct utimbuf times = { mtime, mtime };
+        CPPUNIT_ASSERT(utime(name.c_str(), &times) == 0);
+    }
+
+public:
+    AggMemberDatasetDimensionCacheTest() = default;
+    ~AggMemberDatasetDimensionCacheTest() override = default;
+
+    void setUp() override
+    {
+        BESUtil::mkdir_p(d_data_root, 0775);
+        BESUtil::mkdir_p(d_cache_dir, 0775);
+        for (unsigned int i = 0; i < 3; ++i) {
+            ofstream(d_data_root + "/m" + to_string(i) + ".nc") << "member " << i << endl;
+            touch_member(i, 1000000);
+        }
+
+        d_cache = AggMemberDatasetDimensionCache::get_instance(d_data_root, d_cache_dir, "dim_test", 10);
+        CPPUNIT_ASSERT(d_cache);
+    }
+
+    void tearDown() override
+    {
+        d_members.clear();
+        d_amds.clear();
+    }
+
+    // The index is an item in the cache, so it counts toward the cache size.
+    void index_is_cached_test()
+    {
+        const string id = "index_is_cached.ncml#time";
+        remove_index(id);
+        unsigned long long before = d_cache->get_cache_size();
+
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+        CPPUNIT_ASSERT_EQUAL(3, total_fills());
+
+        off_t size = file_size(index_file(id));
+        DBG(cerr << "Index: " << index_file(id) << ", " << size << " bytes" << endl);
+        CPPUNIT_ASSERT(size > 0);
+        CPPUNIT_ASSERT_EQUAL(before + size, d_cache->get_cache_size());
+    }
+
+    void reuse_test()
+    {
+        const string id = "reuse.ncml#time";
+        remove_index(id);
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+        ino_t inode = file_inode(index_file(id));
+        unsigned long long cache_size = d_cache->get_cache_size();
+
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+        CPPUNIT_ASSERT_EQUAL(0, total_fills());
+        for (unsigned int i = 0; i < 3; ++i)
+            CPPUNIT_ASSERT_EQUAL(10 + i, d_members[i]->getCachedDimensionSize("time"));
+
+        // Nothing changed, so the index was not written again.
+        CPPUNIT_ASSERT_EQUAL(inode, file_inode(index_file(id)));
+        CPPUNIT_ASSERT_EQUAL(cache_size, d_cache->get_cache_size());
+    }
+
+    // Only the member whose file changed is read again.
+    void changed_member_test()
+    {
+        const string id = "changed_member.ncml#time";
+        remove_index(id);
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+        unsigned long long cache_size = d_cache->get_cache_size();
+
+        touch_member(1, 2000000);
+        make_members(3);
+        d_members[1]->d_time_size = 42;
+        d_cache->loadDimensionCache(id, d_amds);
+        CPPUNIT_ASSERT_EQUAL(0, d_members[0]->d_fills);
+        CPPUNIT_ASSERT_EQUAL(1, d_members[1]->d_fills);
+        CPPUNIT_ASSERT_EQUAL(0, d_members[2]->d_fills);
+
+        // The old index was purged before the new one was added.
+        CPPUNIT_ASSERT_EQUAL(cache_size, d_cache->get_cache_size());
+
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+        CPPUNIT_ASSERT_EQUAL(0, total_fills());
+        CPPUNIT_ASSERT_EQUAL(42U, d_members[1]->getCachedDimensionSize("time"));
+    }
+
+    // Members dropped from the aggregation are dropped from the index.
+    void removed_member_test()
+    {
+        const string id = "removed_member.ncml#time";
+        remove_index(id);
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+        off_t old_size = file_size(index_file(id));
+        unsigned long long cache_size = d_cache->get_cache_size();
+
+        make_members(2);
+        d_cache->loadDimensionCache(id, d_amds);
+        CPPUNIT_ASSERT_EQUAL(0, total_fills());
+
+        AggMemberDatasetDimensionIndex index(index_file(id));
+        CPPUNIT_ASSERT(index.open());
+        CPPUNIT_ASSERT_EQUAL(size_t(2), index.size());
+
+        off_t new_size = file_size(index_file(id));
+        CPPUNIT_ASSERT(new_size < old_size);
+        CPPUNIT_ASSERT_EQUAL(cache_size - old_size + new_size, d_cache->get_cache_size());
+    }
+
+    // A damaged index is replaced.
+    void damaged_index_test()
+    {
+        const string id = "damaged_index.ncml#time";
+        remove_index(id);
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+
+        {
+            fstream index(index_file(id), ios::in | ios::out | ios::binary);
+            index.write("XXXXXXXX", 8);
+        }
+
+        make_members(3);
+        d_cache->loadDimensionCache(id, d_amds);
+        CPPUNIT_ASSERT_EQUAL(3, total_fills());
+
+        AggMemberDatasetDimensionIndex index(index_file(id));
+        CPPUNIT_ASSERT(index.open());
+        CPPUNIT_ASSERT_EQUAL(size_t(3), index.size());
+    }
+
+    CPPUNIT_TEST_SUITE( AggMemberDatasetDimensionCacheTest );
+
+    CPPUNIT_TEST(index_is_cached_test);
+    CPPUNIT_TEST(reuse_test);
+    CPPUNIT_TEST(changed_member_test);
+    CPPUNIT_TEST(removed_member_test);
+    CPPUNIT_TEST(damaged_index_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(AggMemberDatasetDimensionCacheTest);
+
+} // namespace agg_util
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<agg_util::AggMemberDatasetDimensionCacheTest>(argc, argv, "cerr,cache") ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES ncml_module, part of the Hyrax data server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "AggMemberDatasetDimensionIndex.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+namespace agg_util {
+
+class AggMemberDatasetDimensionIndexTest: public CppUnit::TestFixture {
+    const string d_index_file = string(TEST_BUILD_DIR) + "/dimension_index_test.idx";
+
+    static vector<AggMemberDatasetDimensionIndex::Entry> make_entries()
+    {
+        vector<AggMemberDatasetDimensionIndex::Entry> entries(3);
+        entries[0].location = "data/a.nc";
+        entries[0].mtime = 1000;
+        entries[0].dimensions = { Dimension("time", 31), Dimension("lat", 3) };
+        entries[1].location = "data/b.nc";
+        entries[1].mtime = 2000;
+        entries[1].dimensions = { Dimension("time", 28), Dimension("lat", 3) };
+        entries[2].location = "data/c.nc";  // A member with no dimensions
+        entries[2].mtime = 3000;
+        return entries;
+    }
+
+    void write_index(const vector<AggMemberDatasetDimensionIndex::Entry> &entries)
+    {
+        unlink(d_index_file.c_str());
+        int fd = open(d_index_file.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+        CPPUNIT_ASSERT_MESSAGE("Could not make " + d_index_file, fd != -1);
+        AggMemberDatasetDimensionIndex::write(fd, entries);
+        close(fd);
+    }
+
+    string read_file()
+    {
+        ifstream in(d_index_file, ios::binary);
+        return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    void replace_file(const string &contents)
+    {
+        unlink(d_index_file.c_str());
+        ofstream out(d_index_file, ios::binary);
+        out.write(contents.data(), contents.size());
+    }
+
+public:
+    AggMemberDatasetDimensionIndexTest() = default;
+    ~AggMemberDatasetDimensionIndexTest() override = default;
+
+    void tearDown() override
+    {
+        unlink(d_index_file.c_str());
+    }
+
+    void write_and_read_test()
+    {
+        write_index(make_entries());
+
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(index.open());
+        CPPUNIT_ASSERT_EQUAL(size_t(3), index.size());
+
+        vector<Dimension> dims;
+        CPPUNIT_ASSERT(index.find("data/b.nc", 2000, dims));
+        CPPUNIT_ASSERT_EQUAL(size_t(2), dims.size());
+        CPPUNIT_ASSERT_EQUAL(string("time"), dims[0].name);
+        CPPUNIT_ASSERT_EQUAL(28U, static_cast<unsigned int>(dims[0].size));
+        CPPUNIT_ASSERT_EQUAL(string("lat"), dims[1].name);
+        CPPUNIT_ASSERT_EQUAL(3U, static_cast<unsigned int>(dims[1].size));
+
+        CPPUNIT_ASSERT(index.find("data/a.nc", 1000, dims));
+        CPPUNIT_ASSERT_EQUAL(31U, static_cast<unsigned int>(dims[0].size));
+
+        CPPUNIT_ASSERT(index.find("data/c.nc", 3000, dims));
+        CPPUNIT_ASSERT(dims.empty());
+    }
+
+    void open_fd_test()
+    {
+        write_index(make_entries());
+
+        int fd = open(d_index_file.c_str(), O_RDONLY);
+        CPPUNIT_ASSERT(fd != -1);
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(index.open(fd));
+        close(fd);
+
+        vector<Dimension> dims;
+        CPPUNIT_ASSERT(index.find("data/a.nc", 1000, dims));
+        CPPUNIT_ASSERT_EQUAL(size_t(2), dims.size());
+    }
+
+    void empty_index_test()
+    {
+        write_index({});
+
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(index.open());
+        CPPUNIT_ASSERT_EQUAL(size_t(0), index.size());
+    }
+
+    void missing_file_test()
+    {
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(!index.open());
+        CPPUNIT_ASSERT_EQUAL(size_t(0), index.size());
+    }
+
+    // An entry made for a different mtime is for an older version of the member.
+    void stale_entry_test()
+    {
+        write_index(make_entries());
+
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(index.open());
+
+        vector<Dimension> dims;
+        CPPUNIT_ASSERT(!index.find("data/a.nc", 1001, dims));
+        CPPUNIT_ASSERT(!index.find("data/a.nc", 999, dims));
+        CPPUNIT_ASSERT(!index.find("data/not_indexed.nc", 1000, dims));
+    }
+
+    void bad_magic_test()
+    {
+        write_index(make_entries());
+        string contents = read_file();
+        contents[0] = 'X';
+        replace_file(contents);
+
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(!index.open());
+    }
+
+    void bad_version_test()
+    {
+        write_index(make_entries());
+        string contents = read_file();
+        uint32_t version = 99;
+        contents.replace(8, sizeof(version), reinterpret_cast<const char *>(&version), sizeof(version));
+        replace_file(contents);
+
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(!index.open());
+    }
+
+    // Every truncation of a valid index must be found, not read past the end.
+    void truncated_test()
+    {
+        write_index(make_entries());
+        const string contents = read_file();
+
+        for (size_t length = 0; length < contents.size(); ++length) {
+            replace_file(contents.substr(0, length));
+            AggMemberDatasetDimensionIndex index(d_index_file);
+            CPPUNIT_ASSERT_MESSAGE("Length " + to_string(length), !index.open());
+            CPPUNIT_ASSERT_EQUAL(size_t(0), index.size());
+        }
+    }
+
+    void huge_count_test()
+    {
+        write_index(make_entries());
+        string contents = read_file();
+        uint32_t count = 0xffffffff;
+        contents.replace(12, sizeof(count), reinterpret_cast<const char *>(&count), sizeof(count));
+        replace_file(contents);
+
+        AggMemberDatasetDimensionIndex index(d_index_file);
+        CPPUNIT_ASSERT(!index.open());
+    }
+
+    // A process with the old index mapped keeps using it after the file
+    // is removed and a new index is written under the same name.
+    void replaced_while_mapped_test()
+    {
+        write_index(make_entries());
+
+        AggMemberDatasetDimensionIndex old_index(d_index_file);
+        CPPUNIT_ASSERT(old_index.open());
+
+        auto entries = make_entries();
+        entries[0].mtime = 1500;
+        entries[0].dimensions[0].size = 30;
+        entries.pop_back();
+        write_index(entries);
+
+        vector<Dimension> dims;
+        CPPUNIT_ASSERT(old_index.find("data/a.nc", 1000, dims));
+        CPPUNIT_ASSERT_EQUAL(31U, static_cast<unsigned int>(dims[0].size));
+        CPPUNIT_ASSERT_EQUAL(size_t(3), old_index.size());
+
+        AggMemberDatasetDimensionIndex new_index(d_index_file);
+        CPPUNIT_ASSERT(new_index.open());
+        CPPUNIT_ASSERT_EQUAL(size_t(2), new_index.size());
+        CPPUNIT_ASSERT(!new_index.find("data/a.nc", 1000, dims));
+        CPPUNIT_ASSERT(new_index.find("data/a.nc", 1500, dims));
+        CPPUNIT_ASSERT_EQUAL(30U, static_cast<unsigned int>(dims[0].size));
+    }
+
+    CPPUNIT_TEST_SUITE( AggMemberDatasetDimensionIndexTest );
+
+    CPPUNIT_TEST(write_and_read_test);
+    CPPUNIT_TEST(open_fd_test);
+    CPPUNIT_TEST(empty_index_test);
+    CPPUNIT_TEST(missing_file_test);
+    CPPUNIT_TEST(stale_entry_test);
+    CPPUNIT_TEST(bad_magic_test);
+    CPPUNIT_TEST(bad_version_test);
+    CPPUNIT_TEST(truncated_test);
+    CPPUNIT_TEST(huge_count_test);
+    CPPUNIT_TEST(replaced_while_mapped_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(AggMemberDatasetDimensionIndexTest);
+
+} // namespace agg_util
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<agg_util::AggMemberDatasetDimensionIndexTest>(argc, argv, "cerr,cache") ? 0 : 1;
+}
@@ -469,7 +469,7 @@ bool NCArray::read()
         return true;
 
     int ncid;
-    int errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    int errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR)
         throw Error(errstat, string("Could not open the dataset's file (") + dataset().c_str() + string(")"));
 
@@ -502,7 +502,7 @@ bool NCArray::read()
             nels, cor, edg, step, has_stride);
     set_read_p(true);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
@@ -44,6 +44,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <libdap/InternalErr.h>
 #include <libdap/util.h>
 
+#include "NCRequestHandler.h"
 #include "NCByte.h"
 
 // This `helper function' creates a pointer to the a NCByte and returns
@@ -98,7 +99,7 @@ bool NCByte::read() {
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
@@ -139,7 +140,7 @@ bool NCByte::read() {
 
     val2buf(&Dbyte);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
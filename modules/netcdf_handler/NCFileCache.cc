@@ -0,0 +1,76 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config_nc.h"
+
+#include <netcdf.h>
+
+#include "NCFileCache.h"
+
+using namespace std;
+
+NCFileCache::NCFileCache(unsigned int max_entries) :
+    d_cache([](const int &ncid) { return nc_close(ncid); }, max_entries, "nc")
+{
+}
+
+/**
+ * @brief Open a netCDF file read-only, reusing the cached ncid if possible
+ * @param path The file
+ * @param ncid Value-result parameter; the ncid. Release it using close().
+ * @return NC_NOERR or the error from nc_open()
+ */
+int NCFileCache::open(const string &path, int *ncid)
+{
+    time_t mtime;
+    if (!bes::HandleCache<int>::file_mtime(path, mtime))
+        return nc_open(path.c_str(), NC_NOWRITE, ncid);    // Let netCDF report the error
+
+    if (d_cache.find(path, mtime, *ncid))
+        return NC_NOERR;
+
+    int status = nc_open(path.c_str(), NC_NOWRITE, ncid);
+    if (status == NC_NOERR)
+        d_cache.insert(path, mtime, *ncid);
+
+    return status;
+}
+
+/**
+ * @brief Release an ncid returned by open()
+ *
+ * The file stays open unless it has changed or the cache is full. An ncid
+ * that is not in the cache is closed.
+ *
+ * @param ncid The ncid
+ * @return NC_NOERR or the error from nc_close()
+ */
+int NCFileCache::close(int ncid)
+{
+    int status = NC_NOERR;
+    if (!d_cache.release(ncid, &status))
+        return nc_close(ncid);
+
+    return status;
+}
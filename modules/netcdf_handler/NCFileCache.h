@@ -0,0 +1,68 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef I_NCFileCache_H
+#define I_NCFileCache_H 1
+
+#include <string>
+
+#include "HandleCache.h"
+
+/**
+ * @brief A cache of open netCDF file ids
+ *
+ * The variable classes' read() methods open the dataset's file, read one
+ * variable and close it again. For a netCDF-4 file, each open reads the
+ * file's HDF5 metadata. This cache keeps files open so that the variables of
+ * a request, and later requests for the same file, share one ncid.
+ *
+ * The ncids are kept in a bes::HandleCache: they are reference counted, at
+ * most max_entries files are kept open, the least recently used are closed
+ * first and an ncid is reused only if the file has not changed since it was
+ * opened.
+ *
+ * The methods return netCDF status codes, like nc_open() and nc_close(),
+ * so they can replace those calls directly.
+ */
+class NCFileCache {
+    bes::HandleCache<int> d_cache;
+
+public:
+    explicit NCFileCache(unsigned int max_entries);
+    NCFileCache(const NCFileCache &) = delete;
+    NCFileCache &operator=(const NCFileCache &) = delete;
+
+    virtual ~NCFileCache() = default;
+
+    int open(const std::string &path, int *ncid);
+    int close(int ncid);
+
+    /// Release the ncids a failed read() did not close
+    void end_request() { d_cache.end_request(); }
+
+    /// @return The number of open files held by the cache
+    size_t size() const { return d_cache.size(); }
+};
+
+#endif // I_NCFileCache_H
@@ -43,6 +43,7 @@ static char rcsid[] not_used ={"$Id$"};
 #include <netcdf.h>
 #include <libdap/InternalErr.h>
 
+#include "NCRequestHandler.h"
 #include "NCFloat64.h"
 
 
@@ -92,7 +93,7 @@ NCFloat64::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
 
     if (errstat != NC_NOERR)
     {
@@ -128,7 +129,7 @@ NCFloat64::read()
 	flt64 = (dods_float64) dbl;
 	val2buf((void *) &flt64 );
 
-	if (nc_close(ncid) != NC_NOERR)
+	if (NCRequestHandler::close_file(ncid) != NC_NOERR)
 	  throw InternalErr(__FILE__, __LINE__, 
 			    "Could not close the dataset!");
     }
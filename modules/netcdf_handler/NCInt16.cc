@@ -83,7 +83,7 @@ bool NCInt16::read() {
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
@@ -135,7 +135,7 @@ bool NCInt16::read() {
     dods_int16 intg16 = (dods_int16) sht;
     val2buf(&intg16);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
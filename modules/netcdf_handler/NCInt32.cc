@@ -42,6 +42,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <netcdf.h>
 #include <libdap/InternalErr.h>
 
+#include "NCRequestHandler.h"
 #include "NCInt32.h"
 
 NCInt32::NCInt32(const string &n, const string &d) :
@@ -82,7 +83,7 @@ bool NCInt32::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
@@ -127,7 +128,7 @@ bool NCInt32::read()
     dods_int32 intg32 = (dods_int32) lht;
     val2buf(&intg32);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
@@ -30,6 +30,8 @@
 #include <sstream>
 #include <exception>
 
+#include <netcdf.h>
+
 #include <libdap/DMR.h>
 #include <libdap/DataDDS.h>
 #include <libdap/mime_util.h>
@@ -53,6 +55,7 @@
 #include <BESStopWatch.h>
 #include <BESContextManager.h>
 #include <BESDMRResponse.h>
+#include <BESInterface.h>
 
 #include <ObjMemCache.h>
 
@@ -60,6 +63,7 @@
 #include <libdap/Ancillary.h>
 
 #include "NCRequestHandler.h"
+#include "NCFileCache.h"
 #include "GlobalMetadataStore.h"
 
 #define NC_NAME "nc"
@@ -87,6 +91,9 @@ ObjMemCache *NCRequestHandler::dds_cache = 0;
 ObjMemCache *NCRequestHandler::datadds_cache = 0;
 ObjMemCache *NCRequestHandler::dmr_cache = 0;
 
+unsigned int NCRequestHandler::_file_cache_entries = 0;
+NCFileCache *NCRequestHandler::file_cache = 0;
+
 extern void nc_read_dataset_attributes(DAS & das, const string & filename);
 extern void nc_read_dataset_variables(DDS & dds, const string & filename);
 
@@ -233,6 +240,13 @@ NCRequestHandler::NCRequestHandler(const string &name) :
         dmr_cache = new ObjMemCache(get_cache_entries(), get_cache_purge_level());
     }
 
+    NCRequestHandler::_file_cache_entries = get_uint_key("NC.FileCacheEntries", 0);
+    if (get_file_cache_entries()) {   // else it stays null and files are opened for each read
+        file_cache = new NCFileCache(get_file_cache_entries());
+        // Drop the ncids held by reads that failed
+        BESInterface::add_end_request_callback(NCRequestHandler::file_cache_end_request);
+    }
+
     BESDEBUG(NC_NAME, prolog << "END" << endl);
 }
 
@@ -242,6 +256,44 @@ NCRequestHandler::~NCRequestHandler()
     delete dds_cache;
     delete datadds_cache;
     delete dmr_cache;
+    delete file_cache;
+}
+
+// Registered with BESInterface::add_end_request_callback()
+void NCRequestHandler::file_cache_end_request()
+{
+    if (file_cache)
+        file_cache->end_request();
+}
+
+/**
+ * @brief Open a dataset's file read-only
+ *
+ * The variable classes use this in place of nc_open(). If NC.FileCacheEntries
+ * is greater than zero, the file may already be open and its ncid is reused.
+ *
+ * @param path The file
+ * @param ncid Value-result parameter; the ncid. Release it using close_file().
+ * @return NC_NOERR or a netCDF error code
+ */
+int NCRequestHandler::open_file(const string &path, int *ncid)
+{
+    if (file_cache)
+        return file_cache->open(path, ncid);
+
+    return nc_open(path.c_str(), NC_NOWRITE, ncid);
+}
+
+/**
+ * @brief Release an ncid returned by open_file()
+ * @return NC_NOERR or a netCDF error code
+ */
+int NCRequestHandler::close_file(int ncid)
+{
+    if (file_cache)
+        return file_cache->close(ncid);
+
+    return nc_close(ncid);
 }
 
 bool NCRequestHandler::nc_build_das(BESDataHandlerInterface & dhi)
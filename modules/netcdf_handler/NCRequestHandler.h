@@ -30,6 +30,7 @@
 #include <BESRequestHandler.h>
 
 class ObjMemCache;  // in bes/dap
+class NCFileCache;
 
 namespace libdap {
 class DDS;
@@ -56,6 +57,10 @@ private:
     static ObjMemCache *datadds_cache;
     static ObjMemCache *dmr_cache;
 
+	static unsigned int _file_cache_entries;
+    static NCFileCache *file_cache;
+    static void file_cache_end_request();
+
     static void get_dds_with_attributes(const std::string& dataset_name, const std::string& container_name, libdap::DDS* dds);
     static void get_dds_without_attributes(const std::string& dataset_name, const std::string& container_name, libdap::DDS* dds);
 
@@ -94,6 +99,15 @@ public:
 	{
 	    return _cache_purge_level;
 	}
+    static unsigned int get_file_cache_entries()
+	{
+	    return _file_cache_entries;
+	}
+
+    // Open and close a dataset's file using the file cache, if it is on.
+    // These return netCDF status codes like nc_open() and nc_close().
+    static int open_file(const std::string &path, int *ncid);
+    static int close_file(int ncid);
 
     // This handler supports the "not including attributes" in
     // the data access feature. Attributes are generated only
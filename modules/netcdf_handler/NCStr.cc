@@ -43,6 +43,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <netcdf.h>
 
 #include <libdap/InternalErr.h>
+#include "NCRequestHandler.h"
 #include "NCStr.h"
 
 #include <libdap/debug.h>
@@ -87,7 +88,7 @@ bool NCStr::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
 
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
@@ -191,5 +192,8 @@ bool NCStr::read()
 
     }
 
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
+        throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
+
     return true;
 }
@@ -50,6 +50,7 @@ static char rcsid[] not_used ={"$Id$"};
 #include <libdap/InternalErr.h>
 
 #include "nc_util.h"
+#include "NCRequestHandler.h"
 #include "NCStructure.h"
 #include "NCArray.h"
 
@@ -242,7 +243,7 @@ bool NCStructure::read()
         return true;
 
     int ncid;
-    int errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    int errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not open the dataset's file (" + dataset() + ")");
 
@@ -265,7 +266,7 @@ bool NCStructure::read()
 
     set_read_p(true);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
@@ -36,6 +36,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <netcdf.h>
 #include <libdap/InternalErr.h>
 
+#include "NCRequestHandler.h"
 #include "NCUInt16.h"
 
 NCUInt16::NCUInt16(const string &n, const string &d) :
@@ -76,7 +77,7 @@ bool NCUInt16::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
@@ -120,7 +121,7 @@ bool NCUInt16::read()
     dods_uint16 uintg16 = (dods_uint16) sht;
     val2buf(&uintg16);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
@@ -36,6 +36,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <netcdf.h>
 #include <libdap/InternalErr.h>
 
+#include "NCRequestHandler.h"
 #include "NCUInt32.h"
 
 NCUInt32::NCUInt32(const string &n, const string &d) :
@@ -76,7 +77,7 @@ bool NCUInt32::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = NCRequestHandler::open_file(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
@@ -121,7 +122,7 @@ bool NCUInt32::read()
     dods_uint32 uintg32 = (dods_uint32) lng;
     val2buf(&uintg32);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (NCRequestHandler::close_file(ncid) != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
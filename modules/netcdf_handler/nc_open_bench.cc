@@ -0,0 +1,149 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Per-variable read latency with and without the file cache. Build it using
+// 'make nc_open_bench' in modules/netcdf_handler.
+//
+// Usage: nc_open_bench <netCDF file> [repetitions (default 10)]
+//
+// Each pass reads the first value of every variable the way the handler's
+// read() methods do: open the file, look up the variable, read, close. The
+// first pass calls nc_open()/nc_close() for each variable; the second uses
+// NCFileCache. The best average time per variable is printed for each.
+
+#include "config_nc.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <netcdf.h>
+
+#include "NCFileCache.h"
+
+using namespace std;
+
+struct Variable {
+    string name;
+    vector<size_t> index;   // All zeros; the first value
+};
+
+// Find the variables of atomic, non-string types that have at least one value.
+static vector<Variable> get_variables(const string &path)
+{
+    int ncid;
+    if (nc_open(path.c_str(), NC_NOWRITE, &ncid) != NC_NOERR) {
+        cerr << "Could not open " << path << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    int nvars;
+    nc_inq_nvars(ncid, &nvars);
+
+    vector<Variable> vars;
+    for (int varid = 0; varid < nvars; ++varid) {
+        char name[NC_MAX_NAME + 1];
+        nc_type type;
+        int ndims;
+        int dimids[NC_MAX_VAR_DIMS];
+        nc_inq_var(ncid, varid, name, &type, &ndims, dimids, nullptr);
+#if NETCDF_VERSION >= 4
+        if (type > NC_MAX_ATOMIC_TYPE || type == NC_STRING)
+            continue;
+#endif
+        bool empty = false;
+        for (int d = 0; d < ndims; ++d) {
+            size_t len;
+            nc_inq_dimlen(ncid, dimids[d], &len);
+            if (len == 0) empty = true;
+        }
+        if (!empty)
+            vars.push_back({name, vector<size_t>(ndims, 0)});
+    }
+
+    nc_close(ncid);
+    return vars;
+}
+
+template <typename Open, typename Close>
+static double best_usec_per_var(const string &path, const vector<Variable> &vars, int reps, Open open_file,
+                                Close close_file)
+{
+    double best = 0.0;
+    for (int r = 0; r < reps; ++r) {
+        auto start = chrono::steady_clock::now();
+        for (const auto &var: vars) {
+            int ncid;
+            int varid;
+            double value[8];  // Large enough for any atomic type
+            if (open_file(path, &ncid) != NC_NOERR || nc_inq_varid(ncid, var.name.c_str(), &varid) != NC_NOERR
+                || nc_get_var1(ncid, varid, var.index.data(), value) != NC_NOERR) {
+                cerr << "Could not read " << var.name << endl;
+                exit(EXIT_FAILURE);
+            }
+            close_file(ncid);
+        }
+        const double usecs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count()
+                             / vars.size();
+        if (r == 0 || usecs < best)
+            best = usecs;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <netCDF file> [repetitions]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    const string path = argv[1];
+    const int reps = argc > 2 ? atoi(argv[2]) : 10;
+
+    const vector<Variable> vars = get_variables(path);
+    if (vars.empty()) {
+        cerr << "No readable variables in " << path << endl;
+        return EXIT_FAILURE;
+    }
+
+    const double uncached = best_usec_per_var(path, vars, reps,
+        [](const string &p, int *ncid) { return nc_open(p.c_str(), NC_NOWRITE, ncid); },
+        [](int ncid) { return nc_close(ncid); });
+
+    NCFileCache cache(1);
+    const double cached = best_usec_per_var(path, vars, reps,
+        [&cache](const string &p, int *ncid) { return cache.open(p, ncid); },
+        [&cache](int ncid) { return cache.close(ncid); });
+
+    cout << path << ": " << vars.size() << " variables, repetitions: " << reps << endl;
+    cout << left << setw(22) << "nc_open per variable" << fixed << setprecision(1) << uncached << " us/variable"
+         << endl;
+    cout << left << setw(22) << "NCFileCache" << fixed << setprecision(1) << cached << " us/variable" << endl;
+
+    return 0;
+}
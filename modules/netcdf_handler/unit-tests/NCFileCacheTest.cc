@@ -0,0 +1,255 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of nc_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2024 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This is free software; you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config_nc.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include <string>
+
+#include <netcdf.h>
+
+#include "NCFileCache.h"
+
+#include "modules/common/run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace std;
+
+class NCFileCacheTest: public CppUnit::TestFixture {
+    static string file(const string &name)
+    {
+        return string(TEST_BUILD_DIR) + "/" + name;
+    }
+
+    // Make a netCDF file with one scalar variable and set its mtime
+    static void make_file(const string &path, const string &var_name, time_t mtime)
+    {
+        unlink(path.c_str());
+        int ncid;
+        int varid;
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, nc_create(path.c_str(), NC_CLOBBER, &ncid));
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, nc_def_var(ncid, var_name.c_str(), NC_INT, 0, nullptr, &varid));
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, nc_enddef(ncid));
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, nc_close(ncid));
+
+        struct utimbuf times = { mtime, mtime };
+        CPPUNIT_ASSERT(utime(path.c_str(), &times) == 0);
+    }
+
+    static bool is_open(int ncid)
+    {
+        int nvars;
+        return nc_inq_nvars(ncid, &nvars) == NC_NOERR;
+    }
+
+    static bool has_var(int ncid, const string &var_name)
+    {
+        int varid;
+        return nc_inq_varid(ncid, var_name.c_str(), &varid) == NC_NOERR;
+    }
+
+public:
+    NCFileCacheTest() = default;
+    ~NCFileCacheTest() override = default;
+
+    void setUp() override
+    {
+        make_file(file("a.nc"), "a", 1000000);
+        make_file(file("b.nc"), "b", 1000000);
+        make_file(file("c.nc"), "c", 1000000);
+    }
+
+    // Readers of the same file share an ncid, and it stays open after the last one closes it.
+    void refcount_test()
+    {
+        NCFileCache cache(4);
+        int ncid1, ncid2;
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("a.nc"), &ncid1));
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("a.nc"), &ncid2));
+        CPPUNIT_ASSERT_EQUAL(ncid1, ncid2);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.close(ncid1));
+        CPPUNIT_ASSERT(has_var(ncid2, "a"));
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.close(ncid2));
+        CPPUNIT_ASSERT(is_open(ncid1));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+
+        int ncid3;
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("a.nc"), &ncid3));
+        CPPUNIT_ASSERT_EQUAL(ncid1, ncid3);
+        cache.close(ncid3);
+    }
+
+    // A file that changed is opened again.
+    void mtime_test()
+    {
+        NCFileCache cache(4);
+        int ncid;
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("a.nc"), &ncid));
+        cache.close(ncid);
+
+        make_file(file("a.nc"), "new_a", 2000000);
+
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("a.nc"), &ncid));
+        CPPUNIT_ASSERT(has_var(ncid, "new_a"));
+        CPPUNIT_ASSERT(!has_var(ncid, "a"));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+        cache.close(ncid);
+    }
+
+    // A reader holding the ncid of a file that changed keeps using the old
+    // file until it closes it.
+    void mtime_in_use_test()
+    {
+        NCFileCache cache(4);
+        int old_ncid;
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("a.nc"), &old_ncid));
+
+        make_file(file("a.nc"), "new_a", 2000000);
+
+        int new_ncid;
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("a.nc"), &new_ncid));
+        CPPUNIT_ASSERT(old_ncid != new_ncid);
+        CPPUNIT_ASSERT(has_var(old_ncid, "a"));
+        CPPUNIT_ASSERT(has_var(new_ncid, "new_a"));
+        CPPUNIT_ASSERT_EQUAL(size_t(2), cache.size());
+
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.close(old_ncid));
+        CPPUNIT_ASSERT(!is_open(old_ncid));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+        cache.close(new_ncid);
+    }
+
+    // The least recently used file is closed when the cache is full.
+    void eviction_test()
+    {
+        NCFileCache cache(2);
+        int a, b, c;
+        cache.open(file("a.nc"), &a);
+        cache.close(a);
+        cache.open(file("b.nc"), &b);
+        cache.close(b);
+
+        int a2;
+        cache.open(file("a.nc"), &a2);
+        CPPUNIT_ASSERT_EQUAL(a, a2);
+        cache.close(a2);
+
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.open(file("c.nc"), &c));
+        CPPUNIT_ASSERT_EQUAL(size_t(2), cache.size());
+        CPPUNIT_ASSERT(!is_open(b));
+        CPPUNIT_ASSERT(is_open(a));
+        CPPUNIT_ASSERT(is_open(c));
+        cache.close(c);
+    }
+
+    // A file in use is not closed even when the cache is full.
+    void in_use_test()
+    {
+        NCFileCache cache(1);
+        int a, b;
+        cache.open(file("a.nc"), &a);
+        cache.open(file("b.nc"), &b);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), cache.size());
+        CPPUNIT_ASSERT(is_open(a));
+        CPPUNIT_ASSERT(is_open(b));
+
+        cache.close(b);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+        CPPUNIT_ASSERT(has_var(a, "a"));
+        cache.close(a);
+    }
+
+    // An ncid that a failed read did not close is released at the end of the request.
+    void end_request_test()
+    {
+        NCFileCache cache(1);
+        int a, b;
+        cache.open(file("a.nc"), &a);
+        cache.open(file("b.nc"), &b);
+        cache.close(b);
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+
+        cache.end_request();
+        cache.open(file("c.nc"), &b);
+        cache.close(b);
+        CPPUNIT_ASSERT(!is_open(a));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+    }
+
+    // ncids the cache did not open are closed.
+    void not_cached_test()
+    {
+        NCFileCache cache(4);
+        int ncid;
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, nc_open(file("a.nc").c_str(), NC_NOWRITE, &ncid));
+        CPPUNIT_ASSERT_EQUAL(NC_NOERR, cache.close(ncid));
+        CPPUNIT_ASSERT(!is_open(ncid));
+        CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+    }
+
+    void missing_file_test()
+    {
+        NCFileCache cache(4);
+        int ncid;
+        CPPUNIT_ASSERT(cache.open(file("no_such_file.nc"), &ncid) != NC_NOERR);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+    }
+
+    void destructor_test()
+    {
+        int ncid;
+        {
+            NCFileCache cache(4);
+            cache.open(file("a.nc"), &ncid);
+            cache.close(ncid);
+            CPPUNIT_ASSERT(is_open(ncid));
+        }
+        CPPUNIT_ASSERT(!is_open(ncid));
+    }
+
+    CPPUNIT_TEST_SUITE( NCFileCacheTest );
+
+    CPPUNIT_TEST(refcount_test);
+    CPPUNIT_TEST(mtime_test);
+    CPPUNIT_TEST(mtime_in_use_test);
+    CPPUNIT_TEST(eviction_test);
+    CPPUNIT_TEST(in_use_test);
+    CPPUNIT_TEST(end_request_test);
+    CPPUNIT_TEST(not_cached_test);
+    CPPUNIT_TEST(missing_file_test);
+    CPPUNIT_TEST(destructor_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NCFileCacheTest);
+
+int main(int argc, char*argv[])
+{
+    return bes_run_tests<NCFileCacheTest>(argc, argv, "cerr,nc") ? 0 : 1;
+}
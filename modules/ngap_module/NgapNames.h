@@ -52,15 +52,21 @@ constexpr static auto const CMR_URL_TYPE_GET_DATA = "GET DATA";
 
 constexpr static auto const USE_CMR_CACHE = "NGAP.UseCMRCache";
 constexpr static auto const CMR_CACHE_THRESHOLD = "NGAP.CMRCacheSize.Items";
-constexpr static auto const CMR_CACHE_SPACE = "NGAP.CMRCachePurge.Items";
 
 constexpr static auto const USE_DMRPP_CACHE = "NGAP.UseDMRppCache";
 constexpr static auto const DMRPP_CACHE_THRESHOLD = "NGAP.DMRppCacheSize.Items";
-constexpr static auto const DMRPP_CACHE_SPACE = "NGAP.DMRppCachePurge.Items";
+constexpr static auto const DMRPP_CACHE_SIZE = "NGAP.DMRppCacheSize.MB";    // in MB
 
 constexpr static auto const DMRPP_FILE_CACHE_THRESHOLD = "NGAP.DMRppFileCacheSize.MB"; // in MB
 constexpr static auto const DMRPP_FILE_CACHE_SPACE = "NGAP.DMRppFileCachePurge.MB";    // in MB
 constexpr static auto const DMRPP_FILE_CACHE_DIR = "NGAP.DMRppFileCacheDir";
+constexpr static auto const DMRPP_FILE_CACHE_BACKGROUND_PURGE = "NGAP.DMRppFileCacheBackgroundPurge";
+
+// The DMR++ cache shared by all the besd processes (see SharedMemoryCache).
+constexpr static auto const USE_DMRPP_SHARED_CACHE = "NGAP.UseDMRppSharedCache";
+constexpr static auto const DMRPP_SHARED_CACHE_FILE = "NGAP.DMRppSharedCacheFile";
+constexpr static auto const DMRPP_SHARED_CACHE_SIZE = "NGAP.DMRppSharedCacheSize.MB";    // in MB
+constexpr static auto const DMRPP_SHARED_CACHE_ITEMS = "NGAP.DMRppSharedCacheSize.Items";
 
 constexpr static auto const DATA_SOURCE_LOCATION = "NGAP.DataSourceLocation";
 constexpr static auto const USE_OPENDAP_BUCKET = "NGAP.UseOPeNDAPBucket";
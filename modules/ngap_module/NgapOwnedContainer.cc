@@ -154,7 +154,7 @@ string NgapOwnedContainer::build_data_url_to_daac_bucket(const string &rest_path
 
     // If using the CMR cache, cache the response.
     if (NgapRequestHandler::d_use_cmr_cache) {
-        NgapRequestHandler::d_cmr_mem_cache.put(url_key, data_url);
+        NgapRequestHandler::d_cmr_mem_cache.put(url_key, data_url, data_url.size());
         CACHE_LOG(prolog + "CMR Cache put, translated URL: " + data_url + '\n');
     }
 
@@ -200,6 +200,16 @@ bool NgapOwnedContainer::get_item_from_dmrpp_cache(string &dmrpp_string) const {
         CACHE_LOG(prolog + "Memory Cache miss, DMR++: " + get_real_name() + '\n');
     }
 
+    // Next, look in the cache shared by all the besd processes.
+    if (NgapRequestHandler::d_dmrpp_shared_cache.get(get_real_name(), dmrpp_string)) {
+        CACHE_LOG(prolog + "Shared Cache hit, DMR++: " + get_real_name() + '\n');
+        NgapRequestHandler::d_dmrpp_mem_cache.put(get_real_name(), dmrpp_string, dmrpp_string.size());
+        return true;
+    }
+    else if (NgapRequestHandler::d_dmrpp_shared_cache.is_initialized()) {
+        CACHE_LOG(prolog + "Shared Cache miss, DMR++: " + get_real_name() + '\n');
+    }
+
     // Before going over the network to get the DMR++, look in the FileCache.
     // If found, put it in the memory cache and return it as a string.
 
@@ -208,8 +218,9 @@ bool NgapOwnedContainer::get_item_from_dmrpp_cache(string &dmrpp_string) const {
         // read data from the file into the string.
         CACHE_LOG(prolog + "File Cache hit, DMR++: " + get_real_name() + '\n');
         if (file_to_string(item.get_fd(), dmrpp_string)) {
-            // put it in the memory cache
-            NgapRequestHandler::d_dmrpp_mem_cache.put(get_real_name(), dmrpp_string);
+            // put it in the memory caches
+            NgapRequestHandler::d_dmrpp_shared_cache.put(get_real_name(), dmrpp_string);
+            NgapRequestHandler::d_dmrpp_mem_cache.put(get_real_name(), dmrpp_string, dmrpp_string.size());
             CACHE_LOG(prolog + "Memory Cache put, DMR++: " + get_real_name() + '\n');
             return true;
         }
@@ -227,28 +238,57 @@ bool NgapOwnedContainer::get_item_from_dmrpp_cache(string &dmrpp_string) const {
 
 bool NgapOwnedContainer::put_item_in_dmrpp_cache(const std::string &dmrpp_string) const {
 
-    FileCache::PutItem item(NgapRequestHandler::d_dmrpp_file_cache);
-    if (NgapRequestHandler::d_dmrpp_file_cache.put(FileCache::hash_key(get_real_name()), item)) {
-        // Do this in a child thread someday, but what about the return value. jhrg 11/14/23
-        if (write(item.get_fd(), dmrpp_string.data(), dmrpp_string.size()) != dmrpp_string.size()) {
-            ERROR_LOG("NgapOwnedContainer::access() - failed to write DMR++ to file cache\n");
+    {
+        FileCache::PutItem item(NgapRequestHandler::d_dmrpp_file_cache);
+        if (!NgapRequestHandler::d_dmrpp_file_cache.put(FileCache::hash_key(get_real_name()), item)) {
+            ERROR_LOG("NgapOwnedContainer::access() - failed to put DMR++ in file cache\n");
             return false;
         }
-        CACHE_LOG(prolog + "File Cache put, DMR++: " + get_real_name() + '\n');
+        if (!write_dmrpp_to_file_cache(dmrpp_string, item))
+            return false;
     }
-    else {
-        ERROR_LOG("NgapOwnedContainer::access() - failed to put DMR++ in file cache\n");
+
+    purge_dmrpp_file_cache();
+    put_item_in_memory_caches(dmrpp_string);
+
+    return true;
+}
+
+/**
+ * @brief Write the DMR++ to an item made by FileCache::put() or FileCache::get_or_reserve()
+ * @return True if the DMR++ was written, false otherwise
+ */
+bool NgapOwnedContainer::write_dmrpp_to_file_cache(const std::string &dmrpp_string, FileCache::PutItem &item) const {
+    // Do this in a child thread someday, but what about the return value. jhrg 11/14/23
+    if (write(item.get_fd(), dmrpp_string.data(), dmrpp_string.size()) != dmrpp_string.size()) {
+        ERROR_LOG("NgapOwnedContainer::access() - failed to write DMR++ to file cache\n");
+        return false;
+    }
+    if (!item.commit()) {
+        ERROR_LOG("NgapOwnedContainer::access() - failed to commit DMR++ to file cache\n");
         return false;
     }
+    CACHE_LOG(prolog + "File Cache put, DMR++: " + get_real_name() + '\n');
+    return true;
+}
 
-    if (!NgapRequestHandler::d_dmrpp_file_cache.purge()) {
+void NgapOwnedContainer::purge_dmrpp_file_cache() const {
+    // A background purge does not make this request wait while the cache is purged.
+    if (NgapRequestHandler::d_dmrpp_file_cache_background_purge) {
+        if (!NgapRequestHandler::d_dmrpp_file_cache.purge_in_background())
+            ERROR_LOG("NgapOwnedContainer::access() - background FileCache::purge() failed\n");
+    }
+    else if (!NgapRequestHandler::d_dmrpp_file_cache.purge()) {
         ERROR_LOG("NgapOwnedContainer::access() - call to FileCache::purge() failed\n");
     }
+}
 
-    NgapRequestHandler::d_dmrpp_mem_cache.put(get_real_name(), dmrpp_string);
-    CACHE_LOG(prolog + "Memory Cache put, DMR++: " + get_real_name() + '\n');
+void NgapOwnedContainer::put_item_in_memory_caches(const std::string &dmrpp_string) const {
+    if (NgapRequestHandler::d_dmrpp_shared_cache.put(get_real_name(), dmrpp_string))
+        CACHE_LOG(prolog + "Shared Cache put, DMR++: " + get_real_name() + '\n');
 
-    return true;
+    NgapRequestHandler::d_dmrpp_mem_cache.put(get_real_name(), dmrpp_string, dmrpp_string.size());
+    CACHE_LOG(prolog + "Memory Cache put, DMR++: " + get_real_name() + '\n');
 }
 
 /**
@@ -400,6 +440,26 @@ void NgapOwnedContainer::dmrpp_read_from_daac_bucket(string &dmrpp_string) const
     }
 }
 
+/**
+ * @brief Read the DMR++ from the OPeNDAP bucket, if that is used, or the DAAC bucket
+ * @exception BESError if the DMR++ cannot be read
+ */
+void NgapOwnedContainer::dmrpp_read_from_remote_source(string &dmrpp_string) const {
+    bool dmrpp_read = false;
+
+    // If the server is set up to try the OPeNDAP bucket, look there first.
+    if (NgapOwnedContainer::d_use_opendap_bucket) {
+        // If we get the DMR++ from the OPeNDAP bucket, set dmrpp_read to true so
+        // we don't also try the DAAC bucket.
+        dmrpp_read = dmrpp_read_from_opendap_bucket(dmrpp_string);
+    }
+
+    // Try the DAAC bucket if either the OPeNDAP bucket is not used or the OPeNDAP bucket failed
+    if (!dmrpp_read) {
+        dmrpp_read_from_daac_bucket(dmrpp_string);
+    }
+}
+
 /**
  * @brief Get the DMR++ from a remote source or a cache
  *
@@ -418,34 +478,66 @@ void NgapOwnedContainer::dmrpp_read_from_daac_bucket(string &dmrpp_string) const
 bool NgapOwnedContainer::get_dmrpp_from_cache_or_remote_source(string &dmrpp_string) const {
     BES_COMMAND_TIMING(prolog + get_real_name());
 
+    if (!NgapRequestHandler::d_use_dmrpp_cache) {
+        dmrpp_read_from_remote_source(dmrpp_string);
+        return true;
+    }
+
     // If the DMR++ is cached, return it. NB: This cache holds OPeNDAP- and DAAC-owned DMR++ documents.
-    if (NgapRequestHandler::d_use_dmrpp_cache && get_item_from_dmrpp_cache(dmrpp_string)) {
+    if (get_item_from_dmrpp_cache(dmrpp_string)) {
         return true;
     }
-    else {
-        // Else, the DMR++ is neither in the memory cache nor the file cache.
-        // Read it from S3, etc., and filter it. Put it in the memory cache
-        bool dmrpp_read = false;
-
-        // If the server is set up to try the OPeNDAP bucket, look there first.
-        if (NgapOwnedContainer::d_use_opendap_bucket) {
-            // If we get the DMR++ from the OPeNDAP bucket, set dmrpp_read to true so
-            // we don't also try the DAAC bucket.
-            dmrpp_read = dmrpp_read_from_opendap_bucket(dmrpp_string);
+
+    // Else, the DMR++ is not in any of the caches. Reserve it in the file cache so that when
+    // many besd processes ask for the same new DMR++ at once, only one reads it from S3, etc.
+    // The others wait here and then read the copy that process puts in the file cache.
+    bool reserved = false;
+    bool use_file_cache = true;
+    {
+        FileCache::Item item;
+        FileCache::PutItem put_item(NgapRequestHandler::d_dmrpp_file_cache);
+        if (!NgapRequestHandler::d_dmrpp_file_cache.get_or_reserve(FileCache::hash_key(get_real_name()), item,
+                                                                    put_item, reserved)) {
+            ERROR_LOG("NgapOwnedContainer::access() - failed to get or reserve DMR++ in file cache\n");
+        }
+        else if (!reserved && item.get_fd() < 0) {
+            // The process that reserved the DMR++ could not read it. Read it here, at the same
+            // time as the other processes that waited, and leave the file cache alone.
+            use_file_cache = false;
         }
+        else if (!reserved) {
+            if (file_to_string(item.get_fd(), dmrpp_string)) {
+                CACHE_LOG(prolog + "File Cache hit after wait, DMR++: " + get_real_name() + '\n');
+                put_item_in_memory_caches(dmrpp_string);
+                return true;
+            }
+            ERROR_LOG("NgapOwnedContainer::access() - failed to read DMR++ from file cache\n");
+        }
+
+        // Read it from S3, etc., and filter it. If this throws, put_item removes the reservation
+        // and the waiting processes read the DMR++ themselves.
+        dmrpp_read_from_remote_source(dmrpp_string);
 
-        // Try the DAAC bucket if either the OPeNDAP bucket is not used or the OPeNDAP bucket failed
-        if (!dmrpp_read) {
-            dmrpp_read_from_daac_bucket(dmrpp_string);
+        if (reserved && !write_dmrpp_to_file_cache(dmrpp_string, put_item)) {
+            return false;
         }
+    }   // Closing put_item lets the waiting processes read the DMR++.
+
+    // if we get here, the DMR++ has been pulled over the network. Put it in the caches.
+    // The memory caches are for use by this process (and the others on this host), the
+    // file cache for other processes/VMs
+    if (!use_file_cache) {
+        put_item_in_memory_caches(dmrpp_string);
+        return true;
     }
 
-    // if we get here, the DMR++ has been pulled over the network. Put it in both caches.
-    // The memory cache is for use by this process, the file cache for other processes/VMs
-    if (NgapRequestHandler::d_use_dmrpp_cache && !put_item_in_dmrpp_cache(dmrpp_string)) {
-        return false;
+    if (!reserved) {
+        return put_item_in_dmrpp_cache(dmrpp_string);
     }
 
+    purge_dmrpp_file_cache();
+    put_item_in_memory_caches(dmrpp_string);
+
     return true;
 }
 
@@ -490,4 +582,4 @@ void NgapOwnedContainer::dump(ostream &strm) const {
     BESIndent::UnIndent();
 }
 
-} // namespace ngap
\ No newline at end of file
+} // namespace ngap
@@ -32,6 +32,7 @@
 #include <memory>
 
 #include "BESContainer.h"
+#include "FileCache.h"
 
 namespace http {
 class RemoteResource;
@@ -80,10 +81,15 @@ class NgapOwnedContainer: public BESContainer {
 
     bool dmrpp_read_from_opendap_bucket(std::string &dmrpp_string) const;
     void dmrpp_read_from_daac_bucket(std::string &dmrpp_string) const;
+    void dmrpp_read_from_remote_source(std::string &dmrpp_string) const;
 
     bool get_item_from_dmrpp_cache(std::string &dmrpp_string) const;
     bool put_item_in_dmrpp_cache(const std::string &dmrpp_string) const;
 
+    bool write_dmrpp_to_file_cache(const std::string &dmrpp_string, FileCache::PutItem &item) const;
+    void purge_dmrpp_file_cache() const;
+    void put_item_in_memory_caches(const std::string &dmrpp_string) const;
+
     friend class NgapOwnedContainerTest;
 
 protected:
@@ -48,24 +48,31 @@ using namespace ngap;
 
 // CMR caching
 unsigned int NgapRequestHandler::d_cmr_cache_size_items = 100;    // Entries, not size in bytes, MB, etc.
-unsigned int NgapRequestHandler::d_cmr_cache_purge_items = 20;
 
 bool NgapRequestHandler::d_use_cmr_cache = false;
-MemoryCache<std::string> NgapRequestHandler::d_cmr_mem_cache;
+LRUCache<std::string> NgapRequestHandler::d_cmr_mem_cache;
 
 // DMR++ caching
 unsigned int NgapRequestHandler::d_dmrpp_mem_cache_size_items = 100;
-unsigned int NgapRequestHandler::d_dmrpp_mem_cache_purge_items = 20;
+unsigned long long NgapRequestHandler::d_dmrpp_mem_cache_size_mb = 256;
 
 bool NgapRequestHandler::d_use_dmrpp_cache = false;
-MemoryCache<std::string> NgapRequestHandler::d_dmrpp_mem_cache;
+LRUCache<std::string> NgapRequestHandler::d_dmrpp_mem_cache;
 
 long long NgapRequestHandler::d_dmrpp_file_cache_size_mb = 10'000;    // 10,000 MB ~= 10GB, roughly
 long long NgapRequestHandler::d_dmrpp_file_cache_purge_size_mb = 2'000;  // 2,000 MB ~= 2GB
 string NgapRequestHandler::d_dmrpp_file_cache_dir = "/tmp/hyrax_dmrpp_cache";
+bool NgapRequestHandler::d_dmrpp_file_cache_background_purge = false;
 
 FileCache NgapRequestHandler::d_dmrpp_file_cache;
 
+bool NgapRequestHandler::d_use_dmrpp_shared_cache = false;
+unsigned long long NgapRequestHandler::d_dmrpp_shared_cache_size_mb = 256;
+unsigned int NgapRequestHandler::d_dmrpp_shared_cache_items = 4096;
+string NgapRequestHandler::d_dmrpp_shared_cache_file;  // Defaults to a file next to d_dmrpp_file_cache_dir
+
+SharedMemoryCache NgapRequestHandler::d_dmrpp_shared_cache;
+
 NgapRequestHandler::NgapRequestHandler(const string &name) :
         BESRequestHandler(name)
 {
@@ -78,11 +85,7 @@ NgapRequestHandler::NgapRequestHandler(const string &name) :
     if (NgapRequestHandler::d_use_cmr_cache) {
         NgapRequestHandler::d_cmr_cache_size_items
                 = TheBESKeys::read_int_key(CMR_CACHE_THRESHOLD, NgapRequestHandler::d_cmr_cache_size_items);
-        NgapRequestHandler::d_cmr_cache_purge_items
-                = TheBESKeys::read_int_key(CMR_CACHE_SPACE, NgapRequestHandler::d_cmr_cache_purge_items);
-        if (!d_cmr_mem_cache.initialize(d_cmr_cache_size_items, d_cmr_cache_purge_items)) {
-            ERROR_LOG("NgapRequestHandler::NgapRequestHandler() - failed to initialize CMR cache");
-        }
+        d_cmr_mem_cache.set_limits(d_cmr_cache_size_items, 0);
     }
 
     NgapRequestHandler::d_use_dmrpp_cache
@@ -90,11 +93,10 @@ NgapRequestHandler::NgapRequestHandler(const string &name) :
     if (NgapRequestHandler::d_use_dmrpp_cache) {
         NgapRequestHandler::d_dmrpp_mem_cache_size_items
                 = TheBESKeys::read_int_key(DMRPP_CACHE_THRESHOLD,  NgapRequestHandler::d_dmrpp_mem_cache_size_items);
-        NgapRequestHandler::d_dmrpp_mem_cache_purge_items
-                = TheBESKeys::read_int_key(DMRPP_CACHE_SPACE, NgapRequestHandler::d_dmrpp_mem_cache_purge_items);
-        if (!d_dmrpp_mem_cache.initialize(d_dmrpp_mem_cache_size_items, d_dmrpp_mem_cache_purge_items)) {
-            ERROR_LOG("NgapRequestHandler::NgapRequestHandler() - failed to initialize DMR++ cache");
-        }
+        NgapRequestHandler::d_dmrpp_mem_cache_size_mb
+                = TheBESKeys::read_ulong_key(DMRPP_CACHE_SIZE, NgapRequestHandler::d_dmrpp_mem_cache_size_mb);
+        // The DMR++ documents vary a lot in size, so the cache is bounded by bytes as well as entries.
+        d_dmrpp_mem_cache.set_limits(d_dmrpp_mem_cache_size_items, MEGABYTE * d_dmrpp_mem_cache_size_mb);
 
         // Now set up the file cache. Note that the sizes in the bes.conf file are in MB,
         // so convert them to bytes. jhrg 11/14/23
@@ -116,6 +118,30 @@ NgapRequestHandler::NgapRequestHandler(const string &name) :
                                                                NgapRequestHandler::d_dmrpp_file_cache_purge_size_mb)) {
             ERROR_LOG("NgapRequestHandler::NgapRequestHandler() - failed to initialize DMR++ file cache");
         }
+        NgapRequestHandler::d_dmrpp_file_cache_background_purge
+            = TheBESKeys::read_bool_key(DMRPP_FILE_CACHE_BACKGROUND_PURGE,
+                                        NgapRequestHandler::d_dmrpp_file_cache_background_purge);
+
+        // The shared cache is mapped here, in the beslistener, so the besd children inherit it.
+        NgapRequestHandler::d_use_dmrpp_shared_cache
+            = TheBESKeys::read_bool_key(USE_DMRPP_SHARED_CACHE, NgapRequestHandler::d_use_dmrpp_shared_cache);
+        if (NgapRequestHandler::d_use_dmrpp_shared_cache) {
+            NgapRequestHandler::d_dmrpp_shared_cache_size_mb
+                = TheBESKeys::read_ulong_key(DMRPP_SHARED_CACHE_SIZE, NgapRequestHandler::d_dmrpp_shared_cache_size_mb);
+            NgapRequestHandler::d_dmrpp_shared_cache_items
+                = TheBESKeys::read_int_key(DMRPP_SHARED_CACHE_ITEMS, NgapRequestHandler::d_dmrpp_shared_cache_items);
+            // The default file is next to, not in, the file cache directory, where FileCache::purge() could remove it.
+            string default_shared_cache_file = NgapRequestHandler::d_dmrpp_file_cache_dir;
+            while (default_shared_cache_file.size() > 1 && default_shared_cache_file.back() == '/')
+                default_shared_cache_file.pop_back();
+            NgapRequestHandler::d_dmrpp_shared_cache_file
+                = TheBESKeys::read_string_key(DMRPP_SHARED_CACHE_FILE, default_shared_cache_file + "_shared");
+            if (!NgapRequestHandler::d_dmrpp_shared_cache.initialize(NgapRequestHandler::d_dmrpp_shared_cache_file,
+                                                                     MEGABYTE * NgapRequestHandler::d_dmrpp_shared_cache_size_mb,
+                                                                     NgapRequestHandler::d_dmrpp_shared_cache_items)) {
+                ERROR_LOG("NgapRequestHandler::NgapRequestHandler() - failed to initialize DMR++ shared cache");
+            }
+        }
     }
 }
 
@@ -34,8 +34,9 @@
 #include <queue>
 #include <unordered_map>
 
-#include "MemoryCache.h"
+#include "LRUCache.h"
 #include "FileCache.h"
+#include "SharedMemoryCache.h"
 #include "BESRequestHandler.h"
 
 namespace ngap {
@@ -43,23 +44,31 @@ namespace ngap {
 class NgapRequestHandler : public BESRequestHandler {
 
     static unsigned int d_cmr_cache_size_items;  // max number of entries
-    static unsigned int d_cmr_cache_purge_items;      // remove this many during purge
 
     static bool d_use_cmr_cache;
-    static MemoryCache<std::string> d_cmr_mem_cache;
+    static LRUCache<std::string> d_cmr_mem_cache;
 
     static unsigned int d_dmrpp_mem_cache_size_items;  // max number of entries
-    static unsigned int d_dmrpp_mem_cache_purge_items;      // remove this many during purge
+    static unsigned long long d_dmrpp_mem_cache_size_mb;    // max size of the entries; zero means no limit
 
     static bool d_use_dmrpp_cache;
-    static MemoryCache<std::string> d_dmrpp_mem_cache;
+    static LRUCache<std::string> d_dmrpp_mem_cache;
 
     static long long d_dmrpp_file_cache_size_mb;
     static long long d_dmrpp_file_cache_purge_size_mb;
     static std::string d_dmrpp_file_cache_dir;
+    static bool d_dmrpp_file_cache_background_purge;
 
     static FileCache d_dmrpp_file_cache;
 
+    // Used by all the besd processes; checked after d_dmrpp_mem_cache and before d_dmrpp_file_cache
+    static bool d_use_dmrpp_shared_cache;
+    static unsigned long long d_dmrpp_shared_cache_size_mb;
+    static unsigned int d_dmrpp_shared_cache_items;
+    static std::string d_dmrpp_shared_cache_file;
+
+    static SharedMemoryCache d_dmrpp_shared_cache;
+
     friend class NgapContainer;   // give NgapContainer access to the cache parameters
     friend class NgapOwnedContainer;    // give NgapOwnedContainer access to the cache parameters. jhrg 4/29/24
     friend class NgapContainerTest;
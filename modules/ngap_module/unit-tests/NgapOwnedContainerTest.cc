@@ -77,7 +77,7 @@ public:
         NgapRequestHandler::d_dmrpp_file_cache.initialize(NgapRequestHandler::d_dmrpp_file_cache_dir,
                                                           NgapRequestHandler::d_dmrpp_file_cache_size_mb,
                                                           NgapRequestHandler::d_dmrpp_file_cache_purge_size_mb);
-        NgapRequestHandler::d_dmrpp_mem_cache.initialize(100, 20);
+        NgapRequestHandler::d_dmrpp_mem_cache.set_limits(100, 0);
     }
 
     void setUp() override {
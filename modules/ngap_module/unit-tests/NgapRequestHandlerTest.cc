@@ -62,8 +62,7 @@ public:
 
         CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache threshold to be 100", NgapRequestHandler::d_cmr_cache_size_items == 100);
         CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache threshold to be 100", NgapRequestHandler::d_dmrpp_mem_cache_size_items == 100);
-        CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache space to be 20", NgapRequestHandler::d_cmr_cache_purge_items == 20);
-        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache space to be 20", NgapRequestHandler::d_dmrpp_mem_cache_purge_items == 20);
+        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache size to be 256MB", NgapRequestHandler::d_dmrpp_mem_cache_size_mb == 256);
     }
 
     void test_cmr_cache_disabled() {
@@ -78,8 +77,7 @@ public:
 
         CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache threshold to be 100", NgapRequestHandler::d_cmr_cache_size_items == 100);
         CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache threshold to be 100", NgapRequestHandler::d_dmrpp_mem_cache_size_items == 100);
-        CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache space to be 20", NgapRequestHandler::d_cmr_cache_purge_items == 20);
-        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache space to be 20", NgapRequestHandler::d_dmrpp_mem_cache_purge_items == 20);
+        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache size to be 256MB", NgapRequestHandler::d_dmrpp_mem_cache_size_mb == 256);
     }
 
     void test_dmrpp_cache_disabled() {
@@ -94,18 +92,16 @@ public:
         // These will still have the default values
         CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache threshold to be 100", NgapRequestHandler::d_cmr_cache_size_items == 100);
         CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache threshold to be 100", NgapRequestHandler::d_dmrpp_mem_cache_size_items == 100);
-        CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache space to be 20", NgapRequestHandler::d_cmr_cache_purge_items == 20);
-        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache space to be 20", NgapRequestHandler::d_dmrpp_mem_cache_purge_items == 20);
+        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache size to be 256MB", NgapRequestHandler::d_dmrpp_mem_cache_size_mb == 256);
     }
 
     void test_custom_cache_params() {
         TheBESKeys::TheKeys()->reload_keys(BESUtil::assemblePath(TEST_BUILD_DIR, "bes.cache.conf"));
 
         TheBESKeys::TheKeys()->set_key("NGAP.CMRCacheSize.Items", "17");
-        TheBESKeys::TheKeys()->set_key("NGAP.CMRCachePurge.Items", "7");
 
         TheBESKeys::TheKeys()->set_key("NGAP.DMRppCacheSize.Items", "17");
-        TheBESKeys::TheKeys()->set_key("NGAP.DMRppCachePurge.Items", "7");
+        TheBESKeys::TheKeys()->set_key("NGAP.DMRppCacheSize.MB", "7");
 
         d_rh = make_unique<NgapRequestHandler>("test_no_dmrpp_cache");
 
@@ -115,8 +111,10 @@ public:
         // These will still have the default values
         CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache threshold to be 17", NgapRequestHandler::d_cmr_cache_size_items == 17);
         CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache threshold to be 17", NgapRequestHandler::d_dmrpp_mem_cache_size_items == 17);
-        CPPUNIT_ASSERT_MESSAGE("Expected the CMR cache space to be 7", NgapRequestHandler::d_cmr_cache_purge_items == 7);
-        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache space to be 7", NgapRequestHandler::d_dmrpp_mem_cache_purge_items == 7);
+        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ cache size to be 7MB", NgapRequestHandler::d_dmrpp_mem_cache_size_mb == 7);
+        CPPUNIT_ASSERT_MESSAGE("Expected the DMR++ memory cache to use the limits",
+                               NgapRequestHandler::d_dmrpp_mem_cache.max_items() == 17
+                               && NgapRequestHandler::d_dmrpp_mem_cache.max_bytes() == 7 * MEGABYTE);
     }
 
     CPPUNIT_TEST_SUITE( NgapRequestHandlerTest );